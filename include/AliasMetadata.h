@@ -0,0 +1,45 @@
+#ifndef TCFS_ANDERSEN_ALIAS_METADATA_H
+#define TCFS_ANDERSEN_ALIAS_METADATA_H
+
+#include "Andersen.h"
+
+#include "llvm/IR/PassManager.h"
+#include "llvm/Pass.h"
+
+// Encode the solved results into the scoped noalias metadata of the IR
+// (!alias.scope and !noalias), so that the later stages of the compilation,
+// including those of other tool invocations, keep the precision of the
+// analysis without having it around. Each function gets a scope domain of its
+// own, with a scope for each memory object its loads, stores and memory
+// intrinsics may access. An access is in the scopes of the objects its
+// pointers may point to, and is noalias with all the other scopes of the
+// function, which makes two accesses noalias exactly when their points-to sets
+// are disjoint
+// A function that would need more than -anders-alias-metadata-max-scopes
+// scopes gets one scope per alias class (see Andersen::getAliasClass())
+// instead, and past that, the classes with the fewest accesses share a scope.
+// The accesses through pointers the analysis knows nothing about, or that
+// only point to null, are left alone. The metadata already on the accesses
+// is kept
+// Return true if any metadata was added
+bool addAliasMetadata(llvm::Function& f, const Andersen& anders);
+
+// The pass for the new pass manager. It takes the results of AndersenAA, which
+// must be registered with the module analysis manager
+class AndersenAliasMetadataPass
+    : public llvm::PassInfoMixin<AndersenAliasMetadataPass> {
+public:
+    llvm::PreservedAnalyses run(llvm::Module&, llvm::ModuleAnalysisManager&);
+};
+
+class AndersenAliasMetadataWrapperPass : public llvm::ModulePass {
+public:
+    static char ID;
+
+    AndersenAliasMetadataWrapperPass();
+
+    bool runOnModule(llvm::Module&) override;
+    void getAnalysisUsage(llvm::AnalysisUsage& AU) const override;
+};
+
+#endif
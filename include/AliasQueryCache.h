@@ -0,0 +1,74 @@
+#ifndef ANDERSEN_ALIAS_QUERY_CACHE_H
+#define ANDERSEN_ALIAS_QUERY_CACHE_H
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// A bounded cache of the answers to alias queries, keyed by an unordered pair of points-to set ids. The points-to graph doesn't change once it is solved, so an entry never goes stale and the cache never has to be invalidated
+// The cache is direct-mapped: a pair can only live in one entry, and a new pair simply replaces what was there. Each entry is a single atomic word holding both the key and the answer, so any number of threads may look up and insert at the same time without locks. A reader sees either a whole entry or none of it
+class AliasQueryCache
+{
+private:
+	// An entry holds the pair in the top 62 bits, then a bit telling the entry is in use, then the answer. Set ids are below 2^31 (they are bounded by the node indices, see Constraint.h)
+	enum: unsigned { IdBits = 31, KeyShift = 2 };
+	static const std::uint64_t ValidBit = 2;
+	static const std::uint64_t AnswerBit = 1;
+
+	std::unique_ptr<std::atomic<std::uint64_t>[]> entries;
+	unsigned mask;
+
+	static std::uint64_t getKey(unsigned id1, unsigned id2)
+	{
+		if (id1 > id2)
+			std::swap(id1, id2);
+		assert(id2 < (1u << IdBits));
+		return (std::uint64_t(id1) << IdBits) | id2;
+	}
+	std::atomic<std::uint64_t>& getEntry(std::uint64_t key) const
+	{
+		// Fibonacci hashing spreads the pairs of nearby ids over the table
+		return entries[(key * 0x9E3779B97F4A7C15ull) >> 32 & mask];
+	}
+public:
+	// The cache has the smallest power of two entries that is no less than size. A size of 0 disables it
+	AliasQueryCache(unsigned size = 0): mask(0)
+	{
+		if (size == 0)
+			return;
+		unsigned numEntries = 1;
+		while (numEntries < size)
+			numEntries <<= 1;
+		entries.reset(new std::atomic<std::uint64_t>[numEntries]);
+		for (unsigned i = 0; i < numEntries; ++i)
+			entries[i].store(0, std::memory_order_relaxed);
+		mask = numEntries - 1;
+	}
+
+	bool isEnabled() const { return entries != nullptr; }
+
+	// Return true if the answer for (id1, id2) is cached, and put it into answer
+	bool lookup(unsigned id1, unsigned id2, bool& answer) const
+	{
+		if (!isEnabled())
+			return false;
+		std::uint64_t key = getKey(id1, id2);
+		std::uint64_t entry = getEntry(key).load(std::memory_order_relaxed);
+		if ((entry & ValidBit) == 0 || (entry >> KeyShift) != key)
+			return false;
+		answer = (entry & AnswerBit) != 0;
+		return true;
+	}
+
+	void insert(unsigned id1, unsigned id2, bool answer)
+	{
+		if (!isEnabled())
+			return;
+		std::uint64_t key = getKey(id1, id2);
+		getEntry(key).store((key << KeyShift) | ValidBit | (answer ? AnswerBit : 0), std::memory_order_relaxed);
+	}
+};
+
+#endif
@@ -45,16 +45,90 @@
 #ifndef TCFS_ANDERSEN_H
 #define TCFS_ANDERSEN_H
 
+#include "AutoConfig.h"
+#include "CompactPtsGraph.h"
 #include "Constraint.h"
+#include "ConstraintFile.h"
+#include "ConstraintGraph.h"
+#include "ConstraintSummary.h"
+#include "EscapeInfo.h"
+#include "FlowSensitiveInfo.h"
+#include "HotNodeReport.h"
+#include "MemoryUsage.h"
 #include "NodeFactory.h"
-#include "PtsSet.h"
+#include "Parallel.h"
+#include "PhaseTimer.h"
+#include "PtsGraph.h"
+#include "PtsSetView.h"
+#include "ResultsExport.h"
+#include "SolverTrace.h"
 
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/CallSite.h"
+#include "llvm/IR/ValueHandle.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/ValueMapper.h"
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+namespace llvm
+{
+	class CallGraph;
+}
+
+// Where a run of the analysis is, as reported to the progress callback of AndersRunOptions
+struct AndersProgress
+{
+	AndersPhase phase;
+	// The nodes and the constraints when the phase starts. By the time the solving starts, the constraint graph has taken over the constraints
+	unsigned numNodes;
+	unsigned numConstraints;
+	// During the solving only: the outer iterations of the solver done so far, and the nodes the last of them had on its work list
+	unsigned iteration;
+	unsigned workListSize;
+};
+
+// Lets a client stop a run of the analysis from any thread. The run only looks at it between phases and between the iterations of the solver, so it stops soon after, but not right away
+class AndersCancellationToken
+{
+private:
+	std::atomic<bool> cancelled{false};
+public:
+	void cancel() { cancelled.store(true, std::memory_order_relaxed); }
+	bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+};
+
+// What a client can hand to a run of the analysis besides the module. Unlike -anders-time-budget and -anders-memory-budget, which are fixed before the run starts, these let the client watch the run and decide when to stop it
+struct AndersRunOptions
+{
+	// Called at the start of each phase, and after each outer iteration of the solver, on the thread that runs the analysis (see -anders-background-solving). Nothing is reported once the run is cancelled
+	std::function<void(const AndersProgress&)> onProgress;
+	// If set, it must outlive the run. Once it is cancelled, the optional phases (the offline optimizations, offline HCD, the Steensgaard pre-analysis and -enable-partition) are skipped, and the solver stops the way it does when a budget runs out: whatever it has not got to yet points to the universal object, which the queries read as unknown. The collection always completes
+	const AndersCancellationToken* cancellation = nullptr;
+	// If not empty, only these functions are collected, and the calls to the other defined functions are treated like calls to unknown external functions (see -anders-scope). With scopeReachable, the functions their direct calls reach are collected as well
+	std::vector<const llvm::Function*> scope;
+	bool scopeReachable = false;
+	// Take getMemoryUsage() at the start of each phase and at the end of the solving, and keep the largest for Andersen::getPeakMemoryUsage(). Each sample walks the points-to sets and the constraint graph
+	bool trackPeakMemory = false;
+	// If set, it must outlive the run, and the parallel phases run on it instead of on a pool of the analysis' own (see Andersen::getThreadPool()). Analyses that run at the same time may share one, so that together they never run more threads than it has (see andersen-batch)
+	AndersThreadPool* threadPool = nullptr;
+};
+
 class Andersen
 {
 private:
@@ -63,46 +137,601 @@ private:
 
 	// Constraints - This vector contains a list of all of the constraints identified by the program.
 	std::vector<AndersConstraint> constraints;
+	// With -anders-field-sensitive, the constraints that step from a field to another (see AndersFieldConstraint). fieldSensitive tells whether the collection makes any, which depends on what else is enabled
+	std::vector<AndersFieldConstraint> fieldConstraints;
+	bool fieldSensitive = false;
+	// Whether the collection merges the nodes of plain pointer copies into their sources (see -anders-coalesce-copies and createValueNodesForFunction())
+	bool coalesceCopies = false;
+	// How the allocation sites are grouped into heap objects (see -anders-heap-abstraction). Above Site, the sites of a group share the object node of the first one committed, which heapObjects keeps by the key of the group (see getHeapObjectKey())
+	enum class HeapGranularity { Site, Function, Type, Single };
+	HeapGranularity heapGranularity = HeapGranularity::Site;
+	llvm::DenseMap<const void*, NodeIndex> heapObjects;
+	// With -enable-constraint-streaming, the constraints go into this graph (and the address-of ones into ptsGraph) each time a batch of them is collected, so that the full constraint vector never exists. Null otherwise, and once the solver has taken the graph over
+	std::unique_ptr<ConstraintGraph> streamedGraph;
+
+	// This is the points-to graph generated by the analysis. It only lives until the solving is over; the queries use the compact copy made by compactResults()
+	AndersPtsGraph ptsGraph;
+	CompactPtsGraph solvedPtsGraph;
+
+	// Location equivalence classes found during constraint optimization. Only the key of an entry is put into the points-to sets, and it stands for the objects in the value part as well
+	llvm::DenseMap<NodeIndex, std::vector<NodeIndex>> locationClasses;
+
+	// The reverse of the points-to sets, for getPointedBySet(). It is built on the first call, since most clients never ask
+	struct PointedByIndex
+	{
+		// Map from a memory object to the ids of the points-to sets that have it (see CompactPtsGraph::getSetId())
+		llvm::DenseMap<const llvm::Value*, llvm::SparseBitVector<>> setsOfObject;
+		// The pointers that have each set, in node order, indexed by set id
+		std::vector<std::vector<const llvm::Value*>> pointersOfSet;
+	};
+	mutable std::unique_ptr<PointedByIndex> pointedByIndex;
+	// Replaced when updateFunctions() drops the index
+	mutable std::unique_ptr<std::once_flag> pointedByIndexFlag{new std::once_flag};
+
+	// The targets of the indirect calls of the module, for getResolvedCallees() and exportCallGraph(). Like the pointed-by index, it is built on the first call
+	struct ResolvedCallGraph
+	{
+		enum: unsigned { UnknownTargets = ~0u };
+		// An indirect call, with the range of callees its targets are in. begin is UnknownTargets if the call may call any address-taken function
+		struct ResolvedCall
+		{
+			const llvm::Instruction* inst;
+			unsigned begin, end;
+		};
+		// In module order
+		std::vector<ResolvedCall> calls;
+		std::vector<const llvm::Function*> callees;
+		// Map from an indirect call instruction to its position in calls
+		llvm::DenseMap<const llvm::Instruction*, unsigned> callIndex;
+	};
+	mutable std::unique_ptr<ResolvedCallGraph> resolvedCallGraph;
+	mutable std::unique_ptr<std::once_flag> resolvedCallGraphFlag{new std::once_flag};
+
+	// The alias class of each points-to set, by set id, for getAliasClass(). Like the pointed-by index, it is built on the first call
+	struct AliasClassIndex
+	{
+		std::vector<unsigned> classOfSet;
+		unsigned numClasses;
+	};
+	mutable std::unique_ptr<AliasClassIndex> aliasClassIndex;
+	mutable std::unique_ptr<std::once_flag> aliasClassIndexFlag{new std::once_flag};
+
+	// The ObjectCategory bits of the objects of each points-to set, location equivalents included, by set id. It is built on the first call of getPointeeCategories(), or when the frozen results are
+	mutable std::vector<unsigned char> setCategories;
+	mutable std::unique_ptr<std::once_flag> setCategoriesFlag{new std::once_flag};
+
+	// The external library functions we know how to model (see ExternalLibrary.cpp)
+	enum ExternalLibraryKind
+	{
+		EXT_UNKNOWN,
+		EXT_NOOP,
+		EXT_MALLOC,
+		EXT_REALLOC,
+		EXT_RET_ARG0,
+		EXT_RET_ARG1,
+		EXT_RET_ARG2,
+		EXT_MEMCPY,
+		EXT_CONVERT,
+		EXT_VA_START,
+	};
+
+	// The classification of every external function of the module, computed once while the globals are collected
+	llvm::DenseMap<const llvm::Function*, ExternalLibraryKind> externalLibraryKinds;
+	// With -anders-heap-cloning, the allocation wrappers of the module (see isAllocationWrapper()), each mapped to whether it may also return null. A direct call to one of them gets an object of its own rather than the object of the allocation in the wrapper
+	llvm::DenseMap<const llvm::Function*, bool> allocWrappers;
+
+	// An address-taken function that an indirect call may reach. External declarations carry their library classification, so that it is not recomputed at every indirect call site
+	struct IndirectCallTarget
+	{
+		const llvm::Function* func;
+		ExternalLibraryKind extKind;
+		// The position of func in the module, used to visit the candidates of a call in module order
+		unsigned order;
+	};
+	// The address-taken functions that take a fixed number of arguments, indexed by that number, and the vararg ones, which may be called with any number of arguments. Built once while the globals are collected
+	std::vector<std::vector<IndirectCallTarget>> fixedArityTargets;
+	std::vector<IndirectCallTarget> varargTargets;
+	// With -anders-type-metadata-calls, the functions in the vtable slots of each type identifier, keyed by the identifier and the byte offset of the slot from the address point that the !type metadata of the vtable gives. Built once while the globals are collected
+	llvm::DenseMap<std::pair<const llvm::Metadata*, uint64_t>, std::vector<const llvm::Function*>> typeSlotTargets;
+
+	// With -enable-otf-callgraph, an indirect call is not wired to its possible targets during collection. The solver resolves it once it knows where the callee pointer points to (see resolveIndirectCalls())
+	struct IndirectCallRecord
+	{
+		const llvm::Instruction* inst;
+		NodeIndex callee;
+		// The objects in the callee's points-to set that have been looked at
+		llvm::SparseBitVector<> examinedObjs;
+		// True if the callee may point to the universal object, in which case the call may reach any address-taken function
+		bool unknownTarget;
+		// The functions resolved as the targets of the call so far
+		std::vector<const llvm::Function*> targets;
+
+		IndirectCallRecord(const llvm::Instruction* i, NodeIndex c): inst(i), callee(c), unknownTarget(false) {}
+	};
+	std::vector<IndirectCallRecord> indirectCalls;
+	// Map from an indirect call instruction to its record in indirectCalls
+	llvm::DenseMap<const llvm::Instruction*, unsigned> indirectCallIndex;
+	// The nodes the on-the-fly call resolution may add copy edges into: the formal arguments of the address-taken functions and the values of the indirect calls. The constraint optimizer doesn't see those edges, so it must treat these nodes conservatively
+	std::vector<NodeIndex> lateCopyTargets;
+
+	// With -anders-dense-value-nodes, where the value nodes of each defined function start: the node of its first pointer instruction, which the nodes of the others follow in instruction order, and the position of its first formal argument in formalNodes. formalNodes holds the node of every formal argument, InvalidIndex for those that are not pointers
+	struct LocalValueNodes
+	{
+		static const unsigned NoFormals = ~0u;
+
+		NodeIndex firstInstNode;
+		unsigned firstFormal;
+
+		LocalValueNodes(): firstInstNode(AndersNodeFactory::InvalidIndex), firstFormal(NoFormals) {}
+	};
+	llvm::DenseMap<const llvm::Function*, LocalValueNodes> localValueNodes;
+	std::vector<NodeIndex> formalNodes;
+
+	// The output of constraint collection for a group of functions. Collecting into a buffer reads the shared state but writes nothing else, so several buffers can be filled at the same time (see -anders-collect-threads)
+	// The nodes created during collection (the objects of the allocation sites and the temporaries) get provisional indices, counted up from ProvisionalIndexBase in the order of creation. commitCollectionBuffer() creates the real nodes in that order and rewrites the constraints that refer to them
+	struct CollectionBuffer
+	{
+		std::vector<AndersConstraint> constraints;
+		std::vector<AndersFieldConstraint> fieldConstraints;
+		// The value each new node stands for. Object nodes and value nodes are told apart by isObject. An object may have several fields
+		struct NewNode
+		{
+			const llvm::Value* val;
+			bool isObject;
+			unsigned numFields;
+		};
+		std::vector<NewNode> newNodes;
+		std::vector<IndirectCallRecord> indirectCalls;
+		std::vector<NodeIndex> lateCopyTargets;
+		unsigned numIndirectCalls = 0;
+		// Where the constraints and the new nodes of each function start, for the per-function records of -anders-incremental
+		struct FunctionStart
+		{
+			const llvm::Function* func;
+			unsigned constraint;
+			unsigned newNode;
+		};
+		std::vector<FunctionStart> functionStarts;
+		// While summarize() collects a module: the calls the linker wires, and the constraints kept aside for the calls to declared functions
+		std::vector<ConstraintSummary::ExternalCall> externalCalls;
+		std::vector<AndersConstraint> fallbackConstraints;
+		std::vector<ConstraintSummary::IndirectCall> summaryIndirectCalls;
+		// Warnings to be printed once the buffer is committed, so that the output of concurrent workers doesn't interleave
+		std::string diagnostics;
+		// With -anders-dense-value-nodes, while a function body is collected: the instruction being collected and its value node, and the value nodes of the formal arguments of the function by argument number (see getLocalValueNode())
+		const llvm::Instruction* currInst;
+		NodeIndex currInstNode;
+		const NodeIndex* currFormals;
+		// With -anders-direct-stack-access, the objects of the allocas of the function being collected (see getStackObject())
+		llvm::DenseMap<const llvm::Value*, NodeIndex> stackObjects;
+
+		CollectionBuffer(): currInst(nullptr), currInstNode(AndersNodeFactory::InvalidIndex), currFormals(nullptr) {}
+
+		NodeIndex createObjectNode(const llvm::Value* val, unsigned numFields = 1)
+		{
+			newNodes.push_back(NewNode{val, true, numFields});
+			return ProvisionalIndexBase + newNodes.size() - 1;
+		}
+		NodeIndex createValueNode()
+		{
+			newNodes.push_back(NewNode{nullptr, false, 1});
+			return ProvisionalIndexBase + newNodes.size() - 1;
+		}
+	};
+	// With -anders-incremental, what updateFunctions() needs to analyze some function bodies again without collecting the others: the constraints tagged by the function whose body they come from
+	struct IncrementalState
+	{
+		// The constraints that don't come from a function body: the special nodes, the globals and the formal arguments
+		std::vector<AndersConstraint> globalConstraints;
+		struct FunctionRecord
+		{
+			std::vector<AndersConstraint> constraints;
+			// The nodes created for the body: the values of its instructions, the objects it allocates and its temporaries
+			std::vector<NodeIndex> nodes;
+		};
+		llvm::DenseMap<const llvm::Function*, FunctionRecord> functions;
+		// What the collection of a body depends on outside of it (see hashModuleShape())
+		size_t moduleShape;
+	};
+	std::unique_ptr<IncrementalState> incrementalState;
+
+	// With -anders-append, what appendDefinitions() solves on from: the constraint graph and the points-to sets the solver ends with, which are otherwise thrown away once the results are compacted. The merges stay in nodeFactory. graph is null until the first solving is over
+	struct AppendState
+	{
+		std::unique_ptr<ConstraintGraph> graph;
+		AndersPtsGraph ptsGraph;
+		// What the module looked like when it was last collected (see hashModuleShape())
+		size_t moduleShape;
+	};
+	std::unique_ptr<AppendState> appendState;
 
-	// This is the points-to graph generated by the analysis
-	std::map<NodeIndex, AndersPtsSet> ptsGraph;
+	// With createLazily(), what is left of the function bodies once they have been collected and freed
+	struct LazyBodyState
+	{
+		// The module, which the collection materializes and frees the bodies of
+		llvm::Module* module;
+		// The functions whose address is taken. The module can't tell that before all of its bodies have been read
+		llvm::DenseSet<const llvm::Function*> addressTakenFuncs;
+		// The functions with a body in the bitcode. Function::isDeclaration() can't tell, since a body may be yet to be materialized, freed already, or being materialized by the thread of -anders-lazy-prefetch
+		llvm::DenseSet<const llvm::Function*> definedFuncs;
+		struct ReleasedBody
+		{
+			// The number of basic blocks and instructions the body had (see PersistedResultsFormat::hashModuleLayout())
+			unsigned size;
+			unsigned numInsts;
+			// The nodes of the instructions, each with the position of its instruction in the body
+			std::vector<std::pair<NodeIndex, unsigned>> nodes;
+		};
+		llvm::DenseMap<const llvm::Function*, ReleasedBody> releasedBodies;
+	};
+	std::unique_ptr<LazyBodyState> lazyBodies;
+
+	// With -enable-dead-pointer-elim or createForQueries(), the constraints that can't reach any pointer the queries may ask about are dropped before solving (see pruneDeadPointers()). queriedValues are the pointers createForQueries() was given, and queryRoots the nodes of those pointers and of the pointers the loads, stores and calls of the module use
+	bool pruneForQueries = false;
+	std::vector<const llvm::Value*> queriedValues;
+	std::vector<NodeIndex> queryRoots;
+
+	// With -anders-scope or AndersRunOptions::scope, the defined functions whose bodies are left out of the collection (see AnalysisScope.cpp)
+	llvm::DenseSet<const llvm::Function*> scopedOut;
+
+	// See Andersen(const llvm::Module&, const AndersRunOptions&). cancelled is set if the solving was stopped by the cancellation token
+	AndersRunOptions runOptions;
+	bool cancelled = false;
+	// The indirect call sites the collection has met, for the profile of -anders-auto-config, and the configuration it chose
+	unsigned numIndirectCallSites = 0;
+	std::unique_ptr<AndersAutoConfig> autoConfig;
+	// What the worklist solver spent on each node, kept for -anders-hot-nodes and -anders-function-cost only
+	std::unique_ptr<SolverNodeProfile> nodeProfile;
+	// The function of each cost tag of -anders-function-cost. Tag 0 is for the globals and the nodes of no function, and has no function
+	std::vector<const llvm::Function*> costTagFunctions;
+	// While the constraints are solved, for getMemoryUsage(): the constraint graph, and the size of the HCD table
+	const ConstraintGraph* solvingGraph = nullptr;
+	std::size_t hcdTableMemory = 0;
+	// The largest of the samples of AndersRunOptions::trackPeakMemory, and what the solvings of this analysis have done
+	AndersMemoryUsage peakMemoryUsage;
+	AndersSolverWork solverWork;
+
+	// With createOnDemand(), the collected constraints indexed for the queries, and the part of them that the queries have solved so far. A node is demanded once a query needs its points-to set, directly or through the constraints. Only the demanded nodes are solved, in ptsGraph, and their sets stay valid from one query to the next
+	struct DemandState
+	{
+		// The constraints of one kind grouped by one of their nodes: the group of node n is elems[first[n]] to elems[first[n + 1]]
+		struct Index
+		{
+			std::vector<unsigned> first;
+			std::vector<NodeIndex> elems;
+
+			void build(unsigned numNodes, const std::vector<std::pair<NodeIndex, NodeIndex>>& pairs);
+			llvm::ArrayRef<NodeIndex> operator[](NodeIndex n) const { return llvm::makeArrayRef(elems.data() + first[n], elems.data() + first[n + 1]); }
+		};
+		// The objects whose address is taken into each node, the sources of the copies into each node and the pointers of the loads into each node
+		Index addrOfsInto, copiesInto, loadsInto;
+		// The destinations of the loads through each pointer, and the sources of the stores through each pointer
+		Index loadsThrough, storesThrough;
+		std::vector<NodeIndex> storePointers;
+
+		llvm::BitVector demanded;
+		// Any store may write to an object, so the pointers of all the stores are demanded along with the first object
+		bool storesDemanded = false;
+		std::vector<NodeIndex> newlyDemanded;
+		// The copy edges between the demanded nodes, from the copies, and from the loads and the stores once the objects they go through are known
+		llvm::DenseMap<NodeIndex, std::vector<NodeIndex>> copyEdges;
+		// The objects in the set of each load and store pointer that have been looked at
+		llvm::DenseMap<NodeIndex, llvm::SparseBitVector<>> examinedObjs;
+		std::vector<NodeIndex> workList;
+		llvm::BitVector onWorkList;
+	};
+	std::unique_ptr<DemandState> demandState;
+
+	// While summarize() collects a module, the summary that the calls depending on the other modules go into
+	std::unique_ptr<ConstraintSummary> summary;
+	// With createFromSummaries(), where the nodes of each module ended up, for writeModuleResults()
+	struct LinkedModule
+	{
+		// ConstraintSummary::valueNodeOf and ConstraintSummary::valueOfNode, with the linked nodes
+		std::vector<std::uint32_t> valueNodeOf;
+		std::vector<std::pair<NodeIndex, std::uint32_t>> valueOfNode;
+		std::uint64_t moduleHash;
+	};
+	std::vector<LinkedModule> linkedModules;
+
+	// With -anders-defer-solving or -anders-background-solving, runOnModule() only collects the constraints, and the rest is done by the first query (see waitForSolution()), or by a thread of its own that the first query waits for
+	struct DeferredSolve
+	{
+		const llvm::Module* module;
+		std::once_flag solved;
+		std::thread worker;
+
+		~DeferredSolve()
+		{
+			if (worker.joinable())
+				worker.join();
+		}
+	};
+
+	// Real node indices stay below this. It leaves half of the index space for the provisional ones and fits in the packed constraint encoding
+	enum: NodeIndex { ProvisionalIndexBase = 1u << 30 };
+
+	// With -anders-track-values, a handle on each value the analysis knows, through which the deletions and the replacements the later passes make reach the results (see ValueTracker.cpp)
+	class TrackedValueHandle: public llvm::CallbackVH
+	{
+	private:
+		Andersen* anders;
+	public:
+		TrackedValueHandle(llvm::Value* v, Andersen* a): llvm::CallbackVH(v), anders(a) {}
+		void reset(llvm::Value* v) { setValPtr(v); }
+
+		void deleted() override;
+		void allUsesReplacedWith(llvm::Value* newVal) override;
+	};
+	struct ValueTracker
+	{
+		std::deque<TrackedValueHandle> handles;
+		// The handles whose values have been deleted, for the next values to track
+		std::vector<TrackedValueHandle*> freeHandles;
+		llvm::DenseSet<const llvm::Value*> tracked;
+		// Set once a change could not be followed
+		bool lostTrack = false;
+		// See getTrackedVersion()
+		unsigned version = 0;
+	};
+	std::unique_ptr<ValueTracker> valueTracker;
+
+	// The workers the parallel phases run on (see getThreadPool()). Declared before deferredSolve, so that a solving thread is done with the pool before it goes away
+	std::unique_ptr<AndersThreadPool> threadPool;
+
+	// Declared last, so that a solving thread is done before the members it works on go away
+	std::unique_ptr<DeferredSolve> deferredSolve;
 
 	// Three main phases
 	void collectConstraints(const llvm::Module&);
+	// Pack the object nodes together (see AndersNodeFactory::packObjectNodes()). It runs between collection and optimization, while the constraints are the only place where the nodes are related to each other
+	void renumberNodes();
 	void optimizeConstraints();
+	// The part of optimizeConstraints() that -anders-optimize-cache stands in for
+	void runOfflineOptimizers(const std::vector<NodeIndex>& indirectTargets);
 	void solveConstraints();
+	// Whether nothing between the collection and the solver needs the constraint vector, so that the constraints can be streamed into the constraint graph
+	static bool canStreamConstraints();
+	// Whether everything between the collection and the queries knows about the field constraints, so that -anders-field-sensitive can make them
+	static bool canUseFieldConstraints();
+	// Move the constraints collected so far into streamedGraph
+	void streamConstraints();
+	// Get rid of what only the solver needs once the solving is over
+	void compactResults();
+	// Everything that follows the collection, whether the constraints come from the IR or from a constraint file
+	void solveCollectedConstraints();
+	// solveCollectedConstraints(), then the results file of -anders-write-results
+	void solveModule(const llvm::Module&);
+	// Block until the results are there. The queries call this first, since the solving may have been deferred
+	void waitForSolution() const;
+	// With -anders-auto-config: choose the optimizations from the profile of the collected constraints and set the options accordingly. Return the values the options had, for restoreAutoConfigOptions() once the solving is over, so that the choice for one module doesn't stick to the next
+	AndersAutoConfig applyAutoConfig();
+	static void restoreAutoConfigOptions(const AndersAutoConfig& saved);
+	// The pool the parallel phases of this analysis share: AndersRunOptions::threadPool if the client gave one, or else a pool as large as the largest of -anders-threads, -anders-collect-threads and -anders-offline-threads asks for, or nullptr if none of them asks for more than one thread. The first call makes it
+	AndersThreadPool* getThreadPool();
+	// Report the start of phase to the progress callback, and return true, unless the run has been cancelled. An optional phase is skipped if it returns false
+	bool startPhase(AndersPhase phase);
+	bool isCancelRequested() const { return runOptions.cancellation != nullptr && runOptions.cancellation->isCancelled(); }
+
+	// Create the nodes and the constraints of a constraint file in place of collectConstraints()
+	bool readConstraints(const ConstraintFileReader& reader, std::string& error);
+	// The analysis of a constraint file. It has no IR behind it
+	Andersen() {}
 
 	// Helper functions for constraint collection
 	void collectConstraintsForGlobals(const llvm::Module&);
-	void collectConstraintsForInstruction(const llvm::Instruction*);
-	void addGlobalInitializerConstraints(NodeIndex, const llvm::Constant*);
-	void addConstraintForCall(llvm::ImmutableCallSite cs);
-	bool addConstraintForExternalLibrary(llvm::ImmutableCallSite cs, const llvm::Function* f);
-	void addArgumentConstraintForCall(llvm::ImmutableCallSite cs, const llvm::Function* f);
+	void createGlobalVariableNodes(const llvm::GlobalVariable&);
+	void createFunctionNodes(const llvm::Function&, unsigned& funcOrder);
+	void collectGlobalInitializerConstraints(const llvm::GlobalVariable&);
+	void createValueNodesForFunction(const llvm::Function&);
+	void collectConstraintsForFunction(const llvm::Function&, CollectionBuffer& buffer) const;
+	void collectConstraintsForInstruction(const llvm::Instruction*, CollectionBuffer& buffer) const;
+	NodeIndex getLocalValueNode(const llvm::Value* v, const CollectionBuffer& buffer) const;
+	NodeIndex getStackObject(const llvm::Value* ptr, const CollectionBuffer& buffer) const;
+	void commitCollectionBuffer(CollectionBuffer& buffer);
+	const void* getHeapObjectKey(const llvm::Instruction* site) const;
+	void addGlobalInitializerConstraints(NodeIndex, const llvm::Constant*, unsigned offset = 0);
+	void collectInitializerTargets(const llvm::Constant*, llvm::SparseBitVector<>& targets) const;
+	// Helper functions for -anders-field-sensitive. getNumFieldsFor() is 1 unless the collection is field-sensitive
+	unsigned getNumFieldsFor(llvm::Type* t) const;
+	void addCopyConstraint(NodeIndex dst, NodeIndex src, CollectionBuffer& buffer) const;
+	void addFieldConstraint(NodeIndex dst, NodeIndex src, unsigned offset, CollectionBuffer& buffer) const;
+	void addConstraintForCall(llvm::ImmutableCallSite cs, CollectionBuffer& buffer) const;
+	bool addConstraintForExternalLibrary(llvm::ImmutableCallSite cs, const llvm::Function* f, CollectionBuffer& buffer) const;
+	bool addConstraintForExternalLibrary(llvm::ImmutableCallSite cs, const llvm::Function* f, ExternalLibraryKind kind, CollectionBuffer& buffer) const;
+	static ExternalLibraryKind classifyExternalLibrary(const llvm::Function* f);
+	void findAllocationWrappers(const llvm::Module&);
+	bool isAllocationWrapper(const llvm::Function& f, bool& mayReturnNull) const;
+	bool isFreshAllocation(const llvm::Value* v, bool& mayReturnNull) const;
+	static void loadExternalLibrarySpec(llvm::StringRef fileName, llvm::StringMap<ExternalLibraryKind>& kindMap);
+	void addArgumentConstraintForCall(llvm::ImmutableCallSite cs, const llvm::Function* f, CollectionBuffer& buffer) const;
+	void addIndirectCallTarget(IndirectCallRecord& call, const llvm::Function* f, CollectionBuffer& buffer) const;
+	void collectTypeSlotTargets(const llvm::GlobalVariable& vtable);
+	const std::vector<const llvm::Function*>* getTypeSlotTargets(llvm::ImmutableCallSite cs) const;
+	// f.hasAddressTaken() and f.isDeclaration(), except that a module read by createLazily() has its bodies read and freed one at a time, so its uses and its bodies don't tell
+	bool isAddressTaken(const llvm::Function& f) const;
+	bool isExternalFunction(const llvm::Function& f) const;
+
+	// Helper functions for -anders-scope
+	void selectScope(const llvm::Module& m);
+	void addScopeBoundaryConstraints(const llvm::Module& m);
+
+	// Helper functions for summarize() and createFromSummaries()
+	void getCallArgNodes(llvm::ImmutableCallSite cs, std::vector<NodeIndex>& args) const;
+	void deferExternalCall(llvm::ImmutableCallSite cs, const llvm::Function* f, unsigned firstConstraint, CollectionBuffer& buffer) const;
+	void fillSummary(const llvm::Module& m);
+	struct LinkedFunction;
+	bool linkSummaries(llvm::ArrayRef<const ConstraintSummary*> summaries, std::string& error);
+	void addLinkedCallConstraints(const LinkedFunction& target, NodeIndex result, llvm::ArrayRef<NodeIndex> args);
+	void addLinkedLibraryConstraints(ExternalLibraryKind kind, NodeIndex result, llvm::ArrayRef<NodeIndex> args);
+
+	// Helper functions for createLazily()
+	void collectLazyBodies();
+	void collectLazyBody(llvm::Function& f);
+	void detachBodies(llvm::ArrayRef<llvm::Function*> funcs, NodeIndex firstNode);
+
+	// Helper functions for createOnDemand()
+	void buildDemandState();
+	void demandNode(NodeIndex n);
+	void addDemandedEdge(NodeIndex src, NodeIndex dst);
+	void initDemandedNode(NodeIndex n);
+	void propagateDemanded(NodeIndex n);
+	void solveDemanded();
+
+	// Helper functions for constraint solving
+	bool resolveIndirectCalls();
+
+	// Helper functions for incremental updates
+	// added (if not null) lists the globals and functions to leave out, as if they weren't in the module
+	static size_t hashModuleShape(const llvm::Module&, const llvm::SmallPtrSetImpl<const llvm::GlobalValue*>* added = nullptr);
+	void findAffectedNodes(llvm::ArrayRef<const IncrementalState::FunctionRecord*> retracted, const llvm::BitVector& deadNodes, llvm::BitVector& affected) const;
+	void getOldPtsSet(NodeIndex n, std::vector<NodeIndex>& objs) const;
+	void resetAnalysis();
+
+	// Helper functions for -anders-track-values
+	void startTrackingValues();
+	void trackValue(const llvm::Value* v);
+	void forgetTrackedValue(const llvm::Value* v);
+	void replaceTrackedValue(const llvm::Value* oldVal, llvm::Value* newVal);
+
+	// Helper functions for dead pointer elimination
+	void findQueryRoots(const llvm::Module&);
+	void pruneDeadPointers();
 
 	// Helper functions for constraint optimization
 	NodeIndex getRefNodeIndex(NodeIndex n) const;
 	NodeIndex getAdrNodeIndex(NodeIndex n) const;
 
+	// Helper functions for the queries
+	void getValuesInPtsSet(const CompactPtsSet& ptsSet, std::vector<const llvm::Value*>& vals) const;
+	void buildPointedByIndex() const;
+	void buildAliasClassIndex() const;
+	void buildSetCategories() const;
+	unsigned getSetCategories(unsigned setId) const;
+	void buildResolvedCallGraph(const llvm::Module& m) const;
+	// Drop the indices the queries build on demand, because the results have changed under them
+	void dropQueryIndices();
+	// Write a results file (see PersistedResults.h) with the given values of the module
+	void writeResults(llvm::raw_ostream& os, std::uint64_t moduleHash, const std::vector<std::uint32_t>& valueNodeOf, const std::vector<std::uint32_t>& valueOfNode) const;
+
+	// With -anders-memory-report, print getMemoryUsage() to stderr, as taken at the point named by when. With AndersRunOptions::trackPeakMemory, keep it if it is the largest so far
+	void sampleMemoryUsage(const char* when);
+	// The report of -anders-hot-nodes, into the file of -anders-hot-nodes-file or stderr. It reads the points-to graph, so it has to come before compactResults()
+	void printHotNodeReport(llvm::raw_ostream& os, unsigned topN) const;
+	void writeHotNodeReport() const;
+	// -anders-function-cost: give each node the cost tag of its function before the offline optimizations merge any, and report the functions whose tags the worklist solver charged the most work to, into the file of -anders-function-cost-file or stderr
+	void assignCostTags();
+	void printFunctionCostReport(llvm::raw_ostream& os, unsigned topN) const;
+	void writeFunctionCostReport() const;
+
 	// For debugging
 	void dumpConstraint(const AndersConstraint&) const;
 	void dumpConstraints() const;
 	void dumpConstraintsPlainVanilla() const;
 	void dumpPtsGraphPlainVanilla() const;
+	void dumpIndirectCallTargets() const;
 public:
 	static char ID;
 
+	// With -anders-defer-solving, the constraints are collected here, but they are only optimized and solved when the first query comes, so that a pipeline that never asks doesn't pay for it. -anders-background-solving starts solving on a thread of its own right away, and the first query waits for it to finish
 	Andersen(const llvm::Module&);
+	// The same, with a progress callback and a cancellation token for the run (see AndersRunOptions)
+	Andersen(const llvm::Module&, const AndersRunOptions& options);
 	bool runOnModule(const llvm::Module& M);
+	// Whether the run was cancelled before the solver reached its fixed point, so that some of the points-to sets are unknown
+	bool wasCancelled() const { waitForSolution(); return cancelled; }
+	// The memory the analysis holds right now, by data structure (see MemoryUsage.h). It may be taken at any point of the run from the thread that runs it, e.g. from the progress callback, and from any thread once the run is over
+	AndersMemoryUsage getMemoryUsage() const;
+	// The largest getMemoryUsage() seen at the phase boundaries, by total, if the run was given AndersRunOptions::trackPeakMemory
+	const AndersMemoryUsage& getPeakMemoryUsage() const { waitForSolution(); return peakMemoryUsage; }
+	// The work of the online solver, summed over all the solvings of the analysis (the incremental updates included). The sub-problems of -enable-partition are not counted
+	const AndersSolverWork& getSolverWork() const { waitForSolution(); return solverWork; }
+	// The optimizations -anders-auto-config chose for this run, or nullptr without it
+	const AndersAutoConfig* getAutoConfig() const { waitForSolution(); return autoConfig.get(); }
 
 	// Given a llvm pointer v,
-	// - Return false if the analysis doesn't know where v points to. In other words, the client must conservatively assume v can points to everything.
+	// - Return false if the analysis doesn't know where v points to. In other words, the client must conservatively assume v can points to everything. This includes the pointers whose points-to sets have the universal object
 	// - Return true otherwise, and the points-to set of v is put into the second argument.
 	bool getPointsToSet(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet) const;
+	// The same as getPointsToSet(), but the set is handed out as a view into the analysis rather than copied (see PtsSetView.h). The view is only valid as long as the analysis is. Unlike getPointsToSet(), a set with the universal object still gives a view, with AndersPtsSetView::hasUniversalObject() set
+	bool getPointsToSetView(const llvm::Value* v, AndersPtsSetView& view) const;
+	// The same for node n, for the analyses that have no IR behind them (see createFromConstraints() and createFromSummaries()), whose nodes are numbered as in their input. Return false if n doesn't exist
+	bool getPointsToSetViewOfNode(NodeIndex n, AndersPtsSetView& view) const;
+	// The batch form of getPointsToSet(): put the points-to set of values[i] into ptsSets[i], or set bit i of unknown where getPointsToSet() would return false. The pointers that share a points-to set share the work of listing it
+	void getPointsToSets(llvm::ArrayRef<const llvm::Value*> values, std::vector<std::vector<const llvm::Value*>>& ptsSets, llvm::BitVector& unknown) const;
+	// The reverse of getPointsToSet(): put into the second argument the pointers whose points-to sets have allocSite. Return false if allocSite is not a memory object known to the analysis
+	// The first call builds a reverse index of all the points-to sets. Later calls only look it up
+	bool getPointedBySet(const llvm::Value* allocSite, std::vector<const llvm::Value*>& pointers) const;
+	// The alias class of pointer v. The pointers whose points-to sets have objects are partitioned into classes, the connected components of the relation "has an object in common", so two of them may alias only if they are in the same class. The classes are numbered from 0 to getNumAliasClasses() - 1. v is in NoAliasClass if it only points to null (or to nothing), and may alias no other pointer, and in UniversalAliasClass if the analysis doesn't know where it points to, and may alias any pointer
+	// The first call partitions all the points-to sets at once. Later calls only look the class up
+	enum: unsigned { NoAliasClass = ~0u - 1, UniversalAliasClass = ~0u };
+	unsigned getAliasClass(const llvm::Value* v) const;
+	unsigned getNumAliasClasses() const;
+	// The kinds of memory v may point to, as a mask of AndersNodeFactory::ObjectCategory bits: the stack, the heap, globals, constant globals, functions. UniversalObject is set if the analysis doesn't know where v points to, and the mask is 0 if v only points to null
+	// The first call works out the mask of every points-to set at once, from the categories the objects were given when they were created, so later calls are a lookup and never look at the objects themselves
+	unsigned getPointeeCategories(const llvm::Value* v) const;
 	// Put all allocation sites (i.e. all memory objects identified by the analysis) into the first arugment
 	void getAllAllocationSites(std::vector<const llvm::Value*>& allocSites) const;
+	// Given an indirect call instruction, put the functions it may call into the second argument. This is only available with -enable-otf-callgraph, and only for the targets that are defined in the module (calls to external functions are still modeled during collection). Return false if the call is not known to the analysis or if it may call any address-taken function
+	bool getIndirectCallTargets(const llvm::Instruction* callInst, std::vector<const llvm::Function*>& targets) const;
+	// Put into callees the functions the indirect call callInst may call according to the solved points-to set of its callee pointer, with or without -enable-otf-callgraph. The functions that can't take as many arguments as the call passes are left out; the external ones are not. The first call resolves all the indirect calls of the module of callInst in a single pass, and the later ones only look them up. Return false if callInst is not an indirect call the analysis knows, or if it may call any address-taken function
+	bool getResolvedCallees(const llvm::Instruction* callInst, llvm::ArrayRef<const llvm::Function*>& callees) const;
+	// Point the indirect call edges of cg, freshly built from the analyzed module, at the callees getResolvedCallees() gives instead of at the external calling node. The calls that may call any address-taken function keep their edge to it, and so do the calls the analysis doesn't know
+	void exportCallGraph(llvm::CallGraph& cg) const;
+	// Save the solved results of module m, which must be the module that was analyzed, in the format of PersistedResults.h. Other processes can then answer queries about m by loading the file instead of running the analysis
+	void writeSolvedResults(const llvm::Module& m, llvm::raw_ostream& os) const;
+	// Stream the solved results of module m, which must be the module that was analyzed, into sink (see ResultsExport.h): each distinct points-to set once, and then the id of the set of each pointer. Nothing is built beyond a map of the values to their ids, so the export costs about as much as reading the sets once. After createLazily(), the values of the freed bodies are left out
+	void exportResults(const llvm::Module& m, AndersResultsSink& sink) const;
+	// Find where each alloca and heap allocation site of module m, which must be the module that was analyzed, may escape to (see EscapeInfo.h), for all of them at once: one walk over the solved points-to sets of the objects from the globals, one from what the analysis doesn't know, and one per allocating function from its arguments and return value, instead of a walk per object
+	void computeEscapes(const llvm::Module& m, AndersEscapeInfo& info) const;
+	// Refine the solved points-to sets of the pointers of f flow-sensitively, and add them to info (see FlowSensitiveInfo.h). The solution decides which objects each load and store may access, so the sets only travel from the stores to the loads they may reach, along def-use chains built per partition of memory, and a store to a single location replaces its contents. f is analyzed on its own: its arguments, what its calls return and the memory on entry or after a call keep their solved sets
+	void computeFlowSensitive(const llvm::Function& f, AndersFlowSensitiveInfo& info) const;
+
+	// Save the collected constraints in the format of ConstraintFile.h (see -anders-write-constraints). Only valid before the constraints are optimized
+	void writeConstraints(llvm::raw_ostream& os) const;
+	// Optimize and solve the constraints of a constraint file, without any IR. Return nullptr and put the reason into error if the file is inconsistent
+	// Nothing in the result has a value, so the value-based queries all come back empty. The file doesn't record the indirect calls that -enable-otf-callgraph resolves during solving, so it should be written without that option
+	static std::unique_ptr<Andersen> createFromConstraints(const ConstraintFileReader& reader, std::string& error, const AndersRunOptions& options = AndersRunOptions());
+
+	// Analyze m, which has been read lazily (see llvm::getLazyIRFileModule()), without ever having all of its function bodies in memory: each body is materialized, its constraints are collected, and the body is freed again. addressTakenFuncs has a bit for each function of m, in module order, set if the function's address is taken (see findAddressTakenFunctions())
+	// The values of the freed bodies are no longer known to the queries. Their results are kept by writeSolvedResults(), which must be given m, so the file it writes answers the queries about the whole module later on. The analysis is collected by a single thread, and can't be combined with -enable-otf-callgraph or -anders-incremental, which need the bodies after collection. Return nullptr and put the reason into error on failure
+	static std::unique_ptr<Andersen> createLazily(llvm::Module& m, const llvm::BitVector& addressTakenFuncs, std::string& error, const AndersRunOptions& options = AndersRunOptions());
+	// Find the functions of m, which has been read lazily, whose address is taken, for createLazily(). The bodies are materialized and freed one at a time, so m is of no use afterwards: createLazily() must be given another copy of the same module
+	static bool findAddressTakenFunctions(llvm::Module& m, llvm::BitVector& addressTakenFuncs, std::string& error);
+
+	// Collect the constraints of m without solving them, for the clients that only ask about a few pointers (see getPointsToSetOnDemand()). The other queries don't work on the result. Return nullptr and put the reason into error on failure. Not available with -enable-otf-callgraph, since the calls it resolves during solving are missing from the constraints
+	static std::unique_ptr<Andersen> createOnDemand(const llvm::Module& m, std::string& error);
+	// Analyze m for a client that only asks about the pointers in queries and those the loads, stores and calls of m use, as -enable-dead-pointer-elim does for the latter. The constraints none of them depend on are dropped before solving, which leaves their answers as they would have been. The pointers whose sets were cut short are forgotten, so the queries about them come back as "don't know". Return nullptr and put the reason into error on failure. Not available with -anders-incremental, whose records need every constraint
+	static std::unique_ptr<Andersen> createForQueries(const llvm::Module& m, llvm::ArrayRef<const llvm::Value*> queries, std::string& error);
+	// getPointsToSet() for an analysis made by createOnDemand(). Only the constraints the set of v depends on are solved, starting from v and going backwards: the copies and the loads into it, and for an object, the stores that may write to it. What is solved for one query is kept for the next ones. The constraints are not optimized, so each query costs more than with the whole module solved, but the queries about a few pointers cost much less than solving the module
+	bool getPointsToSetOnDemand(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet);
+
+	// Collect the constraints of m, one module of a program, into a summary that can be linked with the summaries of the other modules (see ConstraintSummary.h). Nothing is solved. Return nullptr and put the reason into error on failure. Not available with -enable-otf-callgraph, since the linker has no call instructions to resolve
+	static std::unique_ptr<ConstraintSummary> summarize(const llvm::Module& m, std::string& error);
+	// Link the summaries of the modules of a program by symbol name, then optimize and solve the constraints of the whole program. Return nullptr and put the reason into error if the summaries are inconsistent
+	// There is no IR behind the result, so the value-based queries all come back empty. The results of each module are saved with writeModuleResults()
+	static std::unique_ptr<Andersen> createFromSummaries(llvm::ArrayRef<const ConstraintSummary*> summaries, std::string& error);
+	// Save the results of m, the module of the index-th summary given to createFromSummaries(), in the format of PersistedResults.h. The file answers the queries about m as if m had been linked with the rest of the program, except that the points-to lists leave out the objects that have no value in m (the allocation sites of the other modules). The alias queries still take them into account. Return false and put the reason into error if m is not the module of the summary
+	bool writeModuleResults(unsigned index, const llvm::Module& m, llvm::raw_ostream& os, std::string& error) const;
+
+	// Bring the results up to date after the bodies of changedFuncs have changed in m, which must be the module that was analyzed. This needs the records kept with -anders-incremental: the constraints of the changed bodies are retracted and collected again, and the solving restarts from the previous solution, except for the pointers the retracted constraints may have contributed to. Nothing else in the module is collected again
+	// changedFuncs must name every function whose body changed. When anything else changed (globals, declarations, which functions have their address taken), or without the records, the module is analyzed from scratch. Return false in that case
+	// Any view or AndersenAAResult built on the previous results must be rebuilt (see AndersenAAResult::updateFunctions())
+	bool updateFunctions(const llvm::Module& m, llvm::ArrayRef<const llvm::Function*> changedFuncs);
+	// Extend the results to the functions and globals that have been added to m since it was last analyzed, such as the code a JIT adds to its module over time. This needs the state kept with -anders-append: only the new definitions are collected, their constraints go into the constraint graph the last solving ended with, and the worklist solver goes on from the last solution, starting from the nodes the new constraints touch. Adding code never takes anything out of a points-to set, so the old results are only ever extended
+	// newFuncs and newGlobals must name everything added, and nothing that was there before may have changed. When the old code is affected after all (a new function whose address is taken, which the old indirect calls may reach, or a new allocation wrapper), or without the state, the module is analyzed from scratch. Return false in that case
+	bool appendDefinitions(const llvm::Module& m, llvm::ArrayRef<const llvm::Function*> newFuncs, llvm::ArrayRef<const llvm::GlobalVariable*> newGlobals);
+
+	// With -anders-track-values, the results follow the changes the later passes make to the IR instead of going stale: a deleted value is forgotten, and the value that all the uses of another one are replaced with takes its place. The values a pass clones (e.g. the body of an inlined call) are only known if the pass hands its value map to noteClonedValues(): each clone then has the points-to set of its original, and a cloned memory object is a location equivalent of its original. Not available with -anders-incremental, -anders-defer-solving, -anders-background-solving or createLazily()
+	void noteClonedValues(const llvm::ValueToValueMapTy& vmap);
+	void noteClonedValue(const llvm::Value* orig, const llvm::Value* clone);
+	// Whether the results still describe the IR as the tracked changes left it. This is false without -anders-track-values, and once a change could not be followed (a memory object replaced with another object the analysis knows, or with something that isn't an object), after which the module must be analyzed again
+	bool followsIRChanges() const { return valueTracker && !valueTracker->lostTrack; }
+	// Bumped by every tracked change that adds nodes or changes the memory objects. Whatever is built on the results, such as the views and AndersFrozenResults, must be rebuilt when it changes
+	unsigned getTrackedVersion() const { return valueTracker ? valueTracker->version : 0; }
 
 	friend class AndersenAAResult;
+	friend class AndersFrozenResults;
 };
 
 #endif
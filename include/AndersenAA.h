@@ -1,24 +1,117 @@
 #ifndef TCFS_ANDERSEN_AA_H
 #define TCFS_ANDERSEN_AA_H
 
+#include "AliasQueryCache.h"
 #include "Andersen.h"
+#include "FrozenResults.h"
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
 
+#include <memory>
+
 class AndersenAAResult : public llvm::AAResultBase<AndersenAAResult> {
 private:
     friend llvm::AAResultBase<AndersenAAResult>;
 
-    Andersen anders;
+    // The solved analysis. Copies of the result share it
+    std::shared_ptr<Andersen> anders;
+    // A hash of the IR the analysis was run on (see isUpToDate())
+    size_t irHash;
+
+    // The summaries of the solved sets that the queries are answered from. Copies of the result share it. With -anders-defer-solving, it is built on the first query (see ensureSolved())
+    std::shared_ptr<const AndersFrozenResults> frozen;
+    // The version of the tracked changes that frozen and the mod/ref
+    // summaries were built at (see Andersen::getTrackedVersion())
+    unsigned frozenVersion = 0;
+    typedef AndersFrozenResults::SetSummary SetSummary;
+    typedef AndersFrozenResults::ResolvedPointer ResolvedPointer;
+    // The answers of the queries that had to intersect two sets, keyed by the ids of the sets
+    AliasQueryCache aliasCache;
+
+    // What a call may load and store, for the mod/ref queries. The object sets leave out the special objects: reading or writing through a pointer that may point to anything sets refAll or modAll instead
+    struct ModRefEffect {
+        AndersPtsSet ref, mod;
+        bool refAll = false, modAll = false;
+    };
+    // The effect of a function with everything it may call, computed bottom-up over the SCCs of the call graph (see buildModRefSummaries()). The functions of an SCC share one summary. The sets are ranges of modRefElems, sorted like the sets of CompactPtsGraph
+    struct ModRefSummary {
+        unsigned refBegin, modBegin, modEnd;
+        bool refAll, modAll;
+    };
+    std::vector<ModRefSummary> modRefSummaries;
+    std::vector<NodeIndex> modRefElems;
+    llvm::DenseMap<const llvm::Function*, unsigned> modRefSummaryOf;
+    // The summaries are built on the first mod/ref query, so the clients that only ask alias queries don't pay for them
+    bool modRefBuilt = false;
+
+    // Wait for the analysis to be solved, and build frozen if it isn't yet, or
+    // if a tracked change has made it stale
+    void ensureSolved();
+    void buildModRefSummaries(const llvm::Module&);
+    void addPointeeEffect(const llvm::Value* ptr, bool mod, bool ref, ModRefEffect&) const;
+    void addExternalCallEffect(llvm::ImmutableCallSite cs, const llvm::Function* f, ModRefEffect&) const;
+    void getCallEffect(llvm::ImmutableCallSite cs, ModRefEffect&, llvm::SmallVectorImpl<const llvm::Function*>& callees) const;
     llvm::AliasResult andersenAlias(const llvm::Value*, const llvm::Value*);
+    llvm::AliasResult aliasResolved(const ResolvedPointer&, const ResolvedPointer&);
+    // AndersFrozenResults::aliasSets(), with the answers that had to intersect the sets cached
+    llvm::AliasResult aliasSets(unsigned, unsigned);
 
 public:
     AndersenAAResult(const llvm::Module&);
 
+    // The points-to queries are answered by the underlying analysis
+    const Andersen& getAndersen() const { return *anders; }
+    // An immutable view of the results that any number of threads can query at once (see FrozenResults.h). It stays valid until the result is updated, or with -anders-track-values, until the IR changes
+    std::shared_ptr<const AndersFrozenResults> getFrozenResults() {
+        ensureSolved();
+        return frozen;
+    }
+
+    // Return true if the pointer-related IR of m is the same as when the analysis was run, or if the analysis has followed the changes to it (see Andersen::followsIRChanges()), so the result still holds
+    bool isUpToDate(const llvm::Module& m) const;
+    // The result stays valid unless the pass that has run neither preserved it nor left the pointer-related IR alone
+    bool invalidate(llvm::Module& m, const llvm::PreservedAnalyses& pa, llvm::ModuleAnalysisManager::Invalidator&);
+    // Bring the result up to date after the bodies of changedFuncs have changed, analyzing only what they affect (see Andersen::updateFunctions()). The copies of the result share the update
+    void updateFunctions(const llvm::Module& m, llvm::ArrayRef<const llvm::Function*> changedFuncs);
+    // Extend the result to the functions and globals added to m since, solving on from the last solution (see Andersen::appendDefinitions()). The copies of the result share the update
+    void appendDefinitions(const llvm::Module& m, llvm::ArrayRef<const llvm::Function*> newFuncs, llvm::ArrayRef<const llvm::GlobalVariable*> newGlobals);
+    // With -anders-track-values, make the values a pass has cloned known to the analysis (see Andersen::noteClonedValues()). The copies of the result share them
+    void noteClonedValues(const llvm::ValueToValueMapTy& vmap) { anders->noteClonedValues(vmap); }
+
     llvm::AliasResult alias(const llvm::MemoryLocation&,
                             const llvm::MemoryLocation&);
     bool pointsToConstantMemory(const llvm::MemoryLocation&, bool);
+    // Whether the call may read or write loc, from the objects the functions it may call (and their callees) load and store
+    llvm::ModRefInfo getModRefInfo(llvm::ImmutableCallSite, const llvm::MemoryLocation&);
+
+    // Batch queries. The pointers are looked up once each, and the pointers that share a points-to set share the work
+    // Put the answer of the query (v, values[i]) into results[i]
+    void getAliasResults(const llvm::Value* v, llvm::ArrayRef<const llvm::Value*> values, std::vector<llvm::AliasResult>& results);
+    // Set bit i of mayAlias if v may alias values[i]
+    void getMayAliasMask(const llvm::Value* v, llvm::ArrayRef<const llvm::Value*> values, llvm::BitVector& mayAlias);
+    // Set bit j of mayAlias[i] if values[i] may alias values[j]. The sets are intersected once per pair of distinct sets rather than once per pair of values
+    void getMayAliasMatrix(llvm::ArrayRef<const llvm::Value*> values, std::vector<llvm::BitVector>& mayAlias);
+};
+
+// The analysis for the new pass manager. It is a module analysis, so the function passes share one solved result through the AAManager:
+//   MAM.registerPass([] { return AndersenAA(); });
+//   AAM.registerModuleAnalysis<AndersenAA>();
+class AndersenAA : public llvm::AnalysisInfoMixin<AndersenAA> {
+private:
+    friend llvm::AnalysisInfoMixin<AndersenAA>;
+    static llvm::AnalysisKey Key;
+
+public:
+    typedef AndersenAAResult Result;
+
+    AndersenAAResult run(llvm::Module&, llvm::ModuleAnalysisManager&);
 };
 
 class AndersenAAWrapperPass : public llvm::ModulePass {
@@ -0,0 +1,44 @@
+#ifndef ANDERSEN_AUTO_CONFIG_H
+#define ANDERSEN_AUTO_CONFIG_H
+
+#include "Constraint.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+// The statistics -anders-auto-config chooses the optimizations from. They are taken from the collected constraints before any of them is optimized, in a single pass over them
+struct AndersConstraintProfile
+{
+	unsigned numNodes = 0;
+	unsigned numConstraints = 0;
+	unsigned numAddrOf = 0;
+	unsigned numCopy = 0;
+	unsigned numLoad = 0;
+	unsigned numStore = 0;
+	// The indirect calls the collection has met, whether it wired them to all the address-taken functions or left them to -enable-otf-callgraph
+	unsigned numIndirectCalls = 0;
+	// The copies from a node to one created before it. The collection creates the nodes of a function in the order of its instructions, so an acyclic copy graph has few of them. The phis of loops and the calls back into a function make most of the others, so they are a cheap estimate of how cyclic the copy graph is
+	unsigned numBackwardCopies = 0;
+
+	static AndersConstraintProfile compute(unsigned numNodes, llvm::ArrayRef<AndersConstraint> constraints, unsigned numIndirectCalls);
+
+	// The share of the loads and the stores in all constraints
+	double getComplexRatio() const { return numConstraints == 0 ? 0 : double(numLoad + numStore) / numConstraints; }
+	// The share of the backward copies in all copies
+	double getBackwardCopyRatio() const { return numCopy == 0 ? 0 : double(numBackwardCopies) / numCopy; }
+};
+
+// The optimizations -anders-auto-config turns on, and the cost model that picks them. The thresholds of the model are options of their own (-anders-auto-*), so that they can be tuned against the timings of andersen-bench
+struct AndersAutoConfig
+{
+	bool hvn = false;
+	bool hu = false;
+	bool hcd = false;
+	bool lcd = false;
+
+	static AndersAutoConfig choose(const AndersConstraintProfile& profile);
+	// E.g. "hvn+hu+lcd", or "none"
+	void print(llvm::raw_ostream& os) const;
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef ANDERSEN_BDD_H
+#define ANDERSEN_BDD_H
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// A small reduced ordered binary decision diagram (ROBDD) package, just enough to represent sets of unsigned integers
+// An element x is the assignment of the NumVars variables to the bits of x, most significant bit first. With this variable order, walking a BDD low branch first enumerates its elements in increasing order
+// Nodes are reference counted. A node whose count drops to zero is not freed right away: garbage is collected at the beginning of a top-level operation, once the node table has grown enough since the last collection. Results of operations are handed to the caller with one reference already taken
+// All public functions are thread-safe
+class AndersBddManager
+{
+public:
+	typedef unsigned BddRef;
+	static const BddRef False = 0;
+	static const BddRef True = 1;
+	static const unsigned NumVars = 32;
+private:
+	struct Node
+	{
+		// NumVars for the terminals, FreeVar for the slots on the free list
+		unsigned var;
+		BddRef lo, hi;
+		unsigned refCount;
+	};
+	static const unsigned FreeVar = NumVars + 1;
+
+	enum OpKind
+	{
+		OP_OR,
+		OP_AND,
+		OP_DIFF,
+	};
+
+	typedef std::pair<unsigned, std::pair<BddRef, BddRef>> TripleKey;
+
+	mutable std::mutex mutex;
+	std::vector<Node> nodes;
+	std::vector<BddRef> freeList;
+	// (var, lo, hi) -> node
+	llvm::DenseMap<TripleKey, BddRef> uniqueTable;
+	// (op, lhs, rhs) -> result
+	llvm::DenseMap<TripleKey, BddRef> opCache;
+	// Collect garbage once this many nodes are in use
+	unsigned gcThreshold;
+
+	// The following functions expect the mutex to be held
+	BddRef makeNode(unsigned var, BddRef lo, BddRef hi);
+	BddRef apply(OpKind op, BddRef lhs, BddRef rhs);
+	BddRef applyTopLevel(OpKind op, BddRef lhs, BddRef rhs);
+	void refLocked(BddRef n);
+	void derefLocked(BddRef n);
+	void maybeCollectGarbage();
+	std::uint64_t countRec(BddRef n, llvm::DenseMap<BddRef, std::uint64_t>& memo) const;
+	bool findRec(BddRef n, unsigned level, bool tight, unsigned lowerBound, unsigned& value) const;
+	unsigned getNumLiveNodesLocked() const { return nodes.size() - freeList.size(); }
+
+	AndersBddManager(const AndersBddManager&) = delete;
+	AndersBddManager& operator=(const AndersBddManager&) = delete;
+public:
+	AndersBddManager();
+
+	// The manager used by AndersPtsSet
+	static AndersBddManager& getGlobalManager();
+
+	// The set {x}
+	BddRef getSingleton(unsigned x);
+	// lhs | rhs, lhs & rhs and lhs & ~rhs
+	BddRef getUnion(BddRef lhs, BddRef rhs);
+	BddRef getIntersection(BddRef lhs, BddRef rhs);
+	BddRef getDifference(BddRef lhs, BddRef rhs);
+
+	void ref(BddRef n);
+	void deref(BddRef n);
+
+	bool has(BddRef n, unsigned x) const;
+	// The number of elements of n
+	std::uint64_t count(BddRef n) const;
+	// Put the smallest element of n that is no less than lowerBound into result. Return false if there is no such element
+	bool findFrom(BddRef n, unsigned lowerBound, unsigned& result) const;
+
+	// Free all nodes that are no longer referenced
+	void collectGarbage();
+	// The number of nodes in use, terminals included
+	unsigned getNumNodes() const;
+	// The node table, the unique table and the operation cache (see MemoryUsage.h)
+	std::size_t getMemoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#ifndef ANDERSEN_BLOCKBITVECTOR_H
+#define ANDERSEN_BLOCKBITVECTOR_H
+
+#include "MemoryUsage.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// A flat bitvector cut into blocks of 512 bits (one cache line), with a summary bitmap that has one bit per block, set if and only if the block has any bit set. The set operations walk the summary and only touch the blocks that are non-empty, so a set of a few objects scattered over a large graph costs a few blocks per operation rather than a scan of the whole vector
+// The block kernels use AVX-512 or AVX2 when the compiler targets them (see ANDERSEN_NATIVE_ARCH in CMakeLists.txt), and plain 64-bit words otherwise. unionWith() finds out whether anything changed from the registers it already holds, and doesn't write back a block that had all the bits of the other one. It counts the bits it adds, so that the sets keep their size without a count() afterwards
+class AndersBlockBitVector
+{
+public:
+	typedef uint64_t Word;
+	static const unsigned WordBits = 64;
+	static const unsigned WordsPerBlock = 8;
+	static const unsigned BlockBits = WordBits * WordsPerBlock;
+private:
+	// WordsPerBlock words per block. The blocks past the end are empty
+	std::vector<Word> words;
+	// Bit b is set if and only if block b is non-empty
+	std::vector<Word> summary;
+
+	unsigned getNumBlocks() const { return words.size() / WordsPerBlock; }
+	Word* getBlock(unsigned b) { return &words[b * WordsPerBlock]; }
+	const Word* getBlock(unsigned b) const { return &words[b * WordsPerBlock]; }
+
+	bool isBlockNonEmpty(unsigned b) const
+	{
+		return b / WordBits < summary.size() && (summary[b / WordBits] >> (b % WordBits) & 1);
+	}
+	void setBlockNonEmpty(unsigned b)
+	{
+		summary[b / WordBits] |= Word(1) << (b % WordBits);
+	}
+	void setBlockEmpty(unsigned b)
+	{
+		summary[b / WordBits] &= ~(Word(1) << (b % WordBits));
+	}
+
+	void growTo(unsigned numBlocks)
+	{
+		if (numBlocks <= getNumBlocks())
+			return;
+		words.resize(numBlocks * WordsPerBlock);
+		summary.resize((numBlocks + WordBits - 1) / WordBits);
+	}
+
+	// Call f(b) on every block b whose summary bit is set in summaryWord(i) for some i, in increasing order
+	template <typename SummaryWord, typename Func>
+	static bool forEachBlock(unsigned numSummaryWords, SummaryWord summaryWord, Func f)
+	{
+		for (unsigned i = 0; i < numSummaryWords; ++i)
+		{
+			for (Word w = summaryWord(i); w != 0; w &= w - 1)
+			{
+				if (!f(i * WordBits + llvm::countTrailingZeros(w)))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// dst |= src. Return the number of bits dst gains
+	static unsigned orBlock(Word* dst, const Word* src)
+	{
+#if defined(__AVX512F__)
+		__m512i a = _mm512_loadu_si512(dst);
+		__m512i b = _mm512_loadu_si512(src);
+		__m512i gained = _mm512_andnot_si512(a, b);
+		if (_mm512_test_epi64_mask(gained, _mm512_set1_epi64(-1)) == 0)
+			return 0;
+		_mm512_storeu_si512(dst, _mm512_or_si512(a, b));
+		Word newBits[WordsPerBlock];
+		_mm512_storeu_si512(newBits, gained);
+		return countBlock(newBits);
+#elif defined(__AVX2__)
+		__m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+		__m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + 4));
+		__m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+		__m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4));
+		// testc is set if b has no bit that a doesn't have
+		if (_mm256_testc_si256(a0, b0) & _mm256_testc_si256(a1, b1))
+			return 0;
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_or_si256(a0, b0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4), _mm256_or_si256(a1, b1));
+		Word newBits[WordsPerBlock];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(newBits), _mm256_andnot_si256(a0, b0));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(newBits + 4), _mm256_andnot_si256(a1, b1));
+		return countBlock(newBits);
+#else
+		unsigned gained = 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+			gained += llvm::countPopulation(src[i] & ~dst[i]);
+		if (gained == 0)
+			return 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+			dst[i] |= src[i];
+		return gained;
+#endif
+	}
+
+	static unsigned countBlock(const Word* block)
+	{
+		unsigned ret = 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+			ret += llvm::countPopulation(block[i]);
+		return ret;
+	}
+
+	// Return true if a has every bit of b
+	static bool blockContains(const Word* a, const Word* b)
+	{
+#if defined(__AVX512F__)
+		__m512i va = _mm512_loadu_si512(a);
+		__m512i vb = _mm512_loadu_si512(b);
+		return _mm512_test_epi64_mask(_mm512_andnot_si512(va, vb), _mm512_set1_epi64(-1)) == 0;
+#elif defined(__AVX2__)
+		return _mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b))) &
+			_mm256_testc_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 4)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 4)));
+#else
+		Word missing = 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+			missing |= b[i] & ~a[i];
+		return missing == 0;
+#endif
+	}
+
+	// Return true if a and b share a bit
+	static bool blockIntersects(const Word* a, const Word* b)
+	{
+#if defined(__AVX512F__)
+		return _mm512_test_epi64_mask(_mm512_loadu_si512(a), _mm512_loadu_si512(b)) != 0;
+#elif defined(__AVX2__)
+		return !(_mm256_testz_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b))) &
+			_mm256_testz_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + 4)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 4))));
+#else
+		Word common = 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+			common |= a[i] & b[i];
+		return common != 0;
+#endif
+	}
+
+	// dst &= ~src. Return true if dst is still non-empty
+	static bool andNotBlock(Word* dst, const Word* src)
+	{
+#if defined(__AVX512F__)
+		__m512i r = _mm512_andnot_si512(_mm512_loadu_si512(src), _mm512_loadu_si512(dst));
+		_mm512_storeu_si512(dst, r);
+		return _mm512_test_epi64_mask(r, r) != 0;
+#elif defined(__AVX2__)
+		__m256i r0 = _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst)));
+		__m256i r1 = _mm256_andnot_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + 4)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), r0);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 4), r1);
+		return !(_mm256_testz_si256(r0, r0) & _mm256_testz_si256(r1, r1));
+#else
+		Word left = 0;
+		for (unsigned i = 0; i < WordsPerBlock; ++i)
+		{
+			dst[i] &= ~src[i];
+			left |= dst[i];
+		}
+		return left != 0;
+#endif
+	}
+public:
+	// Return the first set bit at or after from, or -1 if there is none
+	int findNext(unsigned from) const
+	{
+		unsigned b = from / BlockBits;
+		if (b < getNumBlocks() && isBlockNonEmpty(b))
+		{
+			const Word* block = getBlock(b);
+			unsigned i = from % BlockBits / WordBits;
+			Word w = block[i] & (~Word(0) << (from % WordBits));
+			while (true)
+			{
+				if (w != 0)
+					return b * BlockBits + i * WordBits + llvm::countTrailingZeros(w);
+				if (++i == WordsPerBlock)
+					break;
+				w = block[i];
+			}
+		}
+		// Jump to the next non-empty block
+		++b;
+		for (unsigned s = b / WordBits; s < summary.size(); ++s)
+		{
+			Word w = summary[s];
+			if (s == b / WordBits)
+				w &= ~Word(0) << (b % WordBits);
+			if (w == 0)
+				continue;
+			unsigned next = s * WordBits + llvm::countTrailingZeros(w);
+			const Word* block = getBlock(next);
+			for (unsigned i = 0; i < WordsPerBlock; ++i)
+			{
+				if (block[i] != 0)
+					return next * BlockBits + i * WordBits + llvm::countTrailingZeros(block[i]);
+			}
+		}
+		return -1;
+	}
+
+	bool test(unsigned idx) const
+	{
+		unsigned b = idx / BlockBits;
+		return b < getNumBlocks() && (getBlock(b)[idx % BlockBits / WordBits] >> (idx % WordBits) & 1);
+	}
+
+	// Return true if the bit was not set before
+	bool testAndSet(unsigned idx)
+	{
+		unsigned b = idx / BlockBits;
+		growTo(b + 1);
+		Word& w = getBlock(b)[idx % BlockBits / WordBits];
+		Word mask = Word(1) << (idx % WordBits);
+		if (w & mask)
+			return false;
+		w |= mask;
+		setBlockNonEmpty(b);
+		return true;
+	}
+
+	// Return the number of bits *this gains, which is 0 if it doesn't change
+	unsigned unionWith(const AndersBlockBitVector& other)
+	{
+		unsigned gained = 0;
+		const std::vector<Word>& otherSummary = other.summary;
+		forEachBlock(otherSummary.size(), [&otherSummary](unsigned i) { return otherSummary[i]; }, [&](unsigned b) {
+			growTo(b + 1);
+			if (unsigned n = orBlock(getBlock(b), other.getBlock(b)))
+			{
+				setBlockNonEmpty(b);
+				gained += n;
+			}
+			return true;
+		});
+		return gained;
+	}
+
+	// Return true if *this has every bit of other
+	bool contains(const AndersBlockBitVector& other) const
+	{
+		// A block that is only non-empty in other settles it without looking at the blocks
+		for (unsigned i = 0, e = other.summary.size(); i < e; ++i)
+		{
+			Word mine = i < summary.size() ? summary[i] : 0;
+			if (other.summary[i] & ~mine)
+				return false;
+		}
+		const std::vector<Word>& otherSummary = other.summary;
+		return forEachBlock(otherSummary.size(), [&otherSummary](unsigned i) { return otherSummary[i]; }, [&](unsigned b) {
+			return blockContains(getBlock(b), other.getBlock(b));
+		});
+	}
+
+	// Return true if *this and other share a bit
+	bool intersects(const AndersBlockBitVector& other) const
+	{
+		unsigned n = std::min(summary.size(), other.summary.size());
+		// forEachBlock() stops at the first block that shares a bit
+		return !forEachBlock(n, [this, &other](unsigned i) { return summary[i] & other.summary[i]; }, [&](unsigned b) {
+			return !blockIntersects(getBlock(b), other.getBlock(b));
+		});
+	}
+
+	// Make *this the bits of lhs that are not in rhs
+	void assignDifference(const AndersBlockBitVector& lhs, const AndersBlockBitVector& rhs)
+	{
+		AndersBlockBitVector result(lhs);
+		unsigned n = std::min(result.summary.size(), rhs.summary.size());
+		forEachBlock(n, [&result, &rhs](unsigned i) { return result.summary[i] & rhs.summary[i]; }, [&](unsigned b) {
+			if (!andNotBlock(result.getBlock(b), rhs.getBlock(b)))
+				result.setBlockEmpty(b);
+			return true;
+		});
+		*this = std::move(result);
+	}
+
+	void clear()
+	{
+		words.clear();
+		summary.clear();
+	}
+
+	std::size_t getMemoryUsage() const { return getVectorMemoryUsage(words) + getVectorMemoryUsage(summary); }
+
+	unsigned count() const
+	{
+		unsigned ret = 0;
+		forEachBlock(summary.size(), [this](unsigned i) { return summary[i]; }, [&](unsigned b) {
+			ret += countBlock(getBlock(b));
+			return true;
+		});
+		return ret;
+	}
+	bool empty() const
+	{
+		return std::all_of(summary.begin(), summary.end(), [](Word w) { return w == 0; });
+	}
+
+	// The two vectors may have different lengths
+	bool operator==(const AndersBlockBitVector& other) const
+	{
+		const std::vector<Word>& shorter = summary.size() < other.summary.size() ? summary : other.summary;
+		const std::vector<Word>& longer = summary.size() < other.summary.size() ? other.summary : summary;
+		if (!std::equal(shorter.begin(), shorter.end(), longer.begin()))
+			return false;
+		if (!std::all_of(longer.begin() + shorter.size(), longer.end(), [](Word w) { return w == 0; }))
+			return false;
+		return forEachBlock(shorter.size(), [&shorter](unsigned i) { return shorter[i]; }, [&](unsigned b) {
+			return std::memcmp(getBlock(b), other.getBlock(b), WordsPerBlock * sizeof(Word)) == 0;
+		});
+	}
+};
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef ANDERSEN_COMPACT_PTSGRAPH_H
+#define ANDERSEN_COMPACT_PTSGRAPH_H
+
+#include "NodeFactory.h"
+#include "PtsGraph.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+// A read-only points-to set: a sorted range of node indices inside a CompactPtsGraph
+class CompactPtsSet
+{
+private:
+	const NodeIndex* first;
+	const NodeIndex* last;
+public:
+	typedef const NodeIndex* iterator;
+
+	CompactPtsSet(const NodeIndex* f, const NodeIndex* l): first(f), last(l) {}
+
+	bool has(NodeIndex idx) const
+	{
+		return std::binary_search(first, last, idx);
+	}
+
+	// Return true if *this and other share an element. Both ranges are sorted, so this is a merge that allocates nothing
+	bool intersectWith(const CompactPtsSet& other) const
+	{
+		const NodeIndex* i = first;
+		const NodeIndex* j = other.first;
+		while (i != last && j != other.last)
+		{
+			if (*i < *j)
+				++i;
+			else if (*j < *i)
+				++j;
+			else
+				return true;
+		}
+		return false;
+	}
+
+	// The elements greater than idx
+	CompactPtsSet getElementsAfter(NodeIndex idx) const
+	{
+		return CompactPtsSet(std::upper_bound(first, last, idx), last);
+	}
+
+	unsigned getSize() const { return last - first; }
+	bool isEmpty() const { return first == last; }
+
+	iterator begin() const { return first; }
+	iterator end() const { return last; }
+};
+
+// The form the points-to graph takes once solving is over (see Andersen::compactResults())
+// The solver's AndersPtsGraph keeps a set object for every node, including the many nodes that have been merged away, and each set is a linked structure made to be updated. Here only the distinct sets are kept, numbered densely, and stored one after another in a single array, each one sorted. A merged node simply shares the slot of its representative, so find() doesn't need the merge target, and representatives whose sets are equal share a slot as well
+// The layout is CSR: the set with id s is elems[offsets[s]..offsets[s + 1]), so a node costs one unsigned and a distinct set one more, on top of its elements. The CompactPtsSets are made on the fly by find() and getSet()
+// The slot number is the id of the set: two nodes have equal points-to sets if and only if they have the same set id
+class CompactPtsGraph
+{
+public:
+	enum: unsigned { NoSlot = ~0u };
+private:
+	// The slot of the set of each node, or NoSlot if the node doesn't have a set
+	std::vector<unsigned> slots;
+	// Where the elements of each set start in elems, plus the end of the last set
+	std::vector<unsigned> offsets;
+	// The elements of all the sets
+	std::vector<NodeIndex> elems;
+public:
+	CompactPtsGraph() {}
+	// The sets handed out point into elems
+	CompactPtsGraph(const CompactPtsGraph&) = delete;
+	CompactPtsGraph& operator=(const CompactPtsGraph&) = delete;
+
+	// Copy the sets of the representatives in graph. The merge targets in nodeFactory must be final
+	void build(const AndersPtsGraph& graph, AndersNodeFactory& nodeFactory)
+	{
+		clear();
+
+		// Map from the hash of a set to the slots of the sets with that hash
+		llvm::DenseMap<unsigned, llvm::SmallVector<unsigned, 1>> slotsByHash;
+		slots.assign(nodeFactory.getNumNodes(), NoSlot);
+		for (auto n: graph)
+		{
+			// A node that has been merged away may still hold a stale set
+			if (nodeFactory.getMergeTarget(n) != n)
+				continue;
+
+			unsigned offset = elems.size();
+			const AndersPtsSet& ptsSet = *graph.find(n);
+			// The queries expect the null object among the other elements
+			if (ptsSet.hasNullObject())
+				elems.push_back(nodeFactory.getNullObjectNode());
+			for (auto obj: ptsSet)
+				elems.push_back(obj);
+			std::sort(elems.begin() + offset, elems.end());
+
+			// Share the slot of an equal set if there is one
+			unsigned hash = llvm::hash_combine_range(elems.begin() + offset, elems.end());
+			auto& candidates = slotsByHash[hash];
+			for (auto slot: candidates)
+			{
+				unsigned slotOffset = offsets[slot], slotEnd = (slot + 1 < offsets.size()) ? offsets[slot + 1] : offset;
+				if (slotEnd - slotOffset == elems.size() - offset && std::equal(elems.begin() + offset, elems.end(), elems.begin() + slotOffset))
+				{
+					slots[n] = slot;
+					break;
+				}
+			}
+			if (slots[n] != NoSlot)
+			{
+				elems.resize(offset);
+				continue;
+			}
+
+			slots[n] = offsets.size();
+			candidates.push_back(offsets.size());
+			offsets.push_back(offset);
+		}
+		offsets.push_back(elems.size());
+		offsets.shrink_to_fit();
+		elems.shrink_to_fit();
+
+		for (unsigned i = 0, e = slots.size(); i < e; ++i)
+			slots[i] = slots[nodeFactory.getMergeTarget(i)];
+	}
+
+	// Set set to the points-to set of idx. Return false if idx does not have one
+	bool find(NodeIndex idx, CompactPtsSet& set) const
+	{
+		if (idx >= slots.size() || slots[idx] == NoSlot)
+			return false;
+		set = getSet(slots[idx]);
+		return true;
+	}
+
+	// Return the id of the set of idx, or NoSlot if idx does not have a points-to set
+	unsigned getSetId(NodeIndex idx) const
+	{
+		if (idx >= slots.size())
+			return NoSlot;
+		return slots[idx];
+	}
+	// Give n, a node created after the graph was built, the set of other
+	void shareSet(NodeIndex n, NodeIndex other)
+	{
+		unsigned id = getSetId(other);
+		if (n >= slots.size())
+			slots.resize(n + 1, NoSlot);
+		slots[n] = id;
+	}
+	CompactPtsSet getSet(unsigned id) const
+	{
+		assert(id < getNumSets());
+		return CompactPtsSet(elems.data() + offsets[id], elems.data() + offsets[id + 1]);
+	}
+
+	void clear()
+	{
+		std::vector<unsigned>().swap(slots);
+		std::vector<unsigned>().swap(offsets);
+		std::vector<NodeIndex>().swap(elems);
+	}
+
+	// Number of distinct points-to sets
+	unsigned getNumSets() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+
+	std::size_t getMemoryUsage() const { return getVectorMemoryUsage(slots) + getVectorMemoryUsage(offsets) + getVectorMemoryUsage(elems); }
+};
+
+#endif
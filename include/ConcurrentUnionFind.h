@@ -0,0 +1,84 @@
+#ifndef ANDERSEN_CONCURRENT_UNION_FIND_H
+#define ANDERSEN_CONCURRENT_UNION_FIND_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// A union-find forest that several threads can find and unite in at the same time, without locks. The algorithm is the one of Anderson and Woll ("Wait-free Parallel Algorithms for the Union-Find Problem", STOC 1991), with the index of a root standing in for its rank
+// A root is only ever linked under a root with a smaller index, and path halving only replaces a parent with one of its ancestors, so no interleaving can close a cycle. find() is wait-free: each of its steps moves to an ancestor in an acyclic forest, so it takes fewer steps than there are elements. unite() is lock-free: its compare-and-swap only fails when another thread has linked one of the roots
+// When two sets are united, the root with the smaller index becomes the representative. The representative of a set is thus the smallest root the set started with, however the unions are interleaved
+class ConcurrentUnionFind
+{
+private:
+	std::unique_ptr<std::atomic<unsigned>[]> parents;
+	unsigned size;
+public:
+	ConcurrentUnionFind(): size(0) {}
+
+	// Start from the forest given by parentOf, which must be acyclic (apart from the roots, which are their own parents)
+	void reset(const std::vector<unsigned>& parentOf)
+	{
+		size = parentOf.size();
+		parents.reset(new std::atomic<unsigned>[size]);
+		for (unsigned i = 0; i < size; ++i)
+			parents[i].store(parentOf[i], std::memory_order_relaxed);
+	}
+
+	// Write the forest back into parentOf. Must not run concurrently with unite()
+	void exportTo(std::vector<unsigned>& parentOf) const
+	{
+		parentOf.resize(size);
+		for (unsigned i = 0; i < size; ++i)
+			parentOf[i] = parents[i].load(std::memory_order_relaxed);
+	}
+
+	void clear()
+	{
+		parents.reset();
+		size = 0;
+	}
+
+	unsigned getSize() const { return size; }
+	std::size_t getMemoryUsage() const { return parents ? size * sizeof(std::atomic<unsigned>) : 0; }
+
+	unsigned find(unsigned n)
+	{
+		assert(n < size);
+		while (true)
+		{
+			unsigned parent = parents[n].load(std::memory_order_acquire);
+			if (parent == n)
+				return n;
+			unsigned grandParent = parents[parent].load(std::memory_order_acquire);
+			// Path halving. If another thread has changed the parent in the meantime, its value is at least as good as ours, so a failed exchange is simply ignored
+			if (grandParent != parent)
+				parents[n].compare_exchange_weak(parent, grandParent, std::memory_order_release, std::memory_order_relaxed);
+			n = grandParent;
+		}
+	}
+
+	// Unite the sets of n0 and n1 and return the representative of the result
+	unsigned unite(unsigned n0, unsigned n1)
+	{
+		while (true)
+		{
+			n0 = find(n0);
+			n1 = find(n1);
+			if (n0 == n1)
+				return n0;
+			if (n0 > n1)
+				std::swap(n0, n1);
+
+			// n1 may have stopped being a root since find() returned. Then the exchange fails and we start over from the new roots
+			unsigned expected = n1;
+			if (parents[n1].compare_exchange_strong(expected, n0, std::memory_order_acq_rel, std::memory_order_acquire))
+				return n0;
+		}
+	}
+};
+
+#endif
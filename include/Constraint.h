@@ -4,6 +4,8 @@
 #include "NodeFactory.h"
 
 #include <cassert>
+#include <cstdint>
+#include <vector>
 
 /// AndersConstraint - Objects of this structure are used to represent the various constraints identified by the algorithm.  The constraints are 'copy', for statements like "A = B", 'load' for statements like "A = *B", 'store' for statements like "*A = B", and AddressOf for statements like A = alloca;  The Offset is applied as *(A + K) = B for stores, A = *(B + K) for loads, and A = B + K for copies.  It is illegal on addressof constraints (because it is statically resolvable to A = &C where C = B + K)
 class AndersConstraint {
@@ -16,19 +18,30 @@ public:
 		STORE,
 	};
 private:
-	ConstraintType type;
-	NodeIndex dest;
-	NodeIndex src;
+	// A constraint is packed into a single 64-bit word: the type in the top 2 bits, then 31 bits for the dest and 31 bits for the src. Comparing two words compares (type, dest, src) lexicographically, so sorting the words sorts the constraints
+	enum: unsigned { IndexBits = 31, TypeShift = 2 * IndexBits };
+	static const std::uint64_t IndexMask = (std::uint64_t(1) << IndexBits) - 1;
+
+	std::uint64_t bits;
+
+	explicit AndersConstraint(std::uint64_t b): bits(b) {}
 public:
-	AndersConstraint(ConstraintType Ty, NodeIndex D, NodeIndex S): type(Ty), dest(D), src(S) {}
+	AndersConstraint(ConstraintType Ty, NodeIndex D, NodeIndex S): bits((std::uint64_t(Ty) << TypeShift) | (std::uint64_t(D) << IndexBits) | S)
+	{
+		assert(D <= IndexMask && S <= IndexMask && "Node index too large to be put into a constraint!");
+	}
+
+	ConstraintType getType() const { return static_cast<ConstraintType>(bits >> TypeShift); }
+	NodeIndex getDest() const { return (bits >> IndexBits) & IndexMask; }
+	NodeIndex getSrc() const { return bits & IndexMask; }
 
-	ConstraintType getType() const { return type; }
-	NodeIndex getDest() const { return dest; }
-	NodeIndex getSrc() const { return src; }
+	// The packed encoding of the constraint, and the constraint a packed encoding stands for
+	std::uint64_t getPackedKey() const { return bits; }
+	static AndersConstraint fromPackedKey(std::uint64_t key) { return AndersConstraint(key); }
 
 	bool operator==(const AndersConstraint &RHS) const
 	{
-		return RHS.type == type && RHS.dest == dest && RHS.src == src;
+		return RHS.bits == bits;
 	}
 
 	bool operator!=(const AndersConstraint &RHS) const
@@ -38,12 +51,22 @@ public:
 
 	bool operator<(const AndersConstraint &RHS) const
 	{
-		if (RHS.type != type)
-			return RHS.type < type;
-		else if (RHS.dest != dest)
-			return RHS.dest < dest;
-		return RHS.src < src;
+		return bits < RHS.bits;
 	}
 };
 
+// AndersFieldConstraint - "A = B + K" for a positive field offset K: A points to the field K fields after each object B points to (see -anders-field-sensitive). An offset of AnyField stands for one that is not known statically, and makes A point to every field of the objects of B. An AndersConstraint has no bits left for the offset, so these are kept apart from the others, and only the worklist solver handles them
+struct AndersFieldConstraint
+{
+	static const unsigned AnyField = ~0u;
+
+	NodeIndex dest, src;
+	unsigned offset;
+
+	AndersFieldConstraint(NodeIndex d, NodeIndex s, unsigned o): dest(d), src(s), offset(o) {}
+};
+
+// Sort the constraints and remove the duplicates. This is a radix sort on the packed encodings, working in place on the vector plus one scratch buffer of the same size, rather than a std::set with a heap node per constraint
+void uniquifyConstraints(std::vector<AndersConstraint>& constraints);
+
 #endif
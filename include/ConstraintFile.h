@@ -0,0 +1,73 @@
+#ifndef ANDERSEN_CONSTRAINT_FILE_H
+#define ANDERSEN_CONSTRAINT_FILE_H
+
+#include "Constraint.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A binary file holding the output of constraint collection: the number of nodes, which of them are objects, and the constraints in their packed encoding (see AndersConstraint::getPackedKey()). Solving it again needs neither the IR nor the collection (see Andersen::createFromConstraints())
+// The layout is a header, the sorted indices of the object nodes padded to a multiple of 8 bytes, then one 64-bit word per constraint up to the end of the file. The number of constraints is not in the header, so the writer can stream them out without knowing it in advance
+namespace ConstraintFileFormat
+{
+	enum: std::uint32_t { Magic = 0x534e4341 /* "ACNS" */, Version = 1 };
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t numNodes;
+		std::uint32_t numObjectNodes;
+	};
+}
+
+class ConstraintFileWriter
+{
+private:
+	llvm::raw_ostream& os;
+public:
+	// Write the header and the object nodes, which must be sorted
+	ConstraintFileWriter(llvm::raw_ostream& o, unsigned numNodes, llvm::ArrayRef<NodeIndex> objectNodes);
+
+	void write(const AndersConstraint& c)
+	{
+		std::uint64_t key = c.getPackedKey();
+		os.write(reinterpret_cast<const char*>(&key), sizeof(key));
+	}
+};
+
+// The reader maps the file and decodes one constraint at a time, so the constraints are never copied as a whole before they are used
+class ConstraintFileReader
+{
+private:
+	std::unique_ptr<llvm::MemoryBuffer> buffer;
+	const ConstraintFileFormat::Header* header;
+	const std::uint32_t* objectNodes;
+	const std::uint64_t* keys;
+	size_t numConstraints;
+
+	ConstraintFileReader() = default;
+public:
+	// Return nullptr and put the reason into error if the file is not a valid constraint file
+	static std::unique_ptr<ConstraintFileReader> open(llvm::StringRef fileName, std::string& error);
+	static std::unique_ptr<ConstraintFileReader> open(std::unique_ptr<llvm::MemoryBuffer> buffer, std::string& error);
+
+	unsigned getNumNodes() const { return header->numNodes; }
+	llvm::ArrayRef<std::uint32_t> getObjectNodes() const { return llvm::ArrayRef<std::uint32_t>(objectNodes, header->numObjectNodes); }
+
+	size_t getNumConstraints() const { return numConstraints; }
+	AndersConstraint getConstraint(size_t i) const
+	{
+		assert(i < numConstraints);
+		return AndersConstraint::fromPackedKey(keys[i]);
+	}
+};
+
+#endif
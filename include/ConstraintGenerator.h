@@ -0,0 +1,75 @@
+#ifndef ANDERSEN_CONSTRAINT_GENERATOR_H
+#define ANDERSEN_CONSTRAINT_GENERATOR_H
+
+#include "Constraint.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+class ConstraintFileReader;
+
+// The shape of a synthetic constraint set. The counts are of the nodes and constraints drawn at random; the special nodes of AndersNodeFactory come on top of numNodes, and the hubs and the indirect calls add their constraints on top of numConstraints
+struct SyntheticConstraintShape
+{
+	unsigned numNodes = 10000;
+	// The share of the nodes that are objects. The others are value nodes
+	double objectRatio = 0.2;
+	unsigned numConstraints = 10000;
+	// The relative weights of the four kinds of constraints in the mix
+	double addrOfWeight = 15, copyWeight = 45, loadWeight = 20, storeWeight = 20;
+	// The two nodes of a constraint are at most locality apart in the order of their kind (for an address-of constraint, the object is near the position of the value among the values), as the constraints of a function mostly refer to its own nodes. Without locality, a few loads and stores per node are enough to make every pointer point to nearly every object
+	unsigned locality = 64;
+	// The share of the copy constraints that go against the order of the value nodes. The others go with it, so without them the copy edges form a DAG; each of them can close a cycle, which the locality keeps short
+	double cycleDensity = 0.05;
+	// numHubs value nodes each get hubDegree copy edges in from and hubDegree copy edges out to random value nodes
+	unsigned numHubs = 0;
+	unsigned hubDegree = 0;
+	// numIndirectCalls call sites each resolve to callFanOut of numFunctions functions with numCallArgs arguments, the way indirect calls are wired without -enable-otf-callgraph: a copy from each actual argument to the matching parameter and from the return node to the result of the call
+	unsigned numIndirectCalls = 0;
+	unsigned callFanOut = 0;
+	unsigned numFunctions = 0;
+	unsigned numCallArgs = 2;
+	// The same shape and seed always give the same constraints
+	std::uint64_t seed = 1;
+
+	// A shape with the node counts and the mix of the constraints of an existing constraint file, so that a constraint set that blows up can be studied at other sizes without its source. The cycles, hubs and calls are left for the caller to set
+	static SyntheticConstraintShape like(const ConstraintFileReader& reader);
+};
+
+// Generate the constraints of a SyntheticConstraintShape. The nodes are numbered the way AndersNodeFactory numbers them, so the output can be written with ConstraintFileWriter and solved with Andersen::createFromConstraints()
+// The constraints are handed out one at a time, so that a set of 100M constraints can go straight to a file without ever being held in memory. They are neither sorted nor unique
+class SyntheticConstraintGenerator
+{
+private:
+	SyntheticConstraintShape shape;
+	unsigned numNodes;
+	// The nodes the constraints are drawn from, which are all but the special ones
+	std::vector<NodeIndex> valueNodes, objectNodes;
+	// Every object node, the special ones included
+	std::vector<NodeIndex> allObjectNodes;
+	double totalWeight;
+	std::mt19937_64 rng;
+
+	// A random number in [0, n)
+	unsigned draw(unsigned n) { return rng() % n; }
+	double drawProbability() { return (rng() >> 11) * (1.0 / (std::uint64_t(1) << 53)); }
+	NodeIndex drawValue() { return valueNodes[draw(valueNodes.size())]; }
+	// A node of nodes at most locality away from position, a fraction of the way through them
+	NodeIndex drawNear(const std::vector<NodeIndex>& nodes, double position);
+	AndersConstraint drawConstraint();
+public:
+	explicit SyntheticConstraintGenerator(const SyntheticConstraintShape& s);
+
+	// All the nodes, including the special ones, and the sorted object nodes among them, as ConstraintFileWriter wants them
+	unsigned getNumNodes() const { return numNodes; }
+	llvm::ArrayRef<NodeIndex> getObjectNodes() const { return allObjectNodes; }
+
+	void generate(llvm::function_ref<void(const AndersConstraint&)> emit);
+	std::vector<AndersConstraint> generate();
+};
+
+#endif
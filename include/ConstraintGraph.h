@@ -0,0 +1,400 @@
+#ifndef ANDERSEN_CONSTRAINT_GRAPH_H
+#define ANDERSEN_CONSTRAINT_GRAPH_H
+
+#include "GraphTraits.h"
+#include "MemoryUsage.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/iterator_range.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+// This class represent the constraint graph
+class ConstraintGraphNode
+{
+private:
+	NodeIndex idx;
+
+	// Edges are kept in sparse bit vectors rather than std::set: they are far more compact (no per-edge heap node), and iterating them walks a short list of 128-bit elements instead of chasing a tree all over the heap. Like std::set, the targets are visited in increasing order
+	typedef llvm::SparseBitVector<> NodeSet;
+	NodeSet copyEdges, loadEdges, storeEdges;
+	// The number of copy successors, kept up to date as copyEdges changes so that the solver can ask for it on every visit without counting the edges
+	unsigned numCopyEdges;
+	// The copy predecessors, only kept once ConstraintGraph::keepPredecessors() has been called (see -anders-pull-propagation). Like the other edges, they are not rewritten when their sources are merged
+	NodeSet predEdges;
+	// The copy successors that LCD has already found to have the same points-to set as this node, and so has made cycle candidates once. This is always a subset of copyEdges, which bounds its size by the size of the graph
+	NodeSet checkedCopyEdges;
+	// The field edges (see AndersFieldConstraint), each target with its offset. Only the field-sensitive mode has any, and few of them, so a vector does
+	std::vector<std::pair<NodeIndex, unsigned>> fieldEdges;
+	// The merge epoch of the node factory when the copy, load and store edges were last made to point to representatives only, or StaleEpoch if edges have been added since
+	unsigned canonicalEpoch, predCanonicalEpoch;
+	static const unsigned StaleEpoch = ~0u;
+
+	// Replace the targets in edges that have been merged away by their merge targets, and drop them from checked if it is given. The stale targets are gathered in a first pass, which allocates nothing when there are none. Return the number of edges that went away because their targets were merged into a target already there
+	static unsigned canonicalizeEdgeSet(NodeSet& edges, const AndersNodeFactory& nodeFactory, NodeSet* checked)
+	{
+		llvm::SmallVector<NodeIndex, 16> staleTargets;
+		unsigned numFolded = 0;
+		for (auto dst: edges)
+		{
+			if (nodeFactory.getMergeTarget(dst) != dst)
+				staleTargets.push_back(dst);
+		}
+		for (auto dst: staleTargets)
+		{
+			edges.reset(dst);
+			if (!edges.test_and_set(nodeFactory.getMergeTarget(dst)))
+				++numFolded;
+			if (checked != nullptr)
+				checked->reset(dst);
+		}
+		return numFolded;
+	}
+
+	bool insertCopyEdge(NodeIndex dst)
+	{
+		canonicalEpoch = StaleEpoch;
+		if (!copyEdges.test_and_set(dst))
+			return false;
+		++numCopyEdges;
+		return true;
+	}
+	bool insertPredEdge(NodeIndex src)
+	{
+		predCanonicalEpoch = StaleEpoch;
+		return predEdges.test_and_set(src);
+	}
+	bool insertLoadEdge(NodeIndex dst)
+	{
+		canonicalEpoch = StaleEpoch;
+		return loadEdges.test_and_set(dst);
+	}
+	bool insertStoreEdge(NodeIndex dst)
+	{
+		canonicalEpoch = StaleEpoch;
+		return storeEdges.test_and_set(dst);
+	}
+	bool insertFieldEdge(NodeIndex dst, unsigned offset)
+	{
+		auto edge = std::make_pair(dst, offset);
+		if (std::find(fieldEdges.begin(), fieldEdges.end(), edge) != fieldEdges.end())
+			return false;
+		fieldEdges.push_back(edge);
+		return true;
+	}
+	bool isEmpty() const
+	{
+		return copyEdges.empty() && loadEdges.empty() && storeEdges.empty() && fieldEdges.empty();
+	}
+
+	// The merged node has a new points-to set, so its copy edges are worth checking for cycles again. The copy edges are counted once here rather than on every visit
+	void mergeEdges(const ConstraintGraphNode& other)
+	{
+		if (copyEdges |= other.copyEdges)
+			numCopyEdges = copyEdges.count();
+		loadEdges |= other.loadEdges;
+		storeEdges |= other.storeEdges;
+		predEdges |= other.predEdges;
+		for (auto const& edge: other.fieldEdges)
+			insertFieldEdge(edge.first, edge.second);
+		checkedCopyEdges.clear();
+		canonicalEpoch = predCanonicalEpoch = StaleEpoch;
+	}
+
+	ConstraintGraphNode(NodeIndex i): idx(i), numCopyEdges(0), canonicalEpoch(StaleEpoch), predCanonicalEpoch(StaleEpoch) {}
+
+	void getMemoryUsage(AndersMemoryUsage& usage) const
+	{
+		usage.copyEdges += getSparseBitVectorMemoryUsage(copyEdges) + getSparseBitVectorMemoryUsage(predEdges);
+		usage.complexEdges += getSparseBitVectorMemoryUsage(loadEdges) + getSparseBitVectorMemoryUsage(storeEdges);
+		usage.fieldEdges += getVectorMemoryUsage(fieldEdges);
+		usage.checkedEdges += getSparseBitVectorMemoryUsage(checkedCopyEdges);
+	}
+public:
+	// SparseBitVector only offers read-only iteration
+	typedef NodeSet::iterator iterator;
+	typedef NodeSet::iterator const_iterator;
+
+	NodeIndex getNodeIndex() const { return idx; }
+
+	// Make the copy, load and store edges point to the representatives of their targets. The solvers call this before walking the edges instead of rewriting them as they go. A node whose edges were canonical at the last merge is skipped without looking at them, so only the edges that have seen a merge since are touched
+	// The field edges are left alone (see fields())
+	void canonicalizeEdges(const AndersNodeFactory& nodeFactory)
+	{
+		if (canonicalEpoch == nodeFactory.getMergeEpoch())
+			return;
+		numCopyEdges -= canonicalizeEdgeSet(copyEdges, nodeFactory, &checkedCopyEdges);
+		canonicalizeEdgeSet(loadEdges, nodeFactory, nullptr);
+		canonicalizeEdgeSet(storeEdges, nodeFactory, nullptr);
+		canonicalEpoch = nodeFactory.getMergeEpoch();
+	}
+
+	// Make the predecessor edges point to the representatives of their sources, in the same way. A merge may leave the node among its own predecessors
+	void canonicalizePredEdges(const AndersNodeFactory& nodeFactory)
+	{
+		if (predCanonicalEpoch == nodeFactory.getMergeEpoch())
+			return;
+		canonicalizeEdgeSet(predEdges, nodeFactory, nullptr);
+		predCanonicalEpoch = nodeFactory.getMergeEpoch();
+	}
+
+	// Record that LCD has checked the copy edge to dst. Return false if it had already
+	bool markCopyEdgeChecked(NodeIndex dst)
+	{
+		return checkedCopyEdges.test_and_set(dst);
+	}
+
+	const_iterator begin() const { return copyEdges.begin(); }
+	const_iterator end() const { return copyEdges.end(); }
+	// The number of copy successors. Targets that have been merged into each other since the last canonicalizeEdges() are still counted apart
+	unsigned getNumCopyEdges() const { return numCopyEdges; }
+	// Whether the solver reads the points-to set of the node when it visits it, i.e. whether it has any edge of its own
+	bool hasEdges() const { return !isEmpty(); }
+
+	const_iterator load_begin() const { return loadEdges.begin(); }
+	const_iterator load_end() const { return loadEdges.end(); }
+	llvm::iterator_range<const_iterator> loads() const
+	{
+		return llvm::iterator_range<const_iterator>(load_begin(), load_end());
+	}
+
+	const_iterator store_begin() const { return storeEdges.begin(); }
+	const_iterator store_end() const { return storeEdges.end(); }
+	llvm::iterator_range<const_iterator> stores() const
+	{
+		return llvm::iterator_range<const_iterator>(store_begin(), store_end());
+	}
+
+	llvm::iterator_range<const_iterator> preds() const
+	{
+		return llvm::iterator_range<const_iterator>(predEdges.begin(), predEdges.end());
+	}
+
+	// The targets are not updated when they are merged, so they have to be looked up through their merge targets
+	llvm::ArrayRef<std::pair<NodeIndex, unsigned>> fields() const { return fieldEdges; }
+
+	friend class ConstraintGraph;
+};
+
+class ConstraintGraph
+{
+private:
+	typedef std::map<NodeIndex, ConstraintGraphNode> NodeMapTy;
+	NodeMapTy graph;
+	// Whether the copy edges are recorded at their targets too (see keepPredecessors())
+	bool hasPredEdges;
+public:
+	typedef NodeMapTy::iterator iterator;
+	typedef NodeMapTy::const_iterator const_iterator;
+
+	ConstraintGraph(): hasPredEdges(false) {}
+
+	bool insertCopyEdge(NodeIndex src, NodeIndex dst)
+	{
+		if (!getOrInsertNode(src)->insertCopyEdge(dst))
+			return false;
+		if (hasPredEdges)
+			getOrInsertNode(dst)->insertPredEdge(src);
+		return true;
+	}
+
+	// Insert the copy edge at src alone, leaving the predecessor edge to insertPredEdge(). This is for the parallel solver, whose threads may only write the nodes they own, and src must be in the graph already
+	bool insertSuccEdge(NodeIndex src, NodeIndex dst)
+	{
+		return getNodeWithIndex(src)->insertCopyEdge(dst);
+	}
+	// dst must be in the graph already
+	bool insertPredEdge(NodeIndex dst, NodeIndex src)
+	{
+		return getNodeWithIndex(dst)->insertPredEdge(src);
+	}
+
+	// From now on, record every copy edge at its target as well, starting with those in the graph, so that a node can find the nodes it gets its points-to set from. The targets of the edges get a node of their own if they have none
+	void keepPredecessors(const AndersNodeFactory& nodeFactory)
+	{
+		if (hasPredEdges)
+			return;
+		hasPredEdges = true;
+		std::vector<std::pair<NodeIndex, NodeIndex>> edges;
+		for (auto const& mapping: graph)
+			for (auto dst: mapping.second)
+				edges.push_back(std::make_pair(nodeFactory.getMergeTarget(dst), mapping.first));
+		for (auto const& edge: edges)
+			getOrInsertNode(edge.first)->insertPredEdge(edge.second);
+	}
+	// Stop recording the predecessors and free them
+	void dropPredecessors()
+	{
+		if (!hasPredEdges)
+			return;
+		hasPredEdges = false;
+		for (auto& mapping: graph)
+			mapping.second.predEdges.clear();
+	}
+	bool keepsPredecessors() const { return hasPredEdges; }
+
+	bool insertLoadEdge(NodeIndex src, NodeIndex dst)
+	{
+		auto itr = graph.find(src);
+		if (itr == graph.end())
+		{
+			ConstraintGraphNode srcNode(src);
+			srcNode.insertLoadEdge(dst);
+			graph.insert(std::make_pair(src, std::move(srcNode)));
+			return true;
+		}
+		else
+			return (itr->second).insertLoadEdge(dst);
+	}
+
+	bool insertStoreEdge(NodeIndex src, NodeIndex dst)
+	{
+		auto itr = graph.find(src);
+		if (itr == graph.end())
+		{
+			ConstraintGraphNode srcNode(src);
+			srcNode.insertStoreEdge(dst);
+			graph.insert(std::make_pair(src, std::move(srcNode)));
+			return true;
+		}
+		else
+			return (itr->second).insertStoreEdge(dst);
+	}
+
+	// Insert the copy edges in edges, (src, dst) pairs sorted by source, looking each source up once. Append the edges that are new to newEdges
+	void insertCopyEdges(llvm::ArrayRef<std::pair<NodeIndex, NodeIndex>> edges, std::vector<std::pair<NodeIndex, NodeIndex>>& newEdges)
+	{
+		ConstraintGraphNode* srcNode = nullptr;
+		for (auto const& edge: edges)
+		{
+			if (srcNode == nullptr || srcNode->getNodeIndex() != edge.first)
+				srcNode = getOrInsertNode(edge.first);
+			if (srcNode->insertCopyEdge(edge.second))
+			{
+				newEdges.push_back(edge);
+				if (hasPredEdges)
+					getOrInsertNode(edge.second)->insertPredEdge(edge.first);
+			}
+		}
+	}
+
+	bool insertFieldEdge(NodeIndex src, NodeIndex dst, unsigned offset)
+	{
+		return getOrInsertNode(src)->insertFieldEdge(dst, offset);
+	}
+
+	void mergeNodes(NodeIndex dst, NodeIndex src)
+	{
+		auto itr = graph.find(src);
+		if (itr == graph.end())
+			return;
+
+		const ConstraintGraphNode& srcNode = itr->second;
+		itr = graph.find(dst);
+		if (itr == graph.end())
+		{
+			ConstraintGraphNode dstNode(dst);
+			dstNode.mergeEdges(srcNode);
+			graph.insert(std::make_pair(dst, std::move(dstNode)));
+		}
+		else
+			(itr->second).mergeEdges(srcNode);
+	}
+
+	// Merge all of srcs into dst and delete them. dst is looked up once, however many nodes there are
+	void mergeNodes(NodeIndex dst, llvm::ArrayRef<NodeIndex> srcs)
+	{
+		ConstraintGraphNode* dstNode = nullptr;
+		for (auto src: srcs)
+		{
+			auto itr = graph.find(src);
+			if (itr == graph.end())
+				continue;
+			if (dstNode == nullptr)
+				dstNode = getOrInsertNode(dst);
+			dstNode->mergeEdges(itr->second);
+			graph.erase(itr);
+		}
+	}
+
+	void deleteNode(NodeIndex idx)
+	{
+		graph.erase(idx);
+	}
+
+	ConstraintGraphNode* getNodeWithIndex(NodeIndex idx)
+	{
+		auto itr = graph.find(idx);
+		if (itr == graph.end())
+			return nullptr;
+		else
+			return &(itr->second);
+	}
+	const ConstraintGraphNode* getNodeWithIndex(NodeIndex idx) const
+	{
+		auto itr = graph.find(idx);
+		if (itr == graph.end())
+			return nullptr;
+		else
+			return &(itr->second);
+	}
+
+	ConstraintGraphNode* getOrInsertNode(NodeIndex idx)
+	{
+		auto itr = graph.find(idx);
+		if (itr == graph.end())
+		{
+			ConstraintGraphNode newNode(idx);
+			itr = graph.insert(std::make_pair(idx, newNode)).first;
+		}
+		return &(itr->second);
+	}
+
+	// Add the memory of the graph to usage, by kind of edge. A node of the map is a tree node, with three links and a color besides the node
+	void getMemoryUsage(AndersMemoryUsage& usage) const
+	{
+		usage.graphNodes += graph.size() * (sizeof(NodeMapTy::value_type) + 4 * sizeof(void*));
+		for (auto const& mapping: graph)
+			mapping.second.getMemoryUsage(usage);
+	}
+
+	iterator begin() { return graph.begin(); }
+	iterator end() { return graph.end(); }
+	const_iterator begin() const { return graph.begin(); }
+	const_iterator end() const { return graph.end(); }
+};
+
+// Specialize the AnderGraphTraits for ConstraintGraph
+template <> class AndersGraphTraits<ConstraintGraph>
+{
+public:
+	typedef ConstraintGraphNode NodeType;
+	typedef MapValueIterator<ConstraintGraph::const_iterator> NodeIterator;
+	typedef ConstraintGraphNode::iterator ChildIterator;
+
+	static inline ChildIterator child_begin(const NodeType* n)
+	{
+		return n->begin();
+	}
+	static inline ChildIterator child_end(const NodeType* n)
+	{
+		return n->end();
+	}
+
+	static inline NodeIterator node_begin(const ConstraintGraph* g)
+	{
+		return NodeIterator(g->begin());
+	}
+	static inline NodeIterator node_end(const ConstraintGraph* g)
+	{
+		return NodeIterator(g->end());
+	}
+};
+
+#endif
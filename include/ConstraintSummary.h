@@ -0,0 +1,86 @@
+#ifndef ANDERSEN_CONSTRAINT_SUMMARY_H
+#define ANDERSEN_CONSTRAINT_SUMMARY_H
+
+#include "Constraint.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The constraints of one module of a program, with what depends on the other modules left symbolic, so that the modules can be summarized separately (and in parallel) and the summaries linked by symbol name into the analysis of the whole program (see Andersen::summarize() and Andersen::createFromSummaries()). A summary only depends on its module, so a build can cache it by the content of the module
+// What the linker resolves:
+// - The globals and the functions that are not local to the module are listed as symbols. The nodes of all the symbols of one name become the nodes of its definition
+// - A global variable the module only declares points to the universal object, unless another module defines it
+// - A call to a function the module only declares is wired to the definition in another module. The constraints the collection would add for the call to a library function are kept aside, and only used if no module defines the function
+// - An indirect call may reach the address-taken functions of any module, so the linker wires it to all of them
+// The file is a header, the packed constraints (see AndersConstraint::getPackedKey()) and the constraints kept aside, then 32-bit words for the object nodes, the value positions, the symbols and the calls, and the names last
+struct ConstraintSummary
+{
+	enum: std::uint32_t { Magic = 0x4d555341 /* "ASUM" */, Version = 1 };
+	// No value
+	enum: std::uint32_t { NoEntry = ~0u };
+
+	struct Symbol
+	{
+		std::string name;
+		bool isFunction;
+		bool isDefinition;
+		// A local symbol is never merged with another one. Only the address-taken local functions are listed, since an indirect call in another module may still reach them
+		bool isLocal;
+		bool isVarArg;
+		// The nodes of the symbol, or InvalidIndex. A function only has a value node and an object node if the module takes its address, and only a definition has a return node, a vararg node and parameters
+		NodeIndex valueNode;
+		NodeIndex objectNode;
+		NodeIndex returnNode;
+		NodeIndex varargNode;
+		// The node of each parameter, InvalidIndex for the ones that are not pointers and for all the parameters of a declaration
+		std::vector<NodeIndex> params;
+		// The library model of a declared function (see Andersen::classifyExternalLibrary())
+		std::uint32_t extKind;
+		// The position of the symbol in valueNodeOf
+		std::uint32_t position;
+	};
+	// A call to a declared function
+	struct ExternalCall
+	{
+		std::string callee;
+		// The value of the call, or InvalidIndex if it's not a pointer
+		NodeIndex result;
+		// The node of each argument, InvalidIndex for the ones that are not pointers
+		std::vector<NodeIndex> args;
+		// The range of fallbackConstraints to use if no module defines the callee
+		std::uint32_t fallbackBegin;
+		std::uint32_t fallbackEnd;
+	};
+	struct IndirectCall
+	{
+		NodeIndex result;
+		std::vector<NodeIndex> args;
+	};
+
+	unsigned numNodes = 0;
+	// Sorted
+	std::vector<NodeIndex> objectNodes;
+	std::vector<AndersConstraint> constraints;
+	std::vector<AndersConstraint> fallbackConstraints;
+	std::vector<Symbol> symbols;
+	std::vector<ExternalCall> externalCalls;
+	std::vector<IndirectCall> indirectCalls;
+	// The values of the module, by their position in the walk of PersistedResultsFormat::enumerateValues(): the value node of each value, and the value each node stands for, with NoEntry for none. With the layout hash of the module, they let the linked analysis write the results of the module (see Andersen::writeModuleResults())
+	std::vector<std::uint32_t> valueNodeOf;
+	std::vector<std::uint32_t> valueOfNode;
+	std::uint64_t moduleHash = 0;
+
+	void write(llvm::raw_ostream& os) const;
+	// Return nullptr and put the reason into error if the file is not a valid summary
+	static std::unique_ptr<ConstraintSummary> read(llvm::StringRef fileName, std::string& error);
+	static std::unique_ptr<ConstraintSummary> read(const llvm::MemoryBuffer& buffer, std::string& error);
+};
+
+#endif
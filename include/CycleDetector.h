@@ -2,16 +2,21 @@
 #define ANDERSEN_CYCLEDETECTOR_H
 
 #include "GraphTraits.h"
+#include "NodeFactory.h"
 
-#include "llvm/ADT/DenseMap.h"
-#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/BitVector.h"
 
-#include <deque>
-#include <stack>
+#include <algorithm>
+#include <cassert>
+#include <vector>
 
-// An abstract base class that offers the functionality of detecting SCC in a graph
-// Any concreate class that does cycle detection should inherit from this class, specifiy the GraphType, and implement all the abstract virtual functions
-template <class GraphType>
+// A base class that offers the functionality of detecting SCC in a graph
+// Any concreate class that does cycle detection should inherit from CycleDetector<itself, GraphType> and implement the following member functions (the base class has to be a friend if they are private). They are bound at compile time, so there is no virtual call per edge:
+// - NodeType* getRep(NodeIndex node): nodes may get merged during the analysis. This function returns the merge target (if the node is merged into another node) or the node itself (if the nodes has not been merged into another node)
+// - void processNodeOnCycle(const NodeType* node, const NodeType* repNode): specify how to process the non-rep nodes if a cycle is found
+// - void processCycleRepNode(const NodeType* node): specify how to process the rep nodes if a cycle is found
+// The DFS is iterative, so long chains of nodes cannot overflow the call stack. All the per-node state is kept in vectors indexed by NodeIndex (one word and one bit per node) rather than in hash tables keyed by node pointers
+template <class Derived, class GraphType>
 class CycleDetector
 {
 public:
@@ -20,75 +25,147 @@ public:
 	typedef typename GraphTraits::NodeIterator node_iterator;
 	typedef typename GraphTraits::ChildIterator child_iterator;
 private:
+	enum: unsigned { Unvisited = ~0u };
+
+	// A node whose successors are being visited
+	struct DFSFrame
+	{
+		NodeType* node;
+		child_iterator itr, ite;
+		unsigned myTimeStamp;
+		// The successor we have descended into, if any. We only keep its index: if it gets collapsed into another node, the node object may be gone when we come back
+		NodeIndex pendingSucc;
+
+		DFSFrame(NodeType* n, unsigned t): node(n), itr(GraphTraits::child_begin(n)), ite(GraphTraits::child_end(n)), myTimeStamp(t), pendingSucc(AndersNodeFactory::InvalidIndex) {}
+	};
+
+	// The explicit DFS stack
+	std::vector<DFSFrame> dfsStack;
 	// The SCC stack
-	std::stack<const NodeType*> sccStack;
-	// Map from NodeIndex to DFS number. Nodes that are not in the map are never visited
-	llvm::DenseMap<const NodeType*, unsigned> dfsNum;
+	std::vector<const NodeType*> sccStack;
+	// Map from NodeIndex to DFS number. Unvisited nodes have number Unvisited
+	std::vector<unsigned> dfsNum;
 	// The "inComponent" array in Nutilla's improved SCC algorithm
-	llvm::DenseSet<const NodeType*> inComponent;
+	llvm::BitVector inComponent;
+	// The nodes that have a DFS number, so that we can reset the state without touching the whole arrays
+	std::vector<NodeIndex> visitedNodes;
 	// DFS timestamp
 	unsigned timestamp;
 
-	// visiting each node and perform some task
-	void visit(NodeType* node)
+	Derived& derived() { return *static_cast<Derived*>(this); }
+
+	bool isVisited(NodeIndex idx) const
 	{
-		unsigned myTimeStamp = timestamp++;
-		assert(!dfsNum.count(node) && "Revisit the same node again?");
-		dfsNum[node] = myTimeStamp;
+		return idx < dfsNum.size() && dfsNum[idx] != Unvisited;
+	}
 
-		// Traverse succecessor edges
-		for (auto childItr = GraphTraits::child_begin(node), childIte = GraphTraits::child_end(node); childItr != childIte; ++childItr)
+	void enterNode(NodeType* node)
+	{
+		NodeIndex idx = node->getNodeIndex();
+		if (idx >= dfsNum.size())
 		{
-			NodeType* succRep = getRep(*childItr);
-			if (!dfsNum.count(succRep))
-				visit(succRep);
-
-			if (!inComponent.count(succRep) && dfsNum[node] > dfsNum[succRep])
-				dfsNum[node] = dfsNum[succRep];
+			unsigned newSize = std::max<unsigned>(idx + 1, 2 * dfsNum.size());
+			dfsNum.resize(newSize, Unvisited);
+			inComponent.resize(newSize);
 		}
+		assert(dfsNum[idx] == Unvisited && "Revisit the same node again?");
+		unsigned myTimeStamp = timestamp++;
+		dfsNum[idx] = myTimeStamp;
+		visitedNodes.push_back(idx);
+		dfsStack.push_back(DFSFrame(node, myTimeStamp));
+	}
+
+	void updateLowLink(NodeIndex idx, NodeIndex succIdx)
+	{
+		if (!inComponent.test(succIdx) && dfsNum[idx] > dfsNum[succIdx])
+			dfsNum[idx] = dfsNum[succIdx];
+	}
+
+	// All successors of node have been visited
+	void finishNode(NodeType* node, unsigned myTimeStamp)
+	{
+		NodeIndex idx = node->getNodeIndex();
 
 		// See if we have any cycle detected
-		if (myTimeStamp != dfsNum[node])
+		if (myTimeStamp != dfsNum[idx])
 		{
 			// If not, push the sccStack and go on
-			sccStack.push(node);
+			sccStack.push_back(node);
 			return;
 		}
 
 		// Cycle detected
-		inComponent.insert(node);
+		inComponent.set(idx);
 		while (!sccStack.empty())
 		{
-			const NodeType* cycleNode = sccStack.top();
-			if (dfsNum[cycleNode] < myTimeStamp)
+			const NodeType* cycleNode = sccStack.back();
+			NodeIndex cycleIdx = cycleNode->getNodeIndex();
+			if (dfsNum[cycleIdx] < myTimeStamp)
 				break;
 
-			processNodeOnCycle(cycleNode, node);
-			inComponent.insert(cycleNode);
-			sccStack.pop();
+			derived().processNodeOnCycle(cycleNode, node);
+			inComponent.set(cycleIdx);
+			sccStack.pop_back();
 		}
 
-		processCycleRepNode(node);
+		derived().processCycleRepNode(node);
 	}
-protected:
-	// Nodes may get merged during the analysis. This function returns the merge target (if the node is merged into another node) or the node itself (if the nodes has not been merged into another node)
-	virtual NodeType* getRep(NodeIndex node) = 0;
-	// Specify how to process the non-rep nodes if a cycle is found
-	virtual void processNodeOnCycle(const NodeType* node, const NodeType* repNode) = 0;
-	// Specify how to process the rep nodes if a cycle is found
-	virtual void processCycleRepNode(const NodeType* node) = 0;
 
+	// visiting each node and perform some task
+	void visit(NodeType* root)
+	{
+		enterNode(root);
+		while (!dfsStack.empty())
+		{
+			DFSFrame& frame = dfsStack.back();
+			NodeIndex idx = frame.node->getNodeIndex();
+
+			// Coming back from a successor
+			if (frame.pendingSucc != AndersNodeFactory::InvalidIndex)
+			{
+				updateLowLink(idx, frame.pendingSucc);
+				frame.pendingSucc = AndersNodeFactory::InvalidIndex;
+			}
+
+			// Traverse succecessor edges
+			if (frame.itr != frame.ite)
+			{
+				NodeType* succRep = derived().getRep(*frame.itr);
+				++frame.itr;
+				NodeIndex succIdx = succRep->getNodeIndex();
+				if (!isVisited(succIdx))
+				{
+					frame.pendingSucc = succIdx;
+					// This invalidates frame
+					enterNode(succRep);
+				}
+				else
+					updateLowLink(idx, succIdx);
+				continue;
+			}
+
+			NodeType* node = frame.node;
+			unsigned myTimeStamp = frame.myTimeStamp;
+			dfsStack.pop_back();
+			finishNode(node, myTimeStamp);
+		}
+	}
+protected:
 	// Running the cycle detection algorithm on a given graph G
 	void runOnGraph(GraphType* graph)
 	{
 		assert(sccStack.empty() && "sccStack is not empty before cycle detection!");
-		assert(dfsNum.empty() && "dfsNum is not empty before cycle detection!");
-		assert(inComponent.empty() && "inComponent is not empty before cycle detection!");
+		assert(visitedNodes.empty() && "dfsNum is not empty before cycle detection!");
 
+		// getRep() may insert nodes into the graph, so don't keep iterating over it while we search
+		std::vector<NodeIndex> roots;
 		for (auto itr = GraphTraits::node_begin(graph), ite = GraphTraits::node_end(graph); itr != ite; ++itr)
+			roots.push_back(itr->getNodeIndex());
+
+		for (auto node: roots)
 		{
-			NodeType* repNode = getRep(itr->getNodeIndex());
-			if (!dfsNum.count(repNode))
+			NodeType* repNode = derived().getRep(node);
+			if (!isVisited(repNode->getNodeIndex()))
 				visit(repNode);
 		}
 
@@ -100,23 +177,38 @@ protected:
 	{
 		assert(sccStack.empty() && "sccStack is not empty before cycle detection!");
 
-		NodeType* repNode = getRep(node);
-		if (!dfsNum.count(repNode))
+		NodeType* repNode = derived().getRep(node);
+		if (!isVisited(repNode->getNodeIndex()))
 			visit(repNode);
 
 		assert(sccStack.empty() && "sccStack not empty after cycle detection!");
 	}
 
+	// The number of nodes the searches since the last resetSCCState() have visited, i.e. the work they have done
+	unsigned getNumVisitedNodes() const { return visitedNodes.size(); }
+
+	// Forget everything about the last search, but keep the arrays around for the next one. This costs time proportional to the number of nodes visited, not to the size of the graph
+	void resetSCCState()
+	{
+		for (auto idx: visitedNodes)
+		{
+			dfsNum[idx] = Unvisited;
+			inComponent.reset(idx);
+		}
+		visitedNodes.clear();
+		timestamp = 0;
+	}
+
 	void releaseSCCMemory()
 	{
-		dfsNum.clear();
+		std::vector<unsigned>().swap(dfsNum);
 		inComponent.clear();
+		std::vector<NodeIndex>().swap(visitedNodes);
+		std::vector<DFSFrame>().swap(dfsStack);
+		timestamp = 0;
 	}
 public:
 	CycleDetector(): timestamp(0) {}
-
-	// The public interface of running the detector
-	virtual void run() = 0;
 };
 
 #endif
@@ -0,0 +1,136 @@
+#ifndef ANDERSEN_DENSESPARSEBITVECTORGRAPH_H
+#define ANDERSEN_DENSESPARSEBITVECTORGRAPH_H
+
+#include "MemoryUsage.h"
+#include "SparseBitVectorGraph.h"
+
+#include "llvm/ADT/BitVector.h"
+
+#include <cassert>
+#include <vector>
+
+// A variant of SparseBitVectorGraph whose nodes are kept in a vector indexed directly by NodeIndex, so that looking up a node never has to hash anything
+// The offline graphs know the range of their node indices up front (every VAR node plus the REF/ADR nodes derived from it), so the whole vector is allocated when the graph is created. The vector never grows afterwards, which gives us the same pointer stability as the map-based graph: we might want to call getOrInsertNode() when another node is being iterated
+class DenseSparseBitVectorGraph
+{
+private:
+	// It must outlive the nodes
+	SparseBitVectorArena arena;
+	std::vector<SparseBitVectorGraphNode> nodes;
+	// Which of the slots in nodes hold a node that is actually in the graph
+	llvm::BitVector inGraph;
+public:
+	// Iterate over the nodes that are in the graph, in increasing order of their indices
+	template <class NodeTy>
+	class NodeIteratorImpl
+	{
+	private:
+		NodeTy* nodeArray;
+		const llvm::BitVector* inGraph;
+		int idx;
+	public:
+		NodeIteratorImpl(NodeTy* n, const llvm::BitVector* b, int i): nodeArray(n), inGraph(b), idx(i) {}
+
+		bool operator== (const NodeIteratorImpl& other) const { return idx == other.idx; }
+		bool operator!= (const NodeIteratorImpl& other) const { return !(*this == other); }
+
+		NodeTy& operator* () const { return nodeArray[idx]; }
+		NodeTy* operator->() const { return &nodeArray[idx]; }
+
+		// Pre-increment
+		NodeIteratorImpl& operator++() { idx = inGraph->find_next(idx); return *this; }
+		// Post-increment
+		const NodeIteratorImpl operator++(int)
+		{
+			NodeIteratorImpl ret(*this);
+			++*this;
+			return ret;
+		}
+	};
+	using iterator = NodeIteratorImpl<SparseBitVectorGraphNode>;
+	using const_iterator = NodeIteratorImpl<const SparseBitVectorGraphNode>;
+
+	// Create a graph that can hold the nodes with indices in [0, numNodes)
+	explicit DenseSparseBitVectorGraph(unsigned numNodes): inGraph(numNodes)
+	{
+		nodes.reserve(numNodes);
+		for (unsigned i = 0; i < numNodes; ++i)
+			nodes.push_back(SparseBitVectorGraphNode(i, arena));
+	}
+
+	SparseBitVectorGraphNode* getOrInsertNode(NodeIndex idx)
+	{
+		assert(idx < nodes.size() && "Node index out of the range of the graph!");
+		inGraph.set(idx);
+		return &nodes[idx];
+	}
+
+	void insertEdge(NodeIndex src, NodeIndex dst)
+	{
+		getOrInsertNode(src)->insertEdge(dst);
+	}
+
+	// src's successors += dst's successors
+	void mergeEdge(NodeIndex src, NodeIndex dst)
+	{
+		SparseBitVectorGraphNode* dstNode = getNodeWithIndex(dst);
+		if (dstNode == nullptr)
+			return;
+
+		getOrInsertNode(src)->succs |= dstNode->succs;
+	}
+
+	SparseBitVectorGraphNode* getNodeWithIndex(NodeIndex idx)
+	{
+		if (idx >= nodes.size() || !inGraph.test(idx))
+			return nullptr;
+		else
+			return &nodes[idx];
+	}
+
+	unsigned getSize() const { return inGraph.count(); }
+
+	// See MemoryUsage.h
+	std::size_t getMemoryUsage() const { return arena.getMemoryUsage() + getVectorMemoryUsage(nodes) + inGraph.getMemorySize(); }
+
+	void releaseMemory()
+	{
+		std::vector<SparseBitVectorGraphNode>().swap(nodes);
+		inGraph.clear();
+		arena.reset();
+	}
+
+	iterator begin() { return iterator(nodes.data(), &inGraph, inGraph.find_first()); }
+	iterator end() { return iterator(nodes.data(), &inGraph, -1); }
+	const_iterator begin() const { return const_iterator(nodes.data(), &inGraph, inGraph.find_first()); }
+	const_iterator end() const { return const_iterator(nodes.data(), &inGraph, -1); }
+};
+
+// Specialize the AnderGraphTraits for DenseSparseBitVectorGraph
+template <> class AndersGraphTraits<DenseSparseBitVectorGraph>
+{
+public:
+	typedef SparseBitVectorGraphNode NodeType;
+	typedef DenseSparseBitVectorGraph::iterator NodeIterator;
+	typedef SparseBitVectorGraphNode::iterator ChildIterator;
+
+	static inline ChildIterator child_begin(NodeType* n)
+	{
+		return n->begin();
+	}
+	static inline ChildIterator child_end(NodeType* n)
+	{
+		return n->end();
+	}
+
+	static inline NodeIterator node_begin(DenseSparseBitVectorGraph* g)
+	{
+		return g->begin();
+	}
+	static inline NodeIterator node_end(DenseSparseBitVectorGraph* g)
+	{
+		return g->end();
+	}
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef ANDERSEN_DISTRIBUTED_SOLVER_H
+#define ANDERSEN_DISTRIBUTED_SOLVER_H
+
+#include "ConstraintFile.h"
+#include "NodeFactory.h"
+#include "PtsSet.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SparseBitVector.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// How the processes of a distributed solving reach each other (see DistributedAndersSolver). The solving goes in bulk-synchronous rounds, and exchange() is the only communication of a round: every rank calls it once per round, with a message for each rank, and gets back the messages of all the ranks addressed to it
+// A message is a sequence of 32-bit words in the byte order of the machine, so all the ranks must share one
+class AndersTransport
+{
+public:
+	virtual ~AndersTransport() = default;
+
+	virtual unsigned getRank() const = 0;
+	virtual unsigned getNumRanks() const = 0;
+	// Send outgoing[r] to rank r, for every rank but this one, and wait for the messages of the others. incoming gets them one after the other in rank order, and active becomes true if any rank, this one included, passed it true. Return false and put the reason into error if a rank can't be reached
+	virtual bool exchange(const std::vector<std::vector<std::uint32_t>>& outgoing, std::vector<std::uint32_t>& incoming, bool& active, std::string& error) = 0;
+};
+
+// The transport of ranks that are threads of one process, for the tests and for trying out a partitioning on one machine. create() makes the numRanks ends of a group, one for each thread
+class AndersInProcessTransport: public AndersTransport
+{
+private:
+	struct Group
+	{
+		unsigned numRanks;
+		std::mutex mutex;
+		std::condition_variable roundDone;
+		// By the parity of the round, so that a rank that is done reading a round can already post to the next one: the messages, at [to * numRanks + from], and whether any rank was active
+		std::vector<std::vector<std::uint32_t>> mailboxes[2];
+		bool wasActive[2] = {false, false};
+		// The ranks that have posted to the current round, and whether any of them was active
+		unsigned numArrived = 0;
+		bool active = false;
+		unsigned round = 0;
+	};
+	std::shared_ptr<Group> group;
+	unsigned rank;
+
+	AndersInProcessTransport(std::shared_ptr<Group> g, unsigned r): group(std::move(g)), rank(r) {}
+public:
+	static std::vector<std::unique_ptr<AndersTransport>> create(unsigned numRanks);
+
+	unsigned getRank() const override { return rank; }
+	unsigned getNumRanks() const override { return group->numRanks; }
+	bool exchange(const std::vector<std::vector<std::uint32_t>>& outgoing, std::vector<std::uint32_t>& incoming, bool& active, std::string& error) override;
+};
+
+// Solve a constraint file over several processes, none of which holds the whole of it (see andersen-dsolve). The nodes are split into as many contiguous ranges as there are ranks, and each rank owns the points-to sets and the edges of its range:
+// - the copy and load edges of a node, and the store edges into the objects it points to, sit with the node they start from, so a rank only ever reads the sets of its own nodes
+// - a change to a set goes along each copy edge as a delta, straight into the target if the rank owns it, and otherwise into the message to its owner
+// - a load or store resolved against an object owned elsewhere becomes a request to the owner to add the copy edge, which sends the whole set of the edge's source the first time
+// Each round solves the local part to its fixed point, then exchanges the deltas and the edge requests in bulk. The solving is over once a round sends nothing. Every rank reads the constraint file, which is mapped, but only keeps the constraints of its own nodes
+// The nodes on a cycle of copy edges all end up with the same set, so each rank collapses the cycles among its own nodes into one of them after each round. The union-find of the merges is distributed with the nodes: only the owner of a node knows where it was merged to, so the messages keep naming the nodes as the constraints do, and the owner follows its merges when they arrive. The cycles that cross ranks are not collapsed, and only cost more rounds
+// The sets are the fixed point of the constraints, the same the sequential solvers reach without the options that give up precision (e.g. -enable-universal-top)
+class DistributedAndersSolver
+{
+public:
+	// What the solving of this rank did, for the report of andersen-dsolve
+	struct Stats
+	{
+		unsigned rounds = 0;
+		std::uint64_t wordsSent = 0;
+		std::uint64_t deltasSent = 0;
+		std::uint64_t edgeRequestsSent = 0;
+		unsigned merges = 0;
+	};
+private:
+	// The messages are sequences of records of these kinds
+	enum RecordKind: std::uint32_t
+	{
+		// [DeltaRecord, node, count, objects...]: the objects the set of node gets
+		DeltaRecord = 1,
+		// [EdgeRecord, src, dst]: add a copy edge from src to dst, which the owner of src has to send the whole set of src along
+		EdgeRecord = 2,
+	};
+
+	struct LocalNode
+	{
+		AndersPtsSet ptsSet;
+		// The part of ptsSet its copy edges, loads and stores have already seen
+		AndersPtsSet propagated;
+		llvm::SparseBitVector<> copySuccs;
+		// For a load dst = *n, dst, and for a store *n = src, src
+		std::vector<NodeIndex> loadDsts, storeSrcs;
+		// Where the node was merged to, or itself. Only followed for the nodes of this rank
+		NodeIndex mergeTarget;
+		bool onWorkList = false;
+	};
+
+	AndersTransport& transport;
+	unsigned numNodes;
+	// The nodes of this rank are [firstNode, lastNode)
+	NodeIndex firstNode, lastNode;
+	unsigned nodesPerRank;
+	std::vector<LocalNode> nodes;
+	std::vector<NodeIndex> workList;
+	// The position of each representative of this rank in a topological order of the copy edges between them, which the work list is visited in
+	std::vector<unsigned> topoOrder;
+	// What the round has for the other ranks, which goes out together at its end: the objects it has found for their nodes, the copy edges it asks them to add, and then the messages, by rank
+	llvm::DenseMap<NodeIndex, AndersPtsSet> remoteDeltas;
+	std::vector<std::pair<NodeIndex, NodeIndex>> remoteEdges;
+	std::vector<std::vector<std::uint32_t>> outgoing;
+	Stats stats;
+
+	bool isLocal(NodeIndex n) const { return n >= firstNode && n < lastNode; }
+	unsigned getOwner(NodeIndex n) const { return n / nodesPerRank; }
+	LocalNode& getNode(NodeIndex n) { return nodes[n - firstNode]; }
+	NodeIndex findLocal(NodeIndex n);
+
+	void addToWorkList(NodeIndex n);
+	// Add objects to the set of n, wherever it is owned
+	void addObjects(NodeIndex n, const AndersPtsSet& objects);
+	void addCopyEdge(NodeIndex src, NodeIndex dst);
+	void visit(NodeIndex n);
+	bool readMessages(llvm::ArrayRef<std::uint32_t> incoming, std::string& error);
+	// Collapse the cycles of copy edges among the nodes of this rank, and order the nodes for topoOrder
+	void collapseLocalCycles();
+	void mergeInto(NodeIndex rep, NodeIndex n);
+
+	DistributedAndersSolver(AndersTransport& t, unsigned n);
+public:
+	// Keep the constraints of reader that belong to the nodes of transport's rank. Return nullptr and put the reason into error if the file is inconsistent
+	static std::unique_ptr<DistributedAndersSolver> create(const ConstraintFileReader& reader, AndersTransport& transport, std::string& error);
+
+	// Solve to the fixed point, together with all the other ranks. Return false and put the reason into error if the transport fails, or a rank sends a malformed message
+	bool solve(std::string& error);
+
+	NodeIndex getFirstNode() const { return firstNode; }
+	NodeIndex getLastNode() const { return lastNode; }
+	// The points-to set of n, which must be a node of this rank. The null object is kept apart from the elements, as in every AndersPtsSet
+	const AndersPtsSet& getPointsToSet(NodeIndex n) const;
+	const Stats& getStats() const { return stats; }
+};
+
+#endif
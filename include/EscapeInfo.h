@@ -0,0 +1,37 @@
+#ifndef ANDERSEN_ESCAPE_INFO_H
+#define ANDERSEN_ESCAPE_INFO_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Value.h"
+
+#include <vector>
+
+// Where the stack and heap objects of a module may escape to, as found by Andersen::computeEscapes() for all of them at once. An object escapes if a pointer to it may be found by following pointers from a root: from the global variables, from the arguments and the return value of the function that allocates it (its callers may see it), or from what the analysis doesn't know (the universal object, and the arguments of the calls to unknown external functions that may capture them)
+struct AndersEscapeInfo
+{
+	enum EscapeKind: unsigned
+	{
+		EscapesToGlobals = 1 << 0,
+		EscapesToCaller = 1 << 1,
+		EscapesToUnknown = 1 << 2,
+		EscapesAnywhere = EscapesToGlobals | EscapesToCaller | EscapesToUnknown
+	};
+
+	// The allocas and the heap allocation sites the analysis has an object for, in module order. Bit i of the sets below is about objects[i]
+	std::vector<const llvm::Value*> objects;
+	llvm::DenseMap<const llvm::Value*, unsigned> objectIndex;
+	llvm::BitVector toGlobals, toCaller, toUnknown;
+
+	// The EscapeKind bits of allocSite, or EscapesAnywhere if it is not one of the objects
+	unsigned getEscapes(const llvm::Value* allocSite) const
+	{
+		auto itr = objectIndex.find(allocSite);
+		if (itr == objectIndex.end())
+			return EscapesAnywhere;
+		unsigned i = itr->second;
+		return (toGlobals.test(i) ? EscapesToGlobals : 0) | (toCaller.test(i) ? EscapesToCaller : 0) | (toUnknown.test(i) ? EscapesToUnknown : 0);
+	}
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef ANDERSEN_FLOW_SENSITIVE_INFO_H
+#define ANDERSEN_FLOW_SENSITIVE_INFO_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Value.h"
+
+#include <vector>
+
+// The flow-sensitive points-to sets of the pointers of some functions, as found by Andersen::computeFlowSensitive(). A pointer loaded from memory only gets what the stores that may reach the load put there, and a store to a single location replaces what the location held instead of adding to it. Each set is a subset of what Andersen::getPointsToSet() gives for the same pointer
+struct AndersFlowSensitiveInfo
+{
+	// The arguments and the instructions of pointer type of the analyzed functions, with their objects listed the way Andersen::getPointsToSet() lists them
+	llvm::DenseMap<const llvm::Value*, std::vector<const llvm::Value*>> ptsSets;
+	// The pointers of the analyzed functions that may point to what the analysis doesn't know
+	llvm::DenseSet<const llvm::Value*> unknown;
+	// The stores that replaced the contents of the location they write to
+	unsigned numStrongUpdates = 0;
+
+	// The same as Andersen::getPointsToSet(): return false if v is not a pointer of an analyzed function, or if it may point to what the analysis doesn't know
+	bool getPointsToSet(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet) const
+	{
+		auto itr = ptsSets.find(v);
+		if (itr == ptsSets.end() || unknown.count(v))
+			return false;
+		ptsSet = itr->second;
+		return true;
+	}
+};
+
+#endif
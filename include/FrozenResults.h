@@ -0,0 +1,72 @@
+#ifndef ANDERSEN_FROZEN_RESULTS_H
+#define ANDERSEN_FROZEN_RESULTS_H
+
+#include "CompactPtsGraph.h"
+#include "NodeFactory.h"
+#include "PtsSetView.h"
+
+#include "llvm/Analysis/AliasAnalysis.h"
+
+#include <memory>
+#include <vector>
+
+class Andersen;
+
+// An immutable view of the solved results, for clients that query one analysis from many threads at once (e.g. analyses that run on each function in parallel). Every query is const, allocates nothing and writes nothing, not even a cache: the AndersenAAResult queries update the alias cache and the statistics, and build the mod/ref summaries on the first mod/ref query
+// What the alias queries need is computed once, when the view is built: the representative of every node, a single lookup away, and a summary of every solved set. The view shares the analysis, which must not be updated (see Andersen::updateFunctions()) as long as the view is in use. With -anders-track-values, a view that was built before Andersen::getTrackedVersion() last changed must be built again
+class AndersFrozenResults
+{
+public:
+	// A pointer once its representative and its points-to set have been looked up. rep is InvalidIndex if the analysis doesn't know the pointer
+	struct ResolvedPointer
+	{
+		NodeIndex rep;
+		unsigned setId;
+	};
+	// What an alias query needs to know about a points-to set. Most queries are answered by a few integer compares
+	struct SetSummary
+	{
+		// The elements of the set other than the special objects
+		CompactPtsSet objs;
+		// True if the set has the universal object, i.e. the pointer may point to anything
+		bool universal;
+		// True if the set is exactly { *objs.begin() } and that object is a single memory object (not a location equivalence class). Two pointers with such a set must alias
+		bool mustAliasSingleton;
+		// The AndersNodeFactory::ObjectCategory bits of the objects in the set (see Andersen::getPointeeCategories())
+		unsigned categories;
+		// True if every object in the set is constant memory: a function, a constant global, or null (see AndersenAAResult::pointsToConstantMemory())
+		bool constantMemory;
+	};
+private:
+	std::shared_ptr<const Andersen> anders;
+	// The representative of each node. The merge targets of the analysis are flattened after solving, but this copy doesn't depend on that, or on the analysis keeping them as they are
+	std::vector<NodeIndex> reps;
+	// Indexed by set id (see CompactPtsGraph::getSetId())
+	std::vector<SetSummary> setSummaries;
+public:
+	// anders must be solved
+	explicit AndersFrozenResults(std::shared_ptr<const Andersen> anders);
+
+	const Andersen& getAndersen() const { return *anders; }
+
+	ResolvedPointer resolvePointer(const llvm::Value* v) const;
+	// The same for node n of an analysis that has no IR behind it (see Andersen::getPointsToSetViewOfNode())
+	ResolvedPointer resolveNode(NodeIndex n) const;
+	const SetSummary& getSetSummary(unsigned setId) const { return setSummaries[setId]; }
+
+	llvm::AliasResult alias(const llvm::Value* v1, const llvm::Value* v2) const;
+	llvm::AliasResult aliasResolved(const ResolvedPointer& p1, const ResolvedPointer& p2) const;
+	// The answer for two pointers that are not merged together, given the ids of their sets
+	llvm::AliasResult aliasSets(unsigned setId1, unsigned setId2) const;
+	// The part of aliasSets() that only needs the summaries of the sets. Return false if the sets have to be intersected, which is the only part worth caching
+	bool aliasSummaries(unsigned setId1, unsigned setId2, llvm::AliasResult& result) const;
+	// Return true if the sets share an object. This is a merge of the two sorted sets
+	bool intersectSets(unsigned setId1, unsigned setId2) const { return setSummaries[setId1].objs.intersectWith(setSummaries[setId2].objs); }
+
+	// Return false if ptr certainly doesn't point to the memory object allocSite. Unlike AndersPtsSetView::hasValue(), a pointer the analysis doesn't know, or that may point to anything, may point to allocSite
+	bool mayPointTo(const llvm::Value* ptr, const llvm::Value* allocSite) const;
+	// See Andersen::getPointsToSetView()
+	bool getPointsToSetView(const llvm::Value* v, AndersPtsSetView& view) const;
+};
+
+#endif
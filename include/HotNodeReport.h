@@ -0,0 +1,56 @@
+#ifndef ANDERSEN_HOT_NODE_REPORT_H
+#define ANDERSEN_HOT_NODE_REPORT_H
+
+#include "NodeFactory.h"
+
+#include <cstdint>
+#include <vector>
+
+// The work the sequential worklist solver spent on each node, for the report of -anders-hot-nodes, and on each cost tag, for that of -anders-function-cost. It is only kept when one of the reports is asked for
+class SolverNodeProfile
+{
+private:
+	std::vector<unsigned> visits;
+	// The elements offered to the targets of the node: the size of the set it propagated times the number of unions it did, summed over its visits
+	std::vector<std::uint64_t> unionWork;
+
+	// With -anders-function-cost, the factory the cost tags of the nodes are read from, and the union work and the new copy edges of the nodes that carry each tag. A node with several tags charges each of them in full
+	const AndersNodeFactory* tagFactory = nullptr;
+	std::vector<std::uint64_t> tagUnionWork, tagCopyEdges;
+public:
+	SolverNodeProfile(unsigned numNodes): visits(numNodes), unionWork(numNodes) {}
+
+	void enableCostTags(const AndersNodeFactory& factory, unsigned numTags)
+	{
+		tagFactory = &factory;
+		tagUnionWork.assign(numTags, 0);
+		tagCopyEdges.assign(numTags, 0);
+	}
+
+	void recordVisit(NodeIndex node) { ++visits[node]; }
+	void recordUnions(NodeIndex node, unsigned numUnions, unsigned setSize)
+	{
+		std::uint64_t work = std::uint64_t(numUnions) * setSize;
+		unionWork[node] += work;
+		if (tagFactory != nullptr)
+			for (auto tag: tagFactory->getCostTags(node))
+				tagUnionWork[tag] += work;
+	}
+	// numEdges copy edges were added to the constraint graph by the loads and stores of node
+	void recordCopyEdges(NodeIndex node, unsigned numEdges)
+	{
+		if (tagFactory != nullptr)
+			for (auto tag: tagFactory->getCostTags(node))
+				tagCopyEdges[tag] += numEdges;
+	}
+
+	unsigned getNumVisits(NodeIndex node) const { return visits[node]; }
+	std::uint64_t getUnionWork(NodeIndex node) const { return unionWork[node]; }
+	unsigned getNumNodes() const { return visits.size(); }
+
+	unsigned getNumTags() const { return tagUnionWork.size(); }
+	std::uint64_t getTagUnionWork(unsigned tag) const { return tagUnionWork[tag]; }
+	std::uint64_t getTagCopyEdges(unsigned tag) const { return tagCopyEdges[tag]; }
+};
+
+#endif
@@ -0,0 +1,139 @@
+#ifndef ANDERSEN_LABELSETTABLE_H
+#define ANDERSEN_LABELSETTABLE_H
+
+#include "PooledSparseBitVector.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// A fingerprint of a set of unsigned integers. Every element is scrambled on its own and the results are added up, so the fingerprint does not depend on the order of insertion and can be updated one element at a time while the set is being built
+class SetFingerprint
+{
+private:
+	std::uint64_t value;
+
+	// The finalizer of splitmix64. Neighbouring indices end up with unrelated bit patterns, so sets such as {1, 2, 3} and {0} no longer collide the way they do when the indices are just XOR-ed together
+	static std::uint64_t mix(unsigned idx)
+	{
+		std::uint64_t x = idx + 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+public:
+	SetFingerprint(): value(0) {}
+
+	// Must be called exactly once for every element of the set
+	void add(unsigned idx) { value += mix(idx); }
+
+	std::uint64_t getValue() const { return value; }
+
+	bool operator==(const SetFingerprint& other) const { return value == other.value; }
+	bool operator!=(const SetFingerprint& other) const { return value != other.value; }
+
+	// Compute the fingerprint of a set that has been built without one
+	template <typename Set>
+	static SetFingerprint of(const Set& vec)
+	{
+		SetFingerprint ret;
+		for (auto const& idx: vec)
+			ret.add(idx);
+		return ret;
+	}
+};
+
+// A table that interns sets of unsigned integers, mapping each distinct set to a number (the pointer equivalence label in HVN/HU, the representative object in LE)
+// The caller provides the sets' fingerprints, so a set is never walked to hash it: only sets with equal fingerprints are compared element by element, and those are almost always equal
+// The copies of the sets the table keeps come from the arenas of the sets it is given, so the table must be cleared before those arenas are reset
+class LabelSetTable
+{
+private:
+	struct Entry
+	{
+		PooledSparseBitVector set;
+		unsigned label;
+		// The next entry whose set has the same fingerprint, or NoEntry
+		unsigned next;
+	};
+	enum: unsigned { NoEntry = ~0u };
+
+	std::vector<Entry> entries;
+	// Map from a fingerprint to the first entry with that fingerprint
+	std::unordered_map<std::uint64_t, unsigned> buckets;
+public:
+	enum: unsigned { NoLabel = ~0u };
+
+	// Return the label that has been given to set, or NoLabel if set has not been seen before
+	unsigned lookup(const PooledSparseBitVector& set, SetFingerprint fingerprint) const
+	{
+		auto itr = buckets.find(fingerprint.getValue());
+		if (itr == buckets.end())
+			return NoLabel;
+		for (unsigned e = itr->second; e != NoEntry; e = entries[e].next)
+		{
+			if (entries[e].set == set)
+				return entries[e].label;
+		}
+		return NoLabel;
+	}
+
+	// Return the label that has been given to set. If set has not been seen before, label it newLabel and return newLabel
+	unsigned getOrInsert(const PooledSparseBitVector& set, SetFingerprint fingerprint, unsigned newLabel)
+	{
+		auto result = buckets.insert(std::make_pair(fingerprint.getValue(), static_cast<unsigned>(entries.size())));
+		unsigned head = NoEntry;
+		if (!result.second)
+		{
+			head = result.first->second;
+			for (unsigned e = head; e != NoEntry; e = entries[e].next)
+			{
+				if (entries[e].set == set)
+					return entries[e].label;
+			}
+			result.first->second = entries.size();
+		}
+
+		entries.push_back(Entry{set, newLabel, head});
+		return newLabel;
+	}
+
+	unsigned getSize() const { return entries.size(); }
+
+	void clear()
+	{
+		std::vector<Entry>().swap(entries);
+		buckets.clear();
+	}
+};
+
+// A LabelSetTable that any number of threads may use at the same time. The sets are spread over shards by their fingerprints and every shard has a lock of its own, so two threads only wait for each other when their sets land in the same shard
+class ConcurrentLabelSetTable
+{
+private:
+	struct Shard
+	{
+		std::mutex lock;
+		LabelSetTable table;
+	};
+	unsigned numShards;
+	std::unique_ptr<Shard[]> shards;
+public:
+	explicit ConcurrentLabelSetTable(unsigned n): numShards(n), shards(new Shard[n]) {}
+
+	// Return the label that has been given to set. If set has not been seen before, label it with the next value of nextLabel. The counter only moves for the new sets, so the labels stay as dense as those of LabelSetTable, although the order in which they are handed out depends on the scheduling
+	unsigned getOrInsert(const PooledSparseBitVector& set, SetFingerprint fingerprint, std::atomic<unsigned>& nextLabel)
+	{
+		Shard& shard = shards[fingerprint.getValue() % numShards];
+		std::lock_guard<std::mutex> guard(shard.lock);
+		unsigned label = shard.table.lookup(set, fingerprint);
+		if (label == LabelSetTable::NoLabel)
+			label = shard.table.getOrInsert(set, fingerprint, nextLabel++);
+		return label;
+	}
+};
+
+#endif
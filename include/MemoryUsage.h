@@ -0,0 +1,48 @@
+#ifndef ANDERSEN_MEMORY_USAGE_H
+#define ANDERSEN_MEMORY_USAGE_H
+
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstddef>
+#include <vector>
+
+// The getMemoryUsage() of the data structures return the heap bytes they hold, estimated from the sizes and capacities of their containers rather than measured, so that they cost no more than a walk over the structure and need no heap profiler. The overhead of the allocator is not counted
+
+template <typename T>
+std::size_t getVectorMemoryUsage(const std::vector<T>& vec)
+{
+	return vec.capacity() * sizeof(T);
+}
+
+// A llvm::SparseBitVector<> is a list of 128-bit elements, one list node per element. SparseBitVector doesn't tell how many elements it has, so they are counted from the set bits
+std::size_t getSparseBitVectorMemoryUsage(const llvm::SparseBitVector<>& bits);
+
+// The memory of an analysis by data structure (see Andersen::getMemoryUsage()), in bytes. What doesn't exist at the time it is taken is 0: the constraint graph and the HCD table only live while the constraints are solved
+struct AndersMemoryUsage
+{
+	// The node factory: the merge targets, the values of the nodes and the maps from the values to their nodes
+	std::size_t nodes = 0;
+	// The constraint vector, optimized or not, with the field constraints
+	std::size_t constraints = 0;
+	// The points-to sets, with the pool or the BDD nodes they share under the shared policies, or the compact graph the queries read once the solving is over
+	std::size_t ptsSets = 0;
+	// The constraint graph, by kind of edge. checkedEdges are the copy edges LCD has checked
+	std::size_t graphNodes = 0;
+	std::size_t copyEdges = 0;
+	std::size_t complexEdges = 0;
+	std::size_t fieldEdges = 0;
+	std::size_t checkedEdges = 0;
+	// The collapse targets of offline HCD
+	std::size_t hcdTable = 0;
+
+	std::size_t getTotal() const
+	{
+		return nodes + constraints + ptsSets + graphNodes + copyEdges + complexEdges + fieldEdges + checkedEdges + hcdTable;
+	}
+
+	// One line, in KB, e.g. "nodes=120 constraints=340 pts=1024 ... total=2048"
+	void print(llvm::raw_ostream& os) const;
+};
+
+#endif
@@ -1,57 +1,81 @@
 #ifndef ANDERSEN_NODE_FACTORY_H
 #define ANDERSEN_NODE_FACTORY_H
 
+#include "ConcurrentUnionFind.h"
+
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/DataLayout.h"
 #include "llvm/IR/Constants.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <utility>
 #include <vector>
 
-// AndersNode class - This class is used to represent a node in the constraint graph.  Due to various optimizations, it is not always the case that there is always a mapping from a Node to a Value. (In particular, we add artificial Node's that represent the set of pointed-to variables shared for each location equivalent Node.
-// Ordinary clients are not allowed to create AndersNode objects. To guarantee index consistency, AndersNodes (and its subclasses) instances should only be created through AndersNodeFactory.
+// A node in the constraint graph is identified by its NodeIndex. Due to various optimizations, it is not always the case that there is always a mapping from a Node to a Value. (In particular, we add artificial Node's that represent the set of pointed-to variables shared for each location equivalent Node.
+// To guarantee index consistency, nodes should only be created through AndersNodeFactory.
 typedef unsigned NodeIndex;
-class AndersNode
-{
-public:
-	enum AndersNodeType
-	{
-		VALUE_NODE,
-		OBJ_NODE
-	};
-private:
-	AndersNodeType type;
-	NodeIndex idx, mergeTarget;
-	const llvm::Value* value;
-	AndersNode(AndersNodeType t, unsigned i, const llvm::Value* v = nullptr): type(t), idx(i), mergeTarget(i), value(v) {}
-public:
-	NodeIndex getIndex() const { return idx; }
-	const llvm::Value* getValue() const { return value; }
 
-	friend class AndersNodeFactory;
-};
-
-// This is the factory class of AndersNode
-// It use a vectors to hold all Nodes in the program
-// Since vectors may invalidate all element pointers/iterators when resizing, it is impossible to return AndersNode* in public interfaces without using std::unique_ptr and heap allocations. Therefore, we use plain integers to represent nodes for public functions like createXXX and getXXX. This is ugly, but it is efficient.
+// This is the factory class of the nodes
+// The attributes of the nodes are kept in parallel arrays indexed by NodeIndex rather than in an array of node objects. getMergeTarget() is called all the time during solving, and this way it only reads the merge targets, which are packed together, instead of dragging the other attributes of every node it visits into the cache
 class AndersNodeFactory
 {
 public:
 	// The largest unsigned int is reserved for invalid index
 	static const unsigned InvalidIndex;
-private:
-
-	// The set of nodes 
-	std::vector<AndersNode> nodes;
 
 	// Some special indices
 	static const NodeIndex UniversalPtrIndex = 0;
 	static const NodeIndex UniversalObjIndex = 1;
 	static const NodeIndex NullPtrIndex = 2;
 	static const NodeIndex NullObjectIndex = 3;
+	// The type class of the nodes whose points-to sets are not filtered
+	static const unsigned NoTypeClass;
+	// The kinds of memory an object node stands for, as bits of a mask (see getObjectCategories()). An object made by a call is taken to be on the heap, whatever the callee, and an object without a value (a vararg node, or an object of a constraint file or a summary) is an OtherObject. The null object is in no category
+	enum ObjectCategory: unsigned char
+	{
+		StackObject = 1 << 0,
+		HeapObject = 1 << 1,
+		GlobalObject = 1 << 2,
+		ConstantGlobalObject = 1 << 3,
+		FunctionObject = 1 << 4,
+		UniversalObject = 1 << 5,
+		OtherObject = 1 << 6,
+		// The objects that are never written to (see AndersenAAResult::pointsToConstantMemory())
+		ConstantMemoryObjects = ConstantGlobalObject | FunctionObject
+	};
+private:
 
-	// valueNodeMap - This map indicates the AndersNode* that a particular Value* corresponds to
+	// The node each node has been merged into, or the node itself if it is a representative. The links form a union-find forest
+	std::vector<NodeIndex> mergeTargets;
+	// Bumped by every merge, so that the holders of node indices can tell whether any of them may have been merged away since they last looked (see ConstraintGraphNode::canonicalizeEdges())
+	unsigned mergeEpoch;
+	// The merge targets while concurrent merging is enabled
+	ConcurrentUnionFind concurrentMergeTargets;
+	// The value each node stands for (nullptr for the artificial nodes)
+	std::vector<const llvm::Value*> nodeValues;
+	// Whether each node is an object node (or a value node)
+	llvm::BitVector objectNodes;
+	// The ObjectCategory bit of each object node, set when the node is created from its value, and 0 for the value nodes. It stays when the object loses its value, since the memory is still of the same kind
+	std::vector<unsigned char> objectCategories;
+	// With -anders-type-filter, the type class of each node while solving (see AndersTypeFilter), and empty otherwise. mergeNode() leaves a representative that merges two classes without one
+	std::vector<unsigned> typeClasses;
+	// With -anders-function-cost, the cost tags of each node: the tags of all the nodes merged into it, sorted. Empty otherwise, and a node past its end has no tags
+	std::vector<llvm::SmallVector<unsigned, 2>> costTags;
+	// Add the tags of n1 to those of n0
+	void unionCostTags(NodeIndex n0, NodeIndex n1);
+	// Apply the rule of mergeNode() to the type classes after merges that didn't go through it: a representative keeps its class only if every node merged into it has that class too
+	void foldTypeClasses();
+	// With -anders-field-sensitive, the index of each node among the fields of its object, and the number of fields of that object. Both are empty until an object is given more than one field, and a node past their end is a single field
+	std::vector<unsigned> fieldIndices;
+	std::vector<unsigned> fieldCounts;
+
+	// valueNodeMap - This map indicates the node that a particular Value* corresponds to
 	llvm::DenseMap<const llvm::Value*, NodeIndex> valueNodeMap;
 	
 	// ObjectNodes - This map contains entries for each memory object in the program: globals, alloca's and mallocs.
@@ -64,6 +88,8 @@ private:
 	// varargMap - This map contains the entry used to represent all pointers passed through the varargs portion of a function call for a particular function.  An entry is not present in this map for functions that do not take variable arguments.
 	llvm::DenseMap<const llvm::Function*, NodeIndex> varargMap;
 
+	NodeIndex createNode(const llvm::Value* val, bool isObject);
+	void setObjectValue(NodeIndex obj, const llvm::Value* val);
 public:
 	AndersNodeFactory();
 
@@ -72,6 +98,10 @@ public:
 	NodeIndex createObjectNode(const llvm::Value* val = nullptr);
 	NodeIndex createReturnNode(const llvm::Function* f);
 	NodeIndex createVarargNode(const llvm::Function* f);
+	// Let val stand for the object obj as well, which was created for another value. obj keeps the value it was created for, which is the one the queries see
+	void shareObjectNode(const llvm::Value* val, NodeIndex obj);
+	// Make room for this many more value and object nodes, so that the tables don't have to grow while the module is scanned
+	void reserve(unsigned numValueNodes, unsigned numObjectNodes);
 
 	// Map lookup interfaces (return InvalidIndex if value not found)
 	NodeIndex getValueNodeFor(const llvm::Value* val) const;
@@ -83,18 +113,92 @@ public:
 
 	// Node merge interfaces
 	void mergeNode(NodeIndex n0, NodeIndex n1);	// Merge n1 into n0
-	NodeIndex getMergeTarget(NodeIndex n);
-	NodeIndex getMergeTarget(NodeIndex n) const;
+	// These two are defined here so that the solving loops can inline them
+	NodeIndex getMergeTarget(NodeIndex n)
+	{
+		assert(n < getNumNodes());
+		while (mergeTargets[n] != n)
+		{
+			NodeIndex grandParent = mergeTargets[mergeTargets[n]];
+			mergeTargets[n] = grandParent;
+			n = grandParent;
+		}
+		return n;
+	}
+	NodeIndex getMergeTarget(NodeIndex n) const
+	{
+		assert(n < getNumNodes());
+		while (mergeTargets[n] != n)
+			n = mergeTargets[n];
+		return n;
+	}
+	unsigned getMergeEpoch() const { return mergeEpoch; }
+	// Link every node directly to its representative, so that getMergeTarget() takes a single step from then on
+	void flattenMergeTargets();
+	// Undo all merges
+	void resetMergeTargets();
+	// Replace all merges with targets, the representative of each node (see SolverCheckpoint)
+	void restoreMergeTargets(const NodeIndex* targets);
+
+	// Renumber the nodes so that all object nodes come right after the special nodes, followed by the value nodes. Both groups keep their creation order, in which the objects of an allocation-site function are already next to each other. Points-to sets only ever hold object nodes, so they end up in fewer bitvector elements
+	// The merges made so far are renumbered along. Return the map from the old indices to the new ones, which the caller uses to rewrite the indices it holds
+	std::vector<NodeIndex> packObjectNodes();
+
+	// Concurrent node merge interfaces. Between beginConcurrentMerge() and endConcurrentMerge(), any number of threads may call concurrentMergeNode() and concurrentGetMergeTarget() at the same time. The sequential merge interfaces must not be used in between
+	// This is groundwork for the parallel solvers, none of which merges through it yet. endConcurrentMerge() folds the cost tags and the type classes the way mergeNode() would have
+	// Unlike mergeNode(), concurrentMergeNode() doesn't let the caller pick the representative: the one with the smaller index wins (see ConcurrentUnionFind), which keeps the special nodes their own representatives. It returns the representative
+	void beginConcurrentMerge() { concurrentMergeTargets.reset(mergeTargets); }
+	void endConcurrentMerge()
+	{
+		++mergeEpoch;
+		concurrentMergeTargets.exportTo(mergeTargets);
+		concurrentMergeTargets.clear();
+		foldCostTags();
+		foldTypeClasses();
+	}
+	NodeIndex concurrentMergeNode(NodeIndex n0, NodeIndex n1) { return concurrentMergeTargets.unite(n0, n1); }
+	NodeIndex concurrentGetMergeTarget(NodeIndex n) { return concurrentMergeTargets.find(n); }
+
+	// Type class interfaces. The classes are given to the representatives once the offline merges are done, and the merges from then on keep them up to date
+	void setTypeClasses(std::vector<unsigned> classes)
+	{
+		assert(classes.empty() || classes.size() == getNumNodes());
+		typeClasses = std::move(classes);
+	}
+	unsigned getTypeClass(NodeIndex n) const { return typeClasses.empty() ? NoTypeClass : typeClasses[n]; }
+
+	// Cost tag interfaces (see -anders-function-cost). The tags are given to the nodes once they are all created, and each representative carries the tags of the nodes merged into it, through the merges made before and after
+	void setCostTags(std::vector<llvm::SmallVector<unsigned, 2>> tags);
+	llvm::ArrayRef<unsigned> getCostTags(NodeIndex n) const { return n < costTags.size() ? llvm::ArrayRef<unsigned>(costTags[n]) : llvm::ArrayRef<unsigned>(); }
+	// Give each representative the tags of its members, after a change to the merges that didn't go through mergeNode()
+	void foldCostTags();
+
+	// Field interfaces. The fields of an object are consecutive object nodes, the first of which is the object node of its value
+	// Give obj, which must be the last node created, numFields - 1 more fields right after it
+	void createFieldNodes(NodeIndex obj, unsigned numFields);
+	bool hasFieldNodes() const { return !fieldIndices.empty(); }
+	unsigned getFieldIndex(NodeIndex n) const { return n < fieldIndices.size() ? fieldIndices[n] : 0; }
+	unsigned getNumFields(NodeIndex n) const { return n < fieldCounts.size() ? fieldCounts[n] : 1; }
+
+	// The ObjectCategory of object node i, or 0 if i is a value node or the null object. A location equivalence class is not folded into its representative: the classes are kept by the analysis, not here
+	unsigned getObjectCategories(NodeIndex i) const
+	{
+		assert(i < objectCategories.size());
+		return objectCategories[i];
+	}
 
 	// Pointer arithmetic
 	bool isObjectNode(NodeIndex i) const
 	{
-		return (nodes.at(i).type == AndersNode::OBJ_NODE);
+		assert(i < objectNodes.size());
+		return objectNodes[i];
 	}
+	// The field offset fields after the field n. An offset past the end of the object lands on its last field, which also stands for the fields past -anders-max-fields
 	NodeIndex getOffsetObjectNode(NodeIndex n, unsigned offset) const
 	{
-		assert(isObjectNode(n + offset));
-		return n + offset;
+		assert(isObjectNode(n));
+		unsigned lastOffset = getNumFields(n) - 1 - getFieldIndex(n);
+		return n + std::min(offset, lastOffset);
 	}
 
 	// Special node getters
@@ -106,18 +210,36 @@ public:
 	// Value getters
 	const llvm::Value* getValueForNode(NodeIndex i) const
 	{
-		return nodes.at(i).getValue();
+		assert(i < nodeValues.size());
+		return nodeValues[i];
 	}
 	void getAllocSites(std::vector<const llvm::Value*>&) const;
 
+	// Iterate over the values that have a value node, together with their nodes
+	typedef llvm::DenseMap<const llvm::Value*, NodeIndex>::const_iterator value_node_iterator;
+	value_node_iterator value_node_begin() const { return valueNodeMap.begin(); }
+	value_node_iterator value_node_end() const { return valueNodeMap.end(); }
+	// Iterate over the values that have an object node, together with their nodes
+	typedef llvm::DenseMap<const llvm::Value*, NodeIndex>::const_iterator obj_node_iterator;
+	obj_node_iterator obj_node_begin() const { return objNodeMap.begin(); }
+	obj_node_iterator obj_node_end() const { return objNodeMap.end(); }
+
 	// Value remover
 	void removeNodeForValue(const llvm::Value* val)
 	{
 		valueNodeMap.erase(val);
 	}
+	// Unlink n from its value, e.g. because the value is about to be deleted. n stays, but it is no longer found through the value
+	void detachNode(NodeIndex n);
+	// Unlink val from all its nodes, because it is being deleted. Return true if it had an object node, or return and vararg nodes
+	bool forgetValue(const llvm::Value* val);
+	// Let newVal stand for the nodes of oldVal, which all the uses of oldVal have been replaced with. A value node newVal already has is kept, and so is one it can't have because it is a constant other than a global. The object of oldVal goes to what newVal points to without its casts, unless that has an object node of its own or can't have one, in which case nothing is done to the objects and false is returned
+	bool replaceValue(const llvm::Value* oldVal, const llvm::Value* newVal);
 
 	// Size getters
-	unsigned getNumNodes() const { return nodes.size(); }
+	unsigned getNumNodes() const { return mergeTargets.size(); }
+	// The per-node tables and the maps from the values to their nodes (see MemoryUsage.h)
+	std::size_t getMemoryUsage() const;
 
 	// For debugging purpose
 	void dumpNode(NodeIndex) const;
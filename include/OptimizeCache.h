@@ -0,0 +1,69 @@
+#ifndef ANDERSEN_OPTIMIZE_CACHE_H
+#define ANDERSEN_OPTIMIZE_CACHE_H
+
+#include "Constraint.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What the offline optimizations (HVN, HU, HRU and LE) made of a set of constraints, kept in a cache directory with -anders-optimize-cache=<dir> for the runs that analyze the same input again. The optimizations are deterministic functions of what they start from (the nodes and their merges, the constraints, the targets of the constraints they don't see) and of the options that pick them, so a hash of all that is the key of the entry, and the entry holds what they leave behind: the constraints, the merges, and the location classes of LE
+// Each entry is a file of its own, named after its key and laid out like the other files of the analysis (see WordFile.h). It is written to a temporary file that is renamed into place once complete, so runs that share the directory never see half an entry
+namespace OptimizeCacheFormat
+{
+	enum: std::uint32_t { Magic = 0x54504f41 /* "AOPT" */, Version = 1 };
+
+	struct Header
+	{
+		std::uint64_t key;
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t numNodes;
+		std::uint32_t numConstraints;
+		std::uint32_t numClasses;
+		std::uint32_t numClassMembers;
+	};
+	// The arrays that follow the header, in this order:
+	//   constraints[numConstraints]     the packed keys of the optimized constraints (see AndersConstraint::getPackedKey()), 64 bits each
+	//   mergeTarget[numNodes]           the representative of each node
+	//   classReps[numClasses]           the representatives of the location equivalence classes
+	//   classOffsets[numClasses + 1]
+	//   classMembers[numClassMembers]
+}
+
+class OptimizeCacheEntry
+{
+private:
+	std::unique_ptr<llvm::MemoryBuffer> buffer;
+	const OptimizeCacheFormat::Header* header;
+	const std::uint64_t* constraints;
+	const std::uint32_t* mergeTarget;
+	const std::uint32_t* classReps;
+	const std::uint32_t* classOffsets;
+	const std::uint32_t* classMembers;
+
+	OptimizeCacheEntry() = default;
+	bool isValid(std::string& error) const;
+public:
+	// The key of the optimizations of constraints, which start from the merges of nodeFactory and leave indirectTargets alone. options has a bit for each optimization that runs
+	static std::uint64_t computeKey(const AndersNodeFactory& nodeFactory, llvm::ArrayRef<AndersConstraint> constraints, llvm::ArrayRef<NodeIndex> indirectTargets, std::uint32_t options);
+	static std::string getFileName(llvm::StringRef dir, std::uint64_t key);
+
+	// Store the results of the optimizations under key in dir, which is created if need be. Return false and put the reason into error if the entry can't be written
+	static bool write(llvm::StringRef dir, std::uint64_t key, const AndersNodeFactory& nodeFactory, llvm::ArrayRef<AndersConstraint> constraints, const llvm::DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses, std::string& error);
+	// Return nullptr if dir has no entry for key and numNodes nodes. error is left empty if there is no entry at all, and otherwise gets the reason the entry can't be used
+	static std::unique_ptr<OptimizeCacheEntry> load(llvm::StringRef dir, std::uint64_t key, unsigned numNodes, std::string& error);
+	static std::unique_ptr<OptimizeCacheEntry> load(std::unique_ptr<llvm::MemoryBuffer> buffer, std::uint64_t key, unsigned numNodes, std::string& error);
+
+	// Replace the merges of nodeFactory, the constraints and the location classes with those of the entry
+	void restore(AndersNodeFactory& nodeFactory, std::vector<AndersConstraint>& constraints, llvm::DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses) const;
+};
+
+#endif
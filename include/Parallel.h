@@ -0,0 +1,90 @@
+#ifndef ANDERSEN_PARALLEL_H
+#define ANDERSEN_PARALLEL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Turn a user-requested thread count into the number of threads we actually use. 0 means "one thread per hardware thread"
+inline unsigned getNumWorkerThreads(unsigned requested)
+{
+	if (requested != 0)
+		return requested;
+	unsigned hw = std::thread::hardware_concurrency();
+	return hw == 0 ? 1 : hw;
+}
+
+// A fixed set of worker threads that the parallel phases of an analysis share (see Andersen::getThreadPool()), so that the phases don't each start threads of their own, and the analysis never runs more threads than the pool has, however many tids a phase asks for
+// A run is a batch of tasks, one per tid, that don't wait for each other. The thread that starts a run takes tids as well, and keeps taking those no worker has got to yet rather than wait for them, so a run makes progress on a busy pool, and a run started from within a task can't deadlock
+class AndersThreadPool
+{
+private:
+	struct Run
+	{
+		const std::function<void(unsigned)>& func;
+		unsigned numTids;
+		unsigned nextTid;
+		unsigned numDone;
+	};
+
+	std::vector<std::thread> workers;
+	// The runs that have tids left to take, oldest first. Guarded by mutex, as is everything in the runs
+	std::deque<Run*> runs;
+	std::mutex mutex;
+	std::condition_variable hasWork;
+	std::condition_variable runDone;
+	bool stopping;
+
+	AndersThreadPool(const AndersThreadPool&) = delete;
+	AndersThreadPool& operator=(const AndersThreadPool&) = delete;
+
+	// Take the next tid of run, with mutex held
+	unsigned takeTid(Run& run);
+	void workerLoop();
+public:
+	// numThreads counts the threads that start the runs, so the pool starts one worker fewer
+	AndersThreadPool(unsigned numThreads);
+	~AndersThreadPool();
+
+	unsigned getNumThreads() const { return workers.size() + 1; }
+
+	// Run func(tid) for every tid in [0, numTids) and wait for all of them to finish
+	void run(unsigned numTids, const std::function<void(unsigned)>& func);
+
+	// The pool that runOnThreads() goes through on the calling thread, or nullptr. The workers of a pool go through their own pool
+	static AndersThreadPool* getCurrent();
+	// Make pool the current pool of the calling thread for as long as the object lives
+	class Scope
+	{
+	private:
+		AndersThreadPool* saved;
+	public:
+		Scope(AndersThreadPool* pool);
+		~Scope();
+	};
+};
+
+// Run func(tid) for every tid in [0, numThreads) concurrently and wait for all of them to finish. The calling thread runs tid 0 itself, so numThreads == 1 does not spawn anything. Within an analysis, the tids go to the thread pool of the analysis instead of threads of their own (see AndersThreadPool::Scope), which may run fewer of them at a time
+// This is the only synchronization primitive the parallel phases need: every phase reads shared state and writes thread-private state, and the join at the end acts as the barrier between phases
+template <typename Func>
+void runOnThreads(unsigned numThreads, Func func)
+{
+	if (AndersThreadPool* pool = AndersThreadPool::getCurrent())
+	{
+		pool->run(numThreads, func);
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(numThreads > 0 ? numThreads - 1 : 0);
+	for (unsigned tid = 1; tid < numThreads; ++tid)
+		workers.emplace_back(func, tid);
+	func(0u);
+	for (auto& worker: workers)
+		worker.join();
+}
+
+#endif
@@ -0,0 +1,258 @@
+#ifndef ANDERSEN_PARALLELSCC_H
+#define ANDERSEN_PARALLELSCC_H
+
+#include "GraphTraits.h"
+#include "NodeFactory.h"
+#include "Parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+// Find the strongly connected components of a graph with several threads, by forward-backward decomposition after trimming (Fleischer, Hendrickson and Pinar, "On Identifying Strongly Connected Components in Parallel", IPDPS workshops 2000)
+// The nodes without a predecessor or a successor are trimmed first, since each of them is a component of its own, which gets rid of the long chains the decomposition is slow on. The rest is split up by picking a pivot: the nodes both reachable from it and reaching it are its component, and the nodes only reachable from it, those only reaching it and the others are three sets that no component straddles. They are decomposed in turn, independently of each other, by whichever thread gets to them
+// Each component is named by its smallest node, so the result doesn't depend on the number of threads or on the order the sets are decomposed in. CycleDetector names a component by the node its DFS entered it through instead, so the two only agree on which nodes make a component
+// The graph is copied into arrays on construction and may change afterwards
+class ParallelSCCFinder
+{
+private:
+	// The color of the nodes whose component is known
+	enum: unsigned { Done = 0, FirstColor = 1 };
+
+	// The graph in CSR form, forwards and backwards. Self-loops are left out, since they don't change the components
+	std::vector<unsigned> succBegin, predBegin;
+	std::vector<NodeIndex> succList, predList;
+
+	// The set each node belongs to while the sets are decomposed, or Done. Only the thread that decomposes a set changes the colors of its nodes, but the other threads read them on their searches, hence the atomics. A color is never reused, so such a read can't mistake a node for one of its own
+	std::unique_ptr<std::atomic<unsigned>[]> colors;
+	std::atomic<unsigned> nextColor;
+	// The smallest node of the component of each node
+	std::vector<NodeIndex> reps;
+
+	// A set of nodes of the same color, which may still hold several components
+	struct NodeSet
+	{
+		unsigned color;
+		std::vector<NodeIndex> nodes;
+	};
+
+	unsigned getColor(NodeIndex n) const { return colors[n].load(std::memory_order_relaxed); }
+	void setColor(NodeIndex n, unsigned c) { colors[n].store(c, std::memory_order_relaxed); }
+
+	unsigned getNumNodes() const { return reps.size(); }
+
+	// Trim the nodes that have no predecessor or no successor among the untrimmed nodes, as long as there are any
+	void trim()
+	{
+		unsigned numNodes = getNumNodes();
+		std::vector<unsigned> numPreds(numNodes), numSuccs(numNodes);
+		std::vector<NodeIndex> trimmed;
+		for (NodeIndex n = 0; n < numNodes; ++n)
+		{
+			numPreds[n] = predBegin[n + 1] - predBegin[n];
+			numSuccs[n] = succBegin[n + 1] - succBegin[n];
+			if (numPreds[n] == 0 || numSuccs[n] == 0)
+			{
+				setColor(n, Done);
+				trimmed.push_back(n);
+			}
+		}
+
+		for (unsigned i = 0; i < trimmed.size(); ++i)
+		{
+			NodeIndex n = trimmed[i];
+			reps[n] = n;
+			for (unsigned j = succBegin[n], e = succBegin[n + 1]; j < e; ++j)
+			{
+				NodeIndex succ = succList[j];
+				if (getColor(succ) != Done && --numPreds[succ] == 0)
+				{
+					setColor(succ, Done);
+					trimmed.push_back(succ);
+				}
+			}
+			for (unsigned j = predBegin[n], e = predBegin[n + 1]; j < e; ++j)
+			{
+				NodeIndex pred = predList[j];
+				if (getColor(pred) != Done && --numSuccs[pred] == 0)
+				{
+					setColor(pred, Done);
+					trimmed.push_back(pred);
+				}
+			}
+		}
+	}
+
+	// Find the component of a pivot of set, and put the three sets that are left into newSets. queue is scratch space
+	void decompose(const NodeSet& set, std::vector<NodeSet>& newSets, std::vector<NodeIndex>& queue)
+	{
+		NodeIndex pivot = set.nodes.front();
+		if (set.nodes.size() == 1)
+		{
+			reps[pivot] = pivot;
+			setColor(pivot, Done);
+			return;
+		}
+
+		unsigned fwColor = nextColor.fetch_add(3);
+		unsigned sccColor = fwColor + 1, bwColor = fwColor + 2;
+
+		// The nodes of set reachable from pivot
+		queue.assign(1, pivot);
+		setColor(pivot, fwColor);
+		for (unsigned i = 0; i < queue.size(); ++i)
+		{
+			NodeIndex n = queue[i];
+			for (unsigned j = succBegin[n], e = succBegin[n + 1]; j < e; ++j)
+			{
+				NodeIndex succ = succList[j];
+				if (getColor(succ) == set.color)
+				{
+					setColor(succ, fwColor);
+					queue.push_back(succ);
+				}
+			}
+		}
+
+		// The nodes of set that reach pivot. Those the forward search has reached as well are the component of pivot
+		queue.assign(1, pivot);
+		setColor(pivot, sccColor);
+		for (unsigned i = 0; i < queue.size(); ++i)
+		{
+			NodeIndex n = queue[i];
+			for (unsigned j = predBegin[n], e = predBegin[n + 1]; j < e; ++j)
+			{
+				NodeIndex pred = predList[j];
+				unsigned color = getColor(pred);
+				if (color == fwColor)
+					setColor(pred, sccColor);
+				else if (color == set.color)
+					setColor(pred, bwColor);
+				else
+					continue;
+				queue.push_back(pred);
+			}
+		}
+
+		NodeSet fwSet{fwColor, {}}, bwSet{bwColor, {}}, restSet{set.color, {}};
+		queue.clear();
+		NodeIndex rep = pivot;
+		for (auto n: set.nodes)
+		{
+			unsigned color = getColor(n);
+			if (color == sccColor)
+			{
+				queue.push_back(n);
+				rep = std::min(rep, n);
+			}
+			else if (color == fwColor)
+				fwSet.nodes.push_back(n);
+			else if (color == bwColor)
+				bwSet.nodes.push_back(n);
+			else
+				restSet.nodes.push_back(n);
+		}
+		for (auto n: queue)
+		{
+			reps[n] = rep;
+			setColor(n, Done);
+		}
+
+		for (auto s: {&fwSet, &bwSet, &restSet})
+		{
+			if (!s->nodes.empty())
+				newSets.push_back(std::move(*s));
+		}
+	}
+public:
+	// The node indices of graph must be below numNodes. The nodes of graph iterate over their successors
+	template <class GraphType>
+	ParallelSCCFinder(GraphType& graph, unsigned numNodes): succBegin(numNodes + 1, 0), predBegin(numNodes + 1, 0), colors(new std::atomic<unsigned>[numNodes]), nextColor(FirstColor + 1), reps(numNodes, AndersNodeFactory::InvalidIndex)
+	{
+		typedef AndersGraphTraits<GraphType> GraphTraits;
+		for (auto itr = GraphTraits::node_begin(&graph), ite = GraphTraits::node_end(&graph); itr != ite; ++itr)
+		{
+			NodeIndex src = itr->getNodeIndex();
+			for (NodeIndex dst: *itr)
+			{
+				assert(src < numNodes && dst < numNodes && "Node index out of range!");
+				if (dst == src)
+					continue;
+				++succBegin[src + 1];
+				++predBegin[dst + 1];
+			}
+		}
+		for (unsigned n = 0; n < numNodes; ++n)
+		{
+			succBegin[n + 1] += succBegin[n];
+			predBegin[n + 1] += predBegin[n];
+		}
+
+		succList.resize(succBegin[numNodes]);
+		predList.resize(predBegin[numNodes]);
+		std::vector<unsigned> nextSucc(succBegin.begin(), succBegin.end() - 1), nextPred(predBegin.begin(), predBegin.end() - 1);
+		for (auto itr = GraphTraits::node_begin(&graph), ite = GraphTraits::node_end(&graph); itr != ite; ++itr)
+		{
+			NodeIndex src = itr->getNodeIndex();
+			for (NodeIndex dst: *itr)
+			{
+				if (dst == src)
+					continue;
+				succList[nextSucc[src]++] = dst;
+				predList[nextPred[dst]++] = src;
+			}
+		}
+
+		for (unsigned n = 0; n < numNodes; ++n)
+			setColor(n, FirstColor);
+	}
+
+	// Decompose the sets level by level: the threads share out the sets of a level, and the sets they split them into make the next level
+	void run(unsigned numThreads)
+	{
+		trim();
+
+		std::vector<NodeSet> sets(1, NodeSet{FirstColor, {}});
+		for (NodeIndex n = 0, e = getNumNodes(); n < e; ++n)
+		{
+			if (getColor(n) == FirstColor)
+				sets.front().nodes.push_back(n);
+		}
+		if (sets.front().nodes.empty())
+			return;
+
+		while (!sets.empty())
+		{
+			unsigned numActive = std::min<unsigned>(numThreads, sets.size());
+			std::vector<std::vector<NodeSet>> newSets(numActive);
+			std::atomic<unsigned> nextSet(0);
+			runOnThreads(numActive, [this, &sets, &newSets, &nextSet] (unsigned tid)
+			{
+				std::vector<NodeIndex> queue;
+				while (true)
+				{
+					unsigned i = nextSet.fetch_add(1);
+					if (i >= sets.size())
+						break;
+					decompose(sets[i], newSets[tid], queue);
+				}
+			});
+
+			sets.clear();
+			for (auto& threadSets: newSets)
+				for (auto& set: threadSets)
+					sets.push_back(std::move(set));
+		}
+	}
+
+	// The smallest node of the component of n. It is n itself if n is on no cycle
+	NodeIndex getRep(NodeIndex n) const
+	{
+		assert(n < getNumNodes() && reps[n] != AndersNodeFactory::InvalidIndex);
+		return reps[n];
+	}
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ANDERSEN_PERF_COUNTERS_H
+#define ANDERSEN_PERF_COUNTERS_H
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+
+// The hardware events counted with -anders-perf-counters
+enum AndersPerfEvent
+{
+	PerfCycles,
+	PerfInstructions,
+	PerfLLCMisses,
+	PerfBranchMisses,
+	PerfDTLBMisses,
+	NumPerfEvents
+};
+
+// A short name of the event, e.g. "llc_misses"
+const char* getPerfEventName(AndersPerfEvent event);
+
+// What the counters counted over some stretch of the run. An event the kernel or the hardware doesn't offer has its bit clear in availableMask and counts 0
+struct AndersPerfCounts
+{
+	std::uint64_t values[NumPerfEvents] = {};
+	unsigned availableMask = 0;
+
+	bool isAvailable(AndersPerfEvent event) const { return (availableMask >> event) & 1; }
+	std::uint64_t get(AndersPerfEvent event) const { return values[event]; }
+
+	AndersPerfCounts& operator+=(const AndersPerfCounts& other);
+
+	// One line, e.g. "cycles=1200 instructions=3400 ipc=2.83 llc_misses=12 branch_misses=n/a ..."
+	void print(llvm::raw_ostream& os) const;
+};
+
+// The Linux perf_event counters of the calling thread, counting from the construction in user space only, so that they work under the default perf_event_paranoid. Elsewhere, or where perf_event_open() is refused, no event is available and everything counts 0
+// The worker threads of the parallel phases are not counted. When the kernel has to multiplex the counters, the counts are scaled up to the time the events were enabled
+class AndersPerfCounters
+{
+private:
+	int fds[NumPerfEvents];
+	// The raw readings at the last restart(): the count, and the time the event was enabled and running
+	std::uint64_t base[NumPerfEvents][3];
+
+	void readRaw(unsigned event, std::uint64_t raw[3]) const;
+
+	AndersPerfCounters(const AndersPerfCounters&) = delete;
+	AndersPerfCounters& operator=(const AndersPerfCounters&) = delete;
+public:
+	AndersPerfCounters();
+	~AndersPerfCounters();
+
+	// The counts since the construction or the last restart()
+	AndersPerfCounts read() const;
+	void restart();
+};
+
+#endif
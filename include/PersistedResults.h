@@ -0,0 +1,120 @@
+#ifndef ANDERSEN_PERSISTED_RESULTS_H
+#define ANDERSEN_PERSISTED_RESULTS_H
+
+#include "CompactPtsGraph.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// The solved results of the analysis, saved in a file (see Andersen::writeSolvedResults()) and read back by other processes without running any phase of the analysis
+// The file is a header followed by flat arrays of 32-bit words, so it is used in place: the reader maps it read-only and points into it. The values of the module are identified by their position in a walk of the module (the globals, then the functions, each followed by its arguments and its instructions), which is the same in every process that loads the same module. A hash of the module's layout guards against loading the file for another module
+namespace PersistedResultsFormat
+{
+	enum: std::uint32_t { Magic = 0x52444e41 /* "ANDR" */, Version = 1 };
+	// No node, or no value
+	enum: std::uint32_t { NoEntry = ~0u };
+
+	struct Header
+	{
+		std::uint64_t moduleHash;
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t numValues;
+		std::uint32_t numNodes;
+		std::uint32_t numSets;
+		std::uint32_t numElems;
+		std::uint32_t numClasses;
+		std::uint32_t numClassMembers;
+		std::uint32_t universalPtrNode;
+		std::uint32_t universalObjNode;
+		std::uint32_t nullPtrNode;
+		std::uint32_t nullObjNode;
+	};
+	// The arrays that follow the header, in this order:
+	//   valueNodeOf[numValues]    the value node of each value, or NoEntry
+	//   valueOfNode[numNodes]     the value each node stands for, or NoEntry
+	//   mergeTarget[numNodes]     the representative of each node
+	//   setOfNode[numNodes]       the set id of each node, or NoEntry
+	//   setOffsets[numSets + 1]   where each set starts in elems
+	//   elems[numElems]           the sorted elements of all the sets
+	//   classReps[numClasses]     the representatives of the location equivalence classes, sorted
+	//   classOffsets[numClasses + 1]
+	//   classMembers[numClassMembers]
+
+	// The values of m in the order the file refers to them by
+	void enumerateValues(const llvm::Module& m, std::vector<const llvm::Value*>& values);
+	// The hash of m's layout that the file is checked against
+	std::uint64_t hashModuleLayout(const llvm::Module& m, unsigned numValues);
+}
+
+// A read-only view of a results file. It answers the same points-to and alias queries as Andersen and AndersenAAResult
+class PersistedAndersResults
+{
+private:
+	std::unique_ptr<llvm::MemoryBuffer> buffer;
+	const PersistedResultsFormat::Header* header;
+	const std::uint32_t* valueNodeOf;
+	const std::uint32_t* valueOfNode;
+	const std::uint32_t* mergeTarget;
+	const std::uint32_t* setOfNode;
+	const std::uint32_t* setOffsets;
+	const std::uint32_t* elems;
+	const std::uint32_t* classReps;
+	const std::uint32_t* classOffsets;
+	const std::uint32_t* classMembers;
+
+	// The values of the module, and the position of each of them
+	std::vector<const llvm::Value*> values;
+	llvm::DenseMap<const llvm::Value*, unsigned> valueIds;
+
+	// The reverse of the points-to sets, for getPointedBySet(). It is built on the first call, since most clients never ask
+	struct PointedByIndex
+	{
+		// Map from the id of an object's value to the ids of the sets that have it
+		llvm::DenseMap<unsigned, std::vector<unsigned>> setsOfValue;
+		// The ids of the values that have each set, in id order
+		std::vector<std::vector<unsigned>> pointersOfSet;
+	};
+	mutable std::unique_ptr<PointedByIndex> pointedByIndex;
+	mutable std::once_flag pointedByIndexFlag;
+
+	PersistedAndersResults() = default;
+
+	NodeIndex getValueNodeFor(const llvm::Value* v) const;
+	// Return false if node doesn't have a points-to set
+	bool getPtsSet(NodeIndex node, CompactPtsSet& set) const;
+	// The members of the location equivalence class of rep other than rep itself. The range is empty if rep doesn't stand for a class
+	CompactPtsSet getClassMembers(NodeIndex rep) const;
+	const llvm::Value* getValueForNode(NodeIndex node) const;
+	void buildPointedByIndex() const;
+public:
+	// Return nullptr and put the reason into error if the file can't be used with m
+	static std::unique_ptr<PersistedAndersResults> load(llvm::StringRef fileName, const llvm::Module& m, std::string& error);
+	static std::unique_ptr<PersistedAndersResults> load(std::unique_ptr<llvm::MemoryBuffer> buffer, const llvm::Module& m, std::string& error);
+
+	// See Andersen::getPointsToSet()
+	bool getPointsToSet(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet) const;
+	// See AndersenAAResult::alias(). Like there, v1 and v2 are pointers whose casts have been stripped
+	llvm::AliasResult alias(const llvm::Value* v1, const llvm::Value* v2) const;
+	// See Andersen::getPointedBySet(). The first call builds a reverse index of the sets. Return false if allocSite is not a value of the module
+	bool getPointedBySet(const llvm::Value* allocSite, std::vector<const llvm::Value*>& pointers) const;
+	// See Andersen::getResolvedCallees(). Return false if callInst is not an indirect call the results know, or if it may call any address-taken function
+	bool getResolvedCallees(const llvm::Instruction* callInst, std::vector<const llvm::Function*>& callees) const;
+
+	// The values of the module by their ids in the file (see PersistedResultsFormat::enumerateValues()), and back. getValueId() returns NoEntry for a value that is not in the module
+	unsigned getNumValues() const { return values.size(); }
+	const llvm::Value* getValue(unsigned id) const { return values[id]; }
+	unsigned getValueId(const llvm::Value* v) const;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef ANDERSEN_PHASE_TIMER_H
+#define ANDERSEN_PHASE_TIMER_H
+
+#include "PerfCounters.h"
+
+#include "llvm/Support/Timer.h"
+
+#include <chrono>
+#include <memory>
+
+// The phases of the analysis that are timed separately
+enum class AndersPhase
+{
+	Collection,
+	DeadPointerElim,
+	HVN,
+	HU,
+	LE,
+	OfflineHCD,
+	Steensgaard,
+	GraphBuild,
+	Solving,
+	NumPhases
+};
+
+// Time a phase for as long as the object lives. The timers are in their own group, which -time-passes prints along with the timings of the passes; without -time-passes the timers don't run. Either way the wall time goes into the phase records below and the peak RSS of the process at the end of the phase goes into the statistics (-stats), so that a look at them tells which phase the memory went to
+// With -anders-perf-counters, the phase is also measured with the hardware counters, which go into the phase records and are printed to stderr at its end
+// The timers accumulate, so a phase that runs more than once (HVN and HU under -enable-hru, the collection under Andersen::updateFunctions()) reports its total
+class AndersPhaseTimer
+{
+private:
+	AndersPhase phase;
+	llvm::TimeRegion region;
+	std::chrono::steady_clock::time_point start;
+	std::unique_ptr<AndersPerfCounters> counters;
+
+	AndersPhaseTimer(const AndersPhaseTimer&) = delete;
+	AndersPhaseTimer& operator=(const AndersPhaseTimer&) = delete;
+public:
+	AndersPhaseTimer(AndersPhase p);
+	~AndersPhaseTimer();
+};
+
+// What the timers have recorded for a phase since the last resetPhaseRecords(), whether or not -time-passes is given: the wall time spent in it, the peak RSS of the process (in KB) at the end of its last run, and with -anders-perf-counters the hardware counts of all its runs. The records are shared by the whole process, so they only make sense when one analysis runs at a time (as in andersen-bench)
+struct AndersPhaseRecord
+{
+	double wallTime = 0;
+	unsigned peakRSS = 0;
+	AndersPerfCounts counters;
+};
+const AndersPhaseRecord& getPhaseRecord(AndersPhase phase);
+void resetPhaseRecords();
+// A short name of the phase, e.g. "offline-hcd"
+const char* getPhaseName(AndersPhase phase);
+// The high-water mark of the resident set of the process so far, in KB (0 where the system can't tell)
+unsigned getProcessPeakRSS();
+
+#endif
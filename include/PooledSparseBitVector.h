@@ -0,0 +1,337 @@
+#ifndef ANDERSEN_POOLEDSPARSEBITVECTOR_H
+#define ANDERSEN_POOLEDSPARSEBITVECTOR_H
+
+#include "llvm/Support/MathExtras.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// A slab allocator for the elements of the PooledSparseBitVectors of one phase. Elements are carved out of slabs of ElementsPerSlab and recycled through a free list, so building and tearing down the sets of an optimizer never goes to the global heap once the slabs are there. reset() gives all the slabs back at once
+// The arena is not thread-safe unless setConcurrent(true) has been called, in which case every allocation and deallocation takes a lock
+class SparseBitVectorArena
+{
+public:
+	// 128 bits, like the elements of llvm::SparseBitVector<>
+	struct Element
+	{
+		static const unsigned NumWords = 2;
+		static const unsigned NumBits = NumWords * 64;
+
+		Element* next;
+		unsigned index;
+		uint64_t words[NumWords];
+	};
+private:
+	static const unsigned ElementsPerSlab = 256;
+
+	std::vector<std::unique_ptr<Element[]>> slabs;
+	// The number of elements of the last slab that have been handed out
+	unsigned numUsedInSlab;
+	Element* freeList;
+	unsigned numLive;
+
+	std::mutex mutex;
+	bool concurrent;
+
+	Element* allocateLocked()
+	{
+		++numLive;
+		if (freeList != nullptr)
+		{
+			Element* ret = freeList;
+			freeList = freeList->next;
+			return ret;
+		}
+		if (slabs.empty() || numUsedInSlab == ElementsPerSlab)
+		{
+			slabs.emplace_back(new Element[ElementsPerSlab]);
+			numUsedInSlab = 0;
+		}
+		return &slabs.back()[numUsedInSlab++];
+	}
+
+	SparseBitVectorArena(const SparseBitVectorArena&) = delete;
+	SparseBitVectorArena& operator=(const SparseBitVectorArena&) = delete;
+public:
+	SparseBitVectorArena(): numUsedInSlab(0), freeList(nullptr), numLive(0), concurrent(false) {}
+
+	void setConcurrent(bool c) { concurrent = c; }
+
+	Element* allocate()
+	{
+		if (!concurrent)
+			return allocateLocked();
+		std::lock_guard<std::mutex> guard(mutex);
+		return allocateLocked();
+	}
+
+	// Put the list of elements that starts at first back on the free list
+	void deallocateList(Element* first)
+	{
+		if (first == nullptr)
+			return;
+		Element* last = first;
+		unsigned n = 1;
+		for (; last->next != nullptr; last = last->next)
+			++n;
+
+		std::unique_lock<std::mutex> guard(mutex, std::defer_lock);
+		if (concurrent)
+			guard.lock();
+		last->next = freeList;
+		freeList = first;
+		numLive -= n;
+	}
+
+	// Free all the slabs. No vector may still have elements from this arena
+	void reset()
+	{
+		assert(numLive == 0 && "A vector still uses the arena!");
+		std::vector<std::unique_ptr<Element[]>>().swap(slabs);
+		numUsedInSlab = 0;
+		freeList = nullptr;
+	}
+
+	// The number of elements that are in use, and the number of slabs they are carved out of
+	unsigned getNumLiveElements() const { return numLive; }
+	unsigned getNumSlabs() const { return slabs.size(); }
+	// The slabs, whether their elements are in use or not
+	std::size_t getMemoryUsage() const { return slabs.size() * ElementsPerSlab * sizeof(Element) + slabs.capacity() * sizeof(slabs[0]); }
+};
+
+// A sparse bit vector laid out like llvm::SparseBitVector<> (a sorted list of 128-bit elements), whose elements come from a SparseBitVectorArena instead of the global heap. It only has the operations the offline optimizations need
+// A copy takes its elements from the arena of the original. Vectors that are assigned to each other may belong to different arenas
+class PooledSparseBitVector
+{
+private:
+	typedef SparseBitVectorArena::Element Element;
+
+	SparseBitVectorArena* arena;
+	Element* head;
+	// The element set() and test_and_set() touched last, where the next search starts if it can. Elements are only reachable forwards, so a cursor past the bit restarts from the head
+	Element* cursor;
+
+	static unsigned getElementIndex(unsigned idx) { return idx / Element::NumBits; }
+
+	Element* newElement(unsigned index, Element* next)
+	{
+		Element* e = arena->allocate();
+		e->next = next;
+		e->index = index;
+		for (unsigned i = 0; i < Element::NumWords; ++i)
+			e->words[i] = 0;
+		return e;
+	}
+
+	void copyFrom(const PooledSparseBitVector& other)
+	{
+		Element** link = &head;
+		for (const Element* e = other.head; e != nullptr; e = e->next)
+		{
+			*link = newElement(e->index, nullptr);
+			for (unsigned i = 0; i < Element::NumWords; ++i)
+				(*link)->words[i] = e->words[i];
+			link = &(*link)->next;
+		}
+	}
+
+	// Return the link to the element with the given index, or to where it would be inserted, starting the search from link
+	static Element** findLinkFrom(Element** link, unsigned index)
+	{
+		while (*link != nullptr && (*link)->index < index)
+			link = &(*link)->next;
+		return link;
+	}
+public:
+	// Iterate over the set bits in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		const Element* elem;
+		unsigned bit;
+
+		// Move to the first set bit at or after bit, in this element or a later one
+		void settle()
+		{
+			for (; elem != nullptr; elem = elem->next, bit = 0)
+			{
+				for (unsigned w = bit / 64; w < Element::NumWords; ++w)
+				{
+					uint64_t word = elem->words[w];
+					if (w == bit / 64)
+						word &= ~uint64_t(0) << (bit % 64);
+					if (word != 0)
+					{
+						bit = w * 64 + llvm::countTrailingZeros(word);
+						return;
+					}
+				}
+			}
+			bit = 0;
+		}
+	public:
+		iterator(const Element* e): elem(e), bit(0) { settle(); }
+
+		bool operator==(const iterator& other) const { return elem == other.elem && bit == other.bit; }
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return elem->index * Element::NumBits + bit; }
+
+		iterator& operator++()
+		{
+			if (++bit == Element::NumBits)
+			{
+				elem = elem->next;
+				bit = 0;
+			}
+			settle();
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	explicit PooledSparseBitVector(SparseBitVectorArena& a): arena(&a), head(nullptr), cursor(nullptr) {}
+	PooledSparseBitVector(const PooledSparseBitVector& other): arena(other.arena), head(nullptr), cursor(nullptr)
+	{
+		copyFrom(other);
+	}
+	PooledSparseBitVector(PooledSparseBitVector&& other) noexcept: arena(other.arena), head(other.head), cursor(other.cursor)
+	{
+		other.head = other.cursor = nullptr;
+	}
+	PooledSparseBitVector& operator=(const PooledSparseBitVector& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			copyFrom(other);
+		}
+		return *this;
+	}
+	PooledSparseBitVector& operator=(PooledSparseBitVector&& other)
+	{
+		if (this == &other)
+			return *this;
+		if (arena != other.arena)
+			return *this = static_cast<const PooledSparseBitVector&>(other);
+		clear();
+		head = other.head;
+		other.head = other.cursor = nullptr;
+		return *this;
+	}
+	~PooledSparseBitVector()
+	{
+		clear();
+	}
+
+	bool test(unsigned idx) const
+	{
+		unsigned index = getElementIndex(idx);
+		const Element* e = head;
+		while (e != nullptr && e->index < index)
+			e = e->next;
+		return e != nullptr && e->index == index && (e->words[idx % Element::NumBits / 64] >> (idx % 64) & 1);
+	}
+
+	// Return true if idx was not set before
+	bool test_and_set(unsigned idx)
+	{
+		unsigned index = getElementIndex(idx);
+		if (cursor == nullptr || cursor->index != index)
+		{
+			Element** link = findLinkFrom((cursor != nullptr && cursor->index < index) ? &cursor->next : &head, index);
+			if (*link == nullptr || (*link)->index != index)
+				*link = newElement(index, *link);
+			cursor = *link;
+		}
+		uint64_t& word = cursor->words[idx % Element::NumBits / 64];
+		uint64_t mask = uint64_t(1) << (idx % 64);
+		if (word & mask)
+			return false;
+		word |= mask;
+		return true;
+	}
+	void set(unsigned idx)
+	{
+		test_and_set(idx);
+	}
+
+	// Return true if *this changes
+	bool operator|=(const PooledSparseBitVector& other)
+	{
+		if (this == &other)
+			return false;
+		bool changed = false;
+		Element** link = &head;
+		for (const Element* e = other.head; e != nullptr; e = e->next)
+		{
+			link = findLinkFrom(link, e->index);
+			if (*link == nullptr || (*link)->index != e->index)
+			{
+				*link = newElement(e->index, *link);
+				for (unsigned i = 0; i < Element::NumWords; ++i)
+					(*link)->words[i] = e->words[i];
+				changed = true;
+			}
+			else
+			{
+				for (unsigned i = 0; i < Element::NumWords; ++i)
+				{
+					uint64_t merged = (*link)->words[i] | e->words[i];
+					changed |= merged != (*link)->words[i];
+					(*link)->words[i] = merged;
+				}
+			}
+			link = &(*link)->next;
+		}
+		return changed;
+	}
+
+	// Elements are never empty, so equal vectors have the same elements
+	bool operator==(const PooledSparseBitVector& other) const
+	{
+		const Element* e1 = head;
+		const Element* e2 = other.head;
+		for (; e1 != nullptr && e2 != nullptr; e1 = e1->next, e2 = e2->next)
+		{
+			if (e1->index != e2->index)
+				return false;
+			for (unsigned i = 0; i < Element::NumWords; ++i)
+				if (e1->words[i] != e2->words[i])
+					return false;
+		}
+		return e1 == e2;
+	}
+	bool operator!=(const PooledSparseBitVector& other) const { return !(*this == other); }
+
+	bool empty() const { return head == nullptr; }
+	unsigned count() const
+	{
+		unsigned ret = 0;
+		for (const Element* e = head; e != nullptr; e = e->next)
+			for (unsigned i = 0; i < Element::NumWords; ++i)
+				ret += llvm::countPopulation(e->words[i]);
+		return ret;
+	}
+
+	void clear()
+	{
+		arena->deallocateList(head);
+		head = cursor = nullptr;
+	}
+
+	iterator begin() const { return iterator(head); }
+	iterator end() const { return iterator(nullptr); }
+};
+
+#endif
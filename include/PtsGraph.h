@@ -0,0 +1,143 @@
+#ifndef ANDERSEN_PTSGRAPH_H
+#define ANDERSEN_PTSGRAPH_H
+
+#include "NodeFactory.h"
+#include "PtsSet.h"
+
+#include "llvm/ADT/BitVector.h"
+
+#include <cassert>
+#include <iterator>
+#include <vector>
+
+class PtsSetSpillFile;
+
+// The points-to graph, i.e. a mapping from NodeIndex to AndersPtsSet
+// NodeIndex values are dense integers handed out by AndersNodeFactory, so we store the sets in a flat vector indexed by NodeIndex rather than in a tree. A side bitmap remembers which nodes actually have a set: a node that has never been given a set (e.g. an undefined pointer) is different from a node whose set happens to be empty
+// Note that, just like std::vector, growing the graph invalidates all references to the sets inside it. Clients who want to hold a reference across an insertion should call resize() with the final number of nodes first
+// A graph can have some of its sets in a PtsSetSpillFile (see PtsSetSpill.h). Such a set still counts as there, and is read back by the first lookup that reaches it, including the const ones; the sets are mutable for that reason. The file is only used by the sequential solver, so the lookups never race
+class AndersPtsGraph
+{
+private:
+	mutable std::vector<AndersPtsSet> sets;
+	llvm::BitVector hasSet;
+	// The nodes whose sets are in spillFile, which is null unless the graph has been spilled into
+	PtsSetSpillFile* spillFile = nullptr;
+	mutable llvm::BitVector spilled;
+
+	// Defined in PtsSetSpill.cpp
+	void readSpilled(NodeIndex idx) const;
+	void dropSpilled(NodeIndex idx);
+
+	friend class PtsSetSpillFile;
+public:
+	// Iterate over the NodeIndex of all nodes that have a points-to set, in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, NodeIndex>
+	{
+	private:
+		const llvm::BitVector* bits;
+		int curr;
+	public:
+		iterator(const llvm::BitVector* b, int c): bits(b), curr(c) {}
+
+		bool operator==(const iterator& other) const { return curr == other.curr; }
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		NodeIndex operator*() const { return curr; }
+
+		iterator& operator++()
+		{
+			curr = bits->find_next(curr);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	AndersPtsGraph() {}
+
+	// Make sure that all nodes with index less than numNodes can be accessed without reallocation
+	void resize(unsigned numNodes)
+	{
+		if (numNodes > sets.size())
+		{
+			sets.resize(numNodes);
+			hasSet.resize(numNodes);
+		}
+	}
+
+	// Return the points-to set of idx, creating an empty one if idx does not have a set yet
+	AndersPtsSet& operator[](NodeIndex idx)
+	{
+		if (idx >= sets.size())
+			resize(idx + 1);
+		if (isSpilled(idx))
+			readSpilled(idx);
+		hasSet.set(idx);
+		return sets[idx];
+	}
+
+	// Return nullptr if idx does not have a points-to set
+	AndersPtsSet* find(NodeIndex idx)
+	{
+		if (!count(idx))
+			return nullptr;
+		if (isSpilled(idx))
+			readSpilled(idx);
+		return &sets[idx];
+	}
+	const AndersPtsSet* find(NodeIndex idx) const
+	{
+		if (!count(idx))
+			return nullptr;
+		if (isSpilled(idx))
+			readSpilled(idx);
+		return &sets[idx];
+	}
+
+	// Return true if the set of idx is in a PtsSetSpillFile, and empty here until it is looked up
+	bool isSpilled(NodeIndex idx) const { return spillFile != nullptr && idx < spilled.size() && spilled.test(idx); }
+
+	bool count(NodeIndex idx) const
+	{
+		return idx < hasSet.size() && hasSet.test(idx);
+	}
+
+	void erase(NodeIndex idx)
+	{
+		if (!count(idx))
+			return;
+		if (isSpilled(idx))
+			dropSpilled(idx);
+		sets[idx].clear();
+		hasSet.reset(idx);
+	}
+
+	void clear()
+	{
+		assert(spillFile == nullptr && "The spilled sets would be left in the file");
+		sets.clear();
+		hasSet.clear();
+	}
+
+	// Number of nodes that have a points-to set
+	unsigned getSize() const { return hasSet.count(); }
+
+	// The sets, with what their elements take on the heap and the storage the sets share, if any (see MemoryUsage.h)
+	std::size_t getMemoryUsage() const
+	{
+		std::size_t ret = getVectorMemoryUsage(sets) + hasSet.getMemorySize() + AndersPtsSet::getSharedMemoryUsage();
+		for (auto const& ptsSet: sets)
+			ret += ptsSet.getMemoryUsage();
+		return ret;
+	}
+
+	iterator begin() const { return iterator(&hasSet, hasSet.find_first()); }
+	iterator end() const { return iterator(&hasSet, -1); }
+};
+
+#endif
@@ -1,76 +1,161 @@
 #ifndef ANDERSEN_PTSSET_H
 #define ANDERSEN_PTSSET_H
 
-#include "llvm/ADT/SparseBitVector.h"
+#include "PtsSetPolicies.h"
+
+#include <algorithm>
+#include <cstdint>
 
 // We move the points-to set representation here into a separate class
 // The intention is to let us try out different internal implementation of this data-structure (e.g. vectors/bitvecs/sets, ref-counted/non-refcounted) easily
-class AndersPtsSet
+// BasicAndersPtsSet is a thin facade over the policy that actually stores the set (see PtsSetPolicies.h). Everything is resolved at compile time, so none of the calls below is virtual
+// The null object is not stored in the policy but in a flag next to it. It ends up in a large share of the sets, where a bit OR is all it takes to carry it along. has(), insert() and the iterators only deal with the other elements; the set operations and the size take the flag into account
+// Next to the policy, every set keeps a summary of its elements: their number, the smallest and the largest, and a 64-bit signature with one bit per element (a Bloom filter with a single hash). Most intersection tests of the alias queries and most equality tests of LCD come out negative, and the summaries usually show it without walking the elements. The summary is updated by every change, so getSize() is constant time. The policy brings the number of elements up to date as part of a union (see PtsSetPolicies.h), so only the policies whose containers can't tell what an OR added count the set again
+template <class Policy>
+class BasicAndersPtsSet
 {
 private:
-	llvm::SparseBitVector<> bitvec;
+	Policy impl;
+	bool nullObject = false;
+	unsigned numElems = 0;
+	unsigned minElem = ~0u, maxElem = 0;
+	std::uint64_t signature = 0;
+
+	// Fibonacci hashing, so that the neighbouring objects of an allocation site get bits far apart
+	static std::uint64_t getSignatureBit(unsigned idx) { return std::uint64_t(1) << ((idx * 0x9E3779B9u) >> 26); }
+	void addToSummary(unsigned idx)
+	{
+		minElem = std::min(minElem, idx);
+		maxElem = std::max(maxElem, idx);
+		signature |= getSignatureBit(idx);
+	}
+	void resetSummary()
+	{
+		numElems = 0;
+		minElem = ~0u;
+		maxElem = 0;
+		signature = 0;
+	}
 public:
-	using iterator = llvm::SparseBitVector<>::iterator;
+	typedef typename Policy::iterator iterator;
+
+	bool hasNullObject() const
+	{
+		return nullObject;
+	}
+	// Return true if the ptsset changes
+	bool insertNullObject()
+	{
+		bool changed = !nullObject;
+		nullObject = true;
+		return changed;
+	}
 
 	// Return true if *this has idx as an element
-	// This function should be marked const, but we cannot do it because SparseBitVector::test() is not marked const. WHY???
 	bool has(unsigned idx)
 	{
-		return bitvec.test(idx);
+		return impl.has(idx);
 	}
 	bool has(unsigned idx) const
 	{
-		// Since llvm::SparseBitVector::test() does not have a const quantifier, we have to use this ugly workaround to implement has()
-		llvm::SparseBitVector<> idVec;
-		idVec.set(idx);
-		return bitvec.contains(idVec);
+		return impl.has(idx);
 	}
 
 	// Return true if the ptsset changes
 	bool insert(unsigned idx)
 	{
-		return bitvec.test_and_set(idx);
+		if (!impl.insert(idx))
+			return false;
+		++numElems;
+		addToSummary(idx);
+		return true;
 	}
 
 	// Return true if *this is a superset of other
-	bool contains(const AndersPtsSet& other) const
+	bool contains(const BasicAndersPtsSet& other) const
 	{
-		return bitvec.contains(other.bitvec);
+		if (other.nullObject && !nullObject)
+			return false;
+		if (other.numElems == 0)
+			return true;
+		if (other.numElems > numElems || other.minElem < minElem || other.maxElem > maxElem || (other.signature & ~signature) != 0)
+			return false;
+		return impl.contains(other.impl);
 	}
 
 	// intersectWith: return true if *this and other share points-to elements
-	bool intersectWith(const AndersPtsSet& other) const
+	bool intersectWith(const BasicAndersPtsSet& other) const
 	{
-		return bitvec.intersects(other.bitvec);
+		if (nullObject && other.nullObject)
+			return true;
+		if (numElems == 0 || other.numElems == 0 || (signature & other.signature) == 0 || maxElem < other.minElem || other.maxElem < minElem)
+			return false;
+		return impl.intersectWith(other.impl);
 	}
 
 	// Return true if the ptsset changes
-	bool unionWith(const AndersPtsSet& other)
+	bool unionWith(const BasicAndersPtsSet& other)
+	{
+		bool changed = other.nullObject && !nullObject;
+		nullObject |= other.nullObject;
+		if (other.numElems == 0 || !impl.unionWith(other.impl, numElems))
+			return changed;
+		minElem = std::min(minElem, other.minElem);
+		maxElem = std::max(maxElem, other.maxElem);
+		signature |= other.signature;
+		return true;
+	}
+
+	// Make *this the set of elements that are in lhs but not in rhs
+	void assignDifference(const BasicAndersPtsSet& lhs, const BasicAndersPtsSet& rhs)
 	{
-		return bitvec |= other.bitvec;
+		impl.assignDifference(lhs.impl, rhs.impl);
+		nullObject = lhs.nullObject && !rhs.nullObject;
+		// Removing elements can't be done on the signature, so the summary is taken again, which costs about what the difference did
+		resetSummary();
+		for (auto idx: impl)
+		{
+			++numElems;
+			addToSummary(idx);
+		}
 	}
 
 	void clear()
 	{
-		bitvec.clear();
+		impl.clear();
+		nullObject = false;
+		resetSummary();
 	}
 
 	unsigned getSize() const
 	{
-		return bitvec.count();		// NOT a constant time operation!
+		return numElems + nullObject;
 	}
-	bool isEmpty() const		// Always prefer using this function to perform empty test 
+	bool isEmpty() const		// Always prefer using this function to perform empty test
 	{
-		return bitvec.empty();
+		return !nullObject && numElems == 0;
 	}
 
-	bool operator==(const AndersPtsSet& other) const
+	bool operator==(const BasicAndersPtsSet& other) const
 	{
-		return bitvec == other.bitvec;
+		if (nullObject != other.nullObject || numElems != other.numElems || signature != other.signature || minElem != other.minElem || maxElem != other.maxElem)
+			return false;
+		return impl == other.impl;
 	}
 
-	iterator begin() const { return bitvec.begin(); }
-	iterator end() const { return bitvec.end(); }
+	// See PtsSetPolicies.h
+	std::size_t getMemoryUsage() const { return impl.getMemoryUsage(); }
+	static std::size_t getSharedMemoryUsage() { return Policy::getSharedMemoryUsage(); }
+
+	iterator begin() const { return impl.begin(); }
+	iterator end() const { return impl.end(); }
 };
 
+// The policy the whole analysis is built with. It is chosen at build time (see ANDERSEN_PTS_SET in CMakeLists.txt)
+#ifndef ANDERSEN_PTS_SET_POLICY
+#define ANDERSEN_PTS_SET_POLICY SparseBitVectorPtsSetPolicy
+#endif
+
+typedef BasicAndersPtsSet<ANDERSEN_PTS_SET_POLICY> AndersPtsSet;
+
 #endif
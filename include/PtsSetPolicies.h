@@ -0,0 +1,950 @@
+#ifndef ANDERSEN_PTSSETPOLICIES_H
+#define ANDERSEN_PTSSETPOLICIES_H
+
+#include "Bdd.h"
+#include "BlockBitVector.h"
+#include "MemoryUsage.h"
+#include "PtsSetPool.h"
+#include "RoaringBitmap.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/SparseBitVector.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+// The implementations (policies) that AndersPtsSet can be instantiated with. Each policy is a value type that offers the same set of operations as AndersPtsSet itself (see PtsSet.h) and defines its own iterator type
+// getMemoryUsage() is the heap memory of one set, and getSharedMemoryUsage() that of the storage all the sets of the policy share, if it has any (see MemoryUsage.h)
+// unionWith() is also given the number of elements of the set, and brings it up to date, so that AndersPtsSet keeps its size without counting the set again. Most policies count the elements they add as they merge. llvm::SparseBitVector and llvm::BitVector don't say how many bits an OR sets, and a BDD apply doesn't either, so the policies built on them count the result instead
+
+// One llvm::SparseBitVector per set
+class SparseBitVectorPtsSetPolicy
+{
+private:
+	llvm::SparseBitVector<> bitvec;
+public:
+	using iterator = llvm::SparseBitVector<>::iterator;
+
+	// Return true if *this has idx as an element
+	// This function should be marked const, but we cannot do it because SparseBitVector::test() is not marked const. WHY???
+	bool has(unsigned idx)
+	{
+		return bitvec.test(idx);
+	}
+	// SparseBitVector::test() moves a cursor inside the vector, so several threads can't call it on the same set. This walks the elements up to idx instead, which allocates and writes nothing. The objects the solver looks for in a const set are the special ones, which come first
+	bool has(unsigned idx) const
+	{
+		for (auto elem: bitvec)
+		{
+			if (elem >= idx)
+				return elem == idx;
+		}
+		return false;
+	}
+
+	// Return true if the ptsset changes
+	bool insert(unsigned idx)
+	{
+		return bitvec.test_and_set(idx);
+	}
+
+	// Return true if *this is a superset of other
+	bool contains(const SparseBitVectorPtsSetPolicy& other) const
+	{
+		return bitvec.contains(other.bitvec);
+	}
+
+	// intersectWith: return true if *this and other share points-to elements
+	bool intersectWith(const SparseBitVectorPtsSetPolicy& other) const
+	{
+		return bitvec.intersects(other.bitvec);
+	}
+
+	// Return true if the ptsset changes
+	bool unionWith(const SparseBitVectorPtsSetPolicy& other, unsigned& size)
+	{
+		if (!(bitvec |= other.bitvec))
+			return false;
+		size = bitvec.count();
+		return true;
+	}
+
+	// Make *this the set of elements that are in lhs but not in rhs
+	void assignDifference(const SparseBitVectorPtsSetPolicy& lhs, const SparseBitVectorPtsSetPolicy& rhs)
+	{
+		bitvec.intersectWithComplement(lhs.bitvec, rhs.bitvec);
+	}
+
+	void clear()
+	{
+		bitvec.clear();
+	}
+
+	unsigned getSize() const
+	{
+		return bitvec.count();		// NOT a constant time operation!
+	}
+	bool isEmpty() const		// Always prefer using this function to perform empty test 
+	{
+		return bitvec.empty();
+	}
+
+	bool operator==(const SparseBitVectorPtsSetPolicy& other) const
+	{
+		return bitvec == other.bitvec;
+	}
+
+	std::size_t getMemoryUsage() const { return getSparseBitVectorMemoryUsage(bitvec); }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return bitvec.begin(); }
+	iterator end() const { return bitvec.end(); }
+};
+
+// A sorted vector of elements. Most pointers point to one or two objects; for those, this is much smaller than a SparseBitVector, whose elements cost over 40 bytes each. All the operations are linear merges, so it degrades quickly on large sets (see HybridPtsSetPolicy)
+class SmallVectorPtsSetPolicy
+{
+private:
+	typedef llvm::SmallVector<unsigned, 8> ElemVec;
+	ElemVec elems;
+public:
+	typedef ElemVec::const_iterator iterator;
+
+	bool has(unsigned idx) const
+	{
+		return std::binary_search(elems.begin(), elems.end(), idx);
+	}
+
+	bool insert(unsigned idx)
+	{
+		auto itr = std::lower_bound(elems.begin(), elems.end(), idx);
+		if (itr != elems.end() && *itr == idx)
+			return false;
+		elems.insert(itr, idx);
+		return true;
+	}
+
+	bool contains(const SmallVectorPtsSetPolicy& other) const
+	{
+		return std::includes(elems.begin(), elems.end(), other.elems.begin(), other.elems.end());
+	}
+
+	bool intersectWith(const SmallVectorPtsSetPolicy& other) const
+	{
+		auto itr1 = elems.begin(), ite1 = elems.end();
+		auto itr2 = other.elems.begin(), ite2 = other.elems.end();
+		while (itr1 != ite1 && itr2 != ite2)
+		{
+			if (*itr1 < *itr2)
+				++itr1;
+			else if (*itr2 < *itr1)
+				++itr2;
+			else
+				return true;
+		}
+		return false;
+	}
+
+	bool unionWith(const SmallVectorPtsSetPolicy& other, unsigned& size)
+	{
+		if (other.elems.empty() || contains(other))
+			return false;
+		ElemVec result;
+		result.reserve(elems.size() + other.elems.size());
+		std::set_union(elems.begin(), elems.end(), other.elems.begin(), other.elems.end(), std::back_inserter(result));
+		elems.swap(result);
+		size = elems.size();
+		return true;
+	}
+
+	void assignDifference(const SmallVectorPtsSetPolicy& lhs, const SmallVectorPtsSetPolicy& rhs)
+	{
+		ElemVec result;
+		std::set_difference(lhs.elems.begin(), lhs.elems.end(), rhs.elems.begin(), rhs.elems.end(), std::back_inserter(result));
+		elems.swap(result);
+	}
+
+	void clear()
+	{
+		elems.clear();
+	}
+
+	unsigned getSize() const
+	{
+		return elems.size();
+	}
+	bool isEmpty() const
+	{
+		return elems.empty();
+	}
+
+	bool operator==(const SmallVectorPtsSetPolicy& other) const
+	{
+		return elems == other.elems;
+	}
+
+	// The first 8 elements are stored in place
+	std::size_t getMemoryUsage() const { return elems.capacity() > 8 ? elems.capacity_in_bytes() : 0; }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return elems.begin(); }
+	iterator end() const { return elems.end(); }
+};
+
+// A plain bitvector, as long as the largest element. Memory is proportional to the number of nodes rather than to the size of the set, which pays off for graphs where pointers point to a large fraction of all objects
+class DenseBitVectorPtsSetPolicy
+{
+private:
+	llvm::BitVector bits;
+public:
+	// Iterate over the set bits in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		const llvm::BitVector* bits;
+		int curr;
+	public:
+		iterator(const llvm::BitVector* b, int c): bits(b), curr(c) {}
+
+		bool operator==(const iterator& other) const { return curr == other.curr; }
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return curr; }
+
+		iterator& operator++()
+		{
+			curr = bits->find_next(curr);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	bool has(unsigned idx) const
+	{
+		return idx < bits.size() && bits.test(idx);
+	}
+
+	bool insert(unsigned idx)
+	{
+		if (idx >= bits.size())
+			bits.resize(idx + 1);
+		if (bits.test(idx))
+			return false;
+		bits.set(idx);
+		return true;
+	}
+
+	bool contains(const DenseBitVectorPtsSetPolicy& other) const
+	{
+		// BitVector::test(RHS) checks whether (*this - RHS) is non-empty
+		return !other.bits.test(bits);
+	}
+
+	bool intersectWith(const DenseBitVectorPtsSetPolicy& other) const
+	{
+		return bits.anyCommon(other.bits);
+	}
+
+	bool unionWith(const DenseBitVectorPtsSetPolicy& other, unsigned& size)
+	{
+		if (!other.bits.test(bits))
+			return false;
+		if (bits.size() < other.bits.size())
+			bits.resize(other.bits.size());
+		bits |= other.bits;
+		size = bits.count();
+		return true;
+	}
+
+	void assignDifference(const DenseBitVectorPtsSetPolicy& lhs, const DenseBitVectorPtsSetPolicy& rhs)
+	{
+		bits = lhs.bits;
+		bits.reset(rhs.bits);
+	}
+
+	void clear()
+	{
+		bits.clear();
+	}
+
+	unsigned getSize() const
+	{
+		return bits.count();
+	}
+	bool isEmpty() const
+	{
+		return bits.none();
+	}
+
+	// The two vectors may have different lengths
+	bool operator==(const DenseBitVectorPtsSetPolicy& other) const
+	{
+		return !bits.test(other.bits) && !other.bits.test(bits);
+	}
+
+	std::size_t getMemoryUsage() const { return bits.getMemorySize(); }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return iterator(&bits, bits.find_first()); }
+	iterator end() const { return iterator(&bits, -1); }
+};
+
+// A flat bitvector in blocks of a cache line, with a summary of the non-empty blocks (see BlockBitVector.h). Like DenseBitVectorPtsSetPolicy it is meant for object-heavy graphs, but the operations skip the empty blocks and run on SIMD registers where the target has them
+class BlockBitVectorPtsSetPolicy
+{
+private:
+	AndersBlockBitVector bits;
+public:
+	// Iterate over the set bits in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		const AndersBlockBitVector* bits;
+		int curr;
+	public:
+		iterator(const AndersBlockBitVector* b, int c): bits(b), curr(c) {}
+
+		bool operator==(const iterator& other) const { return curr == other.curr; }
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return curr; }
+
+		iterator& operator++()
+		{
+			curr = bits->findNext(curr + 1);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	bool has(unsigned idx) const
+	{
+		return bits.test(idx);
+	}
+
+	bool insert(unsigned idx)
+	{
+		return bits.testAndSet(idx);
+	}
+
+	bool contains(const BlockBitVectorPtsSetPolicy& other) const
+	{
+		return bits.contains(other.bits);
+	}
+
+	bool intersectWith(const BlockBitVectorPtsSetPolicy& other) const
+	{
+		return bits.intersects(other.bits);
+	}
+
+	bool unionWith(const BlockBitVectorPtsSetPolicy& other, unsigned& size)
+	{
+		unsigned gained = bits.unionWith(other.bits);
+		size += gained;
+		return gained != 0;
+	}
+
+	void assignDifference(const BlockBitVectorPtsSetPolicy& lhs, const BlockBitVectorPtsSetPolicy& rhs)
+	{
+		bits.assignDifference(lhs.bits, rhs.bits);
+	}
+
+	void clear()
+	{
+		bits.clear();
+	}
+
+	unsigned getSize() const
+	{
+		return bits.count();
+	}
+	bool isEmpty() const
+	{
+		return bits.empty();
+	}
+
+	bool operator==(const BlockBitVectorPtsSetPolicy& other) const
+	{
+		return bits == other.bits;
+	}
+
+	std::size_t getMemoryUsage() const { return bits.getMemoryUsage(); }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return iterator(&bits, bits.findNext(0)); }
+	iterator end() const { return iterator(&bits, -1); }
+};
+
+// The sorted vector for small sets, and a SparseBitVector once the set grows beyond Threshold elements. A set is small if and only if it has no more than Threshold elements, so two sets can only be equal if they use the same representation
+class HybridPtsSetPolicy
+{
+private:
+	static const unsigned Threshold = 8;
+
+	SmallVectorPtsSetPolicy small;
+	SparseBitVectorPtsSetPolicy big;
+	bool isBig;
+
+	// Move the contents of small into big
+	void grow()
+	{
+		for (auto idx: small)
+			big.insert(idx);
+		small.clear();
+		isBig = true;
+	}
+
+	// Move the contents of big back into small
+	void shrink()
+	{
+		for (auto idx: big)
+			small.insert(idx);
+		big.clear();
+		isBig = false;
+	}
+
+	// Return true if big has every element of the sorted range [first, last), or any of them if matchAny is set. The two are walked side by side, without SparseBitVector::test(), which would move the cursor of big (see SparseBitVectorPtsSetPolicy::has())
+	template <typename Iterator>
+	bool bigMatches(Iterator first, Iterator last, bool matchAny) const
+	{
+		auto bigItr = big.begin(), bigEnd = big.end();
+		for (; first != last; ++first)
+		{
+			while (bigItr != bigEnd && *bigItr < *first)
+				++bigItr;
+			bool found = (bigItr != bigEnd && *bigItr == *first);
+			if (found == matchAny)
+				return matchAny;
+		}
+		return !matchAny;
+	}
+public:
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		SmallVectorPtsSetPolicy::iterator smallItr;
+		SparseBitVectorPtsSetPolicy::iterator bigItr;
+		bool isBig;
+	public:
+		iterator(SmallVectorPtsSetPolicy::iterator s, SparseBitVectorPtsSetPolicy::iterator b, bool i): smallItr(s), bigItr(b), isBig(i) {}
+
+		bool operator==(const iterator& other) const
+		{
+			return isBig ? bigItr == other.bigItr : smallItr == other.smallItr;
+		}
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return isBig ? *bigItr : *smallItr; }
+
+		iterator& operator++()
+		{
+			if (isBig)
+				++bigItr;
+			else
+				++smallItr;
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	HybridPtsSetPolicy(): isBig(false) {}
+
+	bool has(unsigned idx) const
+	{
+		return isBig ? big.has(idx) : small.has(idx);
+	}
+
+	bool insert(unsigned idx)
+	{
+		if (isBig)
+			return big.insert(idx);
+		if (!small.insert(idx))
+			return false;
+		if (small.getSize() > Threshold)
+			grow();
+		return true;
+	}
+
+	bool contains(const HybridPtsSetPolicy& other) const
+	{
+		if (isBig == other.isBig)
+			return isBig ? big.contains(other.big) : small.contains(other.small);
+		if (!isBig)
+			return false;
+		return bigMatches(other.small.begin(), other.small.end(), false);
+	}
+
+	bool intersectWith(const HybridPtsSetPolicy& other) const
+	{
+		if (isBig == other.isBig)
+			return isBig ? big.intersectWith(other.big) : small.intersectWith(other.small);
+		const HybridPtsSetPolicy& bigSet = isBig ? *this : other;
+		const HybridPtsSetPolicy& smallSet = isBig ? other : *this;
+		return bigSet.bigMatches(smallSet.small.begin(), smallSet.small.end(), true);
+	}
+
+	bool unionWith(const HybridPtsSetPolicy& other, unsigned& size)
+	{
+		if (isBig)
+		{
+			if (other.isBig)
+				return big.unionWith(other.big, size);
+			unsigned oldSize = size;
+			for (auto idx: other.small)
+				size += big.insert(idx);
+			return size != oldSize;
+		}
+		if (other.isBig)
+		{
+			grow();
+			return big.unionWith(other.big, size);
+		}
+		if (!small.unionWith(other.small, size))
+			return false;
+		if (small.getSize() > Threshold)
+			grow();
+		return true;
+	}
+
+	void assignDifference(const HybridPtsSetPolicy& lhs, const HybridPtsSetPolicy& rhs)
+	{
+		HybridPtsSetPolicy result;
+		if (lhs.isBig && rhs.isBig)
+		{
+			result.big.assignDifference(lhs.big, rhs.big);
+			result.isBig = true;
+			if (result.big.getSize() <= Threshold)
+				result.shrink();
+		}
+		else
+		{
+			for (auto idx: lhs)
+			{
+				if (!rhs.has(idx))
+					result.insert(idx);
+			}
+		}
+		*this = std::move(result);
+	}
+
+	void clear()
+	{
+		small.clear();
+		big.clear();
+		isBig = false;
+	}
+
+	unsigned getSize() const
+	{
+		return isBig ? big.getSize() : small.getSize();
+	}
+	bool isEmpty() const
+	{
+		return isBig ? big.isEmpty() : small.isEmpty();
+	}
+
+	bool operator==(const HybridPtsSetPolicy& other) const
+	{
+		if (isBig != other.isBig)
+			return false;
+		return isBig ? big == other.big : small == other.small;
+	}
+
+	std::size_t getMemoryUsage() const { return small.getMemoryUsage() + big.getMemoryUsage(); }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return iterator(small.begin(), big.begin(), isBig); }
+	iterator end() const { return iterator(small.end(), big.end(), isBig); }
+};
+
+// The Roaring implementation (see RoaringBitmap.h): per 64K chunk of objects, an array, a bitmap or a list of runs, whichever is the smallest. Sets of objects with neighbouring indices take a few bytes per run rather than a list node per 128 elements
+class RoaringPtsSetPolicy
+{
+private:
+	AndersRoaringBitmap bits;
+public:
+	typedef AndersRoaringBitmap::iterator iterator;
+
+	bool has(unsigned idx) const
+	{
+		return bits.test(idx);
+	}
+
+	bool insert(unsigned idx)
+	{
+		return bits.testAndSet(idx);
+	}
+
+	bool contains(const RoaringPtsSetPolicy& other) const
+	{
+		return bits.contains(other.bits);
+	}
+
+	bool intersectWith(const RoaringPtsSetPolicy& other) const
+	{
+		return bits.intersects(other.bits);
+	}
+
+	bool unionWith(const RoaringPtsSetPolicy& other, unsigned& size)
+	{
+		unsigned gained = bits.unionWith(other.bits);
+		size += gained;
+		return gained != 0;
+	}
+
+	void assignDifference(const RoaringPtsSetPolicy& lhs, const RoaringPtsSetPolicy& rhs)
+	{
+		bits.assignDifference(lhs.bits, rhs.bits);
+	}
+
+	void clear()
+	{
+		bits.clear();
+	}
+
+	unsigned getSize() const
+	{
+		return bits.count();
+	}
+	bool isEmpty() const
+	{
+		return bits.empty();
+	}
+
+	bool operator==(const RoaringPtsSetPolicy& other) const
+	{
+		return bits == other.bits;
+	}
+
+	std::size_t getMemoryUsage() const { return bits.getMemoryUsage(); }
+	static std::size_t getSharedMemoryUsage() { return 0; }
+
+	iterator begin() const { return bits.begin(); }
+	iterator end() const { return bits.end(); }
+};
+
+// The hash-consed implementation: a set is a reference to an immutable entry in the global AndersPtsSetPool, and nodes with equal sets share the same entry. Copying a set and comparing two sets are O(1), and unions are memoized. The price is that every modification builds (or finds) a new entry, so insert() is linear in the size of the set
+class SharedPtsSetPolicy
+{
+private:
+	typedef AndersPtsSetPool::Entry Entry;
+	typedef AndersPtsSetPool::BitVec BitVec;
+
+	// nullptr means the empty set
+	const Entry* entry;
+
+	static AndersPtsSetPool& getPool() { return AndersPtsSetPool::getGlobalPool(); }
+	static const BitVec& getEmptyBits()
+	{
+		static const BitVec emptyBits;
+		return emptyBits;
+	}
+	const BitVec& getBits() const
+	{
+		return entry == nullptr ? getEmptyBits() : entry->getBits();
+	}
+
+	// Take over the reference that the caller owns to e. Return true if the set changes
+	bool reset(const Entry* e)
+	{
+		if (e == entry)
+		{
+			getPool().release(e);
+			return false;
+		}
+		getPool().release(entry);
+		entry = e;
+		return true;
+	}
+public:
+	using iterator = BitVec::iterator;
+
+	SharedPtsSetPolicy(): entry(nullptr) {}
+	SharedPtsSetPolicy(const SharedPtsSetPolicy& other): entry(other.entry)
+	{
+		getPool().retain(entry);
+	}
+	SharedPtsSetPolicy(SharedPtsSetPolicy&& other): entry(other.entry)
+	{
+		other.entry = nullptr;
+	}
+	SharedPtsSetPolicy& operator=(const SharedPtsSetPolicy& other)
+	{
+		getPool().retain(other.entry);
+		reset(other.entry);
+		return *this;
+	}
+	SharedPtsSetPolicy& operator=(SharedPtsSetPolicy&& other)
+	{
+		if (this != &other)
+		{
+			getPool().release(entry);
+			entry = other.entry;
+			other.entry = nullptr;
+		}
+		return *this;
+	}
+	~SharedPtsSetPolicy()
+	{
+		getPool().release(entry);
+	}
+
+	// Return true if *this has idx as an element
+	bool has(unsigned idx) const
+	{
+		return entry != nullptr && entry->getBits().test(idx);
+	}
+
+	// Return true if the ptsset changes
+	bool insert(unsigned idx)
+	{
+		if (has(idx))
+			return false;
+		BitVec bits(getBits());
+		bits.set(idx);
+		return reset(getPool().intern(std::move(bits)));
+	}
+
+	// Return true if *this is a superset of other
+	bool contains(const SharedPtsSetPolicy& other) const
+	{
+		return entry == other.entry || getBits().contains(other.getBits());
+	}
+
+	// intersectWith: return true if *this and other share points-to elements
+	bool intersectWith(const SharedPtsSetPolicy& other) const
+	{
+		return getBits().intersects(other.getBits());
+	}
+
+	// Return true if the ptsset changes. The entries know their size
+	bool unionWith(const SharedPtsSetPolicy& other, unsigned& size)
+	{
+		if (!reset(getPool().getUnion(entry, other.entry)))
+			return false;
+		size = getSize();
+		return true;
+	}
+
+	// Make *this the set of elements that are in lhs but not in rhs
+	void assignDifference(const SharedPtsSetPolicy& lhs, const SharedPtsSetPolicy& rhs)
+	{
+		BitVec bits;
+		bits.intersectWithComplement(lhs.getBits(), rhs.getBits());
+		reset(getPool().intern(std::move(bits)));
+	}
+
+	void clear()
+	{
+		reset(nullptr);
+	}
+
+	unsigned getSize() const
+	{
+		return entry == nullptr ? 0 : entry->getSize();
+	}
+	bool isEmpty() const
+	{
+		return entry == nullptr;
+	}
+
+	// Equal sets are always the same entry
+	bool operator==(const SharedPtsSetPolicy& other) const
+	{
+		return entry == other.entry;
+	}
+
+	// The entries belong to the pool, whose memory is counted once for all the sets
+	std::size_t getMemoryUsage() const { return 0; }
+	static std::size_t getSharedMemoryUsage() { return AndersPtsSetPool::getGlobalPool().getMemoryUsage(); }
+
+	iterator begin() const { return getBits().begin(); }
+	iterator end() const { return getBits().end(); }
+};
+
+// The BDD implementation: a set is a reference to the root of a BDD in the global AndersBddManager. Equal sets always have the same root, and large sets whose elements follow regular patterns (e.g. the fields of a struct, or the objects of a module allocated together) share most of their nodes, which is where the memory savings come from. Iteration and has() walk the BDD, so they are slower than with a SparseBitVector
+class BddPtsSetPolicy
+{
+private:
+	typedef AndersBddManager::BddRef BddRef;
+
+	BddRef root;
+
+	static AndersBddManager& getManager() { return AndersBddManager::getGlobalManager(); }
+
+	// Take over the reference that the caller owns to r. Return true if the set changes
+	bool reset(BddRef r)
+	{
+		if (r == root)
+		{
+			getManager().deref(r);
+			return false;
+		}
+		getManager().deref(root);
+		root = r;
+		return true;
+	}
+public:
+	// Enumerate the elements in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		BddRef root;
+		unsigned curr;
+		bool atEnd;
+	public:
+		iterator(BddRef r, bool e): root(r), curr(0), atEnd(e)
+		{
+			if (!atEnd)
+				atEnd = !getManager().findFrom(root, 0, curr);
+		}
+
+		bool operator==(const iterator& other) const
+		{
+			return atEnd == other.atEnd && (atEnd || curr == other.curr);
+		}
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return curr; }
+
+		iterator& operator++()
+		{
+			if (curr == std::numeric_limits<unsigned>::max())
+				atEnd = true;
+			else
+				atEnd = !getManager().findFrom(root, curr + 1, curr);
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	BddPtsSetPolicy(): root(AndersBddManager::False) {}
+	BddPtsSetPolicy(const BddPtsSetPolicy& other): root(other.root)
+	{
+		getManager().ref(root);
+	}
+	BddPtsSetPolicy(BddPtsSetPolicy&& other): root(other.root)
+	{
+		other.root = AndersBddManager::False;
+	}
+	BddPtsSetPolicy& operator=(const BddPtsSetPolicy& other)
+	{
+		getManager().ref(other.root);
+		reset(other.root);
+		return *this;
+	}
+	BddPtsSetPolicy& operator=(BddPtsSetPolicy&& other)
+	{
+		if (this != &other)
+		{
+			getManager().deref(root);
+			root = other.root;
+			other.root = AndersBddManager::False;
+		}
+		return *this;
+	}
+	~BddPtsSetPolicy()
+	{
+		getManager().deref(root);
+	}
+
+	// Return true if *this has idx as an element
+	bool has(unsigned idx) const
+	{
+		return getManager().has(root, idx);
+	}
+
+	// Return true if the ptsset changes
+	bool insert(unsigned idx)
+	{
+		if (has(idx))
+			return false;
+		BddRef singleton = getManager().getSingleton(idx);
+		BddRef newRoot = getManager().getUnion(root, singleton);
+		getManager().deref(singleton);
+		return reset(newRoot);
+	}
+
+	// Return true if *this is a superset of other
+	bool contains(const BddPtsSetPolicy& other) const
+	{
+		BddRef diff = getManager().getDifference(other.root, root);
+		getManager().deref(diff);
+		return diff == AndersBddManager::False;
+	}
+
+	// intersectWith: return true if *this and other share points-to elements
+	bool intersectWith(const BddPtsSetPolicy& other) const
+	{
+		BddRef inter = getManager().getIntersection(root, other.root);
+		getManager().deref(inter);
+		return inter != AndersBddManager::False;
+	}
+
+	// Return true if the ptsset changes
+	bool unionWith(const BddPtsSetPolicy& other, unsigned& size)
+	{
+		if (!reset(getManager().getUnion(root, other.root)))
+			return false;
+		size = getSize();
+		return true;
+	}
+
+	// Make *this the set of elements that are in lhs but not in rhs
+	void assignDifference(const BddPtsSetPolicy& lhs, const BddPtsSetPolicy& rhs)
+	{
+		reset(getManager().getDifference(lhs.root, rhs.root));
+	}
+
+	void clear()
+	{
+		getManager().deref(root);
+		root = AndersBddManager::False;
+	}
+
+	unsigned getSize() const
+	{
+		return getManager().count(root);		// NOT a constant time operation!
+	}
+	bool isEmpty() const
+	{
+		return root == AndersBddManager::False;
+	}
+
+	// Equal sets always have the same root
+	bool operator==(const BddPtsSetPolicy& other) const
+	{
+		return root == other.root;
+	}
+
+	// The nodes belong to the manager, whose memory is counted once for all the sets
+	std::size_t getMemoryUsage() const { return 0; }
+	static std::size_t getSharedMemoryUsage() { return getManager().getMemoryUsage(); }
+
+	iterator begin() const { return iterator(root, false); }
+	iterator end() const { return iterator(root, true); }
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef ANDERSEN_PTSSETPOOL_H
+#define ANDERSEN_PTSSETPOOL_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SparseBitVector.h"
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// A pool of hash-consed (interned), immutable bit vectors. Two equal vectors interned into the same pool are always represented by the same entry, so equality tests become pointer comparisons and all nodes whose points-to sets are equal share a single copy of the bits
+// Entries are reference counted and are freed as soon as the last reference goes away. Unions are memoized by the (id, id) pair of their operands; ids are never reused, so a memo entry can never give a wrong answer, only a stale one that we detect and recompute
+// All public functions are thread-safe
+class AndersPtsSetPool
+{
+public:
+	typedef llvm::SparseBitVector<> BitVec;
+
+	class Entry
+	{
+	private:
+		BitVec bits;
+		std::size_t hash;
+		unsigned id;
+		unsigned refCount;
+		// The number of bits, counted along with the hash
+		unsigned size;
+
+		Entry(BitVec&& b, std::size_t h, unsigned i, unsigned n): bits(std::move(b)), hash(h), id(i), refCount(0), size(n) {}
+	public:
+		const BitVec& getBits() const { return bits; }
+		unsigned getSize() const { return size; }
+		unsigned getId() const { return id; }
+
+		friend class AndersPtsSetPool;
+	};
+private:
+	mutable std::mutex mutex;
+	// Hash value -> entries with that hash value
+	std::unordered_multimap<std::size_t, Entry*> table;
+	// Id -> entry, for all entries that are still alive
+	llvm::DenseMap<unsigned, Entry*> liveEntries;
+	// (smaller id, larger id) -> id of the union
+	llvm::DenseMap<std::pair<unsigned, unsigned>, unsigned> unionMemo;
+	// Id 0 is reserved: DenseMap cannot use ~0U as a key, and we want every valid id to be usable
+	unsigned nextId;
+
+	// Also put the number of bits into size
+	static std::size_t hashBits(const BitVec& bits, unsigned& size);
+
+	// The following functions expect the mutex to be held
+	const Entry* internLocked(BitVec&& bits);
+	void retainLocked(const Entry* entry);
+	void releaseLocked(const Entry* entry);
+
+	AndersPtsSetPool(const AndersPtsSetPool&) = delete;
+	AndersPtsSetPool& operator=(const AndersPtsSetPool&) = delete;
+public:
+	AndersPtsSetPool(): nextId(1) {}
+	~AndersPtsSetPool();
+
+	// The pool used by AndersPtsSet
+	static AndersPtsSetPool& getGlobalPool();
+
+	// Return the entry equal to bits, creating it if necessary. The empty vector is represented by nullptr. The caller owns one reference to the returned entry
+	const Entry* intern(BitVec&& bits);
+	// Return the entry of lhs | rhs. The caller owns one reference to the returned entry
+	const Entry* getUnion(const Entry* lhs, const Entry* rhs);
+
+	// Reference counting. Both accept nullptr
+	void retain(const Entry* entry);
+	void release(const Entry* entry);
+
+	// Number of live entries
+	unsigned getNumSets() const;
+	// The entries, their bits and the tables that find them (see MemoryUsage.h)
+	std::size_t getMemoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ANDERSEN_PTSSETSPILL_H
+#define ANDERSEN_PTSSETSPILL_H
+
+#include "NodeFactory.h"
+#include "PtsGraph.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/FileSystem.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+// The file that -anders-out-of-core moves points-to sets into when the sets of the worklist solver grow past -anders-out-of-core-limit. A spilled set is cleared in memory and left in the file until AndersPtsGraph looks it up again, which reads it back and forgets it here
+// The sets are appended in blocks that start on a page boundary, and each block holds the sets of one spill in increasing NodeIndex order, so a pass over the nodes in index order reads the file front to back. The file is mapped read-only: its pages are never dirtied, so the kernel can drop them under memory pressure without writing them back. Once more than half of the file is sets that have been read back, the next spill rewrites the file with the live sets only
+// The elements of a set are stored as in a solver checkpoint: one 32-bit word per object, with the null object as its node
+class PtsSetSpillFile
+{
+private:
+	std::string fileName;
+	int fd;
+	std::unique_ptr<llvm::sys::fs::mapped_file_region> region;
+	// The size of the file, in words
+	std::uint64_t fileWords;
+	// The words of the sets still in the file, and of those read back since it was last rewritten
+	std::uint64_t liveWords, deadWords;
+	// For each spilled node, the word its set starts at and its number of elements
+	llvm::DenseMap<NodeIndex, std::pair<std::uint64_t, std::uint32_t>> extents;
+
+	PtsSetSpillFile(std::string name, int f): fileName(std::move(name)), fd(f), fileWords(0), liveWords(0), deadWords(0) {}
+	const std::uint32_t* getWords(std::uint64_t offset) const { return reinterpret_cast<const std::uint32_t*>(region->const_data()) + offset; }
+	// Append words, starting on a page boundary, and map the grown file. Return the offset of the first word, or ~0 after putting the reason into error
+	std::uint64_t append(llvm::ArrayRef<std::uint32_t> words, std::string& error);
+	// Replace the file with one that only has the live sets, in increasing NodeIndex order
+	bool compact(std::string& error);
+
+	PtsSetSpillFile(const PtsSetSpillFile&) = delete;
+	PtsSetSpillFile& operator=(const PtsSetSpillFile&) = delete;
+public:
+	// Create a file of a unique name in dir, which is created if need be. Return nullptr and put the reason into error if it can't be
+	static std::unique_ptr<PtsSetSpillFile> create(llvm::StringRef dir, std::string& error);
+	// Remove the file. The graph the sets came from must have read them all back (see readBackAll())
+	~PtsSetSpillFile();
+
+	// Move the sets of nodes, which must be sorted and not spilled already, from graph into the file, and make graph read them back from here. Return false and put the reason into error if the file can't be written, in which case the sets are left in graph
+	bool spill(AndersPtsGraph& graph, llvm::ArrayRef<NodeIndex> nodes, std::string& error);
+	// Put the set of node back into ptsSet, and forget it here
+	void readBack(NodeIndex node, AndersPtsSet& ptsSet);
+	// Forget the set of node without reading it
+	void drop(NodeIndex node);
+	// Read back all the sets that graph has in the file, and detach graph from the file
+	void readBackAll(AndersPtsGraph& graph);
+
+	unsigned getNumSpilledSets() const { return extents.size(); }
+	std::uint64_t getFileSize() const { return fileWords * sizeof(std::uint32_t); }
+};
+
+#endif
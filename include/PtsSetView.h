@@ -0,0 +1,141 @@
+#ifndef ANDERSEN_PTSSET_VIEW_H
+#define ANDERSEN_PTSSET_VIEW_H
+
+#include "CompactPtsGraph.h"
+#include "NodeFactory.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+// A read-only view of a solved points-to set, as handed out by Andersen::getPointsToSetView(). Unlike Andersen::getPointsToSet(), it copies nothing: the objects are only mapped to their values when the view is iterated, and clients that only count objects or test membership never pay for that
+// The view refers to the analysis, so it must not outlive it
+class AndersPtsSetView
+{
+private:
+	typedef llvm::DenseMap<NodeIndex, std::vector<NodeIndex>> LocationClassMap;
+
+	const AndersNodeFactory* nodeFactory;
+	const LocationClassMap* locationClasses;
+	// The objects of the set other than the special ones
+	CompactPtsSet objs;
+	bool universal;
+	bool null;
+public:
+	// Iterate over the values of the objects in the set, in the order getPointsToSet() lists them: each object is followed by the objects that are location equivalent to it. Objects without a value are skipped
+	class value_iterator: public std::iterator<std::forward_iterator_tag, const llvm::Value*>
+	{
+	private:
+		const AndersPtsSetView* view;
+		CompactPtsSet::iterator curr;
+		// The class members of *curr that are left, or nullptr when *curr itself is next
+		const NodeIndex* member;
+		const NodeIndex* memberEnd;
+
+		NodeIndex getNode() const { return member == nullptr ? *curr : *member; }
+
+		// Move to the next position, whether or not it has a value
+		void step()
+		{
+			if (member == nullptr)
+			{
+				auto itr = view->locationClasses->find(*curr);
+				if (itr != view->locationClasses->end() && !itr->second.empty())
+				{
+					member = itr->second.data();
+					memberEnd = member + itr->second.size();
+					return;
+				}
+			}
+			else if (++member != memberEnd)
+				return;
+
+			member = memberEnd = nullptr;
+			++curr;
+		}
+		// Skip the positions without a value
+		void settle()
+		{
+			while (curr != view->objs.end() && view->nodeFactory->getValueForNode(getNode()) == nullptr)
+				step();
+		}
+	public:
+		value_iterator(const AndersPtsSetView* v, CompactPtsSet::iterator c): view(v), curr(c), member(nullptr), memberEnd(nullptr)
+		{
+			settle();
+		}
+
+		bool operator==(const value_iterator& other) const { return curr == other.curr && member == other.member; }
+		bool operator!=(const value_iterator& other) const { return !(*this == other); }
+
+		const llvm::Value* operator*() const { return view->nodeFactory->getValueForNode(getNode()); }
+
+		value_iterator& operator++()
+		{
+			step();
+			settle();
+			return *this;
+		}
+		value_iterator operator++(int)
+		{
+			value_iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	AndersPtsSetView(): nodeFactory(nullptr), locationClasses(nullptr), objs(nullptr, nullptr), universal(false), null(false) {}
+	// set is a solved set. The special objects are the nodes with the smallest indices, so the others are those after the last special object
+	AndersPtsSetView(const AndersNodeFactory& n, const LocationClassMap& l, const CompactPtsSet& set): nodeFactory(&n), locationClasses(&l), objs(set.getElementsAfter(std::max(n.getUniversalObjNode(), n.getNullObjectNode()))), universal(set.has(n.getUniversalObjNode())), null(set.has(n.getNullObjectNode())) {}
+
+	// The raw node indices of the objects in the set, sorted, without the special objects. A location equivalence class only appears as its representative
+	const CompactPtsSet& getNodes() const { return objs; }
+	// Return true if the set has the universal object, i.e. the pointer may point to anything. The universal object has no value, so it doesn't show up in the iteration
+	bool hasUniversalObject() const { return universal; }
+	// Return true if the pointer may be null
+	bool hasNullObject() const { return null; }
+
+	// Return true if the set has the object node obj. A member of a location equivalence class is found through its representative
+	bool hasNode(NodeIndex obj) const
+	{
+		if (objs.has(obj))
+			return true;
+		NodeIndex rep = nodeFactory->getMergeTarget(obj);
+		if (rep == obj || !objs.has(rep))
+			return false;
+		auto itr = locationClasses->find(rep);
+		return itr != locationClasses->end() && std::find(itr->second.begin(), itr->second.end(), obj) != itr->second.end();
+	}
+	// Return true if the set has the memory object allocSite
+	bool hasValue(const llvm::Value* allocSite) const
+	{
+		NodeIndex obj = nodeFactory->getObjectNodeFor(allocSite);
+		return obj != AndersNodeFactory::InvalidIndex && hasNode(obj);
+	}
+
+	// Return true if the set has no object other than the special ones
+	bool isEmpty() const { return objs.isEmpty(); }
+	// The number of values the iteration yields. This walks the set, but allocates nothing
+	unsigned getNumValues() const
+	{
+		unsigned count = 0;
+		for (auto obj: objs)
+		{
+			if (nodeFactory->getValueForNode(obj) != nullptr)
+				++count;
+			auto itr = locationClasses->find(obj);
+			if (itr != locationClasses->end())
+				for (auto member: itr->second)
+					if (nodeFactory->getValueForNode(member) != nullptr)
+						++count;
+		}
+		return count;
+	}
+
+	value_iterator begin() const { return value_iterator(this, objs.begin()); }
+	value_iterator end() const { return value_iterator(this, objs.end()); }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ANDERSEN_QUERY_SERVER_H
+#define ANDERSEN_QUERY_SERVER_H
+
+#include "PersistedResults.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// The protocol of andersen-serve, which keeps the results files of several modules loaded and answers batches of queries about them over a local socket, so that a tool that only has a few questions doesn't load the IR and the results for each of them
+// A message, either way, is a word count followed by that many 32-bit words, in the byte order of the machine. Values are named by their ids in the results file (see PersistedResultsFormat::enumerateValues()), which a client either computes from its own copy of the module or asks for by name with LookUp
+namespace QueryProtocol
+{
+	// A request is [opcode, module, count, operands...]: module is the position of the module on the command line of the server, and count is the number of queries in the batch
+	enum Opcode: std::uint32_t
+	{
+		// Operands: count value ids. Reply: for each, NoEntry if the analysis doesn't know where the value points to (see Andersen::getPointsToSet()), or the number of objects followed by their value ids
+		PointsTo = 1,
+		// Operands: count pairs of value ids. Reply: an AliasCode for each pair (see PersistedAndersResults::alias()). The casts of the values are stripped first
+		Alias = 2,
+		// Operands: count value ids. Reply: for each, NoEntry if the id is not a value of the module, or the number of pointers that may point to it followed by their value ids
+		PointedBy = 3,
+		// Operands: count value ids of calls. Reply: for each, NoEntry if the value is not a call, or if the call may call any address-taken function, or the number of functions it may call followed by their value ids. A direct call calls its function
+		CallTargets = 4,
+		// Operands: count names, each a byte count followed by the bytes, padded with zeros to a whole word. A name is "@name" for a global or a function, and "function:name" for an argument or an instruction of a function. Reply: the value id of each, or NoEntry
+		LookUp = 5,
+	};
+	// The first word of a reply. The answers only follow Ok
+	enum Status: std::uint32_t { Ok = 0, BadRequest = 1, NoSuchModule = 2 };
+	enum AliasCode: std::uint32_t { NoAliasCode = 0, MayAliasCode = 1, PartialAliasCode = 2, MustAliasCode = 3 };
+	enum: std::uint32_t { NoEntry = PersistedResultsFormat::NoEntry };
+	// The longest message either side accepts, in words
+	enum: std::uint32_t { MaxMessageWords = 1u << 26 };
+}
+
+// The modules andersen-serve answers for, and the answering itself, apart from the socket
+class AndersQueryServer
+{
+private:
+	struct ServedModule
+	{
+		std::unique_ptr<llvm::Module> module;
+		std::unique_ptr<PersistedAndersResults> results;
+	};
+	std::vector<ServedModule> modules;
+
+	std::uint32_t lookUp(const ServedModule& served, llvm::StringRef name) const;
+public:
+	// Answer the queries about m from results, which must have been loaded against m. The context of m must outlive the server. Return the number the requests refer to the module by
+	unsigned addModule(std::unique_ptr<llvm::Module> m, std::unique_ptr<PersistedAndersResults> results);
+	unsigned getNumModules() const { return modules.size(); }
+
+	// Put the reply to request, a message without its word count, into reply. The modules are only read, so any number of threads may answer requests at once
+	void handleRequest(llvm::ArrayRef<std::uint32_t> request, std::vector<std::uint32_t>& reply) const;
+};
+
+#endif
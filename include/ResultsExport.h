@@ -0,0 +1,109 @@
+#ifndef ANDERSEN_RESULTS_EXPORT_H
+#define ANDERSEN_RESULTS_EXPORT_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Value.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The solved results, streamed out by Andersen::exportResults() for the tools that import them without this library or the module. A results file (PersistedResults.h) is made to be queried in place, and keeps the nodes, the merge targets and the location classes the queries need; an export only has what a consumer wants to know: for each value, the set of values it points to
+// The values are named by their ids in PersistedResultsFormat::enumerateValues(). Each distinct points-to set is written once, with the location classes expanded into their members, and the values refer to it by its id. All the sets come before the first value, so a consumer can handle the records as they arrive
+class AndersResultsSink
+{
+public:
+	// The set id of a pointer that points to nothing
+	enum: std::uint32_t { EmptySet = ~0u };
+
+	virtual ~AndersResultsSink() = default;
+
+	// Called first. The sets that follow have the ids 0 to numSets - 1, in order, and the values have ids below numValues
+	virtual void begin(unsigned numValues, unsigned numSets) {}
+	// objs are the ids of the values of the objects in the set, sorted. The objects without a value are left out, as getPointsToSet() leaves them out. universal is true if the set has the universal object, i.e. its pointers may point to anything
+	virtual void writeSet(unsigned setId, bool universal, bool nullObject, llvm::ArrayRef<std::uint32_t> objs) = 0;
+	// The set of the pointer valueId, which is v, or nullptr when the records are read back from a file. The values come in increasing id order. The values that are not pointers, and those the analysis knows nothing about, are left out
+	virtual void writeValue(unsigned valueId, const llvm::Value* v, unsigned setId) = 0;
+	// Called last
+	virtual void end() {}
+};
+
+// The binary format of AndersBinaryResultsWriter: a header followed by records of 32-bit words, in the byte order of the machine that wrote them
+namespace ExportedResultsFormat
+{
+	enum: std::uint32_t { Magic = 0x58444e41 /* "ANDX" */, Version = 1 };
+	enum: std::uint32_t { UniversalFlag = 1, NullObjectFlag = 2 };
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t numValues;
+		std::uint32_t numSets;
+	};
+	// Then numSets records [flags, count, objs[count]], and then records [valueId, setId] up to the end of the file
+}
+
+// Write the records in the format of ExportedResultsFormat. The words are gathered into a buffer of their own and written in large blocks, so the stream doesn't have to be buffered (e.g. errs())
+class AndersBinaryResultsWriter: public AndersResultsSink
+{
+private:
+	enum: unsigned { BufferWords = 1 << 14 };
+
+	llvm::raw_ostream& os;
+	std::vector<std::uint32_t> buffer;
+
+	void push(std::uint32_t word)
+	{
+		buffer.push_back(word);
+		if (buffer.size() >= BufferWords)
+			flush();
+	}
+	void flush();
+public:
+	explicit AndersBinaryResultsWriter(llvm::raw_ostream& o): os(o) { buffer.reserve(BufferWords); }
+	~AndersBinaryResultsWriter() override { flush(); }
+
+	void begin(unsigned numValues, unsigned numSets) override;
+	void writeSet(unsigned setId, bool universal, bool nullObject, llvm::ArrayRef<std::uint32_t> objs) override;
+	void writeValue(unsigned valueId, const llvm::Value* v, unsigned setId) override;
+	void end() override { flush(); }
+};
+
+// Write the records as lines of text, for people and scripts:
+//   set <id>: [universal] [null] <value id>...
+//   value <id> [<name>]: <set id>, or "empty"
+// Like AndersBinaryResultsWriter, it has a buffer of its own
+class AndersTextResultsWriter: public AndersResultsSink
+{
+private:
+	enum: unsigned { BufferBytes = 1 << 16 };
+
+	llvm::raw_ostream& os;
+	llvm::SmallVector<char, 0> buffer;
+	llvm::raw_svector_ostream bufferOs;
+
+	// Called after each record, which may take the buffer past BufferBytes
+	void flushIfFull()
+	{
+		if (buffer.size() >= BufferBytes)
+			flush();
+	}
+	void flush();
+public:
+	explicit AndersTextResultsWriter(llvm::raw_ostream& o): os(o), bufferOs(buffer) { buffer.reserve(BufferBytes); }
+	~AndersTextResultsWriter() override { flush(); }
+
+	void writeSet(unsigned setId, bool universal, bool nullObject, llvm::ArrayRef<std::uint32_t> objs) override;
+	void writeValue(unsigned valueId, const llvm::Value* v, unsigned setId) override;
+	void end() override { flush(); }
+};
+
+// Feed the records of a file that AndersBinaryResultsWriter wrote into sink, e.g. to turn it into text. Return false and put the reason into error if the file is malformed, in which case sink may have got a part of the records
+bool readExportedResults(std::unique_ptr<llvm::MemoryBuffer> buffer, AndersResultsSink& sink, std::string& error);
+
+#endif
@@ -0,0 +1,637 @@
+#ifndef ANDERSEN_ROARINGBITMAP_H
+#define ANDERSEN_ROARINGBITMAP_H
+
+#include "MemoryUsage.h"
+
+#include "llvm/Support/MathExtras.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// A compressed bitmap in the style of Roaring (Lemire et al.): the elements are split by their upper 16 bits into chunks of 64K, and each non-empty chunk keeps its lower halves in whichever container is the smallest for them: a sorted array of 16-bit values for a few elements, a 64K-bit bitmap for many, or a list of runs for elements that come in consecutive ranges. The objects of a points-to set are mostly numbered next to each other (the fields of a struct, the globals of a module), so large sets tend to end up as a handful of runs
+// Every set operation re-encodes the containers it produces. insert() only switches an array to a bitmap when it overflows, so it stays cheap
+class AndersRoaringBitmap
+{
+private:
+	// An array that grows past this is larger than a bitmap (8KB)
+	static const unsigned MaxArraySize = 4096;
+	static const unsigned BitmapWords = 1024;
+
+	// An inclusive range of lower halves
+	struct Interval
+	{
+		uint32_t first, last;
+	};
+	typedef std::vector<Interval> IntervalVec;
+
+	enum class Kind: uint8_t { Array, Bitmap, Run };
+
+	// The bits of bitmap word w that fall in [first, last]
+	static uint64_t getRangeMask(uint32_t w, uint32_t first, uint32_t last)
+	{
+		uint32_t lo = std::max(first, w * 64), hi = std::min(last, w * 64 + 63);
+		if (lo > hi)
+			return 0;
+		uint64_t mask = ~uint64_t(0) << (lo % 64);
+		if (hi % 64 != 63)
+			mask &= ~(~uint64_t(0) << (hi % 64 + 1));
+		return mask;
+	}
+
+	// The lower halves of the elements of one chunk. Containers are never empty
+	struct Container
+	{
+		uint16_t key;
+		Kind kind;
+		uint32_t card;
+		// Array: the sorted elements. Run: the first and the last element of each run, in order. Adjacent runs are always merged
+		std::vector<uint16_t> data;
+		// Bitmap: BitmapWords words
+		std::vector<uint64_t> words;
+
+		Container(uint16_t k): key(k), kind(Kind::Array), card(0) {}
+
+		unsigned getNumRuns() const { return data.size() / 2; }
+
+		bool has(uint32_t low) const
+		{
+			switch (kind)
+			{
+				case Kind::Array:
+					return std::binary_search(data.begin(), data.end(), low);
+				case Kind::Bitmap:
+					return words[low / 64] >> (low % 64) & 1;
+				case Kind::Run:
+				{
+					unsigned r = findRun(low);
+					return r < getNumRuns() && data[2 * r] <= low;
+				}
+			}
+			return false;
+		}
+
+		// The first run whose last element is at or after low
+		unsigned findRun(uint32_t low) const
+		{
+			unsigned lo = 0, hi = getNumRuns();
+			while (lo < hi)
+			{
+				unsigned mid = (lo + hi) / 2;
+				if (data[2 * mid + 1] < low)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			return lo;
+		}
+
+		// Find the first element at or after from. Return false if there is none
+		bool findFrom(uint32_t from, uint32_t& out) const
+		{
+			if (from > 0xffff)
+				return false;
+			switch (kind)
+			{
+				case Kind::Array:
+				{
+					auto itr = std::lower_bound(data.begin(), data.end(), from);
+					if (itr == data.end())
+						return false;
+					out = *itr;
+					return true;
+				}
+				case Kind::Bitmap:
+				{
+					uint64_t w = words[from / 64] & (~uint64_t(0) << (from % 64));
+					for (uint32_t i = from / 64; ; w = words[i])
+					{
+						if (w != 0)
+						{
+							out = i * 64 + llvm::countTrailingZeros(w);
+							return true;
+						}
+						if (++i == BitmapWords)
+							return false;
+					}
+				}
+				case Kind::Run:
+				{
+					unsigned r = findRun(from);
+					if (r == getNumRuns())
+						return false;
+					out = std::max<uint32_t>(data[2 * r], from);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void getIntervals(IntervalVec& intervals) const
+		{
+			intervals.clear();
+			auto add = [&intervals](uint32_t v) {
+				if (!intervals.empty() && intervals.back().last + 1 == v)
+					intervals.back().last = v;
+				else
+					intervals.push_back(Interval{v, v});
+			};
+			switch (kind)
+			{
+				case Kind::Array:
+					for (auto v: data)
+						add(v);
+					break;
+				case Kind::Bitmap:
+					for (uint32_t i = 0; i < BitmapWords; ++i)
+						for (uint64_t w = words[i]; w != 0; w &= w - 1)
+							add(i * 64 + llvm::countTrailingZeros(w));
+					break;
+				case Kind::Run:
+					for (unsigned r = 0, e = getNumRuns(); r < e; ++r)
+						intervals.push_back(Interval{data[2 * r], data[2 * r + 1]});
+					break;
+			}
+		}
+
+		// Encode the (sorted, disjoint and non-adjacent) intervals in the smallest container
+		void assignIntervals(const IntervalVec& intervals)
+		{
+			card = 0;
+			for (auto const& i: intervals)
+				card += i.last - i.first + 1;
+			std::vector<uint16_t>().swap(data);
+			std::vector<uint64_t>().swap(words);
+
+			if (intervals.size() * 2 < std::min<uint32_t>(card, MaxArraySize + 1))
+			{
+				kind = Kind::Run;
+				data.reserve(intervals.size() * 2);
+				for (auto const& i: intervals)
+				{
+					data.push_back(i.first);
+					data.push_back(i.last);
+				}
+			}
+			else if (card <= MaxArraySize)
+			{
+				kind = Kind::Array;
+				data.reserve(card);
+				for (auto const& i: intervals)
+					for (uint32_t v = i.first; v <= i.last; ++v)
+						data.push_back(v);
+			}
+			else
+			{
+				kind = Kind::Bitmap;
+				words.assign(BitmapWords, 0);
+				for (auto const& i: intervals)
+					setRange(i.first, i.last);
+			}
+		}
+
+		void toBitmap()
+		{
+			IntervalVec intervals;
+			getIntervals(intervals);
+			std::vector<uint16_t>().swap(data);
+			kind = Kind::Bitmap;
+			words.assign(BitmapWords, 0);
+			for (auto const& i: intervals)
+				setRange(i.first, i.last);
+		}
+
+		// The following three expect a bitmap
+		// Return the number of bits that were not set before. The caller keeps card
+		uint32_t setRange(uint32_t first, uint32_t last)
+		{
+			uint32_t gained = 0;
+			for (uint32_t w = first / 64; w <= last / 64; ++w)
+			{
+				uint64_t mask = getRangeMask(w, first, last);
+				gained += llvm::countPopulation(mask & ~words[w]);
+				words[w] |= mask;
+			}
+			return gained;
+		}
+		bool allSet(uint32_t first, uint32_t last) const
+		{
+			for (uint32_t w = first / 64; w <= last / 64; ++w)
+			{
+				uint64_t mask = getRangeMask(w, first, last);
+				if ((words[w] & mask) != mask)
+					return false;
+			}
+			return true;
+		}
+		bool anySet(uint32_t first, uint32_t last) const
+		{
+			for (uint32_t w = first / 64; w <= last / 64; ++w)
+			{
+				if (words[w] & getRangeMask(w, first, last))
+					return true;
+			}
+			return false;
+		}
+		void recount()
+		{
+			card = 0;
+			for (auto w: words)
+				card += llvm::countPopulation(w);
+		}
+
+		// Return true if low was not there before
+		bool insert(uint32_t low)
+		{
+			switch (kind)
+			{
+				case Kind::Array:
+				{
+					auto itr = std::lower_bound(data.begin(), data.end(), low);
+					if (itr != data.end() && *itr == low)
+						return false;
+					data.insert(itr, low);
+					if (++card > MaxArraySize)
+						toBitmap();
+					return true;
+				}
+				case Kind::Bitmap:
+				{
+					uint64_t mask = uint64_t(1) << (low % 64);
+					if (words[low / 64] & mask)
+						return false;
+					words[low / 64] |= mask;
+					++card;
+					return true;
+				}
+				case Kind::Run:
+				{
+					if (has(low))
+						return false;
+					IntervalVec intervals;
+					getIntervals(intervals);
+					intervals.insert(intervals.begin() + findRun(low), Interval{low, low});
+					assignIntervals(mergeIntervals(intervals, IntervalVec()));
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+
+	// The union of two sorted interval lists, with adjacent intervals merged
+	static IntervalVec mergeIntervals(const IntervalVec& a, const IntervalVec& b)
+	{
+		IntervalVec ret;
+		ret.reserve(a.size() + b.size());
+		auto ia = a.begin(), ib = b.begin();
+		while (ia != a.end() || ib != b.end())
+		{
+			const Interval& next = (ib == b.end() || (ia != a.end() && ia->first <= ib->first)) ? *ia++ : *ib++;
+			if (!ret.empty() && ret.back().last + 1 >= next.first)
+				ret.back().last = std::max(ret.back().last, next.last);
+			else
+				ret.push_back(next);
+		}
+		return ret;
+	}
+
+	// Return the number of elements c gains. Every container keeps its cardinality, so this costs nothing beyond the union
+	static uint32_t unionContainers(Container& c, const Container& other)
+	{
+		uint32_t oldCard = c.card;
+		if (c.kind == Kind::Bitmap)
+		{
+			uint32_t gained = 0;
+			if (other.kind == Kind::Bitmap)
+			{
+				for (unsigned i = 0; i < BitmapWords; ++i)
+				{
+					gained += llvm::countPopulation(other.words[i] & ~c.words[i]);
+					c.words[i] |= other.words[i];
+				}
+			}
+			else if (other.kind == Kind::Array)
+			{
+				for (auto v: other.data)
+				{
+					uint64_t bit = uint64_t(1) << (v % 64);
+					gained += (c.words[v / 64] & bit) == 0;
+					c.words[v / 64] |= bit;
+				}
+			}
+			else
+			{
+				for (unsigned r = 0, e = other.getNumRuns(); r < e; ++r)
+					gained += c.setRange(other.data[2 * r], other.data[2 * r + 1]);
+			}
+			c.card += gained;
+			return gained;
+		}
+		if (other.kind == Kind::Bitmap)
+		{
+			Container result(other);
+			unionContainers(result, c);
+			if (result.card == oldCard)
+				return 0;
+			c = std::move(result);
+			return c.card - oldCard;
+		}
+
+		IntervalVec mine, theirs;
+		c.getIntervals(mine);
+		other.getIntervals(theirs);
+		IntervalVec merged = mergeIntervals(mine, theirs);
+		uint32_t newCard = 0;
+		for (auto const& i: merged)
+			newCard += i.last - i.first + 1;
+		// The union has all of c, so it is c if it is no larger
+		if (newCard == oldCard)
+			return 0;
+		c.assignIntervals(merged);
+		return newCard - oldCard;
+	}
+
+	// Return true if c has every element of other
+	static bool containsContainer(const Container& c, const Container& other)
+	{
+		if (other.card > c.card)
+			return false;
+		IntervalVec theirs;
+		if (c.kind == Kind::Bitmap)
+		{
+			if (other.kind == Kind::Bitmap)
+			{
+				for (unsigned i = 0; i < BitmapWords; ++i)
+					if (other.words[i] & ~c.words[i])
+						return false;
+				return true;
+			}
+			other.getIntervals(theirs);
+			return std::all_of(theirs.begin(), theirs.end(), [&c](const Interval& i) { return c.allSet(i.first, i.last); });
+		}
+		// Intervals are maximal, so each of theirs must lie inside one of mine
+		IntervalVec mine;
+		c.getIntervals(mine);
+		other.getIntervals(theirs);
+		auto im = mine.begin();
+		for (auto const& i: theirs)
+		{
+			while (im != mine.end() && im->last < i.first)
+				++im;
+			if (im == mine.end() || im->first > i.first || im->last < i.last)
+				return false;
+		}
+		return true;
+	}
+
+	// Return true if c and other share an element
+	static bool intersectContainers(const Container& c, const Container& other)
+	{
+		if (c.kind == Kind::Bitmap && other.kind == Kind::Bitmap)
+		{
+			for (unsigned i = 0; i < BitmapWords; ++i)
+				if (c.words[i] & other.words[i])
+					return true;
+			return false;
+		}
+		if (other.kind == Kind::Bitmap)
+			return intersectContainers(other, c);
+		IntervalVec theirs;
+		other.getIntervals(theirs);
+		if (c.kind == Kind::Bitmap)
+			return std::any_of(theirs.begin(), theirs.end(), [&c](const Interval& i) { return c.anySet(i.first, i.last); });
+
+		IntervalVec mine;
+		c.getIntervals(mine);
+		auto im = mine.begin(), it = theirs.begin();
+		while (im != mine.end() && it != theirs.end())
+		{
+			if (im->last < it->first)
+				++im;
+			else if (it->last < im->first)
+				++it;
+			else
+				return true;
+		}
+		return false;
+	}
+
+	// Make c the elements of c that are not in other
+	static void subtractContainer(Container& c, const Container& other)
+	{
+		if (c.kind == Kind::Bitmap && other.kind == Kind::Bitmap)
+		{
+			for (unsigned i = 0; i < BitmapWords; ++i)
+				c.words[i] &= ~other.words[i];
+			c.recount();
+			if (c.card > MaxArraySize)
+				return;
+		}
+
+		IntervalVec mine, theirs, result;
+		c.getIntervals(mine);
+		other.getIntervals(theirs);
+		auto it = theirs.begin();
+		for (auto i: mine)
+		{
+			while (it != theirs.end() && it->last < i.first)
+				++it;
+			for (auto jt = it; jt != theirs.end() && jt->first <= i.last; ++jt)
+			{
+				if (jt->first > i.first)
+					result.push_back(Interval{i.first, jt->first - 1});
+				if (jt->last >= i.last)
+				{
+					i.first = i.last + 1;
+					break;
+				}
+				i.first = jt->last + 1;
+			}
+			if (i.first <= i.last)
+				result.push_back(i);
+		}
+		c.assignIntervals(result);
+	}
+
+	static bool equalContainers(const Container& c, const Container& other)
+	{
+		if (c.key != other.key || c.card != other.card)
+			return false;
+		if (c.kind == other.kind)
+			return c.kind == Kind::Bitmap ? c.words == other.words : c.data == other.data;
+		IntervalVec mine, theirs;
+		c.getIntervals(mine);
+		other.getIntervals(theirs);
+		return mine.size() == theirs.size() && std::equal(mine.begin(), mine.end(), theirs.begin(), [](const Interval& a, const Interval& b) { return a.first == b.first && a.last == b.last; });
+	}
+
+	// Sorted by key
+	std::vector<Container> containers;
+
+	// The first container whose key is at or after key
+	std::vector<Container>::const_iterator findContainer(uint16_t key) const
+	{
+		return std::lower_bound(containers.begin(), containers.end(), key, [](const Container& c, uint16_t k) { return c.key < k; });
+	}
+public:
+	// Enumerate the elements in increasing order
+	class iterator: public std::iterator<std::forward_iterator_tag, unsigned>
+	{
+	private:
+		const std::vector<Container>* containers;
+		unsigned index;
+		uint32_t low;
+	public:
+		iterator(const std::vector<Container>* c, unsigned i): containers(c), index(i), low(0)
+		{
+			if (index != containers->size())
+				(*containers)[index].findFrom(0, low);
+		}
+
+		bool operator==(const iterator& other) const { return index == other.index && low == other.low; }
+		bool operator!=(const iterator& other) const { return !(*this == other); }
+
+		unsigned operator*() const { return (unsigned((*containers)[index].key) << 16) | low; }
+
+		iterator& operator++()
+		{
+			if (!(*containers)[index].findFrom(low + 1, low))
+			{
+				low = 0;
+				if (++index != containers->size())
+					(*containers)[index].findFrom(0, low);
+			}
+			return *this;
+		}
+		iterator operator++(int)
+		{
+			iterator ret = *this;
+			++*this;
+			return ret;
+		}
+	};
+
+	bool test(unsigned idx) const
+	{
+		auto itr = findContainer(idx >> 16);
+		return itr != containers.end() && itr->key == (idx >> 16) && itr->has(idx & 0xffff);
+	}
+
+	// Return true if idx was not there before
+	bool testAndSet(unsigned idx)
+	{
+		auto itr = containers.begin() + (findContainer(idx >> 16) - containers.begin());
+		if (itr == containers.end() || itr->key != (idx >> 16))
+			itr = containers.insert(itr, Container(idx >> 16));
+		return itr->insert(idx & 0xffff);
+	}
+
+	// Return the number of elements *this gains, which is 0 if it doesn't change
+	unsigned unionWith(const AndersRoaringBitmap& other)
+	{
+		unsigned gained = 0;
+		unsigned i = 0;
+		for (auto const& c: other.containers)
+		{
+			while (i < containers.size() && containers[i].key < c.key)
+				++i;
+			if (i < containers.size() && containers[i].key == c.key)
+				gained += unionContainers(containers[i], c);
+			else
+			{
+				containers.insert(containers.begin() + i, c);
+				gained += c.card;
+			}
+			++i;
+		}
+		return gained;
+	}
+
+	// Return true if *this has every element of other
+	bool contains(const AndersRoaringBitmap& other) const
+	{
+		auto itr = containers.begin();
+		for (auto const& c: other.containers)
+		{
+			while (itr != containers.end() && itr->key < c.key)
+				++itr;
+			if (itr == containers.end() || itr->key != c.key || !containsContainer(*itr, c))
+				return false;
+		}
+		return true;
+	}
+
+	// Return true if *this and other share an element
+	bool intersects(const AndersRoaringBitmap& other) const
+	{
+		auto i = containers.begin(), j = other.containers.begin();
+		while (i != containers.end() && j != other.containers.end())
+		{
+			if (i->key < j->key)
+				++i;
+			else if (j->key < i->key)
+				++j;
+			else if (intersectContainers(*i++, *j++))
+				return true;
+		}
+		return false;
+	}
+
+	// Make *this the elements of lhs that are not in rhs
+	void assignDifference(const AndersRoaringBitmap& lhs, const AndersRoaringBitmap& rhs)
+	{
+		std::vector<Container> result;
+		auto j = rhs.containers.begin();
+		for (auto const& c: lhs.containers)
+		{
+			while (j != rhs.containers.end() && j->key < c.key)
+				++j;
+			result.push_back(c);
+			if (j != rhs.containers.end() && j->key == c.key)
+			{
+				subtractContainer(result.back(), *j);
+				if (result.back().card == 0)
+					result.pop_back();
+			}
+		}
+		containers.swap(result);
+	}
+
+	void clear()
+	{
+		containers.clear();
+	}
+
+	std::size_t getMemoryUsage() const
+	{
+		std::size_t ret = getVectorMemoryUsage(containers);
+		for (auto const& c: containers)
+			ret += getVectorMemoryUsage(c.data) + getVectorMemoryUsage(c.words);
+		return ret;
+	}
+
+	unsigned count() const
+	{
+		unsigned ret = 0;
+		for (auto const& c: containers)
+			ret += c.card;
+		return ret;
+	}
+	bool empty() const
+	{
+		return containers.empty();
+	}
+
+	// The same elements may be held in different kinds of containers
+	bool operator==(const AndersRoaringBitmap& other) const
+	{
+		return containers.size() == other.containers.size() && std::equal(containers.begin(), containers.end(), other.containers.begin(), equalContainers);
+	}
+
+	iterator begin() const { return iterator(&containers, 0); }
+	iterator end() const { return iterator(&containers, containers.size()); }
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef ANDERSEN_SOLVER_CHECKPOINT_H
+#define ANDERSEN_SOLVER_CHECKPOINT_H
+
+#include "Constraint.h"
+#include "ConstraintGraph.h"
+#include "NodeFactory.h"
+#include "PtsGraph.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The state of the sequential worklist solver between two of its iterations, written every so often with -anders-checkpoint=<file> and solved on from with -anders-resume=<file>, so that a run that is killed doesn't start over. Between two iterations, everything the solver still has to do is in the merges, the points-to sets, the constraint graph and the current work list; the rest of its state (the cycle candidates of LCD, the propagated sets of difference propagation, the work list order) only decides how fast it gets to the fixed point, and starts afresh
+// The file is laid out like the results file (see WordFile.h). It is only good for the constraints it was written from, which a hash of them guards: the run that resumes collects and optimizes them again, with the same module and the same options, and picks up the solving from the checkpoint
+namespace SolverCheckpointFormat
+{
+	enum: std::uint32_t { Magic = 0x504b4341 /* "ACKP" */, Version = 1 };
+
+	struct Header
+	{
+		std::uint64_t constraintHash;
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t numNodes;
+		// Either numNodes, or 0 if the solving didn't use HCD
+		std::uint32_t numCollapseTargets;
+		std::uint32_t numSets;
+		std::uint32_t numElems;
+		std::uint32_t numCopyEdges;
+		std::uint32_t numLoadEdges;
+		std::uint32_t numStoreEdges;
+		std::uint32_t numFieldEdges;
+		std::uint32_t numWorkListNodes;
+		std::uint32_t reserved;
+	};
+	// The arrays that follow the header, in this order:
+	//   mergeTarget[numNodes]                the representative of each node
+	//   collapseTargets[numCollapseTargets]  the HCD collapse target of each node, or InvalidIndex
+	//   setNodes[numSets]                    the nodes that have a points-to set
+	//   setOffsets[numSets + 1]              where the set of each starts in elems
+	//   elems[numElems]                      the elements of the sets. The null object, which the sets keep apart, is its node
+	//   copyEdges[2 * numCopyEdges]          (src, dst) pairs
+	//   loadEdges[2 * numLoadEdges]
+	//   storeEdges[2 * numStoreEdges]
+	//   fieldEdges[3 * numFieldEdges]        (src, dst, offset) triples
+	//   workList[numWorkListNodes]
+}
+
+class SolverCheckpoint
+{
+private:
+	std::unique_ptr<llvm::MemoryBuffer> buffer;
+	const SolverCheckpointFormat::Header* header;
+	const std::uint32_t* mergeTarget;
+	const std::uint32_t* collapseTargets;
+	const std::uint32_t* setNodes;
+	const std::uint32_t* setOffsets;
+	const std::uint32_t* elems;
+	const std::uint32_t* copyEdges;
+	const std::uint32_t* loadEdges;
+	const std::uint32_t* storeEdges;
+	const std::uint32_t* fieldEdges;
+	const std::uint32_t* workList;
+
+	SolverCheckpoint() = default;
+	bool isValid(std::string& error) const;
+public:
+	// The hash of what the solver starts from: the number of nodes and the constraints, before any of them is solved
+	static std::uint64_t hashConstraints(unsigned numNodes, llvm::ArrayRef<AndersConstraint> constraints, llvm::ArrayRef<AndersFieldConstraint> fieldConstraints);
+
+	// Write the state of the solver into fileName. It goes into a temporary file first, which replaces fileName once it is complete, so that a run killed while writing leaves the last checkpoint as it was. Return false and put the reason into error if the file can't be written
+	static bool write(llvm::StringRef fileName, std::uint64_t constraintHash, const AndersNodeFactory& nodeFactory, const AndersPtsGraph& ptsGraph, const ConstraintGraph& constraintGraph, llvm::ArrayRef<NodeIndex> collapseTargets, llvm::ArrayRef<NodeIndex> workList, std::string& error);
+	// Return nullptr and put the reason into error if the file is not a valid checkpoint for numNodes nodes and the constraints of constraintHash
+	static std::unique_ptr<SolverCheckpoint> load(llvm::StringRef fileName, std::uint64_t constraintHash, unsigned numNodes, std::string& error);
+	static std::unique_ptr<SolverCheckpoint> load(std::unique_ptr<llvm::MemoryBuffer> buffer, std::uint64_t constraintHash, unsigned numNodes, std::string& error);
+
+	bool hasCollapseTargets() const { return header->numCollapseTargets != 0; }
+	std::vector<NodeIndex> getCollapseTargets() const { return std::vector<NodeIndex>(collapseTargets, collapseTargets + header->numCollapseTargets); }
+	llvm::ArrayRef<std::uint32_t> getWorkList() const { return llvm::ArrayRef<std::uint32_t>(workList, header->numWorkListNodes); }
+
+	// Replace the merges of nodeFactory and fill the empty ptsGraph, which must have a slot for every node, and constraintGraph with the state of the checkpoint
+	void restore(AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, ConstraintGraph& constraintGraph) const;
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef ANDERSEN_SOLVER_TRACE_H
+#define ANDERSEN_SOLVER_TRACE_H
+
+#include "PerfCounters.h"
+#include "PtsGraph.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// What the solver did during one outer iteration, i.e. one pass over the current work list (one round of the parallel solver, one sweep of the wave solver). The solvers always count; the counts are only written out when tracing
+struct SolverIterationStats
+{
+	// Nodes taken off the work list (for the parallel solver, the nodes of the round, and for the wave solver, the nodes swept)
+	unsigned workListPops = 0;
+	// Copy edges inserted while resolving load and store constraints
+	unsigned copyEdges = 0;
+	// Points-to set unions along copy edges, and how many of them changed the target set
+	unsigned unions = 0;
+	unsigned changedUnions = 0;
+	// Nodes LCD has queued for cycle detection, and the nodes collapsed by it and by the sweeps of -anders-scc-sweep (by the SCC pass with -enable-wave)
+	unsigned lcdCandidates = 0;
+	unsigned cycleCollapses = 0;
+	// Nodes merged by online HCD
+	unsigned hcdMerges = 0;
+	// Nodes merged by online pointer equivalence
+	unsigned equivMerges = 0;
+};
+
+// The work of whole solvings, summed over their outer iterations (see Andersen::getSolverWork()). Unlike the time, it is the same on every machine, which is what the budgets of the performance tests (unittest/AndersPerfTest.cpp) are put on
+struct AndersSolverWork
+{
+	std::uint64_t iterations = 0;
+	std::uint64_t workListPops = 0;
+	std::uint64_t copyEdges = 0;
+	std::uint64_t unions = 0;
+	std::uint64_t changedUnions = 0;
+	std::uint64_t cycleCollapses = 0;
+	std::uint64_t merges = 0;
+
+	void addIteration(const SolverIterationStats& stats);
+	AndersSolverWork& operator+=(const AndersSolverWork& other);
+};
+
+// The trace written with -anders-trace=<file>: one JSON object per line, one line per outer iteration of the solver
+// The fields are the iteration number, the engine ("worklist", "parallel" or "wave"), the sizes of the current work list at the start of the iteration and of the next one at its end (for the wave solver, the number of nodes swept and 0), the counts of SolverIterationStats, the total number of elements in all points-to sets, and the seconds elapsed since the solving started. With -anders-perf-counters, the record also has the hardware counts of the iteration that are available (see PerfCounters.h), which leave out the time spent writing the trace. Every solving starts a new file
+class SolverTrace
+{
+private:
+	std::unique_ptr<llvm::raw_fd_ostream> os;
+	const char* engine;
+	std::chrono::steady_clock::time_point start;
+	unsigned iteration;
+	std::unique_ptr<AndersPerfCounters> counters;
+public:
+	// Abort with a fatal error if the file can't be opened
+	SolverTrace(llvm::StringRef fileName, const char* e);
+
+	// Write the record of the iteration that has just finished and reset stats for the next one. Summing the sizes of the points-to sets takes time proportional to the graph, which is the price of tracing
+	void endIteration(SolverIterationStats& stats, unsigned workListSize, unsigned nextWorkListSize, const AndersPtsGraph& ptsGraph);
+};
+
+#endif
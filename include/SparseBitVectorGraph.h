@@ -3,25 +3,25 @@
 
 #include "GraphTraits.h"
 #include "NodeFactory.h"
+#include "PooledSparseBitVector.h"
 
-#include "llvm/ADT/SparseBitVector.h"
 #include "llvm/ADT/DenseMap.h"
 
 #include <algorithm>
 #include <unordered_map>
 
-// The node of a graph class where successor edges are represented by sparse bit vectors
+// The node of a graph class where successor edges are represented by sparse bit vectors. Their elements come from the arena of the graph
 class SparseBitVectorGraphNode
 {
 private:
 	NodeIndex idx;
-	llvm::SparseBitVector<> succs;
+	PooledSparseBitVector succs;
 
 	void insertEdge(NodeIndex n) { return succs.set(n); }
 
-	SparseBitVectorGraphNode(NodeIndex i): idx(i) {}
+	SparseBitVectorGraphNode(NodeIndex i, SparseBitVectorArena& arena): idx(i), succs(arena) {}
 public:
-	using iterator = llvm::SparseBitVector<>::iterator;
+	using iterator = PooledSparseBitVector::iterator;
 
 	NodeIndex getNodeIndex() const { return idx; }
 
@@ -29,8 +29,10 @@ public:
 	iterator end() const { return succs.end(); }
 
 	unsigned succ_getSize() const { return succs.count(); }
+	bool hasEdge(NodeIndex n) const { return succs.test(n); }
 
 	friend class SparseBitVectorGraph;
+	friend class DenseSparseBitVectorGraph;
 };
 
 // A graph class where successor edges are represented by sparse bit vectors
@@ -39,6 +41,8 @@ class SparseBitVectorGraph
 private:
 	// Here we cannot use DenseMap because we need iterator stability: we might want to call getOrInsertNode() when another node is being iterated
 	using NodeMapTy = std::unordered_map<NodeIndex, SparseBitVectorGraphNode>;
+	// It must outlive the nodes
+	SparseBitVectorArena arena;
 	NodeMapTy graph;
 public:
 	using iterator = NodeMapTy::iterator;
@@ -48,7 +52,7 @@ private:
 	{
 		auto itr = graph.find(idx);
 		if (itr == graph.end())
-			itr = graph.insert(std::make_pair(idx, SparseBitVectorGraphNode(idx))).first;
+			itr = graph.insert(std::make_pair(idx, SparseBitVectorGraphNode(idx, arena))).first;
 		return itr;
 	}
 public:
@@ -88,9 +92,16 @@ public:
 
 	unsigned getSize() const { return graph.size(); }
 
+	// The edges, in the slabs of the arena, and the hash table of the nodes, each of which holds the next pointer and the cached hash besides the node (see MemoryUsage.h)
+	std::size_t getMemoryUsage() const
+	{
+		return arena.getMemoryUsage() + graph.bucket_count() * sizeof(void*) + graph.size() * (sizeof(NodeMapTy::value_type) + 2 * sizeof(void*));
+	}
+
 	void releaseMemory()
 	{
-		graph.clear();
+		NodeMapTy().swap(graph);
+		arena.reset();
 	}
 
 	iterator begin() { return graph.begin(); }
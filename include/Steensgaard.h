@@ -0,0 +1,42 @@
+#ifndef ANDERSEN_STEENSGAARD_H
+#define ANDERSEN_STEENSGAARD_H
+
+#include "Constraint.h"
+#include "NodeFactory.h"
+#include "PtsSet.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <utility>
+#include <vector>
+
+// A unification-based (Steensgaard) points-to analysis of a constraint set. The nodes fall into equivalence classes, and all the nodes of a class point to the objects of one pointee class. A copy, load or store unifies the pointee classes of its two sides instead of adding an inclusion between them, so the analysis takes near-linear time, and its points-to sets hold those of Andersen's analysis of the same constraints
+// That makes it a cheap upper bound: a node the solver has not finished with can be given its Steensgaard set and the results stay sound (see -enable-steensgaard-fallback)
+class SteensgaardAnalysis
+{
+private:
+	unsigned numNodes;
+	// The union-find over the classes. The nodes come first, and the pointee classes made up for the nodes that point to nothing known yet sit past them
+	std::vector<NodeIndex> parent;
+	// The pointee class of each class, indexed by its representative. InvalidIndex if the class points to nothing
+	std::vector<NodeIndex> pointee;
+	// The objects of each class that has any, indexed by its representative
+	llvm::DenseMap<NodeIndex, AndersPtsSet> objectsOfClass;
+	// The pairs of classes unify() has yet to merge
+	std::vector<std::pair<NodeIndex, NodeIndex>> unifyStack;
+
+	NodeIndex find(NodeIndex n);
+	NodeIndex getOrCreatePointee(NodeIndex n);
+	// Merge the two classes, then their pointee classes, and so on down the chain
+	void unify(NodeIndex a, NodeIndex b);
+public:
+	// The constraints refer to the nodes of nodeFactory, whose merge targets are followed the way buildConstraintGraph() follows them
+	SteensgaardAnalysis(const std::vector<AndersConstraint>& constraints, const AndersNodeFactory& nodeFactory);
+
+	// The objects n may point to, or nullptr if it points to nothing
+	const AndersPtsSet* getPointsToSet(NodeIndex n) const;
+	// The number of classes the nodes fall into
+	unsigned getNumClasses() const;
+};
+
+#endif
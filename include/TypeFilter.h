@@ -0,0 +1,26 @@
+#ifndef ANDERSEN_TYPE_FILTER_H
+#define ANDERSEN_TYPE_FILTER_H
+
+#include "NodeFactory.h"
+#include "PtsSet.h"
+
+#include <vector>
+
+// With -anders-type-filter, the points-to set of a typed pointer only keeps the objects that its pointee type may live in, the way code that respects strict aliasing accesses memory. The pointers are grouped into type classes by pointee type, and each class excludes the objects whose type neither contains the pointee type nor is contained in it (the analysis is field-insensitive, so a pointer to a field points to the object of the whole struct)
+// Pointers to i8 and to functions, the nodes without a value, and the objects without a type (the heap, the varargs, the special objects) are never filtered. All pointer types count as one, since they are cast into each other all the time
+class AndersTypeFilter
+{
+private:
+	// The objects each type class excludes, indexed by class
+	std::vector<AndersPtsSet> excludedObjs;
+public:
+	// Give the representatives of nodeFactory their type classes (see AndersNodeFactory::setTypeClasses()), and work out what each class excludes. A representative of nodes of different classes is not filtered
+	explicit AndersTypeFilter(AndersNodeFactory& nodeFactory);
+
+	// Drop from ptsSet, the points-to set of the representative n, the objects that the class of n excludes. Return the number of objects dropped
+	unsigned filter(const AndersNodeFactory& nodeFactory, NodeIndex n, AndersPtsSet& ptsSet) const;
+
+	unsigned getNumClasses() const { return excludedObjs.size(); }
+};
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ANDERSEN_WORD_FILE_H
+#define ANDERSEN_WORD_FILE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// What the binary files of the analysis (the constraint files, the results files and the solver checkpoints) have in common: a header that starts with, or holds, a magic number and a version, followed by flat arrays of words in the byte order of the machine that wrote them. The readers use the arrays in place
+namespace WordFile
+{
+	// FNV-1a. llvm::hash_code may be seeded differently in each process, so it can't be used for something that is stored in a file
+	inline void hashBytes(std::uint64_t& hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+	}
+	enum: std::uint64_t { HashSeed = 0xcbf29ce484222325ull };
+
+	template <typename T>
+	void writeArray(llvm::raw_ostream& os, llvm::ArrayRef<T> array)
+	{
+		static_assert(sizeof(T) == sizeof(std::uint32_t) || sizeof(T) == sizeof(std::uint64_t), "The arrays of the files are made of 32-bit or 64-bit words");
+		os.write(reinterpret_cast<const char*>(array.data()), array.size() * sizeof(T));
+	}
+
+	// Check the header of the file in buffer, and return it. buffer is copied first if it is not aligned for the words, which a mapped file always is. kind says what the file should be in the error message
+	template <typename Header>
+	const Header* readHeader(std::unique_ptr<llvm::MemoryBuffer>& buffer, std::uint32_t magic, std::uint32_t version, const char* kind, std::string& error)
+	{
+		if (reinterpret_cast<uintptr_t>(buffer->getBufferStart()) % alignof(std::uint64_t) != 0)
+			buffer = llvm::MemoryBuffer::getMemBufferCopy(buffer->getBuffer(), buffer->getBufferIdentifier());
+
+		if (buffer->getBufferSize() < sizeof(Header))
+		{
+			error = "truncated header";
+			return nullptr;
+		}
+		const Header* header = reinterpret_cast<const Header*>(buffer->getBufferStart());
+		if (header->magic != magic)
+		{
+			error = std::string("not a ") + kind + ", or written on a machine of another byte order";
+			return nullptr;
+		}
+		if (header->version != version)
+		{
+			error = "unsupported version " + std::to_string(header->version);
+			return nullptr;
+		}
+		return header;
+	}
+}
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef ANDERSEN_WORKLIST_H
+#define ANDERSEN_WORKLIST_H
+
+#include "NodeFactory.h"
+
+#include "llvm/ADT/BitVector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// The order in which the solver visits the nodes on its work lists
+// - FIFO: first in, first out
+// - LRF: the least recently fired (i.e. dequeued) node first
+// - TOPO: nodes that come earlier in the topological order of the constraint graph first
+// - DIVIDED: like TOPO, but the topological order is only approximated by a fixed number of buckets, each one drained in FIFO order. This is cheaper than maintaining a heap
+enum class AndersWorkListPolicy
+{
+	FIFO,
+	LRF,
+	TOPO,
+	DIVIDED,
+};
+
+// The solver switches between a "current" and a "next" work list. This class holds the ordering state those two lists share
+class AndersWorkListOrder
+{
+private:
+	AndersWorkListPolicy policy;
+	// For LRF, the time each node was last fired. For TOPO and DIVIDED, the topological index of each node
+	std::vector<unsigned> priority;
+	unsigned fireClock;
+public:
+	// The priority of nodes that have not been given one
+	static const unsigned LowestPriority = std::numeric_limits<unsigned>::max();
+
+	AndersWorkListOrder(AndersWorkListPolicy p, unsigned numNodes): policy(p), priority(numNodes, p == AndersWorkListPolicy::LRF ? 0 : LowestPriority), fireClock(0) {}
+
+	AndersWorkListPolicy getPolicy() const { return policy; }
+	unsigned getNumNodes() const { return priority.size(); }
+
+	// Smaller value means "visit earlier"
+	unsigned getPriority(NodeIndex n) const
+	{
+		assert(n < priority.size());
+		return priority[n];
+	}
+	void setPriority(NodeIndex n, unsigned p)
+	{
+		assert(n < priority.size());
+		priority[n] = p;
+	}
+
+	// Notify the order that node n is being processed
+	void fire(NodeIndex n)
+	{
+		if (policy == AndersWorkListPolicy::LRF)
+			setPriority(n, ++fireClock);
+	}
+};
+
+// The worklist for our analysis
+// Membership is tracked in a bitvector indexed by NodeIndex, so that a node is never put into the same list twice
+class AndersWorkList
+{
+private:
+	const AndersWorkListOrder& order;
+	llvm::BitVector inList;
+
+	// The FIFO queue
+	std::queue<NodeIndex> list;
+
+	// The priority queue used by LRF and TOPO. The NodeIndex breaks ties so that the order is deterministic
+	typedef std::pair<unsigned, NodeIndex> HeapEntry;
+	std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+
+	// The buckets used by DIVIDED
+	static const unsigned NumBuckets = 64;
+	std::vector<std::deque<NodeIndex>> buckets;
+	unsigned bucketWidth;
+	// All buckets before this one are empty
+	unsigned firstBucket;
+	unsigned numElems;
+
+	unsigned getBucket(NodeIndex n) const
+	{
+		return std::min(order.getPriority(n) / bucketWidth, NumBuckets - 1);
+	}
+public:
+	AndersWorkList(const AndersWorkListOrder& o): order(o), inList(o.getNumNodes()), bucketWidth(1), firstBucket(NumBuckets), numElems(0)
+	{
+		if (order.getPolicy() == AndersWorkListPolicy::DIVIDED)
+		{
+			buckets.resize(NumBuckets);
+			bucketWidth = std::max(1u, (order.getNumNodes() + NumBuckets - 1) / NumBuckets);
+		}
+	}
+
+	void enqueue(NodeIndex elem)
+	{
+		assert(elem < inList.size());
+		if (inList.test(elem))
+			return;
+		inList.set(elem);
+		++numElems;
+
+		switch (order.getPolicy())
+		{
+			case AndersWorkListPolicy::FIFO:
+				list.push(elem);
+				break;
+			case AndersWorkListPolicy::LRF:
+			case AndersWorkListPolicy::TOPO:
+				heap.push(std::make_pair(order.getPriority(elem), elem));
+				break;
+			case AndersWorkListPolicy::DIVIDED:
+			{
+				unsigned b = getBucket(elem);
+				buckets[b].push_back(elem);
+				firstBucket = std::min(firstBucket, b);
+				break;
+			}
+		}
+	}
+
+	NodeIndex dequeue()
+	{
+		assert(!isEmpty() && "Trying to dequeue an empty queue!");
+		NodeIndex ret = AndersNodeFactory::InvalidIndex;
+		switch (order.getPolicy())
+		{
+			case AndersWorkListPolicy::FIFO:
+				ret = list.front();
+				list.pop();
+				break;
+			case AndersWorkListPolicy::LRF:
+			case AndersWorkListPolicy::TOPO:
+				ret = heap.top().second;
+				heap.pop();
+				break;
+			case AndersWorkListPolicy::DIVIDED:
+			{
+				while (buckets[firstBucket].empty())
+					++firstBucket;
+				ret = buckets[firstBucket].front();
+				buckets[firstBucket].pop_front();
+				break;
+			}
+		}
+		inList.reset(ret);
+		--numElems;
+		return ret;
+	}
+
+	bool isEmpty() const { return numElems == 0; }
+	unsigned getSize() const { return numElems; }
+	bool contains(NodeIndex elem) const { return inList.test(elem); }
+	// Put the nodes in the list into elems, in index order rather than the order they would be taken out in
+	void getElements(std::vector<NodeIndex>& elems) const
+	{
+		elems.clear();
+		for (int n = inList.find_first(); n != -1; n = inList.find_next(n))
+			elems.push_back(n);
+	}
+};
+
+#endif
@@ -0,0 +1,207 @@
+#include "AliasMetadata.h"
+#include "AndersenAA.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "anders-alias-metadata"
+
+STATISTIC(NumAnnotatedAccesses, "Number of memory accesses given alias metadata");
+STATISTIC(NumAliasScopes, "Number of alias scopes created");
+
+static cl::opt<unsigned> MaxScopesPerFunction("anders-alias-metadata-max-scopes", cl::desc("The largest number of alias scopes -anders-alias-metadata creates in a function"), cl::init(64));
+
+namespace {
+// A load, store or memory intrinsic, with the ids the function gives to the
+// objects it may access
+struct Access {
+    Instruction* inst;
+    SmallVector<unsigned, 4> objs;
+};
+} // namespace
+
+// Put the objects ptr may point to into access, giving an id to those the
+// function hasn't seen yet. Return false if the analysis doesn't know where
+// ptr points to
+static bool addPointees(const Andersen& anders, const Value* ptr,
+                        Access& access,
+                        DenseMap<NodeIndex, unsigned>& objectIds,
+                        std::vector<unsigned>& classOfObject) {
+    ptr = ptr->stripPointerCasts();
+    AndersPtsSetView view;
+    if (!anders.getPointsToSetView(ptr, view) || view.hasUniversalObject())
+        return false;
+    if (view.isEmpty())
+        // Only null, which no access may go through
+        return true;
+
+    // The objects of a set are all in the alias class of its pointer
+    unsigned cls = anders.getAliasClass(ptr);
+    for (auto obj : view.getNodes()) {
+        auto ins = objectIds.insert(std::make_pair(obj, objectIds.size()));
+        if (ins.second)
+            classOfObject.push_back(cls);
+        access.objs.push_back(ins.first->second);
+    }
+    return true;
+}
+
+bool addAliasMetadata(Function& f, const Andersen& anders) {
+    if (MaxScopesPerFunction < 2)
+        return false;
+
+    std::vector<Access> accesses;
+    DenseMap<NodeIndex, unsigned> objectIds;
+    std::vector<unsigned> classOfObject;
+    for (auto& inst : instructions(f)) {
+        SmallVector<const Value*, 2> ptrs;
+        if (auto load = dyn_cast<LoadInst>(&inst))
+            ptrs.push_back(load->getPointerOperand());
+        else if (auto store = dyn_cast<StoreInst>(&inst))
+            ptrs.push_back(store->getPointerOperand());
+        else if (auto memInst = dyn_cast<MemIntrinsic>(&inst)) {
+            ptrs.push_back(memInst->getRawDest());
+            if (auto transfer = dyn_cast<MemTransferInst>(memInst))
+                ptrs.push_back(transfer->getRawSource());
+        } else
+            continue;
+
+        Access access{&inst, {}};
+        if (!std::all_of(ptrs.begin(), ptrs.end(), [&](const Value* ptr) {
+                return addPointees(anders, ptr, access, objectIds,
+                                   classOfObject);
+            }) ||
+            access.objs.empty())
+            continue;
+        accesses.push_back(std::move(access));
+    }
+
+    // The scope of each object. Any grouping of the objects is sound, since an
+    // access is only noalias with the scopes that have none of its objects
+    unsigned numObjects = objectIds.size();
+    std::vector<unsigned> scopeOfObject(numObjects);
+    unsigned numScopes = numObjects;
+    if (numObjects <= MaxScopesPerFunction) {
+        for (unsigned i = 0; i < numObjects; ++i)
+            scopeOfObject[i] = i;
+    } else {
+        // One scope per alias class, by decreasing number of accesses. The
+        // classes past the limit share the last scope
+        DenseMap<unsigned, unsigned> accessesOfClass;
+        for (auto const& access : accesses) {
+            SmallVector<unsigned, 4> classes;
+            for (auto obj : access.objs)
+                classes.push_back(classOfObject[obj]);
+            std::sort(classes.begin(), classes.end());
+            classes.erase(std::unique(classes.begin(), classes.end()),
+                          classes.end());
+            for (auto cls : classes)
+                ++accessesOfClass[cls];
+        }
+        std::vector<std::pair<unsigned, unsigned>> classes;
+        for (auto const& mapping : accessesOfClass)
+            classes.push_back(std::make_pair(mapping.second, mapping.first));
+        std::sort(classes.begin(), classes.end(),
+                  [](const std::pair<unsigned, unsigned>& a,
+                     const std::pair<unsigned, unsigned>& b) {
+                      return a.first != b.first ? a.first > b.first
+                                                : a.second < b.second;
+                  });
+        numScopes = std::min<unsigned>(classes.size(), MaxScopesPerFunction);
+        DenseMap<unsigned, unsigned> scopeOfClass;
+        for (unsigned i = 0, e = classes.size(); i < e; ++i)
+            scopeOfClass[classes[i].second] = std::min(i, numScopes - 1);
+        for (unsigned i = 0; i < numObjects; ++i)
+            scopeOfObject[i] = scopeOfClass.lookup(classOfObject[i]);
+    }
+    // With a single scope, every access may alias every other one
+    if (numScopes < 2)
+        return false;
+
+    LLVMContext& ctx = f.getContext();
+    MDBuilder mdb(ctx);
+    MDNode* domain = mdb.createAnonymousAliasScopeDomain(f.getName());
+    std::vector<Metadata*> scopes;
+    for (unsigned i = 0; i < numScopes; ++i)
+        scopes.push_back(mdb.createAnonymousAliasScope(domain));
+    NumAliasScopes += numScopes;
+
+    std::vector<bool> inScope(numScopes);
+    SmallVector<Metadata*, 8> scopeList, noAliasList;
+    for (auto& access : accesses) {
+        std::fill(inScope.begin(), inScope.end(), false);
+        for (auto obj : access.objs)
+            inScope[scopeOfObject[obj]] = true;
+        scopeList.clear();
+        noAliasList.clear();
+        for (unsigned i = 0; i < numScopes; ++i)
+            (inScope[i] ? scopeList : noAliasList).push_back(scopes[i]);
+
+        // The lists are uniqued, so the accesses with the same scopes share
+        // them. The scopes of other domains are left as they are
+        Instruction* inst = access.inst;
+        inst->setMetadata(
+            LLVMContext::MD_alias_scope,
+            MDNode::concatenate(inst->getMetadata(LLVMContext::MD_alias_scope),
+                                MDNode::get(ctx, scopeList)));
+        if (!noAliasList.empty())
+            inst->setMetadata(
+                LLVMContext::MD_noalias,
+                MDNode::concatenate(inst->getMetadata(LLVMContext::MD_noalias),
+                                    MDNode::get(ctx, noAliasList)));
+        ++NumAnnotatedAccesses;
+    }
+    return true;
+}
+
+static bool addAliasMetadata(Module& m, const Andersen& anders) {
+    bool changed = false;
+    for (auto& f : m)
+        if (!f.isDeclaration())
+            changed |= addAliasMetadata(f, anders);
+    return changed;
+}
+
+PreservedAnalyses AndersenAliasMetadataPass::run(Module& m,
+                                                 ModuleAnalysisManager& am) {
+    if (!addAliasMetadata(m, am.getResult<AndersenAA>(m).getAndersen()))
+        return PreservedAnalyses::all();
+
+    // Only metadata has changed, so the analysis itself still holds
+    PreservedAnalyses pa;
+    pa.preserveSet<CFGAnalyses>();
+    pa.preserve<AndersenAA>();
+    return pa;
+}
+
+void AndersenAliasMetadataWrapperPass::getAnalysisUsage(
+    AnalysisUsage& AU) const {
+    AU.addRequired<AndersenAAWrapperPass>();
+    AU.addPreserved<AndersenAAWrapperPass>();
+    AU.setPreservesCFG();
+}
+
+bool AndersenAliasMetadataWrapperPass::runOnModule(Module& m) {
+    return addAliasMetadata(
+        m, getAnalysis<AndersenAAWrapperPass>().getResult().getAndersen());
+}
+
+AndersenAliasMetadataWrapperPass::AndersenAliasMetadataWrapperPass()
+    : ModulePass(ID) {}
+
+char AndersenAliasMetadataWrapperPass::ID = 0;
+static RegisterPass<AndersenAliasMetadataWrapperPass>
+    X("anders-alias-metadata",
+      "Encode Andersen alias analysis results as alias metadata", false,
+      false);
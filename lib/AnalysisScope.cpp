@@ -0,0 +1,122 @@
+#include "Andersen.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+cl::list<std::string> ScopeFunctions("anders-scope", cl::desc("Only collect the constraints of the functions listed (comma separated). The calls to the other defined functions are treated like calls to unknown external functions"), cl::CommaSeparated);
+cl::opt<bool> ScopeReachable("anders-scope-reachable", cl::desc("Take the functions of -anders-scope as roots, and collect every function their direct calls reach as well"));
+
+extern cl::opt<bool> EnableIncremental;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumScopedOutFunctions, "Number of defined functions left out of -anders-scope");
+STATISTIC(NumScopeEntries, "Number of functions in -anders-scope that may be called from outside of it");
+STATISTIC(NumScopeExposedGlobals, "Number of global variables that the functions outside of -anders-scope may write to");
+
+// Fill scopedOut with the defined functions that are out of the scope. Only the bodies in the scope are walked, so the cost of the collection follows the size of the scope rather than that of the module
+void Andersen::selectScope(const Module& m)
+{
+	std::vector<const Function*> roots(runOptions.scope.begin(), runOptions.scope.end());
+	for (auto const& name: ScopeFunctions)
+	{
+		if (const Function* f = m.getFunction(name))
+			roots.push_back(f);
+		else
+			errs() << "-anders-scope: no function named " << name << " in the module\n";
+	}
+	if (roots.empty())
+		return;
+
+	// A lazily read module has no bodies or uses to find the boundary of the scope in, a summary has to stand for all of its module, and -anders-incremental collects the changed functions again whatever the scope
+	if (EnableIncremental || lazyBodies || summary)
+	{
+		errs() << "-anders-scope is not supported with -anders-incremental, summaries or a lazily read module, and will be ignored\n";
+		return;
+	}
+
+	DenseSet<const Function*> inScope;
+	std::vector<const Function*> workList;
+	auto addToScope = [&inScope, &workList] (const Function* f)
+	{
+		if (!f->isDeclaration() && inScope.insert(f).second)
+			workList.push_back(f);
+	};
+	for (auto f: roots)
+		addToScope(f);
+	// The indirect calls are left alone: whatever they may call out of the scope is treated as external
+	while ((runOptions.scopeReachable || ScopeReachable) && !workList.empty())
+	{
+		const Function* f = workList.back();
+		workList.pop_back();
+		for (auto const& inst: instructions(*f))
+		{
+			ImmutableCallSite cs(&inst);
+			if (cs && cs.getCalledFunction() != nullptr)
+				addToScope(cs.getCalledFunction());
+		}
+	}
+
+	for (auto const& f: m)
+		if (!f.isDeclaration() && !f.isIntrinsic() && !inScope.count(&f))
+			scopedOut.insert(&f);
+	NumScopedOutFunctions += scopedOut.size();
+}
+
+// What the functions out of the scope may do to those in it, like the unknown external functions do to everything: call them with any arguments, and write anything into the globals they use. The functions in the scope that are called from outside of it, or whose addresses are taken and so may be called from anywhere, get the universal pointer for their arguments. The globals used outside of the scope get it stored into them
+void Andersen::addScopeBoundaryConstraints(const Module& m)
+{
+	if (scopedOut.empty())
+		return;
+
+	// Through the constant expressions, which have no function of their own
+	auto isUsedOutOfScope = [this] (const Value* v)
+	{
+		SmallVector<const Value*, 8> workList(1, v);
+		SmallPtrSet<const Value*, 8> visited;
+		while (!workList.empty())
+		{
+			const Value* curr = workList.pop_back_val();
+			for (auto user: curr->users())
+			{
+				if (const Instruction* inst = dyn_cast<Instruction>(user))
+				{
+					if (scopedOut.count(inst->getFunction()))
+						return true;
+				}
+				else if (isa<ConstantExpr>(user) && visited.insert(user).second)
+					workList.push_back(user);
+			}
+		}
+		return false;
+	};
+
+	NodeIndex universalPtr = nodeFactory.getUniversalPtrNode();
+	for (auto const& f: m)
+	{
+		if (isExternalFunction(f) || (!isAddressTaken(f) && !isUsedOutOfScope(&f)))
+			continue;
+		++NumScopeEntries;
+		for (auto const& arg: f.args())
+			if (arg.getType()->isPointerTy())
+				constraints.emplace_back(AndersConstraint::COPY, nodeFactory.getValueNodeFor(&arg), universalPtr);
+		if (f.isVarArg())
+			constraints.emplace_back(AndersConstraint::COPY, nodeFactory.getVarargNodeFor(&f), universalPtr);
+	}
+
+	for (auto const& globalVal: m.globals())
+	{
+		if (!isUsedOutOfScope(&globalVal))
+			continue;
+		++NumScopeExposedGlobals;
+		constraints.emplace_back(AndersConstraint::STORE, nodeFactory.getValueNodeFor(&globalVal), universalPtr);
+	}
+}
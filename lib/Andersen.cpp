@@ -1,67 +1,519 @@
 #include "Andersen.h"
+#include "Parallel.h"
+#include "PhaseTimer.h"
+#include "llvm/ADT/IntEqClasses.h"
 
 #include "llvm/ADT/Statistic.h"
 #include "llvm/IR/Module.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+
+#include <algorithm>
 
 using namespace llvm;
 
 cl::opt<bool> DumpDebugInfo("dump-debug", cl::desc("Dump debug info into stderr"), cl::init(false), cl::Hidden);
 cl::opt<bool> DumpResultInfo("dump-result", cl::desc("Dump result info into stderr"), cl::init(false), cl::Hidden);
 cl::opt<bool> DumpConstraintInfo("dump-cons", cl::desc("Dump constraint info into stderr"), cl::init(false), cl::Hidden);
+cl::opt<bool> EnableRenumber("anders-renumber", cl::desc("Renumber the nodes after collection so that the object nodes are packed together"), cl::init(true), cl::Hidden);
+cl::opt<std::string> WriteConstraintsFile("anders-write-constraints", cl::desc("Save the collected constraints into a file that andersen-solve can load"), cl::value_desc("filename"));
+cl::opt<std::string> WriteResultsFile("anders-write-results", cl::desc("Save the solved results into a file that PersistedAndersResults can load"), cl::value_desc("filename"));
+cl::opt<std::string> ExportResultsFile("anders-export-results", cl::desc("Export the solved results into a file, in the binary format of ResultsExport.h"), cl::value_desc("filename"));
+cl::opt<bool> ExportResultsAsText("anders-export-text", cl::desc("Write the file of -anders-export-results as text instead"));
+cl::opt<bool> EnableConstraintStreaming("enable-constraint-streaming", cl::desc("Build the constraint graph while the constraints are collected, instead of from the full list of constraints afterwards. Only possible without the offline optimizations, and the object nodes are not renumbered"));
+cl::opt<bool> DeferSolving("anders-defer-solving", cl::desc("Only collect the constraints when the analysis runs, and optimize and solve them on the first query"));
+cl::opt<bool> BackgroundSolving("anders-background-solving", cl::desc("Optimize and solve the constraints on a thread of their own once they are collected, and make the first query wait for the results. Implies -anders-defer-solving"));
+cl::opt<bool> DumpCallGraphInfo("dump-callgraph", cl::desc("Dump the indirect call targets resolved by -enable-otf-callgraph into stderr"), cl::init(false), cl::Hidden);
+
+// The options of the passes that read the constraint vector between the collection and the solver
+extern cl::opt<bool> EnableIncremental;
+extern cl::opt<bool> EnableAppend;
+extern cl::opt<bool> EnableOnTheFlyCallGraph;
+extern cl::opt<bool> EnableDeadPointerElim;
+extern cl::opt<bool> EnableCopyCoalescing;
+extern cl::opt<bool> EnableValueTracking;
+extern cl::opt<bool> EnableHVN, EnableHU, EnableHRU, EnableLE;
+extern cl::opt<bool> EnableHCD, EnablePartition, EnableSteensgaardFallback;
+extern cl::opt<bool> EnableAutoConfig;
+// The options of the solvers that know nothing about the field constraints
+extern cl::opt<bool> EnableWave, EnableMatrixSolver;
+extern cl::opt<unsigned> NumSolverThreads, NumCollectThreads, NumOptimizerThreads;
+extern cl::opt<unsigned> HotNodeCount;
+extern cl::opt<unsigned> FunctionCostCount;
 
 Andersen::Andersen(const Module& module)
 {
 	runOnModule(module);
 }
 
+Andersen::Andersen(const Module& module, const AndersRunOptions& options): runOptions(options)
+{
+	runOnModule(module);
+}
+
+bool Andersen::startPhase(AndersPhase phase)
+{
+	if (isCancelRequested())
+		return false;
+	sampleMemoryUsage(getPhaseName(phase));
+	if (runOptions.onProgress)
+		runOptions.onProgress(AndersProgress{phase, nodeFactory.getNumNodes(), static_cast<unsigned>(constraints.size()), 0, 0});
+	return true;
+}
+
 void Andersen::getAllAllocationSites(std::vector<const llvm::Value*>& allocSites) const
 {
+	waitForSolution();
 	nodeFactory.getAllocSites(allocSites);
 }
 
 bool Andersen::getPointsToSet(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet) const
 {
-	NodeIndex ptrIndex = nodeFactory.getValueNodeFor(v);
-	// We have no idea what v is...
-	if (ptrIndex == AndersNodeFactory::InvalidIndex || ptrIndex == nodeFactory.getUniversalPtrNode())
+	AndersPtsSetView view;
+	if (!getPointsToSetView(v, view) || view.hasUniversalObject())
 		return false;
 
-	NodeIndex ptrTgt = nodeFactory.getMergeTarget(ptrIndex);
-	ptsSet.clear();
+	ptsSet.assign(view.begin(), view.end());
+	return true;
+}
+
+bool Andersen::getPointsToSetView(const llvm::Value* v, AndersPtsSetView& view) const
+{
+	return getPointsToSetViewOfNode(nodeFactory.getValueNodeFor(v), view);
+}
+
+bool Andersen::getPointsToSetViewOfNode(NodeIndex ptrIndex, AndersPtsSetView& view) const
+{
+	waitForSolution();
+	// We have no idea what the pointer is...
+	if (ptrIndex >= nodeFactory.getNumNodes() || ptrIndex == nodeFactory.getUniversalPtrNode())
+		return false;
 
-	auto ptsItr = ptsGraph.find(ptrTgt);
-	if (ptsItr == ptsGraph.end())
+	NodeIndex ptrTgt = nodeFactory.getMergeTarget(ptrIndex);
+	CompactPtsSet ptrPtsSet(nullptr, nullptr);
+	if (!solvedPtsGraph.find(ptrTgt, ptrPtsSet))
 	{
 		// Can't find ptrTgt. The reason might be that ptrTgt is an undefined pointer. Dereferencing it is undefined behavior anyway, so we might just want to treat it as a nullptr pointer
+		view = AndersPtsSetView(nodeFactory, locationClasses, CompactPtsSet(nullptr, nullptr));
 		return true;
 	}
-	for (auto v: ptsItr->second)
+	view = AndersPtsSetView(nodeFactory, locationClasses, ptrPtsSet);
+	return true;
+}
+
+void Andersen::getPointsToSets(llvm::ArrayRef<const llvm::Value*> values, std::vector<std::vector<const llvm::Value*>>& ptsSets, llvm::BitVector& unknown) const
+{
+	waitForSolution();
+	ptsSets.assign(values.size(), std::vector<const Value*>());
+	unknown.clear();
+	unknown.resize(values.size());
+
+	// The values whose sets have been put into ptsSets, by set id. Any other value with the same set gets a copy
+	DenseMap<unsigned, unsigned> firstValueOfSet;
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
 	{
-		if (v == nodeFactory.getNullObjectNode())
+		NodeIndex ptrIndex = nodeFactory.getValueNodeFor(values[i]);
+		if (ptrIndex == AndersNodeFactory::InvalidIndex || ptrIndex == nodeFactory.getUniversalPtrNode())
+		{
+			unknown.set(i);
+			continue;
+		}
+
+		unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(ptrIndex));
+		if (setId == CompactPtsGraph::NoSlot)
+			continue;
+		if (solvedPtsGraph.getSet(setId).has(nodeFactory.getUniversalObjNode()))
+		{
+			unknown.set(i);
 			continue;
+		}
+
+		auto itr = firstValueOfSet.find(setId);
+		if (itr != firstValueOfSet.end())
+			ptsSets[i] = ptsSets[itr->second];
+		else
+		{
+			firstValueOfSet[setId] = i;
+			getValuesInPtsSet(solvedPtsGraph.getSet(setId), ptsSets[i]);
+		}
+	}
+}
+
+void Andersen::getValuesInPtsSet(const CompactPtsSet& ptsSet, std::vector<const llvm::Value*>& vals) const
+{
+	AndersPtsSetView view(nodeFactory, locationClasses, ptsSet);
+	vals.insert(vals.end(), view.begin(), view.end());
+}
+
+bool Andersen::getPointedBySet(const llvm::Value* allocSite, std::vector<const llvm::Value*>& pointers) const
+{
+	waitForSolution();
+	if (nodeFactory.getObjectNodeFor(allocSite) == AndersNodeFactory::InvalidIndex)
+		return false;
+
+	std::call_once(*pointedByIndexFlag, [this] { buildPointedByIndex(); });
 
-		const llvm::Value* val = nodeFactory.getValueForNode(v);
-		if (val != nullptr)
-			ptsSet.push_back(val);
+	pointers.clear();
+	auto itr = pointedByIndex->setsOfObject.find(allocSite);
+	if (itr == pointedByIndex->setsOfObject.end())
+		return true;
+	for (auto setId: itr->second)
+	{
+		auto const& setPointers = pointedByIndex->pointersOfSet[setId];
+		pointers.insert(pointers.end(), setPointers.begin(), setPointers.end());
 	}
 	return true;
 }
 
+// Invert getPointsToSet() once for all pointers. An object is related to the ids of the sets that have it rather than to the pointers themselves: there are far fewer distinct sets than pointers
+void Andersen::buildPointedByIndex() const
+{
+	std::unique_ptr<PointedByIndex> index(new PointedByIndex);
+
+	std::vector<const Value*> objs;
+	for (unsigned id = 0, e = solvedPtsGraph.getNumSets(); id < e; ++id)
+	{
+		objs.clear();
+		getValuesInPtsSet(solvedPtsGraph.getSet(id), objs);
+		for (auto obj: objs)
+			index->setsOfObject[obj].set(id);
+	}
+
+	// The pointers getPointsToSet() knows, with the sets they have. Sort them by node so that the answers don't depend on the layout of the value map
+	std::vector<std::pair<NodeIndex, const Value*>> pointerNodes;
+	for (auto itr = nodeFactory.value_node_begin(), ite = nodeFactory.value_node_end(); itr != ite; ++itr)
+	{
+		if (itr->second != nodeFactory.getUniversalPtrNode())
+			pointerNodes.emplace_back(itr->second, itr->first);
+	}
+	std::sort(pointerNodes.begin(), pointerNodes.end());
+
+	index->pointersOfSet.resize(solvedPtsGraph.getNumSets());
+	for (auto const& pointerNode: pointerNodes)
+	{
+		unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(pointerNode.first));
+		if (setId != CompactPtsGraph::NoSlot)
+			index->pointersOfSet[setId].push_back(pointerNode.second);
+	}
+
+	pointedByIndex = std::move(index);
+}
+
+unsigned Andersen::getAliasClass(const llvm::Value* v) const
+{
+	waitForSolution();
+	NodeIndex ptrIndex = nodeFactory.getValueNodeFor(v);
+	if (ptrIndex == AndersNodeFactory::InvalidIndex || ptrIndex == nodeFactory.getUniversalPtrNode())
+		return UniversalAliasClass;
+	// As in getPointsToSetView(), a pointer without a set is taken to be undefined
+	unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(ptrIndex));
+	if (setId == CompactPtsGraph::NoSlot)
+		return NoAliasClass;
+
+	std::call_once(*aliasClassIndexFlag, [this] { buildAliasClassIndex(); });
+	return aliasClassIndex->classOfSet[setId];
+}
+
+unsigned Andersen::getNumAliasClasses() const
+{
+	waitForSolution();
+	std::call_once(*aliasClassIndexFlag, [this] { buildAliasClassIndex(); });
+	return aliasClassIndex->numClasses;
+}
+
+// Join the sets that have an object in common, with a union-find over the set ids, since the pointers that share a set are in the same class anyway. The location classes need no care: the objects of a class only appear in the sets through their key
+void Andersen::buildAliasClassIndex() const
+{
+	std::unique_ptr<AliasClassIndex> index(new AliasClassIndex);
+	unsigned numSets = solvedPtsGraph.getNumSets();
+	index->classOfSet.assign(numSets, NoAliasClass);
+
+	NodeIndex universalObj = nodeFactory.getUniversalObjNode();
+	NodeIndex lastSpecialObj = std::max(universalObj, nodeFactory.getNullObjectNode());
+	IntEqClasses setClasses(numSets);
+	// The first set seen with each object
+	std::vector<unsigned> setOfObject(nodeFactory.getNumNodes(), CompactPtsGraph::NoSlot);
+	for (unsigned id = 0; id < numSets; ++id)
+	{
+		const CompactPtsSet& set = solvedPtsGraph.getSet(id);
+		if (set.has(universalObj))
+		{
+			index->classOfSet[id] = UniversalAliasClass;
+			continue;
+		}
+		for (auto obj: set.getElementsAfter(lastSpecialObj))
+		{
+			if (setOfObject[obj] == CompactPtsGraph::NoSlot)
+				setOfObject[obj] = id;
+			else
+				setClasses.join(setOfObject[obj], id);
+		}
+	}
+
+	// Number the classes in the order of their first set, which keeps the ids the same from one run to the next
+	std::vector<unsigned> classOfLeader(numSets, NoAliasClass);
+	unsigned numClasses = 0;
+	for (unsigned id = 0; id < numSets; ++id)
+	{
+		if (index->classOfSet[id] == UniversalAliasClass || solvedPtsGraph.getSet(id).getElementsAfter(lastSpecialObj).isEmpty())
+			continue;
+		unsigned& leaderClass = classOfLeader[setClasses.findLeader(id)];
+		if (leaderClass == NoAliasClass)
+			leaderClass = numClasses++;
+		index->classOfSet[id] = leaderClass;
+	}
+	index->numClasses = numClasses;
+
+	aliasClassIndex = std::move(index);
+}
+
+unsigned Andersen::getPointeeCategories(const llvm::Value* v) const
+{
+	waitForSolution();
+	NodeIndex ptrIndex = nodeFactory.getValueNodeFor(v);
+	if (ptrIndex == AndersNodeFactory::InvalidIndex || ptrIndex == nodeFactory.getUniversalPtrNode())
+		return AndersNodeFactory::UniversalObject;
+	unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(ptrIndex));
+	return setId == CompactPtsGraph::NoSlot ? 0 : getSetCategories(setId);
+}
+
+unsigned Andersen::getSetCategories(unsigned setId) const
+{
+	std::call_once(*setCategoriesFlag, [this] { buildSetCategories(); });
+	return setCategories[setId];
+}
+
+void Andersen::buildSetCategories() const
+{
+	// The categories of the location classes, folded into their representatives
+	std::vector<unsigned char> objCategories(nodeFactory.getNumNodes());
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+		objCategories[n] = nodeFactory.getObjectCategories(n);
+	for (auto const& mapping: locationClasses)
+		for (auto member: mapping.second)
+			objCategories[mapping.first] |= nodeFactory.getObjectCategories(member);
+
+	setCategories.assign(solvedPtsGraph.getNumSets(), 0);
+	for (unsigned id = 0, e = solvedPtsGraph.getNumSets(); id < e; ++id)
+		for (auto obj: solvedPtsGraph.getSet(id))
+			setCategories[id] |= objCategories[obj];
+}
+
+void Andersen::dropQueryIndices()
+{
+	setCategories.clear();
+	setCategoriesFlag.reset(new std::once_flag);
+	pointedByIndex.reset();
+	pointedByIndexFlag.reset(new std::once_flag);
+	aliasClassIndex.reset();
+	aliasClassIndexFlag.reset(new std::once_flag);
+	resolvedCallGraph.reset();
+	resolvedCallGraphFlag.reset(new std::once_flag);
+}
+
+bool Andersen::getIndirectCallTargets(const Instruction* callInst, std::vector<const Function*>& targets) const
+{
+	waitForSolution();
+	auto itr = indirectCallIndex.find(callInst);
+	if (itr == indirectCallIndex.end())
+		return false;
+
+	const IndirectCallRecord& call = indirectCalls[itr->second];
+	if (call.unknownTarget)
+		return false;
+
+	targets = call.targets;
+	return true;
+}
+
 bool Andersen::runOnModule(const Module &M)
 {
-	collectConstraints(M);
+	if (EnableDeadPointerElim)
+	{
+		// A lazily read module has no bodies left to look for the query roots in
+		if (EnableIncremental || lazyBodies)
+			errs() << "-enable-dead-pointer-elim is not supported with -anders-incremental or a lazily read module, and will be ignored\n";
+		else
+			pruneForQueries = true;
+	}
+
+	if (EnableCopyCoalescing)
+	{
+		// Both hand the constraints on as they were collected, without the merges
+		if (EnableIncremental || !WriteConstraintsFile.empty())
+			errs() << "-anders-coalesce-copies is not supported with -anders-incremental or -anders-write-constraints, and will be ignored\n";
+		else
+			coalesceCopies = true;
+	}
+
+	if (EnableConstraintStreaming)
+	{
+		if (canStreamConstraints() && !pruneForQueries)
+			streamedGraph.reset(new ConstraintGraph);
+		else
+			errs() << "-enable-constraint-streaming is not supported with the offline optimizations, -enable-partition, -enable-steensgaard-fallback, -anders-incremental, -anders-write-constraints or the constraint dumps, and will be ignored\n";
+	}
+
+	if (EnableAppend)
+	{
+		// The offline optimizations merge the nodes that the constraints they see can't tell apart, which the appended constraints may. The on-the-fly call graph and the dead pointers would have to look at the old code again
+		if (EnableOnTheFlyCallGraph || EnableHVN || EnableHU || EnableHRU || EnableLE || EnableAutoConfig || pruneForQueries || lazyBodies)
+			errs() << "-anders-append is not supported with -enable-otf-callgraph, -enable-hvn, -enable-hu, -enable-hru, -enable-le, -anders-auto-config, -enable-dead-pointer-elim or a lazily read module, and will be ignored\n";
+		else
+			appendState.reset(new AppendState);
+	}
+
+	bool trackValues = false;
+	if (EnableValueTracking)
+	{
+		// The handles go on once the results are there, and stay on the values the analysis knows afterwards
+		if (EnableIncremental || DeferSolving || BackgroundSolving || lazyBodies)
+			errs() << "-anders-track-values is not supported with -anders-incremental, -anders-defer-solving, -anders-background-solving or a lazily read module, and will be ignored\n";
+		else
+			trackValues = true;
+	}
+
+	AndersThreadPool::Scope poolScope(getThreadPool());
+	{
+		startPhase(AndersPhase::Collection);
+		AndersPhaseTimer timer(AndersPhase::Collection);
+		collectConstraints(M);
+
+		// The streamed constraints are in the graph already, under the indices they were collected with
+		if (EnableRenumber && !streamedGraph)
+			renumberNodes();
+
+		if (pruneForQueries)
+			findQueryRoots(M);
+	}
+
+	if (!WriteConstraintsFile.empty())
+	{
+		std::error_code ec;
+		raw_fd_ostream os(WriteConstraintsFile, ec, sys::fs::F_None);
+		if (ec)
+			report_fatal_error(Twine("Cannot write constraints to ") + WriteConstraintsFile + ": " + ec.message());
+		writeConstraints(os);
+	}
+
+	if (DeferSolving || BackgroundSolving)
+	{
+		deferredSolve.reset(new DeferredSolve);
+		deferredSolve->module = &M;
+		if (BackgroundSolving)
+			deferredSolve->worker = std::thread([this] { solveModule(*deferredSolve->module); });
+		return false;
+	}
+
+	solveModule(M);
+	if (trackValues)
+		startTrackingValues();
+	return false;
+}
+
+void Andersen::solveModule(const Module& M)
+{
+	solveCollectedConstraints();
+
+	if (!WriteResultsFile.empty())
+	{
+		std::error_code ec;
+		raw_fd_ostream os(WriteResultsFile, ec, sys::fs::F_None);
+		if (ec)
+			report_fatal_error(Twine("Cannot write results to ") + WriteResultsFile + ": " + ec.message());
+		writeSolvedResults(M, os);
+	}
+
+	if (!ExportResultsFile.empty())
+	{
+		std::error_code ec;
+		raw_fd_ostream os(ExportResultsFile, ec, ExportResultsAsText ? sys::fs::F_Text : sys::fs::F_None);
+		if (ec)
+			report_fatal_error(Twine("Cannot export results to ") + ExportResultsFile + ": " + ec.message());
+		if (ExportResultsAsText)
+		{
+			AndersTextResultsWriter writer(os);
+			exportResults(M, writer);
+		}
+		else
+		{
+			AndersBinaryResultsWriter writer(os);
+			exportResults(M, writer);
+		}
+	}
+}
+
+void Andersen::waitForSolution() const
+{
+	if (!deferredSolve)
+		return;
+	// The queries only see the solved results, which the deferred solving produces just as runOnModule() would have, so they are const all the same
+	std::call_once(deferredSolve->solved, [this] {
+		if (deferredSolve->worker.joinable())
+			deferredSolve->worker.join();
+		else
+			const_cast<Andersen*>(this)->solveModule(*deferredSolve->module);
+	});
+}
+
+bool Andersen::canStreamConstraints()
+{
+	return !EnableIncremental && WriteConstraintsFile.empty() && !DumpDebugInfo && !DumpConstraintInfo && !EnableHVN && !EnableHU && !EnableHRU && !EnableLE && !EnableHCD && !EnablePartition && !EnableSteensgaardFallback && !EnableAutoConfig;
+}
+
+bool Andersen::canUseFieldConstraints()
+{
+	return !EnableIncremental && !EnableAppend && WriteConstraintsFile.empty() && !EnableConstraintStreaming && !EnableLE && !EnablePartition && !EnableSteensgaardFallback && !EnableWave && !EnableMatrixSolver && getNumWorkerThreads(NumSolverThreads) <= 1;
+}
+
+AndersThreadPool* Andersen::getThreadPool()
+{
+	if (runOptions.threadPool != nullptr)
+		return runOptions.threadPool;
+	unsigned numThreads = std::max({ getNumWorkerThreads(NumSolverThreads), getNumWorkerThreads(NumCollectThreads), getNumWorkerThreads(NumOptimizerThreads) });
+	if (!threadPool && numThreads > 1)
+		threadPool.reset(new AndersThreadPool(numThreads));
+	return threadPool.get();
+}
+
+void Andersen::solveCollectedConstraints()
+{
+	// The deferred solving runs this on a thread of its own
+	AndersThreadPool::Scope poolScope(getThreadPool());
 
 	if (DumpDebugInfo)
 		dumpConstraintsPlainVanilla();
 
-	optimizeConstraints();
+	AndersAutoConfig savedOptions;
+	if (EnableAutoConfig)
+		savedOptions = applyAutoConfig();
+
+	if (FunctionCostCount > 0)
+		assignCostTags();
+	// The constraints appended by appendDefinitions() are solved on from the last solution, whose merges the offline optimizations know nothing about
+	if (!appendState || !appendState->graph)
+		optimizeConstraints();
 
 	if (DumpConstraintInfo)
 		dumpConstraints();
 
 	solveConstraints();
+	solvingGraph = nullptr;
+	hcdTableMemory = 0;
+
+	if (EnableAutoConfig)
+		restoreAutoConfigOptions(savedOptions);
+
+	if (HotNodeCount > 0)
+		writeHotNodeReport();
+	if (FunctionCostCount > 0)
+	{
+		writeFunctionCostReport();
+		nodeFactory.setCostTags(std::vector<SmallVector<unsigned, 2>>());
+		costTagFunctions.clear();
+	}
+	nodeProfile.reset();
 
 	if (DumpDebugInfo)
 	{
@@ -75,9 +527,57 @@ bool Andersen::runOnModule(const Module &M)
 		errs() << "\n";
 		dumpPtsGraphPlainVanilla();	
 	}
-	
 
-	return false;
+	if (DumpCallGraphInfo)
+		dumpIndirectCallTargets();
+
+	compactResults();
+	sampleMemoryUsage("the end of the analysis");
+}
+
+// The analysis object stays alive as long as its clients make queries, which may be for the rest of the compilation. Keep only what the queries need, in a read-only form
+void Andersen::compactResults()
+{
+	nodeFactory.flattenMergeTargets();
+	// The fields of an object have been told apart while solving, but the queries see the objects as a whole: a pointer to a struct and a pointer to one of its fields may access the same memory
+	if (nodeFactory.hasFieldNodes())
+	{
+		for (auto node: ptsGraph)
+		{
+			AndersPtsSet& ptsSet = ptsGraph[node];
+			AndersPtsSet objs;
+			bool hasFields = false;
+			for (auto obj: ptsSet)
+			{
+				unsigned fieldIndex = nodeFactory.getFieldIndex(obj);
+				objs.insert(obj - fieldIndex);
+				hasFields |= fieldIndex != 0;
+			}
+			if (!hasFields)
+				continue;
+			if (ptsSet.hasNullObject())
+				objs.insertNullObject();
+			ptsSet = std::move(objs);
+		}
+	}
+	solvedPtsGraph.build(ptsGraph, nodeFactory);
+	if (appendState)
+		appendState->ptsGraph = std::move(ptsGraph);
+	ptsGraph = AndersPtsGraph();
+
+	std::vector<AndersConstraint>().swap(constraints);
+	std::vector<AndersFieldConstraint>().swap(fieldConstraints);
+	std::vector<NodeIndex>().swap(lateCopyTargets);
+	// updateFunctions() and appendDefinitions() collect function bodies later on, which needs the tables of the call targets
+	if (!incrementalState && !appendState)
+	{
+		std::vector<std::vector<IndirectCallTarget>>().swap(fixedArityTargets);
+		std::vector<IndirectCallTarget>().swap(varargTargets);
+		typeSlotTargets.clear();
+		externalLibraryKinds.clear();
+	}
+	for (auto& call: indirectCalls)
+		call.examinedObjs.clear();
 }
 
 void Andersen::dumpConstraint(const AndersConstraint& item) const
@@ -138,17 +638,48 @@ void Andersen::dumpConstraintsPlainVanilla() const
 
 void Andersen::dumpPtsGraphPlainVanilla() const
 {
+	// errs() is unbuffered, which would make a write of every number
+	errs().SetBuffered();
 	for (unsigned i = 0, e = nodeFactory.getNumNodes(); i < e; ++i)
 	{
 		NodeIndex rep = nodeFactory.getMergeTarget(i);
-		auto ptsItr = ptsGraph.find(rep);
-		if (ptsItr != ptsGraph.end())
+		const AndersPtsSet* repPtsSet = ptsGraph.find(rep);
+		if (repPtsSet != nullptr)
 		{
 			errs() << i << " ";
-			for (auto v: ptsItr->second)
+			// The null object is kept apart from the other elements. Put it back in its place in the order
+			bool nullObject = repPtsSet->hasNullObject();
+			for (auto v: *repPtsSet)
+			{
+				if (nullObject && v > nodeFactory.getNullObjectNode())
+				{
+					errs() << nodeFactory.getNullObjectNode() << " ";
+					nullObject = false;
+				}
 				errs() << v << " ";
+			}
+			if (nullObject)
+				errs() << nodeFactory.getNullObjectNode() << " ";
 			errs() << "\n";
 		}
 	}
+	errs().SetUnbuffered();
 }
 
+void Andersen::dumpIndirectCallTargets() const
+{
+	errs() << "\n----- Indirect Call Targets -----\n";
+	for (auto const& call: indirectCalls)
+	{
+		errs() << *call.inst << "\n\t-->> ";
+		if (call.unknownTarget)
+			errs() << "<unknown>";
+		else
+		{
+			for (auto f: call.targets)
+				errs() << f->getName() << " ";
+		}
+		errs() << "\n";
+	}
+	errs() << "----- End of Print -----\n";
+}
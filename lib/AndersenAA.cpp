@@ -1,50 +1,192 @@
 #include "AndersenAA.h"
 
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
 
 using namespace llvm;
 
-static inline bool isSetContainingOnly(const AndersPtsSet& set, NodeIndex i) {
-    return (set.getSize() == 1) && (*set.begin() == i);
+#define DEBUG_TYPE "anders-aa"
+
+STATISTIC(NumAliasCacheHits, "Number of alias queries answered by the cache");
+STATISTIC(NumAliasCacheMisses, "Number of alias queries that missed the cache");
+
+cl::opt<unsigned> AliasCacheSize("anders-alias-cache-size", cl::desc("The number of entries of the cache of alias query answers (0 to disable the cache)"), cl::init(1 << 16));
+
+void AndersenAAResult::ensureSolved() {
+    unsigned version = anders->getTrackedVersion();
+    if (frozen && frozenVersion == version)
+        return;
+    anders->waitForSolution();
+    frozen = std::make_shared<AndersFrozenResults>(anders);
+    // The set ids stay what they were, so the alias cache holds, but the
+    // objects of the summaries may have changed
+    if (frozenVersion != version)
+        modRefBuilt = false;
+    frozenVersion = version;
 }
 
 AliasResult AndersenAAResult::andersenAlias(const Value* v1, const Value* v2) {
-    NodeIndex n1 =
-        (anders.nodeFactory)
-            .getMergeTarget((anders.nodeFactory).getValueNodeFor(v1));
-    NodeIndex n2 =
-        (anders.nodeFactory)
-            .getMergeTarget((anders.nodeFactory).getValueNodeFor(v2));
-
-    if (n1 == n2)
-        return MustAlias;
+    ensureSolved();
+    return aliasResolved(frozen->resolvePointer(v1),
+                         frozen->resolvePointer(v2));
+}
 
-    auto itr1 = (anders.ptsGraph).find(n1), itr2 = (anders.ptsGraph).find(n2);
-    if (itr1 == (anders.ptsGraph).end() || itr2 == (anders.ptsGraph).end())
-        // We knows nothing about at least one of (v1, v2)
+AliasResult AndersenAAResult::aliasResolved(const ResolvedPointer& p1,
+                                            const ResolvedPointer& p2) {
+    if (p1.rep == AndersNodeFactory::InvalidIndex ||
+        p2.rep == AndersNodeFactory::InvalidIndex)
         return MayAlias;
 
-    AndersPtsSet &s1 = itr1->second, s2 = itr2->second;
-    bool isNull1 =
-        isSetContainingOnly(s1, (anders.nodeFactory).getNullObjectNode());
-    bool isNull2 =
-        isSetContainingOnly(s2, (anders.nodeFactory).getNullObjectNode());
-    if (isNull1 || isNull2)
-        // If any of them is null, we know that they must not alias each other
-        return NoAlias;
-
-    if (s1.getSize() == 1 && s2.getSize() == 1 && *s1.begin() == *s2.begin())
+    if (p1.rep == p2.rep)
         return MustAlias;
 
-    // Compute the intersection of s1 and s2
-    for (auto const& idx : s1) {
-        if (idx == (anders.nodeFactory).getNullObjectNode())
+    return aliasSets(p1.setId, p2.setId);
+}
+
+AliasResult AndersenAAResult::aliasSets(unsigned id1, unsigned id2) {
+    AliasResult result = MayAlias;
+    if (frozen->aliasSummaries(id1, id2, result))
+        return result;
+
+    // Only the queries that get here are worth caching
+    bool mayAlias;
+    if (aliasCache.lookup(id1, id2, mayAlias)) {
+        ++NumAliasCacheHits;
+    } else {
+        ++NumAliasCacheMisses;
+        mayAlias = frozen->intersectSets(id1, id2);
+        aliasCache.insert(id1, id2, mayAlias);
+    }
+    return mayAlias ? MayAlias : NoAlias;
+}
+
+void AndersenAAResult::getAliasResults(const Value* v,
+                                       ArrayRef<const Value*> values,
+                                       std::vector<AliasResult>& results) {
+    ensureSolved();
+    ResolvedPointer p = frozen->resolvePointer(v->stripPointerCasts());
+
+    // Pointers with the same set get the same answer, unless they are merged
+    // with v
+    DenseMap<unsigned, AliasResult> answerForSet;
+    results.clear();
+    results.reserve(values.size());
+    for (auto other : values) {
+        const Value* stripped = other->stripPointerCasts();
+        if (stripped == v->stripPointerCasts()) {
+            results.push_back(MustAlias);
             continue;
-        if (s2.has(idx))
-            return MayAlias;
+        }
+
+        ResolvedPointer q = frozen->resolvePointer(stripped);
+        if (p.rep == AndersNodeFactory::InvalidIndex ||
+            q.rep == AndersNodeFactory::InvalidIndex || p.rep == q.rep ||
+            q.setId == CompactPtsGraph::NoSlot) {
+            results.push_back(aliasResolved(p, q));
+            continue;
+        }
+
+        auto itr = answerForSet.find(q.setId);
+        if (itr == answerForSet.end())
+            itr = answerForSet.insert(std::make_pair(q.setId,
+                                                     aliasSets(p.setId,
+                                                               q.setId)))
+                      .first;
+        results.push_back(itr->second);
     }
+}
+
+void AndersenAAResult::getMayAliasMask(const Value* v,
+                                       ArrayRef<const Value*> values,
+                                       BitVector& mayAlias) {
+    std::vector<AliasResult> results;
+    getAliasResults(v, values, results);
 
-    return NoAlias;
+    mayAlias.clear();
+    mayAlias.resize(values.size());
+    for (unsigned i = 0, e = results.size(); i < e; ++i)
+        if (results[i] != NoAlias)
+            mayAlias.set(i);
+}
+
+void AndersenAAResult::getMayAliasMatrix(ArrayRef<const Value*> values,
+                                         std::vector<BitVector>& mayAlias) {
+    ensureSolved();
+    unsigned numValues = values.size();
+
+    // Bucket the values by their points-to sets. The values the analysis
+    // knows nothing about share a bucket of their own
+    std::vector<ResolvedPointer> resolved;
+    resolved.reserve(numValues);
+    DenseMap<unsigned, unsigned> bucketOfSet;
+    unsigned unknownBucket = ~0u;
+    std::vector<unsigned> bucketSetIds;
+    std::vector<std::vector<unsigned>> bucketMembers;
+    std::vector<unsigned> bucketOf;
+    bucketOf.reserve(numValues);
+    for (unsigned i = 0; i < numValues; ++i) {
+        resolved.push_back(
+            frozen->resolvePointer(values[i]->stripPointerCasts()));
+        unsigned setId = resolved.back().rep == AndersNodeFactory::InvalidIndex
+                             ? CompactPtsGraph::NoSlot
+                             : resolved.back().setId;
+        // NoSlot is the empty key of the map
+        unsigned& bucket = (setId == CompactPtsGraph::NoSlot)
+                               ? unknownBucket
+                               : bucketOfSet.insert(std::make_pair(setId, ~0u))
+                                     .first->second;
+        if (bucket == ~0u) {
+            bucket = bucketSetIds.size();
+            bucketSetIds.push_back(setId);
+            bucketMembers.emplace_back();
+        }
+        bucketOf.push_back(bucket);
+        bucketMembers[bucket].push_back(i);
+    }
+
+    // Compare the buckets pairwise. Two values in the same bucket have equal
+    // sets, so they alias unless they only point to null
+    unsigned numBuckets = bucketSetIds.size();
+    std::vector<BitVector> bucketRows(numBuckets, BitVector(numValues));
+    for (unsigned b1 = 0; b1 < numBuckets; ++b1) {
+        for (unsigned b2 = b1; b2 < numBuckets; ++b2) {
+            if (aliasSets(bucketSetIds[b1], bucketSetIds[b2]) == NoAlias)
+                continue;
+            for (auto i : bucketMembers[b2])
+                bucketRows[b1].set(i);
+            if (b1 != b2)
+                for (auto i : bucketMembers[b1])
+                    bucketRows[b2].set(i);
+        }
+    }
+
+    mayAlias.assign(numValues, BitVector());
+    for (unsigned i = 0; i < numValues; ++i) {
+        mayAlias[i] = bucketRows[bucketOf[i]];
+        // A value aliases itself
+        mayAlias[i].set(i);
+    }
+
+    // The values of a bucket that doesn't alias itself still alias the values
+    // they have been merged with
+    DenseMap<NodeIndex, std::vector<unsigned>> membersOfRep;
+    for (unsigned b = 0; b < numBuckets; ++b) {
+        if (bucketMembers[b].size() < 2 ||
+            bucketRows[b].test(bucketMembers[b][0]))
+            continue;
+        membersOfRep.clear();
+        for (auto i : bucketMembers[b])
+            membersOfRep[resolved[i].rep].push_back(i);
+        for (auto const& mapping : membersOfRep)
+            for (auto i : mapping.second)
+                for (auto j : mapping.second)
+                    mayAlias[i].set(j);
+    }
 }
 
 AliasResult AndersenAAResult::alias(const MemoryLocation& l1,
@@ -66,39 +208,107 @@ AliasResult AndersenAAResult::alias(const MemoryLocation& l1,
 
 bool AndersenAAResult::pointsToConstantMemory(const MemoryLocation& loc,
                                               bool orLocal) {
-    NodeIndex node = (anders.nodeFactory).getValueNodeFor(loc.Ptr);
-    if (node == AndersNodeFactory::InvalidIndex)
-        return false;
-
-    auto itr = (anders.ptsGraph).find(node);
-    if (itr == (anders.ptsGraph).end())
+    ensureSolved();
+    ResolvedPointer p = frozen->resolvePointer(loc.Ptr);
+    if (p.rep == AndersNodeFactory::InvalidIndex ||
+        p.setId == CompactPtsGraph::NoSlot)
         // Not a pointer?
         return false;
 
-    const AndersPtsSet& ptsSet = itr->second;
-    for (auto const& idx : ptsSet) {
-        if (const Value* val = (anders.nodeFactory).getValueForNode(idx)) {
-            if (!isa<GlobalValue>(val) ||
-                (isa<GlobalVariable>(val) &&
-                 !cast<GlobalVariable>(val)->isConstant()))
-                return false;
-        } else {
-            if (idx != (anders.nodeFactory).getNullObjectNode())
-                return false;
+    // Whether all the objects of the set are constant is worked out once per
+    // set when the results are frozen
+    return frozen->getSetSummary(p.setId).constantMemory;
+}
+
+// A hash of the parts of m the constraints are collected from: the globals
+// and their initializers, the functions, and the instructions that define,
+// load, store, pass or return values (together with their operands). The
+// values are hashed by address, so an instruction that is replaced changes the
+// hash even if the new one looks the same
+static size_t hashPointerRelevantIR(const Module& m) {
+    hash_code hash = hash_value(m.getGlobalList().size());
+    for (auto const& g : m.globals())
+        hash = hash_combine(hash, &g,
+                            g.hasDefinitiveInitializer() ? g.getInitializer()
+                                                         : nullptr);
+    for (auto const& f : m) {
+        hash = hash_combine(hash, &f, f.isDeclaration(), f.hasAddressTaken());
+        for (auto const& bb : f) {
+            for (auto const& inst : bb) {
+                if (!inst.getType()->isPointerTy() && !isa<StoreInst>(inst) &&
+                    !isa<CallInst>(inst) && !isa<InvokeInst>(inst) &&
+                    !isa<ReturnInst>(inst))
+                    continue;
+                hash = hash_combine(hash, &inst, inst.getOpcode());
+                for (auto const& op : inst.operands())
+                    hash = hash_combine(hash, op.get());
+            }
         }
     }
+    return hash;
+}
+
+AndersenAAResult::AndersenAAResult(const Module& m)
+    : anders(std::make_shared<Andersen>(m)),
+      irHash(hashPointerRelevantIR(m)),
+      aliasCache(AliasCacheSize) {}
+
+bool AndersenAAResult::isUpToDate(const Module& m) const {
+    if (anders->followsIRChanges())
+        return true;
+    return hashPointerRelevantIR(m) == irHash;
+}
+
+bool AndersenAAResult::invalidate(Module& m, const PreservedAnalyses& pa,
+                                  ModuleAnalysisManager::Invalidator&) {
+    auto checker = pa.getChecker<AndersenAA>();
+    if (checker.preserved() || checker.preservedSet<AllAnalysesOn<Module>>())
+        return false;
 
-    return true;
+    // The pass didn't say it kept the result. It is still good if the pass
+    // didn't touch the IR the constraints come from, which is much cheaper to
+    // check than solving again
+    return !isUpToDate(m);
 }
 
-AndersenAAResult::AndersenAAResult(const Module& m) : anders(m) {}
+void AndersenAAResult::updateFunctions(const Module& m,
+                                       ArrayRef<const Function*> changedFuncs) {
+    anders->updateFunctions(m, changedFuncs);
+    irHash = hashPointerRelevantIR(m);
+    // The set ids are those of the new solution
+    aliasCache = AliasQueryCache(AliasCacheSize);
+    // Rebuilt on the next query, since a module analyzed from scratch may be
+    // solved later
+    frozen.reset();
+    modRefBuilt = false;
+}
+
+void AndersenAAResult::appendDefinitions(const Module& m,
+                                         ArrayRef<const Function*> newFuncs,
+                                         ArrayRef<const GlobalVariable*> newGlobals) {
+    anders->appendDefinitions(m, newFuncs, newGlobals);
+    irHash = hashPointerRelevantIR(m);
+    aliasCache = AliasQueryCache(AliasCacheSize);
+    frozen.reset();
+    modRefBuilt = false;
+}
+
+AnalysisKey AndersenAA::Key;
+
+AndersenAAResult AndersenAA::run(Module& m, ModuleAnalysisManager&) {
+    return AndersenAAResult(m);
+}
 
 void AndersenAAWrapperPass::getAnalysisUsage(AnalysisUsage& AU) const {
     AU.setPreservesAll();
 }
 
 bool AndersenAAWrapperPass::runOnModule(Module& m) {
-    result.reset(new AndersenAAResult(m));
+    // The pass manager runs the pass again whenever a pass that doesn't
+    // preserve it has run. Keep the result if the constraints would be the
+    // same
+    if (result == nullptr || !result->isUpToDate(m))
+        result.reset(new AndersenAAResult(m));
 
     return false;
 }
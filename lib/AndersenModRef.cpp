@@ -0,0 +1,317 @@
+#include "AndersenAA.h"
+
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+// Add the objects ptr may point to to the sets of effect. A pointer the
+// analysis knows nothing about may point to anything
+void AndersenAAResult::addPointeeEffect(const Value* ptr, bool mod, bool ref,
+                                        ModRefEffect& effect) const {
+    ResolvedPointer p = frozen->resolvePointer(ptr->stripPointerCasts());
+    bool unknown = (p.rep == AndersNodeFactory::InvalidIndex);
+    if (!unknown && p.setId != CompactPtsGraph::NoSlot) {
+        const SetSummary& s = frozen->getSetSummary(p.setId);
+        unknown = s.universal;
+        for (auto obj : s.objs) {
+            if (mod)
+                effect.mod.insert(obj);
+            if (ref)
+                effect.ref.insert(obj);
+        }
+    }
+    effect.modAll |= (mod && unknown);
+    effect.refAll |= (ref && unknown);
+}
+
+// The effect of a call to the external function f, from its library model
+// (see ExternalLibrary.cpp) and its attributes. A known library function only
+// touches the memory its pointer arguments point to. An unknown one may touch
+// anything, as its constraints say
+void AndersenAAResult::addExternalCallEffect(ImmutableCallSite cs,
+                                             const Function* f,
+                                             ModRefEffect& effect) const {
+    if (f->doesNotAccessMemory())
+        return;
+
+    Andersen::ExternalLibraryKind kind = Andersen::classifyExternalLibrary(f);
+    if (kind == Andersen::EXT_UNKNOWN && !f->onlyAccessesArgMemory()) {
+        effect.refAll = true;
+        effect.modAll |= !f->onlyReadsMemory();
+        return;
+    }
+
+    for (unsigned i = 0, e = cs.arg_size(); i < e; ++i) {
+        const Value* arg = cs.getArgument(i);
+        if (!arg->getType()->isPointerTy())
+            continue;
+        // memcpy() and friends only write through their first argument and
+        // read through their second
+        bool mod = !f->onlyReadsMemory() &&
+                   (kind != Andersen::EXT_MEMCPY || i == 0);
+        bool ref = (kind != Andersen::EXT_MEMCPY || i != 0);
+        addPointeeEffect(arg, mod, ref, effect);
+    }
+}
+
+// Add what cs does by itself to effect, and put the defined functions it may
+// call into callees. An indirect call may call the functions its callee
+// pointer points to
+void AndersenAAResult::getCallEffect(
+    ImmutableCallSite cs, ModRefEffect& effect,
+    SmallVectorImpl<const Function*>& callees) const {
+    const AndersNodeFactory& nodeFactory = anders->nodeFactory;
+    auto addCallee = [&](const Function* f) {
+        if (f->isDeclaration() || f->isIntrinsic())
+            addExternalCallEffect(cs, f, effect);
+        else
+            callees.push_back(f);
+    };
+
+    if (const Function* f = cs.getCalledFunction()) {
+        addCallee(f);
+        return;
+    }
+
+    ResolvedPointer callee =
+        frozen->resolvePointer(cs.getCalledValue()->stripPointerCasts());
+    if (callee.rep == AndersNodeFactory::InvalidIndex) {
+        effect.modAll = effect.refAll = true;
+        return;
+    }
+    if (callee.setId == CompactPtsGraph::NoSlot)
+        return;
+    const SetSummary& s = frozen->getSetSummary(callee.setId);
+    if (s.universal) {
+        effect.modAll = effect.refAll = true;
+        return;
+    }
+    auto addObject = [&](NodeIndex obj) {
+        if (auto f = dyn_cast_or_null<Function>(nodeFactory.getValueForNode(obj)))
+            addCallee(f);
+    };
+    for (auto obj : s.objs) {
+        addObject(obj);
+        // obj also stands for the objects that are location equivalent to it
+        auto classItr = anders->locationClasses.find(obj);
+        if (classItr != anders->locationClasses.end())
+            for (auto member : classItr->second)
+                if (member != obj)
+                    addObject(member);
+    }
+}
+
+void AndersenAAResult::buildModRefSummaries(const Module& m) {
+    modRefSummaries.clear();
+    modRefElems.clear();
+    modRefSummaryOf.clear();
+    modRefBuilt = true;
+
+    // The effect of each function by itself, and the functions it calls
+    std::vector<const Function*> funcs;
+    DenseMap<const Function*, unsigned> funcIndex;
+    for (auto const& f : m) {
+        if (f.isDeclaration())
+            continue;
+        funcIndex[&f] = funcs.size();
+        funcs.push_back(&f);
+    }
+    unsigned numFuncs = funcs.size();
+    std::vector<ModRefEffect> localEffects(numFuncs);
+    std::vector<std::vector<unsigned>> calls(numFuncs);
+    SmallVector<const Function*, 8> callees;
+    for (unsigned i = 0; i < numFuncs; ++i) {
+        ModRefEffect& effect = localEffects[i];
+        for (auto const& inst : instructions(*funcs[i])) {
+            if (auto load = dyn_cast<LoadInst>(&inst))
+                addPointeeEffect(load->getPointerOperand(), false, true,
+                                 effect);
+            else if (auto store = dyn_cast<StoreInst>(&inst))
+                addPointeeEffect(store->getPointerOperand(), true, false,
+                                 effect);
+            else if (auto vaArg = dyn_cast<VAArgInst>(&inst))
+                // va_arg also advances the va_list
+                addPointeeEffect(vaArg->getPointerOperand(), true, true,
+                                 effect);
+            else if (isa<AtomicRMWInst>(inst) || isa<AtomicCmpXchgInst>(inst))
+                addPointeeEffect(inst.getOperand(0), true, true, effect);
+            else if (ImmutableCallSite cs = ImmutableCallSite(&inst)) {
+                callees.clear();
+                getCallEffect(cs, effect, callees);
+                for (auto callee : callees)
+                    calls[i].push_back(funcIndex.lookup(callee));
+            }
+        }
+        std::sort(calls[i].begin(), calls[i].end());
+        calls[i].erase(std::unique(calls[i].begin(), calls[i].end()),
+                       calls[i].end());
+    }
+
+    // Tarjan's algorithm, with an explicit stack. An SCC is complete only
+    // after the SCCs it calls, so its summary can be put together right away
+    enum : unsigned { Unvisited = ~0u };
+    std::vector<unsigned> dfsNum(numFuncs, Unvisited), lowLink(numFuncs),
+        sccOf(numFuncs, Unvisited);
+    std::vector<unsigned> sccStack, members;
+    std::vector<std::pair<unsigned, unsigned>> dfsStack;
+    // The sets of the completed SCCs, which their callers take in
+    std::vector<ModRefEffect> sccEffects;
+    unsigned timestamp = 0;
+    for (unsigned root = 0; root < numFuncs; ++root) {
+        if (dfsNum[root] != Unvisited)
+            continue;
+        dfsNum[root] = lowLink[root] = timestamp++;
+        sccStack.push_back(root);
+        dfsStack.emplace_back(root, 0);
+        while (!dfsStack.empty()) {
+            unsigned v = dfsStack.back().first;
+            unsigned& nextCall = dfsStack.back().second;
+            if (nextCall < calls[v].size()) {
+                unsigned w = calls[v][nextCall++];
+                if (dfsNum[w] == Unvisited) {
+                    dfsNum[w] = lowLink[w] = timestamp++;
+                    sccStack.push_back(w);
+                    dfsStack.emplace_back(w, 0);
+                } else if (sccOf[w] == Unvisited)
+                    lowLink[v] = std::min(lowLink[v], dfsNum[w]);
+                continue;
+            }
+
+            dfsStack.pop_back();
+            if (!dfsStack.empty()) {
+                unsigned u = dfsStack.back().first;
+                lowLink[u] = std::min(lowLink[u], lowLink[v]);
+            }
+            if (lowLink[v] != dfsNum[v])
+                continue;
+
+            unsigned scc = sccEffects.size();
+            sccEffects.emplace_back();
+            ModRefEffect& effect = sccEffects.back();
+            members.clear();
+            do {
+                members.push_back(sccStack.back());
+                sccStack.pop_back();
+                sccOf[members.back()] = scc;
+            } while (members.back() != v);
+            for (auto member : members) {
+                const ModRefEffect& local = localEffects[member];
+                effect.ref.unionWith(local.ref);
+                effect.mod.unionWith(local.mod);
+                effect.refAll |= local.refAll;
+                effect.modAll |= local.modAll;
+                for (auto callee : calls[member]) {
+                    if (sccOf[callee] == scc)
+                        continue;
+                    const ModRefEffect& calleeEffect = sccEffects[sccOf[callee]];
+                    effect.ref.unionWith(calleeEffect.ref);
+                    effect.mod.unionWith(calleeEffect.mod);
+                    effect.refAll |= calleeEffect.refAll;
+                    effect.modAll |= calleeEffect.modAll;
+                }
+            }
+        }
+    }
+
+    // Keep the summaries in the read-only form the queries use
+    modRefSummaries.reserve(sccEffects.size());
+    for (auto const& effect : sccEffects) {
+        ModRefSummary summary;
+        summary.refBegin = modRefElems.size();
+        for (auto obj : effect.ref)
+            modRefElems.push_back(obj);
+        summary.modBegin = modRefElems.size();
+        for (auto obj : effect.mod)
+            modRefElems.push_back(obj);
+        summary.modEnd = modRefElems.size();
+        std::sort(modRefElems.begin() + summary.refBegin,
+                  modRefElems.begin() + summary.modBegin);
+        std::sort(modRefElems.begin() + summary.modBegin, modRefElems.end());
+        summary.refAll = effect.refAll;
+        summary.modAll = effect.modAll;
+        modRefSummaries.push_back(summary);
+    }
+    for (unsigned i = 0; i < numFuncs; ++i)
+        modRefSummaryOf[funcs[i]] = sccOf[i];
+}
+
+ModRefInfo AndersenAAResult::getModRefInfo(ImmutableCallSite cs,
+                                           const MemoryLocation& loc) {
+    ensureSolved();
+    if (!modRefBuilt)
+        buildModRefSummaries(*cs.getInstruction()->getModule());
+
+    ModRefEffect effect;
+    SmallVector<const Function*, 8> callees;
+    getCallEffect(cs, effect, callees);
+
+    bool mod = effect.modAll, ref = effect.refAll;
+    if (mod && ref)
+        return MRI_ModRef;
+
+    // The objects loc may be in. If the analysis knows nothing about loc, or
+    // loc may be anywhere, any object the call touches may be in loc
+    const SetSummary* locSet = nullptr;
+    bool anywhere = true;
+    if (loc.Ptr->getType()->isPointerTy()) {
+        ResolvedPointer p = frozen->resolvePointer(loc.Ptr->stripPointerCasts());
+        if (p.rep != AndersNodeFactory::InvalidIndex) {
+            if (p.setId == CompactPtsGraph::NoSlot)
+                return MRI_NoModRef;
+            locSet = &frozen->getSetSummary(p.setId);
+            anywhere = locSet->universal;
+            if (!anywhere && locSet->objs.isEmpty())
+                // loc only points to null
+                return MRI_NoModRef;
+        }
+    }
+
+    // Probe the objects of loc, of which there are usually few, in the
+    // summaries, which may be large
+    auto touches = [&](const CompactPtsSet& objs) {
+        if (anywhere)
+            return !objs.isEmpty();
+        for (auto obj : locSet->objs)
+            if (objs.has(obj))
+                return true;
+        return false;
+    };
+    auto touchesEffect = [&](const AndersPtsSet& objs) {
+        if (anywhere)
+            return !objs.isEmpty();
+        for (auto obj : objs)
+            if (locSet->objs.has(obj))
+                return true;
+        return false;
+    };
+    mod = mod || touchesEffect(effect.mod);
+    ref = ref || touchesEffect(effect.ref);
+    for (auto callee : callees) {
+        if (mod && ref)
+            break;
+        auto itr = modRefSummaryOf.find(callee);
+        if (itr == modRefSummaryOf.end())
+            // A function the module didn't have when the summaries were built
+            return MRI_ModRef;
+        const ModRefSummary& summary = modRefSummaries[itr->second];
+        const NodeIndex* elems = modRefElems.data();
+        mod = mod || summary.modAll ||
+              touches(CompactPtsSet(elems + summary.modBegin,
+                                    elems + summary.modEnd));
+        ref = ref || summary.refAll ||
+              touches(CompactPtsSet(elems + summary.refBegin,
+                                    elems + summary.modBegin));
+    }
+
+    if (mod && ref)
+        return MRI_ModRef;
+    if (mod)
+        return MRI_Mod;
+    if (ref)
+        return MRI_Ref;
+    return MRI_NoModRef;
+}
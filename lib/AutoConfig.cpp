@@ -0,0 +1,114 @@
+#include "Andersen.h"
+#include "AutoConfig.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+cl::opt<bool> EnableAutoConfig("anders-auto-config", cl::desc("Choose -enable-hvn, -enable-hu, -enable-hcd and -enable-lcd from statistics of the collected constraints. The options given on the command line are kept as given"));
+static cl::opt<unsigned> AutoHVNThreshold("anders-auto-hvn-constraints", cl::desc("-anders-auto-config: run HVN on at least this many constraints"), cl::init(1000));
+static cl::opt<unsigned> AutoHUThreshold("anders-auto-hu-constraints", cl::desc("-anders-auto-config: run HU on at least this many constraints. Below that, it tends to cost more than it saves"), cl::init(20000));
+static cl::opt<double> AutoHCDRatio("anders-auto-hcd-ratio", cl::desc("-anders-auto-config: use HCD if at least this share of the constraints are loads and stores"), cl::init(0.15));
+static cl::opt<double> AutoLCDRatio("anders-auto-lcd-ratio", cl::desc("-anders-auto-config: use LCD if at least this share of the copies go back to an earlier node"), cl::init(0.05));
+static cl::opt<unsigned> AutoLCDIndirectCalls("anders-auto-lcd-indirect-calls", cl::desc("-anders-auto-config: use LCD if there are at least this many indirect calls"), cl::init(50));
+
+extern cl::opt<bool> EnableHVN, EnableHU, EnableHCD, EnableLCD;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumAutoConfigs, "Number of configurations chosen by -anders-auto-config");
+STATISTIC(NumAutoHVN, "Number of times -anders-auto-config chose HVN");
+STATISTIC(NumAutoHU, "Number of times -anders-auto-config chose HU");
+STATISTIC(NumAutoHCD, "Number of times -anders-auto-config chose HCD");
+STATISTIC(NumAutoLCD, "Number of times -anders-auto-config chose LCD");
+
+AndersConstraintProfile AndersConstraintProfile::compute(unsigned numNodes, ArrayRef<AndersConstraint> constraints, unsigned numIndirectCalls)
+{
+	AndersConstraintProfile ret;
+	ret.numNodes = numNodes;
+	ret.numConstraints = constraints.size();
+	ret.numIndirectCalls = numIndirectCalls;
+	for (auto const& c: constraints)
+	{
+		switch (c.getType())
+		{
+			case AndersConstraint::ADDR_OF:
+				++ret.numAddrOf;
+				break;
+			case AndersConstraint::COPY:
+				++ret.numCopy;
+				if (c.getSrc() > c.getDest())
+					++ret.numBackwardCopies;
+				break;
+			case AndersConstraint::LOAD:
+				++ret.numLoad;
+				break;
+			case AndersConstraint::STORE:
+				++ret.numStore;
+				break;
+		}
+	}
+	return ret;
+}
+
+// HVN is a single linear pass, so it pays off early. HU propagates label sets, which only pays off once there are enough constraints to remove. HCD finds offline the cycles that the loads and stores close during solving, so it is worth it when there are many of them. LCD looks for cycles online, which is wasted where the copy graph has few of them
+AndersAutoConfig AndersAutoConfig::choose(const AndersConstraintProfile& profile)
+{
+	AndersAutoConfig ret;
+	ret.hvn = profile.numConstraints >= AutoHVNThreshold;
+	ret.hu = profile.numConstraints >= AutoHUThreshold;
+	ret.hcd = profile.getComplexRatio() >= AutoHCDRatio;
+	ret.lcd = profile.getBackwardCopyRatio() >= AutoLCDRatio || profile.numIndirectCalls >= AutoLCDIndirectCalls;
+	return ret;
+}
+
+void AndersAutoConfig::print(raw_ostream& os) const
+{
+	const char* sep = "";
+	for (auto const& opt: { std::make_pair(hvn, "hvn"), std::make_pair(hu, "hu"), std::make_pair(hcd, "hcd"), std::make_pair(lcd, "lcd") })
+	{
+		if (opt.first)
+		{
+			os << sep << opt.second;
+			sep = "+";
+		}
+	}
+	if (*sep == '\0')
+		os << "none";
+}
+
+AndersAutoConfig Andersen::applyAutoConfig()
+{
+	AndersAutoConfig saved;
+	saved.hvn = EnableHVN;
+	saved.hu = EnableHU;
+	saved.hcd = EnableHCD;
+	saved.lcd = EnableLCD;
+
+	AndersConstraintProfile profile = AndersConstraintProfile::compute(nodeFactory.getNumNodes(), constraints, numIndirectCallSites);
+	autoConfig.reset(new AndersAutoConfig(AndersAutoConfig::choose(profile)));
+	++NumAutoConfigs;
+
+	for (auto const& choice: { std::make_pair(&EnableHVN, &autoConfig->hvn), std::make_pair(&EnableHU, &autoConfig->hu), std::make_pair(&EnableHCD, &autoConfig->hcd), std::make_pair(&EnableLCD, &autoConfig->lcd) })
+	{
+		// An option the user gave wins over the model, and the choice records what the solving actually uses
+		if (choice.first->getNumOccurrences() != 0)
+			*choice.second = *choice.first;
+		else
+			choice.first->setValue(*choice.second);
+	}
+	NumAutoHVN += autoConfig->hvn;
+	NumAutoHU += autoConfig->hu;
+	NumAutoHCD += autoConfig->hcd;
+	NumAutoLCD += autoConfig->lcd;
+	return saved;
+}
+
+void Andersen::restoreAutoConfigOptions(const AndersAutoConfig& saved)
+{
+	EnableHVN.setValue(saved.hvn);
+	EnableHU.setValue(saved.hu);
+	EnableHCD.setValue(saved.hcd);
+	EnableLCD.setValue(saved.lcd);
+}
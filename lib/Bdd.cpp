@@ -0,0 +1,314 @@
+#include "Bdd.h"
+#include "MemoryUsage.h"
+
+#include <algorithm>
+#include <cassert>
+#include <initializer_list>
+
+using namespace llvm;
+
+// We don't bother collecting garbage when fewer nodes than this are in use
+static const unsigned InitialGCThreshold = 1 << 20;
+// The operation cache is cleared when it grows larger than this
+static const unsigned MaxOpCacheSize = 1 << 22;
+
+AndersBddManager::AndersBddManager(): gcThreshold(InitialGCThreshold)
+{
+	// The two terminals are never freed
+	nodes.push_back(Node{NumVars, False, False, 1});
+	nodes.push_back(Node{NumVars, True, True, 1});
+}
+
+AndersBddManager& AndersBddManager::getGlobalManager()
+{
+	static AndersBddManager manager;
+	return manager;
+}
+
+void AndersBddManager::refLocked(BddRef n)
+{
+	if (n > True)
+		++nodes[n].refCount;
+}
+
+void AndersBddManager::derefLocked(BddRef n)
+{
+	if (n > True)
+	{
+		assert(nodes[n].refCount > 0 && "Dereferencing a dead node!");
+		--nodes[n].refCount;
+	}
+}
+
+AndersBddManager::BddRef AndersBddManager::makeNode(unsigned var, BddRef lo, BddRef hi)
+{
+	// The reduction rule: a test whose two outcomes are the same is redundant
+	if (lo == hi)
+		return lo;
+
+	TripleKey key = std::make_pair(var, std::make_pair(lo, hi));
+	auto itr = uniqueTable.find(key);
+	if (itr != uniqueTable.end())
+		return itr->second;
+
+	BddRef ret;
+	if (!freeList.empty())
+	{
+		ret = freeList.back();
+		freeList.pop_back();
+		nodes[ret] = Node{var, lo, hi, 0};
+	}
+	else
+	{
+		ret = nodes.size();
+		nodes.push_back(Node{var, lo, hi, 0});
+	}
+	refLocked(lo);
+	refLocked(hi);
+	uniqueTable[key] = ret;
+	return ret;
+}
+
+AndersBddManager::BddRef AndersBddManager::apply(OpKind op, BddRef lhs, BddRef rhs)
+{
+	switch (op)
+	{
+		case OP_OR:
+			if (lhs == True || rhs == True)
+				return True;
+			if (lhs == False || lhs == rhs)
+				return rhs;
+			if (rhs == False)
+				return lhs;
+			break;
+		case OP_AND:
+			if (lhs == False || rhs == False)
+				return False;
+			if (lhs == True || lhs == rhs)
+				return rhs;
+			if (rhs == True)
+				return lhs;
+			break;
+		case OP_DIFF:
+			if (lhs == False || rhs == True || lhs == rhs)
+				return False;
+			if (rhs == False)
+				return lhs;
+			break;
+	}
+
+	// OR and AND are commutative
+	if (op != OP_DIFF && lhs > rhs)
+		std::swap(lhs, rhs);
+
+	TripleKey key = std::make_pair(static_cast<unsigned>(op), std::make_pair(lhs, rhs));
+	auto itr = opCache.find(key);
+	if (itr != opCache.end())
+		return itr->second;
+
+	// Don't hold references into nodes across the recursive calls: they may grow the vector
+	Node lhsNode = nodes[lhs], rhsNode = nodes[rhs];
+	unsigned var = std::min(lhsNode.var, rhsNode.var);
+	BddRef lhsLo = lhs, lhsHi = lhs, rhsLo = rhs, rhsHi = rhs;
+	if (lhsNode.var == var)
+	{
+		lhsLo = lhsNode.lo;
+		lhsHi = lhsNode.hi;
+	}
+	if (rhsNode.var == var)
+	{
+		rhsLo = rhsNode.lo;
+		rhsHi = rhsNode.hi;
+	}
+
+	BddRef lo = apply(op, lhsLo, rhsLo);
+	BddRef hi = apply(op, lhsHi, rhsHi);
+	BddRef ret = makeNode(var, lo, hi);
+	opCache[key] = ret;
+	return ret;
+}
+
+AndersBddManager::BddRef AndersBddManager::applyTopLevel(OpKind op, BddRef lhs, BddRef rhs)
+{
+	// Both operands are referenced by the caller, so they survive the collection. Nothing allocated by apply() is collected before we take a reference to the result
+	maybeCollectGarbage();
+	BddRef ret = apply(op, lhs, rhs);
+	refLocked(ret);
+	return ret;
+}
+
+void AndersBddManager::maybeCollectGarbage()
+{
+	if (opCache.size() > MaxOpCacheSize)
+		opCache.clear();
+	if (getNumLiveNodesLocked() < gcThreshold)
+		return;
+
+	collectGarbage();
+	gcThreshold = std::max(InitialGCThreshold, 2 * getNumLiveNodesLocked());
+}
+
+void AndersBddManager::collectGarbage()
+{
+	std::vector<BddRef> deadNodes;
+	for (BddRef n = True + 1, e = nodes.size(); n < e; ++n)
+	{
+		if (nodes[n].var != FreeVar && nodes[n].refCount == 0)
+			deadNodes.push_back(n);
+	}
+
+	while (!deadNodes.empty())
+	{
+		BddRef n = deadNodes.back();
+		deadNodes.pop_back();
+
+		Node node = nodes[n];
+		uniqueTable.erase(std::make_pair(node.var, std::make_pair(node.lo, node.hi)));
+		for (auto child: { node.lo, node.hi })
+		{
+			if (child > True && --nodes[child].refCount == 0)
+				deadNodes.push_back(child);
+		}
+		nodes[n].var = FreeVar;
+		freeList.push_back(n);
+	}
+
+	// The cache may mention the freed nodes
+	opCache.clear();
+}
+
+AndersBddManager::BddRef AndersBddManager::getSingleton(unsigned x)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	maybeCollectGarbage();
+
+	BddRef ret = True;
+	for (unsigned level = NumVars; level-- > 0;)
+	{
+		bool bit = (x >> (NumVars - 1 - level)) & 1;
+		ret = bit ? makeNode(level, False, ret) : makeNode(level, ret, False);
+	}
+	refLocked(ret);
+	return ret;
+}
+
+AndersBddManager::BddRef AndersBddManager::getUnion(BddRef lhs, BddRef rhs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return applyTopLevel(OP_OR, lhs, rhs);
+}
+
+AndersBddManager::BddRef AndersBddManager::getIntersection(BddRef lhs, BddRef rhs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return applyTopLevel(OP_AND, lhs, rhs);
+}
+
+AndersBddManager::BddRef AndersBddManager::getDifference(BddRef lhs, BddRef rhs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return applyTopLevel(OP_DIFF, lhs, rhs);
+}
+
+void AndersBddManager::ref(BddRef n)
+{
+	if (n <= True)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	refLocked(n);
+}
+
+void AndersBddManager::deref(BddRef n)
+{
+	if (n <= True)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	derefLocked(n);
+}
+
+bool AndersBddManager::has(BddRef n, unsigned x) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	while (n > True)
+	{
+		const Node& node = nodes[n];
+		bool bit = (x >> (NumVars - 1 - node.var)) & 1;
+		n = bit ? node.hi : node.lo;
+	}
+	return n == True;
+}
+
+std::uint64_t AndersBddManager::countRec(BddRef n, DenseMap<BddRef, std::uint64_t>& memo) const
+{
+	if (n <= True)
+		return n;
+
+	auto itr = memo.find(n);
+	if (itr != memo.end())
+		return itr->second;
+
+	// Variables skipped between a node and its child can take any value
+	const Node& node = nodes[n];
+	std::uint64_t ret = (countRec(node.lo, memo) << (nodes[node.lo].var - node.var - 1)) + (countRec(node.hi, memo) << (nodes[node.hi].var - node.var - 1));
+	memo[n] = ret;
+	return ret;
+}
+
+std::uint64_t AndersBddManager::count(BddRef n) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	DenseMap<BddRef, std::uint64_t> memo;
+	return countRec(n, memo) << nodes[n].var;
+}
+
+bool AndersBddManager::findRec(BddRef n, unsigned level, bool tight, unsigned lowerBound, unsigned& value) const
+{
+	if (n == False)
+		return false;
+	if (level == NumVars)
+		return true;
+
+	// A node below the current level means that this bit can be anything
+	BddRef lo = n, hi = n;
+	if (nodes[n].var == level)
+	{
+		lo = nodes[n].lo;
+		hi = nodes[n].hi;
+	}
+
+	// While tight, the bits chosen so far equal those of lowerBound, so we may not go below its next bit
+	unsigned shift = NumVars - 1 - level;
+	bool boundBit = (lowerBound >> shift) & 1;
+	if (!tight || !boundBit)
+	{
+		if (findRec(lo, level + 1, tight, lowerBound, value))
+			return true;
+	}
+	value |= 1u << shift;
+	if (findRec(hi, level + 1, tight && boundBit, lowerBound, value))
+		return true;
+	value &= ~(1u << shift);
+	return false;
+}
+
+bool AndersBddManager::findFrom(BddRef n, unsigned lowerBound, unsigned& result) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	unsigned value = 0;
+	if (!findRec(n, 0, true, lowerBound, value))
+		return false;
+	result = value;
+	return true;
+}
+
+unsigned AndersBddManager::getNumNodes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return getNumLiveNodesLocked();
+}
+
+std::size_t AndersBddManager::getMemoryUsage() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return getVectorMemoryUsage(nodes) + getVectorMemoryUsage(freeList) + uniqueTable.getMemorySize() + opCache.getMemorySize();
+}
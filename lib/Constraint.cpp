@@ -0,0 +1,45 @@
+#include "Constraint.h"
+
+#include <algorithm>
+
+// Vectors shorter than this are sorted with std::sort: the counting passes of the radix sort don't pay off for them
+static const unsigned MinRadixSortSize = 256;
+// The radix sort looks at 16 bits of the packed encodings in each pass
+static const unsigned RadixBits = 16;
+static const unsigned NumBuckets = 1u << RadixBits;
+
+void uniquifyConstraints(std::vector<AndersConstraint>& constraints)
+{
+	if (constraints.size() < MinRadixSortSize)
+		std::sort(constraints.begin(), constraints.end());
+	else
+	{
+		// An LSD radix sort on the 64-bit keys. AndersConstraint is nothing but its key, so we sort the objects directly
+		std::vector<AndersConstraint> buffer(constraints.size(), AndersConstraint::fromPackedKey(0));
+		std::vector<unsigned> count(NumBuckets);
+		for (unsigned shift = 0; shift < 64; shift += RadixBits)
+		{
+			std::fill(count.begin(), count.end(), 0);
+			for (auto const& c: constraints)
+				++count[(c.getPackedKey() >> shift) & (NumBuckets - 1)];
+
+			// Skip the pass if all the keys agree on these bits, which is common for the high bits of the node indices
+			if (count[(constraints.front().getPackedKey() >> shift) & (NumBuckets - 1)] == constraints.size())
+				continue;
+
+			unsigned sum = 0;
+			for (auto& n: count)
+			{
+				unsigned bucketSize = n;
+				n = sum;
+				sum += bucketSize;
+			}
+
+			for (auto const& c: constraints)
+				buffer[count[(c.getPackedKey() >> shift) & (NumBuckets - 1)]++] = c;
+			constraints.swap(buffer);
+		}
+	}
+
+	constraints.erase(std::unique(constraints.begin(), constraints.end()), constraints.end());
+}
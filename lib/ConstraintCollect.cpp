@@ -1,20 +1,271 @@
 #include "Andersen.h"
+#include "Parallel.h"
 
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
 #include "llvm/IR/PatternMatch.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
 
 using namespace llvm;
 
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumNodesEstimated, "Number of nodes estimated by the module pre-scan");
+STATISTIC(NumConstraintsEstimated, "Number of constraints estimated by the module pre-scan");
+STATISTIC(NumCoalescedCopies, "Number of value nodes coalesced with their sources during collection");
+STATISTIC(NumDuplicateConstraints, "Number of duplicate constraints dropped at the end of their function bodies");
+STATISTIC(NumTypeRestrictedCalls, "Number of indirect calls whose targets -anders-type-metadata-calls restricted to the slots of a vtable type");
+STATISTIC(NumTrackedIntToPtrs, "Number of inttoptr instructions -anders-int-provenance traced back to pointers");
+STATISTIC(NumSharedHeapObjects, "Number of allocation sites that share the object of another under -anders-heap-abstraction");
+
+cl::opt<unsigned> NumCollectThreads("anders-collect-threads", cl::desc("The number of threads used to collect the constraints of the function bodies (1 for sequential collection, 0 for one thread per hardware thread)"), cl::init(1));
+cl::opt<bool> EnableOnTheFlyCallGraph("enable-otf-callgraph", cl::desc("Resolve indirect calls during solving, using the points-to sets of the callee pointers, rather than wiring them to every address-taken function"));
+cl::opt<bool> EnableTypeMetadataCalls("anders-type-metadata-calls", cl::desc("Wire the virtual calls that load their callee from a vtable checked by llvm.type.test, or that get it from llvm.type.checked.load, only to the functions in that slot of the vtables of the type they check, as the !type metadata of the vtables tells, instead of to every address-taken function of the right arity. The module must hold every vtable of those types, as for whole-program devirtualization"));
+cl::opt<bool> EnableIntProvenance("anders-int-provenance", cl::desc("Follow the integer operand of an inttoptr back through arithmetic, masking, integer casts, selects and phis to the pointers converted by ptrtoint, and make the result point to what they point to, instead of to anything as soon as the integer is more than a ptrtoint or a ptrtoint plus an offset"));
+cl::opt<bool> EnableHeapCloning("anders-heap-cloning", cl::desc("Give each direct call to an allocation wrapper (a function that does nothing with the result of a malloc-like call but return it) an object of its own, instead of the single object of the allocation in the wrapper"));
+cl::opt<bool> EnableFieldSensitive("anders-field-sensitive", cl::desc("Give the stack and global objects one node per field, and follow the constant field offsets of getelementptr. Only done by the sequential worklist solver, and the queries still see the objects as a whole"));
+cl::opt<unsigned> MaxFieldsPerObject("anders-max-fields", cl::desc("With -anders-field-sensitive, the most fields an object is split into. The fields after the last one share its node"), cl::init(32));
+cl::opt<bool> EnableDenseValueNodes("anders-dense-value-nodes", cl::desc("While a function body is collected, find the value nodes of its instructions by their position in the body and those of its formal arguments by their number, rather than in the value map"));
+cl::opt<bool> EnableCopyCoalescing("anders-coalesce-copies", cl::desc("Merge the value node of a pointer cast, a getelementptr that is a plain copy, or a phi or select with a single incoming value into the node of its source while the nodes are created, instead of collecting a copy between them"));
+cl::opt<bool> EnableDirectStackAccess("anders-direct-stack-access", cl::desc("Collect a load or a store straight through an alloca as a copy from or into the object of the alloca, instead of a load or store constraint the solver resolves through the points-to set of the alloca"));
+cl::opt<std::string> HeapAbstraction("anders-heap-abstraction", cl::desc("How many objects stand for the heap: one per allocation site (site), one per function that allocates (function), one per type the allocations are cast to (type), or a single one (single). Not applied with -anders-incremental, createLazily() and summaries"), cl::init("site"));
+cl::opt<bool> EnableIncremental("anders-incremental", cl::desc("Keep the constraints of each function body, so that Andersen::updateFunctions() can analyze changed bodies again without starting over. Not available with -enable-otf-callgraph"), cl::init(false));
+cl::opt<bool> EnableAppend("anders-append", cl::desc("Keep the constraint graph and the points-to sets the solver ends with, so that Andersen::appendDefinitions() can add the functions and globals added to the module since and solve on from the last solution. Not available with -enable-otf-callgraph, the offline optimizations that merge pointers or locations, -enable-dead-pointer-elim or -anders-auto-config"), cl::init(false));
+
+namespace {
+
+// The most integer values -anders-int-provenance looks at for one inttoptr. Past that, the result points to anything
+const unsigned MaxProvenanceValues = 64;
+
+// The pointers that the integer v may have been computed from, put into pointers. Every operand of an arithmetic or bitwise operation may carry a pointer: tagging and hashing code adds, masks and xors them with constants and with each other, and what comes out may be any of them again. The constants carry none. Return false if v depends on an integer the function doesn't compute from its pointers (a load, an argument, the result of a call, ...), or on none at all
+bool getIntegerProvenance(const Value* v, SmallVectorImpl<const Value*>& pointers)
+{
+	SmallPtrSet<const Value*, 16> visited;
+	SmallVector<const Value*, 16> workList;
+	workList.push_back(v);
+	visited.insert(v);
+	auto visit = [&visited, &workList] (const Value* operand)
+	{
+		if (visited.insert(operand).second)
+			workList.push_back(operand);
+	};
+	while (!workList.empty())
+	{
+		const Value* curr = workList.pop_back_val();
+		if (visited.size() > MaxProvenanceValues)
+			return false;
+		if (isa<ConstantInt>(curr) || isa<UndefValue>(curr))
+			continue;
+		auto op = dyn_cast<Operator>(curr);
+		if (op == nullptr)
+			return false;
+		switch (op->getOpcode())
+		{
+			case Instruction::PtrToInt:
+				// A vector of pointers has no node of its own
+				if (!op->getOperand(0)->getType()->isPointerTy())
+					return false;
+				pointers.push_back(op->getOperand(0));
+				break;
+			case Instruction::Add:
+			case Instruction::Sub:
+			case Instruction::Mul:
+			case Instruction::And:
+			case Instruction::Or:
+			case Instruction::Xor:
+			case Instruction::Shl:
+			case Instruction::LShr:
+			case Instruction::AShr:
+			case Instruction::Trunc:
+			case Instruction::ZExt:
+			case Instruction::SExt:
+				for (auto const& operand: op->operands())
+					visit(operand);
+				break;
+			case Instruction::Select:
+				visit(op->getOperand(1));
+				visit(op->getOperand(2));
+				break;
+			case Instruction::PHI:
+				for (auto const& incoming: cast<PHINode>(op)->incoming_values())
+					visit(incoming);
+				break;
+			default:
+				return false;
+		}
+	}
+	return !pointers.empty();
+}
+
+// The number of fields of t when its structs are flattened into their fields, recursively. The elements of an array or a vector share their fields
+unsigned countFields(Type* t)
+{
+	if (auto st = dyn_cast<StructType>(t))
+	{
+		unsigned numFields = 0;
+		for (auto elem: st->elements())
+			numFields += countFields(elem);
+		return numFields;
+	}
+	if (auto at = dyn_cast<ArrayType>(t))
+		return countFields(at->getElementType());
+	return 1;
+}
+
+// The number of fields gep steps over in the flattened layout of countFields(), or AnyField if that is not known statically. The first index moves between the elements of an array of the source element type, which share their fields. Pointer arithmetic on anything but an aggregate may land on any field
+unsigned getGEPFieldOffset(const GetElementPtrInst* gep)
+{
+	Type* t = gep->getSourceElementType();
+	if (!t->isAggregateType())
+		return gep->hasAllZeroIndices() ? 0 : AndersFieldConstraint::AnyField;
+
+	unsigned offset = 0;
+	for (unsigned i = 2, e = gep->getNumOperands(); i < e; ++i)
+	{
+		if (auto st = dyn_cast<StructType>(t))
+		{
+			unsigned field = cast<ConstantInt>(gep->getOperand(i))->getZExtValue();
+			for (unsigned j = 0; j < field; ++j)
+				offset += countFields(st->getElementType(j));
+			t = st->getElementType(field);
+		}
+		else if (auto at = dyn_cast<ArrayType>(t))
+			t = at->getElementType();
+		else
+			t = cast<VectorType>(t)->getElementType();
+	}
+	return offset;
+}
+
+// Whether a constant expression takes the address of some other field of g than the first. The constant expressions are resolved to the object as a whole (see AndersNodeFactory::getObjectNodeForConstant()), so g has to be kept in a single field
+bool hasConstantFieldAddress(const GlobalVariable& g)
+{
+	SmallVector<const User*, 8> workList(g.user_begin(), g.user_end());
+	SmallPtrSet<const User*, 8> visited;
+	while (!workList.empty())
+	{
+		auto ce = dyn_cast<ConstantExpr>(workList.pop_back_val());
+		if (ce == nullptr || !visited.insert(ce).second)
+			continue;
+		if (ce->getOpcode() == Instruction::GetElementPtr && !cast<GEPOperator>(ce)->hasAllZeroIndices())
+			return true;
+		workList.append(ce->user_begin(), ce->user_end());
+	}
+	return false;
+}
+
+// The sizes collectConstraints() reserves before it starts. They are upper bounds of a sort: each pointer instruction is given a constraint and each call an object, which most of them don't need
+struct ModuleSizeEstimate
+{
+	unsigned numValueNodes;
+	unsigned numObjectNodes;
+	unsigned numConstraints;
+};
+
+// Count what the module will need in a quick pass that looks at types and opcodes only. A body that is yet to be materialized counts as empty
+ModuleSizeEstimate estimateModuleSize(const Module& M)
+{
+	// A value, an object and an address-of constraint for each global
+	unsigned numGlobals = M.global_size();
+	ModuleSizeEstimate est = {numGlobals, numGlobals, numGlobals};
+	for (auto const& f: M)
+	{
+		// A value and an object if it is address-taken, and a return and a vararg node
+		est.numValueNodes += 3;
+		++est.numObjectNodes;
+		++est.numConstraints;
+		for (auto const& arg: f.args())
+			if (arg.getType()->isPointerTy())
+				++est.numValueNodes;
+		for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
+		{
+			const Instruction& inst = *itr;
+			if (inst.getType()->isPointerTy())
+			{
+				++est.numValueNodes;
+				++est.numConstraints;
+			}
+			if (isa<AllocaInst>(inst))
+				++est.numObjectNodes;
+			else if (isa<StoreInst>(inst))
+				++est.numConstraints;
+			else if (isa<CallInst>(inst) || isa<InvokeInst>(inst))
+			{
+				// The object of an allocation, and a constraint for each argument
+				++est.numObjectNodes;
+				est.numConstraints += inst.getNumOperands();
+			}
+		}
+	}
+	return est;
+}
+
+// The value inst is a plain copy of, if it is a cast or a getelementptr of a pointer that doesn't move to another field, or a phi or select all of whose incoming values are the same. nullptr otherwise
+const Value* getCopySource(const Instruction* inst, bool fieldSensitive)
+{
+	if (!inst->getType()->isPointerTy())
+		return nullptr;
+	switch (inst->getOpcode())
+	{
+		case Instruction::BitCast:
+			return inst->getOperand(0)->getType()->isPointerTy() ? inst->getOperand(0) : nullptr;
+		case Instruction::GetElementPtr:
+			return (!fieldSensitive || getGEPFieldOffset(cast<GetElementPtrInst>(inst)) == 0) ? inst->getOperand(0) : nullptr;
+		case Instruction::Select:
+			return inst->getOperand(1) == inst->getOperand(2) ? inst->getOperand(1) : nullptr;
+		case Instruction::PHI:
+		{
+			// A phi may feed itself around a loop, which adds nothing
+			const Value* src = nullptr;
+			for (auto const& incoming: cast<PHINode>(inst)->incoming_values())
+			{
+				if (incoming == inst || incoming == src)
+					continue;
+				if (src != nullptr)
+					return nullptr;
+				src = incoming;
+			}
+			return src;
+		}
+		default:
+			return nullptr;
+	}
+}
+
+}	// end of anonymous namespace
+
 // CollectConstraints - This stage scans the program, adding a constraint to the Constraints list for each instruction in the program that induces a constraint, and setting up the initial points-to graph.
 
 void Andersen::collectConstraints(const Module& M)
 {
+	fieldSensitive = EnableFieldSensitive && !summary && canUseFieldConstraints();
+	if (EnableFieldSensitive && !fieldSensitive)
+		errs() << "-anders-field-sensitive is only supported by the sequential worklist solver, without -enable-le, -enable-partition, -enable-steensgaard-fallback, -enable-constraint-streaming, -anders-incremental, -anders-append, -anders-write-constraints or summaries, and will be ignored\n";
+
+	// Before anything is created for the functions, since those out of the scope are treated as external
+	selectScope(M);
+
+	// Size the node tables and the constraint list up front rather than have them double their way up. -stats shows the estimates next to the actual numbers of nodes and constraints
+	ModuleSizeEstimate est = estimateModuleSize(M);
+	nodeFactory.reserve(est.numValueNodes, est.numObjectNodes);
+	if (!streamedGraph)
+		constraints.reserve(constraints.size() + est.numConstraints);
+	NumNodesEstimated += nodeFactory.getNumNodes() + est.numValueNodes + est.numObjectNodes;
+	NumConstraintsEstimated += est.numConstraints;
+
 	// First, the universal ptr points to universal obj, and the universal obj points to itself
 	constraints.emplace_back(AndersConstraint::ADDR_OF,
 		nodeFactory.getUniversalPtrNode(), nodeFactory.getUniversalObjNode());
@@ -27,132 +278,619 @@ void Andersen::collectConstraints(const Module& M)
 
 	// Next, add any constraints on global variables. Associate the address of the global object as pointing to the memory for the global: &G = <G memory>
 	collectConstraintsForGlobals(M);
+	addScopeBoundaryConstraints(M);
+
+	if (EnableIncremental && !EnableOnTheFlyCallGraph)
+	{
+		incrementalState.reset(new IncrementalState);
+		incrementalState->globalConstraints = constraints;
+		incrementalState->moduleShape = hashModuleShape(M);
+	}
+	if (appendState)
+		appendState->moduleShape = hashModuleShape(M);
+
+	// The bodies analyzed again by -anders-incremental, appended by appendDefinitions(), freed by createLazily() or linked later into a summary would each need their objects back
+	auto granularity = StringSwitch<int>(HeapAbstraction)
+		.Case("site", static_cast<int>(HeapGranularity::Site))
+		.Case("function", static_cast<int>(HeapGranularity::Function))
+		.Case("type", static_cast<int>(HeapGranularity::Type))
+		.Case("single", static_cast<int>(HeapGranularity::Single))
+		.Default(-1);
+	if (granularity < 0)
+		errs() << "Unknown heap abstraction \"" << HeapAbstraction << "\", falling back to site\n";
+	heapGranularity = granularity < 0 || incrementalState || appendState || lazyBodies || summary ? HeapGranularity::Site : static_cast<HeapGranularity>(granularity);
 
 	// Here is a notable points before we proceed:
 	// For functions with non-local linkage type, theoretically we should not trust anything that get passed to it or get returned by it. However, precision will be seriously hurt if we do that because if we do not run a -internalize pass before the -anders pass, almost every function is marked external. We'll just assume that even external linkage will not ruin the analysis result first
 
+	std::vector<const Function*> definedFuncs;
 	for (auto const& f: M)
 	{
-		if (f.isDeclaration() || f.isIntrinsic())
-			continue;
+		if (!f.isDeclaration() && !f.isIntrinsic() && !scopedOut.count(&f))
+			definedFuncs.push_back(&f);
+	}
 
-		// Scan the function body
-		// A visitor pattern might help modularity, but it needs more boilerplate codes to set up, and it breaks down the main logic into pieces 
+	unsigned numThreads = std::min<unsigned>(getNumWorkerThreads(NumCollectThreads), definedFuncs.size());
+	if (lazyBodies)
+		collectLazyBodies();
+	else
+	{
+		// Create all the value nodes up front, so that the workers only look nodes up. The node numbering then depends on the module alone, whatever the number of threads: the value nodes of all functions, followed by the nodes created during collection in function order
+		for (auto f: definedFuncs)
+			createValueNodesForFunction(*f);
 
-		// First, create a value node for each instruction with pointer type. It is necessary to do the job here rather than on-the-fly because an instruction may refer to the value node definied before it (e.g. phi nodes)
-		for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
+		if (numThreads <= 1)
 		{
-			auto inst = &*itr.getInstructionIterator();
-			if (inst->getType()->isPointerTy())
-				nodeFactory.createValueNode(inst);
+			for (auto f: definedFuncs)
+			{
+				CollectionBuffer buffer;
+				collectConstraintsForFunction(*f, buffer);
+				commitCollectionBuffer(buffer);
+			}
+		}
+		else
+		{
+			// Each worker takes a contiguous range of functions, and the buffers are committed in order
+			std::vector<CollectionBuffer> buffers(numThreads);
+			runOnThreads(numThreads, [this, numThreads, &definedFuncs, &buffers] (unsigned tid)
+			{
+				unsigned begin = definedFuncs.size() * tid / numThreads;
+				unsigned end = definedFuncs.size() * (tid + 1) / numThreads;
+				for (unsigned i = begin; i < end; ++i)
+					collectConstraintsForFunction(*definedFuncs[i], buffers[tid]);
+			});
+			for (auto& buffer: buffers)
+				commitCollectionBuffer(buffer);
+		}
+	}
+
+	// The same constraint may be collected more than once (e.g. when a value is passed to the same callee at several call sites). Drop the duplicates before anything else looks at them. The constraint graph drops them by itself
+	if (streamedGraph)
+		streamConstraints();
+	else
+		uniquifyConstraints(constraints);
+}
+
+void Andersen::renumberNodes()
+{
+	std::vector<NodeIndex> newIndices = nodeFactory.packObjectNodes();
+
+	for (auto& c: constraints)
+		c = AndersConstraint(c.getType(), newIndices[c.getDest()], newIndices[c.getSrc()]);
+	// The new indices don't preserve the order of the constraints
+	uniquifyConstraints(constraints);
+
+	for (auto& call: indirectCalls)
+		call.callee = newIndices[call.callee];
+	for (auto& n: lateCopyTargets)
+		n = newIndices[n];
+	for (auto& c: fieldConstraints)
+		c = AndersFieldConstraint(newIndices[c.dest], newIndices[c.src], c.offset);
+	// The value nodes keep their order, so the nodes of the instructions of a function still follow each other
+	for (auto& n: formalNodes)
+		if (n != AndersNodeFactory::InvalidIndex)
+			n = newIndices[n];
+	for (auto& mapping: localValueNodes)
+		if (mapping.second.firstInstNode != AndersNodeFactory::InvalidIndex)
+			mapping.second.firstInstNode = newIndices[mapping.second.firstInstNode];
+
+	if (lazyBodies)
+	{
+		for (auto& mapping: lazyBodies->releasedBodies)
+			for (auto& node: mapping.second.nodes)
+				node.first = newIndices[node.first];
+	}
+
+	if (incrementalState)
+	{
+		for (auto& c: incrementalState->globalConstraints)
+			c = AndersConstraint(c.getType(), newIndices[c.getDest()], newIndices[c.getSrc()]);
+		for (auto& mapping: incrementalState->functions)
+		{
+			for (auto& c: mapping.second.constraints)
+				c = AndersConstraint(c.getType(), newIndices[c.getDest()], newIndices[c.getSrc()]);
+			for (auto& n: mapping.second.nodes)
+				n = newIndices[n];
+		}
+	}
+}
+
+// Create a value node for each instruction with pointer type. It is necessary to do the job before the constraints of f are collected because an instruction may refer to the value node definied before it (e.g. phi nodes)
+// The nodes of the instructions are created one after another, so with -anders-dense-value-nodes only the first of them is recorded
+void Andersen::createValueNodesForFunction(const Function& f)
+{
+	NodeIndex firstNode = AndersNodeFactory::InvalidIndex;
+	for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
+	{
+		auto inst = &*itr.getInstructionIterator();
+		if (inst->getType()->isPointerTy())
+		{
+			NodeIndex n = nodeFactory.createValueNode(inst);
+			if (firstNode == AndersNodeFactory::InvalidIndex)
+				firstNode = n;
+			if (incrementalState)
+				incrementalState->functions[&f].nodes.push_back(n);
 		}
+	}
+	if (EnableDenseValueNodes)
+		localValueNodes[&f].firstInstNode = firstNode;
 
-		// Now, collect constraint for each relevant instruction
+	// With -anders-coalesce-copies, merge each plain copy into its source once all the nodes it may refer to are there. Only the representatives of the nodes of f are linked under others, so nothing collected before f is affected. The special nodes are left alone: two pointers that came out of nowhere are not the same pointer
+	if (coalesceCopies)
+	{
 		for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
 		{
 			auto inst = &*itr.getInstructionIterator();
-			collectConstraintsForInstruction(inst);
+			const Value* src = getCopySource(inst, fieldSensitive);
+			if (src == nullptr)
+				continue;
+			NodeIndex srcNode = nodeFactory.getValueNodeFor(src);
+			if (srcNode == AndersNodeFactory::InvalidIndex)
+				continue;
+			srcNode = nodeFactory.getMergeTarget(srcNode);
+			NodeIndex instNode = nodeFactory.getMergeTarget(nodeFactory.getValueNodeFor(inst));
+			if (srcNode <= AndersNodeFactory::NullObjectIndex || srcNode == instNode)
+				continue;
+			nodeFactory.mergeNode(srcNode, instNode);
+			++NumCoalescedCopies;
 		}
 	}
 }
 
-void Andersen::collectConstraintsForGlobals(const Module& M)
+// Scan the function body. The value nodes of f must have been created
+// A visitor pattern might help modularity, but it needs more boilerplate codes to set up, and it breaks down the main logic into pieces
+void Andersen::collectConstraintsForFunction(const Function& f, CollectionBuffer& buffer) const
 {
-	// Create a pointer and an object for each global variable
-	for (auto const& globalVal: M.globals())
+	buffer.functionStarts.push_back(CollectionBuffer::FunctionStart{&f, static_cast<unsigned>(buffer.constraints.size()), static_cast<unsigned>(buffer.newNodes.size())});
+
+	// With -anders-dense-value-nodes, the walk below meets the pointer instructions in the order their nodes were created in
+	auto localItr = EnableDenseValueNodes ? localValueNodes.find(&f) : localValueNodes.end();
+	bool dense = localItr != localValueNodes.end();
+	NodeIndex nextInstNode = AndersNodeFactory::InvalidIndex;
+	if (dense)
 	{
-		NodeIndex gVal = nodeFactory.createValueNode(&globalVal);
-		NodeIndex gObj = nodeFactory.createObjectNode(&globalVal);
-		constraints.emplace_back(AndersConstraint::ADDR_OF, gVal, gObj);
+		nextInstNode = localItr->second.firstInstNode;
+		if (localItr->second.firstFormal != LocalValueNodes::NoFormals)
+			buffer.currFormals = formalNodes.data() + localItr->second.firstFormal;
 	}
-
-	// Functions and function pointers are also considered global
-	for (auto const& f: M)
+	for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
 	{
-		// If f is an addr-taken function, create a pointer and an object for it
-		if (f.hasAddressTaken())
+		auto inst = &*itr.getInstructionIterator();
+		if (dense)
 		{
-			NodeIndex fVal = nodeFactory.createValueNode(&f);
-			NodeIndex fObj = nodeFactory.createObjectNode(&f);
-			constraints.emplace_back(AndersConstraint::ADDR_OF, fVal, fObj);
+			buffer.currInst = inst;
+			buffer.currInstNode = inst->getType()->isPointerTy() ? nextInstNode++ : AndersNodeFactory::InvalidIndex;
+			assert(buffer.currInstNode == nodeFactory.getValueNodeFor(inst) && "The value nodes of f are out of order!");
 		}
+		collectConstraintsForInstruction(inst, buffer);
+	}
+	buffer.currInst = nullptr;
+	buffer.currFormals = nullptr;
+	buffer.stackObjects.clear();
 
-		if (f.isDeclaration() || f.isIntrinsic())
-			continue;
+	// A body repeats many of its constraints: a phi with the same incoming value along several edges, the same argument passed to every target of an indirect call, a pointer handed to several unresolved calls. Drop the repeats now, so that the buffers of a large module don't hold them until collectConstraints() sorts out the duplicates across bodies. The constraints of a body are only ever looked at as a set
+	auto bodyBegin = buffer.constraints.begin() + buffer.functionStarts.back().constraint;
+	std::sort(bodyBegin, buffer.constraints.end());
+	auto bodyEnd = std::unique(bodyBegin, buffer.constraints.end());
+	NumDuplicateConstraints += buffer.constraints.end() - bodyEnd;
+	buffer.constraints.erase(bodyEnd, buffer.constraints.end());
+}
+
+// The object of ptr if it is an alloca of the function being collected into buffer, InvalidIndex otherwise. Nothing but the address-of constraint of the alloca ever flows into its value node, so its points-to set is that object alone, and a load or a store through it reads or writes that object directly
+// An alloca that comes after some of its uses in the layout of the body isn't known yet when they are collected. They keep their load and store constraints, which is just as correct
+NodeIndex Andersen::getStackObject(const Value* ptr, const CollectionBuffer& buffer) const
+{
+	if (!EnableDirectStackAccess || !isa<AllocaInst>(ptr))
+		return AndersNodeFactory::InvalidIndex;
+	auto itr = buffer.stackObjects.find(ptr);
+	return itr != buffer.stackObjects.end() ? itr->second : AndersNodeFactory::InvalidIndex;
+}
 
-		// Create return node
-		if (f.getFunctionType()->getReturnType()->isPointerTy())
+// Look up the value node of v, which the instruction being collected into buffer uses or is. With -anders-dense-value-nodes, that instruction and the formal arguments of its function are not looked up in the value map
+NodeIndex Andersen::getLocalValueNode(const Value* v, const CollectionBuffer& buffer) const
+{
+	if (v == buffer.currInst)
+		return buffer.currInstNode;
+	if (buffer.currFormals != nullptr)
+	{
+		if (auto arg = dyn_cast<Argument>(v))
+			return buffer.currFormals[arg->getArgNo()];
+	}
+	return nodeFactory.getValueNodeFor(v);
+}
+
+// The key of the group of allocation sites site falls into under heapGranularity. Under Type, that is the type the result of the allocation is first cast to, which is what typed code allocates it as, or the type of the call itself if it is not cast
+const void* Andersen::getHeapObjectKey(const Instruction* site) const
+{
+	switch (heapGranularity)
+	{
+	case HeapGranularity::Function:
+		return site->getParent()->getParent();
+	case HeapGranularity::Type:
+		for (auto user: site->users())
+			if (auto castInst = dyn_cast<BitCastInst>(user))
+				return castInst->getDestTy();
+		return site->getType();
+	default:
+		return nullptr;
+	}
+}
+
+// Move what has been collected into buffer into the analysis: create the nodes buffer asked for, then append its constraints with the provisional indices replaced by the real ones
+void Andersen::commitCollectionBuffer(CollectionBuffer& buffer)
+{
+	std::vector<NodeIndex> realIndices;
+	realIndices.reserve(buffer.newNodes.size());
+	for (auto const& node: buffer.newNodes)
+	{
+		if (!node.isObject)
+		{
+			realIndices.push_back(nodeFactory.createValueNode(node.val));
+			continue;
+		}
+		// The objects of the collection that are not allocas are those of the allocation sites
+		if (heapGranularity != HeapGranularity::Site && !isa<AllocaInst>(node.val))
 		{
-			nodeFactory.createReturnNode(&f);
+			auto inserted = heapObjects.insert(std::make_pair(getHeapObjectKey(cast<Instruction>(node.val)), nodeFactory.getNumNodes()));
+			if (!inserted.second)
+			{
+				nodeFactory.shareObjectNode(node.val, inserted.first->second);
+				realIndices.push_back(inserted.first->second);
+				++NumSharedHeapObjects;
+				continue;
+			}
 		}
+		realIndices.push_back(nodeFactory.createObjectNode(node.val));
+		nodeFactory.createFieldNodes(realIndices.back(), node.numFields);
+	}
+	assert(nodeFactory.getNumNodes() <= ProvisionalIndexBase && "Too many nodes!");
 
-		// Create vararg node
-		if (f.getFunctionType()->isVarArg())
-			nodeFactory.createVarargNode(&f);
+	auto getRealIndex = [&realIndices] (NodeIndex n)
+	{
+		return n >= ProvisionalIndexBase ? realIndices[n - ProvisionalIndexBase] : n;
+	};
+	for (auto const& c: buffer.constraints)
+		constraints.emplace_back(c.getType(), getRealIndex(c.getDest()), getRealIndex(c.getSrc()));
+	for (auto const& c: buffer.fieldConstraints)
+		fieldConstraints.emplace_back(getRealIndex(c.dest), getRealIndex(c.src), c.offset);
+
+	if (incrementalState)
+	{
+		// The buffer's constraints are the last ones appended
+		unsigned base = constraints.size() - buffer.constraints.size();
+		for (unsigned i = 0, e = buffer.functionStarts.size(); i < e; ++i)
+		{
+			auto const& start = buffer.functionStarts[i];
+			unsigned constraintEnd = (i + 1 < e) ? buffer.functionStarts[i + 1].constraint : buffer.constraints.size();
+			unsigned newNodeEnd = (i + 1 < e) ? buffer.functionStarts[i + 1].newNode : buffer.newNodes.size();
+			auto& record = incrementalState->functions[start.func];
+			record.constraints.insert(record.constraints.end(), constraints.begin() + base + start.constraint, constraints.begin() + base + constraintEnd);
+			record.nodes.insert(record.nodes.end(), realIndices.begin() + start.newNode, realIndices.begin() + newNodeEnd);
+		}
+	}
 
-		// Add nodes for all formal arguments.
-		for (Function::const_arg_iterator itr = f.arg_begin(), ite = f.arg_end(); itr != ite; ++itr)
+	for (auto& call: buffer.indirectCalls)
+	{
+		indirectCallIndex[call.inst] = indirectCalls.size();
+		indirectCalls.push_back(std::move(call));
+	}
+	lateCopyTargets.insert(lateCopyTargets.end(), buffer.lateCopyTargets.begin(), buffer.lateCopyTargets.end());
+	numIndirectCallSites += buffer.numIndirectCalls;
+	if (summary)
+	{
+		unsigned fallbackBase = summary->fallbackConstraints.size();
+		for (auto const& c: buffer.fallbackConstraints)
+			summary->fallbackConstraints.emplace_back(c.getType(), getRealIndex(c.getDest()), getRealIndex(c.getSrc()));
+		for (auto& call: buffer.externalCalls)
 		{
-			if (isa<PointerType>(itr->getType()))
-				nodeFactory.createValueNode(&*itr);
+			call.fallbackBegin += fallbackBase;
+			call.fallbackEnd += fallbackBase;
+			summary->externalCalls.push_back(std::move(call));
 		}
+		for (auto& call: buffer.summaryIndirectCalls)
+			summary->indirectCalls.push_back(std::move(call));
 	}
+	if (streamedGraph)
+		streamConstraints();
+
+	errs() << buffer.diagnostics;
+
+	buffer = CollectionBuffer();
+}
+
+void Andersen::collectConstraintsForGlobals(const Module& M)
+{
+	for (auto const& globalVal: M.globals())
+		createGlobalVariableNodes(globalVal);
+
+	// Functions and function pointers are also considered global
+	unsigned funcOrder = 0;
+	for (auto const& f: M)
+		createFunctionNodes(f, funcOrder);
+
+	findAllocationWrappers(M);
 
 	// Init globals here since an initializer may refer to a global var/func below it
 	for (auto const& globalVal: M.globals())
+		collectGlobalInitializerConstraints(globalVal);
+}
+
+// Create a pointer and an object for the global variable
+void Andersen::createGlobalVariableNodes(const GlobalVariable& globalVal)
+{
+	NodeIndex gVal = nodeFactory.createValueNode(&globalVal);
+	NodeIndex gObj = nodeFactory.createObjectNode(&globalVal);
+	if (!hasConstantFieldAddress(globalVal))
+		nodeFactory.createFieldNodes(gObj, getNumFieldsFor(globalVal.getValueType()));
+	constraints.emplace_back(AndersConstraint::ADDR_OF, gVal, gObj);
+	if (EnableTypeMetadataCalls && globalVal.hasInitializer())
+		collectTypeSlotTargets(globalVal);
+}
+
+// Create the nodes of f that its body doesn't: its pointer and object if its address is taken, and its return, vararg and formal argument nodes. funcOrder numbers the address-taken functions for the indirect calls
+void Andersen::createFunctionNodes(const Function& f, unsigned& funcOrder)
+{
+	// The functions out of the scope have no library model, whatever their names
+	bool isExternal = f.isDeclaration() || f.isIntrinsic() || scopedOut.count(&f);
+	if (isExternal)
+		externalLibraryKinds[&f] = scopedOut.count(&f) ? EXT_UNKNOWN : classifyExternalLibrary(&f);
+
+	// If f is an addr-taken function, create a pointer and an object for it
+	if (isAddressTaken(f))
+	{
+		NodeIndex fVal = nodeFactory.createValueNode(&f);
+		NodeIndex fObj = nodeFactory.createObjectNode(&f);
+		constraints.emplace_back(AndersConstraint::ADDR_OF, fVal, fObj);
+
+		// Index f for the indirect calls, by the number of arguments it takes
+		IndirectCallTarget target = { &f, isExternal ? externalLibraryKinds[&f] : EXT_UNKNOWN, funcOrder++ };
+		if (f.getFunctionType()->isVarArg())
+			varargTargets.push_back(target);
+		else
+		{
+			if (f.arg_size() >= fixedArityTargets.size())
+				fixedArityTargets.resize(f.arg_size() + 1);
+			fixedArityTargets[f.arg_size()].push_back(target);
+		}
+	}
+
+	if (isExternal)
+		return;
+
+	// Create return node
+	if (f.getFunctionType()->getReturnType()->isPointerTy())
+	{
+		nodeFactory.createReturnNode(&f);
+	}
+
+	// Create vararg node
+	if (f.getFunctionType()->isVarArg())
+		nodeFactory.createVarargNode(&f);
+
+	// Add nodes for all formal arguments.
+	if (EnableDenseValueNodes)
+		localValueNodes[&f].firstFormal = formalNodes.size();
+	for (Function::const_arg_iterator itr = f.arg_begin(), ite = f.arg_end(); itr != ite; ++itr)
 	{
-		NodeIndex gObj = nodeFactory.getObjectNodeFor(&globalVal);
-		assert(gObj != AndersNodeFactory::InvalidIndex && "Cannot find global object!");
+		NodeIndex formal = AndersNodeFactory::InvalidIndex;
+		if (isa<PointerType>(itr->getType()))
+		{
+			formal = nodeFactory.createValueNode(&*itr);
+			if (EnableOnTheFlyCallGraph && isAddressTaken(f))
+				lateCopyTargets.push_back(formal);
+		}
+		if (EnableDenseValueNodes)
+			formalNodes.push_back(formal);
+	}
+	if (EnableOnTheFlyCallGraph && isAddressTaken(f) && f.getFunctionType()->isVarArg())
+		lateCopyTargets.push_back(nodeFactory.getVarargNodeFor(&f));
+}
+
+void Andersen::collectGlobalInitializerConstraints(const GlobalVariable& globalVal)
+{
+	NodeIndex gObj = nodeFactory.getObjectNodeFor(&globalVal);
+	assert(gObj != AndersNodeFactory::InvalidIndex && "Cannot find global object!");
+
+	if (globalVal.hasDefinitiveInitializer())
+	{
+		addGlobalInitializerConstraints(gObj, globalVal.getInitializer());
+	}
+	else if (!summary || !globalVal.isDeclaration())
+	{
+		// If it doesn't have an initializer (i.e. it's defined in another translation unit), it points to the universal set. In a summary, that is left to the linker, which may find the definition
+		constraints.emplace_back(AndersConstraint::COPY,
+			gObj, nodeFactory.getUniversalObjNode());
+	}
+}
 
-		if (globalVal.hasDefinitiveInitializer())
+void Andersen::findAllocationWrappers(const Module& M)
+{
+	// The bodies are not there yet with createLazily(), and in a summary, the allocation functions may be defined by another module
+	if (!EnableHeapCloning || lazyBodies || summary)
+		return;
+
+	// A wrapper may call another wrapper, so look again until no wrapper is found
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (auto const& f: M)
 		{
-			addGlobalInitializerConstraints(gObj, globalVal.getInitializer());
+			bool mayReturnNull = false;
+			if (!isExternalFunction(f) && !allocWrappers.count(&f) && isAllocationWrapper(f, mayReturnNull))
+			{
+				allocWrappers[&f] = mayReturnNull;
+				changed = true;
+			}
 		}
+	}
+}
+
+// f is an allocation wrapper if each of its returns gives either null or the fresh result of a malloc-like call (or of another wrapper) that nothing else gets hold of. The object f allocates is then only seen by its callers, which can each be given an object of their own
+bool Andersen::isAllocationWrapper(const Function& f, bool& mayReturnNull) const
+{
+	if (!f.getReturnType()->isPointerTy())
+		return false;
+
+	bool allocates = false;
+	for (const_inst_iterator itr = inst_begin(f), ite = inst_end(f); itr != ite; ++itr)
+	{
+		auto ret = dyn_cast<ReturnInst>(&*itr);
+		if (ret == nullptr)
+			continue;
+		const Value* v = ret->getReturnValue()->stripPointerCasts();
+		if (isa<ConstantPointerNull>(v))
+			mayReturnNull = true;
+		else if (isFreshAllocation(v, mayReturnNull))
+			allocates = true;
 		else
+			return false;
+	}
+	return allocates;
+}
+
+bool Andersen::isFreshAllocation(const Value* v, bool& mayReturnNull) const
+{
+	ImmutableCallSite cs(v);
+	const Function* callee = cs ? cs.getCalledFunction() : nullptr;
+	if (callee == nullptr)
+		return false;
+	if (isExternalFunction(*callee))
+	{
+		if (externalLibraryKinds.lookup(callee) != EXT_MALLOC)
+			return false;
+	}
+	else
+	{
+		auto itr = allocWrappers.find(callee);
+		if (itr == allocWrappers.end())
+			return false;
+		mayReturnNull |= itr->second;
+	}
+
+	// The pointer may be cast, compared and returned, but not stored, passed or written through: the wrapper must leave the object to its caller
+	SmallVector<const Value*, 4> workList(1, v);
+	while (!workList.empty())
+	{
+		const Value* ptr = workList.pop_back_val();
+		for (auto user: ptr->users())
 		{
-			// If it doesn't have an initializer (i.e. it's defined in another translation unit), it points to the universal set.
-			constraints.emplace_back(AndersConstraint::COPY,
-				gObj, nodeFactory.getUniversalObjNode());
+			if (isa<ReturnInst>(user) || isa<ICmpInst>(user))
+				continue;
+			if (isa<BitCastInst>(user) || isa<AddrSpaceCastInst>(user) || (isa<GetElementPtrInst>(user) && cast<GetElementPtrInst>(user)->hasAllZeroIndices()))
+			{
+				workList.push_back(user);
+				continue;
+			}
+			return false;
 		}
 	}
+	return true;
 }
 
-void Andersen::addGlobalInitializerConstraints(NodeIndex objNode, const Constant* c)
+// c is the part of the initializer of the global object objNode that starts offset fields into it
+void Andersen::addGlobalInitializerConstraints(NodeIndex objNode, const Constant* c, unsigned offset)
 {
 	//errs() << "Called with node# = " << objNode << ", initializer = " << *c << "\n";
+	// A single field object stands for all of its fields
+	bool splitFields = nodeFactory.getNumFields(objNode) > 1;
 	if (c->getType()->isSingleValueType())
 	{
 		if (isa<PointerType>(c->getType()))
 		{
 			NodeIndex rhsNode = nodeFactory.getObjectNodeForConstant(c);
 			assert(rhsNode != AndersNodeFactory::InvalidIndex && "rhs node not found");
-			constraints.emplace_back(AndersConstraint::ADDR_OF, objNode, rhsNode);
+			constraints.emplace_back(AndersConstraint::ADDR_OF, nodeFactory.getOffsetObjectNode(objNode, offset), rhsNode);
 		}
 	}
 	else if (c->isNullValue())
 	{
-		constraints.emplace_back(AndersConstraint::COPY, objNode, nodeFactory.getNullObjectNode());
+		unsigned numFields = splitFields ? std::min(countFields(c->getType()), nodeFactory.getNumFields(objNode)) : 1;
+		for (unsigned i = 0; i < numFields; ++i)
+			constraints.emplace_back(AndersConstraint::ADDR_OF, nodeFactory.getOffsetObjectNode(objNode, offset + i), nodeFactory.getNullObjectNode());
 	}
 	else if (!isa<UndefValue>(c))
 	{
-		// Since we are doing field-insensitive analysis, all objects in the array/struct are pointed-to by the 1st-field pointer
+		// Field-insensitively, all objects in the array/struct are pointed-to by the 1st-field pointer. Otherwise, the elements of a struct start at fields of their own, and those of an array share theirs
 		assert(isa<ConstantArray>(c) || isa<ConstantDataSequential>(c) || isa<ConstantStruct>(c));
 
+		// When the whole aggregate lands in a single field, which is always the case field-insensitively and for an array of pointers otherwise, the objects it points to are gathered first and each is given one constraint. A vtable or a generated dispatch table may hold the same few functions tens of thousands of times
+		if (!splitFields || (isa<ConstantArray>(c) && c->getType()->getArrayElementType()->isPointerTy()))
+		{
+			SparseBitVector<> targets;
+			collectInitializerTargets(c, targets);
+			NodeIndex fieldNode = nodeFactory.getOffsetObjectNode(objNode, offset);
+			for (auto target: targets)
+				constraints.emplace_back(AndersConstraint::ADDR_OF, fieldNode, target);
+			return;
+		}
+
+		splitFields &= isa<ConstantStruct>(c);
+		for (unsigned i = 0, e = c->getNumOperands(); i != e; ++i)
+		{
+			addGlobalInitializerConstraints(objNode, cast<Constant>(c->getOperand(i)), offset);
+			if (splitFields)
+				offset += countFields(c->getOperand(i)->getType());
+		}
+	}
+}
+
+// Add the objects the pointers in c point to to targets, as addGlobalInitializerConstraints() would for an object of a single field
+void Andersen::collectInitializerTargets(const Constant* c, SparseBitVector<>& targets) const
+{
+	if (c->getType()->isSingleValueType())
+	{
+		if (isa<PointerType>(c->getType()))
+		{
+			NodeIndex rhsNode = nodeFactory.getObjectNodeForConstant(c);
+			assert(rhsNode != AndersNodeFactory::InvalidIndex && "rhs node not found");
+			targets.set(rhsNode);
+		}
+	}
+	else if (c->isNullValue())
+		targets.set(nodeFactory.getNullObjectNode());
+	else if (!isa<UndefValue>(c))
+	{
 		for (unsigned i = 0, e = c->getNumOperands(); i != e; ++i)
-			addGlobalInitializerConstraints(objNode, cast<Constant>(c->getOperand(i)));
+			collectInitializerTargets(cast<Constant>(c->getOperand(i)), targets);
 	}
 }
 
-void Andersen::collectConstraintsForInstruction(const Instruction* inst)
+unsigned Andersen::getNumFieldsFor(Type* t) const
+{
+	if (!fieldSensitive)
+		return 1;
+	return std::max(1u, std::min<unsigned>(countFields(t), MaxFieldsPerObject));
+}
+
+// dst = src. With -anders-coalesce-copies, dst may have been merged into src already, which leaves nothing to copy
+void Andersen::addCopyConstraint(NodeIndex dst, NodeIndex src, CollectionBuffer& buffer) const
+{
+	if (!coalesceCopies || nodeFactory.getMergeTarget(dst) != nodeFactory.getMergeTarget(src))
+		buffer.constraints.emplace_back(AndersConstraint::COPY, dst, src);
+}
+
+// dst = src + offset. The offsets are only followed field-sensitively, and a zero offset is a plain copy
+void Andersen::addFieldConstraint(NodeIndex dst, NodeIndex src, unsigned offset, CollectionBuffer& buffer) const
+{
+	if (!fieldSensitive || offset == 0)
+		addCopyConstraint(dst, src, buffer);
+	else
+		buffer.fieldConstraints.emplace_back(dst, src, offset);
+}
+
+void Andersen::collectConstraintsForInstruction(const Instruction* inst, CollectionBuffer& buffer) const
 {
 	switch (inst->getOpcode())
 	{
 		case Instruction::Alloca:
 		{
-			NodeIndex valNode = nodeFactory.getValueNodeFor(inst);
+			NodeIndex valNode = getLocalValueNode(inst, buffer);
 			assert(valNode != AndersNodeFactory::InvalidIndex && "Failed to find alloca value node");
-			NodeIndex objNode = nodeFactory.createObjectNode(inst);
-			constraints.emplace_back(AndersConstraint::ADDR_OF, valNode, objNode);
+			NodeIndex objNode = buffer.createObjectNode(inst, getNumFieldsFor(cast<AllocaInst>(inst)->getAllocatedType()));
+			buffer.constraints.emplace_back(AndersConstraint::ADDR_OF, valNode, objNode);
+			if (EnableDirectStackAccess)
+				buffer.stackObjects[inst] = objNode;
 			break;
 		}
 		case Instruction::Call:
@@ -161,7 +899,7 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 			ImmutableCallSite cs(inst);
 			assert(cs && "Something wrong with callsite?");
 
-			addConstraintForCall(cs);
+			addConstraintForCall(cs, buffer);
 
 			break;
 		}
@@ -171,9 +909,9 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 			{
 				NodeIndex retIndex = nodeFactory.getReturnNodeFor(inst->getParent()->getParent());
 				assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find return node");
-				NodeIndex valIndex = nodeFactory.getValueNodeFor(inst->getOperand(0));
+				NodeIndex valIndex = getLocalValueNode(inst->getOperand(0), buffer);
 				assert(valIndex != AndersNodeFactory::InvalidIndex && "Failed to find return value node");
-				constraints.emplace_back(AndersConstraint::COPY, retIndex, valIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, valIndex);
 			}
 			break;
 		}
@@ -181,11 +919,17 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			if (inst->getType()->isPointerTy())
 			{
-				NodeIndex opIndex = nodeFactory.getValueNodeFor(inst->getOperand(0));
-				assert(opIndex != AndersNodeFactory::InvalidIndex && "Failed to find load operand node");
-				NodeIndex valIndex = nodeFactory.getValueNodeFor(inst);
+				NodeIndex valIndex = getLocalValueNode(inst, buffer);
 				assert(valIndex != AndersNodeFactory::InvalidIndex && "Failed to find load value node");
-				constraints.emplace_back(AndersConstraint::LOAD, valIndex, opIndex);
+				NodeIndex objIndex = getStackObject(inst->getOperand(0), buffer);
+				if (objIndex != AndersNodeFactory::InvalidIndex)
+				{
+					buffer.constraints.emplace_back(AndersConstraint::COPY, valIndex, objIndex);
+					break;
+				}
+				NodeIndex opIndex = getLocalValueNode(inst->getOperand(0), buffer);
+				assert(opIndex != AndersNodeFactory::InvalidIndex && "Failed to find load operand node");
+				buffer.constraints.emplace_back(AndersConstraint::LOAD, valIndex, opIndex);
 			}
 			break;
 		}
@@ -193,11 +937,17 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			if (inst->getOperand(0)->getType()->isPointerTy())
 			{
-				NodeIndex srcIndex = nodeFactory.getValueNodeFor(inst->getOperand(0));
+				NodeIndex srcIndex = getLocalValueNode(inst->getOperand(0), buffer);
 				assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find store src node");
-				NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst->getOperand(1));
+				NodeIndex objIndex = getStackObject(inst->getOperand(1), buffer);
+				if (objIndex != AndersNodeFactory::InvalidIndex)
+				{
+					buffer.constraints.emplace_back(AndersConstraint::COPY, objIndex, srcIndex);
+					break;
+				}
+				NodeIndex dstIndex = getLocalValueNode(inst->getOperand(1), buffer);
 				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find store dst node");
-				constraints.emplace_back(AndersConstraint::STORE, dstIndex, srcIndex);
+				buffer.constraints.emplace_back(AndersConstraint::STORE, dstIndex, srcIndex);
 			}
 			break;
 		}
@@ -205,13 +955,13 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			assert(inst->getType()->isPointerTy());
 
-			// P1 = getelementptr P2, ... --> <Copy/P1/P2>
-			NodeIndex srcIndex = nodeFactory.getValueNodeFor(inst->getOperand(0));
+			// P1 = getelementptr P2, ... --> <Copy/P1/P2>, or P1 = P2 + K field-sensitively
+			NodeIndex srcIndex = getLocalValueNode(inst->getOperand(0), buffer);
 			assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find gep src node");
-			NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst);
+			NodeIndex dstIndex = getLocalValueNode(inst, buffer);
 			assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find gep dst node");
 
-			constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+			addFieldConstraint(dstIndex, srcIndex, fieldSensitive ? getGEPFieldOffset(cast<GetElementPtrInst>(inst)) : 0, buffer);
 
 			break;
 		}
@@ -220,13 +970,13 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 			if (inst->getType()->isPointerTy())
 			{
 				const PHINode* phiInst = cast<PHINode>(inst);
-				NodeIndex dstIndex = nodeFactory.getValueNodeFor(phiInst);
+				NodeIndex dstIndex = getLocalValueNode(phiInst, buffer);
 				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find phi dst node");
 				for (unsigned i = 0, e = phiInst->getNumIncomingValues(); i != e; ++i)
 				{
-					NodeIndex srcIndex = nodeFactory.getValueNodeFor(phiInst->getIncomingValue(i));
+					NodeIndex srcIndex = getLocalValueNode(phiInst->getIncomingValue(i), buffer);
 					assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find phi src node");
-					constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+					addCopyConstraint(dstIndex, srcIndex, buffer);
 				}
 			}
 			break;
@@ -235,11 +985,11 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			if (inst->getType()->isPointerTy())
 			{
-				NodeIndex srcIndex = nodeFactory.getValueNodeFor(inst->getOperand(0));
+				NodeIndex srcIndex = getLocalValueNode(inst->getOperand(0), buffer);
 				assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find bitcast src node");
-				NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst);
+				NodeIndex dstIndex = getLocalValueNode(inst, buffer);
 				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find bitcast dst node");
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+				addCopyConstraint(dstIndex, srcIndex, buffer);
 			}
 			break;
 		}
@@ -248,7 +998,7 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 			assert(inst->getType()->isPointerTy());
 			
 			// Get the node index for dst
-			NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst);
+			NodeIndex dstIndex = getLocalValueNode(inst, buffer);
 			assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find inttoptr dst node");
 
 			// We use pattern matching to look for a matching ptrtoint
@@ -258,9 +1008,9 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 			Value* srcValue = nullptr;
 			if (PatternMatch::match(op, PatternMatch::m_PtrToInt(PatternMatch::m_Value(srcValue))))
 			{
-				NodeIndex srcIndex = nodeFactory.getValueNodeFor(srcValue);
+				NodeIndex srcIndex = getLocalValueNode(srcValue, buffer);
 				assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find inttoptr src node");
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
 				break;
 			}
 			
@@ -271,14 +1021,28 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 						PatternMatch::m_Value(srcValue)),
 					PatternMatch::m_Value())))
 			{
-				NodeIndex srcIndex = nodeFactory.getValueNodeFor(srcValue);
+				NodeIndex srcIndex = getLocalValueNode(srcValue, buffer);
 				assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find inttoptr src node");
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
 				break;
 			}
 			
+			// Anything else made of the pointers of the function: Y = inttoptr ((ptrtoint (X) | tag) & mask), Y = inttoptr (phi ...), ...
+			SmallVector<const Value*, 4> srcValues;
+			if (EnableIntProvenance && getIntegerProvenance(op, srcValues))
+			{
+				for (auto src: srcValues)
+				{
+					NodeIndex srcIndex = getLocalValueNode(src, buffer);
+					assert(srcIndex != AndersNodeFactory::InvalidIndex && "Failed to find inttoptr src node");
+					buffer.constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex);
+				}
+				++NumTrackedIntToPtrs;
+				break;
+			}
+
 			// Otherwise, we really don't know what dst points to
-			constraints.emplace_back(AndersConstraint::COPY, dstIndex, nodeFactory.getUniversalPtrNode());
+			buffer.constraints.emplace_back(AndersConstraint::COPY, dstIndex, nodeFactory.getUniversalPtrNode());
 
 			break;
 		}
@@ -286,14 +1050,14 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			if (inst->getType()->isPointerTy())
 			{
-				NodeIndex srcIndex1 = nodeFactory.getValueNodeFor(inst->getOperand(1));
+				NodeIndex srcIndex1 = getLocalValueNode(inst->getOperand(1), buffer);
 				assert(srcIndex1 != AndersNodeFactory::InvalidIndex && "Failed to find select src node 1");
-				NodeIndex srcIndex2 = nodeFactory.getValueNodeFor(inst->getOperand(2));
+				NodeIndex srcIndex2 = getLocalValueNode(inst->getOperand(2), buffer);
 				assert(srcIndex2 != AndersNodeFactory::InvalidIndex && "Failed to find select src node 2");
-				NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst);
+				NodeIndex dstIndex = getLocalValueNode(inst, buffer);
 				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find select dst node");
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex1);
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, srcIndex2);
+				addCopyConstraint(dstIndex, srcIndex1, buffer);
+				addCopyConstraint(dstIndex, srcIndex2, buffer);
 			}
 			break;
 		}
@@ -301,15 +1065,28 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 		{
 			if (inst->getType()->isPointerTy())
 			{
-				NodeIndex dstIndex = nodeFactory.getValueNodeFor(inst);
+				NodeIndex dstIndex = getLocalValueNode(inst, buffer);
 				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find va_arg dst node");
 				NodeIndex vaIndex = nodeFactory.getVarargNodeFor(inst->getParent()->getParent());
 				assert(vaIndex != AndersNodeFactory::InvalidIndex && "Failed to find vararg node");
-				constraints.emplace_back(AndersConstraint::COPY, dstIndex, vaIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, dstIndex, vaIndex);
 			}
 			break;
 		}
 		case Instruction::ExtractValue:
+		{
+			// The function pointer llvm.type.checked.load returns is the content of a slot of the vtable it is given
+			auto call = dyn_cast<IntrinsicInst>(cast<ExtractValueInst>(inst)->getAggregateOperand());
+			if (inst->getType()->isPointerTy() && call != nullptr && call->getIntrinsicID() == Intrinsic::type_checked_load)
+			{
+				NodeIndex dstIndex = getLocalValueNode(inst, buffer);
+				assert(dstIndex != AndersNodeFactory::InvalidIndex && "Failed to find extractvalue dst node");
+				NodeIndex vtableIndex = getLocalValueNode(call->getArgOperand(0), buffer);
+				assert(vtableIndex != AndersNodeFactory::InvalidIndex && "Failed to find vtable node");
+				buffer.constraints.emplace_back(AndersConstraint::LOAD, dstIndex, vtableIndex);
+				break;
+			}
+		}
 		case Instruction::InsertValue:
 		{
 			if (!inst->getType()->isPointerTy())
@@ -337,81 +1114,210 @@ void Andersen::collectConstraintsForInstruction(const Instruction* inst)
 	}
 }
 
+// The functions in c, a part of the initializer of a vtable that starts offset bytes into it, with the byte offsets of their slots
+static void collectVTableSlots(const Constant* c, uint64_t offset, const DataLayout& dl, std::vector<std::pair<uint64_t, const Function*>>& slots)
+{
+	if (auto cs = dyn_cast<ConstantStruct>(c))
+	{
+		const StructLayout* layout = dl.getStructLayout(cs->getType());
+		for (unsigned i = 0, e = cs->getNumOperands(); i < e; ++i)
+			collectVTableSlots(cs->getOperand(i), offset + layout->getElementOffset(i), dl, slots);
+	}
+	else if (auto ca = dyn_cast<ConstantArray>(c))
+	{
+		uint64_t elemSize = dl.getTypeAllocSize(ca->getType()->getElementType());
+		for (unsigned i = 0, e = ca->getNumOperands(); i < e; ++i)
+			collectVTableSlots(ca->getOperand(i), offset + i * elemSize, dl, slots);
+	}
+	else if (auto f = dyn_cast<Function>(c->stripPointerCasts()))
+		slots.push_back(std::make_pair(offset, f));
+}
+
+// Index the functions of vtable by the type identifiers of its !type metadata, each at the offset of its slot from the address point of that type
+void Andersen::collectTypeSlotTargets(const GlobalVariable& vtable)
+{
+	SmallVector<MDNode*, 2> types;
+	vtable.getMetadata(LLVMContext::MD_type, types);
+	if (types.empty())
+		return;
+
+	std::vector<std::pair<uint64_t, const Function*>> slots;
+	collectVTableSlots(vtable.getInitializer(), 0, vtable.getParent()->getDataLayout(), slots);
+	for (auto type: types)
+	{
+		auto addressPoint = mdconst::dyn_extract<ConstantInt>(type->getOperand(0));
+		if (addressPoint == nullptr)
+			continue;
+		for (auto const& slot: slots)
+		{
+			// Only the address-taken functions have the nodes the argument constraints go to
+			if (slot.first < addressPoint->getZExtValue() || !isAddressTaken(*slot.second))
+				continue;
+			std::vector<const Function*>& targets = typeSlotTargets[std::make_pair(type->getOperand(1).get(), slot.first - addressPoint->getZExtValue())];
+			// A derived class that doesn't override a function has it in the same slot as its base
+			if (std::find(targets.begin(), targets.end(), slot.second) == targets.end())
+				targets.push_back(slot.second);
+		}
+	}
+}
+
+// The type identifier that an llvm.type.test checks vtable against, looking through the casts of vtable, or null if nothing tests it
+static const Metadata* getTestedType(const Value* vtable)
+{
+	for (auto user: vtable->users())
+	{
+		if (auto call = dyn_cast<IntrinsicInst>(user))
+		{
+			if (call->getIntrinsicID() == Intrinsic::type_test && call->getArgOperand(0) == vtable)
+				return cast<MetadataAsValue>(call->getArgOperand(1))->getMetadata();
+		}
+		else if (isa<BitCastInst>(user))
+		{
+			if (const Metadata* type = getTestedType(user))
+				return type;
+		}
+	}
+	return nullptr;
+}
+
+// The functions a virtual call may reach, if its callee comes out of a vtable slot whose type it checks: loaded at a constant offset from a vtable pointer that llvm.type.test checks, or taken from llvm.type.checked.load. Return null if the call is not one of those, or if no vtable of the module has a function in that slot, in which case the call is wired as any other indirect call
+const std::vector<const Function*>* Andersen::getTypeSlotTargets(ImmutableCallSite cs) const
+{
+	const Metadata* type = nullptr;
+	uint64_t slot = 0;
+	const Value* callee = cs.getCalledValue()->stripPointerCasts();
+	if (auto extract = dyn_cast<ExtractValueInst>(callee))
+	{
+		// {callee, ok} = llvm.type.checked.load(vtable, slot, type)
+		auto call = dyn_cast<IntrinsicInst>(extract->getAggregateOperand());
+		if (call == nullptr || call->getIntrinsicID() != Intrinsic::type_checked_load || extract->getNumIndices() != 1 || *extract->idx_begin() != 0)
+			return nullptr;
+		auto offset = dyn_cast<ConstantInt>(call->getArgOperand(1));
+		if (offset == nullptr)
+			return nullptr;
+		type = cast<MetadataAsValue>(call->getArgOperand(2))->getMetadata();
+		slot = offset->getZExtValue();
+	}
+	else if (auto load = dyn_cast<LoadInst>(callee))
+	{
+		// callee = *(vtable + slot), with llvm.type.test(vtable, type)
+		const DataLayout& dl = load->getModule()->getDataLayout();
+		APInt offset(dl.getPointerSizeInBits(), 0);
+		const Value* vtable = load->getPointerOperand()->stripAndAccumulateInBoundsConstantOffsets(dl, offset);
+		if (offset.isNegative())
+			return nullptr;
+		type = getTestedType(vtable);
+		slot = offset.getZExtValue();
+	}
+	if (type == nullptr)
+		return nullptr;
+
+	auto itr = typeSlotTargets.find(std::make_pair(type, slot));
+	return itr != typeSlotTargets.end() ? &itr->second : nullptr;
+}
+
 // There are two types of constraints to add for a function call:
 // - ValueNode(callsite) = ReturnNode(call target)
 // - ValueNode(formal arg) = ValueNode(actual arg)
-void Andersen::addConstraintForCall(ImmutableCallSite cs)
+void Andersen::addConstraintForCall(ImmutableCallSite cs, CollectionBuffer& buffer) const
 {
 	if (const Function* f = cs.getCalledFunction())	// Direct call
 	{
-		if (f->isDeclaration() || f->isIntrinsic())	// External library call
+		if (isExternalFunction(*f))	// External library call
 		{
+			unsigned firstConstraint = buffer.constraints.size();
 			// Handle libraries separately
-			if (addConstraintForExternalLibrary(cs, f))
-				return;
-			else	// Unresolved library call: ruin everything!
+			if (!addConstraintForExternalLibrary(cs, f, buffer))	// Unresolved library call: ruin everything!
 			{
-				errs() << "Unresolved ext function: " << f->getName() << "\n";
+				// In a summary, the function may still be defined by another module. A function out of the scope is unknown on purpose
+				if (!summary && !scopedOut.count(f))
+					buffer.diagnostics += "Unresolved ext function: " + f->getName().str() + "\n";
 				if (cs.getType()->isPointerTy())
 				{
-					NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+					NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 					assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find ret node!");
-					constraints.emplace_back(AndersConstraint::COPY, retIndex, nodeFactory.getUniversalPtrNode());
+					buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, nodeFactory.getUniversalPtrNode());
 				}
 				for (ImmutableCallSite::arg_iterator itr = cs.arg_begin(), ite = cs.arg_end(); itr != ite; ++itr)
 				{
 					Value* argVal = *itr;
 					if (argVal->getType()->isPointerTy())
 					{
-						NodeIndex argIndex = nodeFactory.getValueNodeFor(argVal);
+						NodeIndex argIndex = getLocalValueNode(argVal, buffer);
 						assert(argIndex != AndersNodeFactory::InvalidIndex && "Failed to find arg node!");
-						constraints.emplace_back(AndersConstraint::COPY, argIndex, nodeFactory.getUniversalPtrNode());
+						buffer.constraints.emplace_back(AndersConstraint::COPY, argIndex, nodeFactory.getUniversalPtrNode());
 					}
 				}
 			}
+			if (summary && !f->isIntrinsic())
+				deferExternalCall(cs, f, firstConstraint, buffer);
 		}
 		else	// Non-external function call
 		{
 			if (cs.getType()->isPointerTy())
 			{
-				NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+				NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 				assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find ret node!");
 				//errs() << f->getName() << "\n";
-				NodeIndex fRetIndex = nodeFactory.getReturnNodeFor(f);
-				assert(fRetIndex != AndersNodeFactory::InvalidIndex && "Failed to find function ret node!");
-				constraints.emplace_back(AndersConstraint::COPY, retIndex, fRetIndex);
+				auto wrapperItr = allocWrappers.find(f);
+				if (wrapperItr != allocWrappers.end())
+				{
+					// A heap clone: the call site is the allocation site, as if it called malloc itself
+					NodeIndex objIndex = buffer.createObjectNode(cs.getInstruction());
+					buffer.constraints.emplace_back(AndersConstraint::ADDR_OF, retIndex, objIndex);
+					if (wrapperItr->second)
+						buffer.constraints.emplace_back(AndersConstraint::ADDR_OF, retIndex, nodeFactory.getNullObjectNode());
+				}
+				else
+				{
+					NodeIndex fRetIndex = nodeFactory.getReturnNodeFor(f);
+					assert(fRetIndex != AndersNodeFactory::InvalidIndex && "Failed to find function ret node!");
+					buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, fRetIndex);
+				}
 			}
 			// The argument constraints
-			addArgumentConstraintForCall(cs, f);
+			addArgumentConstraintForCall(cs, f, buffer);
 		}
 	}
+	else if (summary)
+	{
+		// The address-taken functions of the other modules are unknown yet, so the linker wires the call to its targets. The value of the call may be anything, as below
+		ConstraintSummary::IndirectCall call;
+		call.result = cs.getType()->isPointerTy() ? getLocalValueNode(cs.getInstruction(), buffer) : AndersNodeFactory::InvalidIndex;
+		if (call.result != AndersNodeFactory::InvalidIndex)
+			buffer.constraints.emplace_back(AndersConstraint::COPY, call.result, nodeFactory.getUniversalPtrNode());
+		getCallArgNodes(cs, call.args);
+		buffer.summaryIndirectCalls.push_back(std::move(call));
+	}
 	else	// Indirect call
 	{
+		++buffer.numIndirectCalls;
+		// With on-the-fly call graph resolution, the defined functions the call may reach are left to the solver. Calls to external functions are still modeled here
+		NodeIndex calleeIndex = EnableOnTheFlyCallGraph ? getLocalValueNode(cs.getCalledValue(), buffer) : AndersNodeFactory::InvalidIndex;
+		bool resolveLater = (calleeIndex != AndersNodeFactory::InvalidIndex);
+		if (resolveLater)
+		{
+			buffer.indirectCalls.emplace_back(cs.getInstruction(), calleeIndex);
+		}
+
 		// We do the simplest thing here: just assume the returned value can be anything :)
+		// When the call is resolved later, its value is copied from the return values of the targets instead
 		if (cs.getType()->isPointerTy())
 		{
-			NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+			NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 			assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find ret node!");
-			constraints.emplace_back(AndersConstraint::COPY, retIndex, nodeFactory.getUniversalPtrNode());
+			if (resolveLater)
+				buffer.lateCopyTargets.push_back(retIndex);
+			else
+				buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, nodeFactory.getUniversalPtrNode());
 		}
 
-		// For argument constraints, first search through all addr-taken functions: any function that takes can take as many variables is a potential candidate
-		const Module* M = cs.getInstruction()->getParent()->getParent()->getParent();
-		for (auto const& f: *M)
+		auto addTarget = [this, cs, resolveLater, &buffer] (const Function* f, ExternalLibraryKind extKind)
 		{
-			NodeIndex funPtrIndex = nodeFactory.getValueNodeFor(&f);
-			if (funPtrIndex == AndersNodeFactory::InvalidIndex)
-				// Not an addr-taken function
-				continue;
-
-			if (!f.getFunctionType()->isVarArg() && f.arg_size() != cs.arg_size())
-				// #arg mismatch
-				continue;
-
-			if (f.isDeclaration() || f.isIntrinsic())	// External library call
+			if (isExternalFunction(*f))	// External library call
 			{
-				if (addConstraintForExternalLibrary(cs, &f))
-					continue;
+				if (addConstraintForExternalLibrary(cs, f, extKind, buffer))
+					return;
 				else
 				{
 					// Pollute everything
@@ -421,20 +1327,142 @@ void Andersen::addConstraintForCall(ImmutableCallSite cs)
 
 						if (argVal->getType()->isPointerTy())
 						{
-							NodeIndex argIndex = nodeFactory.getValueNodeFor(argVal);
+							NodeIndex argIndex = getLocalValueNode(argVal, buffer);
 							assert(argIndex != AndersNodeFactory::InvalidIndex && "Failed to find arg node!");
-							constraints.emplace_back(AndersConstraint::COPY, argIndex, nodeFactory.getUniversalPtrNode());
+							buffer.constraints.emplace_back(AndersConstraint::COPY, argIndex, nodeFactory.getUniversalPtrNode());
 						}
 					}
+					// The value of the call is no longer tied to the universal pointer above
+					if (resolveLater && cs.getType()->isPointerTy())
+						buffer.constraints.emplace_back(AndersConstraint::COPY, getLocalValueNode(cs.getInstruction(), buffer), nodeFactory.getUniversalPtrNode());
 				}
 			}
-			else
-				addArgumentConstraintForCall(cs, &f);
+			else if (!resolveLater)
+				addArgumentConstraintForCall(cs, f, buffer);
+		};
+
+		// With -anders-type-metadata-calls, a virtual call only reaches the functions in its slot of the vtables of the type it checks
+		if (const std::vector<const Function*>* slotTargets = EnableTypeMetadataCalls ? getTypeSlotTargets(cs) : nullptr)
+		{
+			++NumTypeRestrictedCalls;
+			for (auto f: *slotTargets)
+				if (f->getFunctionType()->isVarArg() || f->arg_size() == cs.arg_size())
+					addTarget(f, isExternalFunction(*f) ? externalLibraryKinds.lookup(f) : EXT_UNKNOWN);
+			return;
+		}
+
+		// For argument constraints, first search through all addr-taken functions: any function that takes can take as many variables is a potential candidate
+		// Those are the functions of the right arity plus all the vararg ones. Both lists are in module order, so merge them to visit the candidates in that order
+		static const std::vector<IndirectCallTarget> noTargets;
+		const std::vector<IndirectCallTarget>& fixedTargets = cs.arg_size() < fixedArityTargets.size() ? fixedArityTargets[cs.arg_size()] : noTargets;
+		auto fixedItr = fixedTargets.begin(), fixedIte = fixedTargets.end();
+		auto varargItr = varargTargets.begin(), varargIte = varargTargets.end();
+		while (fixedItr != fixedIte || varargItr != varargIte)
+		{
+			const IndirectCallTarget& target = (varargItr == varargIte || (fixedItr != fixedIte && fixedItr->order < varargItr->order)) ? *fixedItr++ : *varargItr++;
+			addTarget(target.func, target.extKind);
 		}
 	}
 }
 
-void Andersen::addArgumentConstraintForCall(ImmutableCallSite cs, const Function* f)
+// Wire the indirect call to f, which has been found in the points-to set of its callee pointer. Like addConstraintForCall(), this adds constraints to the constraint list
+void Andersen::addIndirectCallTarget(IndirectCallRecord& call, const Function* f, CollectionBuffer& buffer) const
+{
+	ImmutableCallSite cs(call.inst);
+	call.targets.push_back(f);
+
+	if (cs.getType()->isPointerTy())
+	{
+		NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
+		assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find ret node!");
+		// The call and the function may disagree on the return type if the function has been cast
+		NodeIndex fRetIndex = nodeFactory.getReturnNodeFor(f);
+		if (fRetIndex == AndersNodeFactory::InvalidIndex)
+			fRetIndex = nodeFactory.getUniversalPtrNode();
+		buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, fRetIndex);
+	}
+
+	addArgumentConstraintForCall(cs, f, buffer);
+}
+
+// Look at the new elements of the callee pointers' points-to sets and add the constraints for the calls to the functions found there. Return true if any constraint is added
+bool Andersen::resolveIndirectCalls()
+{
+	assert(constraints.empty() && "The constraint list should have been consumed!");
+
+	// No node is created here, so the buffer only carries the constraints
+	CollectionBuffer buffer;
+	for (auto& call: indirectCalls)
+	{
+		if (call.unknownTarget)
+			continue;
+
+		const AndersPtsSet* calleePtsSet = ptsGraph.find(nodeFactory.getMergeTarget(call.callee));
+		if (calleePtsSet == nullptr)
+			continue;
+
+		ImmutableCallSite cs(call.inst);
+		// With -anders-type-metadata-calls, a virtual call only reaches the functions in its slot, whatever else the imprecision of the callee pointer lets in
+		const std::vector<const Function*>* slotTargets = EnableTypeMetadataCalls ? getTypeSlotTargets(cs) : nullptr;
+		for (auto obj: *calleePtsSet)
+		{
+			if (!call.examinedObjs.test_and_set(obj))
+				continue;
+
+			// The callee pointer may point to anything. Fall back to what the collection does without on-the-fly resolution: the value of the call may be anything (which covers the return values of all the targets), and every address-taken function that can take as many arguments gets the arguments
+			if (obj == nodeFactory.getUniversalObjNode())
+			{
+				call.unknownTarget = true;
+				call.targets.clear();
+				if (cs.getType()->isPointerTy())
+					buffer.constraints.emplace_back(AndersConstraint::COPY, nodeFactory.getValueNodeFor(cs.getInstruction()), nodeFactory.getUniversalPtrNode());
+				if (slotTargets != nullptr)
+				{
+					for (auto f: *slotTargets)
+					{
+						if (!isExternalFunction(*f) && (f->getFunctionType()->isVarArg() || f->arg_size() == cs.arg_size()))
+						{
+							call.targets.push_back(f);
+							addArgumentConstraintForCall(cs, f, buffer);
+						}
+					}
+					break;
+				}
+				for (auto targets: { &varargTargets, cs.arg_size() < fixedArityTargets.size() ? &fixedArityTargets[cs.arg_size()] : nullptr })
+				{
+					if (targets == nullptr)
+						continue;
+					for (auto const& target: *targets)
+					{
+						if (!isExternalFunction(*target.func))
+						{
+							call.targets.push_back(target.func);
+							addArgumentConstraintForCall(cs, target.func, buffer);
+						}
+					}
+				}
+				break;
+			}
+
+			// Only the object node of a function stands for the function
+			const Function* f = dyn_cast_or_null<Function>(nodeFactory.getValueForNode(obj));
+			if (f == nullptr || nodeFactory.getObjectNodeFor(f) != obj || isExternalFunction(*f))
+				continue;
+			if (!f->getFunctionType()->isVarArg() && f->arg_size() != cs.arg_size())
+				// #arg mismatch
+				continue;
+			if (slotTargets != nullptr && std::find(slotTargets->begin(), slotTargets->end(), f) == slotTargets->end())
+				continue;
+
+			addIndirectCallTarget(call, f, buffer);
+		}
+	}
+
+	constraints.swap(buffer.constraints);
+	return !constraints.empty();
+}
+
+void Andersen::addArgumentConstraintForCall(ImmutableCallSite cs, const Function* f, CollectionBuffer& buffer) const
 {
 	Function::const_arg_iterator fItr = f->arg_begin();
 	ImmutableCallSite::arg_iterator aItr = cs.arg_begin();
@@ -449,12 +1477,12 @@ void Andersen::addArgumentConstraintForCall(ImmutableCallSite cs, const Function
 			assert(fIndex != AndersNodeFactory::InvalidIndex && "Failed to find formal arg node!");
 			if (actual->getType()->isPointerTy())
 			{
-				NodeIndex aIndex = nodeFactory.getValueNodeFor(actual);
+				NodeIndex aIndex = getLocalValueNode(actual, buffer);
 				assert(aIndex != AndersNodeFactory::InvalidIndex && "Failed to find actual arg node!");
-				constraints.emplace_back(AndersConstraint::COPY, fIndex, aIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, fIndex, aIndex);
 			}
 			else
-				constraints.emplace_back(AndersConstraint::COPY, fIndex, nodeFactory.getUniversalPtrNode());
+				buffer.constraints.emplace_back(AndersConstraint::COPY, fIndex, nodeFactory.getUniversalPtrNode());
 		}
 
 		++fItr, ++aItr;
@@ -468,11 +1496,11 @@ void Andersen::addArgumentConstraintForCall(ImmutableCallSite cs, const Function
 			const Value* actual = *aItr;
 			if (actual->getType()->isPointerTy())
 			{
-				NodeIndex aIndex = nodeFactory.getValueNodeFor(actual);
+				NodeIndex aIndex = getLocalValueNode(actual, buffer);
 				assert(aIndex != AndersNodeFactory::InvalidIndex && "Failed to find actual arg node!");
 				NodeIndex vaIndex = nodeFactory.getVarargNodeFor(f);
 				assert(vaIndex != AndersNodeFactory::InvalidIndex && "Failed to find vararg node!");
-				constraints.emplace_back(AndersConstraint::COPY, vaIndex, aIndex);
+				buffer.constraints.emplace_back(AndersConstraint::COPY, vaIndex, aIndex);
 			}
 
 			++aItr;
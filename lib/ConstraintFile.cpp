@@ -0,0 +1,141 @@
+#include "Andersen.h"
+#include "ConstraintFile.h"
+#include "WordFile.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace ConstraintFileFormat;
+
+ConstraintFileWriter::ConstraintFileWriter(raw_ostream& o, unsigned numNodes, ArrayRef<NodeIndex> objectNodes): os(o)
+{
+	assert(std::is_sorted(objectNodes.begin(), objectNodes.end()));
+
+	Header header = { Magic, Version, numNodes, static_cast<std::uint32_t>(objectNodes.size()) };
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	WordFile::writeArray(os, objectNodes);
+	// Keep the constraints 8-byte aligned
+	if (objectNodes.size() % 2 != 0)
+	{
+		std::uint32_t padding = 0;
+		os.write(reinterpret_cast<const char*>(&padding), sizeof(padding));
+	}
+}
+
+std::unique_ptr<ConstraintFileReader> ConstraintFileReader::open(StringRef fileName, std::string& error)
+{
+	auto fileOrErr = MemoryBuffer::getFile(fileName, -1, false);
+	if (!fileOrErr)
+	{
+		error = "cannot read " + fileName.str() + ": " + fileOrErr.getError().message();
+		return nullptr;
+	}
+	return open(std::move(*fileOrErr), error);
+}
+
+std::unique_ptr<ConstraintFileReader> ConstraintFileReader::open(std::unique_ptr<MemoryBuffer> buffer, std::string& error)
+{
+	const Header* header = WordFile::readHeader<Header>(buffer, Magic, Version, "constraint file", error);
+	if (header == nullptr)
+		return nullptr;
+	size_t size = buffer->getBufferSize();
+
+	size_t objectBytes = (header->numObjectNodes + header->numObjectNodes % 2) * sizeof(std::uint32_t);
+	if (size < sizeof(Header) + objectBytes || (size - sizeof(Header) - objectBytes) % sizeof(std::uint64_t) != 0)
+	{
+		error = "the size of the file doesn't match its header";
+		return nullptr;
+	}
+
+	std::unique_ptr<ConstraintFileReader> ret(new ConstraintFileReader);
+	ret->header = header;
+	ret->objectNodes = reinterpret_cast<const std::uint32_t*>(header + 1);
+	ret->keys = reinterpret_cast<const std::uint64_t*>(buffer->getBufferStart() + sizeof(Header) + objectBytes);
+	ret->numConstraints = (size - sizeof(Header) - objectBytes) / sizeof(std::uint64_t);
+	ret->buffer = std::move(buffer);
+
+	auto objs = ret->getObjectNodes();
+	for (unsigned i = 0, e = objs.size(); i < e; ++i)
+	{
+		if (objs[i] >= header->numNodes || (i > 0 && objs[i] <= objs[i - 1]))
+		{
+			error = "the object nodes are out of range or not sorted";
+			return nullptr;
+		}
+	}
+	return ret;
+}
+
+void Andersen::writeConstraints(raw_ostream& os) const
+{
+	std::vector<NodeIndex> objectNodes;
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+	{
+		assert(nodeFactory.getMergeTarget(n) == n && "The constraints must be written before they are optimized");
+		if (nodeFactory.isObjectNode(n))
+			objectNodes.push_back(n);
+	}
+
+	ConstraintFileWriter writer(os, nodeFactory.getNumNodes(), objectNodes);
+	for (auto const& c: constraints)
+		writer.write(c);
+}
+
+bool Andersen::readConstraints(const ConstraintFileReader& reader, std::string& error)
+{
+	unsigned numNodes = reader.getNumNodes();
+	// The special nodes already exist
+	unsigned numSpecialNodes = nodeFactory.getNumNodes();
+	if (numNodes < numSpecialNodes || numNodes >= ProvisionalIndexBase)
+	{
+		error = "bad number of nodes " + std::to_string(numNodes);
+		return false;
+	}
+
+	auto objectNodes = reader.getObjectNodes();
+	auto nextObj = objectNodes.begin();
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		bool isObject = nextObj != objectNodes.end() && *nextObj == n;
+		if (isObject)
+			++nextObj;
+
+		if (n < numSpecialNodes)
+		{
+			if (isObject != nodeFactory.isObjectNode(n))
+			{
+				error = "the special nodes don't match";
+				return false;
+			}
+		}
+		else if (isObject)
+			nodeFactory.createObjectNode();
+		else
+			nodeFactory.createValueNode();
+	}
+
+	constraints.reserve(reader.getNumConstraints());
+	for (size_t i = 0, e = reader.getNumConstraints(); i < e; ++i)
+	{
+		AndersConstraint c = reader.getConstraint(i);
+		if (c.getDest() >= numNodes || c.getSrc() >= numNodes)
+		{
+			error = "constraint " + std::to_string(i) + " refers to a node that doesn't exist";
+			return false;
+		}
+		constraints.push_back(c);
+	}
+	// A file written from a ConstraintGenerator may repeat constraints, which HVN and HU would otherwise see as distinct
+	uniquifyConstraints(constraints);
+	return true;
+}
+
+std::unique_ptr<Andersen> Andersen::createFromConstraints(const ConstraintFileReader& reader, std::string& error, const AndersRunOptions& options)
+{
+	std::unique_ptr<Andersen> ret(new Andersen());
+	ret->runOptions = options;
+	if (!ret->readConstraints(reader, error))
+		return nullptr;
+	ret->solveCollectedConstraints();
+	return ret;
+}
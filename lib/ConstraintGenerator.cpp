@@ -0,0 +1,131 @@
+#include "ConstraintFile.h"
+#include "ConstraintGenerator.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+SyntheticConstraintShape SyntheticConstraintShape::like(const ConstraintFileReader& reader)
+{
+	SyntheticConstraintShape shape;
+	unsigned numSpecialNodes = AndersNodeFactory().getNumNodes();
+	shape.numNodes = reader.getNumNodes() > numSpecialNodes ? reader.getNumNodes() - numSpecialNodes : 0;
+	if (reader.getNumNodes() != 0)
+		shape.objectRatio = static_cast<double>(reader.getObjectNodes().size()) / reader.getNumNodes();
+	shape.numConstraints = reader.getNumConstraints();
+
+	double weights[4] = { 0, 0, 0, 0 };
+	for (size_t i = 0, e = reader.getNumConstraints(); i < e; ++i)
+		++weights[reader.getConstraint(i).getType()];
+	shape.addrOfWeight = weights[AndersConstraint::ADDR_OF];
+	shape.copyWeight = weights[AndersConstraint::COPY];
+	shape.loadWeight = weights[AndersConstraint::LOAD];
+	shape.storeWeight = weights[AndersConstraint::STORE];
+	return shape;
+}
+
+SyntheticConstraintGenerator::SyntheticConstraintGenerator(const SyntheticConstraintShape& s): shape(s), rng(s.seed)
+{
+	AndersNodeFactory specialNodes;
+	unsigned numSpecialNodes = specialNodes.getNumNodes();
+	for (NodeIndex n = 0; n < numSpecialNodes; ++n)
+		if (specialNodes.isObjectNode(n))
+			allObjectNodes.push_back(n);
+
+	// Spread the objects among the values, as the collection does. There is at least one node of each kind, so that every kind of constraint can be drawn
+	numNodes = numSpecialNodes + std::max(shape.numNodes, 2u);
+	for (NodeIndex n = numSpecialNodes; n < numNodes; ++n)
+	{
+		bool isObject = drawProbability() < shape.objectRatio;
+		if (n + 1 == numNodes && (objectNodes.empty() || valueNodes.empty()))
+			isObject = objectNodes.empty();
+		(isObject ? objectNodes : valueNodes).push_back(n);
+	}
+	allObjectNodes.insert(allObjectNodes.end(), objectNodes.begin(), objectNodes.end());
+
+	totalWeight = shape.addrOfWeight + shape.copyWeight + shape.loadWeight + shape.storeWeight;
+	if (totalWeight <= 0)
+		totalWeight = shape.copyWeight = 1;
+}
+
+NodeIndex SyntheticConstraintGenerator::drawNear(const std::vector<NodeIndex>& nodes, double position)
+{
+	unsigned size = nodes.size();
+	unsigned center = std::min(static_cast<unsigned>(position * size), size - 1);
+	unsigned low = center > shape.locality ? center - shape.locality : 0;
+	unsigned high = std::min(center + shape.locality, size - 1);
+	return nodes[low + draw(high - low + 1)];
+}
+
+AndersConstraint SyntheticConstraintGenerator::drawConstraint()
+{
+	unsigned numValues = valueNodes.size();
+	unsigned dest = draw(numValues);
+	double position = static_cast<double>(dest) / numValues;
+
+	double p = drawProbability() * totalWeight;
+	if (p < shape.addrOfWeight)
+		return AndersConstraint(AndersConstraint::ADDR_OF, valueNodes[dest], drawNear(objectNodes, position));
+	p -= shape.addrOfWeight;
+	if (p < shape.copyWeight)
+	{
+		// A forward copy comes from a value before dest, a backward one from a value after it
+		unsigned distance = 1 + draw(std::max(shape.locality, 1u));
+		unsigned src;
+		if (drawProbability() < shape.cycleDensity)
+			src = dest + distance < numValues ? dest + distance : dest;
+		else
+			src = dest >= distance ? dest - distance : dest;
+		return AndersConstraint(AndersConstraint::COPY, valueNodes[dest], valueNodes[src]);
+	}
+	p -= shape.copyWeight;
+	if (p < shape.loadWeight)
+		return AndersConstraint(AndersConstraint::LOAD, valueNodes[dest], drawNear(valueNodes, position));
+	return AndersConstraint(AndersConstraint::STORE, valueNodes[dest], drawNear(valueNodes, position));
+}
+
+void SyntheticConstraintGenerator::generate(function_ref<void(const AndersConstraint&)> emit)
+{
+	for (unsigned i = 0; i < shape.numConstraints; ++i)
+		emit(drawConstraint());
+
+	for (unsigned i = 0; i < shape.numHubs; ++i)
+	{
+		NodeIndex hub = drawValue();
+		for (unsigned j = 0; j < shape.hubDegree; ++j)
+		{
+			emit(AndersConstraint(AndersConstraint::COPY, hub, drawValue()));
+			emit(AndersConstraint(AndersConstraint::COPY, drawValue(), hub));
+		}
+	}
+
+	if (shape.numFunctions == 0)
+		return;
+	// The parameters of each function, followed by its return node
+	unsigned numFuncNodes = shape.numCallArgs + 1;
+	std::vector<NodeIndex> funcNodes(shape.numFunctions * numFuncNodes);
+	for (auto& n: funcNodes)
+		n = drawValue();
+	std::vector<NodeIndex> callNodes(numFuncNodes);
+	for (unsigned i = 0; i < shape.numIndirectCalls; ++i)
+	{
+		// The actual arguments, followed by the result
+		for (auto& n: callNodes)
+			n = drawValue();
+		for (unsigned j = 0; j < shape.callFanOut; ++j)
+		{
+			const NodeIndex* func = &funcNodes[draw(shape.numFunctions) * numFuncNodes];
+			for (unsigned k = 0; k < shape.numCallArgs; ++k)
+				emit(AndersConstraint(AndersConstraint::COPY, func[k], callNodes[k]));
+			emit(AndersConstraint(AndersConstraint::COPY, callNodes.back(), func[shape.numCallArgs]));
+		}
+	}
+}
+
+std::vector<AndersConstraint> SyntheticConstraintGenerator::generate()
+{
+	std::vector<AndersConstraint> constraints;
+	constraints.reserve(shape.numConstraints + 2 * shape.numHubs * shape.hubDegree + shape.numIndirectCalls * shape.callFanOut * (shape.numCallArgs + 1));
+	generate([&constraints] (const AndersConstraint& c) { constraints.push_back(c); });
+	return constraints;
+}
@@ -1,64 +1,81 @@
 #include "Andersen.h"
 #include "CycleDetector.h"
-#include "SparseBitVectorGraph.h"
+#include "DenseSparseBitVectorGraph.h"
+#include "LabelSetTable.h"
+#include "OptimizeCache.h"
+#include "Parallel.h"
+#include "PhaseTimer.h"
 
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
-#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/ToolOutputFile.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/FileSystem.h"
 
+#include <algorithm>
+#include <atomic>
 #include <deque>
-#include <unordered_map>
-#include <set>
+#include <map>
 
 using namespace llvm;
 
 cl::opt<bool> EnableHVN("enable-hvn", cl::desc("Enable the HVN constraint optimization"));
 cl::opt<bool> EnableHU("enable-hu", cl::desc("Enable the HU constraint optimization"));
+cl::opt<bool> EnableHRU("enable-hru", cl::desc("Enable the HRU constraint optimization, i.e. HVN and HU iterated to a fixed point. Implies -enable-hvn and -enable-hu"));
+cl::opt<bool> EnableLE("enable-le", cl::desc("Enable the location equivalence constraint optimization"));
+cl::opt<std::string> OptimizeCacheDir("anders-optimize-cache", cl::desc("Keep what the offline optimizations make of the constraints in this directory, and load it back instead of running them when the same constraints come again with the same options"), cl::value_desc("directory"));
+cl::opt<unsigned> NumOptimizerThreads("anders-offline-threads", cl::desc("The number of threads used to propagate the labels of HVN and HU and to find the cycles of HCD (1 for the sequential algorithms, 0 for one thread per hardware thread)"), cl::init(1));
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumNodes, "Number of nodes");
+STATISTIC(NumConstraintsCollected, "Number of constraints before the offline optimizations");
+STATISTIC(NumConstraintsAfterHVN, "Number of constraints after HVN");
+STATISTIC(NumConstraintsAfterHU, "Number of constraints after HU");
+STATISTIC(NumConstraintsAfterLE, "Number of constraints after location equivalence");
+STATISTIC(NumOfflineMerges, "Number of nodes merged by the offline optimizations");
+STATISTIC(NumHUSetsReleased, "Number of offline points-to sets HU freed once the last node reading them was labelled");
+STATISTIC(NumOptimizeCacheHits, "Number of times the offline optimizations were loaded from -anders-optimize-cache");
 
 namespace {
 
-struct SparseBitVectorHash
-{
-	std::size_t operator() (const SparseBitVector<>& vec) const
-	{
-		std::size_t ret = 0;
-		for (auto const& idx: vec)
-			ret ^= idx;
-		return ret;
-	}
-};
-
-struct SparseBitVectorKeyEqual
-{
-	bool operator() (const SparseBitVector<>& lhs, const SparseBitVector<>& rhs) const
-	{
-		return lhs == rhs;
-	}
-};
-
 // There is something in common in HVN and HU. Put all the shared stuffs in the base class here
-class ConstraintOptimizer: public CycleDetector<SparseBitVectorGraph>
+class ConstraintOptimizer: public CycleDetector<ConstraintOptimizer, DenseSparseBitVectorGraph>
 {
 protected:
+	friend class CycleDetector<ConstraintOptimizer, DenseSparseBitVectorGraph>;
+
 	std::vector<AndersConstraint>& constraints;
 	AndersNodeFactory& nodeFactory;
 
-	// The predecessor graph
-	SparseBitVectorGraph predGraph;
+	// The predecessor graph. It holds the VAR, REF and ADR nodes, i.e. 3 * numNodes of them
+	DenseSparseBitVectorGraph predGraph;
 	// Nodes that must be treated conservatively (i.e. never merge with others)
 	// Note that REF nodes and ADR nodes are all automatically indirect nodes. This set only keep track of indirect nodes that are not REF or ADR
 	DenseSet<NodeIndex> indirectNodes;
 
 	// Map from NodeIndex to Pointer Equivalence Class
 	DenseMap<NodeIndex, unsigned> peLabel;
-	// Current pointer equivalence class number
-	unsigned pointerEqClass;
-
-	// Store the "representative" (or "leader") when there is a merge in the cycle. Note that this is different from AndersNode::mergeTarget, which will be set AFTER the optimization
+	// Current pointer equivalence class number. It is only shared between threads when the labels are propagated in parallel
+	std::atomic<unsigned> pointerEqClass;
+	// The elements of the sets of labels (HVN) and of the offline points-to sets (HU), and of their copies in setLabel. All of them go away in one piece with the optimizer
+	SparseBitVectorArena setArena;
+	// Map from a set (of labels for HVN, of offline points-to set elements for HU) to Pointer Equivalence Class. The concurrent table replaces it while the labels are propagated in parallel
+	LabelSetTable setLabel;
+	std::unique_ptr<ConcurrentLabelSetTable> concurrentSetLabel;
+
+	// The number of threads the labels are propagated on. With more than one, the SCC representatives are only collected during the DFS, in the order in which they are finished, and labelled afterwards
+	unsigned numThreads;
+	std::vector<NodeIndex> repOrder;
+	// Levels with fewer nodes than this are labelled by the calling thread alone: spawning the workers would cost more than the work itself
+	static const unsigned MinParallelLevelSize = 1024;
+	// The number of nodes of a level a thread grabs at a time
+	static const unsigned LevelChunkSize = 64;
+
+	// Store the "representative" (or "leader") when there is a merge in the cycle. Note that this is different from the merge targets in AndersNodeFactory, which will be set AFTER the optimization
 	DenseMap<NodeIndex, NodeIndex> mergeTarget;
 
 	// During variable substitution, we create unknowns to represent the unknown value that is a dereference of a variable.  These nodes are known as "ref" nodes (since they represent the value of dereferences)
@@ -89,8 +106,8 @@ protected:
 				case AndersConstraint::ADDR_OF:
 				{
 					indirectNodes.insert(srcTgt);
-					// Dest = &src edge
-					predGraph.insertEdge(dstTgt, getAdrNodeIndex(srcTgt));
+					// Dest = &src edge. Merging two nodes merges what they hold, but their addresses stay different, so the ADR node is that of the original src
+					predGraph.insertEdge(dstTgt, getAdrNodeIndex(c.getSrc()));
 					// *Dest = src edge
 					predGraph.insertEdge(getRefNodeIndex(dstTgt), srcTgt);
 					break;
@@ -131,11 +148,10 @@ protected:
 	void dumpPredecessorGraph() const
 	{
 		errs() << "\n----- Predecessor Graph -----\n";
-		for (auto const& mapping: predGraph)
+		for (auto const& sNode: predGraph)
 		{
-			printPredecessorGraphNode(errs(), mapping.first);
+			printPredecessorGraphNode(errs(), sNode.getNodeIndex());
 			errs()<< "  -->  ";
-			const SparseBitVectorGraphNode& sNode = mapping.second;
 			for (auto const& idx: sNode)
 			{
 				printPredecessorGraphNode(errs(), idx);
@@ -159,16 +175,16 @@ protected:
 		raw_fd_ostream& os = outFile.os();
 		os << "digraph G {\n";
 		std::deque<bool> hasLabel(nodeFactory.getNumNodes() * 3, false);
-		for (auto const& mapping: predGraph)
+		for (auto const& sNode: predGraph)
 		{
-			if (!hasLabel[mapping.first])
+			NodeIndex nodeIdx = sNode.getNodeIndex();
+			if (!hasLabel[nodeIdx])
 			{
-				os << "\tnode" << mapping.first << " [label = \"";
-				printPredecessorGraphNode(os, mapping.first);
+				os << "\tnode" << nodeIdx << " [label = \"";
+				printPredecessorGraphNode(os, nodeIdx);
 				os << "\"]\n";
-				hasLabel[mapping.first] = true;
+				hasLabel[nodeIdx] = true;
 			}
-			const SparseBitVectorGraphNode& sNode = mapping.second;
 			for (auto const& idx: sNode)
 			{
 				if (!hasLabel[idx])
@@ -178,7 +194,7 @@ protected:
 					os << "\"]\n";
 					hasLabel[idx] = true;
 				}
-				os << "\tnode" << idx << " -> " << "node" << mapping.first << '\n';
+				os << "\tnode" << idx << " -> " << "node" << nodeIdx << '\n';
 			}
 		}
 		os << "}\n";
@@ -200,12 +216,12 @@ protected:
 		return idx;
 	}
 
-	NodeType* getRep(NodeIndex idx) override
+	NodeType* getRep(NodeIndex idx)
 	{
 		return predGraph.getOrInsertNode(getMergeTargetRep(idx));
 	}
 	// Specify how to process the non-rep nodes if a cycle is found
-	void processNodeOnCycle(const NodeType* node, const NodeType* repNode) override
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
 	{
 		NodeIndex nodeIdx = node->getNodeIndex();
 		NodeIndex repIdx = repNode->getNodeIndex();
@@ -213,13 +229,105 @@ protected:
 		if (repIdx < nodeFactory.getNumNodes() && (indirectNodes.count(nodeIdx) || nodeIdx > nodeFactory.getNumNodes()))
 			indirectNodes.insert(repIdx);
 
+		mergeNodeState(repIdx, nodeIdx);
 		predGraph.mergeEdge(repIdx, nodeIdx);
 	}
 
 	// Specify how to process the rep nodes if a cycle is found
-	void processCycleRepNode(const NodeType* node) override
+	void processCycleRepNode(const NodeType* node)
 	{
-		propagateLabel(node->getNodeIndex());
+		if (numThreads > 1)
+			repOrder.push_back(node->getNodeIndex());
+		else
+		{
+			propagateLabel(node->getNodeIndex());
+			finishLabel(node->getNodeIndex());
+		}
+	}
+
+	unsigned getNewLabel()
+	{
+		return pointerEqClass++;
+	}
+
+	// Return the label of set, which is a new one if set has not been seen before
+	unsigned getSetLabel(const PooledSparseBitVector& set, SetFingerprint fingerprint)
+	{
+		if (concurrentSetLabel)
+			return concurrentSetLabel->getOrInsert(set, fingerprint, pointerEqClass);
+		unsigned newLabel = pointerEqClass;
+		unsigned label = setLabel.getOrInsert(set, fingerprint, newLabel);
+		if (label == newLabel)
+			pointerEqClass = newLabel + 1;
+		return label;
+	}
+
+	// Create the entries propagateLabel() writes for node before the labels are propagated in parallel. From then on the threads only look up the maps, which is safe as long as nobody inserts into them
+	virtual void prepareNode(NodeIndex node)
+	{
+		peLabel.insert(std::make_pair(node, 0u));
+	}
+
+	// Label the SCC representatives collected by the DFS on numThreads threads. The label of a node only depends on the labels of its predecessors, so the representatives are sorted into levels, each node one level above its highest predecessor, and the nodes of a level are labelled concurrently
+	void propagateLabelsInParallel()
+	{
+		for (auto node: repOrder)
+			prepareNode(node);
+
+		// The DFS finishes every node after its predecessors
+		std::vector<unsigned> nodeLevel(3 * nodeFactory.getNumNodes(), 0);
+		std::vector<std::vector<NodeIndex>> levels;
+		for (auto node: repOrder)
+		{
+			unsigned level = 0;
+			if (const SparseBitVectorGraphNode* sNode = predGraph.getNodeWithIndex(node))
+			{
+				for (auto const& pred: *sNode)
+				{
+					NodeIndex predRep = getMergeTargetRep(pred);
+					if (predRep != node)
+						level = std::max(level, nodeLevel[predRep] + 1);
+				}
+			}
+			nodeLevel[node] = level;
+			if (level >= levels.size())
+				levels.resize(level + 1);
+			levels[level].push_back(node);
+		}
+		std::vector<NodeIndex>().swap(repOrder);
+		std::vector<unsigned>().swap(nodeLevel);
+
+		concurrentSetLabel.reset(new ConcurrentLabelSetTable(16 * numThreads));
+		setArena.setConcurrent(true);
+		for (auto const& nodes: levels)
+		{
+			// A long chain of predecessors makes many small levels
+			if (nodes.size() < MinParallelLevelSize)
+			{
+				for (auto node: nodes)
+				{
+					propagateLabel(node);
+					finishLabel(node);
+				}
+				continue;
+			}
+
+			std::atomic<size_t> nextChunk(0);
+			runOnThreads(numThreads, [this, &nodes, &nextChunk] (unsigned)
+			{
+				size_t begin;
+				while ((begin = nextChunk.fetch_add(LevelChunkSize)) < nodes.size())
+				{
+					for (size_t i = begin, e = std::min<size_t>(begin + LevelChunkSize, nodes.size()); i < e; ++i)
+						propagateLabel(nodes[i]);
+				}
+			});
+			// The nodes of the level may share predecessors, so what they have read is let go of once they are all done
+			for (auto node: nodes)
+				finishLabel(node);
+		}
+		concurrentSetLabel.reset();
+		setArena.setConcurrent(false);
 	}
 
 	void rewriteConstraint()
@@ -229,7 +337,7 @@ protected:
 		// - For VAR+REF, certainly we want to replace the REF node with the VAR node. This will definitely cut down the analysis time because we have one less indirect node to worry about
 		// - For VAR+ADR, we want to replace the VAR node with the ADR node because the latter is more straightforward
 
-		std::vector<NodeIndex> revLabelMap(pointerEqClass, AndersNodeFactory::InvalidIndex);
+		std::vector<NodeIndex> revLabelMap(pointerEqClass.load(), AndersNodeFactory::InvalidIndex);
 		// Scan all the VAR nodes to see if any of them have the same label as other VAR nodes. We have to perform the merge before constraint rewriting
 
 		for (auto const& mapping: peLabel)
@@ -268,12 +376,12 @@ protected:
 		std::vector<AndersConstraint> newConstraints;
 		for (auto const& c: constraints)
 		{
-			// First, if the lhs has label 0 (non-ptr), ignore this constraint
-			if (peLabel[c.getDest()] == 0)
-				continue;
-
 			// Change the lhs to its mergeTarget
 			NodeIndex destTgt = nodeFactory.getMergeTarget(c.getDest());
+			// First, if the lhs has label 0 (non-ptr), ignore this constraint. Look at the merge target: the lhs may have been merged by an earlier pass, in which case it is not in the predecessor graph itself
+			if (peLabel[destTgt] == 0)
+				continue;
+
 			// Change the rhs to its merge target
 			NodeIndex srcTgt = nodeFactory.getMergeTarget(c.getSrc());
 			switch (c.getType())
@@ -355,8 +463,8 @@ protected:
 		}
 
 		// There may be repetitive constraints. Uniquify them
-		std::set<AndersConstraint> constraintSet(newConstraints.begin(), newConstraints.end());
-		constraints.assign(constraintSet.begin(), constraintSet.end());
+		uniquifyConstraints(newConstraints);
+		constraints.swap(newConstraints);
 	}
 
 	virtual void releaseMemory()
@@ -364,22 +472,40 @@ protected:
 		indirectNodes.clear();
 		peLabel.clear();
 		mergeTarget.clear();
+		setLabel.clear();
+		setArena.reset();
 		predGraph.releaseMemory();
 		releaseSCCMemory();
 	}
 
+	// Must be safe to call concurrently for nodes that are not predecessors of each other, once prepareNode() has been called for every node
 	virtual void propagateLabel(NodeIndex node) = 0;
+	// Called when node is found to be on the cycle of rep, before its predecessor edges are merged into those of rep
+	virtual void mergeNodeState(NodeIndex rep, NodeIndex node) {}
+	// Called once node has been labelled, from a single thread. Its predecessors will never be read on its behalf again
+	virtual void finishLabel(NodeIndex node) {}
 public:
-	ConstraintOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n): constraints(c), nodeFactory(n), pointerEqClass(1)
+	// lateTargets are the nodes that the solver may add copy edges into later. We know nothing about what they will point to, so they are indirect nodes
+	ConstraintOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n, const std::vector<NodeIndex>& lateTargets): constraints(c), nodeFactory(n), predGraph(3 * n.getNumNodes()), pointerEqClass(1), numThreads(getNumWorkerThreads(NumOptimizerThreads))
 	{
+		// They need a node in the predecessor graph even if no constraint defines them, otherwise they would never be labelled and would be taken for non-pointers
+		for (auto node: lateTargets)
+		{
+			NodeIndex nodeTgt = nodeFactory.getMergeTarget(node);
+			indirectNodes.insert(nodeTgt);
+			predGraph.getOrInsertNode(nodeTgt);
+		}
+
 		// Build a predecessor graph.  This is like our constraint graph with the edges going in the opposite direction, and there are edges for all the constraints, instead of just copy constraints.  We also build implicit edges for constraints are implied but not explicit.  I.E for the constraint a = &b, we add implicit edges *a = b.  This helps us capture more cycles
 		buildPredecessorGraph();
 	}
 
-	void run() override
+	void run()
 	{
 		// Now run Tarjan's SCC algorithm to find cycles, condense predGraph, and explore possible equivalance relations
 		runOnGraph(&predGraph);
+		if (numThreads > 1)
+			propagateLabelsInParallel();
 
 		// For all nodes on the same cycle: assign their representative's pe label to them
 		for (auto const& mapping: mergeTarget)
@@ -401,22 +527,20 @@ public:
 class HVNOptimizer: public ConstraintOptimizer
 {
 private:
-	// Map from a set of NodeIndex to Pointer Equivalence Class
-	std::unordered_map<SparseBitVector<>, unsigned, SparseBitVectorHash, SparseBitVectorKeyEqual> setLabel;
-
 	void propagateLabel(NodeIndex node) override
 	{
 		// Indirect node always gets a unique label
 		if (node >= nodeFactory.getNumNodes() || indirectNodes.count(node))
 		{
-			peLabel[node] = pointerEqClass++;
+			peLabel[node] = getNewLabel();
 			return;
 		}
 
 		// Scan through the predecessor edges and examine what labels they have
 		bool allSame = true;
 		unsigned lastSeenLabel = 0;
-		SparseBitVector<> predLabels;
+		PooledSparseBitVector predLabels(setArena);
+		SetFingerprint predFingerprint;
 		const SparseBitVectorGraphNode* sNode = predGraph.getNodeWithIndex(node);
 		if (sNode != nullptr)
 		{
@@ -433,7 +557,8 @@ private:
 				else if (allSame && predRepLabel != lastSeenLabel)
 					allSame = false;
 
-				predLabels.set(predRepLabel);
+				if (predLabels.test_and_set(predRepLabel))
+					predFingerprint.add(predRepLabel);
 			}
 		}
 
@@ -443,39 +568,48 @@ private:
 		else if (allSame)
 			peLabel[node] = lastSeenLabel;
 		else
-		{
-			auto labelItr = setLabel.find(predLabels);
-			if (labelItr != setLabel.end())
-			{
-				peLabel[node] = labelItr->second;
-			}
-			else
-			{
-				setLabel.insert(std::make_pair(std::move(predLabels), pointerEqClass));
-				peLabel[node] = pointerEqClass;
-				++pointerEqClass;
-			}
-		}
+			peLabel[node] = getSetLabel(predLabels, predFingerprint);
 	}
 
 public:
-	HVNOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n): ConstraintOptimizer(c, n) {}
-
-	void releaseMemory() override
-	{
-		ConstraintOptimizer::releaseMemory();
-		setLabel.clear();
-	}
+	HVNOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n, const std::vector<NodeIndex>& l): ConstraintOptimizer(c, n, l) {}
 };
 
 // The technique used here is described in "Exploiting Pointer and Location Equivalence to Optimize Pointer Analysis. In the 14th International Static Analysis Symposium (SAS), August 2007."  It is known as the "HU" algorithm, and is equivalent to value numbering the collapsed constraint graph including evaluating unions.
 class HUOptimizer: public ConstraintOptimizer
 {
 private:
-	// Map from a set of NodeIndex to Pointer Equivalence Class
-	std::unordered_map<SparseBitVector<>, unsigned, SparseBitVectorHash, SparseBitVectorKeyEqual> setLabel;
+	// An offline pts-set together with its fingerprint, so that a set that is copied around keeps its fingerprint instead of having it recomputed
+	struct OfflinePtsSet
+	{
+		PooledSparseBitVector elems;
+		SetFingerprint fingerprint;
+
+		explicit OfflinePtsSet(SparseBitVectorArena& arena): elems(arena) {}
+
+		void set(unsigned idx)
+		{
+			if (elems.test_and_set(idx))
+				fingerprint.add(idx);
+		}
+	};
+
 	// Map from NodeIndex to its offline pts-set
-	DenseMap<unsigned, SparseBitVector<>> ptsSet;
+	DenseMap<unsigned, OfflinePtsSet> ptsSet;
+	// For each node of the predecessor graph, the number of edges from it to the nodes that have not been labelled yet, i.e. the number of labellings left that read its set. Once they are done, the set is freed: whatever of it the labels need lives on in setLabel, so only the sets on the frontier of the labelling are kept at a time, instead of all of them until releaseMemory()
+	std::vector<unsigned> numConsumers;
+
+	OfflinePtsSet& getPtsSet(NodeIndex node)
+	{
+		return ptsSet.insert(std::make_pair(node, OfflinePtsSet(setArena))).first->second;
+	}
+
+	void releaseConsumer(NodeIndex node)
+	{
+		assert(numConsumers[node] != 0 && "More consumers released than counted!");
+		if (--numConsumers[node] == 0 && ptsSet.erase(node))
+			++NumHUSetsReleased;
+	}
 
 	// Try to assign a single label to node. Return true if the assignment succeeds
 	bool assignLabel(NodeIndex node)
@@ -483,24 +617,24 @@ private:
 		// ADR nodes get a unique label and a pts-set that contains the corresponding VAR node
 		if (node >= nodeFactory.getNumNodes() * 2)
 		{
-			peLabel[node] = pointerEqClass++;
-			ptsSet[node].set(node - nodeFactory.getNumNodes() * 2);
+			peLabel[node] = getNewLabel();
+			getPtsSet(node).set(node - nodeFactory.getNumNodes() * 2);
 			return true;
 		}
 
 		// REF nodes get a unique label and a pts-set that contains itself (which can never collide with VAR nodes)
 		if (node >= nodeFactory.getNumNodes())
 		{
-			peLabel[node] = pointerEqClass++;
-			ptsSet[node].set(node);
+			peLabel[node] = getNewLabel();
+			getPtsSet(node).set(node);
 			return true;
 		}
 
 		// Indirect VAR nodes get a unique label and a pts-set that contains its corresponding ADR node (which can never collide with VAR and REF nodes)
 		if (indirectNodes.count(node))
 		{
-			peLabel[node] = pointerEqClass++;
-			ptsSet[node].set(getAdrNodeIndex(node));
+			peLabel[node] = getNewLabel();
+			getPtsSet(node).set(getAdrNodeIndex(node));
 			return true;
 		}
 
@@ -513,7 +647,10 @@ private:
 			return;
 
 		// Direct VAR nodes need more careful examination
-		SparseBitVector<>& myPtsSet = ptsSet[node];
+		OfflinePtsSet& myPtsSet = getPtsSet(node);
+		// The only non-empty set that has been unioned in so far. A node that merely copies another one inherits its fingerprint
+		const OfflinePtsSet* onlySource = nullptr;
+		bool multipleSources = false;
 		SparseBitVectorGraphNode* sNode = predGraph.getNodeWithIndex(node);
 		if (sNode != nullptr)
 		{
@@ -522,10 +659,23 @@ private:
 				// Be careful! Any insertion to ptsSet here will invalidate myPtsSet
 				NodeIndex predRep = getMergeTargetRep(pred);
 				auto itr = ptsSet.find(predRep);
-				if (itr != ptsSet.end())
-					myPtsSet |= (itr->second);
+				if (itr == ptsSet.end() || itr->second.elems.empty())
+					continue;
+
+				if (myPtsSet.elems |= itr->second.elems)
+				{
+					if (onlySource == nullptr && !multipleSources)
+						onlySource = &itr->second;
+					else
+						multipleSources = true;
+				}
 			}
 		}
+
+		if (multipleSources)
+			myPtsSet.fingerprint = SetFingerprint::of(myPtsSet.elems);
+		else if (onlySource != nullptr)
+			myPtsSet.fingerprint = onlySource->fingerprint;
 		
 		//errs() << "ptsSet [" << node << "] = ";
 		//for (auto v: myPtsSet)
@@ -533,32 +683,141 @@ private:
 		//errs() << "\n";
 
 		// If the ptsSet is empty, assign a label of zero
-		if (myPtsSet.empty())
+		if (myPtsSet.elems.empty())
 			peLabel[node] = 0;
 		// Otherwise, see if we have seen this pattern before
 		else
+			peLabel[node] = getSetLabel(myPtsSet.elems, myPtsSet.fingerprint);
+	}
+
+	void prepareNode(NodeIndex node) override
+	{
+		ConstraintOptimizer::prepareNode(node);
+		getPtsSet(node);
+	}
+
+	// The consumers of node become those of rep. The merged edges keep a predecessor that both of them have once, which is one consumer less
+	void mergeNodeState(NodeIndex rep, NodeIndex node) override
+	{
+		const SparseBitVectorGraphNode* sNode = predGraph.getNodeWithIndex(node);
+		const SparseBitVectorGraphNode* repNode = predGraph.getNodeWithIndex(rep);
+		if (sNode != nullptr && repNode != nullptr)
 		{
-			auto labelItr = setLabel.find(myPtsSet);
-			if (labelItr != setLabel.end())
-			{
-				peLabel[node] = labelItr->second;
-			}
-			else
+			for (auto const& pred: *sNode)
 			{
-				setLabel.insert(std::make_pair(myPtsSet, pointerEqClass));
-				peLabel[node] = pointerEqClass;
-				++pointerEqClass;
+				if (repNode->hasEdge(pred))
+					--numConsumers[getMergeTargetRep(pred)];
 			}
 		}
+		numConsumers[rep] += numConsumers[node];
+		numConsumers[node] = 0;
+	}
+
+	void finishLabel(NodeIndex node) override
+	{
+		if (const SparseBitVectorGraphNode* sNode = predGraph.getNodeWithIndex(node))
+		{
+			for (auto const& pred: *sNode)
+				releaseConsumer(getMergeTargetRep(pred));
+		}
+		// Nothing reads the set of a node that is nobody's predecessor
+		if (numConsumers[node] == 0 && ptsSet.erase(node))
+			++NumHUSetsReleased;
 	}
 public:
-	HUOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n): ConstraintOptimizer(c, n) {}
+	HUOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n, const std::vector<NodeIndex>& l): ConstraintOptimizer(c, n, l), numConsumers(3 * n.getNumNodes(), 0)
+	{
+		for (auto const& sNode: predGraph)
+			for (auto const& pred: sNode)
+				++numConsumers[pred];
+	}
 
 	void releaseMemory() override
 	{
-		ConstraintOptimizer::releaseMemory();
+		// The sets go back to the arena before the base class resets it
 		ptsSet.clear();
-		setLabel.clear();
+		std::vector<unsigned>().swap(numConsumers);
+		ConstraintOptimizer::releaseMemory();
+	}
+};
+
+// The technique used here is described in "Exploiting Pointer and Location Equivalence to Optimize Pointer Analysis. In the 14th International Static Analysis Symposium (SAS), August 2007." It is known as the "LE" (location equivalence) algorithm. Two objects are location equivalent if they always appear together in points-to sets
+// An object only gets into a points-to set through the ADDR_OF constraints that take its address, so two objects are location equivalent if the same (pointer equivalence classes of) nodes take their addresses. Only one representative of each class is kept in the points-to sets, and the other members are put back when the analysis answers a query
+// The contents of the members are merged as well. A global object also gets the ADDR_OF constraints of its initializer, which put the objects it points to straight into its content, so the objects of a class must have been initialized to point to the same objects too. Otherwise the content of one of them would gain what the other is initialized to
+class LEOptimizer
+{
+private:
+	std::vector<AndersConstraint>& constraints;
+	AndersNodeFactory& nodeFactory;
+	// Map from the representative of a class to the other members of the class
+	DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses;
+
+	// The elements of the sets of address takers, and of their copies in setRep
+	SparseBitVectorArena setArena;
+	// Map from a set of address takers to the representative object
+	LabelSetTable setRep;
+public:
+	LEOptimizer(std::vector<AndersConstraint>& c, AndersNodeFactory& n, DenseMap<NodeIndex, std::vector<NodeIndex>>& l): constraints(c), nodeFactory(n), locationClasses(l) {}
+
+	void run()
+	{
+		// Nodes that have been merged with other nodes by HVN/HU. The content of such an object is pointer equivalent to some other node, and merging it with yet another object would make that node less precise
+		unsigned numNodes = nodeFactory.getNumNodes();
+		BitVector inMerge(numNodes);
+		for (NodeIndex i = 0; i < numNodes; ++i)
+		{
+			NodeIndex rep = nodeFactory.getMergeTarget(i);
+			if (rep != i)
+			{
+				inMerge.set(i);
+				inMerge.set(rep);
+			}
+		}
+
+		// Map from an object to the nodes that take its address, and to the objects its initializer points to, offset by numNodes. Walk the objects in increasing order so that the smallest object of a class becomes its representative
+		std::map<NodeIndex, std::pair<PooledSparseBitVector, SetFingerprint>> addrTakers;
+		auto addToKey = [this, &addrTakers] (NodeIndex obj, NodeIndex elem)
+		{
+			auto& key = addrTakers.insert(std::make_pair(obj, std::make_pair(PooledSparseBitVector(setArena), SetFingerprint()))).first->second;
+			if (key.first.test_and_set(elem))
+				key.second.add(elem);
+		};
+		for (auto const& c: constraints)
+		{
+			if (c.getType() == AndersConstraint::ADDR_OF)
+			{
+				addToKey(c.getSrc(), nodeFactory.getMergeTarget(c.getDest()));
+				if (nodeFactory.isObjectNode(c.getDest()))
+					addToKey(c.getDest(), numNodes + nodeFactory.getMergeTarget(c.getSrc()));
+			}
+		}
+
+		BitVector isMember(numNodes);
+		for (auto& mapping: addrTakers)
+		{
+			NodeIndex obj = mapping.first;
+			// The special objects are checked for by identity all over the place
+			if (obj == nodeFactory.getUniversalObjNode() || obj == nodeFactory.getNullObjectNode() || inMerge.test(obj))
+				continue;
+
+			NodeIndex rep = setRep.getOrInsert(mapping.second.first, mapping.second.second, obj);
+			if (rep == obj)
+				continue;
+
+			// Any pointer that reaches one of the objects reaches the other, so loads and stores always see both of them, and they start out with the same content. Their contents can be merged too
+			nodeFactory.mergeNode(rep, obj);
+			locationClasses[rep].push_back(obj);
+			isMember.set(obj);
+		}
+
+		// The members are no longer put into any points-to set
+		if (isMember.any())
+		{
+			constraints.erase(std::remove_if(constraints.begin(), constraints.end(), [&isMember] (const AndersConstraint& c)
+			{
+				return c.getType() == AndersConstraint::ADDR_OF && isMember.test(c.getSrc());
+			}), constraints.end());
+		}
 	}
 };
 
@@ -570,26 +829,63 @@ void Andersen::optimizeConstraints()
 	//errs() << "\n#constraints = " << constraints.size() << "\n";
 	//dumpConstraints();
 
-	// First, let's do HVN
-	// There is an additional assumption here that before HVN, we have not merged any two nodes. Might fix that in the future
-	if (EnableHVN)
+	NumNodes = nodeFactory.getNumNodes();
+	NumConstraintsCollected = constraints.size();
+	auto countMergedNodes = [this] ()
 	{
-		HVNOptimizer hvn(constraints, nodeFactory);
-		hvn.run();
+		unsigned numMerged = 0;
+		for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+		{
+			if (nodeFactory.getMergeTarget(n) != n)
+				++numMerged;
+		}
+		return numMerged;
+	};
+	unsigned numMergedBefore = countMergedNodes();
+
+	// Drop the dead pointers first, so that the optimizations below have less to look at
+	if (pruneForQueries && startPhase(AndersPhase::DeadPointerElim))
+	{
+		AndersPhaseTimer timer(AndersPhase::DeadPointerElim);
+		pruneDeadPointers();
 	}
 
-	//nodeFactory.dumpRepInfo();
-	//dumpConstraints();
+	// The field constraints are not seen by HVN and HU either, so their targets are treated like those of the late copies
+	std::vector<NodeIndex> indirectTargets(lateCopyTargets);
+	for (auto const& c: fieldConstraints)
+		indirectTargets.push_back(c.dest);
 
-	//errs() << "#constraints = " << constraints.size() << "\n";
+	// The optimizations only depend on what they start from here and on the options that pick them, which makes their results safe to reuse
+	std::uint32_t cacheOptions = (EnableHVN ? 1 : 0) | (EnableHU ? 2 : 0) | (EnableHRU ? 4 : 0) | (EnableLE ? 8 : 0);
+	bool useCache = !OptimizeCacheDir.empty() && cacheOptions != 0;
+	std::uint64_t cacheKey = 0;
+	if (useCache)
+	{
+		cacheKey = OptimizeCacheEntry::computeKey(nodeFactory, constraints, indirectTargets, cacheOptions);
+		std::string error;
+		if (auto entry = OptimizeCacheEntry::load(OptimizeCacheDir, cacheKey, nodeFactory.getNumNodes(), error))
+		{
+			entry->restore(nodeFactory, constraints, locationClasses);
+			++NumOptimizeCacheHits;
+			NumConstraintsAfterLE = constraints.size();
+			NumOfflineMerges = countMergedNodes() - numMergedBefore;
+			return;
+		}
+		if (!error.empty())
+			errs() << "Cannot use the entry of -anders-optimize-cache: " << error << ". Optimizing the constraints again\n";
+	}
+
+	runOfflineOptimizers(indirectTargets);
 
-	// Next, do HU
-	// There is an additional assumption here that before HU, the predecessor graph will have no cycle. Might fix that in the future
-	if (EnableHU)
+	// A cancelled run may have skipped some of the optimizations, so what it leaves is not their result
+	if (useCache && !isCancelRequested())
 	{
-		HUOptimizer hu(constraints, nodeFactory);
-		hu.run();
+		std::string error;
+		if (!OptimizeCacheEntry::write(OptimizeCacheDir, cacheKey, nodeFactory, constraints, locationClasses, error))
+			errs() << "Cannot write the entry of -anders-optimize-cache: " << error << "\n";
 	}
+	NumConstraintsAfterLE = constraints.size();
+	NumOfflineMerges = countMergedNodes() - numMergedBefore;
 
 	//nodeFactory.dumpRepInfo();
 	//dumpConstraints();
@@ -597,3 +893,69 @@ void Andersen::optimizeConstraints()
 	//errs() << "#constraints = " << constraints.size() << "\n";
 }
 
+// HVN, HU or HRU, then LE, as the options ask for them. The constraints of indirectTargets are not seen by them
+void Andersen::runOfflineOptimizers(const std::vector<NodeIndex>& indirectTargets)
+{
+	if (EnableHRU)
+	{
+		// HRU: run HVN and HU in turns until they stop removing constraints. Each round starts from the merges of the previous one, so the REF nodes of nodes found equivalent are equivalent, too (the "ref-node reduction" of HR), which lets HVN find more equivalences in the next round
+		// The number of constraints shrinks in every round but the last one, so this terminates
+		unsigned numConstraints;
+		do
+		{
+			numConstraints = constraints.size();
+
+			if (!startPhase(AndersPhase::HVN))
+				break;
+			{
+				AndersPhaseTimer timer(AndersPhase::HVN);
+				HVNOptimizer hvn(constraints, nodeFactory, indirectTargets);
+				hvn.run();
+			}
+			NumConstraintsAfterHVN = constraints.size();
+
+			if (!startPhase(AndersPhase::HU))
+				break;
+			{
+				AndersPhaseTimer timer(AndersPhase::HU);
+				HUOptimizer hu(constraints, nodeFactory, indirectTargets);
+				hu.run();
+			}
+			NumConstraintsAfterHU = constraints.size();
+		} while (constraints.size() < numConstraints);
+	}
+	else
+	{
+		// First, let's do HVN
+		// Both HVN and HU work on the merge targets of the nodes, and the cycle detector collapses any cycles in the predecessor graph, so they may run after any earlier merges and in any order
+		if (EnableHVN && startPhase(AndersPhase::HVN))
+		{
+			AndersPhaseTimer timer(AndersPhase::HVN);
+			HVNOptimizer hvn(constraints, nodeFactory, indirectTargets);
+			hvn.run();
+		}
+		NumConstraintsAfterHVN = constraints.size();
+
+		//nodeFactory.dumpRepInfo();
+		//dumpConstraints();
+
+		//errs() << "#constraints = " << constraints.size() << "\n";
+
+		// Next, do HU
+		if (EnableHU && startPhase(AndersPhase::HU))
+		{
+			AndersPhaseTimer timer(AndersPhase::HU);
+			HUOptimizer hu(constraints, nodeFactory, indirectTargets);
+			hu.run();
+		}
+		NumConstraintsAfterHU = constraints.size();
+	}
+
+	// Finally, do LE. It has to come after HVN and HU: objects whose addresses are taken by pointer equivalent nodes are location equivalent, too
+	if (EnableLE && startPhase(AndersPhase::LE))
+	{
+		AndersPhaseTimer timer(AndersPhase::LE);
+		LEOptimizer le(constraints, nodeFactory, locationClasses);
+		le.run();
+	}
+}
@@ -1,300 +1,258 @@
 #include "Andersen.h"
+#include "ConstraintGraph.h"
 #include "CycleDetector.h"
-#include "SparseBitVectorGraph.h"
-
+#include "DenseSparseBitVectorGraph.h"
+#include "Parallel.h"
+#include "ParallelSCC.h"
+#include "PhaseTimer.h"
+#include "PtsSetSpill.h"
+#include "SolverCheckpoint.h"
+#include "SolverTrace.h"
+#include "Steensgaard.h"
+#include "TypeFilter.h"
+#include "WorkList.h"
+
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/DenseSet.h"
-#include "llvm/ADT/SmallSet.h"
+#include "llvm/ADT/SparseBitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/iterator_range.h"
 #include "llvm/Support/CommandLine.h"
 
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iterator>
 #include <map>
+#include <memory>
+#include <numeric>
+#include <queue>
+#include <tuple>
 
 using namespace llvm;
 
 cl::opt<bool> EnableHCD("enable-hcd", cl::desc("Enable the hybrid cycle detection algorithm"));
 cl::opt<bool> EnableLCD("enable-lcd", cl::desc("Enable the lazy cycle detection algorithm"));
+cl::opt<bool> EnableWave("enable-wave", cl::desc("Use the wave propagation solver instead of the worklist solver"));
+cl::opt<bool> EnableDiffProp("enable-diff-prop", cl::desc("Enable difference propagation in the online solver"));
+cl::opt<std::string> WorkListPolicy("anders-worklist", cl::desc("The order in which the online solver visits nodes (fifo, lrf, topo or divided)"), cl::init("fifo"));
+cl::opt<unsigned> NumSolverThreads("anders-threads", cl::desc("The number of threads used by the constraint solver (1 for the sequential solver, 0 for one thread per hardware thread)"), cl::init(1));
+cl::opt<std::string> SolverTraceFile("anders-trace", cl::desc("Write one JSON record per iteration of the solver into a file"), cl::value_desc("filename"));
+cl::opt<double> SolverTimeBudget("anders-time-budget", cl::desc("Stop the online solving after this many seconds and fall back to sound but less precise results (0 for no limit)"), cl::value_desc("seconds"), cl::init(0));
+cl::opt<unsigned> SolverMemoryBudget("anders-memory-budget", cl::desc("Stop the online solving once the peak RSS of the process exceeds this many MB and fall back to sound but less precise results (0 for no limit)"), cl::value_desc("MB"), cl::init(0));
+cl::opt<unsigned> SCCSweepInterval("anders-scc-sweep", cl::desc("Collapse every cycle of copy edges each time this many copy edges have been added while solving (0 to disable)"), cl::value_desc("edges"), cl::init(0));
+cl::opt<bool> EnableOnlineEquiv("enable-online-equiv", cl::desc("Merge the nodes whose points-to sets, incoming edges and outgoing edges become identical during solving"));
+cl::opt<bool> EnablePartition("enable-partition", cl::desc("Solve the independent components of the constraint graph apart from each other, on -anders-threads threads"));
+cl::opt<unsigned> DenseKernelSize("anders-dense-kernel-size", cl::desc("Solve the components of -enable-partition that have at most this many nodes and don't touch the special nodes with bit matrices instead of the worklist solver (0 to disable)"), cl::value_desc("nodes"), cl::init(256));
+cl::opt<bool> EnableSteensgaardFallback("enable-steensgaard-fallback", cl::desc("Run a unification-based (Steensgaard) pre-analysis, and give its points-to sets rather than the universal object to the nodes left unfinished when the solver runs out of its budget"));
+cl::opt<bool> EnableTypeFilter("anders-type-filter", cl::desc("Drop from the points-to set of a typed pointer the objects its pointee type can't be in, as if the program respected strict aliasing. Only done by the sequential worklist solver"));
+cl::opt<std::string> SolverCheckpointFile("anders-checkpoint", cl::desc("Save the state of the worklist solver into a file every -anders-checkpoint-interval seconds, for -anders-resume to solve on from if the run is killed"), cl::value_desc("filename"));
+cl::opt<double> SolverCheckpointInterval("anders-checkpoint-interval", cl::desc("The number of seconds between two checkpoints of -anders-checkpoint"), cl::value_desc("seconds"), cl::init(600));
+cl::opt<std::string> SolverResumeFile("anders-resume", cl::desc("Pick up the solving from a checkpoint written by -anders-checkpoint for the same module and options, instead of from the start"), cl::value_desc("filename"));
+cl::opt<bool> EnablePreSolve("anders-presolve", cl::desc("Before the online solving, collapse the cycles of the initial copy edges and push the address-of sets through them in one sweep in topological order, so that the work list starts from what the loads and stores add"));
+cl::opt<bool> EnableUniversalTop("enable-universal-top", cl::desc("Stop growing a points-to set once it has the universal object, and keep only the universal object in it"));
+cl::opt<unsigned> PtsSetLimit("anders-pts-limit", cl::desc("Replace a points-to set that grows past this many elements by the universal object, and handle it from then on as -enable-universal-top does (0 for no limit)"), cl::value_desc("elements"), cl::init(0));
+cl::opt<unsigned> WorkListBatchSize("anders-worklist-batch", cl::desc("Take this many nodes off the work list at a time, and look up and prefetch the constraint graph nodes and points-to sets of the whole batch before visiting its first node (1 to take one node at a time)"), cl::init(1));
+cl::opt<bool> EnableAdaptiveCycles("anders-adaptive-cycles", cl::desc("Turn HCD and LCD off for a while whenever an iteration of them collapses fewer than -anders-adaptive-cycles-yield nodes per node they look at, for longer each time they keep not paying off, and try them again after that"));
+cl::opt<double> AdaptiveCyclesYield("anders-adaptive-cycles-yield", cl::desc("The nodes HCD and LCD must collapse per node they look at for -anders-adaptive-cycles to keep them on"), cl::init(0.01));
+cl::opt<bool> EnablePullPropagation("anders-pull-propagation", cl::desc("Have each thread of the parallel solver pull the new part of the points-to sets of the predecessors of the nodes it owns along reverse copy edges, instead of collecting whole sets for them and committing those. Runs the parallel solver even on a single thread"));
+cl::opt<std::string> OutOfCoreDir("anders-out-of-core", cl::desc("Let the worklist solver move the points-to sets of the nodes off its work list into a file in this directory whenever the sets take more than -anders-out-of-core-limit MB"), cl::value_desc("directory"));
+cl::opt<bool> EnableCopyReduction("anders-reduce-copies", cl::desc("Before solving, drop the copy edges a->c that are implied by two copy edges a->b and b->c, so that the solver doesn't union the same sets twice"));
+cl::opt<unsigned> CopyReductionMaxPreds("anders-reduce-copies-max-preds", cl::desc("The most copy predecessors a node may have for -anders-reduce-copies to look for implied edges into it"), cl::init(64));
+cl::opt<unsigned> HubCopyDegree("anders-hub-degree", cl::desc("Let the worklist solver treat a node with at least this many copy successors as a hub, whose copies into the successors that have no edges of their own are made once per fixed point instead of on every visit (0 to disable)"), cl::value_desc("edges"), cl::init(0));
+cl::opt<bool> EnableMatrixSolver("anders-matrix-solver", cl::desc("Solve the constraints as products of sparse boolean matrices instead of with the worklist solver. The products run on -anders-threads threads"));
+cl::opt<unsigned> OutOfCoreLimit("anders-out-of-core-limit", cl::desc("The memory the points-to sets of -anders-out-of-core may take before some are moved out"), cl::value_desc("MB"), cl::init(1024));
+
+extern cl::opt<unsigned> NumOptimizerThreads;
+extern cl::opt<unsigned> HotNodeCount;
+extern cl::opt<unsigned> FunctionCostCount;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumCopyEdgesAdded, "Number of copy edges added while solving");
+STATISTIC(NumCollapses, "Number of nodes collapsed while solving");
+STATISTIC(NumWorkListPops, "Number of nodes taken off the work lists");
+STATISTIC(NumOnlineEquivMerges, "Number of nodes merged by online pointer equivalence");
+STATISTIC(NumPartitionComponents, "Number of independent components solved apart from each other");
+STATISTIC(NumDenseComponents, "Number of components of -enable-partition solved with bit matrices");
+STATISTIC(NumSteensgaardClasses, "Number of equivalence classes found by the Steensgaard pre-analysis");
+STATISTIC(NumConstraintsStreamed, "Number of constraints streamed into the constraint graph during collection");
+STATISTIC(NumTypeFilterClasses, "Number of pointee type classes the points-to sets are filtered by");
+STATISTIC(NumTypeFilteredObjs, "Number of objects dropped from points-to sets by the type filter");
+STATISTIC(NumBudgetDegradedNodes, "Number of nodes given the universal object, or their Steensgaard set, when the solver ran out of its budget");
+STATISTIC(NumSolverCheckpoints, "Number of solver checkpoints written by -anders-checkpoint");
+STATISTIC(NumPreSolveCollapses, "Number of nodes collapsed by -anders-presolve");
+STATISTIC(NumThrottledIterations, "Number of solver iterations HCD or LCD was turned off for by -anders-adaptive-cycles");
+STATISTIC(NumLimitedSets, "Number of points-to sets replaced by the universal object for growing past -anders-pts-limit");
+STATISTIC(NumCopyEdgesReduced, "Number of copy edges dropped by -anders-reduce-copies for being implied by others");
+STATISTIC(NumHubFlushes, "Number of times the copies of a hub into its idle successors were made at a fixed point");
+STATISTIC(NumMatrixRounds, "Number of rounds of matrix products made by -anders-matrix-solver");
+STATISTIC(NumSpilledSets, "Number of points-to sets moved into the file of -anders-out-of-core");
 
 namespace {
 
-// This class represent the constraint graph
-class ConstraintGraphNode
+// With -enable-universal-top, a points-to set that has the universal object is "top": the pointer may point to anything, so the set keeps nothing but the universal object. A top set absorbs every union into it, and a union from it only makes the target top. Loads and stores through a top pointer only see the universal object, the way they do through a pointer that points to nothing but the universal object without the option
+void makeTop(AndersPtsSet& ptsSet)
 {
-private:
-	NodeIndex idx;
-
-	// We use set rather than SmallSet because we need the capability of iteration
-	typedef std::set<NodeIndex> NodeSet;
-	NodeSet copyEdges, loadEdges, storeEdges;
-
-	bool insertCopyEdge(NodeIndex dst)
-	{
-		return copyEdges.insert(dst).second;
-	}
-	bool removeCopyEdge(NodeIndex dst)
-	{
-		return copyEdges.erase(dst);
-	}
-	bool insertLoadEdge(NodeIndex dst)
-	{
-		return loadEdges.insert(dst).second;
-	}
-	bool removeLoadEdge(NodeIndex dst)
-	{
-		return loadEdges.erase(dst);
-	}
-	bool insertStoreEdge(NodeIndex dst)
-	{
-		return storeEdges.insert(dst).second;
-	}
-	bool removeStoreEdge(NodeIndex dst)
-	{
-		return storeEdges.erase(dst);
-	}
-	bool isEmpty() const
-	{
-		return copyEdges.empty() && loadEdges.empty() && storeEdges.empty();
-	}
-
-	void mergeEdges(const ConstraintGraphNode& other)
-	{
-		copyEdges.insert(other.copyEdges.begin(), other.copyEdges.end());
-		loadEdges.insert(other.loadEdges.begin(), other.loadEdges.end());
-		storeEdges.insert(other.storeEdges.begin(), other.storeEdges.end());
-	}
-
-	ConstraintGraphNode(NodeIndex i): idx(i) {}
-public:
-	typedef NodeSet::iterator iterator;
-	typedef NodeSet::const_iterator const_iterator;
-
-	NodeIndex getNodeIndex() const { return idx; }
-
-	bool replaceCopyEdge(NodeIndex oldIdx, NodeIndex newIdx)
-	{
-		return removeCopyEdge(oldIdx) && insertCopyEdge(newIdx);
-	}
-	bool replaceLoadEdge(NodeIndex oldIdx, NodeIndex newIdx)
-	{
-		return removeLoadEdge(oldIdx) && insertLoadEdge(newIdx);
-	}
-	bool replaceStoreEdge(NodeIndex oldIdx, NodeIndex newIdx)
-	{
-		return removeStoreEdge(oldIdx) && insertStoreEdge(newIdx);
-	}
-
-	iterator begin() { return copyEdges.begin(); }
-	iterator end() { return copyEdges.end(); }
-	const_iterator begin() const { return copyEdges.begin(); }
-	const_iterator end() const { return copyEdges.end(); }
-
-	const_iterator load_begin() const { return loadEdges.begin(); }
-	const_iterator load_end() const { return loadEdges.end(); }
-	llvm::iterator_range<const_iterator> loads() const
-	{
-		return llvm::iterator_range<const_iterator>(load_begin(), load_end());
-	}
-
-	const_iterator store_begin() const { return storeEdges.begin(); }
-	const_iterator store_end() const { return storeEdges.end(); }
-	llvm::iterator_range<const_iterator> stores() const
-	{
-		return llvm::iterator_range<const_iterator>(store_begin(), store_end());
-	}
-
-	friend class ConstraintGraph;
-};
+	ptsSet.clear();
+	ptsSet.insert(AndersNodeFactory::UniversalObjIndex);
+}
 
-class ConstraintGraph
+// With -anders-pts-limit=K, the sets are k-limited: one that grows past K objects is made top. A pointer that may point to that many objects gives the clients no useful precision, and the few sets that large are where most of the solving goes. Top sets only stay top if they absorb everything, so the option implies -enable-universal-top
+bool usesTopSets()
 {
-private:
-	typedef std::map<NodeIndex, ConstraintGraphNode> NodeMapTy;
-	NodeMapTy graph;
-public:
-	typedef NodeMapTy::iterator iterator;
-	typedef NodeMapTy::const_iterator const_iterator;
-
-	ConstraintGraph() {}
-
-	bool insertCopyEdge(NodeIndex src, NodeIndex dst)
-	{
-		auto itr = graph.find(src);
-		if (itr == graph.end())
-		{
-			ConstraintGraphNode srcNode(src);
-			srcNode.insertCopyEdge(dst);
-			graph.insert(std::make_pair(src, std::move(srcNode)));
-			return true;
-		}
-		else
-			return (itr->second).insertCopyEdge(dst);
-	}
+	return EnableUniversalTop || PtsSetLimit != 0;
+}
 
-	bool insertLoadEdge(NodeIndex src, NodeIndex dst)
-	{
-		auto itr = graph.find(src);
-		if (itr == graph.end())
-		{
-			ConstraintGraphNode srcNode(src);
-			srcNode.insertLoadEdge(dst);
-			graph.insert(std::make_pair(src, std::move(srcNode)));
-			return true;
-		}
-		else
-			return (itr->second).insertLoadEdge(dst);
-	}
+// Make ptsSet top if it has grown past -anders-pts-limit. Return true if it has
+bool limitPtsSet(AndersPtsSet& ptsSet)
+{
+	if (PtsSetLimit == 0 || ptsSet.getSize() <= PtsSetLimit)
+		return false;
+	makeTop(ptsSet);
+	++NumLimitedSets;
+	return true;
+}
 
-	bool insertStoreEdge(NodeIndex src, NodeIndex dst)
+// Every union of points-to sets in the solvers goes through here, so that no set ever holds the universal object next to other objects under -enable-universal-top, nor more than -anders-pts-limit objects. Return true if dst changes
+bool unionPtsSets(AndersPtsSet& dst, const AndersPtsSet& src)
+{
+	if (usesTopSets())
 	{
-		auto itr = graph.find(src);
-		if (itr == graph.end())
+		if (dst.has(AndersNodeFactory::UniversalObjIndex))
+			return false;
+		if (src.has(AndersNodeFactory::UniversalObjIndex))
 		{
-			ConstraintGraphNode srcNode(src);
-			srcNode.insertStoreEdge(dst);
-			graph.insert(std::make_pair(src, std::move(srcNode)));
+			makeTop(dst);
 			return true;
 		}
-		else
-			return (itr->second).insertStoreEdge(dst);
 	}
+	if (!dst.unionWith(src))
+		return false;
+	limitPtsSet(dst);
+	return true;
+}
 
-	void mergeNodes(NodeIndex dst, NodeIndex src)
+// The objects a points-to set stands for when its load and store edges are resolved: the null object, which the set keeps apart from its elements (see BasicAndersPtsSet), and then the elements
+class PtsSetObjectRange
+{
+private:
+	const AndersPtsSet& ptsSet;
+public:
+	class iterator
 	{
-		auto itr = graph.find(src);
-		if (itr == graph.end())
-			return;
-
-		const ConstraintGraphNode& srcNode = itr->second;
-		itr = graph.find(dst);
-		if (itr == graph.end())
+	private:
+		AndersPtsSet::iterator itr;
+		bool atNullObject;
+	public:
+		iterator(AndersPtsSet::iterator i, bool n): itr(i), atNullObject(n) {}
+
+		NodeIndex operator*() const { return atNullObject ? AndersNodeFactory::NullObjectIndex : *itr; }
+		iterator& operator++()
 		{
-			ConstraintGraphNode dstNode(dst);
-			graph.insert(std::make_pair(dst, srcNode));
+			if (atNullObject)
+				atNullObject = false;
+			else
+				++itr;
+			return *this;
 		}
-		else
-			(itr->second).mergeEdges(srcNode);
-	}
-
-	void deleteNode(NodeIndex idx)
-	{
-		graph.erase(idx);
-	}
-
-	ConstraintGraphNode* getNodeWithIndex(NodeIndex idx)
-	{
-		auto itr = graph.find(idx);
-		if (itr == graph.end())
-			return nullptr;
-		else
-			return &(itr->second);
-	}
+		bool operator!=(const iterator& other) const { return atNullObject != other.atNullObject || itr != other.itr; }
+	};
 
-	ConstraintGraphNode* getOrInsertNode(NodeIndex idx)
-	{
-		auto itr = graph.find(idx);
-		if (itr == graph.end())
-		{
-			ConstraintGraphNode newNode(idx);
-			itr = graph.insert(std::make_pair(idx, newNode)).first;
-		}
-		return &(itr->second);
-	}
+	PtsSetObjectRange(const AndersPtsSet& s): ptsSet(s) {}
 
-	iterator begin() { return graph.begin(); }
-	iterator end() { return graph.end(); }
-	const_iterator begin() const { return graph.begin(); }
-	const_iterator end() const { return graph.end(); }
+	iterator begin() const { return iterator(ptsSet.begin(), ptsSet.hasNullObject()); }
+	iterator end() const { return iterator(ptsSet.end(), false); }
 };
 
-}	// Temporary end of anonymous namespace
-
-// Specialize the AnderGraphTraits for ConstraintGraph
-template <> class AndersGraphTraits<ConstraintGraph>
+PtsSetObjectRange withNullObject(const AndersPtsSet& ptsSet)
 {
-public:
-	typedef ConstraintGraphNode NodeType;
-	typedef MapValueIterator<ConstraintGraph::const_iterator> NodeIterator;
-	typedef ConstraintGraphNode::iterator ChildIterator;
+	return PtsSetObjectRange(ptsSet);
+}
 
-	static inline ChildIterator child_begin(const NodeType* n)
-	{
-		return n->begin();
-	}
-	static inline ChildIterator child_end(const NodeType* n)
-	{
-		return n->end();
-	}
+// propGraph (if not null) holds, for each node, the part of its points-to set that has already been propagated by difference propagation
+// Return false if dst and src are the same node already
+bool collapseNodes(NodeIndex dst, NodeIndex src, AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, ConstraintGraph& constraintGraph, AndersPtsGraph* propGraph = nullptr)
+{
+	if (dst == src)
+		return false;
+	++NumCollapses;
 
-	static inline NodeIterator node_begin(const ConstraintGraph* g)
-	{
-		return NodeIterator(g->begin());
-	}
-	static inline NodeIterator node_end(const ConstraintGraph* g)
+	// The merged node inherits edges that have never seen dst's points-to set, and vice versa. Forget what has been propagated so that the next visit of dst processes its whole set
+	if (propGraph != nullptr)
 	{
-		return NodeIterator(g->end());
+		propGraph->erase(dst);
+		propGraph->erase(src);
 	}
-};
-
-namespace {
-
-void collapseNodes(NodeIndex dst, NodeIndex src, AndersNodeFactory& nodeFactory, std::map<NodeIndex, AndersPtsSet>& ptsGraph, ConstraintGraph& constraintGraph)
-{
-	if (dst == src)
-		return;
 
 	// Node merge
 	nodeFactory.mergeNode(dst, src);
 	if (ptsGraph.count(src))
-		ptsGraph[dst].unionWith(ptsGraph[src]);
+	{
+		AndersPtsSet& dstPtsSet = ptsGraph[dst];
+		unionPtsSets(dstPtsSet, *ptsGraph.find(src));
+	}
 	constraintGraph.mergeNodes(dst, src);
 
 	// We don't need the node cycleIdx any more
 	ptsGraph.erase(src);
 	constraintGraph.deleteNode(src);
+	return true;
 }
 
-// The worklist for our analysis
-class AndersWorkList
+// Collapse the representatives of all of srcs into dst, which must be a representative, in one pass: the points-to set and the constraint graph node of dst are looked up once rather than once per node. Nodes that are dst already are skipped
+// Return the number of nodes merged away
+unsigned collapseNodes(NodeIndex dst, ArrayRef<NodeIndex> srcs, AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, ConstraintGraph& constraintGraph, AndersPtsGraph* propGraph = nullptr)
 {
-private:
-	// The FIFO queue
-	std::queue<NodeIndex> list;
-	// Avoid duplicate entries in FIFO queue
-	llvm::SmallSet<NodeIndex, 16> set;
-public:
-	AndersWorkList() {}
-	void enqueue(NodeIndex elem)
+	assert(nodeFactory.getMergeTarget(dst) == dst);
+	std::vector<NodeIndex> merged;
+	AndersPtsSet* dstPtsSet = nullptr;
+	for (auto n: srcs)
 	{
-		if (!set.count(elem))
+		NodeIndex src = nodeFactory.getMergeTarget(n);
+		if (src == dst)
+			continue;
+		nodeFactory.mergeNode(dst, src);
+		merged.push_back(src);
+		if (propGraph != nullptr)
+			propGraph->erase(src);
+		if (const AndersPtsSet* srcPtsSet = ptsGraph.find(src))
 		{
-			list.push(elem);
-			set.insert(elem);
+			if (dstPtsSet == nullptr)
+				dstPtsSet = &ptsGraph[dst];
+			unionPtsSets(*dstPtsSet, *srcPtsSet);
+			ptsGraph.erase(src);
 		}
 	}
-	NodeIndex dequeue()
-	{
-		assert(!list.empty() && "Trying to dequeue an empty queue!");
-		NodeIndex ret = list.front();
-		list.pop();
-		set.erase(ret);
-		return ret;
-	}
-	bool isEmpty() const { return list.empty(); }
-};
+	if (merged.empty())
+		return 0;
+
+	// See the single-node collapseNodes()
+	if (propGraph != nullptr)
+		propGraph->erase(dst);
+	constraintGraph.mergeNodes(dst, merged);
+	NumCollapses += merged.size();
+	return merged.size();
+}
 
 // The technique used here is described in "The Ant and the Grasshopper: Fast and Accurate Pointer Analysis for Millions of Lines of Code. In Programming Language Design and Implementation (PLDI), June 2007." It is known as the "HCD" (Hybrid Cycle Detection) algorithm. It is called a hybrid because it performs an offline analysis and uses its results during the solving (online) phase. This is just the offline portion
-class OfflineCycleDetector: public CycleDetector<SparseBitVectorGraph>
+class OfflineCycleDetector: public CycleDetector<OfflineCycleDetector, DenseSparseBitVectorGraph>
 {
 private:
+	friend class CycleDetector<OfflineCycleDetector, DenseSparseBitVectorGraph>;
+
 	// The node factory
 	AndersNodeFactory& nodeFactory;
 
-	// The offline constraint graph
-	SparseBitVectorGraph offlineGraph;
-	// If a mapping <p, q> is in this map, it means that *p and q are in the same cycle in the offline constraint graph, and anything that p points to during the online constraint solving phase can be immediately collapse with q
-	DenseMap<NodeIndex, NodeIndex> collapseMap;
+	// The offline constraint graph. It holds the VAR and REF nodes, i.e. 2 * numNodes of them
+	DenseSparseBitVectorGraph offlineGraph;
+	// If collapseTargets[p] is q (rather than InvalidIndex), it means that *p and q are in the same cycle in the offline constraint graph, and anything that p points to during the online constraint solving phase can be immediately collapse with q. The solver looks this up at every visit, so it is a vector indexed by p rather than a map
+	std::vector<NodeIndex> collapseTargets;
 	// Holds the pairs of VAR nodes that we are going to merge together
 	DenseMap<NodeIndex, NodeIndex> mergeMap;
 	// Used to collect the scc nodes on a cycle
@@ -336,19 +294,19 @@ private:
 		}
 	}
 	
-	NodeType* getRep(NodeIndex idx) override
+	NodeType* getRep(NodeIndex idx)
 	{
 		return offlineGraph.getOrInsertNode(idx);
 	}
 
 	// Specify how to process the non-rep nodes if a cycle is found
-	void processNodeOnCycle(const NodeType* node, const NodeType* repNode) override
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
 	{
 		scc.set(node->getNodeIndex());
 	}
 
 	// Specify how to process the rep nodes if a cycle is found
-	void processCycleRepNode(const NodeType* node) override
+	void processCycleRepNode(const NodeType* node)
 	{
 		// A trivial cycle is not interesting
 		if (scc.count() == 0)
@@ -358,32 +316,51 @@ private:
 
 		// The representative is the first non-ref node
 		NodeIndex repNode = scc.find_first();
-		assert(repNode < nodeFactory.getNumNodes() && "The SCC didn't have a non-Ref node!");
 		for (auto itr = ++scc.begin(), ite = scc.end(); itr != ite; ++itr)
-		{
-			NodeIndex cycleNode = *itr;
-			if (cycleNode > nodeFactory.getNumNodes())
-				// For REF nodes, insert it to the collapse map
-				collapseMap[cycleNode - nodeFactory.getNumNodes()] = repNode;
-			else
-				// For VAR nodes, insert it to the merge map
-				// We don't merge the nodes immediately to avoid affecting the DFS
-				mergeMap[cycleNode] = repNode;
-		}
+			recordCycleNode(*itr, repNode);
 
 		scc.clear();
 	}
 
+	// Record that cycleNode is on the same cycle as repNode, the smallest node of that cycle
+	void recordCycleNode(NodeIndex cycleNode, NodeIndex repNode)
+	{
+		assert(repNode < nodeFactory.getNumNodes() && "The SCC didn't have a non-Ref node!");
+		if (cycleNode > nodeFactory.getNumNodes())
+			// For REF nodes, insert it to the collapse map
+			collapseTargets[cycleNode - nodeFactory.getNumNodes()] = repNode;
+		else
+			// For VAR nodes, insert it to the merge map
+			// We don't merge the nodes immediately to avoid affecting the DFS
+			mergeMap[cycleNode] = repNode;
+	}
+
 public:
-	OfflineCycleDetector(const std::vector<AndersConstraint>& cs, AndersNodeFactory& n): nodeFactory(n)
+	OfflineCycleDetector(const std::vector<AndersConstraint>& cs, AndersNodeFactory& n): nodeFactory(n), offlineGraph(2 * n.getNumNodes()), collapseTargets(n.getNumNodes(), AndersNodeFactory::InvalidIndex)
 	{
 		// Build the offline constraint graph first before we move on
 		buildOfflineConstraintGraph(cs);
 	}
+	// A detector that has already run, with the collapse targets given. PartitionedSolver hands each of its sub-problems the targets of the whole program this way
+	OfflineCycleDetector(AndersNodeFactory& n, std::vector<NodeIndex> targets): nodeFactory(n), offlineGraph(0), collapseTargets(std::move(targets)) {}
 
-	void run() override
+	void run()
 	{
-		runOnGraph(&offlineGraph);
+		unsigned numThreads = getNumWorkerThreads(NumOptimizerThreads);
+		if (numThreads > 1)
+		{
+			// The parallel search names every cycle by its smallest node as well, so it finds the same collapse targets and merges as the DFS
+			ParallelSCCFinder finder(offlineGraph, 2 * nodeFactory.getNumNodes());
+			finder.run(numThreads);
+			for (NodeIndex i = 0, e = 2 * nodeFactory.getNumNodes(); i < e; ++i)
+			{
+				NodeIndex repNode = finder.getRep(i);
+				if (repNode != i)
+					recordCycleNode(i, repNode);
+			}
+		}
+		else
+			runOnGraph(&offlineGraph);
 
 		// Merge the nodes in mergeMap
 		for (auto const& mapping: mergeMap)
@@ -396,17 +373,88 @@ public:
 	}
 
 	// Return InvalidIndex if no collapse target found
-	NodeIndex getCollapseTarget(NodeIndex n)
+	NodeIndex getCollapseTarget(NodeIndex n) const
 	{
-		auto itr = collapseMap.find(n);
-		if (itr == collapseMap.end())
-			return AndersNodeFactory::InvalidIndex;
-		else
-			return itr->second;
+		return n < collapseTargets.size() ? collapseTargets[n] : AndersNodeFactory::InvalidIndex;
 	}
+	ArrayRef<NodeIndex> getCollapseTargets() const { return collapseTargets; }
+
+	// Only the collapse targets are left once it has run
+	std::size_t getMemoryUsage() const { return offlineGraph.getMemoryUsage() + getVectorMemoryUsage(collapseTargets) + mergeMap.getMemorySize(); }
 };
 
-void buildConstraintGraph(ConstraintGraph& cGraph, const std::vector<AndersConstraint>& constraints, AndersNodeFactory& nodeFactory, std::map<NodeIndex, AndersPtsSet>& ptsGraph)
+// An approximate transitive reduction of the copy constraints: a copy a->c is dropped if there are copies a->b and b->c, since the set of a gets into c through b anyway. Only these paths of two edges are looked for, and only into the nodes with at most -anders-reduce-copies-max-preds copy predecessors, so the cost stays close to linear in the number of copies
+// Each edge is dropped for a path through the edges that are left at the time, so whatever reached a node before still reaches it afterwards, cycles or not. The loads and stores only ever add copy edges during solving, so the solution stays the same. Return the number of constraints dropped
+unsigned reduceCopyConstraints(std::vector<AndersConstraint>& constraints, const AndersNodeFactory& nodeFactory)
+{
+	// The distinct copy edges between merge targets, sorted by source, and the edges into each node
+	std::vector<std::pair<NodeIndex, NodeIndex>> edges;
+	for (auto const& c: constraints)
+	{
+		if (c.getType() != AndersConstraint::COPY)
+			continue;
+		NodeIndex srcTgt = nodeFactory.getMergeTarget(c.getSrc());
+		NodeIndex dstTgt = nodeFactory.getMergeTarget(c.getDest());
+		if (srcTgt != dstTgt)
+			edges.emplace_back(srcTgt, dstTgt);
+	}
+	std::sort(edges.begin(), edges.end());
+	edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+	if (edges.empty())
+		return 0;
+
+	std::vector<unsigned> inEdges(edges.size());
+	for (unsigned i = 0, e = edges.size(); i < e; ++i)
+		inEdges[i] = i;
+	std::stable_sort(inEdges.begin(), inEdges.end(), [&edges] (unsigned lhs, unsigned rhs)
+	{
+		return edges[lhs].second < edges[rhs].second;
+	});
+
+	BitVector dropped(edges.size());
+	auto hasEdge = [&edges, &dropped] (NodeIndex src, NodeIndex dst)
+	{
+		auto itr = std::lower_bound(edges.begin(), edges.end(), std::make_pair(src, dst));
+		return itr != edges.end() && *itr == std::make_pair(src, dst) && !dropped.test(itr - edges.begin());
+	};
+	for (unsigned first = 0, e = inEdges.size(); first < e;)
+	{
+		unsigned last = first + 1;
+		while (last < e && edges[inEdges[last]].second == edges[inEdges[first]].second)
+			++last;
+		if (last - first >= 2 && last - first <= CopyReductionMaxPreds)
+		{
+			for (unsigned i = first; i < last; ++i)
+			{
+				NodeIndex src = edges[inEdges[i]].first;
+				for (unsigned j = first; j < last; ++j)
+				{
+					if (j == i || dropped.test(inEdges[j]) || !hasEdge(src, edges[inEdges[j]].first))
+						continue;
+					dropped.set(inEdges[i]);
+					break;
+				}
+			}
+		}
+		first = last;
+	}
+	if (dropped.none())
+		return 0;
+
+	unsigned numConstraints = constraints.size();
+	constraints.erase(std::remove_if(constraints.begin(), constraints.end(), [&] (const AndersConstraint& c)
+	{
+		if (c.getType() != AndersConstraint::COPY)
+			return false;
+		auto edge = std::make_pair(nodeFactory.getMergeTarget(c.getSrc()), nodeFactory.getMergeTarget(c.getDest()));
+		if (edge.first == edge.second)
+			return false;
+		return dropped.test(std::lower_bound(edges.begin(), edges.end(), edge) - edges.begin());
+	}), constraints.end());
+	return numConstraints - constraints.size();
+}
+
+void buildConstraintGraph(ConstraintGraph& cGraph, const std::vector<AndersConstraint>& constraints, AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph)
 {
 	for (auto const& c: constraints)
 	{
@@ -417,7 +465,17 @@ void buildConstraintGraph(ConstraintGraph& cGraph, const std::vector<AndersConst
 			case AndersConstraint::ADDR_OF:
 			{
 				// We don't want to replace src with srcTgt because, after all, the address of a variable is NOT the same as the address of another variable
-				ptsGraph[dstTgt].insert(c.getSrc());
+				AndersPtsSet& ptsSet = ptsGraph[dstTgt];
+				NodeIndex obj = c.getSrc();
+				if (usesTopSets() && (obj == AndersNodeFactory::UniversalObjIndex || ptsSet.has(AndersNodeFactory::UniversalObjIndex)))
+					makeTop(ptsSet);
+				else if (obj == AndersNodeFactory::NullObjectIndex)
+					ptsSet.insertNullObject();
+				else
+				{
+					ptsSet.insert(obj);
+					limitPtsSet(ptsSet);
+				}
 				break;
 			}
 			case AndersConstraint::LOAD:
@@ -439,237 +497,3171 @@ void buildConstraintGraph(ConstraintGraph& cGraph, const std::vector<AndersConst
 	}
 }
 
-class OnlineCycleDetector: public CycleDetector<ConstraintGraph>
+// Insert the copy constraints of the indirect calls that have just been resolved (see Andersen::resolveIndirectCalls()) into the constraint graph. Unlike the copy edges the solver finds by itself, these show up after their sources may have propagated their points-to sets already, so the whole set of the source is pushed along the edge right away. What the source gets later is propagated as usual
+// The nodes whose points-to sets change are put into changedNodes
+void insertResolvedCallEdges(const std::vector<AndersConstraint>& constraints, ConstraintGraph& cGraph, AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, std::vector<NodeIndex>& changedNodes)
+{
+	for (auto const& c: constraints)
+	{
+		assert(c.getType() == AndersConstraint::COPY && "Resolving an indirect call should only add copy constraints!");
+		NodeIndex srcTgt = nodeFactory.getMergeTarget(c.getSrc());
+		NodeIndex dstTgt = nodeFactory.getMergeTarget(c.getDest());
+		if (!cGraph.insertCopyEdge(srcTgt, dstTgt))
+			continue;
+		++NumCopyEdgesAdded;
+		if (srcTgt == dstTgt)
+			continue;
+
+		const AndersPtsSet* srcPtsSet = ptsGraph.find(srcTgt);
+		if (srcPtsSet != nullptr && unionPtsSets(ptsGraph[dstTgt], *srcPtsSet))
+			changedNodes.push_back(dstTgt);
+	}
+}
+
+// The limits of -anders-time-budget and -anders-memory-budget. The time counts from the start of the online solving; the memory is the peak RSS of the whole process, parsing and collection included
+// Given the options of the run, the cancellation token stops the solver just like a budget, and the progress callback hears about each outer iteration
+class SolverBudget
+{
+private:
+	// poll() only looks at the clock and the RSS at the first of every this many calls
+	static const unsigned PollInterval = 256;
+
+	std::chrono::steady_clock::time_point deadline;
+	bool hasDeadline;
+	unsigned maxRSS;
+	unsigned numPolls;
+	const char* exceeded;
+	const AndersRunOptions* runOptions;
+	unsigned numNodes;
+	unsigned numIterations;
+	AndersSolverWork work;
+public:
+	SolverBudget(const AndersRunOptions* options = nullptr, unsigned n = 0): hasDeadline(SolverTimeBudget > 0), maxRSS(SolverMemoryBudget * 1024), numPolls(0), exceeded(nullptr), runOptions(options), numNodes(n), numIterations(0)
+	{
+		if (hasDeadline)
+			deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(SolverTimeBudget));
+	}
+
+	// Return true if a budget is exceeded, or if the run is cancelled. Once it is, it stays so
+	bool check()
+	{
+		if (exceeded == nullptr)
+		{
+			if (isCancelRequested())
+				exceeded = "cancelled";
+			else if (hasDeadline && std::chrono::steady_clock::now() >= deadline)
+				exceeded = "time";
+			else if (maxRSS != 0 && getProcessPeakRSS() > maxRSS)
+				exceeded = "memory";
+		}
+		return exceeded != nullptr;
+	}
+	// The same as check(), cheap enough to call for every node the solver visits
+	bool poll()
+	{
+		if (exceeded != nullptr)
+			return true;
+		if ((!hasDeadline && maxRSS == 0 && !isCancelRequested()) || numPolls++ % PollInterval != 0)
+			return false;
+		return check();
+	}
+
+	// Called by the solvers at the end of each outer iteration, with the number of nodes it started with on the work list and what it did
+	void endIteration(unsigned workListSize, const SolverIterationStats& stats)
+	{
+		++numIterations;
+		work.addIteration(stats);
+		if (runOptions != nullptr && runOptions->onProgress && !isCancelRequested())
+			runOptions->onProgress(AndersProgress{AndersPhase::Solving, numNodes, 0, numIterations, workListSize});
+	}
+
+	bool isCancelRequested() const { return runOptions != nullptr && runOptions->cancellation != nullptr && runOptions->cancellation->isCancelled(); }
+	bool isCancelled() const { return exceeded != nullptr && std::strcmp(exceeded, "cancelled") == 0; }
+	// "time", "memory" or "cancelled"
+	const char* getExceededBudget() const { return exceeded; }
+	// What the solver has done so far
+	const AndersSolverWork& getWork() const { return work; }
+};
+
+// Make the results of a solving stopped before its fixed point sound again. pendingNodes are the nodes whose points-to sets have not been fully processed yet (the work lists, and the targets of the calls the on-the-fly call graph has yet to resolve). Everything they can still reach may still grow: their copy and load successors, and, once a node that has store edges may still get new pointees, any object. All those nodes get the universal object, which the queries read as "may point to anything", or, given a Steensgaard analysis of the same constraints, its points-to sets, which hold whatever the fixed point would have. Return the number of nodes that get either
+unsigned degradePendingNodes(ArrayRef<NodeIndex> pendingNodes, AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, const ConstraintGraph& constraintGraph, const SteensgaardAnalysis* fallback)
+{
+	BitVector affected(nodeFactory.getNumNodes());
+	std::vector<NodeIndex> stack;
+	auto mark = [&] (NodeIndex n)
+	{
+		n = nodeFactory.getMergeTarget(n);
+		if (!affected.test(n))
+		{
+			affected.set(n);
+			stack.push_back(n);
+		}
+	};
+
+	for (auto n: pendingNodes)
+		mark(n);
+	bool allObjectsAffected = false;
+	while (!stack.empty())
+	{
+		NodeIndex n = stack.back();
+		stack.pop_back();
+		const ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(n);
+		if (cNode == nullptr)
+			continue;
+
+		for (auto dst: *cNode)
+			mark(dst);
+		for (auto dst: cNode->loads())
+			mark(dst);
+		for (auto const& edge: cNode->fields())
+			mark(edge.first);
+		if (!allObjectsAffected && cNode->store_begin() != cNode->store_end())
+		{
+			allObjectsAffected = true;
+			for (NodeIndex obj = 0, e = nodeFactory.getNumNodes(); obj < e; ++obj)
+				if (nodeFactory.isObjectNode(obj))
+					mark(obj);
+		}
+	}
+
+	if (fallback != nullptr)
+	{
+		// A representative has to cover the Steensgaard set of every node merged into it, which is not always its own when the nodes were merged for having the same set so far (see -enable-online-equiv)
+		for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+		{
+			NodeIndex rep = nodeFactory.getMergeTarget(n);
+			if (!affected.test(rep))
+				continue;
+			if (const AndersPtsSet* ptsSet = fallback->getPointsToSet(n))
+				unionPtsSets(ptsGraph[rep], *ptsSet);
+		}
+		return affected.count();
+	}
+
+	AndersPtsSet universalSet;
+	universalSet.insert(nodeFactory.getUniversalObjNode());
+	for (int n = affected.find_first(); n != -1; n = affected.find_next(n))
+		unionPtsSets(ptsGraph[n], universalSet);
+	return affected.count();
+}
+
+// The periodic checkpoints of -anders-checkpoint (see SolverCheckpoint), and the work list a run resumed with -anders-resume starts from. Only WorkListSolver takes checkpoints, between two of its iterations
+class SolverCheckpointer
+{
+private:
+	std::uint64_t constraintHash;
+	const OfflineCycleDetector* offlineInfo;
+	std::vector<NodeIndex> resumedWorkList;
+	bool resumed;
+	std::chrono::steady_clock::time_point lastCheckpoint;
+	// Kept from one checkpoint to the next so that its storage is reused
+	std::vector<NodeIndex> workListNodes;
+public:
+	SolverCheckpointer(std::uint64_t h): constraintHash(h), offlineInfo(nullptr), resumed(false), lastCheckpoint(std::chrono::steady_clock::now()) {}
+
+	std::uint64_t getConstraintHash() const { return constraintHash; }
+	void setOfflineInfo(const OfflineCycleDetector* o) { offlineInfo = o; }
+
+	void setResumedWorkList(ArrayRef<std::uint32_t> workList)
+	{
+		resumedWorkList.assign(workList.begin(), workList.end());
+		resumed = true;
+	}
+	bool isResumed() const { return resumed; }
+	ArrayRef<NodeIndex> getResumedWorkList() const { return resumedWorkList; }
+
+	// Write a checkpoint if the interval has passed since the last one. workList is the current work list of the iteration about to start. A checkpoint that can't be written doesn't stop the solving
+	void checkpoint(const AndersNodeFactory& nodeFactory, const AndersPtsGraph& ptsGraph, const ConstraintGraph& constraintGraph, const AndersWorkList& workList)
+	{
+		if (SolverCheckpointFile.empty())
+			return;
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - lastCheckpoint;
+		if (elapsed.count() < SolverCheckpointInterval)
+			return;
+
+		workList.getElements(workListNodes);
+		ArrayRef<NodeIndex> collapseTargets = offlineInfo != nullptr ? offlineInfo->getCollapseTargets() : ArrayRef<NodeIndex>();
+		std::string error;
+		if (SolverCheckpoint::write(SolverCheckpointFile, constraintHash, nodeFactory, ptsGraph, constraintGraph, collapseTargets, workListNodes, error))
+			++NumSolverCheckpoints;
+		else
+			errs() << "Cannot write the solver checkpoint: " << error << "\n";
+		// The interval runs from the end of a checkpoint, so that writing a large one never takes up all of it
+		lastCheckpoint = std::chrono::steady_clock::now();
+	}
+};
+
+// Called by the solvers whenever they reach a fixed point, to let them know whether it is the final one. If it is not, the hook has changed some points-to sets, returns true and puts those nodes into its argument
+typedef std::function<bool(std::vector<NodeIndex>&)> FixedPointHook;
+
+// Ask the hook whether the solver should go on from a fixed point, and if so, put the nodes to revisit into workList
+bool resumeWorkList(const FixedPointHook& atFixedPoint, AndersWorkList& workList)
+{
+	std::vector<NodeIndex> changedNodes;
+	if (!atFixedPoint(changedNodes))
+		return false;
+	for (auto node: changedNodes)
+		workList.enqueue(node);
+	return true;
+}
+
+class OnlineCycleDetector: public CycleDetector<OnlineCycleDetector, ConstraintGraph>
 {
 private:
+	friend class CycleDetector<OnlineCycleDetector, ConstraintGraph>;
+
 	AndersNodeFactory& nodeFactory;
 	ConstraintGraph& constraintGraph;
-	std::map<NodeIndex, AndersPtsSet>& ptsGraph;
+	AndersPtsGraph& ptsGraph;
 	const DenseSet<NodeIndex>& candidates;
-
-	NodeType* getRep(NodeIndex idx) override
+	// Only used by difference propagation: the propagated sets, and the work list that collapsed nodes have to be pushed into
+	AndersPtsGraph* propGraph;
+	AndersWorkList* workList;
+	bool hasCollapsed;
+	unsigned numCollapsed;
+	// The number of nodes the last run visited
+	unsigned numVisited;
+
+	NodeType* getRep(NodeIndex idx)
 	{
 		return constraintGraph.getOrInsertNode(nodeFactory.getMergeTarget(idx));
 	}
 	// Specify how to process the non-rep nodes if a cycle is found
-	void processNodeOnCycle(const NodeType* node, const NodeType* repNode) override
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
 	{
 		NodeIndex repIdx = nodeFactory.getMergeTarget(repNode->getNodeIndex());
 		NodeIndex cycleIdx = nodeFactory.getMergeTarget(node->getNodeIndex());
 		//errs() << "Collapse node " << cycleIdx << " with node " << repIdx << "\n";
 
-		collapseNodes(repIdx, cycleIdx, nodeFactory, ptsGraph, constraintGraph);
+		if (collapseNodes(repIdx, cycleIdx, nodeFactory, ptsGraph, constraintGraph, propGraph))
+			++numCollapsed;
+		hasCollapsed = true;
 	}
 	// Specify how to process the rep nodes if a cycle is found
-	void processCycleRepNode(const NodeType* node) override
+	void processCycleRepNode(const NodeType* node)
 	{
-		// Do nothing, I guess?
+		// The rep node of a non-trivial cycle has to propagate its whole points-to set again under difference propagation
+		if (hasCollapsed && workList != nullptr)
+			workList->enqueue(nodeFactory.getMergeTarget(node->getNodeIndex()));
+		hasCollapsed = false;
 	}
 
 public:
-	OnlineCycleDetector(AndersNodeFactory& n, ConstraintGraph& co, std::map<NodeIndex, AndersPtsSet>& p, const DenseSet<NodeIndex>& ca): nodeFactory(n), constraintGraph(co), ptsGraph(p), candidates(ca) {}
+	OnlineCycleDetector(AndersNodeFactory& n, ConstraintGraph& co, AndersPtsGraph& p, const DenseSet<NodeIndex>& ca, AndersPtsGraph* pg = nullptr, AndersWorkList* w = nullptr): nodeFactory(n), constraintGraph(co), ptsGraph(p), candidates(ca), propGraph(pg), workList(w), hasCollapsed(false), numCollapsed(0), numVisited(0) {}
+
+	// The work list changes between the iterations of the solver
+	void setWorkList(AndersWorkList* w) { workList = w; }
 
-	void run() override
+	// Return the number of nodes collapsed
+	unsigned run()
 	{
+		numCollapsed = 0;
 		// Perform cycle detection on for nodes on the candidate list
 		for (auto node: candidates)
 			runOnNode(node);
+
+		// The same detector is run again at every iteration. Only forget about the nodes we have just visited, so that a run costs nothing proportional to the size of the graph
+		numVisited = getNumVisitedNodes();
+		resetSCCState();
+		return numCollapsed;
 	}
+	unsigned getNumVisited() const { return numVisited; }
 };
 
-}	// end of anonymous namespace
-
-/// solveConstraints - This stage iteratively processes the constraints list
-/// propagating constraints (adding edges to the Nodes in the points-to graph)
-/// until a fixed point is reached.
-///
-/// We use a variant of the technique called "Lazy Cycle Detection", which is
-/// described in "The Ant and the Grasshopper: Fast and Accurate Pointer
-/// Analysis for Millions of Lines of Code. In Programming Language Design and
-/// Implementation (PLDI), June 2007."
-/// The paper describes performing cycle detection one node at a time, which can
-/// be expensive if there are no cycles, but there are long chains of nodes that
-/// it heuristically believes are cycles (because it will DFS from each node
-/// without state from previous nodes).
-/// Instead, we use the heuristic to build a worklist of nodes to check, then
-/// cycle detect them all at the same time to do this more cheaply.  This
-/// catches cycles slightly later than the original technique did, but does it
-/// make significantly cheaper.
-void Andersen::solveConstraints()
+// Periodic cycle elimination, after "Online Cycle Detection and Difference Propagation for Pointer Analysis. In Source Code Analysis and Manipulation (SCAM), September 2003.": instead of guessing where the cycles are, as LCD does, find every SCC of the copy edges once enough copy edges have been added since the last sweep, and collapse them all. A sweep costs time proportional to the graph, so the interval bounds the share of the solving it takes, however the heuristic of LCD would fare on the graph
+class PeriodicCycleSweeper: public CycleDetector<PeriodicCycleSweeper, ConstraintGraph>
 {
-	// We'll do offline HCD first
-	OfflineCycleDetector offlineInfo(constraints, nodeFactory);
-	if (EnableHCD)
-		offlineInfo.run();
-
-	// Now build the constraint graph
-	ConstraintGraph constraintGraph;
-	buildConstraintGraph(constraintGraph, constraints, nodeFactory, ptsGraph);
-	// The constraint vector is useless now
-	constraints.clear();
-
-	// We switch between two work lists instead of relying on only one work list
-	AndersWorkList workList1, workList2;
-	// The "current" and the "next" work list
-	AndersWorkList *currWorkList = &workList1, *nextWorkList = &workList2;
-	// The set of nodes that LCD believes might be on a cycle
-	DenseSet<NodeIndex> cycleCandidates;
-	// The set of edges that LCD believes not on a cycle
-	DenseSet<std::pair<NodeIndex, NodeIndex>> checkedEdges;
+private:
+	friend class CycleDetector<PeriodicCycleSweeper, ConstraintGraph>;
 
-	// Scan the node list, add it to work list if the node a representative and can contribute to the calculation right now.
-	for (auto const& mapping: ptsGraph)
+	AndersNodeFactory& nodeFactory;
+	ConstraintGraph& constraintGraph;
+	AndersPtsGraph& ptsGraph;
+	// Only used by difference propagation
+	AndersPtsGraph* propGraph;
+	// The number of new copy edges that triggers a sweep, and the number added since the last one
+	unsigned interval;
+	unsigned numNewEdges;
+	// The pairs of <rep, cycle node> to collapse. We don't merge the nodes immediately to avoid affecting the DFS
+	std::vector<std::pair<NodeIndex, NodeIndex>> mergePairs;
+
+	NodeType* getRep(NodeIndex idx)
 	{
-		NodeIndex node = mapping.first;
-		if (nodeFactory.getMergeTarget(node) == node && constraintGraph.getNodeWithIndex(node) != nullptr)
-			currWorkList->enqueue(node);
+		return constraintGraph.getOrInsertNode(nodeFactory.getMergeTarget(idx));
 	}
-
-	while (!currWorkList->isEmpty())
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
 	{
-		// Iteration begins
+		mergePairs.push_back(std::make_pair(repNode->getNodeIndex(), node->getNodeIndex()));
+	}
+	void processCycleRepNode(const NodeType* node) {}
+public:
+	PeriodicCycleSweeper(AndersNodeFactory& n, ConstraintGraph& c, AndersPtsGraph& p, unsigned i, AndersPtsGraph* pg = nullptr): nodeFactory(n), constraintGraph(c), ptsGraph(p), propGraph(pg), interval(i), numNewEdges(0) {}
 
-		// First we've got to check if there is any cycle candidates in the last iteration. If there is, detect and collapse cycle
-		if (EnableLCD && !cycleCandidates.empty())
+	void addNewEdges(unsigned n) { numNewEdges += n; }
+
+	// Sweep if it is time to. The nodes on a cycle may have had different points-to sets, so every representative goes into workList to propagate its merged set along its merged edges. Return the number of nodes collapsed
+	unsigned run(AndersWorkList& workList)
+	{
+		if (interval == 0 || numNewEdges < interval)
+			return 0;
+		numNewEdges = 0;
+
+		runOnGraph(&constraintGraph);
+		resetSCCState();
+
+		unsigned numCollapsed = 0;
+		for (auto const& mapping: mergePairs)
+		{
+			NodeIndex repIdx = nodeFactory.getMergeTarget(mapping.first);
+			numCollapsed += collapseNodes(repIdx, nodeFactory.getMergeTarget(mapping.second), nodeFactory, ptsGraph, constraintGraph, propGraph);
+			workList.enqueue(repIdx);
+		}
+		mergePairs.clear();
+		return numCollapsed;
+	}
+};
+
+// Online pointer equivalence: merge the nodes whose points-to sets and edges have become identical during solving. HVN and HU only find the nodes that the constraints force to be equal, while many more nodes end up equal once their sets are solved, and as long as they stay apart every change reaching them is processed once per node
+// Two such nodes pass on exactly the same objects along exactly the same edges. They also get their objects from the same copy, load and field edges, so whatever reaches one of them later reaches the other too, and the merge is exact. A few nodes get objects from edges the graph doesn't show yet: the objects, which any store through a pointer to them writes to, and the nodes the on-the-fly call resolution adds copy edges into. These are never merged. The detector also only looks at the nodes that are not waiting in the work list, i.e. that have nothing left to pass on
+class OnlineEquivalenceDetector
+{
+private:
+	AndersNodeFactory& nodeFactory;
+	ConstraintGraph& constraintGraph;
+	AndersPtsGraph& ptsGraph;
+	// Only used by difference propagation: the propagated sets, and the work list the merged nodes have to be pushed into
+	AndersPtsGraph* propGraph;
+	AndersWorkList* workList;
+	// The nodes the on-the-fly call resolution may add copy edges into (see Andersen::lateCopyTargets)
+	ArrayRef<NodeIndex> lateTargets;
+	unsigned numIterations;
+
+	// The edges into the candidates, as (target, kind, source, offset), sorted. The offset is only used by the field edges
+	enum IncomingKind: unsigned { CopyIn, LoadIn, FieldIn };
+	typedef std::tuple<NodeIndex, unsigned, NodeIndex, unsigned> IncomingEdge;
+	std::vector<IncomingEdge> incoming;
+
+	// Gather the edges into the nodes marked in candidates
+	void collectIncomingEdges(const BitVector& candidates)
+	{
+		incoming.clear();
+		auto addEdge = [this, &candidates] (NodeIndex dst, IncomingKind kind, NodeIndex src, unsigned offset)
+		{
+			dst = nodeFactory.getMergeTarget(dst);
+			if (candidates.test(dst))
+				incoming.emplace_back(dst, kind, src, offset);
+		};
+		for (auto const& mapping: constraintGraph)
+		{
+			NodeIndex src = mapping.first;
+			for (auto dst: mapping.second)
+				addEdge(dst, CopyIn, src, 0);
+			for (auto dst: mapping.second.loads())
+				addEdge(dst, LoadIn, src, 0);
+			for (auto const& edge: mapping.second.fields())
+				addEdge(edge.first, FieldIn, src, edge.second);
+		}
+		std::sort(incoming.begin(), incoming.end());
+		incoming.erase(std::unique(incoming.begin(), incoming.end()), incoming.end());
+	}
+
+	// The merge targets of the copy, load and store successors of node, each kind sorted and closed by InvalidIndex, followed by the sorted (merge target, offset) pairs of its field edges, the type class of node, and its incoming edges
+	void getEdgeSignature(NodeIndex node, const ConstraintGraphNode& cNode, std::vector<NodeIndex>& signature) const
+	{
+		signature.clear();
+		auto addEdges = [this, &signature] (iterator_range<ConstraintGraphNode::const_iterator> edges)
+		{
+			unsigned first = signature.size();
+			for (auto dst: edges)
+				signature.push_back(nodeFactory.getMergeTarget(dst));
+			std::sort(signature.begin() + first, signature.end());
+			signature.erase(std::unique(signature.begin() + first, signature.end()), signature.end());
+			signature.push_back(AndersNodeFactory::InvalidIndex);
+		};
+		addEdges(make_range(cNode.begin(), cNode.end()));
+		addEdges(cNode.loads());
+		addEdges(cNode.stores());
+		std::vector<std::pair<NodeIndex, unsigned>> fieldEdges;
+		for (auto const& edge: cNode.fields())
+			fieldEdges.push_back(std::make_pair(nodeFactory.getMergeTarget(edge.first), edge.second));
+		std::sort(fieldEdges.begin(), fieldEdges.end());
+		fieldEdges.erase(std::unique(fieldEdges.begin(), fieldEdges.end()), fieldEdges.end());
+		for (auto const& edge: fieldEdges)
+		{
+			signature.push_back(edge.first);
+			signature.push_back(edge.second);
+		}
+		signature.push_back(AndersNodeFactory::InvalidIndex);
+
+		// The type filter filters the set of a node by its class (see AndersTypeFilter)
+		signature.push_back(nodeFactory.getTypeClass(node));
+		auto itr = std::lower_bound(incoming.begin(), incoming.end(), IncomingEdge(node, 0, 0, 0));
+		for (; itr != incoming.end() && std::get<0>(*itr) == node; ++itr)
+		{
+			signature.push_back(std::get<1>(*itr));
+			signature.push_back(std::get<2>(*itr));
+			signature.push_back(std::get<3>(*itr));
+		}
+	}
+public:
+	// The detector runs at every this many iterations of the solver. Hashing every node costs about as much as visiting it, so running at every iteration would double the work of the iterations that change little
+	static const unsigned Interval = 8;
+
+	OnlineEquivalenceDetector(AndersNodeFactory& n, ConstraintGraph& c, AndersPtsGraph& p, ArrayRef<NodeIndex> late, AndersPtsGraph* pg = nullptr): nodeFactory(n), constraintGraph(c), ptsGraph(p), propGraph(pg), workList(nullptr), lateTargets(late), numIterations(0) {}
+
+	// The work list changes between the iterations of the solver
+	void setWorkList(AndersWorkList* w) { workList = w; }
+
+	// Called at the start of every iteration of the solver, with the work list of the iteration. Merge the equivalent nodes among those not in pending if it is time to. Return the number of nodes merged away
+	unsigned run(const AndersWorkList& pending)
+	{
+		if (++numIterations % Interval != 0)
+			return 0;
+
+		BitVector excluded(nodeFactory.getNumNodes());
+		for (auto n: lateTargets)
+			excluded.set(nodeFactory.getMergeTarget(n));
+		std::vector<NodeIndex> candidates;
+		BitVector candidateMarks(nodeFactory.getNumNodes());
+		for (auto const& mapping: constraintGraph)
+		{
+			NodeIndex node = mapping.first;
+			if (node <= AndersNodeFactory::NullObjectIndex || nodeFactory.getMergeTarget(node) != node || nodeFactory.isObjectNode(node) || excluded.test(node) || pending.contains(node))
+				continue;
+			const AndersPtsSet* ptsSet = ptsGraph.find(node);
+			if (ptsSet == nullptr || ptsSet->isEmpty())
+				continue;
+			candidates.push_back(node);
+			candidateMarks.set(node);
+		}
+		if (candidates.size() < 2)
+			return 0;
+		collectIncomingEdges(candidateMarks);
+
+		// Hash every candidate, then compare the candidates whose hashes are equal. Sorting by the hash, rather than keeping a table of the signatures, needs no memory beyond one pair per node
+		std::vector<std::pair<size_t, NodeIndex>> hashes;
+		std::vector<NodeIndex> signature;
+		for (auto node: candidates)
+		{
+			const AndersPtsSet* ptsSet = ptsGraph.find(node);
+			getEdgeSignature(node, *constraintGraph.getNodeWithIndex(node), signature);
+			size_t hash = hash_combine(hash_combine_range(ptsSet->begin(), ptsSet->end()), ptsSet->hasNullObject(), hash_combine_range(signature.begin(), signature.end()));
+			hashes.push_back(std::make_pair(hash, node));
+		}
+		std::sort(hashes.begin(), hashes.end());
+
+		unsigned numMerged = 0;
+		std::vector<NodeIndex> targets;
+		std::vector<std::vector<NodeIndex>> targetSignatures;
+		for (size_t i = 0, e = hashes.size(); i < e; )
+		{
+			size_t end = i + 1;
+			while (end < e && hashes[end].first == hashes[i].first)
+				++end;
+			if (end - i == 1)
+			{
+				i = end;
+				continue;
+			}
+
+			// Each node of the run is merged into the first node before it that is equal to it. The nodes have been sorted by index within the run, so the target is the smallest of its class. The signatures are all taken before the first merge, which would make the edges of the others point to the merged node
+			targets.clear();
+			targetSignatures.clear();
+			std::vector<std::pair<NodeIndex, NodeIndex>> merges;
+			for (; i < end; ++i)
+			{
+				NodeIndex node = hashes[i].second;
+				getEdgeSignature(node, *constraintGraph.getNodeWithIndex(node), signature);
+				const AndersPtsSet& ptsSet = *ptsGraph.find(node);
+				bool merged = false;
+				for (unsigned t = 0; t < targets.size() && !merged; ++t)
+				{
+					if (signature != targetSignatures[t] || !(ptsSet == *ptsGraph.find(targets[t])))
+						continue;
+					merges.push_back(std::make_pair(targets[t], node));
+					merged = true;
+				}
+				if (!merged)
+				{
+					targets.push_back(node);
+					targetSignatures.push_back(signature);
+				}
+			}
+			for (auto const& merge: merges)
+			{
+				collapseNodes(merge.first, merge.second, nodeFactory, ptsGraph, constraintGraph, propGraph);
+				// The merged node has forgotten what it propagated
+				if (workList != nullptr)
+					workList->enqueue(merge.first);
+				++numMerged;
+			}
+		}
+		NumOnlineEquivMerges += numMerged;
+		return numMerged;
+	}
+};
+
+// Number the nodes of the constraint graph in topological order of its copy edges. Nodes on the same cycle get the same number
+class TopologicalOrderer: public CycleDetector<TopologicalOrderer, ConstraintGraph>
+{
+private:
+	friend class CycleDetector<TopologicalOrderer, ConstraintGraph>;
+
+	AndersNodeFactory& nodeFactory;
+	ConstraintGraph& constraintGraph;
+	AndersWorkListOrder& order;
+	// Tarjan's algorithm finds the SCCs in reverse topological order: count downwards
+	unsigned nextNumber;
+	std::vector<NodeIndex> sccNodes;
+
+	NodeType* getRep(NodeIndex idx)
+	{
+		return constraintGraph.getOrInsertNode(nodeFactory.getMergeTarget(idx));
+	}
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
+	{
+		sccNodes.push_back(node->getNodeIndex());
+	}
+	void processCycleRepNode(const NodeType* node)
+	{
+		--nextNumber;
+		order.setPriority(node->getNodeIndex(), nextNumber);
+		for (auto n: sccNodes)
+			order.setPriority(n, nextNumber);
+		sccNodes.clear();
+	}
+public:
+	TopologicalOrderer(AndersNodeFactory& n, ConstraintGraph& g, AndersWorkListOrder& o): nodeFactory(n), constraintGraph(g), order(o), nextNumber(n.getNumNodes()) {}
+
+	void run()
+	{
+		runOnGraph(&constraintGraph);
+		releaseSCCMemory();
+	}
+};
+
+// -anders-presolve: solve the copy edges of the initial constraint graph on their own before the online solving. The SCCs of the copy edges are collapsed, and then every set is pushed along the edges of the condensed graph in one sweep in topological order, which needs no work list: a node is only swept once all of its predecessors have been, so its set is final by then. Afterwards every copy edge already holds, and only the nodes with load, store and field edges have anything left to do
+class CopyPreSolver: public CycleDetector<CopyPreSolver, ConstraintGraph>
+{
+private:
+	friend class CycleDetector<CopyPreSolver, ConstraintGraph>;
+
+	AndersNodeFactory& nodeFactory;
+	ConstraintGraph& constraintGraph;
+	AndersPtsGraph& ptsGraph;
+	// The pairs of <rep, cycle node> to collapse once the DFS is over
+	std::vector<std::pair<NodeIndex, NodeIndex>> mergePairs;
+	// The representatives of the SCCs in the order Tarjan's algorithm finds them, which is reverse topological
+	std::vector<NodeIndex> sccReps;
+
+	NodeType* getRep(NodeIndex idx)
+	{
+		return constraintGraph.getOrInsertNode(nodeFactory.getMergeTarget(idx));
+	}
+	void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
+	{
+		mergePairs.push_back(std::make_pair(repNode->getNodeIndex(), node->getNodeIndex()));
+	}
+	void processCycleRepNode(const NodeType* node)
+	{
+		sccReps.push_back(node->getNodeIndex());
+	}
+public:
+	CopyPreSolver(AndersNodeFactory& n, ConstraintGraph& c, AndersPtsGraph& p): nodeFactory(n), constraintGraph(c), ptsGraph(p) {}
+
+	// Return the number of nodes collapsed
+	unsigned run()
+	{
+		runOnGraph(&constraintGraph);
+		releaseSCCMemory();
+
+		unsigned numCollapsed = 0;
+		for (auto const& mapping: mergePairs)
+			numCollapsed += collapseNodes(nodeFactory.getMergeTarget(mapping.first), nodeFactory.getMergeTarget(mapping.second), nodeFactory, ptsGraph, constraintGraph);
+		mergePairs.clear();
+
+		for (auto itr = sccReps.rbegin(), ite = sccReps.rend(); itr != ite; ++itr)
+		{
+			NodeIndex node = nodeFactory.getMergeTarget(*itr);
+			const AndersPtsSet* ptsSet = ptsGraph.find(node);
+			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+			if (ptsSet == nullptr || ptsSet->isEmpty() || cNode == nullptr)
+				continue;
+			cNode->canonicalizeEdges(nodeFactory);
+			// The points-to graph has a slot for every node, so ptsSet stays where it is while the successors grow
+			for (auto tgtNode: *cNode)
+				if (tgtNode != node)
+					unionPtsSets(ptsGraph[tgtNode], *ptsSet);
+		}
+		std::vector<NodeIndex>().swap(sccReps);
+		return numCollapsed;
+	}
+};
+
+AndersWorkListPolicy getWorkListPolicy()
+{
+	auto policy = StringSwitch<int>(WorkListPolicy)
+		.Case("fifo", static_cast<int>(AndersWorkListPolicy::FIFO))
+		.Case("lrf", static_cast<int>(AndersWorkListPolicy::LRF))
+		.Case("topo", static_cast<int>(AndersWorkListPolicy::TOPO))
+		.Case("divided", static_cast<int>(AndersWorkListPolicy::DIVIDED))
+		.Default(-1);
+	if (policy < 0)
+	{
+		errs() << "Unknown worklist policy \"" << WorkListPolicy << "\", falling back to fifo\n";
+		return AndersWorkListPolicy::FIFO;
+	}
+	return static_cast<AndersWorkListPolicy>(policy);
+}
+
+// Under difference propagation, a newly inserted copy edge src -> dst would only see the future changes of src. Bring dst up to date with what src has right now. Return true if dst's points-to set changes
+bool propagateAlongNewEdge(NodeIndex src, NodeIndex dst, AndersPtsGraph& ptsGraph, SolverIterationStats& stats)
+{
+	if (src == dst || !ptsGraph.count(src))
+		return false;
+	AndersPtsSet& dstPtsSet = ptsGraph[dst];
+	++stats.unions;
+	if (!unionPtsSets(dstPtsSet, *ptsGraph.find(src)))
+		return false;
+	++stats.changedUnions;
+	return true;
+}
+
+// The flags that the sequential solving loop would otherwise test at every visit and every copy edge. WorkListSolver is instantiated once per combination of them, and the combination is picked once when solving starts
+template <bool HCD, bool LCD, bool DiffProp>
+struct WorkListSolverConfig
+{
+	static const bool hcd = HCD;
+	static const bool lcd = LCD;
+	static const bool diffProp = DiffProp;
+};
+
+// With -anders-adaptive-cycles, each of HCD and LCD has one of these. Both find most of their cycles early in the solving, and late in it they mostly cost work: LCD searches from candidates that are not on any cycle, and HCD goes through the sets of its nodes to find that they are merged already. The throttle of a technique weighs the nodes it collapses in an iteration against the nodes it looks at, and when the yield falls under -anders-adaptive-cycles-yield, it turns the technique off for a number of iterations. The number doubles after each poor iteration, up to MaxBackoff, and goes back to 1 as soon as one pays, so a technique that has stopped paying costs little, and is still tried again every so often
+// Without the option, the technique is always on
+class CycleDetectionThrottle
+{
+private:
+	static const unsigned MaxBackoff = 64;
+	bool adaptive;
+	// The number of iterations the next poor iteration turns the technique off for, and the number left before it is on again
+	unsigned backoff, offIterations;
+	// The work done and the nodes collapsed in the current iteration
+	std::uint64_t work, collapses;
+public:
+	CycleDetectionThrottle(): adaptive(EnableAdaptiveCycles), backoff(1), offIterations(0), work(0), collapses(0) {}
+
+	bool isEnabled() const { return offIterations == 0; }
+	void record(unsigned w, unsigned c)
+	{
+		work += w;
+		collapses += c;
+	}
+	// Called at the end of every iteration of the solver. An iteration with no work at all says nothing about the yield
+	void endIteration()
+	{
+		if (!adaptive)
+			return;
+		if (offIterations != 0)
+		{
+			--offIterations;
+			++NumThrottledIterations;
+			return;
+		}
+		if (work == 0)
+			return;
+		if (collapses < AdaptiveCyclesYield * work)
+		{
+			offIterations = backoff;
+			backoff = std::min(2 * backoff, MaxBackoff);
+		}
+		else
+			backoff = 1;
+		work = collapses = 0;
+	}
+};
+
+// The state of lazy cycle detection in WorkListSolver. A solver without LCD gets the specialization below, which holds nothing and does nothing
+template <bool Enabled>
+class LazyCycleState
+{
+private:
+	// The set of nodes that LCD believes might be on a cycle. The edges that have been checked already are remembered by the constraint graph nodes
+	DenseSet<NodeIndex> cycleCandidates;
+	OnlineCycleDetector cycleDetector;
+	CycleDetectionThrottle throttle;
+public:
+	LazyCycleState(AndersNodeFactory& n, ConstraintGraph& c, AndersPtsGraph& p, AndersPtsGraph* pg): cycleDetector(n, c, p, cycleCandidates, pg) {}
+
+	// Detect and collapse the cycles through the candidates of the last iteration. The collapsed nodes are pushed into workList under difference propagation. This is called once per iteration, which is also when the throttle judges the last one
+	void collapseCycles(AndersWorkList* workList, SolverIterationStats& stats)
+	{
+		if (!cycleCandidates.empty())
+		{
+			cycleDetector.setWorkList(workList);
+			unsigned numCollapsed = cycleDetector.run();
+			stats.cycleCollapses += numCollapsed;
+			throttle.record(cycleDetector.getNumVisited(), numCollapsed);
+			cycleCandidates.clear();
+		}
+		throttle.endIteration();
+	}
+
+	// Called for the copy edge from cNode to tgtNode when propagating along it has changed nothing. If this is a cycle candidate (equal points-to sets and this particular edge has not been cycle-checked previously), add it to the list to check for cycles on the next iteration. While the throttle has LCD off, the sets aren't even compared
+	void checkEdge(ConstraintGraphNode* cNode, NodeIndex tgtNode, const AndersPtsSet& ptsSet, const AndersPtsSet& tgtPtsSet, SolverIterationStats& stats)
+	{
+		if (throttle.isEnabled() && ptsSet == tgtPtsSet && cNode->markCopyEdgeChecked(tgtNode))
+		{
+			if (cycleCandidates.insert(tgtNode).second)
+				++stats.lcdCandidates;
+		}
+	}
+};
+
+template <>
+class LazyCycleState<false>
+{
+public:
+	LazyCycleState(AndersNodeFactory&, ConstraintGraph&, AndersPtsGraph&, AndersPtsGraph*) {}
+
+	void collapseCycles(AndersWorkList*, SolverIterationStats&) {}
+	void checkEdge(ConstraintGraphNode*, NodeIndex, const AndersPtsSet&, const AndersPtsSet&, SolverIterationStats&) {}
+};
+
+// The sequential solving loop of Andersen::solveConstraints(), for the combination of HCD, LCD and difference propagation given by Config (a WorkListSolverConfig)
+template <typename Config>
+class WorkListSolver
+{
+private:
+	AndersNodeFactory& nodeFactory;
+	AndersPtsGraph& ptsGraph;
+	ConstraintGraph& constraintGraph;
+	// Only used by HCD
+	const OfflineCycleDetector* offlineInfo;
+	// Only used by -anders-type-filter
+	const AndersTypeFilter* typeFilter;
+	// Only used by -anders-checkpoint and -anders-resume
+	SolverCheckpointer* checkpointer;
+	// Only used by -anders-hot-nodes
+	SolverNodeProfile* nodeProfile;
+	// Only used by -enable-online-equiv
+	ArrayRef<NodeIndex> lateCopyTargets;
+
+	// We switch between two work lists instead of relying on only one work list
+	AndersWorkList workList1, workList2;
+	// The "current" and the "next" work list
+	AndersWorkList *currWorkList, *nextWorkList;
+	AndersWorkListOrder& workListOrder;
+
+	// For difference propagation: the part of each node's points-to set that has been propagated already. diffPropGraph points to it under difference propagation and is null otherwise
+	AndersPtsGraph propGraph;
+	AndersPtsGraph* diffPropGraph;
+
+	LazyCycleState<Config::lcd> lazyCycles;
+	// Only used by HCD
+	CycleDetectionThrottle hcdThrottle;
+	PeriodicCycleSweeper cycleSweeper;
+
+	SolverIterationStats stats;
+
+	// Only used by -anders-out-of-core, with the nodes of the last spill
+	std::unique_ptr<PtsSetSpillFile> spillFile;
+	std::vector<NodeIndex> coldNodes;
+
+	// -anders-worklist-batch: the nodes taken off the current work list and not visited yet, from nextInBatch on
+	unsigned batchSize;
+	std::vector<NodeIndex> batch;
+	unsigned nextInBatch = 0;
+
+	// -anders-hub-degree: the hubs whose copies into idle successors have been left since the last fixed point. A successor is idle if it has no edges: nothing reads its set before the fixed point, unless an edge is added to it, and flushHubs() then makes up for what it has missed
+	unsigned hubDegree;
+	std::vector<NodeIndex> pendingHubs;
+	BitVector pendingHubMarks;
+
+	// The copy edges the load and store constraints of the node being visited give rise to, as (src, dst) pairs, and the ones among them that are new. Both are kept from one visit to the next so that their storage is reused
+	std::vector<std::pair<NodeIndex, NodeIndex>> complexEdges, newComplexEdges;
+
+	// This is where we perform HCD: check if node has a collapse target, and if it does, merge them immediately. workSet is the part of the points-to set of node being processed. Return false if node has been merged away
+	bool collapseOffline(NodeIndex node, const AndersPtsSet& workSet)
+	{
+		NodeIndex collapseTarget = offlineInfo->getCollapseTarget(node);
+		if (collapseTarget == AndersNodeFactory::InvalidIndex)
+			return true;
+
+		//errs() << "node = " << node << ", collapseTgt = " << collapseTarget << "\n";
+		NodeIndex ctRep = nodeFactory.getMergeTarget(collapseTarget);
+		// Here we have to pay special attention to whether the node points-to itself.
+		bool mergeSelf = false;
+		// Collapsing into ctRep may change the set we are walking (ctRep can be node itself), so gather the nodes first and collapse them all at once
+		std::vector<NodeIndex> hcdNodes;
+		for (auto v: workSet)
+		{
+			NodeIndex vRep = nodeFactory.getMergeTarget(v);
+			if (vRep == node)
+				mergeSelf = true;
+			else
+				hcdNodes.push_back(vRep);
+		}
+		unsigned numMerged = collapseNodes(ctRep, hcdNodes, nodeFactory, ptsGraph, constraintGraph, diffPropGraph);
+		stats.hcdMerges += numMerged;
+		hcdThrottle.record(workSet.getSize(), numMerged);
+		// The collapsed nodes have forgotten what they propagated. Make sure ctRep gets to propagate the merged set
+		if (Config::diffProp && !workSet.isEmpty())
+			nextWorkList->enqueue(ctRep);
+
+		if (mergeSelf)
+		{
+			unsigned mergedSelf = collapseNodes(ctRep, node, nodeFactory, ptsGraph, constraintGraph, diffPropGraph);
+			stats.hcdMerges += mergedSelf;
+			hcdThrottle.record(0, mergedSelf);
+			// If the node collapsing succeeds, we can't proceed here because node no longer exists. Push ctRep to the worklist and proceed
+			if (ctRep != node)
+			{
+				nextWorkList->enqueue(ctRep);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Add the copy edges in complexEdges, and schedule what has to be propagated along the ones that are new. The edges are sorted and deduplicated first, so that each one is tried once however many elements of the set give rise to it, and each source is looked up in the constraint graph once
+	void insertComplexEdges()
+	{
+		std::sort(complexEdges.begin(), complexEdges.end());
+		complexEdges.erase(std::unique(complexEdges.begin(), complexEdges.end()), complexEdges.end());
+		newComplexEdges.clear();
+		constraintGraph.insertCopyEdges(complexEdges, newComplexEdges);
+		complexEdges.clear();
+
+		NumCopyEdgesAdded += newComplexEdges.size();
+		stats.copyEdges += newComplexEdges.size();
+		cycleSweeper.addNewEdges(newComplexEdges.size());
+		for (unsigned i = 0, e = newComplexEdges.size(); i < e; ++i)
+		{
+			NodeIndex src = newComplexEdges[i].first, dst = newComplexEdges[i].second;
+			//errs() << "\tInsert copy edge " << src << " -> " << dst << "\n";
+			if (!Config::diffProp)
+			{
+				// The whole set of src goes along its new edges when it is visited, so it is enqueued once
+				if (i == 0 || newComplexEdges[i - 1].first != src)
+					nextWorkList->enqueue(src);
+			}
+			else if (propagateAlongNewEdge(src, dst, ptsGraph, stats))
+				nextWorkList->enqueue(dst);
+		}
+	}
+
+	// Put into fieldSet the object offset fields after obj, or all the fields of its object for AnyField
+	void addFieldObjects(NodeIndex obj, unsigned offset, AndersPtsSet& fieldSet) const
+	{
+		if (offset != AndersFieldConstraint::AnyField)
+		{
+			fieldSet.insert(nodeFactory.getOffsetObjectNode(obj, offset));
+			return;
+		}
+		NodeIndex first = obj - nodeFactory.getFieldIndex(obj);
+		for (unsigned i = 0, e = nodeFactory.getNumFields(obj); i < e; ++i)
+			fieldSet.insert(first + i);
+	}
+
+	void visit(NodeIndex node, ConstraintGraphNode* cNode, const AndersPtsSet& ptsSet)
+	{
+		unsigned unionsBefore = stats.unions, copyEdgesBefore = stats.copyEdges;
+		// The elements we need to process in this visit: either the whole points-to set, or, with difference propagation, what has been added to it since the last visit
+		AndersPtsSet deltaSet;
+		if (Config::diffProp)
+		{
+			if (const AndersPtsSet* propSet = propGraph.find(node))
+				deltaSet.assignDifference(ptsSet, *propSet);
+			else
+				deltaSet = ptsSet;
+		}
+		const AndersPtsSet& workSet = Config::diffProp ? deltaSet : ptsSet;
+
+		if (Config::hcd && hcdThrottle.isEnabled() && !collapseOffline(node, workSet))
+			return;
+
+		// Nothing is merged during the rest of the visit, so the edges can be walked as they are once they point to representatives
+		cNode->canonicalizeEdges(nodeFactory);
+
+		// Check indirect constraints and add copy edge to the constraint graph if necessary
+		if (cNode->load_begin() != cNode->load_end() || cNode->store_begin() != cNode->store_end())
+		{
+			for (auto v: withNullObject(workSet))
+			{
+				NodeIndex vRep = nodeFactory.getMergeTarget(v);
+				for (auto const& dst: cNode->loads())
+				{
+					//errs() << "Examining load edge " << node << " -> " << dst << "\n";
+					complexEdges.push_back(std::make_pair(vRep, dst));
+				}
+				for (auto const& dst: cNode->stores())
+					complexEdges.push_back(std::make_pair(dst, vRep));
+			}
+			insertComplexEdges();
+		}
+
+		// The field edges step from each object to another field of it. They are not copy edges, so the cycle detectors never collapse them: a cycle through a positive offset (e.g. p = &p->next->next) only steps through the fields up to the last one of each object (see AndersNodeFactory::getOffsetObjectNode()), which bounds it
+		for (auto const& edge: cNode->fields())
+		{
+			AndersPtsSet fieldSet;
+			for (auto v: workSet)
+				addFieldObjects(v, edge.second, fieldSet);
+			if (workSet.hasNullObject())
+				fieldSet.insertNullObject();
+			// The target may be node itself, whose set is only changed once it has been read
+			NodeIndex tgtNode = nodeFactory.getMergeTarget(edge.first);
+			++stats.unions;
+			if (unionPtsSets(ptsGraph[tgtNode], fieldSet))
+			{
+				++stats.changedUnions;
+				nextWorkList->enqueue(tgtNode);
+			}
+		}
+
+		// Finally, it's time to propagate pts-to info along the copy edges. A hub leaves its idle successors to flushHubs(), which gives each of them the whole set at once however many times the hub changes until then
+		bool isHub = hubDegree != 0 && cNode->getNumCopyEdges() >= hubDegree;
+		bool leftIdle = false;
+		for (auto tgtNode: *cNode)
+		{
+			if (node == tgtNode)
+				continue;
+			if (isHub)
+			{
+				const ConstraintGraphNode* tgtCNode = constraintGraph.getNodeWithIndex(tgtNode);
+				if (tgtCNode == nullptr || !tgtCNode->hasEdges())
+				{
+					leftIdle = true;
+					continue;
+				}
+			}
+			AndersPtsSet& tgtPtsSet = ptsGraph[tgtNode];
+
+			//errs() << "pts[" << tgtNode << "] |= pts[" << node << "]\n";
+			bool isChanged = unionPtsSets(tgtPtsSet, workSet);
+			++stats.unions;
+
+			if (isChanged)
+			{
+				++stats.changedUnions;
+				nextWorkList->enqueue(tgtNode);
+			}
+			else
+				// This is where we do lazy cycle detection
+				lazyCycles.checkEdge(cNode, tgtNode, ptsSet, tgtPtsSet, stats);
+		}
+
+		if (leftIdle && !pendingHubMarks.test(node))
+		{
+			pendingHubMarks.set(node);
+			pendingHubs.push_back(node);
+		}
+
+		if (nodeProfile != nullptr)
+		{
+			nodeProfile->recordUnions(node, stats.unions - unionsBefore, workSet.getSize());
+			nodeProfile->recordCopyEdges(node, stats.copyEdges - copyEdgesBefore);
+		}
+		if (Config::diffProp)
+			unionPtsSets(propGraph[node], deltaSet);
+	}
+	// Between two iterations, move the sets of the nodes that are not on the work list into the spill file if the sets take more than the limit. The nodes on the work list are those the iteration starts from; the others are read back as the propagation reaches them. The sets of difference propagation stay in memory
+	void spillColdSets()
+	{
+		if (spillFile == nullptr || ptsGraph.getMemoryUsage() <= std::uint64_t(OutOfCoreLimit) * 1024 * 1024)
+			return;
+		coldNodes.clear();
+		for (auto node: ptsGraph)
+			if (!ptsGraph.isSpilled(node) && !currWorkList->contains(node))
+				coldNodes.push_back(node);
+		unsigned numSpilled = spillFile->getNumSpilledSets();
+		std::string error;
+		if (spillFile->spill(ptsGraph, coldNodes, error))
+		{
+			NumSpilledSets += spillFile->getNumSpilledSets() - numSpilled;
+			return;
+		}
+		errs() << "Cannot spill the points-to sets: " << error << ". Keeping them in memory\n";
+		spillFile->readBackAll(ptsGraph);
+		spillFile.reset();
+	}
+
+	bool hasWork() const { return !currWorkList->isEmpty() || nextInBatch != batch.size(); }
+
+	// At a fixed point, make the copies the hubs have left: union the set of each pending hub into all its successors, idle or not, since a successor idle at one visit may have got edges since. The successors whose sets change go on workList. Return true if any did
+	bool flushHubs(AndersWorkList& workList)
+	{
+		bool changed = false;
+		for (auto hub: pendingHubs)
+		{
+			pendingHubMarks.reset(hub);
+			NodeIndex rep = nodeFactory.getMergeTarget(hub);
+			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(rep);
+			const AndersPtsSet* hubPtsSet = ptsGraph.find(rep);
+			if (cNode == nullptr || hubPtsSet == nullptr)
+				continue;
+			++NumHubFlushes;
+			cNode->canonicalizeEdges(nodeFactory);
+			for (auto tgtNode: *cNode)
+			{
+				if (tgtNode == rep)
+					continue;
+				++stats.unions;
+				if (unionPtsSets(ptsGraph[tgtNode], *hubPtsSet))
+				{
+					++stats.changedUnions;
+					workList.enqueue(tgtNode);
+					changed = true;
+				}
+			}
+		}
+		pendingHubs.clear();
+		return changed;
+	}
+
+	// Take the next node to visit. With a batch size above 1, the work list is drained batchSize nodes at a time, and the representative, the constraint graph node and the points-to set of each node of the batch are looked up before the first one is visited. The lookups of different nodes don't depend on each other, so their cache misses overlap instead of stalling each visit in turn, and the prefetches bring in the edges and the set heads the visits start from. The visits look everything up again, since a visit may merge the nodes after it, and then hit the cache
+	// The nodes are visited in the order they come off the work list either way: the visits only ever add to the next work list
+	NodeIndex takeNode()
+	{
+		if (batchSize == 1)
+			return currWorkList->dequeue();
+		if (nextInBatch == batch.size())
+		{
+			batch.clear();
+			nextInBatch = 0;
+			while (batch.size() < batchSize && !currWorkList->isEmpty())
+				batch.push_back(currWorkList->dequeue());
+			for (auto node: batch)
+			{
+				NodeIndex rep = nodeFactory.getMergeTarget(node);
+				if (const ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(rep))
+					__builtin_prefetch(cNode);
+				if (const AndersPtsSet* ptsSet = ptsGraph.find(rep))
+					__builtin_prefetch(ptsSet);
+			}
+		}
+		return batch[nextInBatch++];
+	}
+
+public:
+	// offlineInfo is only used, and must only be non-null, under HCD. typeFilter is null unless the points-to sets are filtered by type, checkpointer unless the solving is checkpointed or resumed, and profile unless the hot nodes are reported. late are the nodes that atFixedPoint may add copy edges into
+	WorkListSolver(AndersNodeFactory& n, AndersPtsGraph& p, ConstraintGraph& c, const OfflineCycleDetector* o, const AndersTypeFilter* t, SolverCheckpointer* cp, SolverNodeProfile* profile, ArrayRef<NodeIndex> late, AndersWorkListOrder& order): nodeFactory(n), ptsGraph(p), constraintGraph(c), offlineInfo(o), typeFilter(t), checkpointer(cp), nodeProfile(profile), lateCopyTargets(late), workList1(order), workList2(order), currWorkList(&workList1), nextWorkList(&workList2), workListOrder(order), diffPropGraph(Config::diffProp ? &propGraph : nullptr), lazyCycles(n, c, p, diffPropGraph), cycleSweeper(n, c, p, SCCSweepInterval, diffPropGraph), batchSize(std::max<unsigned>(WorkListBatchSize, 1))
+	{
+		assert(!Config::hcd || offlineInfo != nullptr);
+		// A checkpoint only has the sets and the work list, not the copies the hubs have left
+		hubDegree = checkpointer == nullptr ? HubCopyDegree : 0;
+		if (hubDegree != 0)
+			pendingHubMarks.resize(n.getNumNodes());
+		if (Config::diffProp)
+			propGraph.resize(n.getNumNodes());
+		if (!OutOfCoreDir.empty())
+		{
+			std::string error;
+			spillFile = PtsSetSpillFile::create(OutOfCoreDir, error);
+			if (!spillFile)
+				errs() << "Cannot spill the points-to sets: " << error << ". Keeping them in memory\n";
+		}
+	}
+
+	// trace is null unless -anders-trace is given. presolved is true if CopyPreSolver has run. Return false if the budget runs out before the fixed point, with the nodes left to process in pendingNodes
+	bool run(const FixedPointHook& atFixedPoint, SolverBudget& budget, SolverTrace* trace, bool presolved, std::vector<NodeIndex>& pendingNodes)
+	{
+		// Scan the node list, add it to work list if the node a representative and can contribute to the calculation right now. A resumed solving has nothing left to do but the work list of its checkpoint
+		if (checkpointer != nullptr && checkpointer->isResumed())
+		{
+			for (auto node: checkpointer->getResumedWorkList())
+				currWorkList->enqueue(nodeFactory.getMergeTarget(node));
+		}
+		else
+		{
+			for (auto node: ptsGraph)
+			{
+				if (nodeFactory.getMergeTarget(node) != node)
+					continue;
+				// After the pre-solving, the copy edges hold already, and only the other edges have something to add
+				const ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+				if (cNode != nullptr && (!presolved || cNode->load_begin() != cNode->load_end() || cNode->store_begin() != cNode->store_end() || !cNode->fields().empty()))
+					currWorkList->enqueue(node);
+			}
+		}
+
+		OnlineEquivalenceDetector equivDetector(nodeFactory, constraintGraph, ptsGraph, lateCopyTargets, diffPropGraph);
+		bool outOfBudget = false;
+		while (!outOfBudget && (hasWork() || flushHubs(*currWorkList) || resumeWorkList(atFixedPoint, *currWorkList)))
+		{
+			// Iteration begins
+			unsigned workListSize = currWorkList->getSize();
+			if (checkpointer != nullptr)
+				checkpointer->checkpoint(nodeFactory, ptsGraph, constraintGraph, *currWorkList);
+			spillColdSets();
+
+			// First we've got to check if there is any cycle candidates in the last iteration. If there is, detect and collapse cycle
+			lazyCycles.collapseCycles(Config::diffProp ? currWorkList : nullptr, stats);
+			stats.cycleCollapses += cycleSweeper.run(*currWorkList);
+
+			// Merge the nodes that have become equivalent
+			if (EnableOnlineEquiv)
+			{
+				equivDetector.setWorkList(Config::diffProp ? currWorkList : nullptr);
+				stats.equivMerges += equivDetector.run(*currWorkList);
+			}
+
+			while (hasWork())
+			{
+				if (budget.poll())
+				{
+					outOfBudget = true;
+					break;
+				}
+
+				NodeIndex node = takeNode();
+				++NumWorkListPops;
+				++stats.workListPops;
+				node = nodeFactory.getMergeTarget(node);
+				workListOrder.fire(node);
+				//errs() << "Examining node " << node << "\n";
+
+				ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+				if (cNode == nullptr)
+					continue;
+				if (AndersPtsSet* nodePtsSet = ptsGraph.find(node))
+				{
+					// Whatever reaches a filtered node is filtered before it goes any further. The objects it drops may have gone through new edges already (see propagateAlongNewEdge()), which only costs precision
+					if (typeFilter != nullptr)
+						NumTypeFilteredObjs += typeFilter->filter(nodeFactory, node, *nodePtsSet);
+					if (nodeProfile != nullptr)
+						nodeProfile->recordVisit(node);
+					visit(node, cNode, *nodePtsSet);
+				}
+			}
+			if (Config::hcd)
+				hcdThrottle.endIteration();
+			budget.endIteration(workListSize, stats);
+			if (trace != nullptr)
+				trace->endIteration(stats, workListSize, nextWorkList->getSize(), ptsGraph);
+			else
+				stats = SolverIterationStats();
+			// Swap the current and the next worklist
+			std::swap(currWorkList, nextWorkList);
+		}
+
+		// The rest of the analysis only sees the sets in memory
+		if (spillFile != nullptr)
+			spillFile->readBackAll(ptsGraph);
+		if (!outOfBudget)
+			return true;
+		// The successors the hubs have left get what they missed, and are not finished either if that changes them
+		flushHubs(*nextWorkList);
+		pendingNodes.insert(pendingNodes.end(), batch.begin() + nextInBatch, batch.end());
+		for (auto workList: { currWorkList, nextWorkList })
+			while (!workList->isEmpty())
+				pendingNodes.push_back(workList->dequeue());
+		return false;
+	}
+};
+
+template <typename Config>
+bool runWorkListSolver(AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, ConstraintGraph& constraintGraph, const OfflineCycleDetector* offlineInfo, const AndersTypeFilter* typeFilter, SolverCheckpointer* checkpointer, SolverNodeProfile* nodeProfile, ArrayRef<NodeIndex> lateCopyTargets, AndersWorkListOrder& workListOrder, const FixedPointHook& atFixedPoint, SolverBudget& budget, SolverTrace* trace, bool presolved, std::vector<NodeIndex>& pendingNodes)
+{
+	WorkListSolver<Config> solver(nodeFactory, ptsGraph, constraintGraph, offlineInfo, typeFilter, checkpointer, nodeProfile, lateCopyTargets, workListOrder);
+	return solver.run(atFixedPoint, budget, trace, presolved, pendingNodes);
+}
+
+typedef bool (*WorkListSolverEntry)(AndersNodeFactory&, AndersPtsGraph&, ConstraintGraph&, const OfflineCycleDetector*, const AndersTypeFilter*, SolverCheckpointer*, SolverNodeProfile*, ArrayRef<NodeIndex>, AndersWorkListOrder&, const FixedPointHook&, SolverBudget&, SolverTrace*, bool, std::vector<NodeIndex>&);
+
+// The instantiation of WorkListSolver for the options given on the command line
+WorkListSolverEntry getWorkListSolver()
+{
+	static const WorkListSolverEntry entries[] = {
+		runWorkListSolver<WorkListSolverConfig<false, false, false>>,
+		runWorkListSolver<WorkListSolverConfig<false, false, true>>,
+		runWorkListSolver<WorkListSolverConfig<false, true, false>>,
+		runWorkListSolver<WorkListSolverConfig<false, true, true>>,
+		runWorkListSolver<WorkListSolverConfig<true, false, false>>,
+		runWorkListSolver<WorkListSolverConfig<true, false, true>>,
+		runWorkListSolver<WorkListSolverConfig<true, true, false>>,
+		runWorkListSolver<WorkListSolverConfig<true, true, true>>,
+	};
+	return entries[(EnableHCD ? 4 : 0) | (EnableLCD ? 2 : 0) | (EnableDiffProp ? 1 : 0)];
+}
+
+// The multi-threaded counterpart of WorkListSolver
+// Instead of visiting one node at a time, each round takes the whole current work list as a batch and processes it in four parallel phases separated by joins. Work is split by ownership: the thread that owns a node (node % numThreads) is the only one allowed to write its copy edges or its points-to set within a phase, so no locks are needed. Everything that changes the shape of the graph (HCD/LCD collapsing, creating constraint graph nodes, growing the work list) happens sequentially between phases
+// With -anders-pull-propagation, the copy edges are also kept at their targets (see ConstraintGraph::keepPredecessors()), and phases 3 and 4 become a single pull phase. Phase 1 takes the part of the set of each batch node it hasn't propagated yet, as difference propagation does, and the thread that owns a copy successor of a batch node unions into its set the new parts of its predecessors in the batch. A set is only ever written by its owner, and what it reads was fixed in phase 1, so there is no pending set to build and commit, and the whole sets are not copied across the threads
+class ParallelSolver
+{
+private:
+	typedef std::pair<NodeIndex, NodeIndex> Edge;
+
+	// Batches smaller than this are processed by the calling thread alone: spawning the workers would cost more than the work itself
+	static const unsigned MinParallelBatchSize = 1024;
+	// The number of batch nodes a thread grabs at a time in the scanning phase
+	static const unsigned ScanChunkSize = 64;
+
+	// The buffers each thread fills during a round. Those indexed by owner are read by the owning thread in the next phase
+	struct ThreadState
+	{
+		// New copy edges (src, dst), indexed by the owner of src
+		std::vector<std::vector<Edge>> newEdges;
+		// Copy edges (dst, src) to propagate along, indexed by the owner of dst
+		std::vector<std::vector<Edge>> copyPairs;
+		// Sources of new copy edges that do not have a constraint graph node yet
+		std::vector<NodeIndex> missingNodes;
+		// What this thread is going to add to the points-to sets of the nodes it owns
+		DenseMap<NodeIndex, AndersPtsSet> pending;
+		// Nodes to put into the next work list
+		std::vector<NodeIndex> nextNodes;
+		// LCD cycle candidate edges
+		std::vector<Edge> candidateEdges;
+		// Pull propagation: the copy successors of the batch nodes, indexed by their owner
+		std::vector<std::vector<NodeIndex>> scheduled;
+		// The number of copy edges this thread has inserted, of the unions into its pending sets, and of the pending sets that changed the points-to sets they were committed to. They are added to the statistics at the end of a round
+		unsigned numNewEdges = 0;
+		unsigned numUnions = 0;
+		unsigned numChangedUnions = 0;
+
+		ThreadState(unsigned numThreads): newEdges(numThreads), copyPairs(numThreads), scheduled(numThreads) {}
+	};
+
+	AndersNodeFactory& nodeFactory;
+	AndersPtsGraph& ptsGraph;
+	ConstraintGraph& constraintGraph;
+	// Only used by HCD
+	const OfflineCycleDetector* offlineInfo;
+	// Only used by -enable-online-equiv
+	ArrayRef<NodeIndex> lateCopyTargets;
+	AndersWorkListOrder& workListOrder;
+	unsigned numThreads;
+
+	AndersWorkList workList1, workList2;
+	AndersWorkList *currWorkList, *nextWorkList;
+	DenseSet<NodeIndex> cycleCandidates;
+	// Only used by LCD and HCD
+	CycleDetectionThrottle lcdThrottle, hcdThrottle;
+	// Only used by pull propagation: the part of each node's points-to set that has been pulled by its successors already, the new parts of the sets of the batch nodes in batch order, and the position of each node in the batch (NotInBatch for the others). diffPropGraph points to propGraph under pull propagation and is null otherwise
+	AndersPtsGraph propGraph;
+	AndersPtsGraph* diffPropGraph;
+	std::vector<AndersPtsSet> deltas;
+	std::vector<unsigned> batchIndex;
+	enum: unsigned { NotInBatch = ~0u };
+	PeriodicCycleSweeper cycleSweeper;
+
+	std::vector<ThreadState> threadStates;
+	std::vector<NodeIndex> batch;
+	llvm::BitVector inBatch;
+	// The nodes are sharded among the threads by index range (see getOwner())
+	unsigned shardSize;
+
+	SolverIterationStats stats;
+
+	// Each thread owns a contiguous range of node indices rather than every numActive-th node, so that the sets and the edges a thread writes in phases 2 to 4 are close together, are allocated by that thread and stay in the memory of its socket under the first-touch policy, instead of sharing cache lines and pages with those of the other threads
+	unsigned getOwner(NodeIndex n, unsigned numActive) const
+	{
+		return numActive == 1 ? 0 : std::min(n / shardSize, numActive - 1);
+	}
+
+	// Drain the current work list into the batch. This is also where we perform online HCD, in the same way as the sequential solver
+	void buildBatch()
+	{
+		std::vector<NodeIndex> visited;
+		while (!currWorkList->isEmpty())
+		{
+			NodeIndex node = nodeFactory.getMergeTarget(currWorkList->dequeue());
+			++NumWorkListPops;
+			workListOrder.fire(node);
+			if (constraintGraph.getNodeWithIndex(node) == nullptr || !ptsGraph.count(node))
+				continue;
+
+			if (EnableHCD && hcdThrottle.isEnabled())
+			{
+				NodeIndex collapseTarget = offlineInfo->getCollapseTarget(node);
+				if (collapseTarget != AndersNodeFactory::InvalidIndex)
+				{
+					NodeIndex ctRep = nodeFactory.getMergeTarget(collapseTarget);
+					// Collapsing may change the set of node, so gather the nodes first and collapse them all at once
+					bool mergeSelf = false;
+					std::vector<NodeIndex> hcdNodes;
+					for (auto v: *ptsGraph.find(node))
+					{
+						NodeIndex vRep = nodeFactory.getMergeTarget(v);
+						if (vRep == node)
+							mergeSelf = true;
+						else
+							hcdNodes.push_back(vRep);
+					}
+					unsigned numMerged = collapseNodes(ctRep, hcdNodes, nodeFactory, ptsGraph, constraintGraph, diffPropGraph);
+					// Under pull propagation, the collapsed nodes have forgotten what they propagated
+					if (diffPropGraph != nullptr && !hcdNodes.empty())
+						nextWorkList->enqueue(ctRep);
+
+					if (mergeSelf)
+						numMerged += collapseNodes(ctRep, node, nodeFactory, ptsGraph, constraintGraph, diffPropGraph);
+					stats.hcdMerges += numMerged;
+					hcdThrottle.record(hcdNodes.size() + mergeSelf, numMerged);
+					if (mergeSelf)
+					{
+						if (ctRep != node)
+						{
+							nextWorkList->enqueue(ctRep);
+							continue;
+						}
+					}
+				}
+			}
+			visited.push_back(node);
+		}
+
+		// HCD may have merged some of the nodes we have already visited
+		batch.clear();
+		for (auto node: visited)
+		{
+			node = nodeFactory.getMergeTarget(node);
+			if (inBatch.test(node))
+				continue;
+			if (constraintGraph.getNodeWithIndex(node) == nullptr || !ptsGraph.count(node))
+				continue;
+			inBatch.set(node);
+			batch.push_back(node);
+		}
+		for (auto node: batch)
+			inBatch.reset(node);
+	}
+
+	// Phase 1 (for a single batch node): canonicalize the edges of node, then record the copy edges its complex constraints give rise to and the propagations along its copy edges. Only node's own edges are written, and under pull propagation its propagated set and its new part
+	void scanNode(NodeIndex node, ThreadState& state, unsigned numActive)
+	{
+		const AndersNodeFactory& factory = nodeFactory;
+		const ConstraintGraph& graph = constraintGraph;
+		ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+		const AndersPtsSet& ptsSet = *ptsGraph.find(node);
+		bool pull = diffPropGraph != nullptr;
+
+		// Under pull propagation, the loads, the stores and the successors of node only have to see what it has got since its last visit
+		const AndersPtsSet* workSet = &ptsSet;
+		if (pull)
+		{
+			AndersPtsSet& delta = deltas[batchIndex[node]];
+			AndersPtsSet& propSet = *propGraph.find(node);
+			delta.assignDifference(ptsSet, propSet);
+			unionPtsSets(propSet, delta);
+			workSet = &delta;
+		}
+
+		cNode->canonicalizeEdges(factory);
+		for (auto const& dst: cNode->stores())
+		{
+			if (graph.getNodeWithIndex(dst) == nullptr)
+				state.missingNodes.push_back(dst);
+		}
+		// The targets of the new edges need a node too, to record their predecessor edges
+		if (pull)
+		{
+			for (auto const& dst: cNode->loads())
+			{
+				if (graph.getNodeWithIndex(dst) == nullptr)
+					state.missingNodes.push_back(dst);
+			}
+		}
+
+		bool hasLoads = cNode->load_begin() != cNode->load_end();
+		bool hasStores = cNode->store_begin() != cNode->store_end();
+		for (auto v: withNullObject(*workSet))
+		{
+			NodeIndex vRep = factory.getMergeTarget(v);
+			if ((hasLoads || (pull && hasStores)) && graph.getNodeWithIndex(vRep) == nullptr)
+				state.missingNodes.push_back(vRep);
+			if (hasLoads)
+			{
+				auto& edges = state.newEdges[getOwner(vRep, numActive)];
+				for (auto const& dst: cNode->loads())
+					edges.push_back(std::make_pair(vRep, dst));
+			}
+			for (auto const& dst: cNode->stores())
+				state.newEdges[getOwner(dst, numActive)].push_back(std::make_pair(dst, vRep));
+		}
+
+		for (auto tgtNode: *cNode)
+		{
+			if (tgtNode == node)
+				continue;
+			if (pull)
+				state.scheduled[getOwner(tgtNode, numActive)].push_back(tgtNode);
+			else
+				state.copyPairs[getOwner(tgtNode, numActive)].push_back(std::make_pair(tgtNode, node));
+		}
+	}
+
+	// Pull propagation (for a single scheduled node): union into the set of node the new parts of its predecessors in the batch. The calling thread owns node, and is the only one to write its set and its edges in this phase
+	void pullIntoNode(NodeIndex node, ThreadState& state)
+	{
+		ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+		cNode->canonicalizePredEdges(nodeFactory);
+		AndersPtsSet& ptsSet = *ptsGraph.find(node);
+		bool isChanged = false;
+		for (auto pred: cNode->preds())
+		{
+			if (pred == node || batchIndex[pred] == NotInBatch)
+				continue;
+			++state.numUnions;
+			if (unionPtsSets(ptsSet, deltas[batchIndex[pred]]))
+			{
+				++state.numChangedUnions;
+				isChanged = true;
+			}
+			else if (EnableLCD && lcdThrottle.isEnabled() && *propGraph.find(pred) == ptsSet)
+				state.candidateEdges.push_back(std::make_pair(pred, node));
+		}
+		if (isChanged)
+			state.nextNodes.push_back(node);
+	}
+
+	// Phases 3 and 4 under pull propagation. The new copy edges are in copyPairs, as (dst, src) pairs indexed by the owner of dst: dst records src as a predecessor and catches up with what src has propagated so far (see propagateAlongNewEdge()). src is on the next work list, and the rest of its set will be pulled through the new predecessor edge
+	void pullBatch(unsigned numActive)
+	{
+		// Creating a set flips a bit in the presence bitmap of ptsGraph that neighbouring nodes share, so do it before going parallel
+		for (unsigned tid = 0; tid < numActive; ++tid)
+		{
+			for (unsigned owner = 0; owner < numActive; ++owner)
+			{
+				for (auto node: threadStates[tid].scheduled[owner])
+					ptsGraph[node];
+				for (auto const& pair: threadStates[tid].copyPairs[owner])
+					ptsGraph[pair.first];
+			}
+		}
+
+		runOnThreads(numActive, [this, numActive] (unsigned tid)
+		{
+			ThreadState& mine = threadStates[tid];
+			std::vector<NodeIndex> nodes;
+			for (unsigned from = 0; from < numActive; ++from)
+			{
+				auto& scheduled = threadStates[from].scheduled[tid];
+				nodes.insert(nodes.end(), scheduled.begin(), scheduled.end());
+			}
+			std::sort(nodes.begin(), nodes.end());
+			nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+			for (auto node: nodes)
+				pullIntoNode(node, mine);
+
+			for (unsigned from = 0; from < numActive; ++from)
+			{
+				for (auto const& pair: threadStates[from].copyPairs[tid])
+				{
+					NodeIndex dst = pair.first, src = pair.second;
+					constraintGraph.insertPredEdge(dst, src);
+					const AndersPtsSet* propSet = propGraph.find(src);
+					if (propSet == nullptr)
+						continue;
+					++mine.numUnions;
+					if (unionPtsSets(*ptsGraph.find(dst), *propSet))
+					{
+						++mine.numChangedUnions;
+						mine.nextNodes.push_back(dst);
+					}
+				}
+			}
+		});
+
+		for (unsigned tid = 0; tid < numActive; ++tid)
+		{
+			for (unsigned owner = 0; owner < numActive; ++owner)
+			{
+				threadStates[tid].scheduled[owner].clear();
+				threadStates[tid].copyPairs[owner].clear();
+			}
+		}
+		for (auto node: batch)
+			batchIndex[node] = NotInBatch;
+	}
+
+	void solveBatch()
+	{
+		unsigned numActive = batch.size() >= MinParallelBatchSize ? numThreads : 1;
+
+		// Phase 1: scan the batch nodes. The batch is grouped by shard, and each thread starts with the nodes of its own shard, whose edges it is about to write. Node degrees vary wildly, so the threads grab chunks dynamically, and a thread done with its shard goes on with the chunks left in the others
+		std::vector<unsigned> shardBegin(numActive + 1, 0);
+		if (numActive > 1)
+		{
+			for (auto node: batch)
+				++shardBegin[getOwner(node, numActive) + 1];
+			for (unsigned shard = 0; shard < numActive; ++shard)
+				shardBegin[shard + 1] += shardBegin[shard];
+			std::vector<unsigned> fill(shardBegin.begin(), shardBegin.end() - 1);
+			std::vector<NodeIndex> sharded(batch.size());
+			for (auto node: batch)
+				sharded[fill[getOwner(node, numActive)]++] = node;
+			batch.swap(sharded);
+		}
+		else
+			shardBegin[1] = batch.size();
+		if (diffPropGraph != nullptr)
+		{
+			// The propagated sets the threads write have to exist before going parallel (see pullBatch())
+			deltas.resize(batch.size());
+			for (unsigned i = 0, e = batch.size(); i < e; ++i)
+			{
+				batchIndex[batch[i]] = i;
+				propGraph[batch[i]];
+			}
+		}
+		std::unique_ptr<std::atomic<unsigned>[]> nextChunk(new std::atomic<unsigned>[numActive]);
+		for (unsigned shard = 0; shard < numActive; ++shard)
+			nextChunk[shard] = shardBegin[shard];
+		runOnThreads(numActive, [this, numActive, &shardBegin, &nextChunk] (unsigned tid)
+		{
+			ThreadState& state = threadStates[tid];
+			for (unsigned i = 0; i < numActive; ++i)
+			{
+				unsigned shard = (tid + i) % numActive;
+				while (true)
+				{
+					unsigned begin = nextChunk[shard].fetch_add(ScanChunkSize);
+					if (begin >= shardBegin[shard + 1])
+						break;
+					unsigned end = std::min<unsigned>(begin + ScanChunkSize, shardBegin[shard + 1]);
+					for (unsigned j = begin; j < end; ++j)
+						scanNode(batch[j], state, numActive);
+				}
+			}
+		});
+
+		// New copy edges may start from nodes that are not in the constraint graph yet. Create them here so that phase 2 never changes the shape of the node map
+		for (unsigned tid = 0; tid < numActive; ++tid)
+		{
+			for (auto node: threadStates[tid].missingNodes)
+				constraintGraph.getOrInsertNode(node);
+			threadStates[tid].missingNodes.clear();
+		}
+
+		// Phase 2: each thread inserts the new copy edges leaving the nodes it owns. As in the sequential solver, the source of a new edge goes to the next work list. Under pull propagation, the new edges are also handed to the owners of their targets (see pullBatch())
+		runOnThreads(numActive, [this, numActive] (unsigned tid)
+		{
+			ThreadState& mine = threadStates[tid];
+			for (unsigned from = 0; from < numActive; ++from)
+			{
+				auto& edges = threadStates[from].newEdges[tid];
+				for (auto const& edge: edges)
+				{
+					if (diffPropGraph != nullptr)
+					{
+						if (constraintGraph.insertSuccEdge(edge.first, edge.second))
+						{
+							mine.nextNodes.push_back(edge.first);
+							++mine.numNewEdges;
+							if (edge.first != edge.second)
+								mine.copyPairs[getOwner(edge.second, numActive)].push_back(std::make_pair(edge.second, edge.first));
+						}
+					}
+					else if (constraintGraph.insertCopyEdge(edge.first, edge.second))
+					{
+						mine.nextNodes.push_back(edge.first);
+						++mine.numNewEdges;
+					}
+				}
+			}
+		});
+		for (unsigned tid = 0; tid < numActive; ++tid)
+			for (unsigned owner = 0; owner < numActive; ++owner)
+				threadStates[tid].newEdges[owner].clear();
+
+		if (diffPropGraph != nullptr)
+			pullBatch(numActive);
+		else
+		{
+			// Phase 3: each thread collects what flows into the nodes it owns. Nobody writes a points-to set here, so the sets can be read freely
+			runOnThreads(numActive, [this, numActive] (unsigned tid)
+			{
+				ThreadState& mine = threadStates[tid];
+				for (unsigned from = 0; from < numActive; ++from)
+				{
+					for (auto const& pair: threadStates[from].copyPairs[tid])
+					{
+						NodeIndex tgtNode = pair.first, srcNode = pair.second;
+						const AndersPtsSet& srcPtsSet = *ptsGraph.find(srcNode);
+						const AndersPtsSet* tgtPtsSet = ptsGraph.find(tgtNode);
+						// A top set absorbs whatever flows into it
+						if (usesTopSets() && tgtPtsSet != nullptr && tgtPtsSet->has(AndersNodeFactory::UniversalObjIndex))
+							continue;
+						if (EnableLCD && lcdThrottle.isEnabled() && tgtPtsSet != nullptr && srcPtsSet == *tgtPtsSet)
+						{
+							// Equal sets: nothing to propagate, but this edge may be on a cycle. Whether it has been checked before is left to the sequential part
+							mine.candidateEdges.push_back(std::make_pair(srcNode, tgtNode));
+							continue;
+						}
+						unionPtsSets(mine.pending[tgtNode], srcPtsSet);
+						++mine.numUnions;
+					}
+				}
+			});
+			for (unsigned tid = 0; tid < numActive; ++tid)
+			{
+				for (unsigned owner = 0; owner < numActive; ++owner)
+					threadStates[tid].copyPairs[owner].clear();
+				// Creating a set flips a bit in the presence bitmap of ptsGraph that neighbouring nodes share, so do it before going parallel again
+				for (auto const& mapping: threadStates[tid].pending)
+					ptsGraph[mapping.first];
+			}
+
+			// Phase 4: each thread commits its pending sets
+			runOnThreads(numActive, [this] (unsigned tid)
+			{
+				ThreadState& mine = threadStates[tid];
+				for (auto const& mapping: mine.pending)
+				{
+					if (unionPtsSets(*ptsGraph.find(mapping.first), mapping.second))
+					{
+						mine.nextNodes.push_back(mapping.first);
+						++mine.numChangedUnions;
+					}
+				}
+				mine.pending.clear();
+			});
+		}
+
+		for (unsigned tid = 0; tid < numActive; ++tid)
+		{
+			ThreadState& state = threadStates[tid];
+			for (auto node: state.nextNodes)
+				nextWorkList->enqueue(node);
+			state.nextNodes.clear();
+			NumCopyEdgesAdded += state.numNewEdges;
+			stats.copyEdges += state.numNewEdges;
+			cycleSweeper.addNewEdges(state.numNewEdges);
+			stats.unions += state.numUnions;
+			stats.changedUnions += state.numChangedUnions;
+			state.numNewEdges = state.numUnions = state.numChangedUnions = 0;
+			for (auto const& edge: state.candidateEdges)
+			{
+				if (constraintGraph.getNodeWithIndex(edge.first)->markCopyEdgeChecked(edge.second) && cycleCandidates.insert(edge.second).second)
+					++stats.lcdCandidates;
+			}
+			state.candidateEdges.clear();
+		}
+	}
+public:
+	ParallelSolver(AndersNodeFactory& n, AndersPtsGraph& p, ConstraintGraph& c, const OfflineCycleDetector* o, ArrayRef<NodeIndex> late, AndersWorkListOrder& order, unsigned t): nodeFactory(n), ptsGraph(p), constraintGraph(c), offlineInfo(o), lateCopyTargets(late), workListOrder(order), numThreads(t), workList1(order), workList2(order), currWorkList(&workList1), nextWorkList(&workList2), diffPropGraph(EnablePullPropagation ? &propGraph : nullptr), batchIndex(EnablePullPropagation ? n.getNumNodes() : 0, NotInBatch), cycleSweeper(n, c, p, SCCSweepInterval, diffPropGraph), threadStates(t, ThreadState(t)), inBatch(n.getNumNodes()), shardSize(std::max(1u, (n.getNumNodes() + t - 1) / t))
+	{
+		if (diffPropGraph != nullptr)
+			propGraph.resize(n.getNumNodes());
+	}
+
+	// trace is null unless -anders-trace is given. Return false if the budget runs out before the fixed point, with the nodes left to process in pendingNodes
+	bool run(const FixedPointHook& atFixedPoint, SolverBudget& budget, SolverTrace* trace, std::vector<NodeIndex>& pendingNodes)
+	{
+		if (diffPropGraph != nullptr)
+			constraintGraph.keepPredecessors(nodeFactory);
+		for (auto node: ptsGraph)
+		{
+			if (nodeFactory.getMergeTarget(node) == node && constraintGraph.getNodeWithIndex(node) != nullptr)
+				currWorkList->enqueue(node);
+		}
+
+		OnlineCycleDetector cycleDetector(nodeFactory, constraintGraph, ptsGraph, cycleCandidates, diffPropGraph);
+		OnlineEquivalenceDetector equivDetector(nodeFactory, constraintGraph, ptsGraph, lateCopyTargets, diffPropGraph);
+		while (!currWorkList->isEmpty() || resumeWorkList(atFixedPoint, *currWorkList))
+		{
+			// A round can't be interrupted halfway, so the budget is checked between rounds
+			if (budget.check())
+			{
+				while (!currWorkList->isEmpty())
+					pendingNodes.push_back(currWorkList->dequeue());
+				constraintGraph.dropPredecessors();
+				return false;
+			}
+
+			unsigned workListSize = currWorkList->getSize();
+			// Under pull propagation, the merged nodes have to propagate their whole sets again
+			AndersWorkList* mergedWorkList = diffPropGraph != nullptr ? currWorkList : nullptr;
+			if (EnableLCD && !cycleCandidates.empty())
+			{
+				cycleDetector.setWorkList(mergedWorkList);
+				unsigned numCollapsed = cycleDetector.run();
+				stats.cycleCollapses += numCollapsed;
+				lcdThrottle.record(cycleDetector.getNumVisited(), numCollapsed);
+				cycleCandidates.clear();
+			}
+			lcdThrottle.endIteration();
+			hcdThrottle.endIteration();
+			stats.cycleCollapses += cycleSweeper.run(*currWorkList);
+			if (EnableOnlineEquiv)
+			{
+				equivDetector.setWorkList(mergedWorkList);
+				stats.equivMerges += equivDetector.run(*currWorkList);
+			}
+
+			buildBatch();
+			solveBatch();
+			stats.workListPops += workListSize;
+			budget.endIteration(workListSize, stats);
+			if (trace != nullptr)
+				trace->endIteration(stats, workListSize, nextWorkList->getSize(), ptsGraph);
+			else
+				stats = SolverIterationStats();
+			std::swap(currWorkList, nextWorkList);
+		}
+		constraintGraph.dropPredecessors();
+		return true;
+	}
+};
+
+// The solver described in "Wave Propagation and Deep Propagation for Pointer Analysis. In Code Generation and Optimization (CGO), March 2009." It repeats three phases until no new copy edge shows up:
+// 1. Collapse all SCCs of the copy-edge graph and compute a topological order of what remains
+// 2. Sweep the nodes once in that order, pushing to the copy successors of each node the difference between its points-to set and what it has already propagated. Since the graph is acyclic, a single sweep reaches the fixed point of the copy edges
+// 3. Resolve load/store constraints against the part of each points-to set they have not seen yet, adding copy edges. The already propagated part of the source of a new edge is pushed along it immediately; the rest is left to the next sweep
+// With -anders-threads, phases 2 and 3 are bulk operations over many independent sets, and they run on that many threads (see propagateInParallel() and resolveComplexConstraintsInParallel())
+class WaveSolver
+{
+private:
+	// Levels of the sweep and resolutions with fewer nodes than this are done by the calling thread alone: spawning the workers would cost more than the work itself
+	static const unsigned MinParallelSize = 1024;
+	// The position in the sweep of a node the DFS has not reached
+	enum: unsigned { NoPosition = ~0u };
+
+	// Phase 1
+	class WaveCycleDetector: public CycleDetector<WaveCycleDetector, ConstraintGraph>
+	{
+	private:
+		friend class CycleDetector<WaveCycleDetector, ConstraintGraph>;
+
+		WaveSolver& solver;
+		// Tarjan's algorithm finds the SCC reps in reverse topological order
+		std::vector<NodeIndex> topoOrder;
+		// The pairs of <rep, cycle node> to collapse. We don't merge the nodes immediately to avoid affecting the DFS
+		std::vector<std::pair<NodeIndex, NodeIndex>> mergePairs;
+
+		NodeType* getRep(NodeIndex idx)
+		{
+			return solver.constraintGraph.getOrInsertNode(solver.nodeFactory.getMergeTarget(idx));
+		}
+		void processNodeOnCycle(const NodeType* node, const NodeType* repNode)
+		{
+			mergePairs.push_back(std::make_pair(repNode->getNodeIndex(), node->getNodeIndex()));
+		}
+		void processCycleRepNode(const NodeType* node)
+		{
+			topoOrder.push_back(node->getNodeIndex());
+		}
+	public:
+		WaveCycleDetector(WaveSolver& s): solver(s) {}
+
+		void run()
+		{
+			runOnGraph(&solver.constraintGraph);
+			releaseSCCMemory();
+
+			for (auto const& mapping: mergePairs)
+			{
+				NodeIndex repIdx = solver.nodeFactory.getMergeTarget(mapping.first);
+				NodeIndex cycleIdx = solver.nodeFactory.getMergeTarget(mapping.second);
+				// The merged node has load/store edges that have never seen the other half of its points-to set
+				solver.complexGraph.erase(repIdx);
+				solver.complexGraph.erase(cycleIdx);
+				solver.stats.cycleCollapses += collapseNodes(repIdx, cycleIdx, solver.nodeFactory, solver.ptsGraph, solver.constraintGraph, &solver.propGraph);
+			}
+			std::reverse(topoOrder.begin(), topoOrder.end());
+		}
+
+		const std::vector<NodeIndex>& getTopologicalOrder() const { return topoOrder; }
+	};
+
+	AndersNodeFactory& nodeFactory;
+	AndersPtsGraph& ptsGraph;
+	ConstraintGraph& constraintGraph;
+	unsigned numThreads;
+	// For each node, the part of its points-to set that has been pushed along its copy edges (phase 2)
+	AndersPtsGraph propGraph;
+	// For each node, the part of its points-to set that its load/store edges have been resolved against (phase 3)
+	AndersPtsGraph complexGraph;
+
+	SolverIterationStats stats;
+
+	// Phase 2
+	void propagate(const std::vector<NodeIndex>& topoOrder)
+	{
+		for (auto node: topoOrder)
+		{
+			const AndersPtsSet* ptsSet = ptsGraph.find(node);
+			if (ptsSet == nullptr)
+				continue;
+
+			AndersPtsSet& propSet = propGraph[node];
+			AndersPtsSet deltaSet;
+			deltaSet.assignDifference(*ptsSet, propSet);
+			if (deltaSet.isEmpty())
+				continue;
+			unionPtsSets(propSet, deltaSet);
+
+			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+			cNode->canonicalizeEdges(nodeFactory);
+			for (auto tgtNode: *cNode)
+			{
+				if (tgtNode != node)
+				{
+					++stats.unions;
+					if (unionPtsSets(ptsGraph[tgtNode], deltaSet))
+						++stats.changedUnions;
+				}
+			}
+		}
+	}
+
+	// Phase 2 on several threads. The nodes are swept level by level, the level of a node being the length of the longest path to it, so that no edge joins two nodes of the same level. Rather than push its delta to its successors, each node of a level pulls the deltas of its predecessors, which are final by then, and so writes no set but its own. The unions are the same as those of propagate()
+	void propagateInParallel(const std::vector<NodeIndex>& topoOrder)
+	{
+		std::vector<unsigned> positions(nodeFactory.getNumNodes(), NoPosition);
+		for (unsigned i = 0, e = topoOrder.size(); i < e; ++i)
+			positions[topoOrder[i]] = i;
+		// The predecessors and the level of each position in topoOrder, and the edges to the nodes the DFS has not reached, which get their unions once the sweep is over
+		std::vector<std::vector<unsigned>> preds(topoOrder.size());
+		std::vector<unsigned> levels(topoOrder.size(), 0);
+		std::vector<std::pair<unsigned, NodeIndex>> outsideEdges;
+		unsigned numLevels = 0;
+		for (unsigned i = 0, e = topoOrder.size(); i < e; ++i)
+		{
+			numLevels = std::max(numLevels, levels[i] + 1);
+			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(topoOrder[i]);
+			if (cNode == nullptr)
+				continue;
+			cNode->canonicalizeEdges(nodeFactory);
+			for (auto tgtNode: *cNode)
+			{
+				if (tgtNode == topoOrder[i])
+					continue;
+				unsigned tgt = positions[tgtNode];
+				if (tgt == NoPosition)
+				{
+					outsideEdges.emplace_back(i, tgtNode);
+					continue;
+				}
+				assert(tgt > i && "The sweep is not in topological order!");
+				preds[tgt].push_back(i);
+				levels[tgt] = std::max(levels[tgt], levels[i] + 1);
+			}
+		}
+		std::vector<std::vector<unsigned>> byLevel(numLevels);
+		for (unsigned i = 0, e = topoOrder.size(); i < e; ++i)
+			byLevel[levels[i]].push_back(i);
+		std::vector<unsigned>().swap(positions);
+		std::vector<unsigned>().swap(levels);
+
+		std::vector<AndersPtsSet> deltas(topoOrder.size());
+		std::vector<SolverIterationStats> threadStats(numThreads);
+		auto sweep = [this, &topoOrder, &preds, &deltas] (unsigned i, SolverIterationStats& localStats)
+		{
+			AndersPtsSet* ptsSet = ptsGraph.find(topoOrder[i]);
+			if (ptsSet == nullptr)
+				return;
+			for (auto pred: preds[i])
+			{
+				if (deltas[pred].isEmpty())
+					continue;
+				++localStats.unions;
+				if (unionPtsSets(*ptsSet, deltas[pred]))
+					++localStats.changedUnions;
+			}
+			AndersPtsSet& propSet = *propGraph.find(topoOrder[i]);
+			deltas[i].assignDifference(*ptsSet, propSet);
+			unionPtsSets(propSet, deltas[i]);
+		};
+		for (auto const& level: byLevel)
+		{
+			// Creating a set flips a bit in the presence bitmap of its graph that neighbouring nodes share, so the sets of the level are created before going parallel
+			for (auto i: level)
+			{
+				NodeIndex node = topoOrder[i];
+				if (std::any_of(preds[i].begin(), preds[i].end(), [&deltas] (unsigned pred) { return !deltas[pred].isEmpty(); }))
+					ptsGraph[node];
+				if (ptsGraph.find(node) != nullptr)
+					propGraph[node];
+			}
+			if (level.size() < MinParallelSize)
+			{
+				for (auto i: level)
+					sweep(i, stats);
+				continue;
+			}
+			runOnThreads(numThreads, [this, &level, &sweep, &threadStats] (unsigned tid)
+			{
+				for (size_t k = level.size() * tid / numThreads, e = level.size() * (tid + 1) / numThreads; k < e; ++k)
+					sweep(level[k], threadStats[tid]);
+			});
+		}
+		for (auto const& edge: outsideEdges)
+		{
+			if (deltas[edge.first].isEmpty())
+				continue;
+			++stats.unions;
+			if (unionPtsSets(ptsGraph[edge.second], deltas[edge.first]))
+				++stats.changedUnions;
+		}
+		for (auto const& localStats: threadStats)
+		{
+			stats.unions += localStats.unions;
+			stats.changedUnions += localStats.changedUnions;
+		}
+	}
+
+	// Insert the copy edge src -> dst found by phase 3. Return true if it is new
+	bool addCopyEdge(NodeIndex src, NodeIndex dst)
+	{
+		if (!constraintGraph.insertCopyEdge(src, dst))
+			return false;
+		++NumCopyEdgesAdded;
+		++stats.copyEdges;
+		if (src != dst)
+		{
+			if (const AndersPtsSet* propSet = propGraph.find(src))
+			{
+				++stats.unions;
+				if (unionPtsSets(ptsGraph[dst], *propSet))
+					++stats.changedUnions;
+			}
+		}
+		return true;
+	}
+
+	// Phase 3. Return true if any new copy edge is added
+	bool resolveComplexConstraints()
+	{
+		bool changed = false;
+		for (auto& mapping: constraintGraph)
+		{
+			NodeIndex node = mapping.first;
+			const ConstraintGraphNode& cNode = mapping.second;
+			if (cNode.load_begin() == cNode.load_end() && cNode.store_begin() == cNode.store_end())
+				continue;
+			const AndersPtsSet* ptsSet = ptsGraph.find(node);
+			if (ptsSet == nullptr)
+				continue;
+
+			AndersPtsSet& complexSet = complexGraph[node];
+			AndersPtsSet deltaSet;
+			deltaSet.assignDifference(*ptsSet, complexSet);
+			if (deltaSet.isEmpty())
+				continue;
+			unionPtsSets(complexSet, deltaSet);
+
+			for (auto v: withNullObject(deltaSet))
+			{
+				NodeIndex vRep = nodeFactory.getMergeTarget(v);
+				for (auto const& dst: cNode.loads())
+					changed |= addCopyEdge(vRep, nodeFactory.getMergeTarget(dst));
+				for (auto const& dst: cNode.stores())
+					changed |= addCopyEdge(nodeFactory.getMergeTarget(dst), vRep);
+			}
+		}
+		return changed;
+	}
+
+	// Phase 3 on several threads. Each thread resolves a share of the nodes against the sets as the sweep left them and gathers the copy edges it finds, and the edges are then inserted in order. What the new edges bring into the sets is only resolved in the next iteration, where resolveComplexConstraints() may already see some of it
+	bool resolveComplexConstraintsInParallel()
+	{
+		std::vector<std::pair<NodeIndex, const ConstraintGraphNode*>> nodes;
+		for (auto& mapping: constraintGraph)
+		{
+			const ConstraintGraphNode& cNode = mapping.second;
+			if (cNode.load_begin() == cNode.load_end() && cNode.store_begin() == cNode.store_end())
+				continue;
+			if (ptsGraph.find(mapping.first) != nullptr)
+				nodes.emplace_back(mapping.first, &cNode);
+		}
+		if (nodes.size() < MinParallelSize)
+			return resolveComplexConstraints();
+		// As in phase 2, the sets are created up front
+		for (auto const& node: nodes)
+			complexGraph[node.first];
+
+		// Only the const getMergeTarget() can be called concurrently: the other one shortens the paths it walks
+		const AndersNodeFactory& factory = nodeFactory;
+		std::vector<std::vector<std::pair<NodeIndex, NodeIndex>>> newEdges(numThreads);
+		runOnThreads(numThreads, [this, &nodes, &factory, &newEdges] (unsigned tid)
+		{
+			for (size_t k = nodes.size() * tid / numThreads, e = nodes.size() * (tid + 1) / numThreads; k < e; ++k)
+			{
+				const ConstraintGraphNode& cNode = *nodes[k].second;
+				const AndersPtsSet& ptsSet = *ptsGraph.find(nodes[k].first);
+				AndersPtsSet& complexSet = *complexGraph.find(nodes[k].first);
+				AndersPtsSet deltaSet;
+				deltaSet.assignDifference(ptsSet, complexSet);
+				if (deltaSet.isEmpty())
+					continue;
+				unionPtsSets(complexSet, deltaSet);
+
+				for (auto v: withNullObject(deltaSet))
+				{
+					NodeIndex vRep = factory.getMergeTarget(v);
+					for (auto const& dst: cNode.loads())
+						newEdges[tid].emplace_back(vRep, factory.getMergeTarget(dst));
+					for (auto const& dst: cNode.stores())
+						newEdges[tid].emplace_back(factory.getMergeTarget(dst), vRep);
+				}
+			}
+		});
+
+		bool changed = false;
+		for (auto const& edges: newEdges)
+			for (auto const& edge: edges)
+				changed |= addCopyEdge(edge.first, edge.second);
+		return changed;
+	}
+public:
+	WaveSolver(AndersNodeFactory& n, AndersPtsGraph& p, ConstraintGraph& c, unsigned t): nodeFactory(n), ptsGraph(p), constraintGraph(c), numThreads(t)
+	{
+		propGraph.resize(n.getNumNodes());
+		complexGraph.resize(n.getNumNodes());
+	}
+
+	// The nodes whose points-to sets have grown since they were last pushed along their copy edges or resolved against their load/store edges
+	void getPendingNodes(std::vector<NodeIndex>& pendingNodes)
+	{
+		for (auto node: ptsGraph)
+		{
+			if (nodeFactory.getMergeTarget(node) != node)
+				continue;
+			const AndersPtsSet& ptsSet = *ptsGraph.find(node);
+			const AndersPtsSet* propSet = propGraph.find(node);
+			bool propagated = propSet != nullptr ? *propSet == ptsSet : ptsSet.isEmpty();
+			const ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+			bool resolved = true;
+			if (cNode != nullptr && (cNode->load_begin() != cNode->load_end() || cNode->store_begin() != cNode->store_end()))
+			{
+				const AndersPtsSet* complexSet = complexGraph.find(node);
+				resolved = complexSet != nullptr ? *complexSet == ptsSet : ptsSet.isEmpty();
+			}
+			if (!propagated || !resolved)
+				pendingNodes.push_back(node);
+		}
+	}
+
+	// trace is null unless -anders-trace is given. Return false if the budget runs out before the fixed point, with the nodes left to process in pendingNodes
+	bool run(const FixedPointHook& atFixedPoint, SolverBudget& budget, SolverTrace* trace, std::vector<NodeIndex>& pendingNodes)
+	{
+		bool changed = true;
+		while (changed)
+		{
+			if (budget.check())
+			{
+				getPendingNodes(pendingNodes);
+				return false;
+			}
+
+			WaveCycleDetector cycleDetector(*this);
+			cycleDetector.run();
+			if (numThreads > 1)
+			{
+				propagateInParallel(cycleDetector.getTopologicalOrder());
+				changed = resolveComplexConstraintsInParallel();
+			}
+			else
+			{
+				propagate(cycleDetector.getTopologicalOrder());
+				changed = resolveComplexConstraints();
+			}
+			stats.workListPops += cycleDetector.getTopologicalOrder().size();
+			budget.endIteration(cycleDetector.getTopologicalOrder().size(), stats);
+			if (trace != nullptr)
+				trace->endIteration(stats, cycleDetector.getTopologicalOrder().size(), 0, ptsGraph);
+			else
+				stats = SolverIterationStats();
+			// The next sweep picks up whatever the hook has changed, so there is no need to know which nodes those are
+			if (!changed)
+			{
+				std::vector<NodeIndex> changedNodes;
+				changed = atFixedPoint(changedNodes);
+			}
+		}
+		return true;
+	}
+};
+
+// Solves the constraints as products of sparse boolean matrices, with OR for addition and AND for multiplication. P is the points-to matrix, with a row per representative and a column per object. C holds the copy edges, L the loads (a row per pointer, a column per value loaded into) and S the stores (a row per pointer, a column per value stored). Each round starts from the entries dP the previous round added to P. The copy edges the loads and stores derive from them, dC = dP^T * L + S^T * dP, go into C, and the next entries of P are those of C^T * dP + dC^T * P that it doesn't have yet. This is the semi-naive evaluation of P = P + C^T * P, and the fixed point is reached when a round adds nothing
+// The matrices are kept by rows, as sorted vectors of columns, and C and L by their transposes, so that every product is a row of one matrix selecting rows of the other (see multiply()). The rows of a product are split across the threads, each thread writing its own rows, and so are those of the element-wise additions. The objects of the columns stand for their representatives wherever they become nodes again: as the ends of the copy edges the loads and stores derive
+class MatrixSolver
+{
+private:
+	// Products and additions with fewer rows than this are done by the calling thread alone
+	static const unsigned MinParallelSize = 1024;
+
+	typedef std::vector<std::vector<NodeIndex>> BoolMatrix;
+
+	AndersNodeFactory& nodeFactory;
+	AndersPtsGraph& ptsGraph;
+	ConstraintGraph& constraintGraph;
+	unsigned numThreads;
+	// P, and the last rows added to it. The null object has the column NullObjectIndex
+	BoolMatrix ptsMatrix, deltaMatrix;
+	// C^T, i.e. the copy predecessors of each node, L^T, and S
+	BoolMatrix copyPreds, loadPreds, stores;
+
+	SolverIterationStats stats;
+
+	// Run func(row) for every row in [0, numRows), on several threads if there are enough of them
+	template <typename Func>
+	void forEachRow(unsigned numRows, Func func)
+	{
+		if (numThreads <= 1 || numRows < MinParallelSize)
+		{
+			for (unsigned row = 0; row < numRows; ++row)
+				func(row);
+			return;
+		}
+		runOnThreads(numThreads, [this, numRows, &func] (unsigned tid)
+		{
+			for (unsigned row = numRows * (uint64_t)tid / numThreads, e = numRows * (uint64_t)(tid + 1) / numThreads; row < e; ++row)
+				func(row);
+		});
+	}
+
+	static void sortRow(std::vector<NodeIndex>& row)
+	{
+		std::sort(row.begin(), row.end());
+		row.erase(std::unique(row.begin(), row.end()), row.end());
+	}
+
+	// out = a * b: row i of out is the OR of the rows of b that row i of a has the columns of
+	void multiply(const BoolMatrix& a, const BoolMatrix& b, BoolMatrix& out)
+	{
+		out.assign(a.size(), std::vector<NodeIndex>());
+		forEachRow(a.size(), [&a, &b, &out] (unsigned row)
+		{
+			std::vector<NodeIndex>& outRow = out[row];
+			for (auto k: a[row])
+				outRow.insert(outRow.end(), b[k].begin(), b[k].end());
+			sortRow(outRow);
+		});
+	}
+
+	// Turn added into what it has that m doesn't, and add that to m. Return the number of entries added
+	unsigned addDifference(BoolMatrix& m, BoolMatrix& added)
+	{
+		std::vector<unsigned> numAdded(added.size(), 0);
+		forEachRow(added.size(), [&m, &added, &numAdded] (unsigned row)
+		{
+			std::vector<NodeIndex>& addedRow = added[row];
+			if (addedRow.empty())
+				return;
+			std::vector<NodeIndex>& mRow = m[row];
+			std::vector<NodeIndex> diff;
+			std::set_difference(addedRow.begin(), addedRow.end(), mRow.begin(), mRow.end(), std::back_inserter(diff));
+			if (!diff.empty())
+			{
+				std::vector<NodeIndex> merged;
+				merged.reserve(mRow.size() + diff.size());
+				std::merge(mRow.begin(), mRow.end(), diff.begin(), diff.end(), std::back_inserter(merged));
+				mRow.swap(merged);
+			}
+			addedRow.swap(diff);
+			numAdded[row] = addedRow.size();
+		});
+		return std::accumulate(numAdded.begin(), numAdded.end(), 0u);
+	}
+
+	// The transpose of m, with the columns taken as the rows of their representatives
+	void transposeToReps(const BoolMatrix& m, BoolMatrix& out)
+	{
+		out.assign(m.size(), std::vector<NodeIndex>());
+		for (unsigned row = 0, e = m.size(); row < e; ++row)
+			for (auto col: m[row])
+				out[nodeFactory.getMergeTarget(col)].push_back(row);
+	}
+
+	// Give the rows that have just been added to P to the points-to graph as well
+	void writeBack(const BoolMatrix& added)
+	{
+		for (unsigned row = 0, e = added.size(); row < e; ++row)
+		{
+			if (added[row].empty())
+				continue;
+			AndersPtsSet& ptsSet = ptsGraph[row];
+			for (auto obj: added[row])
+			{
+				if (obj == AndersNodeFactory::NullObjectIndex)
+					ptsSet.insertNullObject();
+				else
+					ptsSet.insert(obj);
+			}
+		}
+	}
+
+	// Take whatever the points-to graph has that P doesn't into P, as new entries of dP
+	void importPtsSets(const std::vector<NodeIndex>& nodes)
+	{
+		BoolMatrix added(ptsMatrix.size());
+		for (auto node: nodes)
+		{
+			NodeIndex rep = nodeFactory.getMergeTarget(node);
+			const AndersPtsSet* ptsSet = ptsGraph.find(rep);
+			if (ptsSet == nullptr)
+				continue;
+			std::vector<NodeIndex>& row = added[rep];
+			for (auto obj: *ptsSet)
+				row.push_back(obj);
+			if (ptsSet->hasNullObject())
+				row.push_back(nodeFactory.getNullObjectNode());
+			sortRow(row);
+		}
+		addDifference(ptsMatrix, added);
+		for (unsigned row = 0, e = added.size(); row < e; ++row)
+			if (!added[row].empty())
+				deltaMatrix[row].insert(deltaMatrix[row].end(), added[row].begin(), added[row].end());
+		for (auto& row: deltaMatrix)
+			sortRow(row);
+	}
+
+	// Take the copy edges of the constraint graph that C^T doesn't have into it, and the entries of P they bring to their targets into dP
+	void importCopyEdges()
+	{
+		BoolMatrix addedPreds(copyPreds.size());
+		for (auto& mapping: constraintGraph)
+		{
+			NodeIndex node = mapping.first;
+			if (nodeFactory.getMergeTarget(node) != node)
+				continue;
+			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
+			cNode->canonicalizeEdges(nodeFactory);
+			for (auto tgtNode: *cNode)
+			{
+				NodeIndex tgtRep = nodeFactory.getMergeTarget(tgtNode);
+				if (tgtRep != node)
+					addedPreds[tgtRep].push_back(node);
+			}
+		}
+		for (auto& row: addedPreds)
+			sortRow(row);
+		addDifference(copyPreds, addedPreds);
+
+		BoolMatrix added;
+		multiply(addedPreds, ptsMatrix, added);
+		addDifference(ptsMatrix, added);
+		writeBack(added);
+		for (unsigned row = 0, e = added.size(); row < e; ++row)
+			deltaMatrix[row].insert(deltaMatrix[row].end(), added[row].begin(), added[row].end());
+		for (auto& row: deltaMatrix)
+			sortRow(row);
+	}
+
+	// One round. Return false if it adds nothing to P
+	bool iterate()
+	{
+		// dC^T = L^T * dP + (dP^T * S), the columns of dP taken as their representatives
+		BoolMatrix deltaReps(deltaMatrix.size());
+		forEachRow(deltaMatrix.size(), [this, &deltaReps] (unsigned row)
+		{
+			const AndersNodeFactory& factory = nodeFactory;
+			for (auto col: deltaMatrix[row])
+				deltaReps[row].push_back(factory.getMergeTarget(col));
+			sortRow(deltaReps[row]);
+		});
+		BoolMatrix addedPreds, storedPreds, deltaTranspose;
+		multiply(loadPreds, deltaReps, addedPreds);
+		transposeToReps(deltaMatrix, deltaTranspose);
+		multiply(deltaTranspose, stores, storedPreds);
+		forEachRow(addedPreds.size(), [&addedPreds, &storedPreds] (unsigned row)
+		{
+			std::vector<NodeIndex>& predRow = addedPreds[row];
+			predRow.insert(predRow.end(), storedPreds[row].begin(), storedPreds[row].end());
+			predRow.erase(std::remove(predRow.begin(), predRow.end(), row), predRow.end());
+			sortRow(predRow);
+		});
+		unsigned numAddedEdges = addDifference(copyPreds, addedPreds);
+		NumCopyEdgesAdded += numAddedEdges;
+		stats.copyEdges += numAddedEdges;
+		// The graph keeps the edges for the clients that look at it after the solving
+		for (unsigned row = 0, e = addedPreds.size(); row < e; ++row)
+			for (auto src: addedPreds[row])
+				constraintGraph.insertCopyEdge(src, row);
+
+		// C^T * dP + dC^T * P
+		BoolMatrix added, addedByNewEdges;
+		multiply(copyPreds, deltaMatrix, added);
+		multiply(addedPreds, ptsMatrix, addedByNewEdges);
+		forEachRow(added.size(), [&added, &addedByNewEdges] (unsigned row)
+		{
+			if (addedByNewEdges[row].empty())
+				return;
+			added[row].insert(added[row].end(), addedByNewEdges[row].begin(), addedByNewEdges[row].end());
+			sortRow(added[row]);
+		});
+		unsigned numAdded = addDifference(ptsMatrix, added);
+		stats.unions += numAdded;
+		stats.changedUnions += std::count_if(added.begin(), added.end(), [] (const std::vector<NodeIndex>& row) { return !row.empty(); });
+		writeBack(added);
+		deltaMatrix.swap(added);
+		return numAdded != 0;
+	}
+public:
+	MatrixSolver(AndersNodeFactory& n, AndersPtsGraph& p, ConstraintGraph& c, unsigned t): nodeFactory(n), ptsGraph(p), constraintGraph(c), numThreads(t)
+	{
+		unsigned numNodes = n.getNumNodes();
+		ptsMatrix.resize(numNodes);
+		deltaMatrix.resize(numNodes);
+		copyPreds.resize(numNodes);
+		loadPreds.resize(numNodes);
+		stores.resize(numNodes);
+	}
+
+	// The nodes whose new entries of P have not been through a round yet
+	void getPendingNodes(std::vector<NodeIndex>& pendingNodes)
+	{
+		for (unsigned row = 0, e = deltaMatrix.size(); row < e; ++row)
+			if (!deltaMatrix[row].empty())
+				pendingNodes.push_back(row);
+	}
+
+	// trace is null unless -anders-trace is given. Return false if the budget runs out before the fixed point, with the nodes left to process in pendingNodes
+	bool run(const FixedPointHook& atFixedPoint, SolverBudget& budget, SolverTrace* trace, std::vector<NodeIndex>& pendingNodes)
+	{
+		// Export the graphs into the matrices. The whole of P is new to the first round
+		for (auto& mapping: constraintGraph)
+		{
+			NodeIndex node = mapping.first;
+			if (nodeFactory.getMergeTarget(node) != node)
+				continue;
+			for (auto const& dst: mapping.second.loads())
+				loadPreds[nodeFactory.getMergeTarget(dst)].push_back(node);
+			for (auto const& src: mapping.second.stores())
+				stores[node].push_back(nodeFactory.getMergeTarget(src));
+		}
+		for (auto& row: loadPreds)
+			sortRow(row);
+		for (auto& row: stores)
+			sortRow(row);
+		std::vector<NodeIndex> nodes;
+		for (auto node: ptsGraph)
+			nodes.push_back(node);
+		importPtsSets(nodes);
+		importCopyEdges();
+
+		bool changed = true;
+		while (changed)
+		{
+			if (budget.check())
+			{
+				getPendingNodes(pendingNodes);
+				return false;
+			}
+
+			unsigned numRows = std::count_if(deltaMatrix.begin(), deltaMatrix.end(), [] (const std::vector<NodeIndex>& row) { return !row.empty(); });
+			changed = iterate();
+			++NumMatrixRounds;
+			stats.workListPops += numRows;
+			budget.endIteration(numRows, stats);
+			if (trace != nullptr)
+				trace->endIteration(stats, numRows, 0, ptsGraph);
+			else
+				stats = SolverIterationStats();
+			// The hook only adds copy edges, and unions along them the sets of the nodes it lists
+			if (!changed)
+			{
+				std::vector<NodeIndex> changedNodes;
+				if (!atFixedPoint(changedNodes))
+					break;
+				importPtsSets(changedNodes);
+				importCopyEdges();
+				changed = true;
+			}
+		}
+		return true;
+	}
+};
+
+// Solve the weakly connected components of the constraints apart from each other, on several threads
+// Two components never exchange anything but through the special nodes, so each of them can be solved with a node factory, a points-to graph and a constraint graph of its own, numbered from 0. The components are packed into a few sub-problems of about the same number of constraints, which the threads take one at a time, and the results are then merged back into the shared graphs. The universal and null objects make the components meet after all (a store through a pointer to the universal object reaches every other component through it), and so do the calls the on-the-fly call graph resolves. The usual solver therefore runs once more over the merged graphs, which is cheap when the components are already at their fixed points, and makes the results exactly those of solving everything at once
+// Solves a small component of the constraints with bit matrices. Each representative gets a row and each object whose address is taken a column. The closure keeps, for each row, the rows that reach it along the copy edges, so the points-to set of a row is the OR of the address-of rows of those, a few words at a time. The loads and stores add copy edges from what the pointers point to, which extend the closure, until they add none. There are no map lookups, no work list and no union of sparse sets, which is what the worklist solver spends its time on when the component is tiny
+// The component must not touch the special nodes, whose sets have their own rules (the null object, top sets)
+class BitMatrixSolver
+{
+private:
+	AndersNodeFactory& nodeFactory;
+	const std::vector<AndersConstraint>& constraints;
+	// The row of each representative, and the column of each object whose address is taken, and back
+	DenseMap<NodeIndex, unsigned> rowOf, columnOf;
+	std::vector<NodeIndex> rowNodes, columnObjs;
+	// The row of the representative of the object of each column, i.e. where its contents go
+	std::vector<unsigned> columnRows;
+	// reachedFrom[r] holds the rows with a path of copy edges to r. addrs[r] holds the columns taken the address of into r, and ptsSets[r] the points-to set of r
+	std::vector<BitVector> reachedFrom, addrs, ptsSets;
+	// The (pointer row, value row) of each load and store
+	std::vector<std::pair<unsigned, unsigned>> loads, stores;
+	// The copy edges the loads and stores add
+	std::vector<std::pair<unsigned, unsigned>> derivedEdges;
+
+	unsigned getRow(NodeIndex n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		auto ins = rowOf.insert(std::make_pair(rep, rowNodes.size()));
+		if (ins.second)
+			rowNodes.push_back(rep);
+		return ins.first->second;
+	}
+	unsigned getColumn(NodeIndex obj)
+	{
+		auto ins = columnOf.insert(std::make_pair(obj, columnObjs.size()));
+		if (ins.second)
+			columnObjs.push_back(obj);
+		return ins.first->second;
+	}
+
+	// Add the copy edge from row src to row dst to the closure. Return false if dst was reached from src already
+	bool insertEdge(unsigned src, unsigned dst)
+	{
+		if (src == dst || reachedFrom[dst].test(src))
+			return false;
+		BitVector added = reachedFrom[src];
+		added.set(src);
+		for (unsigned r = 0, e = rowNodes.size(); r < e; ++r)
+			if (r == dst || reachedFrom[r].test(dst))
+				reachedFrom[r] |= added;
+		return true;
+	}
+
+	void computePtsSets()
+	{
+		for (unsigned r = 0, e = rowNodes.size(); r < e; ++r)
 		{
-			// Detect and collapse cycles online
-			OnlineCycleDetector cycleDetector(nodeFactory, constraintGraph, ptsGraph, cycleCandidates);
-			cycleDetector.run();
-			cycleCandidates.clear();
+			ptsSets[r] = addrs[r];
+			for (int pred = reachedFrom[r].find_first(); pred != -1; pred = reachedFrom[r].find_next(pred))
+				ptsSets[r] |= addrs[pred];
+		}
+	}
+public:
+	BitMatrixSolver(AndersNodeFactory& n, const std::vector<AndersConstraint>& c): nodeFactory(n), constraints(c)
+	{
+		for (auto const& c: constraints)
+		{
+			getRow(c.getDest());
+			getRow(c.getSrc());
+			if (c.getType() == AndersConstraint::ADDR_OF)
+				getColumn(c.getSrc());
 		}
+		unsigned numRows = rowNodes.size(), numColumns = columnObjs.size();
+		reachedFrom.assign(numRows, BitVector(numRows));
+		addrs.assign(numRows, BitVector(numColumns));
+		ptsSets.assign(numRows, BitVector(numColumns));
+		for (auto obj: columnObjs)
+			columnRows.push_back(getRow(obj));
 
-		while (!currWorkList->isEmpty())
+		for (auto const& c: constraints)
 		{
-			NodeIndex node = currWorkList->dequeue();
-			node = nodeFactory.getMergeTarget(node);
-			//errs() << "Examining node " << node << "\n";
+			unsigned dst = getRow(c.getDest()), src = getRow(c.getSrc());
+			switch (c.getType())
+			{
+				case AndersConstraint::ADDR_OF:
+					addrs[dst].set(getColumn(c.getSrc()));
+					break;
+				case AndersConstraint::COPY:
+					insertEdge(src, dst);
+					break;
+				case AndersConstraint::LOAD:
+					loads.push_back(std::make_pair(src, dst));
+					break;
+				case AndersConstraint::STORE:
+					stores.push_back(std::make_pair(dst, src));
+					break;
+			}
+		}
+	}
 
-			ConstraintGraphNode* cNode = constraintGraph.getNodeWithIndex(node);
-			if (cNode == nullptr)
+	void run()
+	{
+		bool changed = true;
+		while (changed)
+		{
+			computePtsSets();
+			changed = false;
+			for (auto const& load: loads)
+			{
+				const BitVector& ptsSet = ptsSets[load.first];
+				for (int col = ptsSet.find_first(); col != -1; col = ptsSet.find_next(col))
+				{
+					if (insertEdge(columnRows[col], load.second))
+					{
+						derivedEdges.push_back(std::make_pair(columnRows[col], load.second));
+						changed = true;
+					}
+				}
+			}
+			for (auto const& store: stores)
+			{
+				const BitVector& ptsSet = ptsSets[store.first];
+				for (int col = ptsSet.find_first(); col != -1; col = ptsSet.find_next(col))
+				{
+					if (insertEdge(store.second, columnRows[col]))
+					{
+						derivedEdges.push_back(std::make_pair(store.second, columnRows[col]));
+						changed = true;
+					}
+				}
+			}
+		}
+	}
+
+	// Put the points-to sets into ptsGraph, and the edges into cGraph, the way the worklist solver would have left them
+	void writeBack(AndersPtsGraph& ptsGraph, ConstraintGraph& cGraph)
+	{
+		for (unsigned r = 0, e = rowNodes.size(); r < e; ++r)
+		{
+			if (ptsSets[r].none())
 				continue;
+			AndersPtsSet& ptsSet = ptsGraph[rowNodes[r]];
+			for (int col = ptsSets[r].find_first(); col != -1; col = ptsSets[r].find_next(col))
+				ptsSet.insert(columnObjs[col]);
+		}
+		buildConstraintGraph(cGraph, constraints, nodeFactory, ptsGraph);
+		for (auto const& edge: derivedEdges)
+			cGraph.insertCopyEdge(rowNodes[edge.first], rowNodes[edge.second]);
+	}
+};
+
+class PartitionedSolver
+{
+private:
+	// The components are spread over this many sub-problems per thread, so that a thread that is done early can pick up another one
+	static const unsigned SubProblemsPerThread = 4;
+	enum: unsigned { NoSlot = ~0u };
+
+	// A group of components solved by one thread. Its local nodes 0 to NullObjectIndex are the special nodes, the others are numbered in the order the constraints refer to them
+	struct SubProblem
+	{
+		// The global node of each local node
+		std::vector<NodeIndex> globalNodes;
+		std::vector<AndersConstraint> constraints;
+		AndersNodeFactory nodeFactory;
+		AndersPtsGraph ptsGraph;
+		ConstraintGraph constraintGraph;
+		// The components small enough for BitMatrixSolver, each with its constraints. They are kept out of the constraint graph until they are solved
+		std::vector<std::vector<AndersConstraint>> denseComponents;
+		// The number of constraints, to balance the sub-problems
+		size_t size = 0;
+	};
+
+	AndersNodeFactory& nodeFactory;
+	AndersPtsGraph& ptsGraph;
+	ConstraintGraph& constraintGraph;
+	const OfflineCycleDetector* offlineInfo;
+	unsigned numThreads;
+	std::vector<std::unique_ptr<SubProblem>> subProblems;
+
+	static bool isSpecialNode(NodeIndex n)
+	{
+		return n <= AndersNodeFactory::NullObjectIndex;
+	}
+
+	void solve(SubProblem& sp, AndersWorkListPolicy policy, SolverBudget& budget)
+	{
+		sp.ptsGraph.resize(sp.nodeFactory.getNumNodes());
+		buildConstraintGraph(sp.constraintGraph, sp.constraints, sp.nodeFactory, sp.ptsGraph);
+		if (usesTopSets())
+			makeTop(sp.ptsGraph[AndersNodeFactory::UniversalObjIndex]);
+		std::vector<AndersConstraint>().swap(sp.constraints);
+
+		// The collapse targets that lie in the same sub-problem. The others are in components this one never reaches
+		std::unique_ptr<OfflineCycleDetector> localOfflineInfo;
+		if (offlineInfo != nullptr)
+		{
+			std::vector<NodeIndex> targets(sp.globalNodes.size(), AndersNodeFactory::InvalidIndex);
+			DenseMap<NodeIndex, NodeIndex> localNodes;
+			for (NodeIndex n = 0, e = sp.globalNodes.size(); n < e; ++n)
+				localNodes[sp.globalNodes[n]] = n;
+			for (NodeIndex n = 0, e = sp.globalNodes.size(); n < e; ++n)
+			{
+				NodeIndex target = offlineInfo->getCollapseTarget(sp.globalNodes[n]);
+				if (target == AndersNodeFactory::InvalidIndex)
+					continue;
+				auto itr = localNodes.find(target);
+				if (itr != localNodes.end())
+					targets[n] = itr->second;
+			}
+			localOfflineInfo.reset(new OfflineCycleDetector(sp.nodeFactory, std::move(targets)));
+		}
+
+		AndersWorkListOrder workListOrder(policy, sp.nodeFactory.getNumNodes());
+		if (policy == AndersWorkListPolicy::TOPO || policy == AndersWorkListPolicy::DIVIDED)
+		{
+			TopologicalOrderer orderer(sp.nodeFactory, sp.constraintGraph, workListOrder);
+			orderer.run();
+		}
+		// Whatever is left pending when the budget runs out is picked up by the final run over the merged graphs
+		FixedPointHook noHook = [] (std::vector<NodeIndex>&) { return false; };
+		std::vector<NodeIndex> pendingNodes;
+		getWorkListSolver()(sp.nodeFactory, sp.ptsGraph, sp.constraintGraph, localOfflineInfo.get(), nullptr, nullptr, nullptr, ArrayRef<NodeIndex>(), workListOrder, noHook, budget, nullptr, false, pendingNodes);
+
+		// The dense components share no node with the rest, so the worklist solver never saw them
+		for (auto const& component: sp.denseComponents)
+		{
+			BitMatrixSolver kernel(sp.nodeFactory, component);
+			kernel.run();
+			kernel.writeBack(sp.ptsGraph, sp.constraintGraph);
+		}
+		std::vector<std::vector<AndersConstraint>>().swap(sp.denseComponents);
+	}
+
+	void mergeBack(SubProblem& sp)
+	{
+		auto getGlobalRep = [this, &sp] (NodeIndex n) { return nodeFactory.getMergeTarget(sp.globalNodes[n]); };
+		for (auto node: sp.ptsGraph)
+		{
+			const AndersPtsSet& localSet = *sp.ptsGraph.find(node);
+			AndersPtsSet ptsSet;
+			if (localSet.hasNullObject())
+				ptsSet.insertNullObject();
+			for (auto obj: localSet)
+				ptsSet.insert(sp.globalNodes[obj]);
+			unionPtsSets(ptsGraph[getGlobalRep(node)], ptsSet);
+		}
+		for (auto const& mapping: sp.constraintGraph)
+		{
+			NodeIndex src = getGlobalRep(mapping.first);
+			const ConstraintGraphNode& cNode = mapping.second;
+			for (auto dst: cNode)
+				constraintGraph.insertCopyEdge(src, getGlobalRep(dst));
+			for (auto dst: cNode.loads())
+				constraintGraph.insertLoadEdge(src, getGlobalRep(dst));
+			for (auto dst: cNode.stores())
+				constraintGraph.insertStoreEdge(src, getGlobalRep(dst));
+		}
+	}
+public:
+	PartitionedSolver(AndersNodeFactory& n, AndersPtsGraph& p, ConstraintGraph& c, const OfflineCycleDetector* o, unsigned t): nodeFactory(n), ptsGraph(p), constraintGraph(c), offlineInfo(o), numThreads(t) {}
 
-			auto ptsItr = ptsGraph.find(node);
-			if (ptsItr != ptsGraph.end())
+	// Split the constraints into sub-problems. Return false if they don't fall apart into at least two components, in which case nothing is gained by partitioning them
+	bool partition(const std::vector<AndersConstraint>& constraints)
+	{
+		unsigned numNodes = nodeFactory.getNumNodes();
+		// A node merged into a special node before solving would tie its component to the special node, which every sub-problem has a copy of. That is rare enough not to bother with
+		for (NodeIndex n = AndersNodeFactory::NullObjectIndex + 1; n < numNodes; ++n)
+			if (isSpecialNode(nodeFactory.getMergeTarget(n)))
+				return false;
+
+		// Union-find over the representatives of the two ends of each constraint. The special nodes stay out of it: nearly every component has a constraint with them, and they would glue everything into one
+		std::vector<NodeIndex> parent(numNodes);
+		for (NodeIndex n = 0; n < numNodes; ++n)
+			parent[n] = n;
+		auto find = [&parent] (NodeIndex n)
+		{
+			while (parent[n] != n)
 			{
-				// Check indirect constraints and add copy edge to the constraint graph if necessary
-				const AndersPtsSet& ptsSet = ptsItr->second;
+				parent[n] = parent[parent[n]];
+				n = parent[n];
+			}
+			return n;
+		};
+		for (auto const& c: constraints)
+		{
+			NodeIndex src = nodeFactory.getMergeTarget(c.getSrc());
+			NodeIndex dst = nodeFactory.getMergeTarget(c.getDest());
+			if (isSpecialNode(src) || isSpecialNode(dst))
+				continue;
+			src = find(src);
+			dst = find(dst);
+			if (src != dst)
+				parent[std::max(src, dst)] = std::min(src, dst);
+		}
+
+		// A constraint belongs to the component of its end that is not special. The constraints between two special nodes belong to every sub-problem
+		auto getComponent = [this, &find] (const AndersConstraint& c)
+		{
+			NodeIndex dst = nodeFactory.getMergeTarget(c.getDest());
+			if (!isSpecialNode(dst))
+				return find(dst);
+			NodeIndex src = nodeFactory.getMergeTarget(c.getSrc());
+			return isSpecialNode(src) ? AndersNodeFactory::InvalidIndex : find(src);
+		};
+		std::vector<size_t> componentSizes(numNodes, 0);
+		std::vector<NodeIndex> components;
+		std::vector<AndersConstraint> sharedConstraints;
+		for (auto const& c: constraints)
+		{
+			NodeIndex component = getComponent(c);
+			if (component == AndersNodeFactory::InvalidIndex)
+				sharedConstraints.push_back(c);
+			else if (componentSizes[component]++ == 0)
+				components.push_back(component);
+		}
+		if (components.size() < 2)
+			return false;
+		NumPartitionComponents += components.size();
 
-				// This is where we perform HCD: check if node has a collapse target, and if it does, merge them immediately
-				if (EnableHCD)
+		// The components that BitMatrixSolver may take: small, and clear of the special nodes. A limited set may become top, which only the usual solvers handle
+		std::vector<bool> isDense(numNodes, false);
+		if (DenseKernelSize != 0 && PtsSetLimit == 0)
+		{
+			std::vector<unsigned> componentNodes(numNodes, 0);
+			std::vector<bool> touchesSpecial(numNodes, false), counted(numNodes, false);
+			for (auto const& c: constraints)
+			{
+				NodeIndex component = getComponent(c);
+				if (component == AndersNodeFactory::InvalidIndex)
+					continue;
+				for (NodeIndex n: { c.getDest(), c.getSrc() })
 				{
-					NodeIndex collapseTarget = offlineInfo.getCollapseTarget(node);
-					if (collapseTarget != AndersNodeFactory::InvalidIndex)
+					if (isSpecialNode(n))
+						touchesSpecial[component] = true;
+					else if (!counted[n])
 					{
-						//errs() << "node = " << node << ", collapseTgt = " << collapseTarget << "\n";
-						NodeIndex ctRep = nodeFactory.getMergeTarget(collapseTarget);
-						// Here we have to pay special attention to whether the node points-to itself.
-						bool mergeSelf = false;
-						for (auto v: ptsSet)
-						{
-							NodeIndex vRep = nodeFactory.getMergeTarget(v);
-							if (vRep == node)
-							{
-								mergeSelf = true;
-								continue;
-							}
-							collapseNodes(ctRep, vRep, nodeFactory, ptsGraph, constraintGraph);
-						}
-
-						if (mergeSelf)
-						{
-							collapseNodes(ctRep, node, nodeFactory, ptsGraph, constraintGraph);
-							// If the node collapsing succeeds, we can't proceed here because node no longer exists. Push ctRep to the worklist and proceed
-							if (ctRep != node)
-							{
-								nextWorkList->enqueue(ctRep);
-								continue;
-							}
-						}
+						counted[n] = true;
+						++componentNodes[component];
 					}
 				}
+			}
+			for (auto component: components)
+			{
+				isDense[component] = !touchesSpecial[component] && componentNodes[component] <= DenseKernelSize;
+				if (isDense[component])
+					++NumDenseComponents;
+			}
+		}
 
-				for (auto v: ptsSet)
-				{
-					DenseMap<NodeIndex, NodeIndex> updateMap;
+		// Pack the components into the sub-problems, the largest first and each into the smallest sub-problem so far
+		unsigned numSubProblems = std::min<size_t>(components.size(), numThreads * SubProblemsPerThread);
+		std::sort(components.begin(), components.end(), [&componentSizes] (NodeIndex a, NodeIndex b)
+		{
+			return componentSizes[a] != componentSizes[b] ? componentSizes[a] > componentSizes[b] : a < b;
+		});
+		for (unsigned i = 0; i < numSubProblems; ++i)
+		{
+			subProblems.emplace_back(new SubProblem);
+			SubProblem& sp = *subProblems.back();
+			for (NodeIndex n = 0; n <= AndersNodeFactory::NullObjectIndex; ++n)
+				sp.globalNodes.push_back(n);
+			sp.constraints = sharedConstraints;
+		}
+		typedef std::pair<size_t, unsigned> SizeAndIndex;
+		std::priority_queue<SizeAndIndex, std::vector<SizeAndIndex>, std::greater<SizeAndIndex>> smallest;
+		for (unsigned i = 0; i < numSubProblems; ++i)
+			smallest.push(std::make_pair(0, i));
+		// The sub-problem of each component, indexed by the root of the component
+		std::vector<unsigned> subProblemOf(numNodes);
+		for (auto component: components)
+		{
+			SizeAndIndex entry = smallest.top();
+			smallest.pop();
+			subProblemOf[component] = entry.second;
+			entry.first += componentSizes[component];
+			subProblems[entry.second]->size = entry.first;
+			smallest.push(entry);
+		}
 
-					NodeIndex vRep = nodeFactory.getMergeTarget(v);
-					for (auto const& dst: cNode->loads())
-					{
-						NodeIndex tgtNode = nodeFactory.getMergeTarget(dst);
-						//errs() << "Examining load edge " << node << " -> " << tgtNode << "\n";
-						if (constraintGraph.insertCopyEdge(vRep, tgtNode))
-						{
-							//errs() << "\tInsert copy edge " << v << " -> " << tgtNode << "\n";
-							nextWorkList->enqueue(vRep);
-						}
+		// Number the nodes of each sub-problem. A node is only ever referred to from its own component, so one mapping serves every sub-problem
+		std::vector<NodeIndex> localNodes(numNodes, AndersNodeFactory::InvalidIndex);
+		auto getLocalNode = [this, &localNodes] (SubProblem& sp, NodeIndex n)
+		{
+			if (isSpecialNode(n))
+				return n;
+			NodeIndex& local = localNodes[n];
+			if (local == AndersNodeFactory::InvalidIndex)
+			{
+				local = nodeFactory.isObjectNode(n) ? sp.nodeFactory.createObjectNode() : sp.nodeFactory.createValueNode();
+				sp.globalNodes.push_back(n);
+			}
+			return local;
+		};
+		// The slot of each dense component in the denseComponents of its sub-problem
+		std::vector<unsigned> denseSlots(numNodes, NoSlot);
+		for (auto const& c: constraints)
+		{
+			NodeIndex component = getComponent(c);
+			if (component == AndersNodeFactory::InvalidIndex)
+				continue;
+			SubProblem& sp = *subProblems[subProblemOf[component]];
+			NodeIndex dst = getLocalNode(sp, c.getDest());
+			NodeIndex src = getLocalNode(sp, c.getSrc());
+			if (!isDense[component])
+			{
+				sp.constraints.push_back(AndersConstraint(c.getType(), dst, src));
+				continue;
+			}
+			if (denseSlots[component] == NoSlot)
+			{
+				denseSlots[component] = sp.denseComponents.size();
+				sp.denseComponents.emplace_back();
+			}
+			sp.denseComponents[denseSlots[component]].push_back(AndersConstraint(c.getType(), dst, src));
+		}
+		// Repeat the merges done before solving, e.g. by HVN or offline HCD, on the local nodes. A representative is in the component of the nodes merged into it
+		for (auto& sp: subProblems)
+		{
+			for (NodeIndex n = AndersNodeFactory::NullObjectIndex + 1; n < sp->globalNodes.size(); ++n)
+			{
+				NodeIndex rep = nodeFactory.getMergeTarget(sp->globalNodes[n]);
+				if (rep != sp->globalNodes[n])
+					sp->nodeFactory.mergeNode(getLocalNode(*sp, rep), n);
+			}
+		}
+		return true;
+	}
 
-						// If we find that dst has been merged to elsewhere, remember this fact to update the constraint graph later
-						if (tgtNode != dst)
-							updateMap[dst] = tgtNode;
-					}
+	// Solve the sub-problems and merge their results into the shared graphs. Each thread has a copy of budget; a sub-problem that runs out of it is left where it stopped
+	void run(const SolverBudget& budget)
+	{
+		AndersWorkListPolicy policy = getWorkListPolicy();
+		// The largest sub-problems go first
+		std::sort(subProblems.begin(), subProblems.end(), [] (const std::unique_ptr<SubProblem>& a, const std::unique_ptr<SubProblem>& b) { return a->size > b->size; });
+		std::atomic<unsigned> nextSubProblem(0);
+		runOnThreads(std::min<unsigned>(numThreads, subProblems.size()), [this, policy, &budget, &nextSubProblem] (unsigned)
+		{
+			SolverBudget threadBudget = budget;
+			for (unsigned i = nextSubProblem++; i < subProblems.size(); i = nextSubProblem++)
+				solve(*subProblems[i], policy, threadBudget);
+		});
 
-					// Now perform the load edge updates
-					for (auto const& mapping: updateMap)
-						cNode->replaceLoadEdge(mapping.first, mapping.second);
-					updateMap.clear();
+		// Merge the nodes that were collapsed within the sub-problems first, so that the sets and edges below go straight to the final representatives. The special nodes are among them: a cycle through one of them makes the cycles of all the sub-problems that go through it one
+		for (auto& sp: subProblems)
+		{
+			for (NodeIndex n = 0; n < sp->globalNodes.size(); ++n)
+			{
+				NodeIndex rep = nodeFactory.getMergeTarget(sp->globalNodes[sp->nodeFactory.getMergeTarget(n)]);
+				NodeIndex node = nodeFactory.getMergeTarget(sp->globalNodes[n]);
+				if (rep != node)
+					nodeFactory.mergeNode(rep, node);
+			}
+		}
+		for (auto& sp: subProblems)
+		{
+			mergeBack(*sp);
+			sp.reset();
+		}
+		subProblems.clear();
+	}
+};
 
-					for (auto const& dst: cNode->stores())
-					{
-						NodeIndex tgtNode = nodeFactory.getMergeTarget(dst);
-						if (constraintGraph.insertCopyEdge(tgtNode, vRep))
-						{
-							//errs() << "\tInsert copy edge " << tgtNode << " -> " << v << "\n";
-							nextWorkList->enqueue(tgtNode);
-						}
+}	// end of anonymous namespace
 
-						// If we find that dst has been merged to elsewhere, remember this fact to update the constraint graph later
-						if (tgtNode != dst)
-							updateMap[dst] = tgtNode;
-					}
+// It is called during the collection, and its time counts towards the collection phase. The constraint graph drops the duplicate constraints by itself, so they need not be sorted first
+void Andersen::streamConstraints()
+{
+	buildConstraintGraph(*streamedGraph, constraints, nodeFactory, ptsGraph);
+	NumConstraintsStreamed += constraints.size();
+	constraints.clear();
+}
 
-					// Now perform the store edge updates
-					for (auto const& mapping: updateMap)
-						cNode->replaceStoreEdge(mapping.first, mapping.second);
-				}
+/// solveConstraints - This stage iteratively processes the constraints list
+/// propagating constraints (adding edges to the Nodes in the points-to graph)
+/// until a fixed point is reached.
+///
+/// We use a variant of the technique called "Lazy Cycle Detection", which is
+/// described in "The Ant and the Grasshopper: Fast and Accurate Pointer
+/// Analysis for Millions of Lines of Code. In Programming Language Design and
+/// Implementation (PLDI), June 2007."
+/// The paper describes performing cycle detection one node at a time, which can
+/// be expensive if there are no cycles, but there are long chains of nodes that
+/// it heuristically believes are cycles (because it will DFS from each node
+/// without state from previous nodes).
+/// Instead, we use the heuristic to build a worklist of nodes to check, then
+/// cycle detect them all at the same time to do this more cheaply.  This
+/// catches cycles slightly later than the original technique did, but does it
+/// make significantly cheaper.
+///
+/// The sequential solving loop is WorkListSolver. It is instantiated once for
+/// each combination of -enable-hcd, -enable-lcd and -enable-diff-prop, so the
+/// features that are off cost neither a test nor any state inside the loop.
+///
+/// With -enable-diff-prop, each node remembers the part of its points-to set
+/// that it has already propagated, and a visit only feeds the new elements
+/// (the "delta") to its complex constraints and copy edges. New copy edges are
+/// brought up to date when they are inserted, and collapsed nodes forget what
+/// they have propagated so that their merged edges see the whole set.
+///
+/// With -anders-threads=N (N > 1, or 0 for one thread per hardware thread),
+/// the solving loop runs on N threads in bulk-synchronous rounds: every round
+/// processes the whole work list as a batch, and each node's copy edges and
+/// points-to set are only written by the thread that owns that node. Cycle
+/// detection and node collapsing stay sequential and run between rounds. See
+/// ParallelSolver for the details.
+///
+/// With -enable-wave, the work lists are replaced by the wave propagation
+/// solver (see WaveSolver), which collapses cycles by itself. Online HCD and
+/// LCD are not used in that mode.
+///
+/// With -enable-universal-top, a points-to set stops growing once it has the
+/// universal object (see unionPtsSets()). The pointers that may point to
+/// anything are reported as unknown by the queries anyway, so nothing is lost
+/// by not listing their other objects. The stores through them are another
+/// matter: they only reach the universal object, and the objects listed for
+/// the other pointers miss what is stored, which is why the option is off by
+/// default.
+///
+/// With -enable-partition, the constraints are first split into their weakly
+/// connected components, leaving the special nodes out, and the components are
+/// solved apart from each other on -anders-threads threads (see
+/// PartitionedSolver). The solver chosen by the other options then runs over
+/// their merged results, which only has work to do where the components meet
+/// through the special nodes or through the indirect calls resolved on the fly.
+void Andersen::solveConstraints()
+{
+	// The checkpoints are taken from the constraints as they are now, which is also what a resumed solving has to start from
+	std::unique_ptr<SolverCheckpointer> checkpointer;
+	std::unique_ptr<SolverCheckpoint> resumePoint;
+	// appendDefinitions() goes on from the graph and the sets the last solving ended with, the way a resumed solving goes on from its checkpoint
+	bool appending = appendState && appendState->graph;
+	if (!appending && (!SolverCheckpointFile.empty() || !SolverResumeFile.empty()))
+	{
+		const char* conflict = streamedGraph ? "-enable-constraint-streaming" : EnablePartition ? "-enable-partition" : EnableWave ? "-enable-wave" : EnableMatrixSolver ? "-anders-matrix-solver" : getNumWorkerThreads(NumSolverThreads) > 1 || EnablePullPropagation ? "the parallel solver" : EnableTypeFilter ? "-anders-type-filter" : nullptr;
+		if (conflict != nullptr)
+			errs() << "-anders-checkpoint and -anders-resume are not supported with " << conflict << " and will be ignored\n";
+		else
+		{
+			checkpointer.reset(new SolverCheckpointer(SolverCheckpoint::hashConstraints(nodeFactory.getNumNodes(), constraints, fieldConstraints)));
+			if (!SolverResumeFile.empty())
+			{
+				std::string error;
+				resumePoint = SolverCheckpoint::load(SolverResumeFile, checkpointer->getConstraintHash(), nodeFactory.getNumNodes(), error);
+				if (!resumePoint)
+					errs() << "Cannot resume from " << SolverResumeFile << ": " << error << ". Solving from the start\n";
+			}
+		}
+	}
 
-				DenseMap<NodeIndex, NodeIndex> updateMap;
-				// Finally, it's time to propagate pts-to info along the copy edges
-				for (auto const& dst: *cNode)
-				{
-					NodeIndex tgtNode = nodeFactory.getMergeTarget(dst);
-					if (node == tgtNode)
-						continue;
-					AndersPtsSet& tgtPtsSet = ptsGraph[tgtNode];
-					
-					//errs() << "pts[" << tgtNode << "] |= pts[" << node << "]\n";
-					bool isChanged =  tgtPtsSet.unionWith(ptsSet);
+	// We'll do offline HCD first. A checkpoint taken under HCD has its collapse targets, and its merges are restored below. A cancelled run has no collapse targets at all
+	std::unique_ptr<OfflineCycleDetector> offlineInfo;
+	if (EnableHCD && resumePoint && resumePoint->hasCollapseTargets())
+		offlineInfo.reset(new OfflineCycleDetector(nodeFactory, resumePoint->getCollapseTargets()));
+	else if (EnableHCD && !startPhase(AndersPhase::OfflineHCD))
+		offlineInfo.reset(new OfflineCycleDetector(nodeFactory, std::vector<NodeIndex>()));
+	else if (EnableHCD)
+	{
+		AndersPhaseTimer timer(AndersPhase::OfflineHCD);
+		offlineInfo.reset(new OfflineCycleDetector(constraints, nodeFactory));
+		offlineInfo->run();
+	}
+	if (checkpointer)
+		checkpointer->setOfflineInfo(offlineInfo.get());
+	if (offlineInfo)
+		hcdTableMemory = offlineInfo->getMemoryUsage();
 
-					if (isChanged)
-					{
-						nextWorkList->enqueue(tgtNode);
-					}
-					else if (EnableLCD)
-					{
-						// This is where we do lazy cycle detection.
-						// If this is a cycle candidate (equal points-to sets and this particular edge has not been cycle-checked previously), add to the list to check for cycles on the next iteration
-						auto edgePair = std::make_pair(node, tgtNode);
-						if (!checkedEdges.count(edgePair) && ptsSet == tgtPtsSet)
-						{
-							checkedEdges.insert(edgePair);
-							cycleCandidates.insert(tgtNode);
-						}
-					}
+	// The copies implied by others go before the graph is built. The type filter doesn't allow this: it filters a node's set when the node is popped (and once more at the end), so without a->c, c would only get what is left of a's set after b's filter, and lose the objects b's type drops but c's type keeps
+	if (EnableCopyReduction && !resumePoint)
+	{
+		if (EnableTypeFilter)
+			errs() << "-anders-reduce-copies is not supported with -anders-type-filter and will be ignored\n";
+		else
+			NumCopyEdgesReduced += reduceCopyConstraints(constraints, nodeFactory);
+	}
 
-					if (tgtNode != dst)
-						updateMap[dst] = tgtNode;
-				}
+	// The Steensgaard pre-analysis is only needed if the solver may have to stop early. It doesn't know about the calls the on-the-fly call graph resolves, so it can't stand in for the solver when there are any. When appending, it would only see the new constraints
+	std::unique_ptr<SteensgaardAnalysis> steensgaard;
+	if (EnableSteensgaardFallback && !appending && (SolverTimeBudget > 0 || SolverMemoryBudget > 0))
+	{
+		if (!indirectCalls.empty())
+			errs() << "-enable-steensgaard-fallback is not supported with the indirect calls of -enable-otf-callgraph and will be ignored\n";
+		else if (startPhase(AndersPhase::Steensgaard))
+		{
+			AndersPhaseTimer timer(AndersPhase::Steensgaard);
+			steensgaard.reset(new SteensgaardAnalysis(constraints, nodeFactory));
+			NumSteensgaardClasses += steensgaard->getNumClasses();
+		}
+	}
+
+	// Every NodeIndex we are going to see during solving is handed out by now. Size the points-to graph accordingly so that references to its sets stay valid throughout the solving loop
+	ptsGraph.resize(nodeFactory.getNumNodes());
+
+	// Now build the constraint graph. With -enable-constraint-streaming, the collection has built it already. With -enable-partition, the independent components build and solve their own graphs first, and the solver below starts from their merged results
+	ConstraintGraph constraintGraph;
+	bool graphBuilt = false;
+	startPhase(AndersPhase::GraphBuild);
+	if (resumePoint)
+	{
+		AndersPhaseTimer timer(AndersPhase::GraphBuild);
+		resumePoint->restore(nodeFactory, ptsGraph, constraintGraph);
+		checkpointer->setResumedWorkList(resumePoint->getWorkList());
+		resumePoint.reset();
+		graphBuilt = true;
+	}
+	else if (appending)
+	{
+		AndersPhaseTimer timer(AndersPhase::GraphBuild);
+		constraintGraph = std::move(*appendState->graph);
+		appendState->graph.reset();
+		ptsGraph = std::move(appendState->ptsGraph);
+		ptsGraph.resize(nodeFactory.getNumNodes());
+		buildConstraintGraph(constraintGraph, constraints, nodeFactory, ptsGraph);
+		// The last solution is a fixed point of the old constraints, so only the nodes that get a new object or a new edge have anything to do
+		std::vector<std::uint32_t> workList;
+		for (auto const& c: constraints)
+			workList.push_back(nodeFactory.getMergeTarget(c.getType() == AndersConstraint::ADDR_OF || c.getType() == AndersConstraint::STORE ? c.getDest() : c.getSrc()));
+		checkpointer.reset(new SolverCheckpointer(0));
+		checkpointer->setResumedWorkList(workList);
+		graphBuilt = true;
+	}
+	else if (streamedGraph)
+	{
+		constraintGraph = std::move(*streamedGraph);
+		streamedGraph.reset();
+		graphBuilt = true;
+	}
+	else if (EnablePartition && !isCancelRequested())
+	{
+		AndersPhaseTimer timer(AndersPhase::Solving);
+		PartitionedSolver partitioner(nodeFactory, ptsGraph, constraintGraph, offlineInfo.get(), getNumWorkerThreads(NumSolverThreads));
+		graphBuilt = partitioner.partition(constraints);
+		if (graphBuilt)
+			partitioner.run(SolverBudget());
+	}
+	if (!graphBuilt)
+	{
+		AndersPhaseTimer timer(AndersPhase::GraphBuild);
+		buildConstraintGraph(constraintGraph, constraints, nodeFactory, ptsGraph);
+	}
+	// Only the worklist solver follows the field edges. The collection makes none when another solver is chosen (see Andersen::canUseFieldConstraints()). A restored graph has them already
+	if (!checkpointer || !checkpointer->isResumed())
+	{
+		for (auto const& c: fieldConstraints)
+			constraintGraph.insertFieldEdge(nodeFactory.getMergeTarget(c.src), nodeFactory.getMergeTarget(c.dest), c.offset);
+	}
+	std::vector<AndersFieldConstraint>().swap(fieldConstraints);
+	solvingGraph = &constraintGraph;
+	// A value loaded through a top pointer may be anything as well. Letting the universal object point to itself makes the destinations of such loads top
+	if (usesTopSets())
+		makeTop(ptsGraph[nodeFactory.getMergeTarget(nodeFactory.getUniversalObjNode())]);
+	// The constraint vector is useless now
+	constraints.clear();
+
+	// Everything from here on, including the calls resolved at the fixed points, is online solving
+	startPhase(AndersPhase::Solving);
+	AndersPhaseTimer solvingTimer(AndersPhase::Solving);
+
+	// The wave solver sweeps the copy edges in topological order itself. The type filter has to see every set before it goes along a copy edge, and a resumed solving is past the start already
+	bool presolved = false;
+	if (EnablePreSolve && !EnableWave && !EnableTypeFilter && (!checkpointer || !checkpointer->isResumed()) && !isCancelRequested())
+	{
+		CopyPreSolver preSolver(nodeFactory, constraintGraph, ptsGraph);
+		NumPreSolveCollapses += preSolver.run();
+		presolved = true;
+	}
 
-				// Now perform the copy edge updates
-				for (auto const& mapping: updateMap)
-					cNode->replaceCopyEdge(mapping.first, mapping.second);
+	// With -enable-otf-callgraph, a fixed point is not final until resolving the indirect calls against it adds nothing new. The constraint vector is reused to hold the constraints of the calls resolved
+	FixedPointHook atFixedPoint = [this, &constraintGraph] (std::vector<NodeIndex>& changedNodes)
+	{
+		if (!resolveIndirectCalls())
+			return false;
+		insertResolvedCallEdges(constraints, constraintGraph, nodeFactory, ptsGraph, changedNodes);
+		constraints.clear();
+		// If no points-to set changes, the next round of resolution sees the same sets and finds nothing new
+		return !changedNodes.empty();
+	};
+
+	// When a budget runs out, stop where the solver is and give up on the precision of whatever may still change
+	SolverBudget budget(&runOptions, nodeFactory.getNumNodes());
+	std::vector<NodeIndex> pendingNodes;
+	auto degrade = [this, &budget, &pendingNodes, &constraintGraph, &steensgaard] ()
+	{
+		// The calls the on-the-fly call graph has not resolved yet may add copy edges into any of these
+		pendingNodes.insert(pendingNodes.end(), lateCopyTargets.begin(), lateCopyTargets.end());
+		unsigned numDegraded = degradePendingNodes(pendingNodes, nodeFactory, ptsGraph, constraintGraph, steensgaard.get());
+		NumBudgetDegradedNodes += numDegraded;
+		const char* fallback = steensgaard ? "their Steensgaard points-to sets" : "the universal object";
+		if (budget.isCancelled())
+		{
+			cancelled = true;
+			errs() << "The solving was cancelled: " << numDegraded << " nodes fall back to " << fallback << "\n";
+		}
+		else
+			errs() << "The solver ran out of its " << budget.getExceededBudget() << " budget: " << numDegraded << " nodes fall back to " << fallback << "\n";
+
+		// A call whose callee may now point to anything may reach any address-taken function
+		for (auto& call: indirectCalls)
+		{
+			const AndersPtsSet* calleePtsSet = ptsGraph.find(nodeFactory.getMergeTarget(call.callee));
+			if (calleePtsSet != nullptr && calleePtsSet->has(nodeFactory.getUniversalObjNode()))
+			{
+				call.unknownTarget = true;
+				call.targets.clear();
 			}
 		}
-		// Swap the current and the next worklist
-		std::swap(currWorkList, nextWorkList);
+	};
+
+	std::unique_ptr<SolverTrace> trace;
+	auto startTrace = [&trace] (const char* engine)
+	{
+		if (!SolverTraceFile.empty())
+			trace.reset(new SolverTrace(SolverTraceFile, engine));
+	};
+	// Every solver returns through here, while the constraint graph is still there
+	auto endSolving = [this, &budget, &constraintGraph] ()
+	{
+		solverWork += budget.getWork();
+		sampleMemoryUsage("the end of the solving");
+		if (appendState)
+			appendState->graph.reset(new ConstraintGraph(std::move(constraintGraph)));
+	};
+
+	if (EnableWave)
+	{
+		if (EnableOnlineEquiv)
+			errs() << "-enable-online-equiv is not supported by the wave solver and will be ignored\n";
+		if (EnableTypeFilter)
+			errs() << "-anders-type-filter is not supported by the wave solver and will be ignored\n";
+		startTrace("wave");
+		WaveSolver solver(nodeFactory, ptsGraph, constraintGraph, getNumWorkerThreads(NumSolverThreads));
+		if (!solver.run(atFixedPoint, budget, trace.get(), pendingNodes))
+			degrade();
+		endSolving();
+		return;
+	}
+
+	// The matrices hold plain sets, which top sets don't fit
+	if (EnableMatrixSolver && usesTopSets())
+		errs() << "-anders-matrix-solver does not support -enable-universal-top or -anders-pts-limit and will be ignored\n";
+	else if (EnableMatrixSolver)
+	{
+		if (EnableOnlineEquiv)
+			errs() << "-enable-online-equiv is not supported by the matrix solver and will be ignored\n";
+		if (EnableTypeFilter)
+			errs() << "-anders-type-filter is not supported by the matrix solver and will be ignored\n";
+		startTrace("matrix");
+		MatrixSolver solver(nodeFactory, ptsGraph, constraintGraph, getNumWorkerThreads(NumSolverThreads));
+		if (!solver.run(atFixedPoint, budget, trace.get(), pendingNodes))
+			degrade();
+		endSolving();
+		return;
+	}
+
+	// Decide the order in which the work lists are drained. The topological orders are computed once from the SCCs of the initial constraint graph
+	AndersWorkListOrder workListOrder(getWorkListPolicy(), nodeFactory.getNumNodes());
+	if (workListOrder.getPolicy() == AndersWorkListPolicy::TOPO || workListOrder.getPolicy() == AndersWorkListPolicy::DIVIDED)
+	{
+		TopologicalOrderer orderer(nodeFactory, constraintGraph, workListOrder);
+		orderer.run();
+	}
+
+	unsigned numThreads = getNumWorkerThreads(NumSolverThreads);
+	if (numThreads > 1 || EnablePullPropagation)
+	{
+		// Pull propagation is difference propagation already
+		if (EnableDiffProp && !EnablePullPropagation)
+			errs() << "-enable-diff-prop is not supported by the parallel solver and will be ignored\n";
+		if (EnableTypeFilter)
+			errs() << "-anders-type-filter is not supported by the parallel solver and will be ignored\n";
+		startTrace(EnablePullPropagation ? "pull" : "parallel");
+		ParallelSolver solver(nodeFactory, ptsGraph, constraintGraph, offlineInfo.get(), lateCopyTargets, workListOrder, numThreads);
+		if (!solver.run(atFixedPoint, budget, trace.get(), pendingNodes))
+			degrade();
+		endSolving();
+		return;
+	}
+
+	// The merges from here on keep the type classes up to date (see AndersNodeFactory::mergeNode()). The nodes the worklist leaves with a set they have not filtered yet are filtered once it is done
+	std::unique_ptr<AndersTypeFilter> typeFilter;
+	if (EnableTypeFilter)
+	{
+		typeFilter.reset(new AndersTypeFilter(nodeFactory));
+		NumTypeFilterClasses += typeFilter->getNumClasses();
+	}
+
+	if (HotNodeCount > 0 || FunctionCostCount > 0)
+		nodeProfile.reset(new SolverNodeProfile(nodeFactory.getNumNodes()));
+	if (FunctionCostCount > 0)
+		nodeProfile->enableCostTags(nodeFactory, costTagFunctions.size());
+	startTrace("worklist");
+	if (!getWorkListSolver()(nodeFactory, ptsGraph, constraintGraph, offlineInfo.get(), typeFilter.get(), checkpointer.get(), nodeProfile.get(), lateCopyTargets, workListOrder, atFixedPoint, budget, trace.get(), presolved, pendingNodes))
+		degrade();
+
+	if (typeFilter)
+	{
+		for (auto node: ptsGraph)
+			if (nodeFactory.getMergeTarget(node) == node)
+				NumTypeFilteredObjs += typeFilter->filter(nodeFactory, node, ptsGraph[node]);
+		nodeFactory.setTypeClasses(std::vector<unsigned>());
 	}
+	endSolving();
 }
@@ -0,0 +1,711 @@
+#include "Andersen.h"
+#include "ConstraintSummary.h"
+#include "PersistedResults.h"
+
+#include "llvm/ADT/MapVector.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+using namespace llvm;
+
+extern cl::opt<bool> EnableOnTheFlyCallGraph;
+
+namespace
+{
+	struct SummaryHeader
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint64_t moduleHash;
+		std::uint32_t numNodes;
+		std::uint32_t numObjectNodes;
+		std::uint32_t numValues;
+		std::uint32_t numConstraints;
+		std::uint32_t numFallbackConstraints;
+		std::uint32_t numSymbols;
+		std::uint32_t numExternalCalls;
+		std::uint32_t numIndirectCalls;
+		// The 32-bit words of the symbols and the calls
+		std::uint32_t numRecordWords;
+		std::uint32_t numNameBytes;
+	};
+
+	enum: std::uint32_t { SymbolFunction = 1, SymbolDefinition = 2, SymbolLocal = 4, SymbolVarArg = 8 };
+
+	// Reads the words of a summary one at a time. Running past the end is remembered rather than checked at every step
+	class WordReader
+	{
+	private:
+		const char* pos;
+		const char* end;
+		bool overrun = false;
+	public:
+		WordReader(const char* b, const char* e): pos(b), end(e) {}
+
+		std::uint32_t next()
+		{
+			std::uint32_t word = 0;
+			if (end - pos < static_cast<std::ptrdiff_t>(sizeof(word)))
+			{
+				overrun = true;
+				return word;
+			}
+			std::memcpy(&word, pos, sizeof(word));
+			pos += sizeof(word);
+			return word;
+		}
+		std::uint64_t next64()
+		{
+			std::uint64_t low = next();
+			return low | (static_cast<std::uint64_t>(next()) << 32);
+		}
+		bool hasOverrun() const { return overrun; }
+		bool atEnd() const { return pos == end; }
+	};
+}
+
+void ConstraintSummary::write(raw_ostream& os) const
+{
+	// The records and the names are put together first, since the header holds their sizes
+	std::vector<std::uint32_t> words;
+	std::string names;
+	auto addName = [&words, &names] (const std::string& name)
+	{
+		words.push_back(names.size());
+		words.push_back(name.size());
+		names += name;
+	};
+	for (auto const& sym: symbols)
+	{
+		addName(sym.name);
+		words.push_back((sym.isFunction ? SymbolFunction : 0) | (sym.isDefinition ? SymbolDefinition : 0) | (sym.isLocal ? SymbolLocal : 0) | (sym.isVarArg ? SymbolVarArg : 0));
+		words.insert(words.end(), { sym.valueNode, sym.objectNode, sym.returnNode, sym.varargNode, sym.extKind, sym.position, static_cast<std::uint32_t>(sym.params.size()) });
+		words.insert(words.end(), sym.params.begin(), sym.params.end());
+	}
+	for (auto const& call: externalCalls)
+	{
+		addName(call.callee);
+		words.insert(words.end(), { call.result, call.fallbackBegin, call.fallbackEnd, static_cast<std::uint32_t>(call.args.size()) });
+		words.insert(words.end(), call.args.begin(), call.args.end());
+	}
+	for (auto const& call: indirectCalls)
+	{
+		words.insert(words.end(), { call.result, static_cast<std::uint32_t>(call.args.size()) });
+		words.insert(words.end(), call.args.begin(), call.args.end());
+	}
+
+	SummaryHeader header = { Magic, Version, moduleHash, numNodes, static_cast<std::uint32_t>(objectNodes.size()), static_cast<std::uint32_t>(valueNodeOf.size()), static_cast<std::uint32_t>(constraints.size()), static_cast<std::uint32_t>(fallbackConstraints.size()), static_cast<std::uint32_t>(symbols.size()), static_cast<std::uint32_t>(externalCalls.size()), static_cast<std::uint32_t>(indirectCalls.size()), static_cast<std::uint32_t>(words.size()), static_cast<std::uint32_t>(names.size()) };
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (auto const* list: { &constraints, &fallbackConstraints })
+		for (auto const& c: *list)
+		{
+			std::uint64_t key = c.getPackedKey();
+			os.write(reinterpret_cast<const char*>(&key), sizeof(key));
+		}
+	for (auto const* list: { &objectNodes, &valueNodeOf, &valueOfNode })
+		os.write(reinterpret_cast<const char*>(list->data()), list->size() * sizeof(std::uint32_t));
+	os.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(std::uint32_t));
+	os.write(names.data(), names.size());
+}
+
+std::unique_ptr<ConstraintSummary> ConstraintSummary::read(StringRef fileName, std::string& error)
+{
+	auto fileOrErr = MemoryBuffer::getFile(fileName, -1, false);
+	if (!fileOrErr)
+	{
+		error = "cannot read " + fileName.str() + ": " + fileOrErr.getError().message();
+		return nullptr;
+	}
+	return read(**fileOrErr, error);
+}
+
+std::unique_ptr<ConstraintSummary> ConstraintSummary::read(const MemoryBuffer& buffer, std::string& error)
+{
+	// The summary is decoded into its own vectors, so the words are copied out one by one and need no alignment
+	SummaryHeader header;
+	if (buffer.getBufferSize() < sizeof(header))
+	{
+		error = "truncated header";
+		return nullptr;
+	}
+	std::memcpy(&header, buffer.getBufferStart(), sizeof(header));
+	if (header.magic != Magic)
+	{
+		error = "not a constraint summary, or written on a machine of another byte order";
+		return nullptr;
+	}
+	if (header.version != Version)
+	{
+		error = "unsupported version " + std::to_string(header.version);
+		return nullptr;
+	}
+	std::uint64_t numWords = 2 * (static_cast<std::uint64_t>(header.numConstraints) + header.numFallbackConstraints) + header.numObjectNodes + header.numValues + header.numNodes + header.numRecordWords;
+	if (buffer.getBufferSize() != sizeof(header) + numWords * sizeof(std::uint32_t) + header.numNameBytes)
+	{
+		error = "the size of the file doesn't match its header";
+		return nullptr;
+	}
+
+	std::unique_ptr<ConstraintSummary> ret(new ConstraintSummary);
+	ret->numNodes = header.numNodes;
+	ret->moduleHash = header.moduleHash;
+	unsigned numNodes = header.numNodes;
+	auto isValidNode = [numNodes] (std::uint32_t n) { return n < numNodes || n == AndersNodeFactory::InvalidIndex; };
+
+	const char* namesStart = buffer.getBufferEnd() - header.numNameBytes;
+	WordReader reader(buffer.getBufferStart() + sizeof(header), namesStart);
+	for (auto* list: { &ret->constraints, &ret->fallbackConstraints })
+	{
+		unsigned count = (list == &ret->constraints) ? header.numConstraints : header.numFallbackConstraints;
+		list->reserve(count);
+		for (unsigned i = 0; i < count; ++i)
+		{
+			AndersConstraint c = AndersConstraint::fromPackedKey(reader.next64());
+			if (c.getDest() >= numNodes || c.getSrc() >= numNodes)
+			{
+				error = "a constraint refers to a node that doesn't exist";
+				return nullptr;
+			}
+			list->push_back(c);
+		}
+	}
+	for (unsigned i = 0; i < header.numObjectNodes; ++i)
+	{
+		NodeIndex n = reader.next();
+		if (n >= numNodes || (i > 0 && n <= ret->objectNodes.back()))
+		{
+			error = "the object nodes are out of range or not sorted";
+			return nullptr;
+		}
+		ret->objectNodes.push_back(n);
+	}
+	for (unsigned i = 0; i < header.numValues; ++i)
+	{
+		std::uint32_t n = reader.next();
+		if (n != NoEntry && n >= numNodes)
+		{
+			error = "a value refers to a node that doesn't exist";
+			return nullptr;
+		}
+		ret->valueNodeOf.push_back(n);
+	}
+	for (unsigned i = 0; i < numNodes; ++i)
+	{
+		std::uint32_t position = reader.next();
+		if (position != NoEntry && position >= header.numValues)
+		{
+			error = "a node refers to a value that doesn't exist";
+			return nullptr;
+		}
+		ret->valueOfNode.push_back(position);
+	}
+
+	// The counts come from the file, so the lists are only reserved once they are known to fit in it
+	auto readNodes = [&reader, &isValidNode, &header] (std::vector<NodeIndex>& nodes)
+	{
+		std::uint32_t count = reader.next();
+		if (count > header.numRecordWords)
+			return false;
+		nodes.reserve(count);
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			nodes.push_back(reader.next());
+			if (!isValidNode(nodes.back()))
+				return false;
+		}
+		return true;
+	};
+	auto readName = [&reader, &header, namesStart] (std::string& name)
+	{
+		std::uint32_t offset = reader.next();
+		std::uint32_t length = reader.next();
+		if (offset > header.numNameBytes || length > header.numNameBytes - offset)
+			return false;
+		name.assign(namesStart + offset, length);
+		return true;
+	};
+	for (unsigned i = 0; i < header.numSymbols && !reader.hasOverrun(); ++i)
+	{
+		Symbol sym;
+		bool valid = readName(sym.name);
+		std::uint32_t flags = reader.next();
+		sym.isFunction = flags & SymbolFunction;
+		sym.isDefinition = flags & SymbolDefinition;
+		sym.isLocal = flags & SymbolLocal;
+		sym.isVarArg = flags & SymbolVarArg;
+		sym.valueNode = reader.next();
+		sym.objectNode = reader.next();
+		sym.returnNode = reader.next();
+		sym.varargNode = reader.next();
+		sym.extKind = reader.next();
+		sym.position = reader.next();
+		if (!valid || sym.position >= header.numValues || !isValidNode(sym.valueNode) || !isValidNode(sym.objectNode) || !isValidNode(sym.returnNode) || !isValidNode(sym.varargNode) || !readNodes(sym.params))
+		{
+			error = "symbol " + std::to_string(i) + " is malformed";
+			return nullptr;
+		}
+		ret->symbols.push_back(std::move(sym));
+	}
+	for (unsigned i = 0; i < header.numExternalCalls && !reader.hasOverrun(); ++i)
+	{
+		ExternalCall call;
+		bool valid = readName(call.callee);
+		call.result = reader.next();
+		call.fallbackBegin = reader.next();
+		call.fallbackEnd = reader.next();
+		if (!valid || !isValidNode(call.result) || call.fallbackBegin > call.fallbackEnd || call.fallbackEnd > header.numFallbackConstraints || !readNodes(call.args))
+		{
+			error = "external call " + std::to_string(i) + " is malformed";
+			return nullptr;
+		}
+		ret->externalCalls.push_back(std::move(call));
+	}
+	for (unsigned i = 0; i < header.numIndirectCalls && !reader.hasOverrun(); ++i)
+	{
+		IndirectCall call;
+		call.result = reader.next();
+		if (!isValidNode(call.result) || !readNodes(call.args))
+		{
+			error = "indirect call " + std::to_string(i) + " is malformed";
+			return nullptr;
+		}
+		ret->indirectCalls.push_back(std::move(call));
+	}
+	if (reader.hasOverrun() || !reader.atEnd())
+	{
+		error = "the records don't match their size in the header";
+		return nullptr;
+	}
+	return ret;
+}
+
+void Andersen::getCallArgNodes(ImmutableCallSite cs, std::vector<NodeIndex>& args) const
+{
+	for (ImmutableCallSite::arg_iterator itr = cs.arg_begin(), ite = cs.arg_end(); itr != ite; ++itr)
+	{
+		NodeIndex argIndex = AndersNodeFactory::InvalidIndex;
+		if ((*itr)->getType()->isPointerTy())
+		{
+			argIndex = nodeFactory.getValueNodeFor(*itr);
+			assert(argIndex != AndersNodeFactory::InvalidIndex && "Failed to find arg node!");
+		}
+		args.push_back(argIndex);
+	}
+}
+
+// Record the direct call to the declared function f for the linker. The constraints the collection added for it from firstConstraint on are moved aside, to be used only if no module defines f
+void Andersen::deferExternalCall(ImmutableCallSite cs, const Function* f, unsigned firstConstraint, CollectionBuffer& buffer) const
+{
+	ConstraintSummary::ExternalCall call;
+	call.callee = f->getName().str();
+	call.result = cs.getType()->isPointerTy() ? nodeFactory.getValueNodeFor(cs.getInstruction()) : AndersNodeFactory::InvalidIndex;
+	getCallArgNodes(cs, call.args);
+	call.fallbackBegin = buffer.fallbackConstraints.size();
+	buffer.fallbackConstraints.insert(buffer.fallbackConstraints.end(), buffer.constraints.begin() + firstConstraint, buffer.constraints.end());
+	buffer.constraints.erase(buffer.constraints.begin() + firstConstraint, buffer.constraints.end());
+	call.fallbackEnd = buffer.fallbackConstraints.size();
+	buffer.externalCalls.push_back(std::move(call));
+}
+
+std::unique_ptr<ConstraintSummary> Andersen::summarize(const Module& m, std::string& error)
+{
+	if (EnableOnTheFlyCallGraph)
+	{
+		error = "-enable-otf-callgraph resolves the calls through the call instructions, which a summary doesn't keep";
+		return nullptr;
+	}
+
+	Andersen anders;
+	anders.summary.reset(new ConstraintSummary);
+	anders.collectConstraints(m);
+	anders.fillSummary(m);
+	return std::move(anders.summary);
+}
+
+// Put the nodes, the constraints, the symbols and the values of m into the summary. The calls are there already
+void Andersen::fillSummary(const Module& m)
+{
+	ConstraintSummary& s = *summary;
+	s.numNodes = nodeFactory.getNumNodes();
+	for (NodeIndex n = 0; n < s.numNodes; ++n)
+		if (nodeFactory.isObjectNode(n))
+			s.objectNodes.push_back(n);
+	s.constraints = std::move(constraints);
+	constraints.clear();
+
+	std::vector<const Value*> values;
+	PersistedResultsFormat::enumerateValues(m, values);
+	DenseMap<const Value*, unsigned> valueIds;
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+		valueIds[values[i]] = i;
+
+	// An unnamed global can't be referred to from another module, even if it's not local
+	for (auto const& g: m.globals())
+	{
+		if (g.hasLocalLinkage() || !g.hasName())
+			continue;
+		s.symbols.push_back(ConstraintSummary::Symbol{ g.getName().str(), false, !g.isDeclaration(), false, false, nodeFactory.getValueNodeFor(&g), nodeFactory.getObjectNodeFor(&g), AndersNodeFactory::InvalidIndex, AndersNodeFactory::InvalidIndex, {}, EXT_UNKNOWN, valueIds.lookup(&g) });
+	}
+	for (auto const& f: m)
+	{
+		NodeIndex fObj = nodeFactory.getObjectNodeFor(&f);
+		bool isLocal = f.hasLocalLinkage() || !f.hasName();
+		if (f.isIntrinsic() || (isLocal && fObj == AndersNodeFactory::InvalidIndex))
+			continue;
+
+		ConstraintSummary::Symbol sym{ f.getName().str(), true, !f.isDeclaration(), isLocal, f.getFunctionType()->isVarArg(), nodeFactory.getValueNodeFor(&f), fObj, AndersNodeFactory::InvalidIndex, AndersNodeFactory::InvalidIndex, {}, EXT_UNKNOWN, valueIds.lookup(&f) };
+		if (f.isDeclaration())
+		{
+			sym.extKind = externalLibraryKinds.lookup(&f);
+			sym.params.resize(f.arg_size(), AndersNodeFactory::InvalidIndex);
+		}
+		else
+		{
+			sym.returnNode = nodeFactory.getReturnNodeFor(&f);
+			sym.varargNode = nodeFactory.getVarargNodeFor(&f);
+			for (auto const& arg: f.args())
+				sym.params.push_back(arg.getType()->isPointerTy() ? nodeFactory.getValueNodeFor(&arg) : AndersNodeFactory::InvalidIndex);
+		}
+		s.symbols.push_back(std::move(sym));
+	}
+
+	s.valueNodeOf.resize(values.size(), ConstraintSummary::NoEntry);
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+	{
+		NodeIndex valNode = nodeFactory.getValueNodeFor(values[i]);
+		if (valNode != AndersNodeFactory::InvalidIndex)
+			s.valueNodeOf[i] = valNode;
+	}
+	s.valueOfNode.resize(s.numNodes, ConstraintSummary::NoEntry);
+	for (NodeIndex n = 0; n < s.numNodes; ++n)
+	{
+		if (const Value* val = nodeFactory.getValueForNode(n))
+		{
+			auto itr = valueIds.find(val);
+			if (itr != valueIds.end())
+				s.valueOfNode[n] = itr->second;
+		}
+	}
+	s.moduleHash = PersistedResultsFormat::hashModuleLayout(m, values.size());
+}
+
+std::unique_ptr<Andersen> Andersen::createFromSummaries(ArrayRef<const ConstraintSummary*> summaries, std::string& error)
+{
+	std::unique_ptr<Andersen> ret(new Andersen());
+	if (!ret->linkSummaries(summaries, error))
+		return nullptr;
+	ret->solveCollectedConstraints();
+	return ret;
+}
+
+// A function as the linker sees it, with the linked nodes of its definition
+struct Andersen::LinkedFunction
+{
+	bool isDefined;
+	bool isVarArg;
+	ExternalLibraryKind extKind;
+	NodeIndex objectNode;
+	NodeIndex returnNode;
+	NodeIndex varargNode;
+	std::vector<NodeIndex> params;
+};
+
+bool Andersen::linkSummaries(ArrayRef<const ConstraintSummary*> summaries, std::string& error)
+{
+	// Lay the nodes of the modules out one after the other. The special nodes already exist, and all the modules share them
+	unsigned numSpecialNodes = nodeFactory.getNumNodes();
+	std::vector<NodeIndex> bases;
+	for (unsigned i = 0, e = summaries.size(); i < e; ++i)
+	{
+		const ConstraintSummary& s = *summaries[i];
+		if (s.numNodes < numSpecialNodes || nodeFactory.getNumNodes() - numSpecialNodes + s.numNodes >= ProvisionalIndexBase)
+		{
+			error = "bad number of nodes in summary " + std::to_string(i);
+			return false;
+		}
+		bases.push_back(nodeFactory.getNumNodes() - numSpecialNodes);
+		auto nextObj = s.objectNodes.begin();
+		for (NodeIndex n = 0; n < s.numNodes; ++n)
+		{
+			bool isObject = nextObj != s.objectNodes.end() && *nextObj == n;
+			if (isObject)
+				++nextObj;
+
+			if (n < numSpecialNodes)
+			{
+				if (isObject != nodeFactory.isObjectNode(n))
+				{
+					error = "the special nodes of summary " + std::to_string(i) + " don't match";
+					return false;
+				}
+			}
+			else if (isObject)
+				nodeFactory.createObjectNode();
+			else
+				nodeFactory.createValueNode();
+		}
+	}
+	auto getLinkedNode = [&bases, numSpecialNodes] (unsigned module, NodeIndex n)
+	{
+		return (n == AndersNodeFactory::InvalidIndex || n < numSpecialNodes) ? n : bases[module] + n;
+	};
+
+	// The symbols of one name become one: every node of an occurrence is redirected to the node of the definition, or of the first occurrence that has one. The constraints are rewritten with the redirections, so no node has to be merged
+	std::vector<NodeIndex> remap(nodeFactory.getNumNodes());
+	for (NodeIndex n = 0, e = remap.size(); n < e; ++n)
+		remap[n] = n;
+	auto getNode = [&remap, &getLinkedNode] (unsigned module, NodeIndex n)
+	{
+		n = getLinkedNode(module, n);
+		return n == AndersNodeFactory::InvalidIndex ? n : remap[n];
+	};
+
+	typedef std::pair<unsigned, const ConstraintSummary::Symbol*> SymbolRef;
+	MapVector<StringRef, std::vector<SymbolRef>> symbolsByName;
+	std::vector<SymbolRef> localFunctions;
+	for (unsigned i = 0, e = summaries.size(); i < e; ++i)
+		for (auto const& sym: summaries[i]->symbols)
+		{
+			if (sym.extKind > EXT_VA_START)
+			{
+				error = "symbol " + sym.name + " of summary " + std::to_string(i) + " has an unknown library model";
+				return false;
+			}
+			if (sym.isLocal)
+				localFunctions.emplace_back(i, &sym);
+			else
+				symbolsByName[sym.name].emplace_back(i, &sym);
+		}
+
+	StringMap<LinkedFunction> functionsByName;
+	std::vector<LinkedFunction> addressTakenFunctions;
+	// A module that refers to a function without taking its address has no node for it. The nodes of the other modules stand for it in the results of the module: (position, value node, object node) for each module
+	std::vector<std::vector<std::tuple<std::uint32_t, NodeIndex, NodeIndex>>> borrowedNodes(summaries.size());
+	for (auto const& entry: symbolsByName)
+	{
+		auto const& occurrences = entry.second;
+		const SymbolRef* def = nullptr;
+		for (auto const& occurrence: occurrences)
+		{
+			if (occurrence.second->isFunction != occurrences.front().second->isFunction)
+			{
+				error = "symbol " + entry.first.str() + " is a function in one module and a variable in another";
+				return false;
+			}
+			if (def == nullptr && occurrence.second->isDefinition)
+				def = &occurrence;
+		}
+
+		auto redirect = [&] (NodeIndex ConstraintSummary::Symbol::*field)
+		{
+			NodeIndex canonical = AndersNodeFactory::InvalidIndex;
+			if (def != nullptr)
+				canonical = getLinkedNode(def->first, def->second->*field);
+			for (auto itr = occurrences.begin(), ite = occurrences.end(); itr != ite && canonical == AndersNodeFactory::InvalidIndex; ++itr)
+				canonical = getLinkedNode(itr->first, itr->second->*field);
+			for (auto const& occurrence: occurrences)
+			{
+				NodeIndex n = getLinkedNode(occurrence.first, occurrence.second->*field);
+				if (n != AndersNodeFactory::InvalidIndex)
+					remap[n] = canonical;
+			}
+			return canonical;
+		};
+		NodeIndex valueNode = redirect(&ConstraintSummary::Symbol::valueNode);
+		NodeIndex objectNode = redirect(&ConstraintSummary::Symbol::objectNode);
+		if (objectNode != AndersNodeFactory::InvalidIndex)
+		{
+			for (auto const& occurrence: occurrences)
+				if (occurrence.second->objectNode == AndersNodeFactory::InvalidIndex)
+					borrowedNodes[occurrence.first].emplace_back(occurrence.second->position, valueNode, objectNode);
+		}
+
+		if (!occurrences.front().second->isFunction)
+		{
+			// As in collectConstraintsForGlobals(), a variable no module defines may point to anything
+			if (def == nullptr && objectNode != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::COPY, objectNode, nodeFactory.getUniversalObjNode());
+			continue;
+		}
+
+		// A function defined more than once (e.g. an inline function of a header) is one function as well
+		if (def != nullptr)
+		{
+			redirect(&ConstraintSummary::Symbol::returnNode);
+			redirect(&ConstraintSummary::Symbol::varargNode);
+			auto const& defParams = def->second->params;
+			for (auto const& occurrence: occurrences)
+			{
+				if (!occurrence.second->isDefinition)
+					continue;
+				for (unsigned k = 0, e = std::min(defParams.size(), occurrence.second->params.size()); k < e; ++k)
+				{
+					NodeIndex n = getLinkedNode(occurrence.first, occurrence.second->params[k]);
+					NodeIndex canonical = getLinkedNode(def->first, defParams[k]);
+					if (n != AndersNodeFactory::InvalidIndex && canonical != AndersNodeFactory::InvalidIndex)
+						remap[n] = canonical;
+				}
+			}
+		}
+
+		const ConstraintSummary::Symbol& sym = *(def != nullptr ? def : &occurrences.front())->second;
+		unsigned module = (def != nullptr ? def : &occurrences.front())->first;
+		// The nodes of the definition are the ones the others have been redirected to
+		LinkedFunction func = { def != nullptr, sym.isVarArg, static_cast<ExternalLibraryKind>(sym.extKind), objectNode, getLinkedNode(module, sym.returnNode), getLinkedNode(module, sym.varargNode), {} };
+		for (NodeIndex param: sym.params)
+			func.params.push_back(getLinkedNode(module, param));
+		if (objectNode != AndersNodeFactory::InvalidIndex)
+			addressTakenFunctions.push_back(func);
+		functionsByName[entry.first] = std::move(func);
+	}
+	for (auto const& local: localFunctions)
+	{
+		const ConstraintSummary::Symbol& sym = *local.second;
+		LinkedFunction func = { sym.isDefinition, sym.isVarArg, static_cast<ExternalLibraryKind>(sym.extKind), getLinkedNode(local.first, sym.objectNode), getLinkedNode(local.first, sym.returnNode), getLinkedNode(local.first, sym.varargNode), {} };
+		for (NodeIndex param: sym.params)
+			func.params.push_back(getLinkedNode(local.first, param));
+		addressTakenFunctions.push_back(std::move(func));
+	}
+
+	for (unsigned i = 0, e = summaries.size(); i < e; ++i)
+	{
+		const ConstraintSummary& s = *summaries[i];
+		for (auto const& c: s.constraints)
+			constraints.emplace_back(c.getType(), getNode(i, c.getDest()), getNode(i, c.getSrc()));
+
+		std::vector<NodeIndex> args;
+		for (auto const& call: s.externalCalls)
+		{
+			args.clear();
+			for (NodeIndex arg: call.args)
+				args.push_back(getNode(i, arg));
+			auto itr = functionsByName.find(call.callee);
+			if (itr != functionsByName.end() && itr->second.isDefined)
+				addLinkedCallConstraints(itr->second, getNode(i, call.result), args);
+			else
+			{
+				for (unsigned k = call.fallbackBegin; k < call.fallbackEnd; ++k)
+				{
+					auto const& c = s.fallbackConstraints[k];
+					constraints.emplace_back(c.getType(), getNode(i, c.getDest()), getNode(i, c.getSrc()));
+				}
+			}
+		}
+
+		// As in the collection without a summary, an indirect call may reach every address-taken function that takes its number of arguments. Its value is the universal pointer already
+		for (auto const& call: s.indirectCalls)
+		{
+			args.clear();
+			for (NodeIndex arg: call.args)
+				args.push_back(getNode(i, arg));
+			for (auto const& target: addressTakenFunctions)
+			{
+				if (!target.isVarArg && target.params.size() != args.size())
+					continue;
+				if (target.isDefined)
+					addLinkedCallConstraints(target, AndersNodeFactory::InvalidIndex, args);
+				else
+					addLinkedLibraryConstraints(target.extKind, getNode(i, call.result), args);
+			}
+		}
+
+		LinkedModule linked;
+		linked.moduleHash = s.moduleHash;
+		linked.valueNodeOf.reserve(s.valueNodeOf.size());
+		for (std::uint32_t n: s.valueNodeOf)
+			linked.valueNodeOf.push_back(n == ConstraintSummary::NoEntry ? n : getNode(i, n));
+		for (NodeIndex n = 0; n < s.numNodes; ++n)
+			if (s.valueOfNode[n] != ConstraintSummary::NoEntry)
+				linked.valueOfNode.emplace_back(getNode(i, n), s.valueOfNode[n]);
+		for (auto const& borrowed: borrowedNodes[i])
+		{
+			linked.valueNodeOf[std::get<0>(borrowed)] = std::get<1>(borrowed);
+			linked.valueOfNode.emplace_back(std::get<2>(borrowed), std::get<0>(borrowed));
+		}
+		linkedModules.push_back(std::move(linked));
+	}
+
+	uniquifyConstraints(constraints);
+	return true;
+}
+
+// The constraints of addConstraintForCall() and addArgumentConstraintForCall() for a call to a function another module defines. A result of InvalidIndex leaves the value of the call alone
+void Andersen::addLinkedCallConstraints(const LinkedFunction& target, NodeIndex result, ArrayRef<NodeIndex> args)
+{
+	if (result != AndersNodeFactory::InvalidIndex)
+	{
+		// The modules may disagree on the type of the function. A value the definition doesn't return may be anything
+		NodeIndex retIndex = target.returnNode != AndersNodeFactory::InvalidIndex ? target.returnNode : nodeFactory.getUniversalPtrNode();
+		constraints.emplace_back(AndersConstraint::COPY, result, retIndex);
+	}
+	for (unsigned k = 0, e = std::min(target.params.size(), args.size()); k < e; ++k)
+	{
+		if (target.params[k] == AndersNodeFactory::InvalidIndex)
+			continue;
+		NodeIndex argIndex = args[k] != AndersNodeFactory::InvalidIndex ? args[k] : nodeFactory.getUniversalPtrNode();
+		constraints.emplace_back(AndersConstraint::COPY, target.params[k], argIndex);
+	}
+	if (target.varargNode != AndersNodeFactory::InvalidIndex)
+	{
+		for (unsigned k = target.params.size(), e = args.size(); k < e; ++k)
+			if (args[k] != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::COPY, target.varargNode, args[k]);
+	}
+}
+
+// The constraints of addConstraintForExternalLibrary() for an indirect call that may reach a library function, from the nodes of the call alone. Without the IR, realloc() and the conversion functions can't tell a null first argument apart, and are modeled as if it could be either
+void Andersen::addLinkedLibraryConstraints(ExternalLibraryKind kind, NodeIndex result, ArrayRef<NodeIndex> args)
+{
+	auto getArg = [args] (unsigned k) { return k < args.size() ? args[k] : AndersNodeFactory::InvalidIndex; };
+	switch (kind)
+	{
+		case EXT_NOOP:
+		case EXT_VA_START:
+			break;
+		case EXT_MALLOC:
+		case EXT_REALLOC:
+		{
+			NodeIndex objIndex = nodeFactory.createObjectNode();
+			if (result != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::ADDR_OF, result, objIndex);
+			else if (getArg(0) != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::STORE, getArg(0), objIndex);
+			if (kind == EXT_REALLOC && result != AndersNodeFactory::InvalidIndex && getArg(0) != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::COPY, result, getArg(0));
+			break;
+		}
+		case EXT_RET_ARG0:
+		case EXT_RET_ARG1:
+		case EXT_RET_ARG2:
+		{
+			NodeIndex argIndex = getArg(kind - EXT_RET_ARG0);
+			if (result != AndersNodeFactory::InvalidIndex && argIndex != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::COPY, result, argIndex);
+			break;
+		}
+		case EXT_MEMCPY:
+			if (getArg(0) != AndersNodeFactory::InvalidIndex && getArg(1) != AndersNodeFactory::InvalidIndex)
+			{
+				NodeIndex tempIndex = nodeFactory.createValueNode();
+				constraints.emplace_back(AndersConstraint::LOAD, tempIndex, getArg(1));
+				constraints.emplace_back(AndersConstraint::STORE, getArg(0), tempIndex);
+				if (result != AndersNodeFactory::InvalidIndex)
+					constraints.emplace_back(AndersConstraint::COPY, result, getArg(0));
+			}
+			break;
+		case EXT_CONVERT:
+			if (getArg(0) != AndersNodeFactory::InvalidIndex && getArg(1) != AndersNodeFactory::InvalidIndex)
+				constraints.emplace_back(AndersConstraint::STORE, getArg(0), getArg(1));
+			break;
+		case EXT_UNKNOWN:
+			// Unresolved library call: ruin everything!
+			for (NodeIndex argIndex: args)
+				if (argIndex != AndersNodeFactory::InvalidIndex)
+					constraints.emplace_back(AndersConstraint::COPY, argIndex, nodeFactory.getUniversalPtrNode());
+			break;
+	}
+}
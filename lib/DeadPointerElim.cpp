@@ -0,0 +1,193 @@
+#include "Andersen.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+cl::opt<bool> EnableDeadPointerElim("enable-dead-pointer-elim", cl::desc("Drop the constraints that can't reach any pointer the loads, stores and calls of the module use before solving. The other pointers are no longer known to the analysis"));
+
+extern cl::opt<bool> EnableIncremental;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumDeadConstraints, "Number of constraints dropped by dead pointer elimination");
+STATISTIC(NumDeadPointers, "Number of pointers forgotten by dead pointer elimination");
+
+std::unique_ptr<Andersen> Andersen::createForQueries(const Module& m, ArrayRef<const Value*> queries, std::string& error)
+{
+	if (EnableIncremental)
+	{
+		error = "-anders-incremental retracts the constraints of a function from the full list, which dead pointer elimination cuts short";
+		return nullptr;
+	}
+
+	std::unique_ptr<Andersen> ret(new Andersen());
+	ret->pruneForQueries = true;
+	ret->queriedValues.assign(queries.begin(), queries.end());
+	ret->runOnModule(m);
+	return ret;
+}
+
+// The pointers an alias analysis client asks about are almost always those the memory accesses and the calls use: whether two accesses may touch the same memory, and what a call may read or write through its arguments
+void Andersen::findQueryRoots(const Module& m)
+{
+	auto addRoot = [this] (const Value* v)
+	{
+		if (!v->getType()->isPointerTy())
+			return;
+		NodeIndex n = nodeFactory.getValueNodeFor(v);
+		if (n != AndersNodeFactory::InvalidIndex)
+			queryRoots.push_back(n);
+	};
+
+	for (auto v: queriedValues)
+		addRoot(v);
+	std::vector<const Value*>().swap(queriedValues);
+
+	for (auto const& f: m)
+	{
+		for (auto const& bb: f)
+		{
+			for (auto const& inst: bb)
+			{
+				if (const LoadInst* load = dyn_cast<LoadInst>(&inst))
+					addRoot(load->getPointerOperand());
+				else if (const StoreInst* store = dyn_cast<StoreInst>(&inst))
+				{
+					addRoot(store->getPointerOperand());
+					addRoot(store->getValueOperand());
+				}
+				else if (ImmutableCallSite cs = ImmutableCallSite(&inst))
+				{
+					addRoot(cs.getCalledValue());
+					for (ImmutableCallSite::arg_iterator itr = cs.arg_begin(), ite = cs.arg_end(); itr != ite; ++itr)
+						addRoot(*itr);
+				}
+			}
+		}
+	}
+}
+
+// A node is live if its points-to set may be asked for, or may flow into the set of a live node. Every object is live, since the loads may read whatever is stored into it, and so are the pointers the loads and the stores go through and the values stored. The rest is found backwards from them along the copies (and the field constraints, which are copies with an offset): the source of a copy into a live node is live
+// A constraint into a dead node is dropped, except for the stores, whose destination is live anyway. The dead nodes then have no outgoing constraints either, so the sets of the live nodes come out as they would have without the pruning. The sets of the dead nodes don't, so the pointers whose sets lost a constraint are detached from their values
+void Andersen::pruneDeadPointers()
+{
+	unsigned numNodes = nodeFactory.getNumNodes();
+	BitVector live(numNodes);
+	std::vector<NodeIndex> workList;
+	auto markLive = [this, &live, &workList] (NodeIndex n)
+	{
+		n = nodeFactory.getMergeTarget(n);
+		if (!live.test(n))
+		{
+			live.set(n);
+			workList.push_back(n);
+		}
+	};
+
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (n <= AndersNodeFactory::NullObjectIndex || nodeFactory.isObjectNode(n))
+			markLive(n);
+	}
+	for (auto n: queryRoots)
+		markLive(n);
+	std::vector<NodeIndex>().swap(queryRoots);
+
+	// The on-the-fly call graph adds copies that nothing sees yet: from the arguments of an indirect call, which are roots already, and from the return values of the functions it may call into the value of the call
+	for (auto const& call: indirectCalls)
+		markLive(call.callee);
+	if (!indirectCalls.empty())
+	{
+		auto markReturnLive = [this, &markLive] (const IndirectCallTarget& target)
+		{
+			NodeIndex ret = nodeFactory.getReturnNodeFor(target.func);
+			if (ret != AndersNodeFactory::InvalidIndex)
+				markLive(ret);
+		};
+		for (auto const& targets: fixedArityTargets)
+			std::for_each(targets.begin(), targets.end(), markReturnLive);
+		std::for_each(varargTargets.begin(), varargTargets.end(), markReturnLive);
+	}
+
+	// The sources of the copies into each node, in CSR form
+	std::vector<std::pair<NodeIndex, NodeIndex>> copies;
+	for (auto const& c: constraints)
+	{
+		switch (c.getType())
+		{
+			case AndersConstraint::COPY:
+				copies.emplace_back(nodeFactory.getMergeTarget(c.getDest()), nodeFactory.getMergeTarget(c.getSrc()));
+				break;
+			case AndersConstraint::LOAD:
+				markLive(c.getSrc());
+				break;
+			case AndersConstraint::STORE:
+				markLive(c.getSrc());
+				markLive(c.getDest());
+				break;
+			case AndersConstraint::ADDR_OF:
+				break;
+		}
+	}
+	for (auto const& c: fieldConstraints)
+		copies.emplace_back(nodeFactory.getMergeTarget(c.dest), nodeFactory.getMergeTarget(c.src));
+
+	std::vector<unsigned> firstSrc(numNodes + 1, 0);
+	for (auto const& copy: copies)
+		++firstSrc[copy.first + 1];
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		firstSrc[n + 1] += firstSrc[n];
+	std::vector<NodeIndex> srcs(copies.size());
+	std::vector<unsigned> nextSrc(firstSrc.begin(), firstSrc.end() - 1);
+	for (auto const& copy: copies)
+		srcs[nextSrc[copy.first]++] = copy.second;
+	std::vector<std::pair<NodeIndex, NodeIndex>>().swap(copies);
+
+	while (!workList.empty())
+	{
+		NodeIndex n = workList.back();
+		workList.pop_back();
+		for (unsigned i = firstSrc[n], e = firstSrc[n + 1]; i < e; ++i)
+			markLive(srcs[i]);
+	}
+
+	BitVector cutShort(numNodes);
+	auto isDead = [this, &live, &cutShort] (NodeIndex dst)
+	{
+		dst = nodeFactory.getMergeTarget(dst);
+		if (live.test(dst))
+			return false;
+		cutShort.set(dst);
+		return true;
+	};
+	unsigned numConstraints = constraints.size() + fieldConstraints.size();
+	constraints.erase(std::remove_if(constraints.begin(), constraints.end(), [&isDead] (const AndersConstraint& c)
+	{
+		return c.getType() != AndersConstraint::STORE && isDead(c.getDest());
+	}), constraints.end());
+	fieldConstraints.erase(std::remove_if(fieldConstraints.begin(), fieldConstraints.end(), [&isDead] (const AndersFieldConstraint& c)
+	{
+		return isDead(c.dest);
+	}), fieldConstraints.end());
+	NumDeadConstraints += numConstraints - constraints.size() - fieldConstraints.size();
+
+	// A pointer with no constraint into it keeps its empty set, which is the right answer. The return and vararg nodes have no value of their own to detach
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (!cutShort.test(nodeFactory.getMergeTarget(n)))
+			continue;
+		const Value* val = nodeFactory.getValueForNode(n);
+		if (val != nullptr && nodeFactory.getValueNodeFor(val) == n)
+		{
+			nodeFactory.detachNode(n);
+			++NumDeadPointers;
+		}
+	}
+}
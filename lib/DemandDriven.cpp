@@ -0,0 +1,270 @@
+#include "Andersen.h"
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+extern cl::opt<bool> EnableOnTheFlyCallGraph;
+extern cl::opt<bool> EnableFieldSensitive;
+
+std::unique_ptr<Andersen> Andersen::createOnDemand(const Module& m, std::string& error)
+{
+	if (EnableOnTheFlyCallGraph)
+	{
+		error = "-enable-otf-callgraph resolves the indirect calls during solving, which the demand-driven queries don't do";
+		return nullptr;
+	}
+	if (EnableFieldSensitive)
+	{
+		error = "-anders-field-sensitive needs the worklist solver, which the demand-driven queries don't use";
+		return nullptr;
+	}
+
+	std::unique_ptr<Andersen> ret(new Andersen());
+	ret->collectConstraints(m);
+	ret->buildDemandState();
+	return ret;
+}
+
+void Andersen::DemandState::Index::build(unsigned numNodes, const std::vector<std::pair<NodeIndex, NodeIndex>>& pairs)
+{
+	first.assign(numNodes + 1, 0);
+	for (auto const& pair: pairs)
+		++first[pair.first + 1];
+	for (unsigned n = 0; n < numNodes; ++n)
+		first[n + 1] += first[n];
+
+	elems.resize(pairs.size());
+	std::vector<unsigned> next(first.begin(), first.end() - 1);
+	for (auto const& pair: pairs)
+		elems[next[pair.first]++] = pair.second;
+}
+
+void Andersen::buildDemandState()
+{
+	demandState.reset(new DemandState);
+	DemandState& ds = *demandState;
+
+	std::vector<std::pair<NodeIndex, NodeIndex>> addrOfs, copies, loadsInto, loadsThrough, storesThrough;
+	for (auto const& c: constraints)
+	{
+		switch (c.getType())
+		{
+			case AndersConstraint::ADDR_OF:
+				addrOfs.emplace_back(c.getDest(), c.getSrc());
+				break;
+			case AndersConstraint::COPY:
+				copies.emplace_back(c.getDest(), c.getSrc());
+				break;
+			case AndersConstraint::LOAD:
+				loadsInto.emplace_back(c.getDest(), c.getSrc());
+				loadsThrough.emplace_back(c.getSrc(), c.getDest());
+				break;
+			case AndersConstraint::STORE:
+				storesThrough.emplace_back(c.getDest(), c.getSrc());
+				ds.storePointers.push_back(c.getDest());
+				break;
+		}
+	}
+	std::vector<AndersConstraint>().swap(constraints);
+
+	unsigned numNodes = nodeFactory.getNumNodes();
+	ds.addrOfsInto.build(numNodes, addrOfs);
+	ds.copiesInto.build(numNodes, copies);
+	ds.loadsInto.build(numNodes, loadsInto);
+	ds.loadsThrough.build(numNodes, loadsThrough);
+	ds.storesThrough.build(numNodes, storesThrough);
+	std::sort(ds.storePointers.begin(), ds.storePointers.end());
+	ds.storePointers.erase(std::unique(ds.storePointers.begin(), ds.storePointers.end()), ds.storePointers.end());
+
+	ds.demanded.resize(numNodes);
+	ds.onWorkList.resize(numNodes);
+	// The sets are never moved, so the references to them stay valid
+	ptsGraph.resize(numNodes);
+}
+
+void Andersen::demandNode(NodeIndex n)
+{
+	DemandState& ds = *demandState;
+	if (ds.demanded.test(n))
+		return;
+	ds.demanded.set(n);
+	ds.newlyDemanded.push_back(n);
+}
+
+void Andersen::addDemandedEdge(NodeIndex src, NodeIndex dst)
+{
+	DemandState& ds = *demandState;
+	if (src == dst)
+		return;
+	std::vector<NodeIndex>& succs = ds.copyEdges[src];
+	if (std::find(succs.begin(), succs.end(), dst) != succs.end())
+		return;
+	succs.push_back(dst);
+
+	// What src has already been given is pushed along the new edge right away. What it gets later is propagated from the work list
+	if (ptsGraph[dst].unionWith(ptsGraph[src]) && !ds.onWorkList.test(dst))
+	{
+		ds.onWorkList.set(dst);
+		ds.workList.push_back(dst);
+	}
+}
+
+// Find where the set of the newly demanded node n comes from, and demand those nodes in turn
+void Andersen::initDemandedNode(NodeIndex n)
+{
+	DemandState& ds = *demandState;
+	AndersPtsSet& ptsSet = ptsGraph[n];
+	for (auto obj: ds.addrOfsInto[n])
+	{
+		if (obj == nodeFactory.getNullObjectNode())
+			ptsSet.insertNullObject();
+		else
+			ptsSet.insert(obj);
+	}
+	if (!ptsSet.isEmpty() && !ds.onWorkList.test(n))
+	{
+		ds.onWorkList.set(n);
+		ds.workList.push_back(n);
+	}
+
+	for (auto src: ds.copiesInto[n])
+	{
+		demandNode(src);
+		addDemandedEdge(src, n);
+	}
+	// n = *ptr reads the objects ptr points to. The ones known so far are wired here, the others as they show up in the set of ptr
+	for (auto ptr: ds.loadsInto[n])
+	{
+		demandNode(ptr);
+		auto itr = ds.examinedObjs.find(ptr);
+		if (itr == ds.examinedObjs.end())
+			continue;
+		for (auto obj: itr->second)
+		{
+			demandNode(obj);
+			addDemandedEdge(obj, n);
+		}
+	}
+
+	if (!nodeFactory.isObjectNode(n))
+		return;
+	// An object is written by the stores whose pointer may point to it
+	if (!ds.storesDemanded)
+	{
+		ds.storesDemanded = true;
+		for (auto ptr: ds.storePointers)
+			demandNode(ptr);
+	}
+	for (auto ptr: ds.storePointers)
+	{
+		auto itr = ds.examinedObjs.find(ptr);
+		if (itr == ds.examinedObjs.end() || !itr->second.test(n))
+			continue;
+		for (auto src: ds.storesThrough[ptr])
+		{
+			demandNode(src);
+			addDemandedEdge(src, n);
+		}
+	}
+}
+
+// The set of the demanded node n has grown: push it along the copy edges, and wire the loads and the stores through n to the objects that are new in the set
+void Andersen::propagateDemanded(NodeIndex n)
+{
+	DemandState& ds = *demandState;
+	const AndersPtsSet& ptsSet = ptsGraph[n];
+	auto edgeItr = ds.copyEdges.find(n);
+	if (edgeItr != ds.copyEdges.end())
+	{
+		for (auto dst: edgeItr->second)
+		{
+			if (ptsGraph[dst].unionWith(ptsSet) && !ds.onWorkList.test(dst))
+			{
+				ds.onWorkList.set(dst);
+				ds.workList.push_back(dst);
+			}
+		}
+	}
+
+	ArrayRef<NodeIndex> loadDsts = ds.loadsThrough[n];
+	ArrayRef<NodeIndex> storeSrcs = ds.storesThrough[n];
+	if (loadDsts.empty() && storeSrcs.empty())
+		return;
+	// The set may grow while the new edges are added, so the new objects are taken out first. The null object is kept apart from the others, but it is loaded from and stored to like any other object, as in the solver
+	std::vector<NodeIndex> newObjs;
+	SparseBitVector<>& examined = ds.examinedObjs[n];
+	if (ptsSet.hasNullObject() && examined.test_and_set(nodeFactory.getNullObjectNode()))
+		newObjs.push_back(nodeFactory.getNullObjectNode());
+	for (auto obj: ptsSet)
+	{
+		if (examined.test_and_set(obj))
+			newObjs.push_back(obj);
+	}
+	for (auto obj: newObjs)
+	{
+		for (auto dst: loadDsts)
+		{
+			if (!ds.demanded.test(dst))
+				continue;
+			demandNode(obj);
+			addDemandedEdge(obj, dst);
+		}
+		// A store only matters to the objects that are demanded. initDemandedNode() wires the others if they ever are
+		if (!ds.demanded.test(obj))
+			continue;
+		for (auto src: storeSrcs)
+		{
+			demandNode(src);
+			addDemandedEdge(src, obj);
+		}
+	}
+}
+
+void Andersen::solveDemanded()
+{
+	DemandState& ds = *demandState;
+	while (true)
+	{
+		if (!ds.newlyDemanded.empty())
+		{
+			NodeIndex n = ds.newlyDemanded.back();
+			ds.newlyDemanded.pop_back();
+			initDemandedNode(n);
+		}
+		else if (!ds.workList.empty())
+		{
+			NodeIndex n = ds.workList.back();
+			ds.workList.pop_back();
+			ds.onWorkList.reset(n);
+			propagateDemanded(n);
+		}
+		else
+			break;
+	}
+}
+
+bool Andersen::getPointsToSetOnDemand(const llvm::Value* v, std::vector<const llvm::Value*>& ptsSet)
+{
+	assert(demandState && "Not an analysis made by createOnDemand()");
+	NodeIndex ptrIndex = nodeFactory.getValueNodeFor(v);
+	if (ptrIndex == AndersNodeFactory::InvalidIndex || ptrIndex == nodeFactory.getUniversalPtrNode())
+		return false;
+
+	demandNode(ptrIndex);
+	solveDemanded();
+
+	const AndersPtsSet& solvedSet = ptsGraph[ptrIndex];
+	if (solvedSet.has(nodeFactory.getUniversalObjNode()))
+		return false;
+	ptsSet.clear();
+	for (auto obj: solvedSet)
+	{
+		if (const Value* val = nodeFactory.getValueForNode(obj))
+			ptsSet.push_back(val);
+	}
+	return true;
+}
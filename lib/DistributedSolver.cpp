@@ -0,0 +1,450 @@
+#include "DistributedSolver.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+std::vector<std::unique_ptr<AndersTransport>> AndersInProcessTransport::create(unsigned numRanks)
+{
+	auto group = std::make_shared<Group>();
+	group->numRanks = numRanks;
+	for (auto& mailboxes: group->mailboxes)
+		mailboxes.resize(numRanks * numRanks);
+
+	std::vector<std::unique_ptr<AndersTransport>> ret;
+	for (unsigned rank = 0; rank < numRanks; ++rank)
+		ret.emplace_back(new AndersInProcessTransport(group, rank));
+	return ret;
+}
+
+bool AndersInProcessTransport::exchange(const std::vector<std::vector<std::uint32_t>>& outgoing, std::vector<std::uint32_t>& incoming, bool& active, std::string& error)
+{
+	unsigned numRanks = group->numRanks;
+	if (outgoing.size() != numRanks)
+	{
+		error = "a message for each of the " + std::to_string(numRanks) + " ranks is needed";
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(group->mutex);
+	unsigned round = group->round;
+	auto& mailboxes = group->mailboxes[round % 2];
+	for (unsigned to = 0; to < numRanks; ++to)
+		if (to != rank)
+			mailboxes[to * numRanks + rank] = outgoing[to];
+	group->active |= active;
+	if (++group->numArrived == numRanks)
+	{
+		// The last rank to post closes the round. A rank of the next one can't post to this parity again before every rank has posted to the next one, which it only does once it has read this one
+		group->wasActive[round % 2] = group->active;
+		group->active = false;
+		group->numArrived = 0;
+		++group->round;
+		group->roundDone.notify_all();
+	}
+	else
+		group->roundDone.wait(lock, [this, round] { return group->round != round; });
+
+	incoming.clear();
+	for (unsigned from = 0; from < numRanks; ++from)
+	{
+		auto& mailbox = mailboxes[rank * numRanks + from];
+		incoming.insert(incoming.end(), mailbox.begin(), mailbox.end());
+		mailbox.clear();
+	}
+	active = group->wasActive[round % 2];
+	return true;
+}
+
+namespace
+{
+
+// The set operations of AndersPtsSet keep the null object apart from the elements, but a load or store resolves it like any other object, and a message names it by its node
+void insertObject(AndersPtsSet& ptsSet, NodeIndex obj)
+{
+	if (obj == AndersNodeFactory::NullObjectIndex)
+		ptsSet.insertNullObject();
+	else
+		ptsSet.insert(obj);
+}
+
+template <typename Func>
+void forEachObject(const AndersPtsSet& ptsSet, Func func)
+{
+	if (ptsSet.hasNullObject())
+		func(AndersNodeFactory::NullObjectIndex);
+	for (auto obj: ptsSet)
+		func(obj);
+}
+
+}
+
+DistributedAndersSolver::DistributedAndersSolver(AndersTransport& t, unsigned n): transport(t), numNodes(n)
+{
+	unsigned numRanks = transport.getNumRanks();
+	nodesPerRank = std::max(1u, (numNodes + numRanks - 1) / numRanks);
+	firstNode = std::min<std::uint64_t>(std::uint64_t(transport.getRank()) * nodesPerRank, numNodes);
+	lastNode = std::min(firstNode + nodesPerRank, numNodes);
+	nodes.resize(lastNode - firstNode);
+	for (NodeIndex i = firstNode; i < lastNode; ++i)
+		getNode(i).mergeTarget = i;
+	outgoing.resize(numRanks);
+}
+
+std::unique_ptr<DistributedAndersSolver> DistributedAndersSolver::create(const ConstraintFileReader& reader, AndersTransport& transport, std::string& error)
+{
+	if (transport.getRank() >= transport.getNumRanks())
+	{
+		error = "bad rank " + std::to_string(transport.getRank());
+		return nullptr;
+	}
+	std::unique_ptr<DistributedAndersSolver> ret(new DistributedAndersSolver(transport, reader.getNumNodes()));
+	for (size_t i = 0, e = reader.getNumConstraints(); i < e; ++i)
+	{
+		AndersConstraint c = reader.getConstraint(i);
+		NodeIndex dst = c.getDest(), src = c.getSrc();
+		if (dst >= ret->numNodes || src >= ret->numNodes)
+		{
+			error = "constraint " + std::to_string(i) + " refers to a node that doesn't exist";
+			return nullptr;
+		}
+		switch (c.getType())
+		{
+			case AndersConstraint::ADDR_OF:
+				if (ret->isLocal(dst))
+				{
+					insertObject(ret->getNode(dst).ptsSet, src);
+					ret->addToWorkList(dst);
+				}
+				break;
+			case AndersConstraint::COPY:
+				if (ret->isLocal(src) && src != dst)
+					ret->getNode(src).copySuccs.set(dst);
+				break;
+			case AndersConstraint::LOAD:
+				if (ret->isLocal(src))
+					ret->getNode(src).loadDsts.push_back(dst);
+				break;
+			case AndersConstraint::STORE:
+				if (ret->isLocal(dst))
+					ret->getNode(dst).storeSrcs.push_back(src);
+				break;
+		}
+	}
+	// A file written from a ConstraintGenerator may repeat constraints
+	for (auto& node: ret->nodes)
+	{
+		for (auto vec: {&node.loadDsts, &node.storeSrcs})
+		{
+			std::sort(vec->begin(), vec->end());
+			vec->erase(std::unique(vec->begin(), vec->end()), vec->end());
+		}
+	}
+	return ret;
+}
+
+NodeIndex DistributedAndersSolver::findLocal(NodeIndex n)
+{
+	assert(isLocal(n));
+	NodeIndex rep = n;
+	while (getNode(rep).mergeTarget != rep)
+		rep = getNode(rep).mergeTarget;
+	// Path compression
+	while (getNode(n).mergeTarget != rep)
+	{
+		NodeIndex next = getNode(n).mergeTarget;
+		getNode(n).mergeTarget = rep;
+		n = next;
+	}
+	return rep;
+}
+
+const AndersPtsSet& DistributedAndersSolver::getPointsToSet(NodeIndex n) const
+{
+	assert(n >= firstNode && n < lastNode && "Not a node of this rank!");
+	while (nodes[n - firstNode].mergeTarget != n)
+		n = nodes[n - firstNode].mergeTarget;
+	return nodes[n - firstNode].ptsSet;
+}
+
+void DistributedAndersSolver::addToWorkList(NodeIndex n)
+{
+	LocalNode& node = getNode(n);
+	if (!node.onWorkList)
+	{
+		node.onWorkList = true;
+		workList.push_back(n);
+	}
+}
+
+void DistributedAndersSolver::addObjects(NodeIndex n, const AndersPtsSet& objects)
+{
+	if (isLocal(n))
+	{
+		NodeIndex rep = findLocal(n);
+		if (getNode(rep).ptsSet.unionWith(objects))
+			addToWorkList(rep);
+	}
+	else
+		remoteDeltas[n].unionWith(objects);
+}
+
+void DistributedAndersSolver::addCopyEdge(NodeIndex src, NodeIndex dst)
+{
+	if (!isLocal(src))
+	{
+		remoteEdges.emplace_back(src, dst);
+		return;
+	}
+
+	NodeIndex rep = findLocal(src);
+	if (isLocal(dst) && findLocal(dst) == rep)
+		return;
+	LocalNode& node = getNode(rep);
+	if (!node.copySuccs.test_and_set(dst))
+		return;
+	// What is not propagated yet goes along the edge with the next visit of src
+	if (!node.propagated.isEmpty())
+		addObjects(dst, node.propagated);
+}
+
+void DistributedAndersSolver::visit(NodeIndex n)
+{
+	LocalNode& node = getNode(n);
+	AndersPtsSet delta;
+	delta.assignDifference(node.ptsSet, node.propagated);
+	if (delta.isEmpty())
+		return;
+	node.propagated.unionWith(delta);
+
+	// addObjects() and addCopyEdge() may add to the edges of n itself, so walk copies of them
+	std::vector<NodeIndex> succs;
+	for (auto succ: node.copySuccs)
+		succs.push_back(succ);
+	for (auto succ: succs)
+		if (!isLocal(succ) || findLocal(succ) != n)
+			addObjects(succ, delta);
+
+	std::vector<NodeIndex> loadDsts = node.loadDsts, storeSrcs = node.storeSrcs;
+	forEachObject(delta, [this, &loadDsts, &storeSrcs] (NodeIndex obj)
+	{
+		for (auto dst: loadDsts)
+			addCopyEdge(obj, dst);
+		for (auto src: storeSrcs)
+			addCopyEdge(src, obj);
+	});
+}
+
+bool DistributedAndersSolver::readMessages(ArrayRef<std::uint32_t> incoming, std::string& error)
+{
+	auto malformed = [&error] { error = "malformed message"; return false; };
+	size_t pos = 0;
+	while (pos < incoming.size())
+	{
+		std::uint32_t kind = incoming[pos++];
+		if (kind == DeltaRecord)
+		{
+			if (incoming.size() - pos < 2)
+				return malformed();
+			NodeIndex n = incoming[pos++];
+			std::uint32_t count = incoming[pos++];
+			if (!isLocal(n) || incoming.size() - pos < count)
+				return malformed();
+			AndersPtsSet objects;
+			for (auto obj: incoming.slice(pos, count))
+			{
+				if (obj >= numNodes)
+					return malformed();
+				insertObject(objects, obj);
+			}
+			pos += count;
+			addObjects(n, objects);
+		}
+		else if (kind == EdgeRecord)
+		{
+			if (incoming.size() - pos < 2)
+				return malformed();
+			NodeIndex src = incoming[pos++], dst = incoming[pos++];
+			if (!isLocal(src) || dst >= numNodes)
+				return malformed();
+			addCopyEdge(src, dst);
+		}
+		else
+			return malformed();
+	}
+	return true;
+}
+
+void DistributedAndersSolver::mergeInto(NodeIndex rep, NodeIndex n)
+{
+	LocalNode& repNode = getNode(rep);
+	LocalNode& node = getNode(n);
+	repNode.ptsSet.unionWith(node.ptsSet);
+	// Only what both have propagated has gone along the edges of both
+	AndersPtsSet notPropagated;
+	notPropagated.assignDifference(repNode.propagated, node.propagated);
+	AndersPtsSet propagated;
+	propagated.assignDifference(repNode.propagated, notPropagated);
+	repNode.propagated = std::move(propagated);
+
+	repNode.copySuccs |= node.copySuccs;
+	repNode.loadDsts.insert(repNode.loadDsts.end(), node.loadDsts.begin(), node.loadDsts.end());
+	repNode.storeSrcs.insert(repNode.storeSrcs.end(), node.storeSrcs.begin(), node.storeSrcs.end());
+	node.ptsSet.clear();
+	node.propagated.clear();
+	node.copySuccs.clear();
+	std::vector<NodeIndex>().swap(node.loadDsts);
+	std::vector<NodeIndex>().swap(node.storeSrcs);
+	node.mergeTarget = rep;
+	++stats.merges;
+}
+
+// Tarjan's algorithm over the representatives of this rank and the copy edges between them, with an explicit stack. The components are done in reverse topological order
+void DistributedAndersSolver::collapseLocalCycles()
+{
+	const unsigned Unvisited = ~0u;
+	std::vector<unsigned> dfsNum(nodes.size(), Unvisited), lowLink(nodes.size());
+	std::vector<bool> onStack(nodes.size());
+	std::vector<NodeIndex> sccStack;
+	struct Frame
+	{
+		NodeIndex node;
+		std::vector<NodeIndex> succs;
+		size_t next;
+	};
+	std::vector<Frame> dfsStack;
+	unsigned timestamp = 0;
+	// The nodes without a copy edge to another node of this rank come last
+	unsigned numComponents = 0;
+	topoOrder.assign(nodes.size(), nodes.size());
+
+	auto push = [&] (NodeIndex n)
+	{
+		unsigned i = n - firstNode;
+		dfsNum[i] = lowLink[i] = timestamp++;
+		onStack[i] = true;
+		sccStack.push_back(n);
+		Frame frame{n, {}, 0};
+		for (auto succ: getNode(n).copySuccs)
+			if (isLocal(succ))
+				frame.succs.push_back(findLocal(succ));
+		dfsStack.push_back(std::move(frame));
+	};
+
+	for (NodeIndex root = firstNode; root < lastNode; ++root)
+	{
+		if (dfsNum[root - firstNode] != Unvisited || findLocal(root) != root || getNode(root).copySuccs.empty())
+			continue;
+		push(root);
+		while (!dfsStack.empty())
+		{
+			Frame& frame = dfsStack.back();
+			unsigned i = frame.node - firstNode;
+			if (frame.next < frame.succs.size())
+			{
+				NodeIndex succ = frame.succs[frame.next++];
+				unsigned j = succ - firstNode;
+				if (dfsNum[j] == Unvisited)
+					push(succ);
+				else if (onStack[j])
+					lowLink[i] = std::min(lowLink[i], dfsNum[j]);
+				continue;
+			}
+
+			NodeIndex n = frame.node;
+			dfsStack.pop_back();
+			if (!dfsStack.empty())
+			{
+				unsigned parent = dfsStack.back().node - firstNode;
+				lowLink[parent] = std::min(lowLink[parent], lowLink[i]);
+			}
+			if (lowLink[i] != dfsNum[i])
+				continue;
+
+			// n is the root of a component. Merge it into its smallest node, so that the representatives don't depend on the order of the search
+			auto begin = std::find(sccStack.begin(), sccStack.end(), n);
+			for (auto itr = begin; itr != sccStack.end(); ++itr)
+				onStack[*itr - firstNode] = false;
+			NodeIndex rep = *std::min_element(begin, sccStack.end());
+			topoOrder[rep - firstNode] = nodes.size() - ++numComponents;
+			if (sccStack.end() - begin > 1)
+			{
+				for (auto itr = begin; itr != sccStack.end(); ++itr)
+					if (*itr != rep)
+						mergeInto(rep, *itr);
+				getNode(rep).copySuccs.reset(rep);
+				for (auto vec: {&getNode(rep).loadDsts, &getNode(rep).storeSrcs})
+				{
+					std::sort(vec->begin(), vec->end());
+					vec->erase(std::unique(vec->begin(), vec->end()), vec->end());
+				}
+				addToWorkList(rep);
+			}
+			sccStack.erase(begin, sccStack.end());
+		}
+	}
+}
+
+bool DistributedAndersSolver::solve(std::string& error)
+{
+	std::vector<std::uint32_t> incoming;
+	while (true)
+	{
+		// Solve the local part to its fixed point, in sweeps over the work list in topological order. Between two sweeps, collapse the cycles the new edges have closed
+		while (true)
+		{
+			collapseLocalCycles();
+			if (workList.empty())
+				break;
+			std::vector<NodeIndex> sweep;
+			sweep.swap(workList);
+			std::sort(sweep.begin(), sweep.end(), [this] (NodeIndex a, NodeIndex b) { return topoOrder[a - firstNode] < topoOrder[b - firstNode]; });
+			for (auto n: sweep)
+			{
+				getNode(n).onWorkList = false;
+				if (findLocal(n) == n)
+					visit(n);
+			}
+		}
+
+		for (auto const& delta: remoteDeltas)
+		{
+			auto& message = outgoing[getOwner(delta.first)];
+			message.push_back(DeltaRecord);
+			message.push_back(delta.first);
+			message.push_back(delta.second.getSize());
+			forEachObject(delta.second, [&message] (NodeIndex obj) { message.push_back(obj); });
+			++stats.deltasSent;
+		}
+		remoteDeltas.clear();
+		// The loads and stores of several nodes of this rank may well ask for the same edge
+		std::sort(remoteEdges.begin(), remoteEdges.end());
+		remoteEdges.erase(std::unique(remoteEdges.begin(), remoteEdges.end()), remoteEdges.end());
+		for (auto const& edge: remoteEdges)
+		{
+			auto& message = outgoing[getOwner(edge.first)];
+			message.push_back(EdgeRecord);
+			message.push_back(edge.first);
+			message.push_back(edge.second);
+			++stats.edgeRequestsSent;
+		}
+		std::vector<std::pair<NodeIndex, NodeIndex>>().swap(remoteEdges);
+
+		bool active = false;
+		for (auto const& message: outgoing)
+		{
+			active |= !message.empty();
+			stats.wordsSent += message.size();
+		}
+		if (!transport.exchange(outgoing, incoming, active, error))
+			return false;
+		for (auto& message: outgoing)
+			message.clear();
+		++stats.rounds;
+		// Nobody sent anything, and every rank has solved its part
+		if (!active)
+			return true;
+		if (!readMessages(incoming, error))
+			return false;
+	}
+}
@@ -0,0 +1,181 @@
+#include "Andersen.h"
+#include "EscapeInfo.h"
+
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace
+{
+
+// Marks the objects that may be reached from a set of roots by following the solved points-to sets of the objects. A walk is begun, given its roots, and run; the marks of a walk are told apart by a stamp, so the walks of the functions don't have to clear anything
+class EscapeWalker
+{
+private:
+	const AndersNodeFactory& nodeFactory;
+	const CompactPtsGraph& solvedPtsGraph;
+	const DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses;
+	// The key of the location class of each member, i.e. the node the points-to sets have in place of the member
+	DenseMap<NodeIndex, NodeIndex> classKeys;
+	std::vector<unsigned> stamps;
+	unsigned stamp;
+	std::vector<NodeIndex> stack;
+
+	NodeIndex getKey(NodeIndex obj) const
+	{
+		auto itr = classKeys.find(obj);
+		return itr == classKeys.end() ? obj : itr->second;
+	}
+	// A pointer to one field of an object may be moved to the others
+	void markFields(NodeIndex obj)
+	{
+		NodeIndex first = obj - nodeFactory.getFieldIndex(obj);
+		for (NodeIndex field = first, e = first + nodeFactory.getNumFields(obj); field < e; ++field)
+			if (field != obj)
+				mark(field);
+	}
+public:
+	EscapeWalker(const AndersNodeFactory& n, const CompactPtsGraph& g, const DenseMap<NodeIndex, std::vector<NodeIndex>>& l): nodeFactory(n), solvedPtsGraph(g), locationClasses(l), stamps(n.getNumNodes(), 0), stamp(0)
+	{
+		for (auto const& mapping: locationClasses)
+			for (auto member: mapping.second)
+				classKeys[member] = mapping.first;
+	}
+
+	void begin() { ++stamp; }
+	void mark(NodeIndex obj)
+	{
+		NodeIndex key = getKey(obj);
+		if (key == nodeFactory.getNullObjectNode() || stamps[key] == stamp)
+			return;
+		stamps[key] = stamp;
+		stack.push_back(key);
+	}
+	// Mark the objects ptr may point to
+	void markPointees(NodeIndex ptr)
+	{
+		unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(ptr));
+		if (setId != CompactPtsGraph::NoSlot)
+			for (auto obj: solvedPtsGraph.getSet(setId))
+				mark(obj);
+	}
+	void run()
+	{
+		while (!stack.empty())
+		{
+			NodeIndex key = stack.back();
+			stack.pop_back();
+			markFields(key);
+			auto itr = locationClasses.find(key);
+			if (itr != locationClasses.end())
+				for (auto member: itr->second)
+					markFields(member);
+			// The contents of the object are the points-to set of its node
+			markPointees(key);
+		}
+	}
+	bool isMarked(NodeIndex obj) const { return stamps[getKey(obj)] == stamp; }
+};
+
+}
+
+void Andersen::computeEscapes(const Module& m, AndersEscapeInfo& info) const
+{
+	waitForSolution();
+	info = AndersEscapeInfo();
+
+	// The objects of each function, by node
+	DenseMap<const Function*, std::vector<std::pair<NodeIndex, unsigned>>> objectsOfFunction;
+	for (auto const& f: m)
+	{
+		for (auto const& inst: instructions(f))
+		{
+			NodeIndex obj = nodeFactory.getObjectNodeFor(&inst);
+			if (obj == AndersNodeFactory::InvalidIndex || (nodeFactory.getObjectCategories(obj) & (AndersNodeFactory::StackObject | AndersNodeFactory::HeapObject)) == 0)
+				continue;
+			objectsOfFunction[&f].push_back(std::make_pair(obj, info.objects.size()));
+			info.objectIndex[&inst] = info.objects.size();
+			info.objects.push_back(&inst);
+		}
+	}
+	unsigned numObjects = info.objects.size();
+	info.toGlobals.resize(numObjects);
+	info.toCaller.resize(numObjects);
+	info.toUnknown.resize(numObjects);
+
+	EscapeWalker walker(nodeFactory, solvedPtsGraph, locationClasses);
+	auto collect = [&objectsOfFunction, &walker](BitVector& escapes)
+	{
+		for (auto const& mapping: objectsOfFunction)
+			for (auto const& obj: mapping.second)
+				if (walker.isMarked(obj.first))
+					escapes.set(obj.second);
+	};
+
+	// The global variables and what they point to, transitively
+	walker.begin();
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+		if (nodeFactory.getObjectCategories(n) & (AndersNodeFactory::GlobalObject | AndersNodeFactory::ConstantGlobalObject))
+			walker.mark(n);
+	walker.run();
+	collect(info.toGlobals);
+
+	// The stores through pointers the analysis doesn't know end up in the universal object. The calls to unknown external functions are only modeled by what they return, so the objects they are given are roots of their own
+	walker.begin();
+	walker.mark(nodeFactory.getUniversalObjNode());
+	auto isUnknownFunction = [this](const Function* f)
+	{
+		return isExternalFunction(*f) && (scopedOut.count(f) || classifyExternalLibrary(f) == EXT_UNKNOWN);
+	};
+	for (auto const& f: m)
+	{
+		for (auto const& inst: instructions(f))
+		{
+			ImmutableCallSite cs(&inst);
+			if (!cs)
+				continue;
+			bool unknownCallee;
+			if (const Function* callee = cs.getCalledFunction())
+				unknownCallee = isUnknownFunction(callee);
+			else
+			{
+				ArrayRef<const Function*> callees;
+				unknownCallee = !getResolvedCallees(&inst, callees) || std::any_of(callees.begin(), callees.end(), isUnknownFunction);
+			}
+			if (!unknownCallee)
+				continue;
+			for (unsigned i = 0, e = cs.arg_size(); i < e; ++i)
+			{
+				NodeIndex arg = cs.getArgument(i)->getType()->isPointerTy() ? nodeFactory.getValueNodeFor(cs.getArgument(i)) : AndersNodeFactory::InvalidIndex;
+				if (arg != AndersNodeFactory::InvalidIndex && !cs.doesNotCapture(i))
+					walker.markPointees(arg);
+			}
+		}
+	}
+	walker.run();
+	collect(info.toUnknown);
+
+	// The callers of a function see what its arguments point to and what it returns. Only the functions that allocate something are walked
+	for (auto const& mapping: objectsOfFunction)
+	{
+		const Function* f = mapping.first;
+		walker.begin();
+		for (auto const& arg: f->args())
+		{
+			NodeIndex argNode = arg.getType()->isPointerTy() ? nodeFactory.getValueNodeFor(&arg) : AndersNodeFactory::InvalidIndex;
+			if (argNode != AndersNodeFactory::InvalidIndex)
+				walker.markPointees(argNode);
+		}
+		NodeIndex retNode = nodeFactory.getReturnNodeFor(f);
+		if (retNode != AndersNodeFactory::InvalidIndex)
+			walker.markPointees(retNode);
+		walker.run();
+		for (auto const& obj: mapping.second)
+			if (walker.isMarked(obj.first))
+				info.toCaller.set(obj.second);
+	}
+}
@@ -3,13 +3,21 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/CallSite.h"
 #include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSwitch.h"
 #include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include <cstring>
+#include <mutex>
 
 using namespace llvm;
 
+cl::opt<std::string> ExternalLibrarySpec("anders-ext-spec", cl::desc("A file with models for more external library functions, one \"<kind> <function name>\" per line. The kinds are noop, alloc, realloc, ret-arg0, ret-arg1, ret-arg2, memcpy and store-arg"), cl::value_desc("filename"));
+
 static const char* noopFuncs[] = {
 	"log", "log10", "exp", "exp2", "exp10", "strcmp", "strncmp", "strlen",
 	"atoi", "atof",	"atol", "atoll", "remove", "unlink", "rename", "memcmp", "free",
@@ -40,6 +48,8 @@ static const char* noopFuncs[] = {
 	"llvm.lifetime.start", "llvm.lifetime.end", "llvm.stackrestore",
 	"memset", "llvm.memset.i32", "llvm.memset.p0i8.i32", "llvm.memset.i64",
 	"llvm.memset.p0i8.i64", "llvm.va_end",
+	// The pointer llvm.type.checked.load returns in its pair is taken out by an extractvalue, which loads it from the vtable
+	"llvm.type.test", "llvm.type.checked.load", "llvm.assume",
 	// The following functions might not be NOOP. They need to be removed from this list in the future
 	"setrlimit", "getrlimit",
 	nullptr
@@ -91,48 +101,127 @@ static const char* convertFuncs[] = {
 	nullptr
 };
 
-static bool lookupName(const char* table[], const char* str)
+// Read the models listed in the file named by -anders-ext-spec into kindMap. A line of the file is "<kind> <function name>"; blank lines and text after a '#' are ignored. If a function is listed more than once, the last line wins
+// The kinds are named after the tables above, except that a function listed as store-arg is modeled like the convert functions: argument 1 is stored into the memory argument 0 points to
+void Andersen::loadExternalLibrarySpec(StringRef fileName, StringMap<ExternalLibraryKind>& kindMap)
 {
-	for (unsigned i = 0; table[i] != nullptr; ++i)
+	auto fileOrErr = MemoryBuffer::getFile(fileName);
+	if (!fileOrErr)
+		report_fatal_error("Cannot read external library spec " + fileName + ": " + fileOrErr.getError().message());
+
+	SmallVector<StringRef, 64> lines;
+	(*fileOrErr)->getBuffer().split(lines, '\n');
+	for (unsigned i = 0, e = lines.size(); i != e; ++i)
 	{
-		if (strcmp(table[i], str) == 0)
-			return true;
+		StringRef line = lines[i].split('#').first.trim();
+		if (line.empty())
+			continue;
+
+		std::pair<StringRef, StringRef> fields = getToken(line);
+		StringRef funcName = fields.second.trim();
+		ExternalLibraryKind kind = StringSwitch<ExternalLibraryKind>(fields.first)
+			.Case("noop", EXT_NOOP)
+			.Case("alloc", EXT_MALLOC)
+			.Case("realloc", EXT_REALLOC)
+			.Case("ret-arg0", EXT_RET_ARG0)
+			.Case("ret-arg1", EXT_RET_ARG1)
+			.Case("ret-arg2", EXT_RET_ARG2)
+			.Case("memcpy", EXT_MEMCPY)
+			.Case("store-arg", EXT_CONVERT)
+			.Default(EXT_UNKNOWN);
+		if (kind == EXT_UNKNOWN || funcName.empty() || getToken(funcName).second.size() != 0)
+			report_fatal_error(fileName + ":" + Twine(i + 1) + ": expected \"<kind> <function name>\"");
+
+		kindMap[funcName] = kind;
 	}
-	return false;
+}
+
+// Find out which of the tables above f belongs to. A function that appears in several of them (e.g. fgets) gets the kind of the first one
+// The tables are turned into a hash map the first time this is called, and again whenever -anders-ext-spec names another file than the map was built with. The analysis calls it once per external function (see externalLibraryKinds), not once per call site
+Andersen::ExternalLibraryKind Andersen::classifyExternalLibrary(const Function* f)
+{
+	assert(f != nullptr && "called function is nullptr!");
+	assert((f->isDeclaration() || f->isIntrinsic()) && "Not an external function!");
+
+	static std::mutex kindMapMutex;
+	static StringMap<ExternalLibraryKind> kindMap;
+	static std::string kindMapSpec;
+	static bool kindMapBuilt = false;
+
+	std::lock_guard<std::mutex> lock(kindMapMutex);
+	if (!kindMapBuilt || kindMapSpec != ExternalLibrarySpec)
+	{
+		StringMap<ExternalLibraryKind> ret;
+		// The user's models come first, so they replace the built-in ones
+		if (!ExternalLibrarySpec.empty())
+			loadExternalLibrarySpec(ExternalLibrarySpec, ret);
+
+		std::pair<const char**, ExternalLibraryKind> tables[] = {
+			{ noopFuncs, EXT_NOOP },
+			{ mallocFuncs, EXT_MALLOC },
+			{ reallocFuncs, EXT_REALLOC },
+			{ retArg0Funcs, EXT_RET_ARG0 },
+			{ retArg1Funcs, EXT_RET_ARG1 },
+			{ retArg2Funcs, EXT_RET_ARG2 },
+			{ memcpyFuncs, EXT_MEMCPY },
+			{ convertFuncs, EXT_CONVERT },
+		};
+		// insert() keeps the existing entry, which is what gives the earlier tables precedence
+		for (auto const& table: tables)
+		{
+			for (unsigned i = 0; table.first[i] != nullptr; ++i)
+				ret.insert(std::make_pair(table.first[i], table.second));
+		}
+		ret.insert(std::make_pair("llvm.va_start", EXT_VA_START));
+		kindMap = std::move(ret);
+		kindMapSpec = ExternalLibrarySpec;
+		kindMapBuilt = true;
+	}
+
+	auto itr = kindMap.find(f->getName());
+	return itr == kindMap.end() ? EXT_UNKNOWN : itr->second;
 }
 
 // This function identifies if the external callsite is a library function call, and add constraint correspondingly
 // If this is a call to a "known" function, add the constraints and return true. If this is a call to an unknown function, return false.
-bool Andersen::addConstraintForExternalLibrary(ImmutableCallSite cs, const Function* f)
+bool Andersen::addConstraintForExternalLibrary(ImmutableCallSite cs, const Function* f, CollectionBuffer& buffer) const
+{
+	auto itr = externalLibraryKinds.find(f);
+	assert(itr != externalLibraryKinds.end() && "External function not classified!");
+	return addConstraintForExternalLibrary(cs, f, itr->second, buffer);
+}
+
+// The same as above, for callers that have already classified f
+bool Andersen::addConstraintForExternalLibrary(ImmutableCallSite cs, const Function* f, ExternalLibraryKind kind, CollectionBuffer& buffer) const
 {
 	assert(f != nullptr && "called function is nullptr!");
-	assert((f->isDeclaration() || f->isIntrinsic()) && "Not an external function!");
+	assert(isExternalFunction(*f) && "Not an external function!");
 
 	// These functions don't induce any points-to constraints
-	if (lookupName(noopFuncs, f->getName().data()))
+	if (kind == EXT_NOOP)
 		return true;
 
 	// Realloc-like library is a little different: if the first argument is nullptr, then it behaves like retArg0Funcs; otherwise, it behaves like mallocFuncs
-	bool isReallocLike = lookupName(reallocFuncs, f->getName().data());
+	bool isReallocLike = (kind == EXT_REALLOC);
 
 	// Library calls that might allocate memory.
-	if (lookupName(mallocFuncs, f->getName().data()) || (isReallocLike && !isa<ConstantPointerNull>(cs.getArgument(0))))
+	if (kind == EXT_MALLOC || (isReallocLike && !isa<ConstantPointerNull>(cs.getArgument(0))))
 	{
 		const Instruction* inst = cs.getInstruction();
 
 		// Create the obj node
-		NodeIndex objIndex = nodeFactory.createObjectNode(inst);
+		NodeIndex objIndex = buffer.createObjectNode(inst);
 
 		// Get the pointer node
-		NodeIndex ptrIndex = nodeFactory.getValueNodeFor(inst);
+		NodeIndex ptrIndex = getLocalValueNode(inst, buffer);
 		if (ptrIndex == AndersNodeFactory::InvalidIndex)
 		{
 			// Must be something like posix_memalign()
 			if (f->getName() == "posix_memalign")
 			{
-				ptrIndex = nodeFactory.getValueNodeFor(cs.getArgument(0));
+				ptrIndex = getLocalValueNode(cs.getArgument(0), buffer);
 				assert(ptrIndex != AndersNodeFactory::InvalidIndex && "Failed to find arg0 node");
-				constraints.emplace_back(AndersConstraint::STORE, ptrIndex, objIndex);
+				buffer.constraints.emplace_back(AndersConstraint::STORE, ptrIndex, objIndex);
 			}
 			else
 			{
@@ -143,88 +232,112 @@ bool Andersen::addConstraintForExternalLibrary(ImmutableCallSite cs, const Funct
 		else
 		{
 			// Normal malloc-like call 
-			constraints.emplace_back(AndersConstraint::ADDR_OF, ptrIndex, objIndex);
+			buffer.constraints.emplace_back(AndersConstraint::ADDR_OF, ptrIndex, objIndex);
 		}
 		
 		return true;
 	}
 
-	if (lookupName(retArg0Funcs, f->getName().data()) || (isReallocLike && isa<ConstantPointerNull>(cs.getArgument(0))))
+	if (kind == EXT_RET_ARG0 || (isReallocLike && isa<ConstantPointerNull>(cs.getArgument(0))))
 	{
-		NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+		NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 		if (retIndex != AndersNodeFactory::InvalidIndex)
 		{
-			NodeIndex arg0Index = nodeFactory.getValueNodeFor(cs.getArgument(0));
+			NodeIndex arg0Index = getLocalValueNode(cs.getArgument(0), buffer);
 			assert(arg0Index != AndersNodeFactory::InvalidIndex && "Failed to find arg0 node");
-			constraints.emplace_back(AndersConstraint::COPY, retIndex, arg0Index);
+			buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, arg0Index);
 		}
 		
 		return true;
 	}
 
-	if (lookupName(retArg1Funcs, f->getName().data()))
+	if (kind == EXT_RET_ARG1)
 	{
-		NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+		NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 		assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find call site node");
-		NodeIndex arg1Index = nodeFactory.getValueNodeFor(cs.getArgument(1));
+		NodeIndex arg1Index = getLocalValueNode(cs.getArgument(1), buffer);
 		assert(arg1Index != AndersNodeFactory::InvalidIndex && "Failed to find arg1 node");
-		constraints.emplace_back(AndersConstraint::COPY, retIndex, arg1Index);
+		buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, arg1Index);
 		return true;
 	}
 
-	if (lookupName(retArg2Funcs, f->getName().data()))
+	if (kind == EXT_RET_ARG2)
 	{
-		NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+		NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 		assert(retIndex != AndersNodeFactory::InvalidIndex && "Failed to find call site node");
-		NodeIndex arg2Index = nodeFactory.getValueNodeFor(cs.getArgument(2));
+		NodeIndex arg2Index = getLocalValueNode(cs.getArgument(2), buffer);
 		assert(arg2Index != AndersNodeFactory::InvalidIndex && "Failed to find arg2 node");
-		constraints.emplace_back(AndersConstraint::COPY, retIndex, arg2Index);
+		buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, arg2Index);
 		return true;
 	}
 
-	if (lookupName(memcpyFuncs, f->getName().data()))
+	if (kind == EXT_MEMCPY)
 	{
-		NodeIndex arg0Index = nodeFactory.getValueNodeFor(cs.getArgument(0));
+		NodeIndex arg0Index = getLocalValueNode(cs.getArgument(0), buffer);
 		assert(arg0Index != AndersNodeFactory::InvalidIndex && "Failed to find arg0 node");
-		NodeIndex arg1Index = nodeFactory.getValueNodeFor(cs.getArgument(1));
+		NodeIndex arg1Index = getLocalValueNode(cs.getArgument(1), buffer);
 		assert(arg1Index != AndersNodeFactory::InvalidIndex && "Failed to find arg1 node");	
 
-		NodeIndex tempIndex = nodeFactory.createValueNode();
-		constraints.emplace_back(AndersConstraint::LOAD, tempIndex, arg1Index);
-		constraints.emplace_back(AndersConstraint::STORE, arg0Index, tempIndex);
+		// Field-sensitively, the fields are copied one by one when both sides are the same struct. Otherwise the layouts are not known, and any field of the source may be copied into any field of the destination
+		unsigned numFields = 1;
+		bool anyField = false;
+		if (fieldSensitive)
+		{
+			Type* dstType = cs.getArgument(0)->stripPointerCasts()->getType()->getPointerElementType();
+			Type* srcType = cs.getArgument(1)->stripPointerCasts()->getType()->getPointerElementType();
+			if (dstType == srcType && dstType->isStructTy())
+				numFields = getNumFieldsFor(dstType);
+			else
+				anyField = true;
+		}
+		auto getFieldPointer = [this, &buffer] (NodeIndex ptrIndex, unsigned offset)
+		{
+			if (offset == 0)
+				return ptrIndex;
+			NodeIndex fieldIndex = buffer.createValueNode();
+			addFieldConstraint(fieldIndex, ptrIndex, offset, buffer);
+			return fieldIndex;
+		};
+		for (unsigned i = 0; i < numFields; ++i)
+		{
+			unsigned offset = anyField ? AndersFieldConstraint::AnyField : i;
+			NodeIndex tempIndex = buffer.createValueNode();
+			buffer.constraints.emplace_back(AndersConstraint::LOAD, tempIndex, getFieldPointer(arg1Index, offset));
+			buffer.constraints.emplace_back(AndersConstraint::STORE, getFieldPointer(arg0Index, offset), tempIndex);
+		}
 
 		// Don't forget the return value
-		NodeIndex retIndex = nodeFactory.getValueNodeFor(cs.getInstruction());
+		NodeIndex retIndex = getLocalValueNode(cs.getInstruction(), buffer);
 		if (retIndex != AndersNodeFactory::InvalidIndex)
-			constraints.emplace_back(AndersConstraint::COPY, retIndex, arg0Index);
+			buffer.constraints.emplace_back(AndersConstraint::COPY, retIndex, arg0Index);
 
 		return true;
 	}
 
-	if (lookupName(convertFuncs, f->getName().data()))
+	if (kind == EXT_CONVERT)
 	{
 		if (!isa<ConstantPointerNull>(cs.getArgument(1)))
 		{
-			NodeIndex arg0Index = nodeFactory.getValueNodeFor(cs.getArgument(0));
+			NodeIndex arg0Index = getLocalValueNode(cs.getArgument(0), buffer);
 			assert(arg0Index != AndersNodeFactory::InvalidIndex && "Failed to find arg0 node");
-			NodeIndex arg1Index = nodeFactory.getValueNodeFor(cs.getArgument(1));
+			NodeIndex arg1Index = getLocalValueNode(cs.getArgument(1), buffer);
 			assert(arg1Index != AndersNodeFactory::InvalidIndex && "Failed to find arg1 node");
-			constraints.emplace_back(AndersConstraint::STORE, arg0Index, arg1Index);
+			buffer.constraints.emplace_back(AndersConstraint::STORE, arg0Index, arg1Index);
 		}
 
 		return true;
 	}
 
-	if (f->getName() == "llvm.va_start")
+	if (kind == EXT_VA_START)
 	{
 		const Instruction* inst = cs.getInstruction();
 		const Function* parentF = inst->getParent()->getParent();
 		assert(parentF->getFunctionType()->isVarArg());
-		NodeIndex arg0Index = nodeFactory.getValueNodeFor(cs.getArgument(0));
+		NodeIndex arg0Index = getLocalValueNode(cs.getArgument(0), buffer);
 		assert(arg0Index != AndersNodeFactory::InvalidIndex && "Failed to find arg0 node");
 		NodeIndex vaIndex = nodeFactory.getVarargNodeFor(parentF);
 		assert(vaIndex != AndersNodeFactory::InvalidIndex && "Failed to find va node");
-		constraints.emplace_back(AndersConstraint::ADDR_OF, arg0Index, vaIndex);
+		buffer.constraints.emplace_back(AndersConstraint::ADDR_OF, arg0Index, vaIndex);
 
 		return true;
 	}
@@ -0,0 +1,715 @@
+#include "Andersen.h"
+#include "FlowSensitiveInfo.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+
+#include <algorithm>
+#include <map>
+
+using namespace llvm;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumMemoryPartitions, "Number of memory partitions made by the flow-sensitive analysis");
+STATISTIC(NumFlowSensitiveStrongUpdates, "Number of stores the flow-sensitive analysis found to replace the contents of a single location");
+
+namespace
+{
+
+// Whether inst may write memory other than through the loads and stores the flow-sensitive analysis follows: the calls, except to the intrinsics that write nothing, and the atomic updates
+bool mayClobberMemory(const Instruction& inst)
+{
+	if (isa<AtomicRMWInst>(inst) || isa<AtomicCmpXchgInst>(inst))
+		return true;
+	ImmutableCallSite cs(&inst);
+	if (!cs || cs.onlyReadsMemory() || isa<DbgInfoIntrinsic>(inst))
+		return false;
+	if (auto intrinsic = dyn_cast<IntrinsicInst>(&inst))
+	{
+		switch (intrinsic->getIntrinsicID())
+		{
+			case Intrinsic::lifetime_start:
+			case Intrinsic::lifetime_end:
+			case Intrinsic::assume:
+				return false;
+			default:
+				break;
+		}
+	}
+	return true;
+}
+
+// The staged flow-sensitive analysis of one function, after Hardekopf and Lin, "Flow-Sensitive Pointer Analysis for Millions of Lines of Code". The solved points-to sets are the auxiliary analysis: they tell which objects each load and store may access, the objects that the same loads and stores access are put into one partition, and each partition is put into SSA form over the dominator tree, as if it were a register. The definitions of a partition (its contents on entry, the stores and the phis) are linked to the loads and stores that use them, and the points-to sets are only propagated along those links, never over the whole control flow graph
+// The function is analyzed on its own: its arguments and what its calls return keep their solved points-to sets, and so do the objects on entry and after each call that may write them, since the solution holds whatever the callers and the callees may do
+class SparseFlowSolver
+{
+private:
+	const AndersNodeFactory& nodeFactory;
+	const CompactPtsGraph& solvedPtsGraph;
+	const DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses;
+	bool fieldSensitive;
+	const Function& func;
+	DominatorTree domTree;
+
+	// The pointers the propagation looks at: the loads and copies of the function, whose sets it refines, and their operands, which keep their solved sets
+	DenseMap<const Value*, unsigned> valueIds;
+	std::vector<const Value*> values;
+	std::vector<AndersPtsSet> valueSets;
+	std::vector<bool> refined;
+	// The solved set of each pointer, or nothing if the analysis doesn't know it. A refined set is kept within the solved one, so it never has what the solver filtered away
+	std::vector<CompactPtsSet> solvedSets;
+	std::vector<bool> knownSolved;
+	// The items to look at again when the set of a pointer grows
+	std::vector<std::vector<unsigned>> valueUsers;
+
+	// The loads and stores of the reachable blocks, and the blocks of the instructions that may write memory behind their back
+	std::vector<const Instruction*> accesses;
+	std::vector<const BasicBlock*> clobberBlocks;
+	// The memory partitions, the slot of each object in its partition, and the partitions each load and store accesses
+	std::vector<std::vector<NodeIndex>> partitions;
+	std::vector<bool> clobberable;
+	DenseMap<NodeIndex, std::pair<unsigned, unsigned>> objectSlots;
+	DenseMap<const Instruction*, SmallVector<unsigned, 2>> accessedPartitions;
+
+	struct MemoryDef
+	{
+		enum DefKind { Entry, Store, Phi } kind;
+		unsigned partition;
+		const StoreInst* store;
+		// The definition a store updates, and the ones a phi merges
+		unsigned incoming;
+		std::vector<unsigned> operands;
+		// What each object of the partition holds after the definition
+		std::vector<AndersPtsSet> contents;
+		std::vector<unsigned> users;
+
+		MemoryDef(DefKind k, unsigned p, unsigned numObjects): kind(k), partition(p), store(nullptr), incoming(0), contents(numObjects) {}
+	};
+	std::vector<MemoryDef> defs;
+	// The contents of each partition on entry, which is also what a call that may write the partition leaves in it
+	std::vector<unsigned> entryDefs;
+	DenseMap<const BasicBlock*, std::vector<std::pair<unsigned, unsigned>>> blockPhis;
+	// The definitions each load reads, by partition, and the ones each store makes
+	DenseMap<const LoadInst*, SmallVector<std::pair<unsigned, unsigned>, 2>> loadDefs;
+	DenseMap<const StoreInst*, SmallVector<unsigned, 2>> storeDefs;
+
+	std::vector<unsigned> workList;
+	std::vector<bool> inWorkList;
+
+	CompactPtsSet getSolvedSet(NodeIndex n) const
+	{
+		CompactPtsSet set(nullptr, nullptr);
+		solvedPtsGraph.find(nodeFactory.getMergeTarget(n), set);
+		return set;
+	}
+	void copySolvedSet(const CompactPtsSet& set, AndersPtsSet& ptsSet) const
+	{
+		for (auto obj: set)
+		{
+			if (obj == nodeFactory.getNullObjectNode())
+				ptsSet.insertNullObject();
+			else
+				ptsSet.insert(obj);
+		}
+	}
+
+	unsigned getValueId(const Value* v)
+	{
+		auto itr = valueIds.find(v);
+		if (itr != valueIds.end())
+			return itr->second;
+
+		unsigned id = values.size();
+		valueIds[v] = id;
+		values.push_back(v);
+		valueSets.emplace_back();
+		refined.push_back(false);
+		valueUsers.emplace_back();
+		NodeIndex n = nodeFactory.getValueNodeFor(v);
+		bool known = n != AndersNodeFactory::InvalidIndex && n != nodeFactory.getUniversalPtrNode();
+		solvedSets.push_back(known ? getSolvedSet(n) : CompactPtsSet(nullptr, nullptr));
+		knownSolved.push_back(known);
+		return id;
+	}
+	unsigned getDefItem(unsigned d) const { return values.size() + d; }
+
+	// The copies whose sets are refined. A getelementptr only copies its operand when the objects are not split into fields
+	bool isCopy(const Instruction& inst) const
+	{
+		if (!inst.getType()->isPointerTy())
+			return false;
+		switch (inst.getOpcode())
+		{
+			case Instruction::BitCast:
+				return inst.getOperand(0)->getType()->isPointerTy();
+			case Instruction::GetElementPtr:
+				return !fieldSensitive;
+			case Instruction::PHI:
+			case Instruction::Select:
+				return true;
+			default:
+				return false;
+		}
+	}
+	template <typename Callback>
+	void forEachCopySource(const Instruction& inst, Callback callback) const
+	{
+		if (auto phi = dyn_cast<PHINode>(&inst))
+		{
+			for (auto const& incoming: phi->incoming_values())
+				callback(incoming.get());
+		}
+		else if (isa<SelectInst>(inst))
+		{
+			callback(inst.getOperand(1));
+			callback(inst.getOperand(2));
+		}
+		else
+			callback(inst.getOperand(0));
+	}
+
+	// An alloca whose address is only used to load from and store to it. No pointer but the alloca itself can reach it, so no call writes it, and each activation of the function has its own
+	bool isPrivateAlloca(NodeIndex obj) const
+	{
+		if (locationClasses.count(obj) || nodeFactory.getNumFields(obj) != 1)
+			return false;
+		auto alloca = dyn_cast_or_null<AllocaInst>(nodeFactory.getValueForNode(obj));
+		if (alloca == nullptr || alloca->getParent()->getParent() != &func || alloca->isArrayAllocation())
+			return false;
+		for (auto user: alloca->users())
+		{
+			if (auto load = dyn_cast<LoadInst>(user))
+			{
+				if (load->getPointerOperand() != alloca)
+					return false;
+			}
+			else if (auto store = dyn_cast<StoreInst>(user))
+			{
+				if (store->getPointerOperand() != alloca || store->getValueOperand() == alloca)
+					return false;
+			}
+			else
+				return false;
+		}
+		return true;
+	}
+	// Whether a store of type t through a pointer to obj alone replaces all that obj holds: obj must be a single location of type t, i.e. a global variable or a private alloca, with nothing location equivalent to it
+	bool isSingleLocation(NodeIndex obj, Type* t) const
+	{
+		if (locationClasses.count(obj) || nodeFactory.getNumFields(obj) != 1)
+			return false;
+		const Value* v = nodeFactory.getValueForNode(obj);
+		if (auto global = dyn_cast_or_null<GlobalVariable>(v))
+			return global->getValueType() == t;
+		return isPrivateAlloca(obj) && cast<AllocaInst>(v)->getAllocatedType() == t;
+	}
+	// The objects a store to ptr may replace, or InvalidIndex if it may only add to what they hold
+	NodeIndex getStrongUpdateTarget(const StoreInst* store) const
+	{
+		const AndersPtsSet& ptrSet = valueSets[valueIds.lookup(store->getPointerOperand())];
+		if (!store->getValueOperand()->getType()->isPointerTy() || ptrSet.getSize() - ptrSet.hasNullObject() != 1)
+			return AndersNodeFactory::InvalidIndex;
+		NodeIndex obj = *ptrSet.begin();
+		return isSingleLocation(obj, store->getValueOperand()->getType()) ? obj : AndersNodeFactory::InvalidIndex;
+	}
+
+	void collect()
+	{
+		for (auto const& bb: func)
+		{
+			if (!domTree.isReachableFromEntry(&bb))
+				continue;
+			for (auto const& inst: bb)
+			{
+				if (auto load = dyn_cast<LoadInst>(&inst))
+				{
+					if (!load->getType()->isPointerTy())
+						continue;
+					unsigned id = getValueId(load);
+					unsigned ptrId = getValueId(load->getPointerOperand());
+					// A load through a pointer the analysis doesn't know keeps its solved set
+					if (!knownSolved[id] || !knownSolved[ptrId])
+						continue;
+					refined[id] = true;
+					valueUsers[ptrId].push_back(id);
+					accesses.push_back(load);
+				}
+				else if (auto store = dyn_cast<StoreInst>(&inst))
+				{
+					unsigned ptrId = getValueId(store->getPointerOperand());
+					if (store->getValueOperand()->getType()->isPointerTy())
+						getValueId(store->getValueOperand());
+					// The analysis doesn't know which objects the store writes, so it is taken to write them all
+					if (!knownSolved[ptrId])
+						clobberBlocks.push_back(&bb);
+					else
+						accesses.push_back(store);
+				}
+				else if (isCopy(inst))
+				{
+					unsigned id = getValueId(&inst);
+					if (!knownSolved[id])
+						continue;
+					refined[id] = true;
+					forEachCopySource(inst, [this, id](const Value* src)
+					{
+						unsigned srcId = getValueId(src);
+						valueUsers[srcId].push_back(id);
+					});
+				}
+				else if (mayClobberMemory(inst))
+					clobberBlocks.push_back(&bb);
+			}
+		}
+
+		for (unsigned id = 0, e = values.size(); id < e; ++id)
+		{
+			if (refined[id])
+				continue;
+			if (knownSolved[id])
+				copySolvedSet(solvedSets[id], valueSets[id]);
+			else
+				valueSets[id].insert(nodeFactory.getUniversalObjNode());
+		}
+	}
+
+	// Put the objects that the same loads and stores may access into one partition
+	void partition()
+	{
+		DenseMap<NodeIndex, std::vector<unsigned>> accessesOfObject;
+		for (unsigned i = 0, e = accesses.size(); i < e; ++i)
+		{
+			const Value* ptr = isa<LoadInst>(accesses[i]) ? cast<LoadInst>(accesses[i])->getPointerOperand() : cast<StoreInst>(accesses[i])->getPointerOperand();
+			for (auto obj: solvedSets[valueIds.lookup(ptr)])
+				if (obj != nodeFactory.getNullObjectNode())
+					accessesOfObject[obj].push_back(i);
+		}
+		std::vector<NodeIndex> objects;
+		objects.reserve(accessesOfObject.size());
+		for (auto const& mapping: accessesOfObject)
+			objects.push_back(mapping.first);
+		std::sort(objects.begin(), objects.end());
+
+		std::map<std::vector<unsigned>, unsigned> partitionOfAccesses;
+		for (auto obj: objects)
+		{
+			auto const& objAccesses = accessesOfObject[obj];
+			auto res = partitionOfAccesses.insert(std::make_pair(objAccesses, partitions.size()));
+			if (res.second)
+			{
+				partitions.emplace_back();
+				clobberable.push_back(false);
+			}
+			unsigned p = res.first->second;
+			objectSlots[obj] = std::make_pair(p, partitions[p].size());
+			partitions[p].push_back(obj);
+			if (!isPrivateAlloca(obj))
+				clobberable[p] = true;
+			for (auto i: objAccesses)
+			{
+				auto& accessed = accessedPartitions[accesses[i]];
+				if (std::find(accessed.begin(), accessed.end(), p) == accessed.end())
+					accessed.push_back(p);
+			}
+		}
+		NumMemoryPartitions += partitions.size();
+	}
+
+	// Place the phis of each partition at the iterated dominance frontier of the blocks that define it
+	void placePhis()
+	{
+		// The dominance frontiers (Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm")
+		DenseMap<const BasicBlock*, SmallVector<const BasicBlock*, 4>> frontiers;
+		for (auto const& bb: func)
+		{
+			if (!domTree.isReachableFromEntry(&bb))
+				continue;
+			unsigned numPreds = 0;
+			for (auto pred: predecessors(&bb))
+				if (domTree.isReachableFromEntry(pred))
+					++numPreds;
+			if (numPreds < 2)
+				continue;
+			const BasicBlock* idom = domTree.getNode(&bb)->getIDom()->getBlock();
+			for (auto pred: predecessors(&bb))
+			{
+				if (!domTree.isReachableFromEntry(pred))
+					continue;
+				for (const BasicBlock* runner = pred; runner != idom; runner = domTree.getNode(runner)->getIDom()->getBlock())
+				{
+					auto& frontier = frontiers[runner];
+					if (std::find(frontier.begin(), frontier.end(), &bb) == frontier.end())
+						frontier.push_back(&bb);
+				}
+			}
+		}
+
+		std::vector<std::vector<const BasicBlock*>> defBlocks(partitions.size());
+		for (auto access: accesses)
+			if (isa<StoreInst>(access))
+				for (auto p: accessedPartitions[access])
+					defBlocks[p].push_back(access->getParent());
+		for (unsigned p = 0, e = partitions.size(); p < e; ++p)
+			if (clobberable[p])
+				defBlocks[p].insert(defBlocks[p].end(), clobberBlocks.begin(), clobberBlocks.end());
+
+		// Each block is stamped with the partition that last put it on the work list, and the one that last put a phi into it
+		DenseMap<const BasicBlock*, unsigned> workStamps, phiStamps;
+		std::vector<const BasicBlock*> blocks;
+		for (unsigned p = 0, e = partitions.size(); p < e; ++p)
+		{
+			for (auto bb: defBlocks[p])
+				if (workStamps[bb] != p + 1)
+				{
+					workStamps[bb] = p + 1;
+					blocks.push_back(bb);
+				}
+			while (!blocks.empty())
+			{
+				const BasicBlock* bb = blocks.back();
+				blocks.pop_back();
+				auto itr = frontiers.find(bb);
+				if (itr == frontiers.end())
+					continue;
+				for (auto frontier: itr->second)
+				{
+					if (phiStamps[frontier] == p + 1)
+						continue;
+					phiStamps[frontier] = p + 1;
+					blockPhis[frontier].emplace_back(p, defs.size());
+					defs.emplace_back(MemoryDef::Phi, p, partitions[p].size());
+					if (workStamps[frontier] != p + 1)
+					{
+						workStamps[frontier] = p + 1;
+						blocks.push_back(frontier);
+					}
+				}
+			}
+		}
+	}
+
+	void renameBlock(const BasicBlock* bb, std::vector<unsigned>& current, std::vector<std::pair<unsigned, unsigned>>& undo)
+	{
+		auto setCurrent = [&current, &undo](unsigned p, unsigned d)
+		{
+			undo.emplace_back(p, current[p]);
+			current[p] = d;
+		};
+
+		auto phis = blockPhis.find(bb);
+		if (phis != blockPhis.end())
+			for (auto const& phi: phis->second)
+				setCurrent(phi.first, phi.second);
+
+		for (auto const& inst: *bb)
+		{
+			auto accessed = accessedPartitions.find(&inst);
+			if (accessed != accessedPartitions.end())
+			{
+				if (auto load = dyn_cast<LoadInst>(&inst))
+				{
+					unsigned item = valueIds.lookup(load);
+					auto& reaching = loadDefs[load];
+					for (auto p: accessed->second)
+					{
+						reaching.emplace_back(p, current[p]);
+						defs[current[p]].users.push_back(item);
+					}
+				}
+				else
+				{
+					const StoreInst* store = cast<StoreInst>(&inst);
+					for (auto p: accessed->second)
+					{
+						unsigned d = defs.size();
+						defs.emplace_back(MemoryDef::Store, p, partitions[p].size());
+						defs[d].store = store;
+						defs[d].incoming = current[p];
+						defs[current[p]].users.push_back(getDefItem(d));
+						storeDefs[store].push_back(d);
+						valueUsers[valueIds.lookup(store->getPointerOperand())].push_back(getDefItem(d));
+						if (store->getValueOperand()->getType()->isPointerTy())
+							valueUsers[valueIds.lookup(store->getValueOperand())].push_back(getDefItem(d));
+						setCurrent(p, d);
+					}
+				}
+			}
+			else if (mayClobberMemory(inst) || (isa<StoreInst>(inst) && !knownSolved[valueIds.lookup(cast<StoreInst>(inst).getPointerOperand())]))
+			{
+				for (unsigned p = 0, e = partitions.size(); p < e; ++p)
+					if (clobberable[p] && current[p] != entryDefs[p])
+						setCurrent(p, entryDefs[p]);
+			}
+		}
+
+		for (auto succ: successors(bb))
+		{
+			auto succPhis = blockPhis.find(succ);
+			if (succPhis == blockPhis.end())
+				continue;
+			for (auto const& phi: succPhis->second)
+			{
+				defs[phi.second].operands.push_back(current[phi.first]);
+				defs[current[phi.first]].users.push_back(getDefItem(phi.second));
+			}
+		}
+	}
+
+	// Link each definition to its uses with a walk over the dominator tree
+	void rename()
+	{
+		for (unsigned p = 0, e = partitions.size(); p < e; ++p)
+		{
+			unsigned d = defs.size();
+			entryDefs.push_back(d);
+			defs.emplace_back(MemoryDef::Entry, p, partitions[p].size());
+			// A private alloca holds nothing before it is first stored to
+			for (unsigned k = 0, numObjects = partitions[p].size(); k < numObjects; ++k)
+				if (!isPrivateAlloca(partitions[p][k]))
+					copySolvedSet(getSolvedSet(partitions[p][k]), defs[d].contents[k]);
+		}
+
+		std::vector<unsigned> current(entryDefs);
+		std::vector<std::pair<unsigned, unsigned>> undo;
+		struct Frame
+		{
+			const DomTreeNode* node;
+			unsigned child;
+			std::size_t undoMark;
+		};
+		std::vector<Frame> stack;
+		const DomTreeNode* root = domTree.getRootNode();
+		renameBlock(root->getBlock(), current, undo);
+		stack.push_back(Frame{root, 0, 0});
+		while (!stack.empty())
+		{
+			Frame& frame = stack.back();
+			if (frame.child < frame.node->getNumChildren())
+			{
+				const DomTreeNode* child = *(frame.node->begin() + frame.child);
+				++frame.child;
+				std::size_t mark = undo.size();
+				renameBlock(child->getBlock(), current, undo);
+				stack.push_back(Frame{child, 0, mark});
+			}
+			else
+			{
+				for (std::size_t mark = frame.undoMark; undo.size() > mark; undo.pop_back())
+					current[undo.back().first] = undo.back().second;
+				stack.pop_back();
+			}
+		}
+	}
+
+	// Add next to the set of pointer id, within its solved set
+	bool addToValueSet(unsigned id, const AndersPtsSet& next)
+	{
+		AndersPtsSet filtered;
+		for (auto obj: next)
+			if (solvedSets[id].has(obj))
+				filtered.insert(obj);
+		if (next.hasNullObject() && solvedSets[id].has(nodeFactory.getNullObjectNode()))
+			filtered.insertNullObject();
+		return valueSets[id].unionWith(filtered);
+	}
+	bool evaluateValue(unsigned id)
+	{
+		AndersPtsSet next;
+		if (auto load = dyn_cast<LoadInst>(values[id]))
+		{
+			auto const& reaching = loadDefs[load];
+			for (auto obj: valueSets[valueIds.lookup(load->getPointerOperand())])
+			{
+				auto slot = objectSlots.find(obj);
+				if (slot == objectSlots.end())
+					continue;
+				for (auto const& def: reaching)
+				{
+					if (def.first == slot->second.first)
+					{
+						next.unionWith(defs[def.second].contents[slot->second.second]);
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			forEachCopySource(*cast<Instruction>(values[id]), [this, &next](const Value* src)
+			{
+				next.unionWith(valueSets[valueIds.lookup(src)]);
+			});
+		}
+		return addToValueSet(id, next);
+	}
+	bool evaluateDef(unsigned d)
+	{
+		MemoryDef& def = defs[d];
+		bool changed = false;
+		switch (def.kind)
+		{
+			case MemoryDef::Entry:
+				break;
+			case MemoryDef::Phi:
+				for (auto op: def.operands)
+					if (op != d)
+						for (unsigned k = 0, e = def.contents.size(); k < e; ++k)
+							changed |= def.contents[k].unionWith(defs[op].contents[k]);
+				break;
+			case MemoryDef::Store:
+			{
+				const StoreInst* store = def.store;
+				const AndersPtsSet& ptrSet = valueSets[valueIds.lookup(store->getPointerOperand())];
+				// A store through a pointer to nothing never completes, so nothing flows past it
+				if (ptrSet.getSize() == unsigned(ptrSet.hasNullObject()))
+					break;
+				Type* valueType = store->getValueOperand()->getType();
+				const AndersPtsSet* stored = valueType->isPointerTy() ? &valueSets[valueIds.lookup(store->getValueOperand())] : nullptr;
+				// An aggregate or a vector may hold pointers the analysis didn't follow, so the objects get what the solution says they hold
+				bool opaque = valueType->isAggregateType() || valueType->isVectorTy();
+				NodeIndex strongTarget = getStrongUpdateTarget(store);
+				auto const& objects = partitions[def.partition];
+				for (unsigned k = 0, e = objects.size(); k < e; ++k)
+				{
+					if (objects[k] != strongTarget)
+						changed |= def.contents[k].unionWith(defs[def.incoming].contents[k]);
+					if (!ptrSet.has(objects[k]))
+						continue;
+					if (stored != nullptr)
+						changed |= def.contents[k].unionWith(*stored);
+					else if (opaque)
+					{
+						AndersPtsSet solved;
+						copySolvedSet(getSolvedSet(objects[k]), solved);
+						changed |= def.contents[k].unionWith(solved);
+					}
+				}
+				break;
+			}
+		}
+		return changed;
+	}
+	void push(unsigned item)
+	{
+		if (inWorkList[item])
+			return;
+		inWorkList[item] = true;
+		workList.push_back(item);
+	}
+	// The transfer functions only grow with their inputs: a store through a pointer to nothing passes nothing on, so a strong update can only turn into a weak one as the sets grow. Adding up what each item computes therefore ends at the least solution
+	void propagate()
+	{
+		unsigned numValues = values.size();
+		inWorkList.assign(numValues + defs.size(), false);
+		for (unsigned item = numValues + defs.size(); item-- > 0;)
+			if (item >= numValues || refined[item])
+				push(item);
+		while (!workList.empty())
+		{
+			unsigned item = workList.back();
+			workList.pop_back();
+			inWorkList[item] = false;
+			if (item < numValues)
+			{
+				if (evaluateValue(item))
+					for (auto user: valueUsers[item])
+						push(user);
+			}
+			else if (evaluateDef(item - numValues))
+			{
+				for (auto user: defs[item - numValues].users)
+					push(user);
+			}
+		}
+	}
+
+	// Record the set of pointer v in info, listing the objects as Andersen::getPointsToSet() does
+	void record(const Value* v, const AndersPtsSet& ptsSet, AndersFlowSensitiveInfo& info) const
+	{
+		if (ptsSet.has(nodeFactory.getUniversalObjNode()))
+		{
+			info.unknown.insert(v);
+			return;
+		}
+		std::vector<NodeIndex> objects;
+		for (auto obj: ptsSet)
+			objects.push_back(obj);
+		std::sort(objects.begin(), objects.end());
+		NodeIndex lastSpecial = std::max(nodeFactory.getUniversalObjNode(), nodeFactory.getNullObjectNode());
+		auto& list = info.ptsSets[v];
+		list.clear();
+		auto append = [this, &list](NodeIndex obj)
+		{
+			if (const Value* objValue = nodeFactory.getValueForNode(obj))
+				list.push_back(objValue);
+		};
+		for (auto obj: objects)
+		{
+			if (obj <= lastSpecial)
+				continue;
+			append(obj);
+			auto itr = locationClasses.find(obj);
+			if (itr != locationClasses.end())
+				for (auto member: itr->second)
+					append(member);
+		}
+	}
+	void record(const Value* v, AndersFlowSensitiveInfo& info) const
+	{
+		auto itr = valueIds.find(v);
+		if (itr != valueIds.end() && refined[itr->second])
+		{
+			record(v, valueSets[itr->second], info);
+			return;
+		}
+		NodeIndex n = nodeFactory.getValueNodeFor(v);
+		AndersPtsSet ptsSet;
+		if (n == AndersNodeFactory::InvalidIndex || n == nodeFactory.getUniversalPtrNode())
+			ptsSet.insert(nodeFactory.getUniversalObjNode());
+		else
+			copySolvedSet(getSolvedSet(n), ptsSet);
+		record(v, ptsSet, info);
+	}
+public:
+	SparseFlowSolver(const AndersNodeFactory& n, const CompactPtsGraph& g, const DenseMap<NodeIndex, std::vector<NodeIndex>>& l, bool fs, const Function& f): nodeFactory(n), solvedPtsGraph(g), locationClasses(l), fieldSensitive(fs), func(f), domTree(const_cast<Function&>(f)) {}
+
+	void run(AndersFlowSensitiveInfo& info)
+	{
+		collect();
+		partition();
+		placePhis();
+		rename();
+		propagate();
+
+		for (auto const& mapping: storeDefs)
+		{
+			if (getStrongUpdateTarget(mapping.first) != AndersNodeFactory::InvalidIndex)
+			{
+				++info.numStrongUpdates;
+				++NumFlowSensitiveStrongUpdates;
+			}
+		}
+		for (auto const& arg: func.args())
+			if (arg.getType()->isPointerTy())
+				record(&arg, info);
+		for (auto const& bb: func)
+			for (auto const& inst: bb)
+				if (inst.getType()->isPointerTy())
+					record(&inst, info);
+	}
+};
+
+}
+
+void Andersen::computeFlowSensitive(const Function& f, AndersFlowSensitiveInfo& info) const
+{
+	waitForSolution();
+	if (f.isDeclaration())
+		return;
+	SparseFlowSolver solver(nodeFactory, solvedPtsGraph, locationClasses, fieldSensitive, f);
+	solver.run(info);
+}
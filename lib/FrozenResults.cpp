@@ -0,0 +1,134 @@
+#include "FrozenResults.h"
+#include "Andersen.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+AndersFrozenResults::AndersFrozenResults(std::shared_ptr<const Andersen> a): anders(std::move(a))
+{
+	const AndersNodeFactory& nodeFactory = anders->nodeFactory;
+	const CompactPtsGraph& graph = anders->solvedPtsGraph;
+
+	reps.reserve(nodeFactory.getNumNodes());
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+		reps.push_back(nodeFactory.getMergeTarget(n));
+
+	// The special nodes have the smallest indices, so the other objects are those after the last special object
+	NodeIndex lastSpecialObj = std::max(nodeFactory.getUniversalObjNode(), nodeFactory.getNullObjectNode());
+	setSummaries.reserve(graph.getNumSets());
+	for (unsigned id = 0, e = graph.getNumSets(); id < e; ++id)
+	{
+		const CompactPtsSet& set = graph.getSet(id);
+		CompactPtsSet objs = set.getElementsAfter(lastSpecialObj);
+		bool universal = set.has(nodeFactory.getUniversalObjNode());
+		bool mustAliasSingleton = set.getSize() == 1 && objs.getSize() == 1 && !anders->locationClasses.count(*objs.begin());
+		// An object is constant memory if it is a function or a constant global, and so are the objects merged into it as a location equivalence class. The null object is in no category
+		unsigned categories = anders->getSetCategories(id);
+		bool constantMemory = (categories & ~AndersNodeFactory::ConstantMemoryObjects) == 0;
+		setSummaries.push_back(SetSummary{objs, universal, mustAliasSingleton, categories, constantMemory});
+	}
+}
+
+AndersFrozenResults::ResolvedPointer AndersFrozenResults::resolvePointer(const Value* v) const
+{
+	return resolveNode(anders->nodeFactory.getValueNodeFor(v));
+}
+
+AndersFrozenResults::ResolvedPointer AndersFrozenResults::resolveNode(NodeIndex n) const
+{
+	if (n >= reps.size())
+		return ResolvedPointer{AndersNodeFactory::InvalidIndex, CompactPtsGraph::NoSlot};
+
+	n = reps[n];
+	return ResolvedPointer{n, anders->solvedPtsGraph.getSetId(n)};
+}
+
+AliasResult AndersFrozenResults::alias(const Value* v1, const Value* v2) const
+{
+	return aliasResolved(resolvePointer(v1), resolvePointer(v2));
+}
+
+AliasResult AndersFrozenResults::aliasResolved(const ResolvedPointer& p1, const ResolvedPointer& p2) const
+{
+	if (p1.rep == AndersNodeFactory::InvalidIndex || p2.rep == AndersNodeFactory::InvalidIndex)
+		return MayAlias;
+
+	if (p1.rep == p2.rep)
+		return MustAlias;
+
+	return aliasSets(p1.setId, p2.setId);
+}
+
+AliasResult AndersFrozenResults::aliasSets(unsigned setId1, unsigned setId2) const
+{
+	AliasResult result = MayAlias;
+	if (aliasSummaries(setId1, setId2, result))
+		return result;
+	return intersectSets(setId1, setId2) ? MayAlias : NoAlias;
+}
+
+bool AndersFrozenResults::aliasSummaries(unsigned setId1, unsigned setId2, AliasResult& result) const
+{
+	result = MayAlias;
+	if (setId1 == CompactPtsGraph::NoSlot || setId2 == CompactPtsGraph::NoSlot)
+		// We know nothing about at least one of them
+		return true;
+
+	const SetSummary& s1 = setSummaries[setId1];
+	const SetSummary& s2 = setSummaries[setId2];
+	bool isNull1 = !s1.universal && s1.objs.isEmpty();
+	bool isNull2 = !s2.universal && s2.objs.isEmpty();
+	if (isNull1 || isNull2)
+	{
+		// If any of them points to nothing but null, they must not alias each other
+		result = NoAlias;
+		return true;
+	}
+
+	if (s1.universal || s2.universal)
+		return true;
+
+	if (s1.objs.getSize() == 1 && s2.objs.getSize() == 1)
+	{
+		if (*s1.objs.begin() != *s2.objs.begin())
+			result = NoAlias;
+		else if (s1.mustAliasSingleton && s2.mustAliasSingleton)
+			result = MustAlias;
+		return true;
+	}
+
+	// Equal sets share the same id
+	return setId1 == setId2;
+}
+
+bool AndersFrozenResults::mayPointTo(const Value* ptr, const Value* allocSite) const
+{
+	const AndersNodeFactory& nodeFactory = anders->nodeFactory;
+	ResolvedPointer p = resolvePointer(ptr);
+	if (p.rep == AndersNodeFactory::InvalidIndex || p.rep == nodeFactory.getUniversalPtrNode())
+		return true;
+	if (p.setId == CompactPtsGraph::NoSlot)
+		return false;
+	const SetSummary& s = setSummaries[p.setId];
+	if (s.universal)
+		return true;
+
+	NodeIndex obj = nodeFactory.getObjectNodeFor(allocSite);
+	// With -anders-track-values, an object the analysis doesn't know may have been made by a pass since
+	if (obj == AndersNodeFactory::InvalidIndex)
+		return anders->valueTracker != nullptr;
+	if (s.objs.has(obj))
+		return true;
+	// A member of a location equivalence class is in the set through its representative
+	NodeIndex rep = reps[obj];
+	if (rep == obj || !s.objs.has(rep))
+		return false;
+	auto itr = anders->locationClasses.find(rep);
+	return itr != anders->locationClasses.end() && std::find(itr->second.begin(), itr->second.end(), obj) != itr->second.end();
+}
+
+bool AndersFrozenResults::getPointsToSetView(const Value* v, AndersPtsSetView& view) const
+{
+	return anders->getPointsToSetView(v, view);
+}
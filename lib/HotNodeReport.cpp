@@ -0,0 +1,233 @@
+#include "Andersen.h"
+#include "HotNodeReport.h"
+
+#include "llvm/ADT/Twine.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+cl::opt<unsigned> HotNodeCount("anders-hot-nodes", cl::desc("After solving, report the nodes with the largest points-to sets, the most work list visits and the most union work (this many of each), and a histogram of the points-to set sizes"), cl::value_desc("N"), cl::init(0));
+static cl::opt<std::string> HotNodeFile("anders-hot-nodes-file", cl::desc("Write the report of -anders-hot-nodes into a file instead of stderr"), cl::value_desc("filename"));
+cl::opt<unsigned> FunctionCostCount("anders-function-cost", cl::desc("After solving, report the functions whose pointers and objects took the most union work and got the most new copy edges in the worklist solver (this many of each)"), cl::value_desc("N"), cl::init(0));
+static cl::opt<std::string> FunctionCostFile("anders-function-cost-file", cl::desc("Write the report of -anders-function-cost into a file instead of stderr"), cl::value_desc("filename"));
+
+namespace
+{
+
+// The function a value belongs to, or null for the globals and the nodes without a value
+const Function* getParentFunction(const Value* val)
+{
+	if (const Instruction* inst = dyn_cast<Instruction>(val))
+		return inst->getFunction();
+	if (const Argument* arg = dyn_cast<Argument>(val))
+		return arg->getParent();
+	return dyn_cast<Function>(val);
+}
+
+// E.g. "[V #42] %p in @main at foo.c:12:3"
+void printNode(raw_ostream& os, NodeIndex node, const AndersNodeFactory& nodeFactory)
+{
+	os << (nodeFactory.isObjectNode(node) ? "[O #" : "[V #") << node << "] ";
+	const Value* val = nodeFactory.getValueForNode(node);
+	if (val == nullptr)
+	{
+		os << "<no value>";
+		return;
+	}
+	val->printAsOperand(os, false);
+	const Function* f = getParentFunction(val);
+	if (f != nullptr && f != val)
+		os << " in @" << f->getName();
+
+	const DILocation* loc = nullptr;
+	if (const Instruction* inst = dyn_cast<Instruction>(val))
+		loc = inst->getDebugLoc().get();
+	if (loc != nullptr)
+		os << " at " << loc->getFilename() << ":" << loc->getLine() << ":" << loc->getColumn();
+	else if (const DISubprogram* sp = f != nullptr ? f->getSubprogram() : nullptr)
+		os << " at " << sp->getFilename() << ":" << sp->getLine();
+}
+
+// Print the topN nodes with the highest nonzero counts, highest first
+template <typename Count>
+void printTopNodes(raw_ostream& os, const char* title, std::vector<std::pair<Count, NodeIndex>>& counts, unsigned topN, const AndersNodeFactory& nodeFactory)
+{
+	auto end = counts.begin() + std::min<size_t>(topN, counts.size());
+	std::partial_sort(counts.begin(), end, counts.end(), [] (const std::pair<Count, NodeIndex>& lhs, const std::pair<Count, NodeIndex>& rhs)
+	{
+		return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+	});
+	os << "Top nodes by " << title << ":\n";
+	for (auto itr = counts.begin(); itr != end && itr->first != 0; ++itr)
+	{
+		os << "  " << itr->first << "  ";
+		printNode(os, itr->second, nodeFactory);
+		os << "\n";
+	}
+}
+
+// E.g. "@main at foo.c:10", or "<globals>" for tag 0
+void printFunction(raw_ostream& os, const Function* f)
+{
+	if (f == nullptr)
+	{
+		os << "<globals>";
+		return;
+	}
+	os << "@" << f->getName();
+	if (const DISubprogram* sp = f->getSubprogram())
+		os << " at " << sp->getFilename() << ":" << sp->getLine();
+}
+
+// Print the topN tags with the highest nonzero counts, highest first, with their share of the total
+void printTopFunctions(raw_ostream& os, const char* title, std::vector<std::pair<std::uint64_t, unsigned>>& counts, unsigned topN, ArrayRef<const Function*> functions)
+{
+	std::uint64_t total = 0;
+	for (auto const& count: counts)
+		total += count.first;
+	auto end = counts.begin() + std::min<size_t>(topN, counts.size());
+	std::partial_sort(counts.begin(), end, counts.end(), [] (const std::pair<std::uint64_t, unsigned>& lhs, const std::pair<std::uint64_t, unsigned>& rhs)
+	{
+		return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+	});
+	os << "Top functions by " << title << " (" << total << " in all):\n";
+	for (auto itr = counts.begin(); itr != end && itr->first != 0; ++itr)
+	{
+		os << "  " << itr->first << format("  %5.1f%%  ", 100.0 * itr->first / total);
+		printFunction(os, functions[itr->second]);
+		os << "\n";
+	}
+}
+
+}
+
+// The representatives only: the merged nodes have given their sets away. The visits and the unions are counted on the node that was the representative at the time
+void Andersen::printHotNodeReport(raw_ostream& os, unsigned topN) const
+{
+	std::vector<std::pair<unsigned, NodeIndex>> setSizes;
+	// Bucket i holds the sets of size [2^(i-1), 2^i), and bucket 0 the empty ones
+	std::vector<unsigned> histogram;
+	for (auto node: ptsGraph)
+	{
+		if (nodeFactory.getMergeTarget(node) != node)
+			continue;
+		unsigned size = ptsGraph.find(node)->getSize();
+		setSizes.emplace_back(size, node);
+		unsigned bucket = size == 0 ? 0 : Log2_32(size) + 1;
+		if (bucket >= histogram.size())
+			histogram.resize(bucket + 1);
+		++histogram[bucket];
+	}
+
+	os << "----- Hot node report -----\n";
+	printTopNodes(os, "points-to set size", setSizes, topN, nodeFactory);
+	if (nodeProfile)
+	{
+		std::vector<std::pair<unsigned, NodeIndex>> visits;
+		std::vector<std::pair<std::uint64_t, NodeIndex>> unionWork;
+		for (NodeIndex node = 0, e = nodeProfile->getNumNodes(); node < e; ++node)
+		{
+			visits.emplace_back(nodeProfile->getNumVisits(node), node);
+			unionWork.emplace_back(nodeProfile->getUnionWork(node), node);
+		}
+		printTopNodes(os, "work list visits", visits, topN, nodeFactory);
+		printTopNodes(os, "union work", unionWork, topN, nodeFactory);
+	}
+	else
+		os << "The work list visits and the union work are only counted by the sequential worklist solver\n";
+
+	os << "Points-to set sizes:\n";
+	for (unsigned i = 0, e = histogram.size(); i < e; ++i)
+	{
+		if (i == 0)
+			os << "  0";
+		else if (i == 1)
+			os << "  1";
+		else
+			os << "  " << (1u << (i - 1)) << "-" << (1u << i) - 1;
+		os << ": " << histogram[i] << "\n";
+	}
+	os << "----- End of report -----\n";
+}
+
+void Andersen::writeHotNodeReport() const
+{
+	if (HotNodeFile.empty())
+	{
+		printHotNodeReport(errs(), HotNodeCount);
+		return;
+	}
+	std::error_code ec;
+	raw_fd_ostream os(HotNodeFile, ec, sys::fs::F_Text);
+	if (ec)
+		report_fatal_error(Twine("Cannot write the hot node report to ") + HotNodeFile + ": " + ec.message());
+	printHotNodeReport(os, HotNodeCount);
+}
+
+// The tags of the nodes are their functions: the function of the instruction or the argument of a value node or of the call that allocates a heap object, and the function itself for its address, its return and its vararg nodes. The globals and the objects of global variables share tag 0. After createLazily(), the values of the freed bodies are gone, so their nodes have no tag
+void Andersen::assignCostTags()
+{
+	costTagFunctions.assign(1, nullptr);
+	DenseMap<const Function*, unsigned> functionTags;
+	std::vector<SmallVector<unsigned, 2>> tags(nodeFactory.getNumNodes());
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+	{
+		const Value* val = nodeFactory.getValueForNode(n);
+		if (val == nullptr)
+			continue;
+		unsigned tag = 0;
+		if (const Function* f = getParentFunction(val))
+		{
+			auto inserted = functionTags.insert(std::make_pair(f, costTagFunctions.size()));
+			if (inserted.second)
+				costTagFunctions.push_back(f);
+			tag = inserted.first->second;
+		}
+		tags[n].push_back(tag);
+	}
+	nodeFactory.setCostTags(std::move(tags));
+}
+
+// A node charges its work to all the functions of the nodes that had been merged into it at the time, so the shares of the functions that HVN, HU or a cycle lumped together add up to more than the whole
+void Andersen::printFunctionCostReport(raw_ostream& os, unsigned topN) const
+{
+	os << "----- Function cost report -----\n";
+	if (nodeProfile && nodeProfile->getNumTags() != 0)
+	{
+		std::vector<std::pair<std::uint64_t, unsigned>> unionWork, copyEdges;
+		for (unsigned tag = 0, e = nodeProfile->getNumTags(); tag < e; ++tag)
+		{
+			unionWork.emplace_back(nodeProfile->getTagUnionWork(tag), tag);
+			copyEdges.emplace_back(nodeProfile->getTagCopyEdges(tag), tag);
+		}
+		printTopFunctions(os, "union work", unionWork, topN, costTagFunctions);
+		printTopFunctions(os, "copy edges added", copyEdges, topN, costTagFunctions);
+	}
+	else
+		os << "The work is only counted by the sequential worklist solver\n";
+	os << "----- End of report -----\n";
+}
+
+void Andersen::writeFunctionCostReport() const
+{
+	if (FunctionCostFile.empty())
+	{
+		printFunctionCostReport(errs(), FunctionCostCount);
+		return;
+	}
+	std::error_code ec;
+	raw_fd_ostream os(FunctionCostFile, ec, sys::fs::F_Text);
+	if (ec)
+		report_fatal_error(Twine("Cannot write the function cost report to ") + FunctionCostFile + ": " + ec.message());
+	printFunctionCostReport(os, FunctionCostCount);
+}
@@ -0,0 +1,326 @@
+#include "Andersen.h"
+#include "PhaseTimer.h"
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+extern cl::opt<bool> EnableHeapCloning;
+extern cl::opt<bool> EnableTypeMetadataCalls;
+
+// What collecting a function body reads outside of the body: the nodes of the globals, of the functions and of their formal arguments, and the targets of the indirect calls, which are the address-taken functions. Hashing the addresses is enough, since the records only live as long as the module does
+size_t Andersen::hashModuleShape(const Module& M, const SmallPtrSetImpl<const GlobalValue*>* added)
+{
+	auto isAdded = [added] (const GlobalValue& v)
+	{
+		return added != nullptr && added->count(&v);
+	};
+	hash_code hash = hash_value(std::count_if(M.global_begin(), M.global_end(), [&isAdded] (const GlobalVariable& g) { return !isAdded(g); }));
+	for (auto const& g: M.globals())
+		if (!isAdded(g))
+			hash = hash_combine(hash, &g, g.hasInitializer() ? g.getInitializer() : nullptr);
+	for (auto const& f: M)
+		if (!isAdded(f))
+			hash = hash_combine(hash, &f, f.isDeclaration(), f.hasAddressTaken());
+	return hash;
+}
+
+// The points-to set n had in the last solution, with the location equivalence classes spelled out
+void Andersen::getOldPtsSet(NodeIndex n, std::vector<NodeIndex>& objs) const
+{
+	objs.clear();
+	CompactPtsSet set(nullptr, nullptr);
+	if (!solvedPtsGraph.find(n, set))
+		return;
+	for (auto obj: set)
+	{
+		objs.push_back(obj);
+		auto itr = locationClasses.find(obj);
+		if (itr != locationClasses.end())
+			objs.insert(objs.end(), itr->second.begin(), itr->second.end());
+	}
+}
+
+// Find the nodes whose points-to sets the retracted constraints and the dead nodes may have contributed to. The dependencies are taken from the constraints of the last solving, with the loads and the stores resolved through the last solution, which over-approximates the new one
+// Every other node keeps its points-to set, which the new solving can then start from
+void Andersen::findAffectedNodes(ArrayRef<const IncrementalState::FunctionRecord*> retracted, const BitVector& deadNodes, BitVector& affected) const
+{
+	unsigned numNodes = deadNodes.size();
+
+	std::vector<const std::vector<AndersConstraint>*> constraintLists;
+	constraintLists.push_back(&incrementalState->globalConstraints);
+	for (auto const& mapping: incrementalState->functions)
+		constraintLists.push_back(&mapping.second.constraints);
+
+	// The constraints that read the points-to set of each node, and the destinations of the loads that read the contents of each object
+	std::vector<std::vector<AndersConstraint>> readers(numNodes);
+	std::vector<std::vector<NodeIndex>> loadsFrom(numNodes);
+	std::vector<NodeIndex> objs;
+	for (auto list: constraintLists)
+	{
+		for (auto const& c: *list)
+		{
+			switch (c.getType())
+			{
+				case AndersConstraint::ADDR_OF:
+					break;
+				case AndersConstraint::COPY:
+					readers[c.getSrc()].push_back(c);
+					break;
+				case AndersConstraint::LOAD:
+					readers[c.getSrc()].push_back(c);
+					getOldPtsSet(c.getSrc(), objs);
+					for (auto obj: objs)
+						loadsFrom[obj].push_back(c.getDest());
+					break;
+				case AndersConstraint::STORE:
+					readers[c.getSrc()].push_back(c);
+					if (c.getDest() != c.getSrc())
+						readers[c.getDest()].push_back(c);
+					break;
+			}
+		}
+	}
+
+	// The nodes that were merged share one points-to set in the last solution, so they are affected together
+	std::vector<std::vector<NodeIndex>> mergedInto(numNodes);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		if (rep != n)
+			mergedInto[rep].push_back(n);
+	}
+
+	affected.clear();
+	affected.resize(numNodes);
+	std::vector<NodeIndex> workList;
+	auto markOne = [&affected, &workList] (NodeIndex n)
+	{
+		if (!affected.test(n))
+		{
+			affected.set(n);
+			workList.push_back(n);
+		}
+	};
+	auto mark = [this, &mergedInto, &markOne] (NodeIndex n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		markOne(rep);
+		for (auto member: mergedInto[rep])
+			markOne(member);
+	};
+	for (int n = deadNodes.find_first(); n != -1; n = deadNodes.find_next(n))
+		mark(n);
+	// A store changes the contents of the objects its destination points to
+	auto markStore = [this, &objs, &mark] (const AndersConstraint& c)
+	{
+		getOldPtsSet(c.getDest(), objs);
+		for (auto obj: objs)
+			mark(obj);
+	};
+
+	for (auto record: retracted)
+	{
+		for (auto const& c: record->constraints)
+		{
+			if (c.getType() == AndersConstraint::STORE)
+				markStore(c);
+			else
+				mark(c.getDest());
+		}
+	}
+
+	while (!workList.empty())
+	{
+		NodeIndex n = workList.back();
+		workList.pop_back();
+
+		for (auto const& c: readers[n])
+		{
+			if (c.getType() == AndersConstraint::STORE)
+				markStore(c);
+			else
+				mark(c.getDest());
+		}
+		for (auto dest: loadsFrom[n])
+			mark(dest);
+	}
+}
+
+void Andersen::resetAnalysis()
+{
+	// The handles point into the maps that are about to go
+	valueTracker.reset();
+	nodeFactory = AndersNodeFactory();
+	constraints.clear();
+	fieldConstraints.clear();
+	ptsGraph = AndersPtsGraph();
+	solvedPtsGraph.clear();
+	locationClasses.clear();
+	dropQueryIndices();
+	externalLibraryKinds.clear();
+	allocWrappers.clear();
+	fixedArityTargets.clear();
+	varargTargets.clear();
+	typeSlotTargets.clear();
+	indirectCalls.clear();
+	indirectCallIndex.clear();
+	lateCopyTargets.clear();
+	incrementalState.reset();
+	appendState.reset();
+	deferredSolve.reset();
+}
+
+bool Andersen::updateFunctions(const Module& M, ArrayRef<const Function*> changedFuncs)
+{
+	waitForSolution();
+	// The calls to an allocation wrapper are collected from what its body was, so a body that is, or becomes, a wrapper takes its callers along
+	bool wrapperChanged = false;
+	for (auto f: changedFuncs)
+	{
+		bool mayReturnNull = false;
+		if (allocWrappers.count(f) || (EnableHeapCloning && isAllocationWrapper(*f, mayReturnNull)))
+			wrapperChanged = true;
+	}
+	if (!incrementalState || incrementalState->moduleShape != hashModuleShape(M) || wrapperChanged)
+	{
+		resetAnalysis();
+		runOnModule(M);
+		return false;
+	}
+
+	// The nodes of the changed bodies die with them: the instructions they stand for may have been deleted already, and the new instructions get new nodes
+	unsigned oldNumNodes = nodeFactory.getNumNodes();
+	BitVector deadNodes(oldNumNodes);
+	SmallPtrSet<const Function*, 16> changed;
+	std::vector<const IncrementalState::FunctionRecord*> retracted;
+	for (auto f: changedFuncs)
+	{
+		if (!changed.insert(f).second)
+			continue;
+		auto itr = incrementalState->functions.find(f);
+		if (itr == incrementalState->functions.end())
+			continue;
+		retracted.push_back(&itr->second);
+		for (auto n: itr->second.nodes)
+		{
+			deadNodes.set(n);
+			nodeFactory.detachNode(n);
+		}
+	}
+
+	// Start from the last solution wherever the retracted constraints can't have contributed to it. Such a node's set is part of the new solution too, so adding it as address-of constraints changes nothing but the number of iterations it takes the solver to get there
+	BitVector affected;
+	findAffectedNodes(retracted, deadNodes, affected);
+	std::vector<AndersConstraint> seeds;
+	std::vector<NodeIndex> objs;
+	for (NodeIndex n = 0; n < oldNumNodes; ++n)
+	{
+		if (affected.test(n))
+			continue;
+		getOldPtsSet(n, objs);
+		for (auto obj: objs)
+		{
+			assert(!deadNodes.test(obj) && "A dead object is only reachable through affected nodes");
+			seeds.emplace_back(AndersConstraint::ADDR_OF, n, obj);
+		}
+	}
+
+	for (auto f: changed)
+		incrementalState->functions.erase(f);
+	solvedPtsGraph.clear();
+	locationClasses.clear();
+	dropQueryIndices();
+	nodeFactory.resetMergeTargets();
+
+	// Collect the new bodies, in module order like collectConstraints() does
+	constraints.clear();
+	{
+		AndersPhaseTimer timer(AndersPhase::Collection);
+		for (auto const& f: M)
+		{
+			if (!changed.count(&f) || f.isDeclaration() || f.isIntrinsic())
+				continue;
+			createValueNodesForFunction(f);
+			CollectionBuffer buffer;
+			collectConstraintsForFunction(f, buffer);
+			commitCollectionBuffer(buffer);
+		}
+	}
+
+	constraints = incrementalState->globalConstraints;
+	for (auto const& mapping: incrementalState->functions)
+		constraints.insert(constraints.end(), mapping.second.constraints.begin(), mapping.second.constraints.end());
+	constraints.insert(constraints.end(), seeds.begin(), seeds.end());
+	uniquifyConstraints(constraints);
+
+	solveCollectedConstraints();
+	return true;
+}
+
+bool Andersen::appendDefinitions(const Module& M, ArrayRef<const Function*> newFuncs, ArrayRef<const GlobalVariable*> newGlobals)
+{
+	waitForSolution();
+	SmallPtrSet<const GlobalValue*, 16> added;
+	added.insert(newFuncs.begin(), newFuncs.end());
+	added.insert(newGlobals.begin(), newGlobals.end());
+	// The old indirect calls are wired to the functions whose address was taken when they were collected, and the calls to an allocation wrapper are collected from its body. A new vtable may add targets to the old virtual calls
+	bool affectsOldCode = false;
+	for (auto f: newFuncs)
+	{
+		bool mayReturnNull = false;
+		if (isAddressTaken(*f) || (EnableHeapCloning && isAllocationWrapper(*f, mayReturnNull)))
+			affectsOldCode = true;
+	}
+	for (auto g: newGlobals)
+		if (EnableTypeMetadataCalls && g->hasMetadata(LLVMContext::MD_type))
+			affectsOldCode = true;
+	if (!appendState || !appendState->graph || appendState->moduleShape != hashModuleShape(M, &added) || affectsOldCode)
+	{
+		resetAnalysis();
+		runOnModule(M);
+		return false;
+	}
+
+	solvedPtsGraph.clear();
+	dropQueryIndices();
+
+	// Collect the new definitions the way collectConstraints() collects a module: the nodes of the globals and the functions first, since a body or an initializer may refer to any of them
+	constraints.clear();
+	{
+		AndersPhaseTimer timer(AndersPhase::Collection);
+		for (auto g: newGlobals)
+			createGlobalVariableNodes(*g);
+		// None of the new functions has its address taken
+		unsigned funcOrder = 0;
+		for (auto f: newFuncs)
+			createFunctionNodes(*f, funcOrder);
+		for (auto g: newGlobals)
+			collectGlobalInitializerConstraints(*g);
+		if (incrementalState)
+			incrementalState->globalConstraints.insert(incrementalState->globalConstraints.end(), constraints.begin(), constraints.end());
+
+		for (auto f: newFuncs)
+		{
+			if (f->isDeclaration() || f->isIntrinsic())
+				continue;
+			createValueNodesForFunction(*f);
+			CollectionBuffer buffer;
+			collectConstraintsForFunction(*f, buffer);
+			commitCollectionBuffer(buffer);
+		}
+	}
+	uniquifyConstraints(constraints);
+
+	appendState->moduleShape = hashModuleShape(M);
+	if (incrementalState)
+		incrementalState->moduleShape = appendState->moduleShape;
+
+	solveCollectedConstraints();
+	return true;
+}
@@ -0,0 +1,316 @@
+#include "Andersen.h"
+#include "Parallel.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/ErrorHandling.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace llvm;
+
+cl::opt<unsigned> LazyPrefetch("anders-lazy-prefetch", cl::desc("With createLazily(), materialize up to this many function bodies ahead of the collection on a thread of its own, so that reading the bitcode overlaps with collecting the constraints, which then runs on -anders-collect-threads threads (0 to materialize each body when it is collected)"), cl::init(0));
+
+extern cl::opt<bool> EnableOnTheFlyCallGraph;
+extern cl::opt<bool> EnableIncremental;
+extern cl::opt<unsigned> NumCollectThreads;
+
+namespace {
+
+// With -anders-lazy-prefetch, materializes the bodies of funcs in order on a thread of its own, at most window bodies past the last one freed. Materializing a body and freeing one both change the use lists of the globals and the constants the body refers to, so both are done with the IR mutex held. The collection doesn't need it: it only reads the bodies it has been handed and the values they refer to
+class BodyPrefetcher
+{
+private:
+	ArrayRef<Function*> funcs;
+	unsigned window;
+	std::mutex irMutex;
+	std::mutex mutex;
+	std::condition_variable changed;
+	// The number of bodies materialized and freed so far, from the start of funcs
+	size_t numMaterialized = 0;
+	size_t numReleased = 0;
+	bool stopping = false;
+	// Why each body that couldn't be materialized couldn't be
+	std::vector<std::string> errors;
+	// Started last, once everything it uses is there
+	std::thread thread;
+
+	void run();
+public:
+	BodyPrefetcher(ArrayRef<Function*> f, unsigned w): funcs(f), window(w), errors(f.size()), thread(&BodyPrefetcher::run, this) {}
+	~BodyPrefetcher();
+
+	std::mutex& getIRMutex() { return irMutex; }
+	// Wait until the body of funcs[i] has been materialized. Return false and put the reason into error if it couldn't be
+	bool waitFor(size_t i, std::string& error);
+	// The bodies of funcs before end have been freed, which makes room for more
+	void releasedUpTo(size_t end);
+};
+
+void BodyPrefetcher::run()
+{
+	for (size_t i = 0; i < funcs.size(); ++i)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [this, i] { return stopping || i < numReleased + window; });
+			if (stopping)
+				return;
+		}
+		std::string error;
+		{
+			std::lock_guard<std::mutex> irLock(irMutex);
+			if (Error err = funcs[i]->materialize())
+				error = toString(std::move(err));
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		errors[i] = std::move(error);
+		numMaterialized = i + 1;
+		changed.notify_all();
+	}
+}
+
+BodyPrefetcher::~BodyPrefetcher()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	changed.notify_all();
+	thread.join();
+}
+
+bool BodyPrefetcher::waitFor(size_t i, std::string& error)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	changed.wait(lock, [this, i] { return i < numMaterialized; });
+	error = errors[i];
+	return error.empty();
+}
+
+void BodyPrefetcher::releasedUpTo(size_t end)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		numReleased = end;
+	}
+	changed.notify_all();
+}
+
+}	// end of anonymous namespace
+
+std::unique_ptr<Andersen> Andersen::createLazily(Module& m, const BitVector& addressTakenFuncs, std::string& error, const AndersRunOptions& options)
+{
+	// Both resolve calls through the call instructions after collection, when their bodies are gone
+	if (EnableOnTheFlyCallGraph || EnableIncremental)
+	{
+		error = "-enable-otf-callgraph and -anders-incremental need the function bodies after collection";
+		return nullptr;
+	}
+	if (addressTakenFuncs.size() != m.size())
+	{
+		error = "the address-taken functions were found in another module";
+		return nullptr;
+	}
+
+	std::unique_ptr<Andersen> ret(new Andersen());
+	ret->runOptions = options;
+	ret->lazyBodies.reset(new LazyBodyState);
+	ret->lazyBodies->module = &m;
+	unsigned i = 0;
+	for (auto const& f: m)
+	{
+		if (addressTakenFuncs.test(i++))
+			ret->lazyBodies->addressTakenFuncs.insert(&f);
+		// A body that is yet to be materialized still counts as a definition
+		if (!f.isDeclaration())
+			ret->lazyBodies->definedFuncs.insert(&f);
+	}
+	ret->runOnModule(m);
+	return ret;
+}
+
+// Mark the functions the operands of inst refer to that Function::hasAddressTaken() would count: everything but the callee of a call. The constants are followed down to their operands, since a function used by a constant expression has its address taken
+static void markAddressTakenOperands(const Instruction& inst, const DenseMap<const Function*, unsigned>& funcIndices, BitVector& addressTakenFuncs, SmallPtrSetImpl<const Constant*>& visited)
+{
+	ImmutableCallSite cs(&inst);
+	std::vector<const Constant*> workList;
+	for (auto const& use: inst.operands())
+	{
+		if (auto f = dyn_cast<Function>(use.get()))
+		{
+			if (!cs || !cs.isCallee(&use))
+				addressTakenFuncs.set(funcIndices.lookup(f));
+		}
+		else if (auto c = dyn_cast<Constant>(use.get()))
+		{
+			if (!isa<GlobalValue>(c) && visited.insert(c).second)
+				workList.push_back(c);
+		}
+	}
+	while (!workList.empty())
+	{
+		const Constant* c = workList.back();
+		workList.pop_back();
+		for (auto const& op: c->operands())
+		{
+			if (auto f = dyn_cast<Function>(op.get()))
+				addressTakenFuncs.set(funcIndices.lookup(f));
+			else if (auto opConst = dyn_cast<Constant>(op.get()))
+			{
+				if (!isa<GlobalValue>(opConst) && visited.insert(opConst).second)
+					workList.push_back(opConst);
+			}
+		}
+	}
+}
+
+bool Andersen::findAddressTakenFunctions(Module& m, BitVector& addressTakenFuncs, std::string& error)
+{
+	addressTakenFuncs.clear();
+	addressTakenFuncs.resize(m.size());
+	DenseMap<const Function*, unsigned> funcIndices;
+	for (auto const& f: m)
+	{
+		unsigned index = funcIndices.size();
+		funcIndices[&f] = index;
+		// Only the uses outside of the bodies are there yet: the global initializers, the aliases and the bodies materialized already
+		if (f.hasAddressTaken())
+			addressTakenFuncs.set(index);
+	}
+
+	// The constants are shared by all bodies, so each of them is looked into once
+	SmallPtrSet<const Constant*, 32> visited;
+	for (auto& f: m)
+	{
+		if (f.isDeclaration())
+			continue;
+		if (Error err = f.materialize())
+		{
+			error = "cannot materialize " + f.getName().str() + ": " + toString(std::move(err));
+			return false;
+		}
+		for (auto const& bb: f)
+			for (auto const& inst: bb)
+				markAddressTakenOperands(inst, funcIndices, addressTakenFuncs, visited);
+		f.deleteBody();
+	}
+	return true;
+}
+
+bool Andersen::isAddressTaken(const Function& f) const
+{
+	if (lazyBodies)
+		return lazyBodies->addressTakenFuncs.count(&f) != 0;
+	return f.hasAddressTaken();
+}
+
+bool Andersen::isExternalFunction(const Function& f) const
+{
+	if (f.isIntrinsic() || scopedOut.count(&f))
+		return true;
+	if (lazyBodies)
+		return !lazyBodies->definedFuncs.count(&f);
+	return f.isDeclaration();
+}
+
+// Collect the bodies of the module in module order, each materialized for the time being and freed once collected. With -anders-lazy-prefetch, the bodies are materialized ahead on a thread of their own, and they are collected in batches of -anders-collect-threads bodies as the parallel collection does: the value nodes of the whole batch first, then each body into a buffer of its own on a thread of its own, and the buffers committed in order
+void Andersen::collectLazyBodies()
+{
+	std::vector<Function*> funcs;
+	for (auto& f: *lazyBodies->module)
+		if (!f.isDeclaration() && !f.isIntrinsic())
+			funcs.push_back(&f);
+	if (LazyPrefetch == 0)
+	{
+		for (auto f: funcs)
+			collectLazyBody(*f);
+		return;
+	}
+
+	// The arguments of a function are only created the first time they are asked for, which both the collection of a call to it and its materialization may do
+	for (auto& f: *lazyBodies->module)
+		f.arg_begin();
+
+	unsigned batchSize = getNumWorkerThreads(NumCollectThreads);
+	BodyPrefetcher prefetcher(funcs, batchSize + LazyPrefetch);
+	std::vector<CollectionBuffer> buffers;
+	for (size_t begin = 0; begin < funcs.size(); begin += batchSize)
+	{
+		ArrayRef<Function*> batch = makeArrayRef(funcs).slice(begin, std::min<size_t>(batchSize, funcs.size() - begin));
+		NodeIndex firstNode = nodeFactory.getNumNodes();
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			std::string error;
+			if (!prefetcher.waitFor(begin + i, error))
+				report_fatal_error(Twine("Cannot materialize ") + batch[i]->getName() + ": " + error);
+			createValueNodesForFunction(*batch[i]);
+		}
+
+		buffers.clear();
+		buffers.resize(batch.size());
+		runOnThreads(batch.size(), [this, batch, &buffers] (unsigned tid)
+		{
+			collectConstraintsForFunction(*batch[tid], buffers[tid]);
+		});
+		for (auto& buffer: buffers)
+			commitCollectionBuffer(buffer);
+
+		detachBodies(batch, firstNode);
+		{
+			std::lock_guard<std::mutex> lock(prefetcher.getIRMutex());
+			for (auto f: batch)
+				f->deleteBody();
+		}
+		prefetcher.releasedUpTo(begin + batch.size());
+	}
+}
+
+// Collect the constraints of f as the sequential collection does, with its body materialized for the time being
+void Andersen::collectLazyBody(Function& f)
+{
+	NodeIndex firstNode = nodeFactory.getNumNodes();
+	if (Error err = f.materialize())
+		report_fatal_error(Twine("Cannot materialize ") + f.getName() + ": " + toString(std::move(err)));
+
+	createValueNodesForFunction(f);
+	CollectionBuffer buffer;
+	collectConstraintsForFunction(f, buffer);
+	commitCollectionBuffer(buffer);
+
+	detachBodies(&f, firstNode);
+	f.deleteBody();
+}
+
+// Get the bodies of funcs ready to be freed. The nodes created for them (from firstNode on) are detached from their instructions before they go away, and the positions of the instructions are recorded for writeSolvedResults()
+void Andersen::detachBodies(ArrayRef<Function*> funcs, NodeIndex firstNode)
+{
+	// The function of each instruction and its position in the body
+	DenseMap<const Value*, std::pair<const Function*, unsigned>> positions;
+	for (auto f: funcs)
+	{
+		unsigned numInsts = 0;
+		for (auto const& bb: *f)
+			for (auto const& inst: bb)
+				positions[&inst] = std::make_pair(f, numInsts++);
+		LazyBodyState::ReleasedBody& body = lazyBodies->releasedBodies[f];
+		body.numInsts = numInsts;
+		body.size = f->size() + numInsts;
+	}
+
+	// Some of the nodes stand for constants rather than instructions, and they stay as they are
+	for (NodeIndex n = firstNode, e = nodeFactory.getNumNodes(); n < e; ++n)
+	{
+		auto itr = positions.find(nodeFactory.getValueForNode(n));
+		if (itr == positions.end())
+			continue;
+		lazyBodies->releasedBodies[itr->second.first].nodes.emplace_back(n, itr->second.second);
+		nodeFactory.detachNode(n);
+	}
+}
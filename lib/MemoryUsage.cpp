@@ -0,0 +1,69 @@
+#include "Andersen.h"
+#include "MemoryUsage.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+cl::opt<bool> MemoryReport("anders-memory-report", cl::desc("Print the memory of each data structure of the analysis to stderr at the start of each phase, at the end of the solving and at the end of the analysis"));
+
+std::size_t getSparseBitVectorMemoryUsage(const SparseBitVector<>& bits)
+{
+	typedef SparseBitVectorElement<> Element;
+	unsigned numElements = 0, lastElement = ~0u;
+	for (auto bit: bits)
+	{
+		if (bit / Element::BITS_PER_ELEMENT != lastElement)
+		{
+			++numElements;
+			lastElement = bit / Element::BITS_PER_ELEMENT;
+		}
+	}
+	// The elements are kept in a std::list
+	return numElements * (sizeof(Element) + 2 * sizeof(void*));
+}
+
+void AndersMemoryUsage::print(raw_ostream& os) const
+{
+	os << "nodes=" << nodes / 1024 << "KB"
+		<< " constraints=" << constraints / 1024 << "KB"
+		<< " pts=" << ptsSets / 1024 << "KB"
+		<< " graph_nodes=" << graphNodes / 1024 << "KB"
+		<< " copy_edges=" << copyEdges / 1024 << "KB"
+		<< " complex_edges=" << complexEdges / 1024 << "KB"
+		<< " field_edges=" << fieldEdges / 1024 << "KB"
+		<< " checked_edges=" << checkedEdges / 1024 << "KB"
+		<< " hcd=" << hcdTable / 1024 << "KB"
+		<< " total=" << getTotal() / 1024 << "KB";
+}
+
+AndersMemoryUsage Andersen::getMemoryUsage() const
+{
+	AndersMemoryUsage usage;
+	usage.nodes = nodeFactory.getMemoryUsage();
+	usage.constraints = getVectorMemoryUsage(constraints) + getVectorMemoryUsage(fieldConstraints);
+	usage.ptsSets = ptsGraph.getMemoryUsage() + solvedPtsGraph.getMemoryUsage();
+	// With -enable-constraint-streaming, the collection builds the graph the solver takes over
+	if (solvingGraph != nullptr)
+		solvingGraph->getMemoryUsage(usage);
+	else if (streamedGraph)
+		streamedGraph->getMemoryUsage(usage);
+	usage.hcdTable = hcdTableMemory;
+	return usage;
+}
+
+void Andersen::sampleMemoryUsage(const char* when)
+{
+	if (!MemoryReport && !runOptions.trackPeakMemory)
+		return;
+	AndersMemoryUsage usage = getMemoryUsage();
+	if (MemoryReport)
+	{
+		errs() << "Memory at " << when << ": ";
+		usage.print(errs());
+		errs() << "\n";
+	}
+	if (runOptions.trackPeakMemory && usage.getTotal() > peakMemoryUsage.getTotal())
+		peakMemoryUsage = usage;
+}
@@ -1,6 +1,9 @@
 #include "NodeFactory.h"
+#include "MemoryUsage.h"
 
 #include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/Analysis/ValueTracking.h"
 #include "llvm/Support/raw_ostream.h"
@@ -10,28 +13,93 @@
 using namespace llvm;
 
 const unsigned AndersNodeFactory::InvalidIndex = std::numeric_limits<unsigned int>::max();
+const unsigned AndersNodeFactory::NoTypeClass = std::numeric_limits<unsigned int>::max();
 
-AndersNodeFactory::AndersNodeFactory()
+AndersNodeFactory::AndersNodeFactory(): mergeEpoch(0)
 {
-	// Note that we can't use std::vector::emplace_back() here because AndersNode's constructors are private hence std::vector cannot see it
-
 	// Node #0 is always the universal ptr: the ptr that we don't know anything about.
-	nodes.push_back(AndersNode(AndersNode::VALUE_NODE, 0));
+	createNode(nullptr, false);
 	// Node #0 is always the universal obj: the obj that we don't know anything about.
-	nodes.push_back(AndersNode(AndersNode::OBJ_NODE, 1));
+	createNode(nullptr, true);
 	// Node #2 always represents the null pointer.
-	nodes.push_back(AndersNode(AndersNode::VALUE_NODE, 2));
+	createNode(nullptr, false);
 	// Node #3 is the object that null pointer points to
-	nodes.push_back(AndersNode(AndersNode::OBJ_NODE, 3));
+	createNode(nullptr, true);
+
+	objectCategories[UniversalObjIndex] = UniversalObject;
+
+	assert(getNumNodes() == 4);
+}
+
+// The ObjectCategory of the memory object val stands for
+static unsigned char getCategoryOfObject(const Value* val)
+{
+	if (val == nullptr)
+		return AndersNodeFactory::OtherObject;
+	if (isa<AllocaInst>(val))
+		return AndersNodeFactory::StackObject;
+	if (isa<Function>(val))
+		return AndersNodeFactory::FunctionObject;
+	if (const GlobalVariable* gv = dyn_cast<GlobalVariable>(val))
+		return gv->isConstant() ? AndersNodeFactory::ConstantGlobalObject : AndersNodeFactory::GlobalObject;
+	if (isa<GlobalValue>(val))
+		return AndersNodeFactory::GlobalObject;
+	if (isa<CallInst>(val) || isa<InvokeInst>(val))
+		return AndersNodeFactory::HeapObject;
+	return AndersNodeFactory::OtherObject;
+}
+
+NodeIndex AndersNodeFactory::createNode(const Value* val, bool isObject)
+{
+	NodeIndex nextIdx = mergeTargets.size();
+	mergeTargets.push_back(nextIdx);
+	nodeValues.push_back(val);
+	objectNodes.push_back(isObject);
+	objectCategories.push_back(0);
+	if (hasFieldNodes())
+	{
+		fieldIndices.push_back(0);
+		fieldCounts.push_back(1);
+	}
+	return nextIdx;
+}
 
-	assert(nodes.size() == 4);
+void AndersNodeFactory::reserve(unsigned numValueNodes, unsigned numObjectNodes)
+{
+	unsigned numNodes = getNumNodes() + numValueNodes + numObjectNodes;
+	mergeTargets.reserve(numNodes);
+	nodeValues.reserve(numNodes);
+	objectNodes.reserve(numNodes);
+	objectCategories.reserve(numNodes);
+	valueNodeMap.reserve(valueNodeMap.size() + numValueNodes);
+	objNodeMap.reserve(objNodeMap.size() + numObjectNodes);
+}
+
+void AndersNodeFactory::createFieldNodes(NodeIndex obj, unsigned numFields)
+{
+	assert(obj + 1 == getNumNodes() && isObjectNode(obj) && "The fields must follow their object!");
+	if (numFields <= 1)
+		return;
+	if (!hasFieldNodes())
+	{
+		fieldIndices.assign(getNumNodes(), 0);
+		fieldCounts.assign(getNumNodes(), 1);
+	}
+	fieldCounts[obj] = numFields;
+	// The fields stand for the value of the object, but only the object node is found through it
+	for (unsigned i = 1; i < numFields; ++i)
+	{
+		NodeIndex field = createNode(nodeValues[obj], true);
+		objectCategories[field] = objectCategories[obj];
+		fieldIndices[field] = i;
+		fieldCounts[field] = numFields;
+	}
 }
 
 NodeIndex AndersNodeFactory::createValueNode(const Value* val)
 {
 	//errs() << "inserting " << *val << "\n";
-	unsigned nextIdx = nodes.size();
-	nodes.push_back(AndersNode(AndersNode::VALUE_NODE, nextIdx, val));
+	NodeIndex nextIdx = createNode(val, false);
 	if (val != nullptr)
 	{
 		assert(!valueNodeMap.count(val) && "Trying to insert two mappings to revValueNodeMap!");
@@ -43,8 +111,8 @@ NodeIndex AndersNodeFactory::createValueNode(const Value* val)
 
 NodeIndex AndersNodeFactory::createObjectNode(const Value* val)
 {
-	unsigned nextIdx = nodes.size();
-	nodes.push_back(AndersNode(AndersNode::OBJ_NODE, nextIdx, val));
+	NodeIndex nextIdx = createNode(val, true);
+	objectCategories[nextIdx] = getCategoryOfObject(val);
 	if (val != nullptr)
 	{
 		assert(!objNodeMap.count(val) && "Trying to insert two mappings to revObjNodeMap!");
@@ -54,10 +122,16 @@ NodeIndex AndersNodeFactory::createObjectNode(const Value* val)
 	return nextIdx;
 }
 
+void AndersNodeFactory::shareObjectNode(const Value* val, NodeIndex obj)
+{
+	assert(isObjectNode(obj) && "Sharing a value node as an object!");
+	assert(!objNodeMap.count(val) && "Trying to insert two mappings to revObjNodeMap!");
+	objNodeMap[val] = obj;
+}
+
 NodeIndex AndersNodeFactory::createReturnNode(const llvm::Function* f)
 {
-	unsigned nextIdx = nodes.size();
-	nodes.push_back(AndersNode(AndersNode::VALUE_NODE, nextIdx, f));
+	NodeIndex nextIdx = createNode(f, false);
 
 	assert(!returnMap.count(f) && "Trying to insert two mappings to returnMap!");
 	returnMap[f] = nextIdx;
@@ -67,8 +141,8 @@ NodeIndex AndersNodeFactory::createReturnNode(const llvm::Function* f)
 
 NodeIndex AndersNodeFactory::createVarargNode(const llvm::Function* f)
 {
-	unsigned nextIdx = nodes.size();
-	nodes.push_back(AndersNode(AndersNode::OBJ_NODE, nextIdx, f));
+	NodeIndex nextIdx = createNode(f, true);
+	objectCategories[nextIdx] = OtherObject;
 
 	assert(!varargMap.count(f) && "Trying to insert two mappings to varargMap!");
 	varargMap[f] = nextIdx;
@@ -183,36 +257,226 @@ NodeIndex AndersNodeFactory::getVarargNodeFor(const llvm::Function* f) const
 
 void AndersNodeFactory::mergeNode(NodeIndex n0, NodeIndex n1)
 {
-	assert(n0 < nodes.size() && n1 < nodes.size());
-	nodes[n1].mergeTarget = n0;
+	assert(n0 < getNumNodes() && n1 < getNumNodes());
+	mergeTargets[n1] = n0;
+	++mergeEpoch;
+	// The merged node holds the points-to sets of both, so it can only be filtered by a class they share
+	if (!typeClasses.empty() && typeClasses[n0] != typeClasses[n1])
+		typeClasses[n0] = NoTypeClass;
+	if (!costTags.empty())
+		unionCostTags(n0, n1);
+}
+
+void AndersNodeFactory::unionCostTags(NodeIndex n0, NodeIndex n1)
+{
+	if (std::max(n0, n1) >= costTags.size())
+		costTags.resize(std::max(n0, n1) + 1);
+	auto& tags = costTags[n0];
+	for (auto tag: costTags[n1])
+	{
+		auto pos = std::lower_bound(tags.begin(), tags.end(), tag);
+		if (pos == tags.end() || *pos != tag)
+			tags.insert(pos, tag);
+	}
+}
+
+void AndersNodeFactory::setCostTags(std::vector<SmallVector<unsigned, 2>> tags)
+{
+	costTags = std::move(tags);
+	foldCostTags();
+}
+
+void AndersNodeFactory::foldCostTags()
+{
+	for (NodeIndex n = 0, e = costTags.size(); n < e; ++n)
+	{
+		NodeIndex rep = getMergeTarget(n);
+		if (rep != n)
+			unionCostTags(rep, n);
+	}
+}
+
+void AndersNodeFactory::foldTypeClasses()
+{
+	for (NodeIndex n = 0, e = typeClasses.size(); n < e; ++n)
+	{
+		NodeIndex rep = getMergeTarget(n);
+		if (rep != n && typeClasses[rep] != typeClasses[n])
+			typeClasses[rep] = NoTypeClass;
+	}
+}
+
+// Find the representative with path halving: every node on the way is relinked to its grandparent. This shortens the path about as well as full compression does, in a single pass and without having to remember the path
+void AndersNodeFactory::flattenMergeTargets()
+{
+	for (NodeIndex i = 0, e = getNumNodes(); i < e; ++i)
+		mergeTargets[i] = getMergeTarget(i);
+}
+
+void AndersNodeFactory::resetMergeTargets()
+{
+	for (NodeIndex i = 0, e = getNumNodes(); i < e; ++i)
+		mergeTargets[i] = i;
+}
+
+void AndersNodeFactory::restoreMergeTargets(const NodeIndex* targets)
+{
+	mergeTargets.assign(targets, targets + getNumNodes());
+	++mergeEpoch;
+	foldCostTags();
+}
+
+void AndersNodeFactory::detachNode(NodeIndex n)
+{
+	const Value* val = getValueForNode(n);
+	if (val == nullptr)
+		return;
+	// The value may be gone already, so only its address is used
+	auto& map = isObjectNode(n) ? objNodeMap : valueNodeMap;
+	auto itr = map.find(val);
+	if (itr != map.end() && itr->second == n)
+		map.erase(itr);
+	nodeValues[n] = nullptr;
+}
+
+// The fields of an object stand for its value too (see createFieldNodes()). An object that loses its value keeps its category
+void AndersNodeFactory::setObjectValue(NodeIndex obj, const Value* val)
+{
+	for (unsigned i = 0, e = getNumFields(obj); i < e; ++i)
+	{
+		nodeValues[obj + i] = val;
+		if (val != nullptr)
+			objectCategories[obj + i] = getCategoryOfObject(val);
+	}
 }
 
-NodeIndex AndersNodeFactory::getMergeTarget(NodeIndex n)
+bool AndersNodeFactory::forgetValue(const Value* val)
 {
-	assert(n < nodes.size());
-	NodeIndex ret = nodes[n].mergeTarget;
-	if (ret != n)
+	auto valItr = valueNodeMap.find(val);
+	if (valItr != valueNodeMap.end())
 	{
-		std::vector<NodeIndex> path(1, n);
-		while (ret != nodes[ret].mergeTarget)
+		if (nodeValues[valItr->second] == val)
+			nodeValues[valItr->second] = nullptr;
+		valueNodeMap.erase(valItr);
+	}
+
+	bool hadObject = false;
+	auto objItr = objNodeMap.find(val);
+	if (objItr != objNodeMap.end())
+	{
+		if (nodeValues[objItr->second] == val)
+			setObjectValue(objItr->second, nullptr);
+		objNodeMap.erase(objItr);
+		hadObject = true;
+	}
+
+	if (const Function* f = dyn_cast<Function>(val))
+	{
+		for (auto map: {&returnMap, &varargMap})
 		{
-			path.push_back(ret);
-			ret = nodes[ret].mergeTarget;
+			auto itr = map->find(f);
+			if (itr != map->end())
+			{
+				nodeValues[itr->second] = nullptr;
+				map->erase(itr);
+				hadObject = true;
+			}
 		}
-		for (auto idx: path)
-			nodes[idx].mergeTarget = ret;
 	}
-	assert(ret < nodes.size());
-	return ret;
+	return hadObject;
+}
+
+bool AndersNodeFactory::replaceValue(const Value* oldVal, const Value* newVal)
+{
+	// A constant other than a global is looked up by what it is made of (see getValueNodeForConstant()), so it can't be given a node
+	auto isPlainConstant = [] (const Value* v)
+	{
+		return isa<Constant>(v) && !isa<GlobalValue>(v);
+	};
+
+	auto objItr = objNodeMap.find(oldVal);
+	if (objItr != objNodeMap.end())
+	{
+		NodeIndex obj = objItr->second;
+		const Value* newObj = newVal->stripPointerCasts();
+		auto newItr = objNodeMap.find(newObj);
+		if (isPlainConstant(newObj) || (newItr != objNodeMap.end() && newItr->second != obj))
+			return false;
+		objNodeMap.erase(objItr);
+		objNodeMap[newObj] = obj;
+		if (nodeValues[obj] == oldVal)
+			setObjectValue(obj, newObj);
+	}
+
+	auto valItr = valueNodeMap.find(oldVal);
+	if (valItr != valueNodeMap.end())
+	{
+		NodeIndex n = valItr->second;
+		valueNodeMap.erase(valItr);
+		bool moved = !isPlainConstant(newVal) && valueNodeMap.insert(std::make_pair(newVal, n)).second;
+		if (nodeValues[n] == oldVal)
+			nodeValues[n] = moved ? newVal : nullptr;
+	}
+	return true;
 }
 
-NodeIndex AndersNodeFactory::getMergeTarget(NodeIndex n) const
+std::vector<NodeIndex> AndersNodeFactory::packObjectNodes()
 {
-	assert (n < nodes.size());
-	NodeIndex ret = nodes[n].mergeTarget;
-	while (ret != nodes[ret].mergeTarget)
-		ret = nodes[ret].mergeTarget;
-	return ret;
+	unsigned numNodes = getNumNodes();
+	std::vector<NodeIndex> newIndices(numNodes);
+
+	// The special nodes are checked for by index all over the place, so they stay where they are
+	NodeIndex nextIdx = 0;
+	for (NodeIndex i = 0; i <= NullObjectIndex; ++i)
+		newIndices[i] = nextIdx++;
+	for (NodeIndex i = NullObjectIndex + 1; i < numNodes; ++i)
+		if (objectNodes[i])
+			newIndices[i] = nextIdx++;
+	for (NodeIndex i = NullObjectIndex + 1; i < numNodes; ++i)
+		if (!objectNodes[i])
+			newIndices[i] = nextIdx++;
+	assert(nextIdx == numNodes);
+
+	std::vector<const Value*> newValues(numNodes);
+	std::vector<NodeIndex> newMergeTargets(numNodes);
+	BitVector newObjectNodes(numNodes);
+	std::vector<unsigned char> newCategories(numNodes);
+	for (NodeIndex i = 0; i < numNodes; ++i)
+	{
+		// The collection may have merged some value nodes already (see -anders-coalesce-copies)
+		newMergeTargets[newIndices[i]] = newIndices[mergeTargets[i]];
+		newValues[newIndices[i]] = nodeValues[i];
+		newCategories[newIndices[i]] = objectCategories[i];
+		if (objectNodes[i])
+			newObjectNodes.set(newIndices[i]);
+	}
+	nodeValues.swap(newValues);
+	objectCategories.swap(newCategories);
+	mergeTargets.swap(newMergeTargets);
+	objectNodes = std::move(newObjectNodes);
+	// The objects keep their order, so the fields of an object stay right after it
+	if (hasFieldNodes())
+	{
+		std::vector<unsigned> newFieldIndices(numNodes), newFieldCounts(numNodes);
+		for (NodeIndex i = 0; i < numNodes; ++i)
+		{
+			newFieldIndices[newIndices[i]] = fieldIndices[i];
+			newFieldCounts[newIndices[i]] = fieldCounts[i];
+		}
+		fieldIndices.swap(newFieldIndices);
+		fieldCounts.swap(newFieldCounts);
+	}
+
+	for (auto& mapping: valueNodeMap)
+		mapping.second = newIndices[mapping.second];
+	for (auto& mapping: objNodeMap)
+		mapping.second = newIndices[mapping.second];
+	for (auto& mapping: returnMap)
+		mapping.second = newIndices[mapping.second];
+	for (auto& mapping: varargMap)
+		mapping.second = newIndices[mapping.second];
+
+	return newIndices;
 }
 
 void AndersNodeFactory::getAllocSites(std::vector<const llvm::Value*>& allocSites) const
@@ -223,26 +487,30 @@ void AndersNodeFactory::getAllocSites(std::vector<const llvm::Value*>& allocSite
 		allocSites.push_back(mapping.first);
 }
 
+std::size_t AndersNodeFactory::getMemoryUsage() const
+{
+	std::size_t ret = getVectorMemoryUsage(mergeTargets) + concurrentMergeTargets.getMemoryUsage() + getVectorMemoryUsage(nodeValues) + objectNodes.getMemorySize() + getVectorMemoryUsage(objectCategories);
+	ret += getVectorMemoryUsage(typeClasses) + getVectorMemoryUsage(fieldIndices) + getVectorMemoryUsage(fieldCounts) + getVectorMemoryUsage(costTags);
+	return ret + valueNodeMap.getMemorySize() + objNodeMap.getMemorySize() + returnMap.getMemorySize() + varargMap.getMemorySize();
+}
+
 void AndersNodeFactory::dumpNode(NodeIndex idx) const
 {
-	const AndersNode& n = nodes.at(idx);
-	if (n.type == AndersNode::VALUE_NODE)
-		errs() << "[V ";
-	else if (n.type == AndersNode::OBJ_NODE)
+	if (isObjectNode(idx))
 		errs() << "[O ";
 	else
-		assert(false && "Wrong type number!");
-	errs() << "#" << n.idx << "]";
+		errs() << "[V ";
+	errs() << "#" << idx << "]";
 }
 
 void AndersNodeFactory::dumpNodeInfo() const
 {
 	errs() << "\n----- Print AndersNodeFactory Info -----\n";
-	for (auto const& node: nodes)
+	for (NodeIndex i = 0, e = getNumNodes(); i < e; ++i)
 	{
-		dumpNode(node.getIndex());
+		dumpNode(i);
 		errs() << ", val = ";
-		const Value* val = node.getValue();
+		const Value* val = nodeValues[i];
 		if (val == nullptr)
 			errs() << "nullptr";
 		else if (isa<Function>(val))
@@ -264,7 +532,7 @@ void AndersNodeFactory::dumpNodeInfo() const
 void AndersNodeFactory::dumpRepInfo() const
 {
 	errs() << "\n----- Print Node Merge Info -----\n";
-	for (NodeIndex i = 0, e = nodes.size(); i < e; ++i)
+	for (NodeIndex i = 0, e = getNumNodes(); i < e; ++i)
 	{
 		NodeIndex rep = getMergeTarget(i);
 		if (rep != i)
@@ -0,0 +1,215 @@
+#include "OptimizeCache.h"
+#include "WordFile.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace OptimizeCacheFormat;
+
+std::uint64_t OptimizeCacheEntry::computeKey(const AndersNodeFactory& nodeFactory, ArrayRef<AndersConstraint> constraints, ArrayRef<NodeIndex> indirectTargets, std::uint32_t options)
+{
+	std::uint64_t hash = WordFile::HashSeed;
+	std::uint32_t words[] = { Version, options, nodeFactory.getNumNodes(), static_cast<std::uint32_t>(constraints.size()), static_cast<std::uint32_t>(indirectTargets.size()) };
+	WordFile::hashBytes(hash, words, sizeof(words));
+	for (NodeIndex n = 0, e = nodeFactory.getNumNodes(); n < e; ++n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		WordFile::hashBytes(hash, &rep, sizeof(rep));
+	}
+	for (auto const& c: constraints)
+	{
+		std::uint64_t key = c.getPackedKey();
+		WordFile::hashBytes(hash, &key, sizeof(key));
+	}
+	WordFile::hashBytes(hash, indirectTargets.data(), indirectTargets.size() * sizeof(NodeIndex));
+	return hash;
+}
+
+std::string OptimizeCacheEntry::getFileName(StringRef dir, std::uint64_t key)
+{
+	SmallString<128> path(dir);
+	sys::path::append(path, (Twine::utohexstr(key) + ".aopt").str());
+	return path.str().str();
+}
+
+bool OptimizeCacheEntry::write(StringRef dir, std::uint64_t key, const AndersNodeFactory& nodeFactory, ArrayRef<AndersConstraint> constraints, const DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses, std::string& error)
+{
+	unsigned numNodes = nodeFactory.getNumNodes();
+	std::vector<std::uint64_t> keys;
+	keys.reserve(constraints.size());
+	for (auto const& c: constraints)
+		keys.push_back(c.getPackedKey());
+	std::vector<std::uint32_t> mergeTarget(numNodes);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		mergeTarget[n] = nodeFactory.getMergeTarget(n);
+
+	std::vector<std::uint32_t> classReps, classOffsets, classMembers;
+	for (auto const& mapping: locationClasses)
+		classReps.push_back(mapping.first);
+	std::sort(classReps.begin(), classReps.end());
+	for (auto rep: classReps)
+	{
+		classOffsets.push_back(classMembers.size());
+		auto const& members = locationClasses.find(rep)->second;
+		classMembers.insert(classMembers.end(), members.begin(), members.end());
+	}
+	classOffsets.push_back(classMembers.size());
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.key = key;
+	header.magic = Magic;
+	header.version = Version;
+	header.numNodes = numNodes;
+	header.numConstraints = keys.size();
+	header.numClasses = classReps.size();
+	header.numClassMembers = classMembers.size();
+
+	if (std::error_code ec = sys::fs::create_directories(dir))
+	{
+		error = "cannot create " + dir.str() + ": " + ec.message();
+		return false;
+	}
+	// Other runs may be writing the same entry, so the temporary file is unique to this one
+	std::string fileName = getFileName(dir, key);
+	int fd;
+	SmallString<128> tempName;
+	if (std::error_code ec = sys::fs::createUniqueFile(fileName + ".%%%%%%.tmp", fd, tempName))
+	{
+		error = "cannot write into " + dir.str() + ": " + ec.message();
+		return false;
+	}
+	{
+		raw_fd_ostream os(fd, true);
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WordFile::writeArray<std::uint64_t>(os, keys);
+		WordFile::writeArray<std::uint32_t>(os, mergeTarget);
+		WordFile::writeArray<std::uint32_t>(os, classReps);
+		WordFile::writeArray<std::uint32_t>(os, classOffsets);
+		WordFile::writeArray<std::uint32_t>(os, classMembers);
+		os.close();
+		if (os.has_error())
+		{
+			os.clear_error();
+			sys::fs::remove(tempName);
+			error = "cannot write " + tempName.str().str();
+			return false;
+		}
+	}
+	if (std::error_code ec = sys::fs::rename(tempName, fileName))
+	{
+		sys::fs::remove(tempName);
+		error = "cannot rename " + tempName.str().str() + " to " + fileName + ": " + ec.message();
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<OptimizeCacheEntry> OptimizeCacheEntry::load(StringRef dir, std::uint64_t key, unsigned numNodes, std::string& error)
+{
+	std::string fileName = getFileName(dir, key);
+	auto fileOrErr = MemoryBuffer::getFile(fileName, -1, false);
+	if (!fileOrErr)
+	{
+		if (fileOrErr.getError() != std::errc::no_such_file_or_directory)
+			error = "cannot read " + fileName + ": " + fileOrErr.getError().message();
+		return nullptr;
+	}
+	return load(std::move(*fileOrErr), key, numNodes, error);
+}
+
+std::unique_ptr<OptimizeCacheEntry> OptimizeCacheEntry::load(std::unique_ptr<MemoryBuffer> buffer, std::uint64_t key, unsigned numNodes, std::string& error)
+{
+	const Header* header = WordFile::readHeader<Header>(buffer, Magic, Version, "optimization cache entry", error);
+	if (header == nullptr)
+		return nullptr;
+	if (header->numNodes != numNodes || header->key != key)
+	{
+		error = "the entry was written for other constraints";
+		return nullptr;
+	}
+
+	std::uint64_t numWords = 2 * std::uint64_t(header->numConstraints) + header->numNodes + 2 * std::uint64_t(header->numClasses) + 1 + header->numClassMembers;
+	if (buffer->getBufferSize() != sizeof(Header) + numWords * sizeof(std::uint32_t))
+	{
+		error = "the size of the file doesn't match its header";
+		return nullptr;
+	}
+
+	std::unique_ptr<OptimizeCacheEntry> ret(new OptimizeCacheEntry);
+	ret->header = header;
+	ret->constraints = reinterpret_cast<const std::uint64_t*>(header + 1);
+	const std::uint32_t* words = reinterpret_cast<const std::uint32_t*>(ret->constraints + header->numConstraints);
+	auto take = [&words](std::uint64_t count)
+	{
+		const std::uint32_t* ret = words;
+		words += count;
+		return ret;
+	};
+	ret->mergeTarget = take(header->numNodes);
+	ret->classReps = take(header->numClasses);
+	ret->classOffsets = take(header->numClasses + 1);
+	ret->classMembers = take(header->numClassMembers);
+	ret->buffer = std::move(buffer);
+	if (!ret->isValid(error))
+		return nullptr;
+	return ret;
+}
+
+// The solver trusts the node indices it is given, so a damaged entry must not get that far
+bool OptimizeCacheEntry::isValid(std::string& error) const
+{
+	unsigned numNodes = header->numNodes;
+	// Every representative must be its own, which rules out the cycles getMergeTarget() would loop on
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (mergeTarget[n] >= numNodes || mergeTarget[mergeTarget[n]] != mergeTarget[n])
+		{
+			error = "bad merge target of node " + std::to_string(n);
+			return false;
+		}
+	}
+	for (unsigned i = 0, e = header->numConstraints; i < e; ++i)
+	{
+		AndersConstraint c = AndersConstraint::fromPackedKey(constraints[i]);
+		if (c.getDest() >= numNodes || c.getSrc() >= numNodes)
+		{
+			error = "constraint " + std::to_string(i) + " refers to a node that doesn't exist";
+			return false;
+		}
+	}
+	for (unsigned i = 0, e = header->numClasses; i < e; ++i)
+	{
+		if (classReps[i] >= numNodes || classOffsets[i] > classOffsets[i + 1])
+		{
+			error = "bad location class " + std::to_string(i);
+			return false;
+		}
+	}
+	if (classOffsets[0] != 0 || classOffsets[header->numClasses] != header->numClassMembers || std::any_of(classMembers, classMembers + header->numClassMembers, [numNodes] (std::uint32_t n) { return n >= numNodes; }))
+	{
+		error = "the location classes don't cover their members";
+		return false;
+	}
+	return true;
+}
+
+void OptimizeCacheEntry::restore(AndersNodeFactory& nodeFactory, std::vector<AndersConstraint>& constraints, DenseMap<NodeIndex, std::vector<NodeIndex>>& locationClasses) const
+{
+	nodeFactory.restoreMergeTargets(mergeTarget);
+
+	constraints.clear();
+	constraints.reserve(header->numConstraints);
+	for (unsigned i = 0, e = header->numConstraints; i < e; ++i)
+		constraints.push_back(AndersConstraint::fromPackedKey(this->constraints[i]));
+
+	locationClasses.clear();
+	for (unsigned i = 0, e = header->numClasses; i < e; ++i)
+		locationClasses[classReps[i]].assign(classMembers + classOffsets[i], classMembers + classOffsets[i + 1]);
+}
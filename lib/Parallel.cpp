@@ -0,0 +1,88 @@
+#include "Parallel.h"
+
+#include <algorithm>
+
+static thread_local AndersThreadPool* currentPool = nullptr;
+
+AndersThreadPool::AndersThreadPool(unsigned numThreads): stopping(false)
+{
+	for (unsigned i = 1; i < numThreads; ++i)
+		workers.emplace_back([this] { workerLoop(); });
+}
+
+AndersThreadPool::~AndersThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	hasWork.notify_all();
+	for (auto& worker: workers)
+		worker.join();
+}
+
+unsigned AndersThreadPool::takeTid(Run& run)
+{
+	unsigned tid = run.nextTid++;
+	if (run.nextTid == run.numTids)
+		runs.erase(std::find(runs.begin(), runs.end(), &run));
+	return tid;
+}
+
+void AndersThreadPool::workerLoop()
+{
+	currentPool = this;
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		hasWork.wait(lock, [this] { return stopping || !runs.empty(); });
+		if (runs.empty())
+			return;
+		Run& run = *runs.front();
+		unsigned tid = takeTid(run);
+		lock.unlock();
+		run.func(tid);
+		lock.lock();
+		if (++run.numDone == run.numTids)
+			runDone.notify_all();
+	}
+}
+
+void AndersThreadPool::run(unsigned numTids, const std::function<void(unsigned)>& func)
+{
+	if (numTids <= 1 || workers.empty())
+	{
+		for (unsigned tid = 0; tid < numTids; ++tid)
+			func(tid);
+		return;
+	}
+
+	Run run{func, numTids, 0, 0};
+	std::unique_lock<std::mutex> lock(mutex);
+	runs.push_back(&run);
+	hasWork.notify_all();
+	while (run.nextTid < run.numTids)
+	{
+		unsigned tid = takeTid(run);
+		lock.unlock();
+		run.func(tid);
+		lock.lock();
+		++run.numDone;
+	}
+	runDone.wait(lock, [&run] { return run.numDone == run.numTids; });
+}
+
+AndersThreadPool* AndersThreadPool::getCurrent()
+{
+	return currentPool;
+}
+
+AndersThreadPool::Scope::Scope(AndersThreadPool* pool): saved(currentPool)
+{
+	currentPool = pool;
+}
+
+AndersThreadPool::Scope::~Scope()
+{
+	currentPool = saved;
+}
@@ -0,0 +1,143 @@
+#include "PerfCounters.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+using namespace llvm;
+
+cl::opt<bool> EnablePerfCounters("anders-perf-counters", cl::desc("Count CPU cycles, instructions, LLC misses, branch misses and dTLB misses with the Linux perf_event counters: per phase, printed to stderr at the end of each phase, and per solver iteration in the trace of -anders-trace"));
+
+namespace
+{
+
+const char* const PerfEventNames[] = { "cycles", "instructions", "llc_misses", "branch_misses", "dtlb_misses" };
+
+#ifdef __linux__
+void getPerfEventConfig(unsigned event, perf_event_attr& attr)
+{
+	attr.type = PERF_TYPE_HARDWARE;
+	switch (event)
+	{
+		case PerfCycles:
+			attr.config = PERF_COUNT_HW_CPU_CYCLES;
+			break;
+		case PerfInstructions:
+			attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+			break;
+		case PerfLLCMisses:
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			break;
+		case PerfBranchMisses:
+			attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+			break;
+		case PerfDTLBMisses:
+			attr.type = PERF_TYPE_HW_CACHE;
+			attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+			break;
+	}
+}
+#endif
+
+}
+
+const char* getPerfEventName(AndersPerfEvent event)
+{
+	return PerfEventNames[event];
+}
+
+AndersPerfCounts& AndersPerfCounts::operator+=(const AndersPerfCounts& other)
+{
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+		values[i] += other.values[i];
+	availableMask |= other.availableMask;
+	return *this;
+}
+
+void AndersPerfCounts::print(raw_ostream& os) const
+{
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+	{
+		AndersPerfEvent event = static_cast<AndersPerfEvent>(i);
+		os << (i == 0 ? "" : " ") << getPerfEventName(event) << "=";
+		if (isAvailable(event))
+			os << values[i];
+		else
+			os << "n/a";
+		// The instructions per cycle, which is what most of the layout changes are after
+		if (event == PerfInstructions && isAvailable(PerfCycles) && isAvailable(PerfInstructions) && values[PerfCycles] != 0)
+			os << " ipc=" << format("%.2f", double(values[PerfInstructions]) / values[PerfCycles]);
+	}
+}
+
+AndersPerfCounters::AndersPerfCounters()
+{
+	std::memset(base, 0, sizeof(base));
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+	{
+		fds[i] = -1;
+#ifdef __linux__
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		getPerfEventConfig(i, attr);
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+	}
+	restart();
+}
+
+AndersPerfCounters::~AndersPerfCounters()
+{
+#ifdef __linux__
+	for (int fd: fds)
+		if (fd >= 0)
+			close(fd);
+#endif
+}
+
+void AndersPerfCounters::readRaw(unsigned event, std::uint64_t raw[3]) const
+{
+	raw[0] = raw[1] = raw[2] = 0;
+#ifdef __linux__
+	if (fds[event] >= 0 && ::read(fds[event], raw, 3 * sizeof(std::uint64_t)) != 3 * sizeof(std::uint64_t))
+		raw[0] = raw[1] = raw[2] = 0;
+#endif
+}
+
+AndersPerfCounts AndersPerfCounters::read() const
+{
+	std::uint64_t raw[NumPerfEvents][3];
+	// Read everything first, so that the arithmetic below isn't counted
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+		readRaw(i, raw[i]);
+
+	AndersPerfCounts counts;
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+	{
+		if (fds[i] < 0)
+			continue;
+		counts.availableMask |= 1u << i;
+		std::uint64_t value = raw[i][0] - base[i][0], enabled = raw[i][1] - base[i][1], running = raw[i][2] - base[i][2];
+		if (running != 0 && running < enabled)
+			value = static_cast<std::uint64_t>(double(value) * enabled / running);
+		counts.values[i] = value;
+	}
+	return counts;
+}
+
+void AndersPerfCounters::restart()
+{
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+		readRaw(i, base[i]);
+}
@@ -0,0 +1,500 @@
+#include "Andersen.h"
+#include "PersistedResults.h"
+#include "WordFile.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace llvm;
+using namespace PersistedResultsFormat;
+using WordFile::hashBytes;
+
+void PersistedResultsFormat::enumerateValues(const Module& m, std::vector<const Value*>& values)
+{
+	values.clear();
+	for (auto const& g: m.globals())
+		values.push_back(&g);
+	for (auto const& f: m)
+	{
+		values.push_back(&f);
+		for (auto const& arg: f.args())
+			values.push_back(&arg);
+		for (auto const& bb: f)
+			for (auto const& inst: bb)
+				values.push_back(&inst);
+	}
+}
+
+// The layout hash, with the size of each function body (its basic blocks and instructions) given by getBodySize
+static std::uint64_t hashLayout(const Module& m, unsigned numValues, function_ref<unsigned(const Function&)> getBodySize)
+{
+	std::uint64_t hash = WordFile::HashSeed;
+	hashBytes(hash, &numValues, sizeof(numValues));
+	for (auto const& g: m.globals())
+	{
+		StringRef name = g.getName();
+		hashBytes(hash, name.data(), name.size());
+		hashBytes(hash, "", 1);
+	}
+	for (auto const& f: m)
+	{
+		StringRef name = f.getName();
+		hashBytes(hash, name.data(), name.size());
+		hashBytes(hash, "", 1);
+		unsigned size = getBodySize(f);
+		hashBytes(hash, &size, sizeof(size));
+	}
+	return hash;
+}
+
+std::uint64_t PersistedResultsFormat::hashModuleLayout(const Module& m, unsigned numValues)
+{
+	return hashLayout(m, numValues, [] (const Function& f)
+	{
+		unsigned size = f.size();
+		for (auto const& bb: f)
+			size += bb.size();
+		return size;
+	});
+}
+
+void Andersen::writeSolvedResults(const Module& m, raw_ostream& os) const
+{
+	waitForSolution();
+	// The bodies freed by createLazily() are no longer in m. Their part of the walk is filled in from what was recorded when they were freed, with null in place of their instructions
+	std::vector<const Value*> values;
+	unsigned numNodes = nodeFactory.getNumNodes();
+	std::vector<std::uint32_t> valueNodeOf, valueOfNode(numNodes, NoEntry);
+	if (lazyBodies)
+	{
+		for (auto const& g: m.globals())
+			values.push_back(&g);
+		for (auto const& f: m)
+		{
+			values.push_back(&f);
+			for (auto const& arg: f.args())
+				values.push_back(&arg);
+			auto itr = lazyBodies->releasedBodies.find(&f);
+			if (itr == lazyBodies->releasedBodies.end())
+				continue;
+			unsigned base = values.size();
+			values.resize(base + itr->second.numInsts, nullptr);
+			valueNodeOf.resize(values.size(), NoEntry);
+			for (auto const& node: itr->second.nodes)
+			{
+				valueOfNode[node.first] = base + node.second;
+				if (!nodeFactory.isObjectNode(node.first))
+					valueNodeOf[base + node.second] = node.first;
+			}
+		}
+	}
+	else
+		enumerateValues(m, values);
+	DenseMap<const Value*, unsigned> valueIds;
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+		if (values[i] != nullptr)
+			valueIds[values[i]] = i;
+
+	valueNodeOf.resize(values.size(), NoEntry);
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+	{
+		NodeIndex valNode = values[i] != nullptr ? nodeFactory.getValueNodeFor(values[i]) : AndersNodeFactory::InvalidIndex;
+		if (valNode != AndersNodeFactory::InvalidIndex)
+			valueNodeOf[i] = valNode;
+	}
+
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (const Value* val = nodeFactory.getValueForNode(n))
+		{
+			auto itr = valueIds.find(val);
+			if (itr != valueIds.end())
+				valueOfNode[n] = itr->second;
+		}
+	}
+
+	std::uint64_t moduleHash;
+	if (lazyBodies)
+	{
+		auto const& releasedBodies = lazyBodies->releasedBodies;
+		moduleHash = hashLayout(m, values.size(), [&releasedBodies] (const Function& f)
+		{
+			auto itr = releasedBodies.find(&f);
+			return itr != releasedBodies.end() ? itr->second.size : 0u;
+		});
+	}
+	else
+		moduleHash = hashModuleLayout(m, values.size());
+	writeResults(os, moduleHash, valueNodeOf, valueOfNode);
+}
+
+bool Andersen::writeModuleResults(unsigned index, const Module& m, raw_ostream& os, std::string& error) const
+{
+	if (index >= linkedModules.size())
+	{
+		error = "there is no summary " + std::to_string(index);
+		return false;
+	}
+	const LinkedModule& linked = linkedModules[index];
+	std::vector<const Value*> values;
+	enumerateValues(m, values);
+	std::uint64_t moduleHash = hashModuleLayout(m, values.size());
+	if (values.size() != linked.valueNodeOf.size() || moduleHash != linked.moduleHash)
+	{
+		error = "the summary was written for another module";
+		return false;
+	}
+
+	// The nodes of the other modules have no value in m, except the symbols m refers to, which have been merged with the definitions
+	std::vector<std::uint32_t> valueOfNode(nodeFactory.getNumNodes(), NoEntry);
+	for (auto const& nodeValue: linked.valueOfNode)
+		valueOfNode[nodeValue.first] = nodeValue.second;
+	writeResults(os, moduleHash, linked.valueNodeOf, valueOfNode);
+	return true;
+}
+
+void Andersen::writeResults(raw_ostream& os, std::uint64_t moduleHash, const std::vector<std::uint32_t>& valueNodeOf, const std::vector<std::uint32_t>& valueOfNode) const
+{
+	unsigned numNodes = nodeFactory.getNumNodes();
+	std::vector<std::uint32_t> mergeTarget(numNodes), setOfNode(numNodes);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		mergeTarget[n] = nodeFactory.getMergeTarget(n);
+		unsigned setId = solvedPtsGraph.getSetId(n);
+		setOfNode[n] = (setId == CompactPtsGraph::NoSlot) ? NoEntry : setId;
+	}
+
+	std::vector<std::uint32_t> setOffsets, elems;
+	for (unsigned id = 0, e = solvedPtsGraph.getNumSets(); id < e; ++id)
+	{
+		setOffsets.push_back(elems.size());
+		const CompactPtsSet& set = solvedPtsGraph.getSet(id);
+		elems.insert(elems.end(), set.begin(), set.end());
+	}
+	setOffsets.push_back(elems.size());
+
+	std::vector<std::uint32_t> classReps, classOffsets, classMembers;
+	for (auto const& mapping: locationClasses)
+		classReps.push_back(mapping.first);
+	std::sort(classReps.begin(), classReps.end());
+	for (auto rep: classReps)
+	{
+		classOffsets.push_back(classMembers.size());
+		auto const& members = locationClasses.find(rep)->second;
+		classMembers.insert(classMembers.end(), members.begin(), members.end());
+	}
+	classOffsets.push_back(classMembers.size());
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.moduleHash = moduleHash;
+	header.magic = Magic;
+	header.version = Version;
+	header.numValues = valueNodeOf.size();
+	header.numNodes = numNodes;
+	header.numSets = setOffsets.size() - 1;
+	header.numElems = elems.size();
+	header.numClasses = classReps.size();
+	header.numClassMembers = classMembers.size();
+	header.universalPtrNode = nodeFactory.getUniversalPtrNode();
+	header.universalObjNode = nodeFactory.getUniversalObjNode();
+	header.nullPtrNode = nodeFactory.getNullPtrNode();
+	header.nullObjNode = nodeFactory.getNullObjectNode();
+
+	os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	WordFile::writeArray<std::uint32_t>(os, valueNodeOf);
+	WordFile::writeArray<std::uint32_t>(os, valueOfNode);
+	WordFile::writeArray<std::uint32_t>(os, mergeTarget);
+	WordFile::writeArray<std::uint32_t>(os, setOfNode);
+	WordFile::writeArray<std::uint32_t>(os, setOffsets);
+	WordFile::writeArray<std::uint32_t>(os, elems);
+	WordFile::writeArray<std::uint32_t>(os, classReps);
+	WordFile::writeArray<std::uint32_t>(os, classOffsets);
+	WordFile::writeArray<std::uint32_t>(os, classMembers);
+}
+
+std::unique_ptr<PersistedAndersResults> PersistedAndersResults::load(StringRef fileName, const Module& m, std::string& error)
+{
+	// A file that doesn't need a null terminator is mapped rather than read, so only the pages the queries touch are ever loaded
+	auto fileOrErr = MemoryBuffer::getFile(fileName, -1, false);
+	if (!fileOrErr)
+	{
+		error = "cannot read " + fileName.str() + ": " + fileOrErr.getError().message();
+		return nullptr;
+	}
+	return load(std::move(*fileOrErr), m, error);
+}
+
+std::unique_ptr<PersistedAndersResults> PersistedAndersResults::load(std::unique_ptr<MemoryBuffer> buffer, const Module& m, std::string& error)
+{
+	const Header* header = WordFile::readHeader<Header>(buffer, Magic, Version, "results file", error);
+	if (header == nullptr)
+		return nullptr;
+	size_t size = buffer->getBufferSize();
+
+	std::unique_ptr<PersistedAndersResults> ret(new PersistedAndersResults);
+	enumerateValues(m, ret->values);
+	if (header->numValues != ret->values.size() || header->moduleHash != hashModuleLayout(m, ret->values.size()))
+	{
+		error = "the results were written for another module";
+		return nullptr;
+	}
+
+	std::uint64_t numWords = std::uint64_t(header->numValues) + 3 * std::uint64_t(header->numNodes) + std::uint64_t(header->numSets) + 1 + header->numElems + 2 * std::uint64_t(header->numClasses) + 1 + header->numClassMembers;
+	if (size != sizeof(Header) + numWords * sizeof(std::uint32_t))
+	{
+		error = "the size of the file doesn't match its header";
+		return nullptr;
+	}
+
+	const std::uint32_t* words = reinterpret_cast<const std::uint32_t*>(header + 1);
+	auto take = [&words](std::uint32_t count)
+	{
+		const std::uint32_t* ret = words;
+		words += count;
+		return ret;
+	};
+	ret->header = header;
+	ret->valueNodeOf = take(header->numValues);
+	ret->valueOfNode = take(header->numNodes);
+	ret->mergeTarget = take(header->numNodes);
+	ret->setOfNode = take(header->numNodes);
+	ret->setOffsets = take(header->numSets + 1);
+	ret->elems = take(header->numElems);
+	ret->classReps = take(header->numClasses);
+	ret->classOffsets = take(header->numClasses + 1);
+	ret->classMembers = take(header->numClassMembers);
+	ret->buffer = std::move(buffer);
+
+	ret->valueIds.reserve(ret->values.size());
+	for (unsigned i = 0, e = ret->values.size(); i < e; ++i)
+		ret->valueIds[ret->values[i]] = i;
+	return ret;
+}
+
+// Mirror AndersNodeFactory::getValueNodeFor()
+NodeIndex PersistedAndersResults::getValueNodeFor(const Value* v) const
+{
+	if (const Constant* c = dyn_cast<Constant>(v))
+	{
+		if (!isa<GlobalValue>(c))
+		{
+			if (isa<ConstantPointerNull>(c) || isa<UndefValue>(c))
+				return header->nullPtrNode;
+			if (const ConstantExpr* ce = dyn_cast<ConstantExpr>(c))
+			{
+				switch (ce->getOpcode())
+				{
+					case Instruction::GetElementPtr:
+					case Instruction::BitCast:
+						return getValueNodeFor(ce->getOperand(0));
+					case Instruction::IntToPtr:
+					case Instruction::PtrToInt:
+						return header->universalPtrNode;
+					default:
+						break;
+				}
+			}
+			return AndersNodeFactory::InvalidIndex;
+		}
+	}
+
+	auto itr = valueIds.find(v);
+	if (itr == valueIds.end() || valueNodeOf[itr->second] == NoEntry)
+		return AndersNodeFactory::InvalidIndex;
+	return valueNodeOf[itr->second];
+}
+
+bool PersistedAndersResults::getPtsSet(NodeIndex node, CompactPtsSet& set) const
+{
+	std::uint32_t id = setOfNode[node];
+	if (id == NoEntry)
+		return false;
+	set = CompactPtsSet(elems + setOffsets[id], elems + setOffsets[id + 1]);
+	return true;
+}
+
+CompactPtsSet PersistedAndersResults::getClassMembers(NodeIndex rep) const
+{
+	const std::uint32_t* repEnd = classReps + header->numClasses;
+	const std::uint32_t* itr = std::lower_bound(classReps, repEnd, rep);
+	if (itr == repEnd || *itr != rep)
+		return CompactPtsSet(nullptr, nullptr);
+	unsigned c = itr - classReps;
+	return CompactPtsSet(classMembers + classOffsets[c], classMembers + classOffsets[c + 1]);
+}
+
+const Value* PersistedAndersResults::getValueForNode(NodeIndex node) const
+{
+	std::uint32_t id = valueOfNode[node];
+	return id == NoEntry ? nullptr : values[id];
+}
+
+bool PersistedAndersResults::getPointsToSet(const Value* v, std::vector<const Value*>& ptsSet) const
+{
+	NodeIndex ptr = getValueNodeFor(v);
+	if (ptr == AndersNodeFactory::InvalidIndex || ptr == header->universalPtrNode)
+		return false;
+
+	ptsSet.clear();
+	CompactPtsSet set(nullptr, nullptr);
+	if (!getPtsSet(mergeTarget[ptr], set))
+		return true;
+	if (set.has(header->universalObjNode))
+		return false;
+
+	// List the objects the way AndersPtsSetView does: each object is followed by the objects that are location equivalent to it
+	for (auto obj: set.getElementsAfter(std::max(header->universalObjNode, header->nullObjNode)))
+	{
+		if (const Value* val = getValueForNode(obj))
+			ptsSet.push_back(val);
+		for (auto member: getClassMembers(obj))
+			if (const Value* val = getValueForNode(member))
+				ptsSet.push_back(val);
+	}
+	return true;
+}
+
+// Mirror AndersenAAResult::aliasResolved() and aliasSets()
+AliasResult PersistedAndersResults::alias(const Value* v1, const Value* v2) const
+{
+	NodeIndex n1 = getValueNodeFor(v1), n2 = getValueNodeFor(v2);
+	if (n1 == AndersNodeFactory::InvalidIndex || n2 == AndersNodeFactory::InvalidIndex)
+		return MayAlias;
+
+	n1 = mergeTarget[n1];
+	n2 = mergeTarget[n2];
+	if (n1 == n2)
+		return MustAlias;
+
+	CompactPtsSet set1(nullptr, nullptr), set2(nullptr, nullptr);
+	if (!getPtsSet(n1, set1) || !getPtsSet(n2, set2))
+		return MayAlias;
+
+	NodeIndex lastSpecialObj = std::max(header->universalObjNode, header->nullObjNode);
+	CompactPtsSet objs1 = set1.getElementsAfter(lastSpecialObj), objs2 = set2.getElementsAfter(lastSpecialObj);
+	bool universal1 = set1.has(header->universalObjNode), universal2 = set2.has(header->universalObjNode);
+	if ((!universal1 && objs1.isEmpty()) || (!universal2 && objs2.isEmpty()))
+		return NoAlias;
+	if (universal1 || universal2)
+		return MayAlias;
+
+	if (objs1.getSize() == 1 && objs2.getSize() == 1)
+	{
+		NodeIndex obj = *objs1.begin();
+		if (obj != *objs2.begin())
+			return NoAlias;
+		bool mustAlias = set1.getSize() == 1 && set2.getSize() == 1 && !std::binary_search(classReps, classReps + header->numClasses, obj);
+		return mustAlias ? MustAlias : MayAlias;
+	}
+
+	if (setOfNode[n1] == setOfNode[n2])
+		return MayAlias;
+	return objs1.intersectWith(objs2) ? MayAlias : NoAlias;
+}
+
+unsigned PersistedAndersResults::getValueId(const Value* v) const
+{
+	auto itr = valueIds.find(v);
+	return itr == valueIds.end() ? NoEntry : itr->second;
+}
+
+// Mirror Andersen::buildPointedByIndex(): an object is related to the ids of the sets that have it rather than to the pointers themselves
+void PersistedAndersResults::buildPointedByIndex() const
+{
+	std::unique_ptr<PointedByIndex> index(new PointedByIndex);
+
+	NodeIndex lastSpecialObj = std::max(header->universalObjNode, header->nullObjNode);
+	auto addObject = [this, &index] (NodeIndex obj, unsigned setId)
+	{
+		std::uint32_t id = valueOfNode[obj];
+		if (id != NoEntry)
+			index->setsOfValue[id].push_back(setId);
+	};
+	for (unsigned setId = 0; setId < header->numSets; ++setId)
+	{
+		CompactPtsSet set(elems + setOffsets[setId], elems + setOffsets[setId + 1]);
+		for (auto obj: set.getElementsAfter(lastSpecialObj))
+		{
+			addObject(obj, setId);
+			for (auto member: getClassMembers(obj))
+				addObject(member, setId);
+		}
+	}
+
+	index->pointersOfSet.resize(header->numSets);
+	for (unsigned id = 0; id < header->numValues; ++id)
+	{
+		std::uint32_t node = valueNodeOf[id];
+		if (node == NoEntry || node == header->universalPtrNode)
+			continue;
+		std::uint32_t setId = setOfNode[mergeTarget[node]];
+		if (setId != NoEntry)
+			index->pointersOfSet[setId].push_back(id);
+	}
+
+	pointedByIndex = std::move(index);
+}
+
+bool PersistedAndersResults::getPointedBySet(const Value* allocSite, std::vector<const Value*>& pointers) const
+{
+	unsigned id = getValueId(allocSite);
+	if (id == NoEntry)
+		return false;
+
+	std::call_once(pointedByIndexFlag, [this] { buildPointedByIndex(); });
+
+	pointers.clear();
+	auto itr = pointedByIndex->setsOfValue.find(id);
+	if (itr == pointedByIndex->setsOfValue.end())
+		return true;
+	for (auto setId: itr->second)
+		for (auto pointer: pointedByIndex->pointersOfSet[setId])
+			pointers.push_back(values[pointer]);
+	return true;
+}
+
+// Mirror Andersen::buildResolvedCallGraph(). The file doesn't tell the object node of a function from its vararg node, which stands for the same function, so the functions are deduplicated instead
+bool PersistedAndersResults::getResolvedCallees(const Instruction* callInst, std::vector<const Function*>& callees) const
+{
+	ImmutableCallSite cs(callInst);
+	if (!cs || cs.getCalledFunction() != nullptr || isa<InlineAsm>(cs.getCalledValue()))
+		return false;
+	NodeIndex callee = getValueNodeFor(cs.getCalledValue());
+	if (callee == AndersNodeFactory::InvalidIndex || callee == header->universalPtrNode)
+		return false;
+
+	callees.clear();
+	CompactPtsSet set(nullptr, nullptr);
+	if (!getPtsSet(mergeTarget[callee], set))
+		return true;
+	if (set.has(header->universalObjNode))
+		return false;
+
+	SmallPtrSet<const Function*, 8> seen;
+	auto addCallee = [this, &cs, &callees, &seen] (NodeIndex obj)
+	{
+		const Function* f = dyn_cast_or_null<Function>(getValueForNode(obj));
+		if (f == nullptr || f->isIntrinsic())
+			return;
+		if (!f->getFunctionType()->isVarArg() && f->arg_size() != cs.arg_size())
+			return;
+		if (seen.insert(f).second)
+			callees.push_back(f);
+	};
+	for (auto obj: set.getElementsAfter(std::max(header->universalObjNode, header->nullObjNode)))
+	{
+		addCallee(obj);
+		for (auto member: getClassMembers(obj))
+			addCallee(member);
+	}
+	return true;
+}
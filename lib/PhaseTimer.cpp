@@ -0,0 +1,166 @@
+#include "PhaseTimer.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <mutex>
+
+#ifdef LLVM_ON_UNIX
+#include <sys/resource.h>
+#endif
+
+using namespace llvm;
+
+extern cl::opt<bool> EnablePerfCounters;
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(PeakRSSCollection, "Peak RSS (KB) after constraint collection");
+STATISTIC(PeakRSSDeadPointerElim, "Peak RSS (KB) after dead pointer elimination");
+STATISTIC(PeakRSSHVN, "Peak RSS (KB) after HVN");
+STATISTIC(PeakRSSHU, "Peak RSS (KB) after HU");
+STATISTIC(PeakRSSLE, "Peak RSS (KB) after location equivalence");
+STATISTIC(PeakRSSOfflineHCD, "Peak RSS (KB) after offline HCD");
+STATISTIC(PeakRSSSteensgaard, "Peak RSS (KB) after the Steensgaard pre-analysis");
+STATISTIC(PeakRSSGraphBuild, "Peak RSS (KB) after building the constraint graph");
+STATISTIC(PeakRSSSolving, "Peak RSS (KB) after online solving");
+
+namespace {
+
+const char* const TimerGroupName = "andersen";
+const char* const TimerGroupDesc = "Andersen's analysis";
+
+const char* const PhaseNames[] = { "collection", "dead-pointer-elim", "hvn", "hu", "le", "offline-hcd", "steensgaard", "graph-build", "solving" };
+const char* const PhaseDescs[] = { "Constraint collection", "Dead pointer elimination", "HVN", "HU", "Location equivalence", "Offline HCD", "Steensgaard pre-analysis", "Constraint graph build", "Online solving" };
+
+struct PhaseTimers
+{
+	TimerGroup group;
+	Timer timers[static_cast<unsigned>(AndersPhase::NumPhases)];
+
+#if LLVM_VERSION_MAJOR < 4
+	PhaseTimers(): group(TimerGroupDesc)
+	{
+		for (unsigned i = 0; i < static_cast<unsigned>(AndersPhase::NumPhases); ++i)
+			timers[i].init(PhaseDescs[i], group);
+	}
+#else
+	PhaseTimers(): group(TimerGroupName, TimerGroupDesc)
+	{
+		for (unsigned i = 0; i < static_cast<unsigned>(AndersPhase::NumPhases); ++i)
+			timers[i].init(PhaseNames[i], PhaseDescs[i], group);
+	}
+#endif
+};
+
+// Like the pass timers, the report is printed when the group goes away at llvm_shutdown()
+ManagedStatic<PhaseTimers> phaseTimers;
+
+AndersPhaseRecord phaseRecords[static_cast<unsigned>(AndersPhase::NumPhases)];
+// Analyses that run at the same time (see andersen-batch) end their phases on threads of their own
+std::mutex phaseRecordsMutex;
+
+Timer* getPhaseTimer(AndersPhase phase)
+{
+	if (!TimePassesIsEnabled)
+		return nullptr;
+	return &phaseTimers->timers[static_cast<unsigned>(phase)];
+}
+
+}	// end of anonymous namespace
+
+// It never goes down, so recording it at the end of each phase tells which phase raised it
+unsigned getProcessPeakRSS()
+{
+#ifdef LLVM_ON_UNIX
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	// Darwin reports bytes rather than KB
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+}
+
+const AndersPhaseRecord& getPhaseRecord(AndersPhase phase)
+{
+	return phaseRecords[static_cast<unsigned>(phase)];
+}
+
+void resetPhaseRecords()
+{
+	for (auto& record: phaseRecords)
+		record = AndersPhaseRecord();
+}
+
+const char* getPhaseName(AndersPhase phase)
+{
+	return PhaseNames[static_cast<unsigned>(phase)];
+}
+
+AndersPhaseTimer::AndersPhaseTimer(AndersPhase p): phase(p), region(getPhaseTimer(p)), start(std::chrono::steady_clock::now())
+{
+	if (EnablePerfCounters)
+		counters.reset(new AndersPerfCounters());
+}
+
+AndersPhaseTimer::~AndersPhaseTimer()
+{
+	std::lock_guard<std::mutex> lock(phaseRecordsMutex);
+	AndersPhaseRecord& record = phaseRecords[static_cast<unsigned>(phase)];
+	if (counters)
+	{
+		AndersPerfCounts counts = counters->read();
+		record.counters += counts;
+		errs() << "Perf counters of " << getPhaseName(phase) << ": ";
+		counts.print(errs());
+		errs() << "\n";
+	}
+
+	unsigned peakRSS = getProcessPeakRSS();
+	record.wallTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	record.peakRSS = peakRSS;
+
+	switch (phase)
+	{
+		case AndersPhase::Collection:
+			PeakRSSCollection = peakRSS;
+			break;
+		case AndersPhase::DeadPointerElim:
+			PeakRSSDeadPointerElim = peakRSS;
+			break;
+		case AndersPhase::HVN:
+			PeakRSSHVN = peakRSS;
+			break;
+		case AndersPhase::HU:
+			PeakRSSHU = peakRSS;
+			break;
+		case AndersPhase::LE:
+			PeakRSSLE = peakRSS;
+			break;
+		case AndersPhase::OfflineHCD:
+			PeakRSSOfflineHCD = peakRSS;
+			break;
+		case AndersPhase::Steensgaard:
+			PeakRSSSteensgaard = peakRSS;
+			break;
+		case AndersPhase::GraphBuild:
+			PeakRSSGraphBuild = peakRSS;
+			break;
+		case AndersPhase::Solving:
+			PeakRSSSolving = peakRSS;
+			break;
+		case AndersPhase::NumPhases:
+			llvm_unreachable("Not a phase");
+	}
+}
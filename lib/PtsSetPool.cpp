@@ -0,0 +1,163 @@
+#include "PtsSetPool.h"
+#include "MemoryUsage.h"
+
+#include "llvm/ADT/Hashing.h"
+
+#include <cassert>
+
+using namespace llvm;
+
+AndersPtsSetPool::~AndersPtsSetPool()
+{
+	for (auto const& mapping: liveEntries)
+		delete mapping.second;
+}
+
+AndersPtsSetPool& AndersPtsSetPool::getGlobalPool()
+{
+	static AndersPtsSetPool pool;
+	return pool;
+}
+
+std::size_t AndersPtsSetPool::hashBits(const BitVec& bits, unsigned& size)
+{
+	hash_code code = hash_value(0u);
+	size = 0;
+	for (auto idx: bits)
+	{
+		code = hash_combine(code, idx);
+		++size;
+	}
+	return code;
+}
+
+const AndersPtsSetPool::Entry* AndersPtsSetPool::internLocked(BitVec&& bits)
+{
+	if (bits.empty())
+		return nullptr;
+
+	unsigned size;
+	std::size_t hash = hashBits(bits, size);
+	auto range = table.equal_range(hash);
+	for (auto itr = range.first; itr != range.second; ++itr)
+	{
+		if (itr->second->bits == bits)
+		{
+			retainLocked(itr->second);
+			return itr->second;
+		}
+	}
+
+	Entry* entry = new Entry(std::move(bits), hash, nextId++, size);
+	table.insert(std::make_pair(hash, entry));
+	liveEntries[entry->id] = entry;
+	retainLocked(entry);
+	return entry;
+}
+
+void AndersPtsSetPool::retainLocked(const Entry* entry)
+{
+	if (entry != nullptr)
+		++const_cast<Entry*>(entry)->refCount;
+}
+
+void AndersPtsSetPool::releaseLocked(const Entry* entry)
+{
+	if (entry == nullptr)
+		return;
+
+	Entry* mutableEntry = const_cast<Entry*>(entry);
+	assert(mutableEntry->refCount > 0 && "Releasing a dead entry!");
+	if (--mutableEntry->refCount > 0)
+		return;
+
+	auto range = table.equal_range(mutableEntry->hash);
+	for (auto itr = range.first; itr != range.second; ++itr)
+	{
+		if (itr->second == mutableEntry)
+		{
+			table.erase(itr);
+			break;
+		}
+	}
+	liveEntries.erase(mutableEntry->id);
+	delete mutableEntry;
+
+	// Memo entries that mention dead ids are useless. Throw the memo away once it gets much larger than the pool itself
+	if (unionMemo.size() > 4 * liveEntries.size() + 1024)
+		unionMemo.clear();
+}
+
+const AndersPtsSetPool::Entry* AndersPtsSetPool::intern(BitVec&& bits)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return internLocked(std::move(bits));
+}
+
+const AndersPtsSetPool::Entry* AndersPtsSetPool::getUnion(const Entry* lhs, const Entry* rhs)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (lhs == rhs || rhs == nullptr)
+	{
+		retainLocked(lhs);
+		return lhs;
+	}
+	if (lhs == nullptr)
+	{
+		retainLocked(rhs);
+		return rhs;
+	}
+
+	// Union is commutative: normalize the key
+	auto key = lhs->id < rhs->id ? std::make_pair(lhs->id, rhs->id) : std::make_pair(rhs->id, lhs->id);
+	auto memoItr = unionMemo.find(key);
+	if (memoItr != unionMemo.end())
+	{
+		auto liveItr = liveEntries.find(memoItr->second);
+		if (liveItr != liveEntries.end())
+		{
+			retainLocked(liveItr->second);
+			return liveItr->second;
+		}
+	}
+
+	BitVec bits(lhs->bits);
+	bits |= rhs->bits;
+	const Entry* result = internLocked(std::move(bits));
+	unionMemo[key] = result->id;
+	return result;
+}
+
+void AndersPtsSetPool::retain(const Entry* entry)
+{
+	if (entry == nullptr)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	retainLocked(entry);
+}
+
+void AndersPtsSetPool::release(const Entry* entry)
+{
+	if (entry == nullptr)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	releaseLocked(entry);
+}
+
+unsigned AndersPtsSetPool::getNumSets() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return liveEntries.size();
+}
+
+// A node of the hash table holds the next pointer and the cached hash besides the pair
+std::size_t AndersPtsSetPool::getMemoryUsage() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::size_t ret = table.bucket_count() * sizeof(void*) + table.size() * (sizeof(decltype(table)::value_type) + 2 * sizeof(void*));
+	ret += liveEntries.getMemorySize() + unionMemo.getMemorySize();
+	for (auto const& mapping: liveEntries)
+		ret += sizeof(Entry) + getSparseBitVectorMemoryUsage(mapping.second->getBits());
+	return ret;
+}
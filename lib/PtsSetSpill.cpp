@@ -0,0 +1,192 @@
+#include "PtsSetSpill.h"
+
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+void AndersPtsGraph::readSpilled(NodeIndex idx) const
+{
+	spilled.reset(idx);
+	spillFile->readBack(idx, sets[idx]);
+}
+
+void AndersPtsGraph::dropSpilled(NodeIndex idx)
+{
+	spilled.reset(idx);
+	spillFile->drop(idx);
+}
+
+std::unique_ptr<PtsSetSpillFile> PtsSetSpillFile::create(StringRef dir, std::string& error)
+{
+	if (std::error_code ec = sys::fs::create_directories(dir))
+	{
+		error = "cannot create " + dir.str() + ": " + ec.message();
+		return nullptr;
+	}
+	SmallString<128> model(dir);
+	sys::path::append(model, "anders-spill-%%%%%%.pts");
+	int fd;
+	SmallString<128> name;
+	if (std::error_code ec = sys::fs::createUniqueFile(model, fd, name))
+	{
+		error = "cannot create a file in " + dir.str() + ": " + ec.message();
+		return nullptr;
+	}
+	return std::unique_ptr<PtsSetSpillFile>(new PtsSetSpillFile(name.str().str(), fd));
+}
+
+PtsSetSpillFile::~PtsSetSpillFile()
+{
+	assert(extents.empty() && "The spilled sets have not been read back");
+	region.reset();
+	sys::Process::SafelyCloseFileDescriptor(fd);
+	sys::fs::remove(fileName);
+}
+
+std::uint64_t PtsSetSpillFile::append(ArrayRef<std::uint32_t> words, std::string& error)
+{
+	std::uint64_t pageWords = sys::Process::getPageSizeEstimate() / sizeof(std::uint32_t);
+	std::uint64_t start = alignTo(fileWords, pageWords);
+	{
+		raw_fd_ostream os(fd, false);
+		os.seek(fileWords * sizeof(std::uint32_t));
+		os.write_zeros((start - fileWords) * sizeof(std::uint32_t));
+		os.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(std::uint32_t));
+		os.flush();
+		if (os.has_error())
+		{
+			error = "cannot write " + fileName + ": " + os.error().message();
+			os.clear_error();
+			return ~std::uint64_t(0);
+		}
+	}
+
+	// The mapping covers the whole file, so it is made again each time the file grows. The sets read from the old one have been copied out already
+	std::error_code ec;
+	std::unique_ptr<sys::fs::mapped_file_region> grown(new sys::fs::mapped_file_region(sys::fs::convertFDToNativeFile(fd), sys::fs::mapped_file_region::readonly, (start + words.size()) * sizeof(std::uint32_t), 0, ec));
+	if (ec)
+	{
+		error = "cannot map " + fileName + ": " + ec.message();
+		return ~std::uint64_t(0);
+	}
+	region = std::move(grown);
+	fileWords = start + words.size();
+	return start;
+}
+
+bool PtsSetSpillFile::compact(std::string& error)
+{
+	std::vector<NodeIndex> nodes;
+	nodes.reserve(extents.size());
+	for (auto const& mapping: extents)
+		nodes.push_back(mapping.first);
+	std::sort(nodes.begin(), nodes.end());
+
+	std::vector<std::uint32_t> words;
+	words.reserve(liveWords);
+	DenseMap<NodeIndex, std::pair<std::uint64_t, std::uint32_t>> newExtents;
+	for (auto node: nodes)
+	{
+		auto extent = extents.lookup(node);
+		newExtents[node] = std::make_pair(std::uint64_t(words.size()), extent.second);
+		const std::uint32_t* first = getWords(extent.first);
+		words.insert(words.end(), first, first + extent.second);
+	}
+
+	// The new file is written in full before the old one goes, so a failure leaves the sets where they are
+	std::unique_ptr<PtsSetSpillFile> fresh = create(sys::path::parent_path(fileName), error);
+	if (!fresh || (!words.empty() && fresh->append(words, error) == ~std::uint64_t(0)))
+		return false;
+	std::swap(fileName, fresh->fileName);
+	std::swap(fd, fresh->fd);
+	std::swap(region, fresh->region);
+	std::swap(fileWords, fresh->fileWords);
+	extents = std::move(newExtents);
+	deadWords = 0;
+	// fresh now has the old file, and removes it
+	return true;
+}
+
+bool PtsSetSpillFile::spill(AndersPtsGraph& graph, ArrayRef<NodeIndex> nodes, std::string& error)
+{
+	if (deadWords > liveWords && !compact(error))
+		return false;
+
+	std::vector<std::uint32_t> words;
+	// (node, offset in words) for each set that isn't empty, which is all that is worth spilling
+	std::vector<std::pair<NodeIndex, std::uint64_t>> written;
+	for (auto node: nodes)
+	{
+		assert(!graph.isSpilled(node) && (written.empty() || written.back().first < node));
+		const AndersPtsSet& ptsSet = graph.sets[node];
+		if (ptsSet.isEmpty())
+			continue;
+		written.push_back(std::make_pair(node, std::uint64_t(words.size())));
+		for (auto obj: ptsSet)
+			words.push_back(obj);
+		if (ptsSet.hasNullObject())
+			words.push_back(NodeIndex(AndersNodeFactory::NullObjectIndex));
+	}
+	if (words.empty())
+		return true;
+	std::uint64_t start = append(words, error);
+	if (start == ~std::uint64_t(0))
+		return false;
+
+	graph.spillFile = this;
+	graph.spilled.resize(graph.sets.size());
+	for (unsigned i = 0, e = written.size(); i < e; ++i)
+	{
+		NodeIndex node = written[i].first;
+		std::uint64_t end = i + 1 < e ? written[i + 1].second : words.size();
+		extents[node] = std::make_pair(start + written[i].second, std::uint32_t(end - written[i].second));
+		graph.sets[node].clear();
+		graph.spilled.set(node);
+	}
+	liveWords += words.size();
+	return true;
+}
+
+void PtsSetSpillFile::readBack(NodeIndex node, AndersPtsSet& ptsSet)
+{
+	auto itr = extents.find(node);
+	assert(itr != extents.end());
+	const std::uint32_t* words = getWords(itr->second.first);
+	for (std::uint32_t i = 0, e = itr->second.second; i < e; ++i)
+	{
+		if (words[i] == AndersNodeFactory::NullObjectIndex)
+			ptsSet.insertNullObject();
+		else
+			ptsSet.insert(words[i]);
+	}
+	liveWords -= itr->second.second;
+	deadWords += itr->second.second;
+	extents.erase(itr);
+}
+
+void PtsSetSpillFile::drop(NodeIndex node)
+{
+	auto itr = extents.find(node);
+	assert(itr != extents.end());
+	liveWords -= itr->second.second;
+	deadWords += itr->second.second;
+	extents.erase(itr);
+}
+
+void PtsSetSpillFile::readBackAll(AndersPtsGraph& graph)
+{
+	if (graph.spillFile != this)
+		return;
+	// In NodeIndex order, which reads each block of the file front to back
+	for (int n = graph.spilled.find_first(); n != -1; n = graph.spilled.find_next(n))
+		readBack(n, graph.sets[n]);
+	graph.spilled.clear();
+	graph.spillFile = nullptr;
+}
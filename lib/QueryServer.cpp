@@ -0,0 +1,147 @@
+#include "QueryServer.h"
+
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/ValueSymbolTable.h"
+
+using namespace llvm;
+using namespace QueryProtocol;
+
+unsigned AndersQueryServer::addModule(std::unique_ptr<Module> m, std::unique_ptr<PersistedAndersResults> results)
+{
+	modules.push_back(ServedModule{std::move(m), std::move(results)});
+	return modules.size() - 1;
+}
+
+std::uint32_t AndersQueryServer::lookUp(const ServedModule& served, StringRef name) const
+{
+	const Value* v = nullptr;
+	if (name.startswith("@"))
+		v = served.module->getNamedValue(name.drop_front());
+	else
+	{
+		// The names of the C++ functions have no colon, but those of the Objective-C methods do
+		auto parts = name.rsplit(':');
+		const Function* f = served.module->getFunction(parts.first);
+		if (f != nullptr && !parts.second.empty() && f->getValueSymbolTable() != nullptr)
+			v = f->getValueSymbolTable()->lookup(parts.second);
+	}
+	return v != nullptr ? served.results->getValueId(v) : NoEntry;
+}
+
+void AndersQueryServer::handleRequest(ArrayRef<std::uint32_t> request, std::vector<std::uint32_t>& reply) const
+{
+	reply.assign(1, Ok);
+	if (request.size() < 3)
+	{
+		reply[0] = BadRequest;
+		return;
+	}
+	std::uint32_t opcode = request[0], moduleIndex = request[1], count = request[2];
+	ArrayRef<std::uint32_t> operands = request.drop_front(3);
+	if (moduleIndex >= modules.size())
+	{
+		reply[0] = NoSuchModule;
+		return;
+	}
+	const ServedModule& served = modules[moduleIndex];
+	const PersistedAndersResults& results = *served.results;
+
+	auto getValue = [&results] (std::uint32_t id) -> const Value*
+	{
+		return id < results.getNumValues() ? results.getValue(id) : nullptr;
+	};
+	auto addValues = [&results, &reply] (const auto& vals)
+	{
+		reply.push_back(vals.size());
+		for (auto v: vals)
+			reply.push_back(results.getValueId(v));
+	};
+	auto badRequest = [&reply] { reply.assign(1, BadRequest); };
+
+	std::vector<const Value*> vals;
+	switch (opcode)
+	{
+		case PointsTo:
+		case PointedBy:
+			if (operands.size() != count)
+				return badRequest();
+			for (auto id: operands)
+			{
+				const Value* v = getValue(id);
+				bool known = v != nullptr && (opcode == PointsTo ? results.getPointsToSet(v, vals) : results.getPointedBySet(v, vals));
+				if (known)
+					addValues(vals);
+				else
+					reply.push_back(NoEntry);
+			}
+			break;
+		case Alias:
+			if (operands.size() != 2 * std::uint64_t(count))
+				return badRequest();
+			for (unsigned i = 0; i < count; ++i)
+			{
+				const Value* v1 = getValue(operands[2 * i]);
+				const Value* v2 = getValue(operands[2 * i + 1]);
+				if (v1 == nullptr || v2 == nullptr)
+				{
+					reply.push_back(MayAliasCode);
+					continue;
+				}
+				switch (results.alias(v1->stripPointerCasts(), v2->stripPointerCasts()))
+				{
+					case NoAlias:
+						reply.push_back(NoAliasCode);
+						break;
+					case MustAlias:
+						reply.push_back(MustAliasCode);
+						break;
+					case PartialAlias:
+						reply.push_back(PartialAliasCode);
+						break;
+					default:
+						reply.push_back(MayAliasCode);
+						break;
+				}
+			}
+			break;
+		case CallTargets:
+		{
+			if (operands.size() != count)
+				return badRequest();
+			std::vector<const Function*> callees;
+			for (auto id: operands)
+			{
+				const Instruction* inst = dyn_cast_or_null<Instruction>(getValue(id));
+				if (inst == nullptr || !ImmutableCallSite(inst))
+					reply.push_back(NoEntry);
+				else if (const Function* f = ImmutableCallSite(inst).getCalledFunction())
+					addValues(ArrayRef<const Function*>(f));
+				else if (results.getResolvedCallees(inst, callees))
+					addValues(callees);
+				else
+					reply.push_back(NoEntry);
+			}
+			break;
+		}
+		case LookUp:
+		{
+			std::uint64_t pos = 0;
+			for (unsigned i = 0; i < count; ++i)
+			{
+				if (pos >= operands.size())
+					return badRequest();
+				std::uint32_t numBytes = operands[pos++];
+				std::uint64_t numWords = (std::uint64_t(numBytes) + 3) / 4;
+				if (numWords > operands.size() - pos)
+					return badRequest();
+				reply.push_back(lookUp(served, StringRef(reinterpret_cast<const char*>(operands.data() + pos), numBytes)));
+				pos += numWords;
+			}
+			if (pos != operands.size())
+				return badRequest();
+			break;
+		}
+		default:
+			return badRequest();
+	}
+}
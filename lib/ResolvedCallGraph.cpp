@@ -0,0 +1,110 @@
+#include "Andersen.h"
+
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/Module.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+// Resolve every indirect call of m from the solved set of its callee pointer. The calls that share a callee set and pass as many arguments share their callees, so each set is only walked once per arity
+void Andersen::buildResolvedCallGraph(const Module& m) const
+{
+	typedef ResolvedCallGraph::ResolvedCall ResolvedCall;
+	std::unique_ptr<ResolvedCallGraph> graph(new ResolvedCallGraph);
+	DenseMap<std::pair<unsigned, unsigned>, std::pair<unsigned, unsigned>> rangeOfSet;
+
+	auto resolveSet = [this, &graph] (unsigned setId, unsigned numArgs) -> std::pair<unsigned, unsigned>
+	{
+		const CompactPtsSet& set = solvedPtsGraph.getSet(setId);
+		if (set.has(nodeFactory.getUniversalObjNode()))
+			return std::make_pair(unsigned(ResolvedCallGraph::UnknownTargets), 0u);
+
+		unsigned begin = graph->callees.size();
+		auto addCallee = [this, &graph, numArgs] (NodeIndex obj)
+		{
+			// Only the object node of a function stands for the function
+			const Function* f = dyn_cast_or_null<Function>(nodeFactory.getValueForNode(obj));
+			if (f == nullptr || nodeFactory.getObjectNodeFor(f) != obj || f->isIntrinsic())
+				return;
+			if (!f->getFunctionType()->isVarArg() && f->arg_size() != numArgs)
+				return;
+			graph->callees.push_back(f);
+		};
+		AndersPtsSetView view(nodeFactory, locationClasses, set);
+		for (auto obj: view.getNodes())
+		{
+			addCallee(obj);
+			auto itr = locationClasses.find(obj);
+			if (itr != locationClasses.end())
+				std::for_each(itr->second.begin(), itr->second.end(), addCallee);
+		}
+		return std::make_pair(begin, unsigned(graph->callees.size()));
+	};
+
+	for (auto const& f: m)
+	{
+		for (auto const& bb: f)
+		{
+			for (auto const& inst: bb)
+			{
+				ImmutableCallSite cs(&inst);
+				if (!cs || cs.getCalledFunction() != nullptr || isa<InlineAsm>(cs.getCalledValue()))
+					continue;
+				NodeIndex callee = nodeFactory.getValueNodeFor(cs.getCalledValue());
+				if (callee == AndersNodeFactory::InvalidIndex)
+					continue;
+
+				unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(callee));
+				std::pair<unsigned, unsigned> range(0, 0);
+				if (setId != CompactPtsGraph::NoSlot)
+				{
+					auto key = std::make_pair(setId, unsigned(cs.arg_size()));
+					auto itr = rangeOfSet.find(key);
+					if (itr == rangeOfSet.end())
+						itr = rangeOfSet.insert(std::make_pair(key, resolveSet(setId, cs.arg_size()))).first;
+					range = itr->second;
+				}
+				graph->callIndex[&inst] = graph->calls.size();
+				graph->calls.push_back(ResolvedCall{&inst, range.first, range.second});
+			}
+		}
+	}
+
+	resolvedCallGraph = std::move(graph);
+}
+
+bool Andersen::getResolvedCallees(const Instruction* callInst, ArrayRef<const Function*>& callees) const
+{
+	waitForSolution();
+	std::call_once(*resolvedCallGraphFlag, [this, callInst] { buildResolvedCallGraph(*callInst->getModule()); });
+
+	auto itr = resolvedCallGraph->callIndex.find(callInst);
+	if (itr == resolvedCallGraph->callIndex.end())
+		return false;
+	auto const& call = resolvedCallGraph->calls[itr->second];
+	if (call.begin == ResolvedCallGraph::UnknownTargets)
+		return false;
+	callees = makeArrayRef(resolvedCallGraph->callees).slice(call.begin, call.end - call.begin);
+	return true;
+}
+
+void Andersen::exportCallGraph(CallGraph& cg) const
+{
+	waitForSolution();
+	std::call_once(*resolvedCallGraphFlag, [this, &cg] { buildResolvedCallGraph(cg.getModule()); });
+
+	for (auto const& call: resolvedCallGraph->calls)
+	{
+		if (call.begin == ResolvedCallGraph::UnknownTargets)
+			continue;
+		// The call graph edits the calls of its nodes, so it takes them as non-const
+		CallSite cs(const_cast<Instruction*>(call.inst));
+		CallGraphNode* caller = cg[call.inst->getParent()->getParent()];
+		caller->removeCallEdgeFor(cs);
+		for (unsigned i = call.begin; i < call.end; ++i)
+			caller->addCalledFunction(cs, cg.getOrInsertFunction(resolvedCallGraph->callees[i]));
+	}
+}
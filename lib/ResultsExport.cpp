@@ -0,0 +1,161 @@
+#include "Andersen.h"
+#include "PersistedResults.h"
+#include "ResultsExport.h"
+#include "WordFile.h"
+
+#include <algorithm>
+
+using namespace llvm;
+using namespace ExportedResultsFormat;
+
+void Andersen::exportResults(const Module& m, AndersResultsSink& sink) const
+{
+	waitForSolution();
+	std::vector<const Value*> values;
+	PersistedResultsFormat::enumerateValues(m, values);
+	DenseMap<const Value*, unsigned> valueIds;
+	valueIds.reserve(values.size());
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+		valueIds[values[i]] = i;
+
+	unsigned numSets = solvedPtsGraph.getNumSets();
+	sink.begin(values.size(), numSets);
+	std::vector<std::uint32_t> objs;
+	for (unsigned id = 0; id < numSets; ++id)
+	{
+		AndersPtsSetView view(nodeFactory, locationClasses, solvedPtsGraph.getSet(id));
+		objs.clear();
+		for (auto val: view)
+		{
+			// The values of the bodies createLazily() freed are no longer in m
+			auto itr = valueIds.find(val);
+			if (itr != valueIds.end())
+				objs.push_back(itr->second);
+		}
+		std::sort(objs.begin(), objs.end());
+		sink.writeSet(id, view.hasUniversalObject(), view.hasNullObject(), objs);
+	}
+
+	for (unsigned i = 0, e = values.size(); i < e; ++i)
+	{
+		NodeIndex ptr = nodeFactory.getValueNodeFor(values[i]);
+		if (ptr == AndersNodeFactory::InvalidIndex || ptr == nodeFactory.getUniversalPtrNode())
+			continue;
+		unsigned setId = solvedPtsGraph.getSetId(nodeFactory.getMergeTarget(ptr));
+		sink.writeValue(i, values[i], setId == CompactPtsGraph::NoSlot ? AndersResultsSink::EmptySet : setId);
+	}
+	sink.end();
+}
+
+void AndersBinaryResultsWriter::flush()
+{
+	WordFile::writeArray<std::uint32_t>(os, buffer);
+	buffer.clear();
+}
+
+void AndersBinaryResultsWriter::begin(unsigned numValues, unsigned numSets)
+{
+	// The words of the Header, in order
+	push(Magic);
+	push(Version);
+	push(numValues);
+	push(numSets);
+}
+
+void AndersBinaryResultsWriter::writeSet(unsigned setId, bool universal, bool nullObject, ArrayRef<std::uint32_t> objs)
+{
+	push((universal ? UniversalFlag : 0) | (nullObject ? NullObjectFlag : 0));
+	push(objs.size());
+	for (auto obj: objs)
+		push(obj);
+}
+
+void AndersBinaryResultsWriter::writeValue(unsigned valueId, const Value* v, unsigned setId)
+{
+	push(valueId);
+	push(setId);
+}
+
+void AndersTextResultsWriter::flush()
+{
+	os.write(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+void AndersTextResultsWriter::writeSet(unsigned setId, bool universal, bool nullObject, ArrayRef<std::uint32_t> objs)
+{
+	bufferOs << "set " << setId << ":";
+	if (universal)
+		bufferOs << " universal";
+	if (nullObject)
+		bufferOs << " null";
+	for (auto obj: objs)
+		bufferOs << " " << obj;
+	bufferOs << "\n";
+	flushIfFull();
+}
+
+void AndersTextResultsWriter::writeValue(unsigned valueId, const Value* v, unsigned setId)
+{
+	bufferOs << "value " << valueId;
+	if (v != nullptr && v->hasName())
+		bufferOs << " " << v->getName();
+	bufferOs << ": ";
+	if (setId == EmptySet)
+		bufferOs << "empty";
+	else
+		bufferOs << setId;
+	bufferOs << "\n";
+	flushIfFull();
+}
+
+bool readExportedResults(std::unique_ptr<MemoryBuffer> buffer, AndersResultsSink& sink, std::string& error)
+{
+	const Header* header = WordFile::readHeader<Header>(buffer, Magic, Version, "results export", error);
+	if (header == nullptr)
+		return false;
+	if (buffer->getBufferSize() % sizeof(std::uint32_t) != 0)
+	{
+		error = "the size of the file is not a whole number of words";
+		return false;
+	}
+	const std::uint32_t* words = reinterpret_cast<const std::uint32_t*>(header + 1);
+	const std::uint32_t* wordsEnd = reinterpret_cast<const std::uint32_t*>(buffer->getBufferEnd());
+
+	sink.begin(header->numValues, header->numSets);
+	for (unsigned id = 0; id < header->numSets; ++id)
+	{
+		if (wordsEnd - words < 2 || std::uint64_t(wordsEnd - words - 2) < words[1])
+		{
+			error = "set " + std::to_string(id) + " is truncated";
+			return false;
+		}
+		std::uint32_t flags = words[0], count = words[1];
+		ArrayRef<std::uint32_t> objs(words + 2, count);
+		words += 2 + count;
+		if (std::any_of(objs.begin(), objs.end(), [header] (std::uint32_t obj) { return obj >= header->numValues; }))
+		{
+			error = "set " + std::to_string(id) + " has a value that doesn't exist";
+			return false;
+		}
+		sink.writeSet(id, (flags & UniversalFlag) != 0, (flags & NullObjectFlag) != 0, objs);
+	}
+
+	if ((wordsEnd - words) % 2 != 0)
+	{
+		error = "the last value is truncated";
+		return false;
+	}
+	for (; words != wordsEnd; words += 2)
+	{
+		std::uint32_t valueId = words[0], setId = words[1];
+		if (valueId >= header->numValues || (setId >= header->numSets && setId != AndersResultsSink::EmptySet))
+		{
+			error = "value " + std::to_string(valueId) + " is out of range or has a set that doesn't exist";
+			return false;
+		}
+		sink.writeValue(valueId, nullptr, setId);
+	}
+	sink.end();
+	return true;
+}
@@ -0,0 +1,248 @@
+#include "SolverCheckpoint.h"
+#include "WordFile.h"
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstring>
+
+using namespace llvm;
+using namespace SolverCheckpointFormat;
+
+std::uint64_t SolverCheckpoint::hashConstraints(unsigned numNodes, ArrayRef<AndersConstraint> constraints, ArrayRef<AndersFieldConstraint> fieldConstraints)
+{
+	std::uint64_t hash = WordFile::HashSeed;
+	WordFile::hashBytes(hash, &numNodes, sizeof(numNodes));
+	for (auto const& c: constraints)
+	{
+		std::uint64_t key = c.getPackedKey();
+		WordFile::hashBytes(hash, &key, sizeof(key));
+	}
+	for (auto const& c: fieldConstraints)
+	{
+		std::uint32_t words[] = { c.dest, c.src, c.offset };
+		WordFile::hashBytes(hash, words, sizeof(words));
+	}
+	return hash;
+}
+
+bool SolverCheckpoint::write(StringRef fileName, std::uint64_t constraintHash, const AndersNodeFactory& nodeFactory, const AndersPtsGraph& ptsGraph, const ConstraintGraph& constraintGraph, ArrayRef<NodeIndex> collapseTargets, ArrayRef<NodeIndex> workList, std::string& error)
+{
+	unsigned numNodes = nodeFactory.getNumNodes();
+	std::vector<std::uint32_t> mergeTarget(numNodes);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		mergeTarget[n] = nodeFactory.getMergeTarget(n);
+
+	std::vector<std::uint32_t> setNodes, setOffsets, elems;
+	for (auto node: ptsGraph)
+	{
+		setNodes.push_back(node);
+		setOffsets.push_back(elems.size());
+		const AndersPtsSet& set = *ptsGraph.find(node);
+		for (auto obj: set)
+			elems.push_back(obj);
+		if (set.hasNullObject())
+			elems.push_back(nodeFactory.getNullObjectNode());
+	}
+	setOffsets.push_back(elems.size());
+
+	std::vector<std::uint32_t> copyEdges, loadEdges, storeEdges, fieldEdges;
+	for (auto const& mapping: constraintGraph)
+	{
+		NodeIndex src = mapping.first;
+		const ConstraintGraphNode& node = mapping.second;
+		for (auto dst: node)
+			copyEdges.insert(copyEdges.end(), { src, dst });
+		for (auto dst: node.loads())
+			loadEdges.insert(loadEdges.end(), { src, dst });
+		for (auto dst: node.stores())
+			storeEdges.insert(storeEdges.end(), { src, dst });
+		for (auto const& edge: node.fields())
+			fieldEdges.insert(fieldEdges.end(), { src, edge.first, edge.second });
+	}
+
+	Header header;
+	std::memset(&header, 0, sizeof(header));
+	header.constraintHash = constraintHash;
+	header.magic = Magic;
+	header.version = Version;
+	header.numNodes = numNodes;
+	header.numCollapseTargets = collapseTargets.size();
+	header.numSets = setNodes.size();
+	header.numElems = elems.size();
+	header.numCopyEdges = copyEdges.size() / 2;
+	header.numLoadEdges = loadEdges.size() / 2;
+	header.numStoreEdges = storeEdges.size() / 2;
+	header.numFieldEdges = fieldEdges.size() / 3;
+	header.numWorkListNodes = workList.size();
+
+	std::string tempName = (fileName + ".tmp").str();
+	{
+		std::error_code ec;
+		raw_fd_ostream os(tempName, ec, sys::fs::F_None);
+		if (ec)
+		{
+			error = "cannot write " + tempName + ": " + ec.message();
+			return false;
+		}
+		os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		WordFile::writeArray<std::uint32_t>(os, mergeTarget);
+		WordFile::writeArray(os, collapseTargets);
+		WordFile::writeArray<std::uint32_t>(os, setNodes);
+		WordFile::writeArray<std::uint32_t>(os, setOffsets);
+		WordFile::writeArray<std::uint32_t>(os, elems);
+		WordFile::writeArray<std::uint32_t>(os, copyEdges);
+		WordFile::writeArray<std::uint32_t>(os, loadEdges);
+		WordFile::writeArray<std::uint32_t>(os, storeEdges);
+		WordFile::writeArray<std::uint32_t>(os, fieldEdges);
+		WordFile::writeArray(os, workList);
+		os.close();
+		if (os.has_error())
+		{
+			os.clear_error();
+			error = "cannot write " + tempName;
+			return false;
+		}
+	}
+	if (std::error_code ec = sys::fs::rename(tempName, fileName))
+	{
+		error = "cannot rename " + tempName + " to " + fileName.str() + ": " + ec.message();
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<SolverCheckpoint> SolverCheckpoint::load(StringRef fileName, std::uint64_t constraintHash, unsigned numNodes, std::string& error)
+{
+	auto fileOrErr = MemoryBuffer::getFile(fileName, -1, false);
+	if (!fileOrErr)
+	{
+		error = "cannot read " + fileName.str() + ": " + fileOrErr.getError().message();
+		return nullptr;
+	}
+	return load(std::move(*fileOrErr), constraintHash, numNodes, error);
+}
+
+std::unique_ptr<SolverCheckpoint> SolverCheckpoint::load(std::unique_ptr<MemoryBuffer> buffer, std::uint64_t constraintHash, unsigned numNodes, std::string& error)
+{
+	const Header* header = WordFile::readHeader<Header>(buffer, Magic, Version, "solver checkpoint", error);
+	if (header == nullptr)
+		return nullptr;
+	if (header->numNodes != numNodes || header->constraintHash != constraintHash)
+	{
+		error = "the checkpoint was written for other constraints";
+		return nullptr;
+	}
+
+	std::uint64_t numWords = std::uint64_t(header->numNodes) + header->numCollapseTargets + 2 * std::uint64_t(header->numSets) + 1 + header->numElems + 2 * (std::uint64_t(header->numCopyEdges) + header->numLoadEdges + header->numStoreEdges) + 3 * std::uint64_t(header->numFieldEdges) + header->numWorkListNodes;
+	if (buffer->getBufferSize() != sizeof(Header) + numWords * sizeof(std::uint32_t))
+	{
+		error = "the size of the file doesn't match its header";
+		return nullptr;
+	}
+
+	const std::uint32_t* words = reinterpret_cast<const std::uint32_t*>(header + 1);
+	auto take = [&words](std::uint64_t count)
+	{
+		const std::uint32_t* ret = words;
+		words += count;
+		return ret;
+	};
+	std::unique_ptr<SolverCheckpoint> ret(new SolverCheckpoint);
+	ret->header = header;
+	ret->mergeTarget = take(header->numNodes);
+	ret->collapseTargets = take(header->numCollapseTargets);
+	ret->setNodes = take(header->numSets);
+	ret->setOffsets = take(header->numSets + 1);
+	ret->elems = take(header->numElems);
+	ret->copyEdges = take(2 * std::uint64_t(header->numCopyEdges));
+	ret->loadEdges = take(2 * std::uint64_t(header->numLoadEdges));
+	ret->storeEdges = take(2 * std::uint64_t(header->numStoreEdges));
+	ret->fieldEdges = take(3 * std::uint64_t(header->numFieldEdges));
+	ret->workList = take(header->numWorkListNodes);
+	ret->buffer = std::move(buffer);
+	if (!ret->isValid(error))
+		return nullptr;
+	return ret;
+}
+
+// The solver trusts the node indices it is given, so a damaged file must not get that far
+bool SolverCheckpoint::isValid(std::string& error) const
+{
+	unsigned numNodes = header->numNodes;
+	auto inRange = [numNodes] (const std::uint32_t* nodes, std::uint64_t count, unsigned stride)
+	{
+		for (std::uint64_t i = 0; i < count; i += stride)
+			if (nodes[i] >= numNodes || (stride > 1 && nodes[i + 1] >= numNodes))
+				return false;
+		return true;
+	};
+
+	// Every representative must be its own, which rules out the cycles getMergeTarget() would loop on
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (mergeTarget[n] >= numNodes || mergeTarget[mergeTarget[n]] != mergeTarget[n])
+		{
+			error = "bad merge target of node " + std::to_string(n);
+			return false;
+		}
+	}
+	if (header->numCollapseTargets != 0 && header->numCollapseTargets != numNodes)
+	{
+		error = "bad number of collapse targets";
+		return false;
+	}
+	for (unsigned i = 0, e = header->numCollapseTargets; i < e; ++i)
+	{
+		if (collapseTargets[i] >= numNodes && collapseTargets[i] != AndersNodeFactory::InvalidIndex)
+		{
+			error = "bad collapse target of node " + std::to_string(i);
+			return false;
+		}
+	}
+	for (unsigned i = 0, e = header->numSets; i < e; ++i)
+	{
+		if (setOffsets[i] > setOffsets[i + 1])
+		{
+			error = "the sets are out of order";
+			return false;
+		}
+	}
+	if (setOffsets[0] != 0 || setOffsets[header->numSets] != header->numElems)
+	{
+		error = "the sets don't cover the elements";
+		return false;
+	}
+	if (!inRange(setNodes, header->numSets, 1) || !inRange(elems, header->numElems, 1) || !inRange(copyEdges, 2 * std::uint64_t(header->numCopyEdges), 2) || !inRange(loadEdges, 2 * std::uint64_t(header->numLoadEdges), 2) || !inRange(storeEdges, 2 * std::uint64_t(header->numStoreEdges), 2) || !inRange(fieldEdges, 3 * std::uint64_t(header->numFieldEdges), 3) || !inRange(workList, header->numWorkListNodes, 1))
+	{
+		error = "a node is out of range";
+		return false;
+	}
+	return true;
+}
+
+void SolverCheckpoint::restore(AndersNodeFactory& nodeFactory, AndersPtsGraph& ptsGraph, ConstraintGraph& constraintGraph) const
+{
+	nodeFactory.restoreMergeTargets(mergeTarget);
+
+	for (unsigned i = 0, e = header->numSets; i < e; ++i)
+	{
+		AndersPtsSet& set = ptsGraph[setNodes[i]];
+		for (unsigned j = setOffsets[i], je = setOffsets[i + 1]; j < je; ++j)
+		{
+			if (elems[j] == AndersNodeFactory::NullObjectIndex)
+				set.insertNullObject();
+			else
+				set.insert(elems[j]);
+		}
+	}
+
+	for (unsigned i = 0, e = header->numCopyEdges; i < e; ++i)
+		constraintGraph.insertCopyEdge(copyEdges[2 * i], copyEdges[2 * i + 1]);
+	for (unsigned i = 0, e = header->numLoadEdges; i < e; ++i)
+		constraintGraph.insertLoadEdge(loadEdges[2 * i], loadEdges[2 * i + 1]);
+	for (unsigned i = 0, e = header->numStoreEdges; i < e; ++i)
+		constraintGraph.insertStoreEdge(storeEdges[2 * i], storeEdges[2 * i + 1]);
+	for (unsigned i = 0, e = header->numFieldEdges; i < e; ++i)
+		constraintGraph.insertFieldEdge(fieldEdges[3 * i], fieldEdges[3 * i + 1], fieldEdges[3 * i + 2]);
+}
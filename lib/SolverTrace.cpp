@@ -0,0 +1,80 @@
+#include "SolverTrace.h"
+
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+
+using namespace llvm;
+
+extern cl::opt<bool> EnablePerfCounters;
+
+SolverTrace::SolverTrace(StringRef fileName, const char* e): engine(e), start(std::chrono::steady_clock::now()), iteration(0)
+{
+	std::error_code ec;
+	os.reset(new raw_fd_ostream(fileName, ec, sys::fs::F_Text));
+	if (ec)
+		report_fatal_error(Twine("Cannot write the solver trace to ") + fileName + ": " + ec.message());
+	if (EnablePerfCounters)
+		counters.reset(new AndersPerfCounters());
+}
+
+void AndersSolverWork::addIteration(const SolverIterationStats& stats)
+{
+	++iterations;
+	workListPops += stats.workListPops;
+	copyEdges += stats.copyEdges;
+	unions += stats.unions;
+	changedUnions += stats.changedUnions;
+	cycleCollapses += stats.cycleCollapses;
+	merges += stats.hcdMerges + stats.equivMerges;
+}
+
+AndersSolverWork& AndersSolverWork::operator+=(const AndersSolverWork& other)
+{
+	iterations += other.iterations;
+	workListPops += other.workListPops;
+	copyEdges += other.copyEdges;
+	unions += other.unions;
+	changedUnions += other.changedUnions;
+	cycleCollapses += other.cycleCollapses;
+	merges += other.merges;
+	return *this;
+}
+
+void SolverTrace::endIteration(SolverIterationStats& stats, unsigned workListSize, unsigned nextWorkListSize, const AndersPtsGraph& ptsGraph)
+{
+	AndersPerfCounts counts;
+	if (counters)
+		counts = counters->read();
+	std::uint64_t ptsBits = 0;
+	for (auto node: ptsGraph)
+		ptsBits += ptsGraph.find(node)->getSize();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	*os << "{\"iteration\":" << iteration++
+		<< ",\"engine\":\"" << engine << "\""
+		<< ",\"worklist\":" << workListSize
+		<< ",\"next_worklist\":" << nextWorkListSize
+		<< ",\"worklist_pops\":" << stats.workListPops
+		<< ",\"copy_edges\":" << stats.copyEdges
+		<< ",\"unions\":" << stats.unions
+		<< ",\"changed_unions\":" << stats.changedUnions
+		<< ",\"lcd_candidates\":" << stats.lcdCandidates
+		<< ",\"cycle_collapses\":" << stats.cycleCollapses
+		<< ",\"hcd_merges\":" << stats.hcdMerges
+		<< ",\"equiv_merges\":" << stats.equivMerges
+		<< ",\"pts_bits\":" << ptsBits
+		<< ",\"elapsed\":" << format("%.6f", elapsed.count());
+	for (unsigned i = 0; i < NumPerfEvents; ++i)
+	{
+		AndersPerfEvent event = static_cast<AndersPerfEvent>(i);
+		if (counts.isAvailable(event))
+			*os << ",\"" << getPerfEventName(event) << "\":" << counts.get(event);
+	}
+	*os << "}\n";
+	stats = SolverIterationStats();
+	if (counters)
+		counters->restart();
+}
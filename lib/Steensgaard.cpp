@@ -0,0 +1,121 @@
+#include "Steensgaard.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+SteensgaardAnalysis::SteensgaardAnalysis(const std::vector<AndersConstraint>& constraints, const AndersNodeFactory& nodeFactory): numNodes(nodeFactory.getNumNodes()), parent(numNodes), pointee(numNodes, AndersNodeFactory::InvalidIndex)
+{
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		parent[n] = n;
+
+	// A node merged into another one before solving shares its contents, so whatever is loaded from one may have been stored into the other
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		if (rep != n)
+			unify(getOrCreatePointee(n), getOrCreatePointee(rep));
+	}
+
+	for (auto const& c: constraints)
+	{
+		NodeIndex src = nodeFactory.getMergeTarget(c.getSrc());
+		NodeIndex dst = nodeFactory.getMergeTarget(c.getDest());
+		switch (c.getType())
+		{
+			case AndersConstraint::ADDR_OF:
+				// As in buildConstraintGraph(), the object keeps its own index
+				unify(getOrCreatePointee(dst), c.getSrc());
+				break;
+			case AndersConstraint::COPY:
+				unify(getOrCreatePointee(dst), getOrCreatePointee(src));
+				break;
+			case AndersConstraint::LOAD:
+				unify(getOrCreatePointee(dst), getOrCreatePointee(getOrCreatePointee(src)));
+				break;
+			case AndersConstraint::STORE:
+				unify(getOrCreatePointee(getOrCreatePointee(dst)), getOrCreatePointee(src));
+				break;
+		}
+	}
+	std::vector<std::pair<NodeIndex, NodeIndex>>().swap(unifyStack);
+
+	// Link every class straight to its representative, so that the queries don't have to write anything
+	for (NodeIndex n = 0, e = parent.size(); n < e; ++n)
+		parent[n] = find(n);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		if (!nodeFactory.isObjectNode(n))
+			continue;
+		AndersPtsSet& objects = objectsOfClass[parent[n]];
+		if (n == AndersNodeFactory::NullObjectIndex)
+			objects.insertNullObject();
+		else
+			objects.insert(n);
+	}
+}
+
+NodeIndex SteensgaardAnalysis::find(NodeIndex n)
+{
+	while (parent[n] != n)
+	{
+		parent[n] = parent[parent[n]];
+		n = parent[n];
+	}
+	return n;
+}
+
+NodeIndex SteensgaardAnalysis::getOrCreatePointee(NodeIndex n)
+{
+	n = find(n);
+	if (pointee[n] == AndersNodeFactory::InvalidIndex)
+	{
+		NodeIndex newClass = parent.size();
+		parent.push_back(newClass);
+		pointee.push_back(AndersNodeFactory::InvalidIndex);
+		pointee[n] = newClass;
+	}
+	return pointee[n];
+}
+
+void SteensgaardAnalysis::unify(NodeIndex a, NodeIndex b)
+{
+	// The chains of pointee classes can be long, so they are followed with a stack rather than by recursion
+	unifyStack.push_back(std::make_pair(a, b));
+	while (!unifyStack.empty())
+	{
+		a = find(unifyStack.back().first);
+		b = find(unifyStack.back().second);
+		unifyStack.pop_back();
+		if (a == b)
+			continue;
+
+		// The smaller index wins, which keeps the node classes ahead of the made-up ones
+		if (b < a)
+			std::swap(a, b);
+		parent[b] = a;
+		if (pointee[b] == AndersNodeFactory::InvalidIndex)
+			continue;
+		if (pointee[a] == AndersNodeFactory::InvalidIndex)
+			pointee[a] = pointee[b];
+		else
+			unifyStack.push_back(std::make_pair(pointee[a], pointee[b]));
+	}
+}
+
+const AndersPtsSet* SteensgaardAnalysis::getPointsToSet(NodeIndex n) const
+{
+	if (n >= numNodes || pointee[parent[n]] == AndersNodeFactory::InvalidIndex)
+		return nullptr;
+	auto itr = objectsOfClass.find(parent[pointee[parent[n]]]);
+	return itr != objectsOfClass.end() ? &itr->second : nullptr;
+}
+
+unsigned SteensgaardAnalysis::getNumClasses() const
+{
+	unsigned numClasses = 0;
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		if (parent[n] == n)
+			++numClasses;
+	return numClasses;
+}
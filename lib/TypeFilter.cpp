@@ -0,0 +1,165 @@
+#include "TypeFilter.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/GlobalVariable.h"
+
+using namespace llvm;
+
+namespace {
+
+// All pointer types stand for one another
+Type* normalizeType(Type* t)
+{
+	if (t->isPointerTy())
+		return Type::getInt8PtrTy(t->getContext());
+	return t;
+}
+
+// Put into types the (normalized) types t is made of: t itself, and the fields and the elements of its aggregates, recursively. Return false if t has a byte array in it, which may hold anything (e.g. a union, which is lowered to its largest member)
+bool collectContainedTypes(Type* t, SmallPtrSetImpl<Type*>& types)
+{
+	t = normalizeType(t);
+	if (!types.insert(t).second)
+		return true;
+	if (auto st = dyn_cast<StructType>(t))
+	{
+		for (auto elem: st->elements())
+			if (!collectContainedTypes(elem, types))
+				return false;
+	}
+	else if (isa<ArrayType>(t) || isa<VectorType>(t))
+	{
+		Type* elemType = isa<ArrayType>(t) ? cast<ArrayType>(t)->getElementType() : cast<VectorType>(t)->getElementType();
+		if (elemType->isIntegerTy(8))
+			return false;
+		return collectContainedTypes(elemType, types);
+	}
+	return true;
+}
+
+// The type the points-to set of the value node n is filtered by, or nullptr if it is not filtered
+Type* getPointeeType(const AndersNodeFactory& nodeFactory, NodeIndex n)
+{
+	const Value* val = nodeFactory.getValueForNode(n);
+	if (val == nullptr)
+		return nullptr;
+
+	Type* ptrType = val->getType();
+	if (auto f = dyn_cast<Function>(val))
+	{
+		// The value node of a function is its address. Its return node stands for the values it returns
+		if (nodeFactory.getReturnNodeFor(f) != n)
+			return nullptr;
+		ptrType = f->getReturnType();
+	}
+	if (!ptrType->isPointerTy())
+		return nullptr;
+
+	Type* pointee = ptrType->getPointerElementType();
+	SmallPtrSet<Type*, 8> pointeeTypes;
+	if (pointee->isIntegerTy(8) || pointee->isFunctionTy() || !pointee->isSized() || !collectContainedTypes(pointee, pointeeTypes))
+		return nullptr;
+	return normalizeType(pointee);
+}
+
+// The type of the memory object o, or nullptr if it has none
+Type* getObjectType(const AndersNodeFactory& nodeFactory, NodeIndex o)
+{
+	const Value* val = nodeFactory.getValueForNode(o);
+	if (auto allocaInst = dyn_cast_or_null<AllocaInst>(val))
+		return allocaInst->getAllocatedType();
+	if (auto globalVar = dyn_cast_or_null<GlobalVariable>(val))
+		return globalVar->getValueType();
+	// The heap, the functions and the varargs
+	return nullptr;
+}
+
+}	// end of anonymous namespace
+
+AndersTypeFilter::AndersTypeFilter(AndersNodeFactory& nodeFactory)
+{
+	unsigned numNodes = nodeFactory.getNumNodes();
+
+	// The class of each representative. The nodes merged offline share it if they agree on their class
+	DenseMap<Type*, unsigned> classOfType;
+	std::vector<Type*> classTypes;
+	std::vector<unsigned> classes(numNodes, AndersNodeFactory::NoTypeClass);
+	BitVector hasMember(numNodes), mergedInto(numNodes);
+	for (NodeIndex n = 0; n < numNodes; ++n)
+	{
+		NodeIndex rep = nodeFactory.getMergeTarget(n);
+		if (rep != n)
+			mergedInto.set(rep);
+
+		unsigned cls = AndersNodeFactory::NoTypeClass;
+		if (!nodeFactory.isObjectNode(n))
+		{
+			if (Type* pointee = getPointeeType(nodeFactory, n))
+			{
+				auto itr = classOfType.insert(std::make_pair(pointee, classTypes.size())).first;
+				if (itr->second == classTypes.size())
+					classTypes.push_back(pointee);
+				cls = itr->second;
+			}
+		}
+		if (!hasMember.test(rep))
+		{
+			hasMember.set(rep);
+			classes[rep] = cls;
+		}
+		else if (classes[rep] != cls)
+			classes[rep] = AndersNodeFactory::NoTypeClass;
+	}
+	for (NodeIndex n = 0; n < numNodes; ++n)
+		classes[n] = classes[nodeFactory.getMergeTarget(n)];
+
+	// Group the typed objects by type. An object that stands for others, or that has been merged into another, is the object of several allocation sites, and has no type of its own
+	DenseMap<Type*, AndersPtsSet> objsOfType;
+	for (NodeIndex o = 0; o < numNodes; ++o)
+	{
+		if (!nodeFactory.isObjectNode(o) || mergedInto.test(o) || nodeFactory.getMergeTarget(o) != o)
+			continue;
+		if (Type* objType = getObjectType(nodeFactory, o))
+			objsOfType[normalizeType(objType)].insert(o);
+	}
+	DenseMap<Type*, SmallPtrSet<Type*, 8>> containedTypes;
+	std::vector<Type*> untypedTypes;
+	for (auto& mapping: objsOfType)
+	{
+		if (!collectContainedTypes(mapping.first, containedTypes[mapping.first]))
+			untypedTypes.push_back(mapping.first);
+	}
+	for (auto t: untypedTypes)
+		objsOfType.erase(t);
+
+	excludedObjs.resize(classTypes.size());
+	for (unsigned cls = 0, e = classTypes.size(); cls < e; ++cls)
+	{
+		Type* pointee = classTypes[cls];
+		SmallPtrSet<Type*, 8> pointeeTypes;
+		collectContainedTypes(pointee, pointeeTypes);
+		for (auto& mapping: objsOfType)
+		{
+			if (!containedTypes[mapping.first].count(pointee) && !pointeeTypes.count(mapping.first))
+				excludedObjs[cls].unionWith(mapping.second);
+		}
+	}
+
+	nodeFactory.setTypeClasses(std::move(classes));
+}
+
+unsigned AndersTypeFilter::filter(const AndersNodeFactory& nodeFactory, NodeIndex n, AndersPtsSet& ptsSet) const
+{
+	unsigned cls = nodeFactory.getTypeClass(n);
+	if (cls == AndersNodeFactory::NoTypeClass || !ptsSet.intersectWith(excludedObjs[cls]))
+		return 0;
+
+	unsigned oldSize = ptsSet.getSize();
+	AndersPtsSet kept;
+	kept.assignDifference(ptsSet, excludedObjs[cls]);
+	ptsSet = std::move(kept);
+	return oldSize - ptsSet.getSize();
+}
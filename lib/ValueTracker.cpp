@@ -0,0 +1,174 @@
+#include "Andersen.h"
+
+#include "llvm/ADT/Statistic.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/Support/CommandLine.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+cl::opt<bool> EnableValueTracking("anders-track-values", cl::desc("Keep the solved results in step with the deletions and the replacements the later passes make to the IR, through value handles on the values the analysis knows, instead of letting them go stale"));
+
+#define DEBUG_TYPE "andersen"
+
+STATISTIC(NumTrackedDeletions, "Number of deleted values forgotten by -anders-track-values");
+STATISTIC(NumTrackedReplacements, "Number of value replacements followed by -anders-track-values");
+STATISTIC(NumTrackedClones, "Number of cloned values added by -anders-track-values");
+STATISTIC(NumUntrackedChanges, "Number of IR changes -anders-track-values could not follow");
+
+// The results are not solved again: the nodes and their sets stay what they were, and only which values stand for which nodes changes. Whatever a pass does to the IR, as long as it keeps its meaning, the set a pointer was given still holds everything the pointer may point to, so the deletions and the replacements are followed by moving the values around
+// The memory objects are the exception. An object that is replaced with another object the analysis knows would have to be merged into it in every set, so the results are given up on instead (see followsIRChanges())
+
+void Andersen::TrackedValueHandle::deleted()
+{
+	anders->forgetTrackedValue(getValPtr());
+	CallbackVH::deleted();
+	anders->valueTracker->freeHandles.push_back(this);
+}
+
+void Andersen::TrackedValueHandle::allUsesReplacedWith(Value* newVal)
+{
+	anders->replaceTrackedValue(getValPtr(), newVal);
+}
+
+void Andersen::startTrackingValues()
+{
+	valueTracker.reset(new ValueTracker);
+	// The functions with a return or a vararg node have a value node as well
+	for (auto itr = nodeFactory.value_node_begin(), ite = nodeFactory.value_node_end(); itr != ite; ++itr)
+		trackValue(itr->first);
+	for (auto itr = nodeFactory.obj_node_begin(), ite = nodeFactory.obj_node_end(); itr != ite; ++itr)
+		trackValue(itr->first);
+	for (auto const& mapping: indirectCallIndex)
+		trackValue(mapping.first);
+}
+
+void Andersen::trackValue(const Value* v)
+{
+	if (!valueTracker->tracked.insert(v).second)
+		return;
+	// The handles only read the values, but llvm::CallbackVH takes them as non-const
+	Value* val = const_cast<Value*>(v);
+	if (valueTracker->freeHandles.empty())
+		valueTracker->handles.emplace_back(val, this);
+	else
+	{
+		valueTracker->freeHandles.back()->reset(val);
+		valueTracker->freeHandles.pop_back();
+	}
+}
+
+void Andersen::forgetTrackedValue(const Value* v)
+{
+	if (nodeFactory.forgetValue(v))
+		++valueTracker->version;
+	if (const Instruction* inst = dyn_cast<Instruction>(v))
+		indirectCallIndex.erase(inst);
+	valueTracker->tracked.erase(v);
+	dropQueryIndices();
+	++NumTrackedDeletions;
+}
+
+void Andersen::replaceTrackedValue(const Value* oldVal, Value* newVal)
+{
+	bool wasObject = nodeFactory.getObjectNodeFor(oldVal) != AndersNodeFactory::InvalidIndex;
+	if (!nodeFactory.replaceValue(oldVal, newVal))
+	{
+		valueTracker->lostTrack = true;
+		++NumUntrackedChanges;
+		return;
+	}
+
+	// The call that replaces an indirect call keeps its targets
+	if (const Instruction* oldInst = dyn_cast<Instruction>(oldVal))
+	{
+		auto itr = indirectCallIndex.find(oldInst);
+		if (itr != indirectCallIndex.end())
+		{
+			if (const Instruction* newInst = dyn_cast<Instruction>(newVal))
+				indirectCallIndex.insert(std::make_pair(newInst, itr->second));
+			indirectCallIndex.erase(oldInst);
+		}
+	}
+
+	// The constants other than the globals are looked up by what they are made of, and never have nodes of their own
+	const Value* newObj = newVal->stripPointerCasts();
+	for (const Value* v: {static_cast<const Value*>(newVal), newObj})
+	{
+		if (!isa<Constant>(v) || isa<GlobalValue>(v))
+			trackValue(v);
+	}
+	if (wasObject)
+		++valueTracker->version;
+	dropQueryIndices();
+	++NumTrackedReplacements;
+}
+
+void Andersen::noteClonedValues(const ValueToValueMapTy& vmap)
+{
+	for (auto const& mapping: vmap)
+	{
+		if (const Value* clone = mapping.second)
+			noteClonedValue(mapping.first, clone);
+	}
+}
+
+void Andersen::noteClonedValue(const Value* orig, const Value* clone)
+{
+	auto isPlainConstant = [] (const Value* v)
+	{
+		return isa<Constant>(v) && !isa<GlobalValue>(v);
+	};
+	if (!valueTracker || orig == clone || isPlainConstant(orig) || isPlainConstant(clone))
+		return;
+
+	bool added = false;
+	// A clone points to what its original points to, but is a pointer of its own: the two need not hold the same address at the same time
+	NodeIndex n = nodeFactory.getValueNodeFor(orig);
+	if (n != AndersNodeFactory::InvalidIndex && nodeFactory.getValueNodeFor(clone) == AndersNodeFactory::InvalidIndex)
+	{
+		NodeIndex cloneNode = nodeFactory.createValueNode(clone);
+		solvedPtsGraph.shareSet(cloneNode, nodeFactory.getMergeTarget(n));
+		added = true;
+	}
+
+	// A cloned object is wherever its original is, which is what a location equivalence class says: the sets that have the key of the class have all its members
+	NodeIndex obj = nodeFactory.getObjectNodeFor(orig);
+	if (obj != AndersNodeFactory::InvalidIndex && nodeFactory.getObjectNodeFor(clone) == AndersNodeFactory::InvalidIndex)
+	{
+		NodeIndex key = nodeFactory.getMergeTarget(obj);
+		auto itr = locationClasses.find(key);
+		bool inClass = key != obj && itr != locationClasses.end() && std::find(itr->second.begin(), itr->second.end(), obj) != itr->second.end();
+		// An object merged away by the solver on a cycle, rather than by location equivalence, has no class to join
+		if (key != obj && !inClass)
+		{
+			valueTracker->lostTrack = true;
+			++NumUntrackedChanges;
+		}
+		else
+		{
+			NodeIndex cloneObj = nodeFactory.createObjectNode(clone);
+			nodeFactory.mergeNode(key, cloneObj);
+			locationClasses[key].push_back(cloneObj);
+			added = true;
+		}
+	}
+
+	if (const Instruction* origInst = dyn_cast<Instruction>(orig))
+	{
+		auto itr = indirectCallIndex.find(origInst);
+		if (itr != indirectCallIndex.end() && isa<Instruction>(clone))
+		{
+			indirectCallIndex.insert(std::make_pair(cast<Instruction>(clone), itr->second));
+			added = true;
+		}
+	}
+
+	if (!added)
+		return;
+	trackValue(clone);
+	++valueTracker->version;
+	dropQueryIndices();
+	++NumTrackedClones;
+}
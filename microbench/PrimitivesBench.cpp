@@ -0,0 +1,359 @@
+// Microbenchmarks of the primitives the solver spends its time in: the operations of the points-to sets, under every set implementation of PtsSetPolicies.h, the edge merging of SparseBitVectorGraph, and the union-find lookups of AndersNodeFactory
+//
+// The sets are drawn from a distribution that mimics a real run by default: most sets hold one or two objects, a few hold thousands, and the objects of a set tend to be allocated next to each other. With --pts-dump=<file>, the sets are read instead from the points-to dump of a real run (what -dump-debug or -dump-result prints to stderr, whose last part has one "<node> <object>..." line per node), so that the implementations can be compared on the exact sets of a program
+// All the other options are Google Benchmark's (--benchmark_filter, --benchmark_format, ...)
+
+#include "NodeFactory.h"
+#include "PtsSet.h"
+#include "SparseBitVectorGraph.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The number of sets, graph nodes and union-find nodes each benchmark works on
+const unsigned NumSets = 2048;
+const unsigned NumObjects = 1 << 14;
+
+typedef std::vector<std::vector<unsigned>> SetContents;
+
+// Filled by main() before the benchmarks run
+SetContents setContents;
+
+// A size distribution with a long tail, with each set clustered around a random base object
+SetContents generateSetContents()
+{
+	std::mt19937 rng(42);
+	std::discrete_distribution<unsigned> bucket({ 60, 25, 10, 4, 1 });
+	const unsigned bucketMin[] = { 1, 3, 9, 65, 513 };
+	const unsigned bucketMax[] = { 2, 8, 64, 512, 4096 };
+
+	SetContents ret(NumSets);
+	for (auto& set: ret)
+	{
+		unsigned b = bucket(rng);
+		unsigned size = std::uniform_int_distribution<unsigned>(bucketMin[b], bucketMax[b])(rng);
+		// Objects allocated together are numbered together: draw from a window a few times the size of the set
+		unsigned window = std::min(NumObjects, size * 4);
+		unsigned base = std::uniform_int_distribution<unsigned>(0, NumObjects - window)(rng);
+		std::uniform_int_distribution<unsigned> offset(0, window - 1);
+		while (set.size() < size)
+		{
+			set.push_back(base + offset(rng));
+			std::sort(set.begin(), set.end());
+			set.erase(std::unique(set.begin(), set.end()), set.end());
+		}
+	}
+	return ret;
+}
+
+// Read the non-empty sets of a points-to dump, keeping at most NumSets of them spread evenly over the dump
+bool readSetContents(const char* fileName, SetContents& ret)
+{
+	std::ifstream in(fileName);
+	if (!in)
+		return false;
+
+	// -dump-debug and -dump-result print the points-to sets last, after an empty line
+	std::vector<std::string> lines;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.empty())
+			lines.clear();
+		else
+			lines.push_back(line);
+	}
+
+	SetContents all;
+	for (auto const& line: lines)
+	{
+		std::istringstream fields(line);
+		unsigned node, obj;
+		if (!(fields >> node))
+			continue;
+		std::vector<unsigned> set;
+		while (fields >> obj)
+			set.push_back(obj);
+		if (!set.empty())
+			all.push_back(std::move(set));
+	}
+	if (all.empty())
+		return false;
+
+	ret.clear();
+	unsigned step = std::max<size_t>(1, all.size() / NumSets);
+	for (size_t i = 0; i < all.size() && ret.size() < NumSets; i += step)
+		ret.push_back(std::move(all[i]));
+	return true;
+}
+
+template <class Policy>
+std::vector<BasicAndersPtsSet<Policy>> buildSets()
+{
+	std::vector<BasicAndersPtsSet<Policy>> sets(setContents.size());
+	for (unsigned i = 0; i < sets.size(); ++i)
+		for (auto obj: setContents[i])
+			sets[i].insert(obj);
+	return sets;
+}
+
+// The pairs of sets the binary operations are applied to
+std::vector<std::pair<unsigned, unsigned>> getSetPairs()
+{
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<unsigned> pick(0, setContents.size() - 1);
+	std::vector<std::pair<unsigned, unsigned>> pairs(NumSets);
+	for (auto& pair: pairs)
+		pair = std::make_pair(pick(rng), pick(rng));
+	return pairs;
+}
+
+// Copy a set and union another into it: the solver's propagation along a copy edge
+template <class Policy>
+void BM_UnionWith(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	auto pairs = getSetPairs();
+	while (state.KeepRunning())
+	{
+		for (auto const& pair: pairs)
+		{
+			BasicAndersPtsSet<Policy> set = sets[pair.first];
+			benchmark::DoNotOptimize(set.unionWith(sets[pair.second]));
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+// Union a set into one that already has all of it, the common case once the solver gets close to the fixed point
+template <class Policy>
+void BM_UnionWithNoChange(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	auto halves = sets;
+	for (unsigned i = 0; i < halves.size(); ++i)
+	{
+		halves[i].clear();
+		for (unsigned j = 0; j < setContents[i].size(); j += 2)
+			halves[i].insert(setContents[i][j]);
+	}
+	while (state.KeepRunning())
+	{
+		for (unsigned i = 0; i < sets.size(); ++i)
+			benchmark::DoNotOptimize(sets[i].unionWith(halves[i]));
+	}
+	state.SetItemsProcessed(state.iterations() * sets.size());
+}
+
+template <class Policy>
+void BM_Has(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	std::mt19937 rng(11);
+	std::uniform_int_distribution<unsigned> pickSet(0, sets.size() - 1);
+	std::vector<std::pair<unsigned, unsigned>> queries(NumSets);
+	for (auto& query: queries)
+	{
+		unsigned s = pickSet(rng);
+		// Half of the queries hit
+		auto const& contents = setContents[s];
+		unsigned obj = (rng() % 2) ? contents[rng() % contents.size()] : rng() % NumObjects;
+		query = std::make_pair(s, obj);
+	}
+	while (state.KeepRunning())
+	{
+		for (auto const& query: queries)
+			benchmark::DoNotOptimize(sets[query.first].has(query.second));
+	}
+	state.SetItemsProcessed(state.iterations() * queries.size());
+}
+
+template <class Policy>
+void BM_Contains(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	auto pairs = getSetPairs();
+	while (state.KeepRunning())
+	{
+		for (auto const& pair: pairs)
+			benchmark::DoNotOptimize(sets[pair.first].contains(sets[pair.second]));
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+template <class Policy>
+void BM_IntersectWith(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	auto pairs = getSetPairs();
+	while (state.KeepRunning())
+	{
+		for (auto const& pair: pairs)
+			benchmark::DoNotOptimize(sets[pair.first].intersectWith(sets[pair.second]));
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+
+template <class Policy>
+void BM_Iterate(benchmark::State& state)
+{
+	auto sets = buildSets<Policy>();
+	size_t numElems = 0;
+	for (auto const& contents: setContents)
+		numElems += contents.size();
+	while (state.KeepRunning())
+	{
+		unsigned sum = 0;
+		for (auto const& set: sets)
+			for (auto obj: set)
+				sum += obj;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * numElems);
+}
+
+#define ANDERSEN_SET_BENCHMARKS(Policy) \
+	BENCHMARK_TEMPLATE(BM_UnionWith, Policy); \
+	BENCHMARK_TEMPLATE(BM_UnionWithNoChange, Policy); \
+	BENCHMARK_TEMPLATE(BM_Has, Policy); \
+	BENCHMARK_TEMPLATE(BM_Contains, Policy); \
+	BENCHMARK_TEMPLATE(BM_IntersectWith, Policy); \
+	BENCHMARK_TEMPLATE(BM_Iterate, Policy)
+
+ANDERSEN_SET_BENCHMARKS(SparseBitVectorPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(SmallVectorPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(DenseBitVectorPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(BlockBitVectorPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(HybridPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(RoaringPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(SharedPtsSetPolicy);
+ANDERSEN_SET_BENCHMARKS(BddPtsSetPolicy);
+
+// Merge the successors of one node into another, as the offline cycle detector does when it collapses a cycle. The successor sets have the sizes of the points-to sets
+void BM_MergeEdge(benchmark::State& state)
+{
+	auto pairs = getSetPairs();
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		SparseBitVectorGraph graph;
+		for (unsigned i = 0; i < setContents.size(); ++i)
+			for (auto succ: setContents[i])
+				graph.insertEdge(i, succ);
+		state.ResumeTiming();
+
+		for (auto const& pair: pairs)
+			graph.mergeEdge(pair.first, pair.second);
+	}
+	state.SetItemsProcessed(state.iterations() * pairs.size());
+}
+BENCHMARK(BM_MergeEdge);
+
+// A union-find forest shaped like the merges of a solved program: most nodes stay alone, the rest end up in a few large classes built by chains of merges
+void buildMergeForest(AndersNodeFactory& nodeFactory, std::vector<NodeIndex>& queries)
+{
+	std::vector<NodeIndex> nodes;
+	for (unsigned i = 0; i < NumObjects; ++i)
+		nodes.push_back(nodeFactory.createValueNode());
+
+	std::mt19937 rng(13);
+	std::uniform_int_distribution<unsigned> pick(0, nodes.size() - 1);
+	for (unsigned i = 0; i < NumObjects / 2; ++i)
+	{
+		NodeIndex dst = nodeFactory.getMergeTarget(nodes[pick(rng) % 64]);
+		NodeIndex src = nodeFactory.getMergeTarget(nodes[pick(rng)]);
+		if (dst != src)
+			nodeFactory.mergeNode(dst, src);
+	}
+
+	queries.resize(NumSets);
+	for (auto& query: queries)
+		query = nodes[pick(rng)];
+}
+
+void BM_GetMergeTarget(benchmark::State& state)
+{
+	AndersNodeFactory nodeFactory;
+	std::vector<NodeIndex> queries;
+	buildMergeForest(nodeFactory, queries);
+	while (state.KeepRunning())
+	{
+		for (auto n: queries)
+			benchmark::DoNotOptimize(nodeFactory.getMergeTarget(n));
+	}
+	state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_GetMergeTarget);
+
+// The lookups without path compression, as made by the const queries after the solving
+void BM_GetMergeTargetConst(benchmark::State& state)
+{
+	AndersNodeFactory nodeFactory;
+	std::vector<NodeIndex> queries;
+	buildMergeForest(nodeFactory, queries);
+	const AndersNodeFactory& constFactory = nodeFactory;
+	while (state.KeepRunning())
+	{
+		for (auto n: queries)
+			benchmark::DoNotOptimize(constFactory.getMergeTarget(n));
+	}
+	state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_GetMergeTargetConst);
+
+// The lock-free union-find of the concurrent merge mode (see ConcurrentUnionFind.h)
+void BM_ConcurrentGetMergeTarget(benchmark::State& state)
+{
+	AndersNodeFactory nodeFactory;
+	std::vector<NodeIndex> queries;
+	buildMergeForest(nodeFactory, queries);
+	nodeFactory.beginConcurrentMerge();
+	while (state.KeepRunning())
+	{
+		for (auto n: queries)
+			benchmark::DoNotOptimize(nodeFactory.concurrentGetMergeTarget(n));
+	}
+	nodeFactory.endConcurrentMerge();
+	state.SetItemsProcessed(state.iterations() * queries.size());
+}
+BENCHMARK(BM_ConcurrentGetMergeTarget);
+
+}	// end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+	benchmark::Initialize(&argc, argv);
+
+	setContents = generateSetContents();
+	const char* dumpFlag = "--pts-dump=";
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strncmp(argv[i], dumpFlag, std::strlen(dumpFlag)) == 0)
+		{
+			const char* fileName = argv[i] + std::strlen(dumpFlag);
+			if (!readSetContents(fileName, setContents))
+			{
+				fprintf(stderr, "%s: cannot read points-to sets from %s\n", argv[0], fileName);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "%s: unknown argument %s\n", argv[0], argv[i]);
+			return 1;
+		}
+	}
+
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,219 @@
+// andersen-batch - Analyze many independent bitcode files in one process and save the results of each
+//
+// The files come from the command line and from -list, one path per line. The results of each go next to it in <file>.results, for PersistedAndersResults and andersen-serve, as andersen-persist writes them. The process, LLVM and the tables of the external library models are set up once for the whole batch rather than once per file
+// -j files are analyzed at once, each on a thread of its own, and the parallel phases of all of them share one pool of -threads workers. With -memory-cap, a file is only started while the memory the running analyses are expected to take stays under the cap. A file is expected to take -bytes-per-bitcode-byte times its size; the ratio is raised whenever a finished analysis turns out to have needed more. The files start in the order given, so a large file waits for room rather than being overtaken, and one file always runs however large it is
+// All the options of the analysis apply to every file (-enable-hvn, -anders-threads, ...), except two that only work with -j=1: -anders-auto-config, which changes the options per file, and -time-passes, whose phase timers are shared by the whole process
+
+#include "Andersen.h"
+#include "Parallel.h"
+#include "PhaseTimer.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<bitcode files>"), cl::ZeroOrMore);
+static cl::opt<std::string> ListFile("list", cl::desc("A file with more bitcode files to analyze, one path per line"), cl::value_desc("file"));
+static cl::opt<unsigned> NumJobs("j", cl::desc("The number of files analyzed at once (0 for one per hardware thread)"), cl::init(0));
+static cl::opt<unsigned> NumThreads("threads", cl::desc("The number of workers the parallel phases of all the analyses share (0 for one per hardware thread)"), cl::init(0));
+static cl::opt<unsigned> MemoryCap("memory-cap", cl::desc("Only start a file while the expected memory of the running analyses stays under this many MB (0 for no cap)"), cl::value_desc("MB"), cl::init(0));
+static cl::opt<double> BytesPerBitcodeByte("bytes-per-bitcode-byte", cl::desc("The memory a file is first expected to take, per byte of its bitcode"), cl::init(40));
+static cl::opt<bool> Lazy("lazy", cl::desc("Read the bitcode lazily and free each function body once its constraints are collected"), cl::init(true));
+
+namespace
+{
+
+struct BatchFile
+{
+	std::string name;
+	std::uint64_t size = 0;
+	std::string error;
+	double seconds = 0;
+	// The largest memory of the analysis itself, as Andersen::getPeakMemoryUsage() takes it. The IR is not counted
+	std::size_t peakBytes = 0;
+};
+
+// Analyze file and write its results. Return false and put the reason into file.error on failure
+bool analyzeFile(BatchFile& file, const AndersRunOptions& options)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::error_code ec;
+	raw_fd_ostream os(file.name + ".results", ec, sys::fs::F_None);
+	if (ec)
+	{
+		file.error = file.name + ".results: " + ec.message();
+		return false;
+	}
+
+	// Each file has a context of its own, since the contexts are not shared between threads
+	LLVMContext context;
+	SMDiagnostic err;
+	BitVector addressTakenFuncs;
+	if (Lazy)
+	{
+		std::unique_ptr<Module> scanned = getLazyIRFileModule(file.name, err, context);
+		if (!scanned)
+		{
+			file.error = err.getMessage().str();
+			return false;
+		}
+		if (!Andersen::findAddressTakenFunctions(*scanned, addressTakenFuncs, file.error))
+			return false;
+	}
+
+	std::unique_ptr<Module> module = Lazy ? getLazyIRFileModule(file.name, err, context) : parseIRFile(file.name, err, context);
+	if (!module)
+	{
+		file.error = err.getMessage().str();
+		return false;
+	}
+	std::unique_ptr<Andersen> anders;
+	if (Lazy)
+		anders = Andersen::createLazily(*module, addressTakenFuncs, file.error, options);
+	else
+		anders.reset(new Andersen(*module, options));
+	if (!anders)
+		return false;
+	anders->writeSolvedResults(*module, os);
+
+	file.peakBytes = anders->getPeakMemoryUsage().getTotal();
+	file.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
+
+// Hands the files out to the workers in order, under the memory cap
+class BatchScheduler
+{
+private:
+	std::vector<BatchFile>& files;
+	std::mutex mutex;
+	std::condition_variable changed;
+	size_t next = 0;
+	unsigned numRunning = 0;
+	// The expected memory of the running files, and the ratio it is expected from
+	double reservedBytes = 0;
+	double bytesPerByte;
+	double capBytes;
+
+	double getExpectedBytes(const BatchFile& file) const { return file.size * bytesPerByte; }
+	bool canStart(const BatchFile& file) const { return numRunning == 0 || capBytes == 0 || reservedBytes + getExpectedBytes(file) <= capBytes; }
+public:
+	BatchScheduler(std::vector<BatchFile>& f): files(f), bytesPerByte(BytesPerBitcodeByte), capBytes(MemoryCap * 1024.0 * 1024.0) {}
+
+	// Wait until the next file may start, and return it, or nullptr once every file has been handed out. expected gets what it was reserved with
+	BatchFile* take(double& expected)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [this] { return next == files.size() || canStart(files[next]); });
+		if (next == files.size())
+			return nullptr;
+		BatchFile& file = files[next++];
+		expected = getExpectedBytes(file);
+		reservedBytes += expected;
+		++numRunning;
+		return &file;
+	}
+
+	void finish(const BatchFile& file, double expected)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reservedBytes -= expected;
+		--numRunning;
+		if (file.size != 0)
+			bytesPerByte = std::max(bytesPerByte, double(file.peakBytes) / file.size);
+		changed.notify_all();
+	}
+};
+
+}
+
+int main(int argc, char** argv)
+{
+	// Print the -time-passes and -stats reports on the way out
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen analysis of a batch of bitcode files\n");
+
+	std::vector<BatchFile> files;
+	for (auto const& name: InputFiles)
+		files.push_back(BatchFile{name});
+	if (!ListFile.empty())
+	{
+		auto listOrErr = MemoryBuffer::getFile(ListFile);
+		if (!listOrErr)
+		{
+			errs() << argv[0] << ": " << ListFile << ": " << listOrErr.getError().message() << "\n";
+			return 1;
+		}
+		SmallVector<StringRef, 64> lines;
+		(*listOrErr)->getBuffer().split(lines, '\n', -1, false);
+		for (auto line: lines)
+			if (!line.trim().empty())
+				files.push_back(BatchFile{line.trim().str()});
+	}
+	for (auto& file: files)
+		sys::fs::file_size(file.name, file.size);
+
+	unsigned numJobs = std::min<unsigned>(getNumWorkerThreads(NumJobs), std::max<size_t>(files.size(), 1));
+	if (numJobs > 1 && cl::getRegisteredOptions()["anders-auto-config"]->getNumOccurrences() > 0)
+	{
+		errs() << argv[0] << ": -anders-auto-config sets the options for each file, so it needs -j=1\n";
+		return 1;
+	}
+	if (numJobs > 1 && TimePassesIsEnabled)
+	{
+		errs() << argv[0] << ": -time-passes times the phases of the whole process, so it needs -j=1\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	AndersThreadPool pool(getNumWorkerThreads(NumThreads));
+	AndersRunOptions options;
+	options.threadPool = &pool;
+	options.trackPeakMemory = MemoryCap != 0;
+	BatchScheduler scheduler(files);
+	std::mutex outputMutex;
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < numJobs; ++i)
+	{
+		workers.emplace_back([&]
+		{
+			double expected;
+			while (BatchFile* file = scheduler.take(expected))
+			{
+				bool ok = analyzeFile(*file, options);
+				scheduler.finish(*file, expected);
+				std::lock_guard<std::mutex> lock(outputMutex);
+				if (ok)
+					outs() << file->name << ": analyzed in " << format("%.3f", file->seconds) << "s\n";
+				else
+					errs() << argv[0] << ": " << file->name << ": " << file->error << "\n";
+			}
+		});
+	}
+	for (auto& worker: workers)
+		worker.join();
+
+	unsigned numFailed = std::count_if(files.begin(), files.end(), [] (const BatchFile& file) { return !file.error.empty(); });
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	outs() << files.size() - numFailed << " of " << files.size() << " files analyzed in " << format("%.3f", elapsed.count()) << "s, peak RSS " << getProcessPeakRSS() << " KB\n";
+	return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+// andersen-bench - Run the analysis over a corpus of bitcode files under every combination of the offline and online optimizations
+//
+// Every .bc file of the directory is analyzed with every subset of -enable-hvn, -enable-hu, -enable-hcd and -enable-lcd, under each solver named by -engines, -repeat times. Each run gets a process of its own, so that the peak memory of a run is not hidden by the runs before it. The results go to the standard output as CSV, one line per run: the wall time of each phase (see PhaseTimer.h) and of the whole analysis in seconds, the peak RSS in KB after parsing the bitcode and after the analysis, and statistics of the points-to sets of the pointers in the module
+// Any other option of the analysis given on the command line (-anders-worklist, -enable-le, ...) applies to all runs
+
+#include "Andersen.h"
+#include "PhaseTimer.h"
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+static cl::opt<std::string> CorpusDir(cl::Positional, cl::desc("<directory of .bc files>"), cl::Required);
+static cl::opt<unsigned> NumRepeats("repeat", cl::desc("The number of runs of each configuration on each file"), cl::init(3));
+static cl::list<std::string> EngineNames("engines", cl::CommaSeparated, cl::desc("The solvers to run every combination with (worklist, diff-prop, wave, parallel). The default is worklist"));
+
+namespace {
+
+// The optimizations whose combinations are benchmarked, by the name of their option
+const char* const OptimizationFlags[] = { "enable-hvn", "enable-hu", "enable-hcd", "enable-lcd" };
+
+// The solvers, with the options that select them. Add new engines here
+struct Engine
+{
+	const char* name;
+	std::vector<const char*> flags;
+};
+const Engine Engines[] = {
+	{ "worklist", {} },
+	{ "diff-prop", { "enable-diff-prop" } },
+	{ "wave", { "enable-wave" } },
+	{ "parallel", { "anders-threads=0" } },
+};
+
+struct Config
+{
+	std::string name;
+	const Engine* engine;
+	std::vector<const char*> flags;
+};
+
+// Set an option of the analysis as if "-flag" had been given on the command line. A flag may carry a value after a '='
+void setOption(StringRef flag)
+{
+	auto nameAndValue = flag.split('=');
+	auto& options = cl::getRegisteredOptions();
+	auto itr = options.find(nameAndValue.first);
+	if (itr == options.end())
+		report_fatal_error(Twine("Unknown option -") + flag);
+	itr->second->addOccurrence(0, nameAndValue.first, nameAndValue.second);
+}
+
+void writeHeader(raw_ostream& os)
+{
+	os << "file,config,engine,run";
+	for (unsigned i = 0; i < static_cast<unsigned>(AndersPhase::NumPhases); ++i)
+		os << "," << getPhaseName(static_cast<AndersPhase>(i));
+	os << ",total,parse_rss_kb,peak_rss_kb,pointers,unknown_pointers,pts_total,pts_max\n";
+}
+
+// Analyze file once under config, in this process, and write the CSV line of the run to os
+bool runOnce(StringRef file, const Config& config, unsigned run, raw_ostream& os)
+{
+	for (auto flag: config.flags)
+		setOption(flag);
+
+	LLVMContext context;
+	SMDiagnostic err;
+	std::unique_ptr<Module> module = parseIRFile(file, err, context);
+	if (!module)
+	{
+		err.print("andersen-bench", errs());
+		return false;
+	}
+	unsigned parseRSS = getProcessPeakRSS();
+
+	resetPhaseRecords();
+	auto start = std::chrono::steady_clock::now();
+	Andersen anders(*module);
+	std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+
+	// The points-to sets of every pointer the module defines
+	std::vector<const Value*> pointers;
+	for (auto const& g: module->globals())
+		pointers.push_back(&g);
+	for (auto const& f: *module)
+	{
+		for (auto const& arg: f.args())
+			if (arg.getType()->isPointerTy())
+				pointers.push_back(&arg);
+		for (auto const& bb: f)
+			for (auto const& inst: bb)
+				if (inst.getType()->isPointerTy())
+					pointers.push_back(&inst);
+	}
+	unsigned numUnknown = 0, ptsMax = 0;
+	uint64_t ptsTotal = 0;
+	for (auto ptr: pointers)
+	{
+		AndersPtsSetView view;
+		if (!anders.getPointsToSetView(ptr, view) || view.hasUniversalObject())
+		{
+			++numUnknown;
+			continue;
+		}
+		unsigned size = view.getNumValues();
+		ptsTotal += size;
+		ptsMax = std::max(ptsMax, size);
+	}
+
+	os << sys::path::filename(file) << "," << config.name;
+	// What -anders-auto-config chose, e.g. "auto(hvn+lcd)", to compare with the fixed combinations
+	if (const AndersAutoConfig* autoConfig = anders.getAutoConfig())
+	{
+		os << "(";
+		autoConfig->print(os);
+		os << ")";
+	}
+	os << "," << config.engine->name << "," << run;
+	for (unsigned i = 0; i < static_cast<unsigned>(AndersPhase::NumPhases); ++i)
+		os << "," << format("%.6f", getPhaseRecord(static_cast<AndersPhase>(i)).wallTime);
+	os << "," << format("%.6f", total.count()) << "," << parseRSS << "," << getProcessPeakRSS();
+	os << "," << pointers.size() << "," << numUnknown << "," << ptsTotal << "," << ptsMax << "\n";
+	return true;
+}
+
+// Run runOnce() in a child process and copy its line to the standard output
+bool runInChild(StringRef file, const Config& config, unsigned run)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		report_fatal_error("pipe() failed");
+	outs().flush();
+	errs().flush();
+
+	pid_t pid = fork();
+	if (pid < 0)
+		report_fatal_error("fork() failed");
+	if (pid == 0)
+	{
+		close(fds[0]);
+		bool succeeded;
+		{
+			raw_fd_ostream os(fds[1], true);
+			succeeded = runOnce(file, config, run, os);
+		}
+		errs().flush();
+		_exit(succeeded ? 0 : 1);
+	}
+
+	close(fds[1]);
+	std::string line;
+	char buffer[4096];
+	ssize_t numRead;
+	while ((numRead = read(fds[0], buffer, sizeof(buffer))) > 0)
+		line.append(buffer, numRead);
+	close(fds[0]);
+
+	int status;
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		errs() << "andersen-bench: " << file << ": run " << run << " of " << config.name << "/" << config.engine->name << " failed\n";
+		return false;
+	}
+	outs() << line;
+	return true;
+}
+
+}	// end of anonymous namespace
+
+int main(int argc, char** argv)
+{
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen analysis benchmark\n");
+
+	std::vector<const Engine*> engines;
+	if (EngineNames.empty())
+		engines.push_back(&Engines[0]);
+	for (auto const& name: EngineNames)
+	{
+		auto itr = std::find_if(std::begin(Engines), std::end(Engines), [&name] (const Engine& e) { return name == e.name; });
+		if (itr == std::end(Engines))
+		{
+			errs() << argv[0] << ": unknown engine " << name << "\n";
+			return 1;
+		}
+		engines.push_back(itr);
+	}
+
+	std::vector<Config> configs;
+	unsigned numOptimizations = array_lengthof(OptimizationFlags);
+	for (auto engine: engines)
+	{
+		for (unsigned mask = 0; mask < (1u << numOptimizations); ++mask)
+		{
+			Config config;
+			config.engine = engine;
+			config.flags = engine->flags;
+			for (unsigned i = 0; i < numOptimizations; ++i)
+			{
+				if (mask & (1u << i))
+				{
+					// "enable-hvn" goes by "hvn"
+					config.name += (config.name.empty() ? "" : "+") + StringRef(OptimizationFlags[i]).drop_front(7).str();
+					config.flags.push_back(OptimizationFlags[i]);
+				}
+			}
+			if (config.name.empty())
+				config.name = "none";
+			configs.push_back(std::move(config));
+		}
+		configs.push_back(Config{"auto", engine, engine->flags});
+		configs.back().flags.push_back("anders-auto-config");
+	}
+
+	std::vector<std::string> files;
+	std::error_code ec;
+	for (sys::fs::directory_iterator itr(CorpusDir, ec), ite; itr != ite && !ec; itr.increment(ec))
+	{
+		if (sys::path::extension(itr->path()) == ".bc")
+			files.push_back(itr->path());
+	}
+	if (ec)
+	{
+		errs() << argv[0] << ": " << CorpusDir << ": " << ec.message() << "\n";
+		return 1;
+	}
+	std::sort(files.begin(), files.end());
+
+	writeHeader(outs());
+	bool allSucceeded = true;
+	for (auto const& file: files)
+		for (auto const& config: configs)
+			for (unsigned run = 0; run < NumRepeats; ++run)
+				allSucceeded &= runInChild(file, config, run);
+	return allSucceeded ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+// andersen-dsolve - Solve a constraint file over several processes, on one machine or many
+//
+// Every process is started with the same constraint file, which each of them maps and reads its own part of, and the same -peers list, and a -rank of its own. The nodes are split between the ranks, and each rank keeps only the points-to sets and the edges of its nodes, so the memory of the solving is spread over the machines (see DistributedSolver.h). The ranks connect to each other over TCP: rank r listens on the port of the r-th peer, and connects to the ranks before it. All the machines must have the same byte order
+// The constraint file is solved as it is: run the optimizers first with andersen-solve if they are wanted
+
+#include "ConstraintFile.h"
+#include "DistributedSolver.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <thread>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<constraint file>"), cl::Required);
+static cl::list<std::string> Peers("peers", cl::desc("The host:port of every rank, in rank order"), cl::value_desc("host:port,..."), cl::CommaSeparated, cl::OneOrMore);
+static cl::opt<unsigned> Rank("rank", cl::desc("The rank of this process in -peers"), cl::Required);
+static cl::opt<unsigned> ConnectTimeout("connect-timeout", cl::desc("How long to keep trying to reach the other ranks, in seconds"), cl::init(60));
+static cl::opt<bool> DumpResult("dump-result", cl::desc("Print the points-to sets of the nodes of this rank"));
+
+// Read or write exactly size bytes. Return false once the connection is closed or broken
+static bool readAll(int fd, void* data, size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0)
+	{
+		ssize_t n = read(fd, bytes, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeAll(int fd, const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		ssize_t n = write(fd, bytes, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+// A full mesh of TCP connections between the ranks. A message goes as [active, word count, words...]
+class SocketTransport: public AndersTransport
+{
+private:
+	unsigned rank;
+	// The connection to each other rank, or -1 for this one
+	std::vector<int> fds;
+
+	SocketTransport(unsigned r, unsigned numRanks): rank(r), fds(numRanks, -1) {}
+
+	static bool splitPeer(StringRef peer, std::string& host, std::string& port, std::string& error)
+	{
+		auto parts = peer.rsplit(':');
+		if (parts.first.empty() || parts.second.empty())
+		{
+			error = peer.str() + ": not host:port";
+			return false;
+		}
+		host = parts.first;
+		port = parts.second;
+		return true;
+	}
+
+	// Keep trying until the peer listens, or the deadline passes. Return the connection, or -1
+	static int connectTo(StringRef peer, std::chrono::steady_clock::time_point deadline, std::string& error)
+	{
+		std::string host, port;
+		if (!splitPeer(peer, host, port, error))
+			return -1;
+		while (true)
+		{
+			addrinfo hints;
+			std::memset(&hints, 0, sizeof(hints));
+			hints.ai_family = AF_UNSPEC;
+			hints.ai_socktype = SOCK_STREAM;
+			addrinfo* addrs = nullptr;
+			int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs);
+			if (rc != 0)
+			{
+				error = peer.str() + ": " + gai_strerror(rc);
+				return -1;
+			}
+			for (addrinfo* addr = addrs; addr != nullptr; addr = addr->ai_next)
+			{
+				int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+				if (fd < 0)
+					continue;
+				if (connect(fd, addr->ai_addr, addr->ai_addrlen) == 0)
+				{
+					freeaddrinfo(addrs);
+					return fd;
+				}
+				error = peer.str() + ": " + std::strerror(errno);
+				close(fd);
+			}
+			freeaddrinfo(addrs);
+			if (std::chrono::steady_clock::now() >= deadline)
+				return -1;
+			std::this_thread::sleep_for(std::chrono::milliseconds(200));
+		}
+	}
+public:
+	~SocketTransport() override
+	{
+		for (auto fd: fds)
+			if (fd >= 0)
+				close(fd);
+	}
+
+	// Listen on the port of this rank, connect to the ranks before it, and take the connections of the ranks after it. Each connection starts with the rank of the side that opened it
+	static std::unique_ptr<SocketTransport> connectAll(ArrayRef<std::string> peers, unsigned rank, std::string& error)
+	{
+		std::unique_ptr<SocketTransport> ret(new SocketTransport(rank, peers.size()));
+		std::string host, port;
+		if (!splitPeer(peers[rank], host, port, error))
+			return nullptr;
+
+		addrinfo hints;
+		std::memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE;
+		addrinfo* addrs = nullptr;
+		int rc = getaddrinfo(nullptr, port.c_str(), &hints, &addrs);
+		if (rc != 0)
+		{
+			error = peers[rank] + ": " + gai_strerror(rc);
+			return nullptr;
+		}
+		int listenFd = socket(addrs->ai_family, addrs->ai_socktype, addrs->ai_protocol);
+		int reuse = 1;
+		bool listening = listenFd >= 0 && setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) == 0 && bind(listenFd, addrs->ai_addr, addrs->ai_addrlen) == 0 && listen(listenFd, SOMAXCONN) == 0;
+		freeaddrinfo(addrs);
+		if (!listening)
+		{
+			error = peers[rank] + ": " + std::strerror(errno);
+			if (listenFd >= 0)
+				close(listenFd);
+			return nullptr;
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(ConnectTimeout);
+		for (unsigned r = 0; r < rank; ++r)
+		{
+			int fd = connectTo(peers[r], deadline, error);
+			std::uint32_t myRank = rank;
+			if (fd < 0 || !writeAll(fd, &myRank, sizeof(myRank)))
+			{
+				if (fd >= 0)
+					close(fd);
+				close(listenFd);
+				return nullptr;
+			}
+			ret->fds[r] = fd;
+		}
+		for (unsigned i = rank + 1; i < peers.size(); ++i)
+		{
+			int fd = accept(listenFd, nullptr, nullptr);
+			std::uint32_t peerRank;
+			if (fd < 0 || !readAll(fd, &peerRank, sizeof(peerRank)) || peerRank <= rank || peerRank >= peers.size() || ret->fds[peerRank] >= 0)
+			{
+				error = fd < 0 ? std::strerror(errno) : "a connection from an unexpected rank";
+				if (fd >= 0)
+					close(fd);
+				close(listenFd);
+				return nullptr;
+			}
+			ret->fds[peerRank] = fd;
+		}
+		close(listenFd);
+
+		// The rounds exchange one message each way, so don't let Nagle hold the last packet of one back
+		for (auto fd: ret->fds)
+		{
+			int noDelay = 1;
+			if (fd >= 0)
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+		}
+		return ret;
+	}
+
+	unsigned getRank() const override { return rank; }
+	unsigned getNumRanks() const override { return fds.size(); }
+
+	bool exchange(const std::vector<std::vector<std::uint32_t>>& outgoing, std::vector<std::uint32_t>& incoming, bool& active, std::string& error) override
+	{
+		// Every rank sends all its messages before it reads, so the sending goes on another thread, or two ranks with full socket buffers would wait on each other
+		bool sent = true;
+		std::uint32_t myActive = active;
+		std::thread sender([this, &outgoing, &sent, myActive]
+		{
+			for (unsigned r = 0; r < fds.size(); ++r)
+			{
+				if (r == rank)
+					continue;
+				std::uint32_t header[2] = {myActive, static_cast<std::uint32_t>(outgoing[r].size())};
+				if (!writeAll(fds[r], header, sizeof(header)) || !writeAll(fds[r], outgoing[r].data(), outgoing[r].size() * sizeof(std::uint32_t)))
+				{
+					sent = false;
+					return;
+				}
+			}
+		});
+
+		incoming.clear();
+		bool received = true;
+		for (unsigned r = 0; r < fds.size() && received; ++r)
+		{
+			if (r == rank)
+				continue;
+			std::uint32_t header[2];
+			received = readAll(fds[r], header, sizeof(header));
+			if (!received)
+				break;
+			active |= header[0] != 0;
+			size_t pos = incoming.size();
+			incoming.resize(pos + header[1]);
+			received = readAll(fds[r], incoming.data() + pos, header[1] * sizeof(std::uint32_t));
+		}
+		sender.join();
+		if (!sent || !received)
+		{
+			error = "lost the connection to another rank";
+			return false;
+		}
+		return true;
+	}
+};
+
+int main(int argc, char** argv)
+{
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Distributed Andersen constraint solver\n");
+	if (Rank >= Peers.size())
+	{
+		errs() << argv[0] << ": rank " << Rank << " of " << Peers.size() << " peers\n";
+		return 1;
+	}
+	// A rank that goes away in the middle of a round must be reported, not kill the others
+	std::signal(SIGPIPE, SIG_IGN);
+
+	std::string error;
+	auto reader = ConstraintFileReader::open(InputFile, error);
+	if (!reader)
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::string> peers(Peers.begin(), Peers.end());
+	auto transport = SocketTransport::connectAll(peers, Rank, error);
+	if (!transport)
+	{
+		errs() << argv[0] << ": " << error << "\n";
+		return 1;
+	}
+	auto solver = DistributedAndersSolver::create(*reader, *transport, error);
+	if (!solver || !solver->solve(error))
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	auto const& stats = solver->getStats();
+	outs() << "rank " << Rank << ": nodes [" << solver->getFirstNode() << ", " << solver->getLastNode() << "), solved in " << format("%.3f", elapsed.count()) << "s, " << stats.rounds << " rounds, " << stats.merges << " merges, sent " << stats.deltasSent << " deltas and " << stats.edgeRequestsSent << " edge requests in " << stats.wordsSent << " words\n";
+	if (DumpResult)
+	{
+		for (NodeIndex n = solver->getFirstNode(); n < solver->getLastNode(); ++n)
+		{
+			auto const& ptsSet = solver->getPointsToSet(n);
+			if (ptsSet.isEmpty())
+				continue;
+			outs() << n << " -> {";
+			if (ptsSet.hasNullObject())
+				outs() << " " << AndersNodeFactory::NullObjectIndex;
+			for (auto obj: ptsSet)
+				outs() << " " << obj;
+			outs() << " }\n";
+		}
+	}
+	return 0;
+}
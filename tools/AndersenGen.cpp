@@ -0,0 +1,94 @@
+// andersen-gen - Write a synthetic constraint file of a given shape
+//
+// The file can be solved with andersen-solve like a file written with -anders-write-constraints, so the scaling of the optimizers and the solver can be measured at any size without a program of that size. With -like=<constraint file>, the node counts and the mix of the constraints are taken from an existing file, and the options given on the command line override them
+// See ConstraintGenerator.h for the meaning of the shape
+
+#include "ConstraintFile.h"
+#include "ConstraintGenerator.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> OutputFile("o", cl::desc("The constraint file to write"), cl::value_desc("file"), cl::Required);
+static cl::opt<std::string> LikeFile("like", cl::desc("Take the node counts and the constraint mix from an existing constraint file"), cl::value_desc("file"));
+
+static cl::opt<unsigned> NumNodes("nodes", cl::desc("The number of nodes, besides the special ones"), cl::init(10000));
+static cl::opt<double> ObjectRatio("object-ratio", cl::desc("The share of the nodes that are objects"), cl::init(0.2));
+static cl::opt<unsigned> NumConstraints("constraints", cl::desc("The number of constraints drawn from the mix"), cl::init(10000));
+static cl::opt<double> AddrOfWeight("addr-of", cl::desc("The weight of the address-of constraints in the mix"), cl::init(15));
+static cl::opt<double> CopyWeight("copy", cl::desc("The weight of the copy constraints in the mix"), cl::init(45));
+static cl::opt<double> LoadWeight("load", cl::desc("The weight of the load constraints in the mix"), cl::init(20));
+static cl::opt<double> StoreWeight("store", cl::desc("The weight of the store constraints in the mix"), cl::init(20));
+static cl::opt<unsigned> Locality("locality", cl::desc("How far apart the two nodes of a constraint can be"), cl::init(64));
+static cl::opt<double> CycleDensity("cycle-density", cl::desc("The share of the copy constraints that may close a cycle"), cl::init(0.05));
+static cl::opt<unsigned> NumHubs("hubs", cl::desc("The number of hub nodes"), cl::init(0));
+static cl::opt<unsigned> HubDegree("hub-degree", cl::desc("The number of copy edges into and out of each hub node"), cl::init(0));
+static cl::opt<unsigned> NumIndirectCalls("indirect-calls", cl::desc("The number of indirect call sites"), cl::init(0));
+static cl::opt<unsigned> CallFanOut("call-fan-out", cl::desc("The number of functions each indirect call site resolves to"), cl::init(0));
+static cl::opt<unsigned> NumFunctions("functions", cl::desc("The number of functions the indirect calls resolve to"), cl::init(0));
+static cl::opt<unsigned> NumCallArgs("call-args", cl::desc("The number of arguments of each indirect call"), cl::init(2));
+static cl::opt<unsigned long long> Seed("seed", cl::desc("The seed of the random numbers"), cl::init(1));
+
+// Override the field with the option when there is no file to take it from or the option is given
+template <typename T, typename Opt>
+static void setField(T& field, const Opt& opt)
+{
+	if (LikeFile.empty() || opt.getNumOccurrences() != 0)
+		field = opt;
+}
+
+int main(int argc, char** argv)
+{
+	cl::ParseCommandLineOptions(argc, argv, "Synthetic constraint file generator\n");
+
+	SyntheticConstraintShape shape;
+	if (!LikeFile.empty())
+	{
+		std::string error;
+		auto reader = ConstraintFileReader::open(LikeFile, error);
+		if (!reader)
+		{
+			errs() << argv[0] << ": " << LikeFile << ": " << error << "\n";
+			return 1;
+		}
+		shape = SyntheticConstraintShape::like(*reader);
+	}
+	setField(shape.numNodes, NumNodes);
+	setField(shape.objectRatio, ObjectRatio);
+	setField(shape.numConstraints, NumConstraints);
+	setField(shape.addrOfWeight, AddrOfWeight);
+	setField(shape.copyWeight, CopyWeight);
+	setField(shape.loadWeight, LoadWeight);
+	setField(shape.storeWeight, StoreWeight);
+	shape.locality = Locality;
+	shape.cycleDensity = CycleDensity;
+	shape.numHubs = NumHubs;
+	shape.hubDegree = HubDegree;
+	shape.numIndirectCalls = NumIndirectCalls;
+	shape.callFanOut = CallFanOut;
+	shape.numFunctions = NumFunctions;
+	shape.numCallArgs = NumCallArgs;
+	shape.seed = Seed;
+
+	std::error_code ec;
+	raw_fd_ostream os(OutputFile, ec, sys::fs::F_None);
+	if (ec)
+	{
+		errs() << argv[0] << ": " << OutputFile << ": " << ec.message() << "\n";
+		return 1;
+	}
+
+	SyntheticConstraintGenerator generator(shape);
+	ConstraintFileWriter writer(os, generator.getNumNodes(), generator.getObjectNodes());
+	size_t numWritten = 0;
+	generator.generate([&writer, &numWritten] (const AndersConstraint& c) {
+		writer.write(c);
+		++numWritten;
+	});
+
+	outs() << "nodes: " << generator.getNumNodes() << ", object nodes: " << generator.getObjectNodes().size() << ", constraints: " << numWritten << "\n";
+	return 0;
+}
@@ -0,0 +1,86 @@
+// andersen-link - Link the summaries of the modules of a program and solve the analysis of the whole program
+//
+// The summaries are the ones written by andersen-summarize. No IR is needed to solve them. With -m, the bitcode file of each summary is given in the same order, and the results of each module are saved next to it in <file>.results for PersistedAndersResults. All the options of the analysis apply (-enable-hvn, -anders-worklist, -time-passes, -stats, ...)
+
+#include "Andersen.h"
+#include "ConstraintSummary.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<summary files>"), cl::OneOrMore);
+static cl::list<std::string> ModuleFiles("m", cl::desc("The bitcode file of each summary, in the same order, to save the results of"), cl::value_desc("file"));
+
+int main(int argc, char** argv)
+{
+	// Print the -time-passes and -stats reports on the way out
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen analysis of linked constraint summaries\n");
+	if (!ModuleFiles.empty() && ModuleFiles.size() != InputFiles.size())
+	{
+		errs() << argv[0] << ": " << ModuleFiles.size() << " bitcode files for " << InputFiles.size() << " summaries\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	std::string error;
+	std::vector<std::unique_ptr<ConstraintSummary>> summaries;
+	std::vector<const ConstraintSummary*> summaryPtrs;
+	for (auto const& fileName: InputFiles)
+	{
+		summaries.push_back(ConstraintSummary::read(fileName, error));
+		if (!summaries.back())
+		{
+			errs() << argv[0] << ": " << fileName << ": " << error << "\n";
+			return 1;
+		}
+		summaryPtrs.push_back(summaries.back().get());
+	}
+
+	auto anders = Andersen::createFromSummaries(summaryPtrs, error);
+	if (!anders)
+	{
+		errs() << argv[0] << ": " << error << "\n";
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	outs() << "linked and solved " << summaries.size() << " summaries in " << format("%.3f", elapsed.count()) << "s\n";
+
+	// One module at a time, so that only one of them is in memory
+	for (unsigned i = 0, e = ModuleFiles.size(); i < e; ++i)
+	{
+		LLVMContext context;
+		SMDiagnostic err;
+		std::unique_ptr<Module> module = parseIRFile(ModuleFiles[i], err, context);
+		if (!module)
+		{
+			err.print(argv[0], errs());
+			return 1;
+		}
+		std::string outputFile = ModuleFiles[i] + ".results";
+		std::error_code ec;
+		raw_fd_ostream os(outputFile, ec, sys::fs::F_None);
+		if (ec)
+		{
+			errs() << argv[0] << ": " << outputFile << ": " << ec.message() << "\n";
+			return 1;
+		}
+		if (!anders->writeModuleResults(i, *module, os, error))
+		{
+			errs() << argv[0] << ": " << ModuleFiles[i] << ": " << error << "\n";
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,82 @@
+// andersen-persist - Analyze a bitcode file and save the results for PersistedAndersResults
+//
+// The bitcode is read lazily, and the analysis materializes, collects and frees one function body at a time (see Andersen::createLazily()), so the IR of the whole program is never in memory at once. It is read twice: the first copy is only scanned for the functions whose address is taken, and freed before the analysis starts. With -lazy=false, the module is parsed in full and analyzed as usual, for comparison. All the options of the analysis apply (-enable-hvn, -anders-worklist, -time-passes, -stats, ...)
+
+#include "Andersen.h"
+#include "PhaseTimer.h"
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<bitcode file>"), cl::Required);
+static cl::opt<std::string> OutputFile("o", cl::desc("The results file to write"), cl::value_desc("file"), cl::Required);
+static cl::opt<bool> Lazy("lazy", cl::desc("Read the bitcode lazily and free each function body once its constraints are collected"), cl::init(true));
+
+int main(int argc, char** argv)
+{
+	// Print the -time-passes and -stats reports on the way out
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen analysis with persisted results\n");
+
+	std::error_code ec;
+	raw_fd_ostream os(OutputFile, ec, sys::fs::F_None);
+	if (ec)
+	{
+		errs() << argv[0] << ": " << OutputFile << ": " << ec.message() << "\n";
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	LLVMContext context;
+	SMDiagnostic err;
+	std::string error;
+	BitVector addressTakenFuncs;
+	if (Lazy)
+	{
+		std::unique_ptr<Module> scanned = getLazyIRFileModule(InputFile, err, context);
+		if (!scanned)
+		{
+			err.print(argv[0], errs());
+			return 1;
+		}
+		if (!Andersen::findAddressTakenFunctions(*scanned, addressTakenFuncs, error))
+		{
+			errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+			return 1;
+		}
+	}
+
+	std::unique_ptr<Module> module = Lazy ? getLazyIRFileModule(InputFile, err, context) : parseIRFile(InputFile, err, context);
+	if (!module)
+	{
+		err.print(argv[0], errs());
+		return 1;
+	}
+	std::unique_ptr<Andersen> anders;
+	if (Lazy)
+		anders = Andersen::createLazily(*module, addressTakenFuncs, error);
+	else
+		anders.reset(new Andersen(*module));
+	if (!anders)
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+	anders->writeSolvedResults(*module, os);
+
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	outs() << "analyzed in " << format("%.3f", elapsed.count()) << "s, peak RSS " << getProcessPeakRSS() << " KB\n";
+	return 0;
+}
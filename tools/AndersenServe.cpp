@@ -0,0 +1,143 @@
+// andersen-serve - Keep the results of several modules loaded and answer queries about them over a local socket
+//
+// Each bitcode file is loaded with the results saved next to it in <file>.results (see -anders-write-results, andersen-persist and andersen-link -m), and both stay in memory as long as the server runs. The server listens on the Unix domain socket given with -socket. The requests and the replies are described in QueryServer.h. Each connection is served by a thread of its own, and may send any number of requests
+
+#include "QueryServer.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+static cl::list<std::string> InputFiles(cl::Positional, cl::desc("<bitcode files>"), cl::OneOrMore);
+static cl::opt<std::string> SocketPath("socket", cl::desc("The path of the Unix domain socket to listen on"), cl::value_desc("path"), cl::Required);
+
+// Read or write exactly size bytes. Return false once the connection is closed or broken
+static bool readAll(int fd, void* data, size_t size)
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0)
+	{
+		ssize_t n = read(fd, bytes, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+static bool writeAll(int fd, const void* data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		ssize_t n = write(fd, bytes, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		bytes += n;
+		size -= n;
+	}
+	return true;
+}
+
+// Answer the requests of a connection until the client closes it, or sends a message too long to be one
+static void serveConnection(const AndersQueryServer& server, int fd)
+{
+	std::vector<std::uint32_t> request, reply;
+	while (true)
+	{
+		std::uint32_t numWords;
+		if (!readAll(fd, &numWords, sizeof(numWords)) || numWords > QueryProtocol::MaxMessageWords)
+			break;
+		request.resize(numWords);
+		if (!readAll(fd, request.data(), numWords * sizeof(std::uint32_t)))
+			break;
+		server.handleRequest(request, reply);
+		std::uint32_t numReplyWords = reply.size();
+		if (!writeAll(fd, &numReplyWords, sizeof(numReplyWords)) || !writeAll(fd, reply.data(), numReplyWords * sizeof(std::uint32_t)))
+			break;
+	}
+	close(fd);
+}
+
+int main(int argc, char** argv)
+{
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen query server\n");
+
+	// The modules are only read once they are loaded, so they share a context
+	LLVMContext context;
+	AndersQueryServer server;
+	for (auto const& fileName: InputFiles)
+	{
+		SMDiagnostic err;
+		std::unique_ptr<Module> module = parseIRFile(fileName, err, context);
+		if (!module)
+		{
+			err.print(argv[0], errs());
+			return 1;
+		}
+		std::string error;
+		auto results = PersistedAndersResults::load(fileName + ".results", *module, error);
+		if (!results)
+		{
+			errs() << argv[0] << ": " << fileName << ".results: " << error << "\n";
+			return 1;
+		}
+		server.addModule(std::move(module), std::move(results));
+	}
+
+	sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (SocketPath.size() >= sizeof(addr.sun_path))
+	{
+		errs() << argv[0] << ": " << SocketPath << ": the path is too long for a socket\n";
+		return 1;
+	}
+	std::strcpy(addr.sun_path, SocketPath.c_str());
+	// A socket left behind by a server that is gone
+	unlink(SocketPath.c_str());
+	int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0 || bind(listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0)
+	{
+		errs() << argv[0] << ": " << SocketPath << ": " << std::strerror(errno) << "\n";
+		return 1;
+	}
+	// A client that goes away in the middle of a reply must not take the server down with it
+	std::signal(SIGPIPE, SIG_IGN);
+	outs() << "serving " << server.getNumModules() << " modules on " << SocketPath << "\n";
+	outs().flush();
+
+	while (true)
+	{
+		int fd = accept(listenFd, nullptr, nullptr);
+		if (fd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			errs() << argv[0] << ": " << std::strerror(errno) << "\n";
+			return 1;
+		}
+		std::thread([&server, fd] { serveConnection(server, fd); }).detach();
+	}
+}
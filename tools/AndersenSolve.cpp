@@ -0,0 +1,44 @@
+// andersen-solve - Optimize and solve a constraint file
+//
+// The constraints are the ones collected from a module and saved with -anders-write-constraints. No IR is parsed and no constraint is collected, so the time measured is the time of the optimizers and the solver alone. All the options of the analysis apply (-enable-hvn, -anders-worklist, -dump-result, -time-passes, -stats, ...)
+
+#include "Andersen.h"
+#include "ConstraintFile.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <chrono>
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<constraint file>"), cl::Required);
+
+int main(int argc, char** argv)
+{
+	// Print the -time-passes and -stats reports on the way out
+	llvm_shutdown_obj shutdown;
+	cl::ParseCommandLineOptions(argc, argv, "Andersen constraint solver\n");
+
+	std::string error;
+	auto reader = ConstraintFileReader::open(InputFile, error);
+	if (!reader)
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+	outs() << "nodes: " << reader->getNumNodes() << ", object nodes: " << reader->getObjectNodes().size() << ", constraints: " << reader->getNumConstraints() << "\n";
+
+	auto start = std::chrono::steady_clock::now();
+	auto anders = Andersen::createFromConstraints(*reader, error);
+	if (!anders)
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	outs() << "solved in " << format("%.3f", elapsed.count()) << "s\n";
+	return 0;
+}
@@ -0,0 +1,49 @@
+// andersen-summarize - Collect the constraints of one module of a program into a summary for andersen-link
+//
+// The summary only depends on the module, so the build can write the summaries of the modules in parallel and cache them by the content of the bitcode. Nothing is solved here
+
+#include "Andersen.h"
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+static cl::opt<std::string> InputFile(cl::Positional, cl::desc("<bitcode file>"), cl::Required);
+static cl::opt<std::string> OutputFile("o", cl::desc("The summary file to write"), cl::value_desc("file"), cl::Required);
+
+int main(int argc, char** argv)
+{
+	cl::ParseCommandLineOptions(argc, argv, "Andersen constraint summary of one module\n");
+
+	LLVMContext context;
+	SMDiagnostic err;
+	std::unique_ptr<Module> module = parseIRFile(InputFile, err, context);
+	if (!module)
+	{
+		err.print(argv[0], errs());
+		return 1;
+	}
+	std::string error;
+	auto summary = Andersen::summarize(*module, error);
+	if (!summary)
+	{
+		errs() << argv[0] << ": " << InputFile << ": " << error << "\n";
+		return 1;
+	}
+
+	std::error_code ec;
+	raw_fd_ostream os(OutputFile, ec, sys::fs::F_None);
+	if (ec)
+	{
+		errs() << argv[0] << ": " << OutputFile << ": " << ec.message() << "\n";
+		return 1;
+	}
+	summary->write(os);
+	return 0;
+}
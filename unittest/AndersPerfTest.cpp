@@ -0,0 +1,218 @@
+#include "Andersen.h"
+#include "ConstraintFile.h"
+#include "ConstraintGenerator.h"
+#include "NodeFactory.h"
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+// The performance tests put budgets on the work of the solver (see AndersSolverWork) and on the memory the analysis holds at its phase boundaries (see AndersMemoryUsage), which are the same on every machine where the time is not. Each budget is what the tree measured when it was set, plus 10% and rounded up to the next hundredth per constraint. The measurements are recorded as properties of the tests, so --gtest_output=xml shows them. A change that needs more fails here, and the budget is only raised once the reason is understood. The memory is counted from the sizes of the containers of the default points-to set policy on a 64-bit target
+// The synthetic constraint sets also come at several sizes, and the work may only grow 10% faster than the size does, so that an accidental quadratic step fails even when it is still cheap at the sizes of the budgets
+
+namespace {
+
+// A combination of the optimizations, as the command line would give it
+struct PerfConfig {
+    const char* name;
+    std::vector<const char*> options;
+};
+
+const PerfConfig PerfConfigs[] = {
+    {"plain", {}},
+    {"hvn-hu", {"enable-hvn", "enable-hu"}},
+    {"hcd-lcd", {"enable-hcd", "enable-lcd"}},
+    {"diff-prop", {"enable-diff-prop", "enable-lcd"}},
+    {"wave", {"enable-wave"}},
+};
+
+// Turn the options of a config on for as long as the object lives
+class ScopedConfig {
+    std::vector<cl::opt<bool>*> opts;
+
+public:
+    explicit ScopedConfig(const PerfConfig& config) {
+        auto& registered = cl::getRegisteredOptions();
+        for (auto name : config.options) {
+            auto opt = static_cast<cl::opt<bool>*>(registered[name]);
+            EXPECT_TRUE(opt != nullptr) << name;
+            if (opt == nullptr)
+                continue;
+            opt->setValue(true);
+            opts.push_back(opt);
+        }
+    }
+    ~ScopedConfig() {
+        for (auto opt : opts)
+            opt->setValue(false);
+    }
+};
+
+struct PerfMetrics {
+    AndersSolverWork work;
+    std::size_t peakBytes = 0;
+    // The constraints the input was made of, which the budgets are relative to
+    std::uint64_t numConstraints = 0;
+};
+
+void getMetrics(const Andersen& anders, PerfMetrics& metrics) {
+    metrics.work = anders.getSolverWork();
+    metrics.peakBytes = anders.getPeakMemoryUsage().getTotal();
+}
+
+// The progress callback sees the constraints at each phase boundary. The most it sees are the collected ones, before the optimizations take any away
+AndersRunOptions getPerfRunOptions(PerfMetrics& metrics) {
+    AndersRunOptions options;
+    options.trackPeakMemory = true;
+    options.onProgress = [&metrics] (const AndersProgress& progress) {
+        metrics.numConstraints = std::max<std::uint64_t>(metrics.numConstraints, progress.numConstraints);
+    };
+    return options;
+}
+
+// A synthetic constraint set of numNodes nodes and as many constraints, with a few hubs and indirect calls, repeated numCopies times over nodes of their own. The copies share nothing, so the points-to sets of numCopies copies are exactly numCopies times those of one, and so should the work be
+PerfMetrics solveSynthetic(unsigned numNodes, unsigned numCopies, const PerfConfig& config) {
+    SyntheticConstraintShape shape;
+    shape.numNodes = numNodes;
+    shape.numConstraints = numNodes;
+    shape.numHubs = numNodes / 1000;
+    shape.hubDegree = 8;
+    shape.numIndirectCalls = numNodes / 200;
+    shape.callFanOut = 4;
+    shape.numFunctions = numNodes / 100;
+    SyntheticConstraintGenerator generator(shape);
+    std::vector<AndersConstraint> constraints = generator.generate();
+
+    // The constraints never refer to the special nodes, which come first
+    unsigned numSpecialNodes = AndersNodeFactory().getNumNodes();
+    unsigned copySize = generator.getNumNodes() - numSpecialNodes;
+    std::vector<NodeIndex> objectNodes;
+    for (unsigned copy = 0; copy < numCopies; ++copy)
+        for (auto obj : generator.getObjectNodes())
+            if (obj >= numSpecialNodes || copy == 0)
+                objectNodes.push_back(obj < numSpecialNodes ? obj : obj + copy * copySize);
+
+    std::string file;
+    {
+        raw_string_ostream os(file);
+        ConstraintFileWriter writer(os, numSpecialNodes + numCopies * copySize, objectNodes);
+        for (unsigned copy = 0; copy < numCopies; ++copy)
+            for (auto const& c : constraints)
+                writer.write(AndersConstraint(c.getType(), c.getDest() + copy * copySize, c.getSrc() + copy * copySize));
+    }
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBuffer(file, "synthetic", false), error);
+    EXPECT_TRUE(reader != nullptr) << error;
+    if (reader == nullptr)
+        return PerfMetrics();
+
+    ScopedConfig scoped(config);
+    PerfMetrics ret;
+    auto anders = Andersen::createFromConstraints(*reader, error, getPerfRunOptions(ret));
+    EXPECT_TRUE(anders != nullptr) << error;
+    if (anders != nullptr)
+        getMetrics(*anders, ret);
+    return ret;
+}
+
+// Solve one of the modules checked in under unittest/perf
+PerfMetrics solveCheckedIn(const char* name, const PerfConfig& config) {
+    std::string fileName = std::string(ANDERSEN_PERF_INPUT_DIR) + "/" + name;
+    LLVMContext context;
+    SMDiagnostic diag;
+    std::unique_ptr<Module> module = parseAssemblyFile(fileName, diag, context);
+    EXPECT_TRUE(module != nullptr) << fileName << ": " << diag.getMessage().str();
+    if (module == nullptr)
+        return PerfMetrics();
+
+    ScopedConfig scoped(config);
+    PerfMetrics ret;
+    Andersen anders(*module, getPerfRunOptions(ret));
+    getMetrics(anders, ret);
+    return ret;
+}
+
+// The budget of one config, per constraint of the input
+struct WorkBudget {
+    const char* config;
+    double workListPops;
+    double unions;
+    double copyEdges;
+    double peakBytes;
+};
+
+void expectWithinBudget(const PerfMetrics& metrics, const WorkBudget& budget, const std::string& what) {
+    ::testing::Test::RecordProperty(what + ":constraints", std::to_string(metrics.numConstraints));
+    ::testing::Test::RecordProperty(what + ":worklist_pops", std::to_string(metrics.work.workListPops));
+    ::testing::Test::RecordProperty(what + ":unions", std::to_string(metrics.work.unions));
+    ::testing::Test::RecordProperty(what + ":copy_edges", std::to_string(metrics.work.copyEdges));
+    ::testing::Test::RecordProperty(what + ":peak_bytes", std::to_string(metrics.peakBytes));
+    EXPECT_GT(metrics.work.iterations, 0u) << what;
+    EXPECT_GT(metrics.numConstraints, 0u) << what;
+    double n = metrics.numConstraints;
+    EXPECT_LE(metrics.work.workListPops, budget.workListPops * n) << what;
+    EXPECT_LE(metrics.work.unions, budget.unions * n) << what;
+    EXPECT_LE(metrics.work.copyEdges, budget.copyEdges * n) << what;
+    EXPECT_LE(metrics.peakBytes, budget.peakBytes * n) << what;
+}
+
+const PerfConfig& getConfig(const char* name) {
+    for (auto const& config : PerfConfigs)
+        if (std::string(config.name) == name)
+            return config;
+    ADD_FAILURE() << "no config " << name;
+    return PerfConfigs[0];
+}
+
+} // namespace
+
+TEST(AndersPerfTest, SyntheticBudgetTest) {
+    // One copy of the synthetic set of 2000 nodes. The wave solver sweeps every node of the graph on each pass, so it pops the most
+    const WorkBudget budgets[] = {
+        {"plain", 1.61, 10.59, 1.90, 369.28},
+        {"hvn-hu", 1.13, 10.50, 2.06, 216.66},
+        {"hcd-lcd", 1.16, 3.31, 0.92, 344.33},
+        {"diff-prop", 0.87, 3.56, 0.91, 341.61},
+        {"wave", 5.25, 1.13, 1.13, 369.28},
+    };
+    for (auto const& budget : budgets)
+        expectWithinBudget(solveSynthetic(2000, 1, getConfig(budget.config)), budget, std::string("synthetic-2000:") + budget.config);
+}
+
+TEST(AndersPerfTest, SyntheticGrowthTest) {
+    // Four times the nodes and the constraints may take at most this many times the work and the memory. Linear growth is 4, quadratic 16, and every config measures 4 within 1%
+    const double maxGrowth = 4.4;
+    for (auto const& config : PerfConfigs) {
+        PerfMetrics small = solveSynthetic(2000, 2, config), large = solveSynthetic(2000, 8, config);
+        std::string what = config.name;
+        EXPECT_LE(large.work.workListPops, maxGrowth * small.work.workListPops) << what;
+        EXPECT_LE(large.work.unions, maxGrowth * small.work.unions) << what;
+        EXPECT_LE(large.work.copyEdges, maxGrowth * small.work.copyEdges) << what;
+        EXPECT_LE(large.peakBytes, maxGrowth * small.peakBytes) << what;
+    }
+}
+
+TEST(AndersPerfTest, CheckedInBudgetTest) {
+    // The module is small, so the fixed costs of the analysis (the special nodes, the empty containers) weigh more per constraint than on the synthetic sets
+    const WorkBudget budgets[] = {
+        {"plain", 1.47, 1.13, 0.48, 440.76},
+        {"hvn-hu", 0.46, 0.26, 0.22, 269.94},
+        {"hcd-lcd", 1.47, 1.13, 0.48, 451.89},
+        {"diff-prop", 1.13, 1.06, 0.48, 441.62},
+        {"wave", 3.26, 0.87, 0.48, 451.46},
+    };
+    for (auto const& budget : budgets)
+        expectWithinBudget(solveCheckedIn("linked_list.ll", getConfig(budget.config)), budget, std::string("linked_list:") + budget.config);
+}
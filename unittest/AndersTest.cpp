@@ -1,27 +1,123 @@
+#include "AliasMetadata.h"
+#include "AliasQueryCache.h"
+#include "Andersen.h"
+#include "AndersenAA.h"
+#include "Bdd.h"
+#include "CompactPtsGraph.h"
+#include "Constraint.h"
+#include "ConstraintFile.h"
+#include "ConstraintGraph.h"
+#include "ConstraintGenerator.h"
+#include "ConstraintSummary.h"
+#include "CycleDetector.h"
+#include "DenseSparseBitVectorGraph.h"
+#include "DistributedSolver.h"
+#include "EscapeInfo.h"
+#include "FlowSensitiveInfo.h"
+#include "FrozenResults.h"
+#include "LabelSetTable.h"
+#include "MemoryUsage.h"
 #include "NodeFactory.h"
+#include "OptimizeCache.h"
+#include "Parallel.h"
+#include "ParallelSCC.h"
+#include "PerfCounters.h"
+#include "PersistedResults.h"
+#include "PhaseTimer.h"
+#include "PooledSparseBitVector.h"
+#include "PtsGraph.h"
 #include "PtsSet.h"
+#include "PtsSetPool.h"
+#include "PtsSetSpill.h"
+#include "PtsSetView.h"
+#include "QueryServer.h"
+#include "ResultsExport.h"
 #include "SparseBitVectorGraph.h"
+#include "WorkList.h"
 
 #include "llvm/Analysis/CFG.h"
+#include "llvm/Analysis/CallGraph.h"
 #include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/InstIterator.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/Signals.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace llvm;
 
 namespace {
 
-TEST(AndersTest, PtsSetTest) {
+// A command line option of the analysis, looked up by name, that gets back the value it had before when the scope ends. The tests set it through -> as they would the option itself, and an ASSERT that returns early no longer leaves it set for the tests that follow
+template <typename T>
+class ScopedOption {
+private:
+    cl::opt<T>* option;
+    T saved;
+
+public:
+    explicit ScopedOption(const char* name)
+        : option(static_cast<cl::opt<T>*>(cl::getRegisteredOptions().lookup(name))) {
+        if (option == nullptr)
+            // A failure here means that the test itself is buggy.
+            report_fatal_error(Twine("No option named ") + name);
+        saved = option->getValue();
+    }
+    ~ScopedOption() { option->setValue(saved); }
+    ScopedOption(const ScopedOption&) = delete;
+    ScopedOption& operator=(const ScopedOption&) = delete;
+
+    cl::opt<T>* operator->() const { return option; }
+};
+
+// The death test style of gtest, set for as long as the object lives. Like ScopedOption, it gets back the style it had before when the scope ends, so that the death tests that follow don't inherit it
+class ScopedDeathTestStyle {
+private:
+    std::string saved;
+
+public:
+    explicit ScopedDeathTestStyle(const char* style) : saved(::testing::FLAGS_gtest_death_test_style) {
+        ::testing::FLAGS_gtest_death_test_style = style;
+    }
+    ~ScopedDeathTestStyle() { ::testing::FLAGS_gtest_death_test_style = saved; }
+    ScopedDeathTestStyle(const ScopedDeathTestStyle&) = delete;
+    ScopedDeathTestStyle& operator=(const ScopedDeathTestStyle&) = delete;
+};
+
+template <typename Policy>
+class PtsSetPolicyTest: public ::testing::Test {};
+
+typedef ::testing::Types<SparseBitVectorPtsSetPolicy, SmallVectorPtsSetPolicy, DenseBitVectorPtsSetPolicy, BlockBitVectorPtsSetPolicy, HybridPtsSetPolicy, RoaringPtsSetPolicy, SharedPtsSetPolicy, BddPtsSetPolicy> PtsSetPolicies;
+TYPED_TEST_CASE(PtsSetPolicyTest, PtsSetPolicies);
+
+TYPED_TEST(PtsSetPolicyTest, PtsSetTest) {
+    typedef BasicAndersPtsSet<TypeParam> AndersPtsSet;
+
     AndersPtsSet pSet1, pSet2;
     EXPECT_TRUE(pSet1.isEmpty());
     EXPECT_TRUE(pSet2.isEmpty());
@@ -42,6 +138,437 @@ TEST(AndersTest, PtsSetTest) {
     EXPECT_TRUE(pSet1.unionWith(pSet2));
     EXPECT_TRUE(pSet1.contains(pSet2));
     EXPECT_EQ(pSet1.getSize(), 3u);
+
+    AndersPtsSet delta;
+    delta.assignDifference(pSet1, pSet2);
+    EXPECT_EQ(delta.getSize(), 1u);
+    EXPECT_TRUE(delta.has(5));
+    delta.assignDifference(pSet2, pSet1);
+    EXPECT_TRUE(delta.isEmpty());
+
+    // Grow past the small-set threshold of the hybrid policy and come back
+    AndersPtsSet big, copy;
+    for (unsigned i = 100; i > 0; --i)
+        EXPECT_TRUE(big.insert(i * 3));
+    EXPECT_EQ(big.getSize(), 100u);
+    EXPECT_TRUE(copy.unionWith(big));
+    EXPECT_EQ(copy.getSize(), 100u);
+    // A union keeps the size without counting the set again, whether it adds a few elements to a large set or a large set to a small one
+    AndersPtsSet grown = big;
+    EXPECT_TRUE(grown.unionWith(pSet1));
+    EXPECT_EQ(grown.getSize(), 102u);
+    AndersPtsSet sub;
+    sub.insert(3);
+    sub.insert(300);
+    EXPECT_FALSE(copy.unionWith(sub));
+    EXPECT_TRUE(copy == big);
+    EXPECT_TRUE(big.intersectWith(pSet1));
+    EXPECT_FALSE(big.contains(pSet1));
+    // The const lookups don't go through SparseBitVector::test()
+    const AndersPtsSet& constBig = big;
+    EXPECT_TRUE(constBig.has(3));
+    EXPECT_TRUE(constBig.has(300));
+    EXPECT_FALSE(constBig.has(301));
+    EXPECT_TRUE(constBig.contains(sub));
+    EXPECT_TRUE(sub.intersectWith(constBig));
+    std::vector<unsigned> elems;
+    for (auto v: big)
+        elems.push_back(v);
+    EXPECT_EQ(elems.size(), 100u);
+    EXPECT_TRUE(std::is_sorted(elems.begin(), elems.end()));
+    delta.assignDifference(pSet1, big);
+    EXPECT_EQ(delta.getSize(), 2u);
+    EXPECT_TRUE(delta.has(5));
+    EXPECT_FALSE(delta.has(15));
+    delta.assignDifference(big, pSet1);
+    EXPECT_EQ(delta.getSize(), 99u);
+    EXPECT_FALSE(delta == big);
+    delta.clear();
+    EXPECT_TRUE(delta.isEmpty());
+    EXPECT_TRUE(delta == AndersPtsSet());
+
+    // The null object is kept apart from the elements, but the set operations see it
+    AndersPtsSet null1, null2;
+    EXPECT_TRUE(null1.insertNullObject());
+    EXPECT_FALSE(null1.insertNullObject());
+    EXPECT_TRUE(null1.hasNullObject());
+    EXPECT_FALSE(null1.isEmpty());
+    EXPECT_EQ(null1.getSize(), 1u);
+    EXPECT_TRUE(null1.begin() == null1.end());
+    EXPECT_FALSE(null2.contains(null1));
+    EXPECT_FALSE(null1 == null2);
+    EXPECT_TRUE(null2.unionWith(null1));
+    EXPECT_FALSE(null2.unionWith(null1));
+    EXPECT_TRUE(null2.intersectWith(null1));
+    EXPECT_TRUE(null2.insert(5));
+    EXPECT_TRUE(null2.contains(null1));
+    delta.assignDifference(null2, null1);
+    EXPECT_FALSE(delta.hasNullObject());
+    EXPECT_TRUE(delta.has(5));
+    delta.assignDifference(null2, pSet1);
+    EXPECT_TRUE(delta.hasNullObject());
+    EXPECT_FALSE(delta.has(5));
+    delta.clear();
+    EXPECT_FALSE(delta.hasNullObject());
+
+    // The summaries only ever reject: sets with overlapping ranges and signatures still get the right answer from the elements, and so do sets that differ in one element only
+    AndersPtsSet low, high, mixed;
+    for (unsigned i = 0; i < 64; ++i) {
+        low.insert(i);
+        high.insert(i + 1000);
+        mixed.insert(i % 2 == 0 ? i : i + 1000);
+    }
+    EXPECT_FALSE(low.intersectWith(high));
+    EXPECT_FALSE(low.contains(high));
+    EXPECT_TRUE(low.intersectWith(mixed));
+    EXPECT_FALSE(mixed.contains(low));
+    AndersPtsSet odd, even;
+    for (unsigned i = 0; i < 200; ++i)
+        (i % 2 == 0 ? even : odd).insert(i);
+    EXPECT_EQ(odd.getSize(), even.getSize());
+    EXPECT_FALSE(odd.intersectWith(even));
+    EXPECT_FALSE(odd == even);
+    AndersPtsSet almost = odd;
+    almost.insert(198);
+    EXPECT_FALSE(almost == odd);
+    EXPECT_TRUE(almost.contains(odd));
+    // The summary of a difference is taken again, and a union with an empty set changes nothing
+    delta.assignDifference(almost, odd);
+    EXPECT_TRUE(delta.has(198));
+    EXPECT_EQ(delta.getSize(), 1u);
+    EXPECT_TRUE(delta.intersectWith(even));
+    EXPECT_FALSE(delta.intersectWith(odd));
+    EXPECT_FALSE(delta.unionWith(AndersPtsSet()));
+    EXPECT_TRUE(delta.unionWith(odd));
+    EXPECT_EQ(delta.getSize(), 101u);
+    EXPECT_TRUE(delta == almost);
+}
+
+TEST(AndersTest, BlockBitVectorTest) {
+    const unsigned B = AndersBlockBitVector::BlockBits;
+
+    // Blocks 0, 3 and 130, with empty blocks and a whole empty summary word between them
+    AndersBlockBitVector v1, v2;
+    EXPECT_TRUE(v1.testAndSet(1));
+    EXPECT_TRUE(v1.testAndSet(3 * B + 63));
+    EXPECT_TRUE(v1.testAndSet(130 * B + B - 1));
+    EXPECT_FALSE(v1.testAndSet(3 * B + 63));
+    EXPECT_EQ(v1.count(), 3u);
+    EXPECT_EQ(v1.findNext(0), 1);
+    EXPECT_EQ(v1.findNext(2), int(3 * B + 63));
+    EXPECT_EQ(v1.findNext(3 * B + 64), int(130 * B + B - 1));
+    EXPECT_EQ(v1.findNext(130 * B + B), -1);
+
+    EXPECT_TRUE(v2.testAndSet(3 * B + 64));
+    EXPECT_FALSE(v1.intersects(v2));
+    EXPECT_FALSE(v1.contains(v2));
+    EXPECT_EQ(v2.unionWith(v1), 3u);
+    EXPECT_EQ(v2.unionWith(v1), 0u);
+    EXPECT_TRUE(v2.contains(v1));
+    EXPECT_TRUE(v1.intersects(v2));
+    EXPECT_EQ(v2.count(), 4u);
+
+    // Emptying a block clears its summary bit, and the shorter vector still compares equal
+    AndersBlockBitVector diff, small;
+    diff.assignDifference(v2, v1);
+    small.testAndSet(3 * B + 64);
+    EXPECT_TRUE(diff == small);
+    diff.assignDifference(v1, v2);
+    EXPECT_TRUE(diff.empty());
+    EXPECT_TRUE(diff == AndersBlockBitVector());
+    EXPECT_EQ(diff.findNext(0), -1);
+    EXPECT_FALSE(v1.contains(small));
+    EXPECT_EQ(small.unionWith(v1), 3u);
+    EXPECT_TRUE(small == v2);
+}
+
+TEST(AndersTest, RoaringBitmapTest) {
+    // A run in the first chunk and scattered elements in the third
+    AndersRoaringBitmap run, scattered;
+    for (unsigned i = 1000; i < 9000; ++i)
+        EXPECT_TRUE(run.testAndSet(i));
+    for (unsigned i = 0; i < 5000; ++i)
+        EXPECT_TRUE(scattered.testAndSet((2 << 16) + i * 7));
+    EXPECT_EQ(run.count(), 8000u);
+    EXPECT_EQ(scattered.count(), 5000u);
+    EXPECT_FALSE(run.intersects(scattered));
+
+    // The array container that overflowed into a bitmap becomes a run once a union re-encodes it, and compares equal to the bitmap it was
+    AndersRoaringBitmap merged;
+    EXPECT_TRUE(merged.testAndSet(999));
+    EXPECT_EQ(merged.unionWith(run), 8000u);
+    EXPECT_EQ(merged.unionWith(run), 0u);
+    EXPECT_TRUE(merged.testAndSet(9000));
+    EXPECT_TRUE(merged.contains(run));
+    EXPECT_FALSE(run.contains(merged));
+    EXPECT_EQ(merged.unionWith(scattered), 5000u);
+    EXPECT_EQ(merged.count(), 13002u);
+    EXPECT_TRUE(merged.test((2 << 16) + 7 * 4999));
+    EXPECT_FALSE(merged.test((2 << 16) + 1));
+    EXPECT_FALSE(merged.test(1 << 16));
+
+    // Cut holes into the run
+    AndersRoaringBitmap holes, diff;
+    for (unsigned i = 2000; i < 8000; i += 2)
+        holes.testAndSet(i);
+    diff.assignDifference(merged, holes);
+    EXPECT_EQ(diff.count(), 13002u - 3000u);
+    EXPECT_TRUE(diff.test(2001));
+    EXPECT_FALSE(diff.test(2002));
+    EXPECT_TRUE(diff.intersects(run));
+    EXPECT_FALSE(diff.intersects(holes));
+    EXPECT_TRUE(diff.testAndSet(2002));
+    EXPECT_FALSE(diff.testAndSet(2002));
+
+    std::vector<unsigned> elems;
+    for (auto v: merged)
+        elems.push_back(v);
+    EXPECT_EQ(elems.size(), 13002u);
+    EXPECT_TRUE(std::is_sorted(elems.begin(), elems.end()));
+    EXPECT_EQ(elems.front(), 999u);
+    EXPECT_EQ(elems.back(), (2u << 16) + 7 * 4999);
+
+    // Taking away everything drops the chunks
+    diff.assignDifference(run, merged);
+    EXPECT_TRUE(diff.empty());
+    EXPECT_TRUE(diff.begin() == diff.end());
+    EXPECT_TRUE(diff == AndersRoaringBitmap());
+}
+
+TEST(AndersTest, PtsSetPoolTest) {
+    AndersPtsSetPool pool;
+    AndersPtsSetPool::BitVec bits1, bits2, bits3;
+    bits1.set(1);
+    bits2.set(2);
+    bits3.set(1);
+
+    EXPECT_TRUE(pool.intern(AndersPtsSetPool::BitVec()) == nullptr);
+    auto e1 = pool.intern(std::move(bits1));
+    auto e2 = pool.intern(std::move(bits2));
+    auto e3 = pool.intern(std::move(bits3));
+    // Equal contents share one entry
+    EXPECT_EQ(e1, e3);
+    EXPECT_NE(e1, e2);
+    EXPECT_EQ(pool.getNumSets(), 2u);
+
+    auto u1 = pool.getUnion(e1, e2);
+    auto u2 = pool.getUnion(e2, e1);
+    EXPECT_EQ(u1, u2);
+    EXPECT_EQ(u1->getBits().count(), 2u);
+    EXPECT_EQ(pool.getUnion(u1, e1), u1);
+    EXPECT_EQ(pool.getNumSets(), 3u);
+
+    // Entries die with their last reference. A memo entry whose result is dead gets recomputed
+    for (unsigned i = 0; i < 3; ++i)
+        pool.release(u1);
+    EXPECT_EQ(pool.getNumSets(), 2u);
+    u1 = pool.getUnion(e1, e2);
+    EXPECT_EQ(u1->getBits().count(), 2u);
+    EXPECT_EQ(pool.getNumSets(), 3u);
+    pool.release(e2);
+    EXPECT_EQ(pool.getNumSets(), 2u);
+}
+
+TEST(AndersTest, BddTest) {
+    AndersBddManager manager;
+    auto s5 = manager.getSingleton(5);
+    auto s9 = manager.getSingleton(9);
+    auto sLarge = manager.getSingleton(0x80000001u);
+    EXPECT_EQ(manager.getSingleton(5), s5);
+    manager.deref(s5);
+
+    auto u1 = manager.getUnion(s9, s5);
+    auto u2 = manager.getUnion(u1, sLarge);
+    EXPECT_EQ(manager.count(u2), 3u);
+    EXPECT_TRUE(manager.has(u2, 5));
+    EXPECT_TRUE(manager.has(u2, 0x80000001u));
+    EXPECT_FALSE(manager.has(u2, 1));
+
+    // Elements are enumerated in increasing order
+    std::vector<unsigned> elems;
+    unsigned elem = 0;
+    for (unsigned lb = 0; manager.findFrom(u2, lb, elem); lb = elem + 1)
+        elems.push_back(elem);
+    EXPECT_EQ(elems, (std::vector<unsigned>{5, 9, 0x80000001u}));
+
+    auto diff = manager.getDifference(u2, u1);
+    EXPECT_EQ(diff, sLarge);
+    auto inter = manager.getIntersection(u2, s9);
+    EXPECT_EQ(inter, s9);
+    EXPECT_EQ(manager.count(AndersBddManager::False), 0u);
+
+    // Only the nodes reachable from live references survive a collection
+    for (auto n: {s5, s9, sLarge, u1, u2, diff, inter})
+        manager.deref(n);
+    manager.collectGarbage();
+    EXPECT_EQ(manager.getNumNodes(), 2u);
+}
+
+TEST(AndersTest, PtsGraphTest) {
+    AndersPtsGraph graph;
+    EXPECT_EQ(graph.getSize(), 0u);
+    EXPECT_TRUE(graph.find(3) == nullptr);
+    EXPECT_FALSE(graph.count(100));
+
+    EXPECT_TRUE(graph[3].insert(7));
+    EXPECT_TRUE(graph[1].insert(7));
+    // Touching a node gives it an (empty) set
+    EXPECT_TRUE(graph[5].isEmpty());
+    EXPECT_EQ(graph.getSize(), 3u);
+    ASSERT_TRUE(graph.find(3) != nullptr);
+    EXPECT_TRUE(graph.find(3)->has(7));
+    ASSERT_TRUE(graph.find(5) != nullptr);
+    EXPECT_FALSE(graph.count(2));
+
+    std::vector<NodeIndex> nodes(graph.begin(), graph.end());
+    ASSERT_EQ(nodes.size(), 3u);
+    EXPECT_EQ(nodes[0], 1u);
+    EXPECT_EQ(nodes[1], 3u);
+    EXPECT_EQ(nodes[2], 5u);
+
+    graph.erase(3);
+    EXPECT_FALSE(graph.count(3));
+    EXPECT_TRUE(graph[3].isEmpty());
+    EXPECT_EQ(graph.getSize(), 3u);
+
+    graph.resize(1000);
+    EXPECT_FALSE(graph.count(999));
+    EXPECT_EQ(graph.getSize(), 3u);
+}
+
+TEST(AndersTest, CompactPtsGraphTest) {
+    AndersNodeFactory factory;
+    std::vector<NodeIndex> nodes;
+    for (unsigned i = 0; i < 6; ++i)
+        nodes.push_back(factory.createValueNode());
+    factory.mergeNode(nodes[0], nodes[1]);
+    factory.mergeNode(nodes[1], nodes[2]);
+
+    AndersPtsGraph graph;
+    graph[nodes[0]].insert(9);
+    graph[nodes[0]].insert(5);
+    graph[nodes[3]].insert(5);
+    graph[nodes[4]];
+    graph[nodes[5]].insert(5);
+    factory.flattenMergeTargets();
+
+    CompactPtsGraph compact;
+    compact.build(graph, factory);
+    EXPECT_EQ(compact.getNumSets(), 3u);
+    // Equal sets share an id
+    EXPECT_EQ(compact.getSetId(nodes[3]), compact.getSetId(nodes[5]));
+    EXPECT_NE(compact.getSetId(nodes[0]), compact.getSetId(nodes[3]));
+    EXPECT_EQ(compact.getSetId(nodes[1]), compact.getSetId(nodes[0]));
+    CompactPtsSet set0(nullptr, nullptr), set2(nullptr, nullptr), set3(nullptr, nullptr), set4(nullptr, nullptr);
+    ASSERT_TRUE(compact.find(nodes[0], set0));
+    EXPECT_EQ(compact.getSet(compact.getSetId(nodes[0])).begin(), set0.begin());
+
+    // The merged nodes share the set of their representative
+    ASSERT_TRUE(compact.find(nodes[2], set2));
+    EXPECT_EQ(set2.begin(), set0.begin());
+    EXPECT_EQ(set2.end(), set0.end());
+    EXPECT_EQ(set0.getSize(), 2u);
+    EXPECT_TRUE(set0.has(5));
+    EXPECT_TRUE(set0.has(9));
+    EXPECT_FALSE(set0.has(7));
+    std::vector<NodeIndex> elems(set0.begin(), set0.end());
+    EXPECT_EQ(elems, (std::vector<NodeIndex>{5, 9}));
+    ASSERT_TRUE(compact.find(nodes[3], set3));
+    EXPECT_TRUE(set0.intersectWith(set3));
+    EXPECT_FALSE(set0.getElementsAfter(5).intersectWith(set3));
+    EXPECT_EQ(set0.getElementsAfter(5).getSize(), 1u);
+
+    // The sets are laid out back to back
+    EXPECT_EQ(compact.getSet(0).end(), compact.getSet(1).begin());
+    EXPECT_EQ(compact.getSet(1).end(), compact.getSet(2).begin());
+
+    ASSERT_TRUE(compact.find(nodes[4], set4));
+    EXPECT_TRUE(set4.isEmpty());
+    EXPECT_FALSE(set4.intersectWith(set0));
+    EXPECT_FALSE(compact.find(1000, set4));
+    EXPECT_EQ(compact.getSetId(1000), CompactPtsGraph::NoSlot);
+}
+
+TEST(AndersTest, AliasQueryCacheTest) {
+    bool answer;
+    AliasQueryCache disabled;
+    EXPECT_FALSE(disabled.isEnabled());
+    disabled.insert(1, 2, true);
+    EXPECT_FALSE(disabled.lookup(1, 2, answer));
+
+    AliasQueryCache cache(100);
+    EXPECT_TRUE(cache.isEnabled());
+    EXPECT_FALSE(cache.lookup(0, 1, answer));
+    cache.insert(0, 1, false);
+    cache.insert(7, 3, true);
+    // The pairs are unordered
+    ASSERT_TRUE(cache.lookup(1, 0, answer));
+    EXPECT_FALSE(answer);
+    ASSERT_TRUE(cache.lookup(3, 7, answer));
+    EXPECT_TRUE(answer);
+    EXPECT_FALSE(cache.lookup(3, 8, answer));
+
+    // The cache is bounded: filling it with many pairs evicts some of the old ones, but a lookup never returns the answer of another pair
+    for (unsigned i = 0; i < 1000; ++i)
+        cache.insert(i, i + 1, i % 2 == 0);
+    for (unsigned i = 0; i < 1000; ++i)
+        if (cache.lookup(i + 1, i, answer))
+            EXPECT_EQ(answer, i % 2 == 0);
+    EXPECT_FALSE(cache.lookup(2000, 2001, answer));
+}
+
+TEST(AndersTest, WorkListTest) {
+    AndersWorkListOrder fifoOrder(AndersWorkListPolicy::FIFO, 10);
+    AndersWorkList fifo(fifoOrder);
+    EXPECT_TRUE(fifo.isEmpty());
+    fifo.enqueue(5);
+    fifo.enqueue(2);
+    fifo.enqueue(5);
+    EXPECT_EQ(fifo.getSize(), 2u);
+    EXPECT_EQ(fifo.dequeue(), 5u);
+    EXPECT_EQ(fifo.dequeue(), 2u);
+    EXPECT_TRUE(fifo.isEmpty());
+
+    // Nodes with smaller priority come first, whatever the enqueue order
+    AndersWorkListOrder topoOrder(AndersWorkListPolicy::TOPO, 10);
+    topoOrder.setPriority(7, 0);
+    topoOrder.setPriority(3, 1);
+    topoOrder.setPriority(9, 2);
+    AndersWorkList topo(topoOrder);
+    topo.enqueue(9);
+    topo.enqueue(3);
+    topo.enqueue(7);
+    EXPECT_EQ(topo.dequeue(), 7u);
+    EXPECT_EQ(topo.dequeue(), 3u);
+    EXPECT_EQ(topo.dequeue(), 9u);
+
+    // Buckets are drained in priority order, each one in FIFO order
+    AndersWorkListOrder dividedOrder(AndersWorkListPolicy::DIVIDED, 1000);
+    dividedOrder.setPriority(1, 900);
+    dividedOrder.setPriority(2, 0);
+    dividedOrder.setPriority(3, 1);
+    AndersWorkList divided(dividedOrder);
+    divided.enqueue(1);
+    divided.enqueue(3);
+    divided.enqueue(2);
+    EXPECT_EQ(divided.dequeue(), 3u);
+    EXPECT_EQ(divided.dequeue(), 2u);
+    divided.enqueue(3);
+    EXPECT_EQ(divided.dequeue(), 3u);
+    EXPECT_EQ(divided.dequeue(), 1u);
+    EXPECT_TRUE(divided.isEmpty());
+
+    // The least recently fired node comes first
+    AndersWorkListOrder lrfOrder(AndersWorkListPolicy::LRF, 10);
+    lrfOrder.fire(4);
+    lrfOrder.fire(1);
+    AndersWorkList lrf(lrfOrder);
+    lrf.enqueue(1);
+    lrf.enqueue(4);
+    lrf.enqueue(6);
+    EXPECT_EQ(lrf.dequeue(), 6u);
+    EXPECT_EQ(lrf.dequeue(), 4u);
+    EXPECT_EQ(lrf.dequeue(), 1u);
 }
 
 TEST(AndersTest, SparseBitVectorGraphTest) {
@@ -95,6 +622,594 @@ TEST(AndersTest, SparseBitVectorGraphTest) {
     EXPECT_EQ(node3->succ_getSize(), 3u);
 }
 
+TEST(AndersTest, DenseSparseBitVectorGraphTest) {
+    DenseSparseBitVectorGraph graph(8);
+
+    auto node1 = graph.getOrInsertNode(1);
+    auto node3 = graph.getOrInsertNode(3);
+    EXPECT_EQ(graph.getSize(), 2u);
+    EXPECT_TRUE(graph.getNodeWithIndex(0) == nullptr);
+    EXPECT_TRUE(graph.getNodeWithIndex(8) == nullptr);
+    EXPECT_EQ(graph.getNodeWithIndex(1), node1);
+    EXPECT_EQ(graph.getNodeWithIndex(3), node3);
+    EXPECT_EQ(node3->getNodeIndex(), 3u);
+
+    // 1 -> 3 -> 5, 7 -> 1
+    graph.insertEdge(1, 3);
+    graph.insertEdge(3, 5);
+    graph.insertEdge(7, 1);
+    EXPECT_EQ(graph.getSize(), 3u);
+    EXPECT_TRUE(graph.getNodeWithIndex(5) == nullptr);
+    EXPECT_EQ(graph.getOrInsertNode(1), node1);
+
+    // Nodes are visited in increasing order of their indices
+    std::vector<NodeIndex> nodes;
+    for (auto const& node: graph)
+        nodes.push_back(node.getNodeIndex());
+    EXPECT_EQ(nodes, std::vector<NodeIndex>({1, 3, 7}));
+
+    graph.mergeEdge(1, 3);
+    EXPECT_EQ(node1->succ_getSize(), 2u);
+    graph.mergeEdge(3, 5);
+    EXPECT_EQ(node3->succ_getSize(), 1u);
+}
+
+// Record the sizes of the SCCs of a SparseBitVectorGraph
+class SCCRecorder: public CycleDetector<SCCRecorder, SparseBitVectorGraph> {
+    friend class CycleDetector<SCCRecorder, SparseBitVectorGraph>;
+
+    SparseBitVectorGraph& graph;
+    unsigned sccSize;
+
+    NodeType* getRep(NodeIndex idx) {
+        return graph.getOrInsertNode(idx);
+    }
+    void processNodeOnCycle(const NodeType*, const NodeType*) {
+        ++sccSize;
+    }
+    void processCycleRepNode(const NodeType*) {
+        sccSizes.push_back(sccSize + 1);
+        sccSize = 0;
+    }
+public:
+    std::vector<unsigned> sccSizes;
+
+    SCCRecorder(SparseBitVectorGraph& g): graph(g), sccSize(0) {}
+
+    void run() {
+        runOnGraph(&graph);
+        releaseSCCMemory();
+    }
+};
+
+TEST(AndersTest, CycleDetectorTest) {
+    // 1 -> 2 -> 3 -> 1, 3 -> 4 -> 5 -> 4
+    SparseBitVectorGraph graph;
+    graph.insertEdge(1, 2);
+    graph.insertEdge(2, 3);
+    graph.insertEdge(3, 1);
+    graph.insertEdge(3, 4);
+    graph.insertEdge(4, 5);
+    graph.insertEdge(5, 4);
+
+    SCCRecorder recorder(graph);
+    recorder.run();
+    std::sort(recorder.sccSizes.begin(), recorder.sccSizes.end());
+    ASSERT_EQ(recorder.sccSizes.size(), 2u);
+    EXPECT_EQ(recorder.sccSizes[0], 2u);
+    EXPECT_EQ(recorder.sccSizes[1], 3u);
+
+    // A chain far longer than the call stack could handle with one frame per node, closed into one big cycle
+    const unsigned chainLength = 200000;
+    SparseBitVectorGraph chain;
+    for (unsigned i = 0; i < chainLength; ++i)
+        chain.insertEdge(i, i + 1);
+    chain.insertEdge(chainLength, 0);
+
+    SCCRecorder chainRecorder(chain);
+    chainRecorder.run();
+    ASSERT_EQ(chainRecorder.sccSizes.size(), 1u);
+    EXPECT_EQ(chainRecorder.sccSizes[0], chainLength + 1);
+}
+
+TEST(AndersTest, ParallelSCCTest) {
+    // 1 -> 2 -> 3 -> 1, 3 -> 4 -> 5 -> 4, 0 -> 1 and 6 -> 6
+    SparseBitVectorGraph graph;
+    graph.insertEdge(0, 1);
+    graph.insertEdge(3, 1);
+    graph.insertEdge(2, 3);
+    graph.insertEdge(1, 2);
+    graph.insertEdge(3, 4);
+    graph.insertEdge(5, 4);
+    graph.insertEdge(4, 5);
+    graph.insertEdge(6, 6);
+
+    ParallelSCCFinder finder(graph, 8);
+    finder.run(4);
+    // Every component is named by its smallest node
+    const NodeIndex expected[] = {0, 1, 1, 1, 4, 4, 6, 7};
+    for (NodeIndex i = 0; i < 8; ++i)
+        EXPECT_EQ(finder.getRep(i), expected[i]);
+
+    // The same big cycle as CycleDetectorTest, entered from a chain that trimming has to peel off first
+    const unsigned chainLength = 200000;
+    SparseBitVectorGraph chain;
+    for (unsigned i = 0; i < chainLength; ++i)
+        chain.insertEdge(i, i + 1);
+    chain.insertEdge(chainLength, chainLength / 2);
+
+    ParallelSCCFinder chainFinder(chain, chainLength + 1);
+    chainFinder.run(4);
+    for (NodeIndex i = 0; i <= chainLength; ++i)
+        ASSERT_EQ(chainFinder.getRep(i), i < chainLength / 2 ? i : chainLength / 2);
+}
+
+TEST(AndersTest, ThreadPoolTest) {
+    // More tids than threads: every tid runs once, on at most as many threads as the pool has
+    AndersThreadPool pool(3);
+    EXPECT_EQ(pool.getNumThreads(), 3u);
+    std::mutex mutex;
+    std::vector<unsigned> counts(16, 0);
+    std::set<std::thread::id> threads;
+    auto count = [&](unsigned tid) {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++counts[tid];
+        threads.insert(std::this_thread::get_id());
+    };
+    pool.run(counts.size(), count);
+    EXPECT_EQ(counts, std::vector<unsigned>(counts.size(), 1));
+    EXPECT_LE(threads.size(), 3u);
+
+    // Within a scope, runOnThreads() goes through the pool, and so do the runs the tasks start
+    EXPECT_EQ(AndersThreadPool::getCurrent(), nullptr);
+    {
+        AndersThreadPool::Scope scope(&pool);
+        std::atomic<unsigned> total(0);
+        runOnThreads(4, [&total](unsigned) {
+            EXPECT_TRUE(AndersThreadPool::getCurrent() != nullptr);
+            runOnThreads(4, [&total](unsigned) { ++total; });
+        });
+        EXPECT_EQ(total.load(), 16u);
+    }
+    EXPECT_EQ(AndersThreadPool::getCurrent(), nullptr);
+}
+
+TEST(AndersTest, ConstraintGraphCanonicalizeTest) {
+    AndersNodeFactory factory;
+    std::vector<NodeIndex> nodes;
+    for (unsigned i = 0; i < 5; ++i)
+        nodes.push_back(factory.createValueNode());
+
+    ConstraintGraph graph;
+    graph.insertCopyEdge(nodes[0], nodes[1]);
+    graph.insertCopyEdge(nodes[0], nodes[2]);
+    graph.insertLoadEdge(nodes[0], nodes[3]);
+    graph.insertStoreEdge(nodes[0], nodes[4]);
+    ConstraintGraphNode* cNode = graph.getNodeWithIndex(nodes[0]);
+    // SparseBitVector's iterator is no standard iterator, so the targets are copied out by hand
+    auto targets = [](ConstraintGraphNode::const_iterator itr, ConstraintGraphNode::const_iterator end) {
+        std::vector<NodeIndex> ret;
+        for (; itr != end; ++itr)
+            ret.push_back(*itr);
+        return ret;
+    };
+    EXPECT_TRUE(cNode->markCopyEdgeChecked(nodes[1]));
+    EXPECT_FALSE(cNode->markCopyEdgeChecked(nodes[1]));
+    EXPECT_FALSE(graph.insertCopyEdge(nodes[0], nodes[1]));
+    EXPECT_EQ(cNode->getNumCopyEdges(), 2u);
+
+    factory.mergeNode(nodes[2], nodes[1]);
+    factory.mergeNode(nodes[4], nodes[3]);
+    cNode->canonicalizeEdges(factory);
+    EXPECT_EQ(targets(cNode->begin(), cNode->end()), (std::vector<NodeIndex>{nodes[2]}));
+    EXPECT_EQ(cNode->getNumCopyEdges(), 1u);
+    EXPECT_EQ(targets(cNode->load_begin(), cNode->load_end()), (std::vector<NodeIndex>{nodes[4]}));
+    EXPECT_EQ(targets(cNode->store_begin(), cNode->store_end()), (std::vector<NodeIndex>{nodes[4]}));
+    // The replaced edge is no longer marked as checked
+    EXPECT_TRUE(cNode->markCopyEdgeChecked(nodes[1]));
+
+    // An edge added after the last merge is still canonicalized
+    graph.insertCopyEdge(nodes[0], nodes[1]);
+    EXPECT_EQ(cNode->getNumCopyEdges(), 2u);
+    cNode->canonicalizeEdges(factory);
+    EXPECT_EQ(targets(cNode->begin(), cNode->end()), (std::vector<NodeIndex>{nodes[2]}));
+    EXPECT_EQ(cNode->getNumCopyEdges(), 1u);
+
+    // A merge counts the copy edges the two nodes have between them
+    graph.insertCopyEdge(nodes[3], nodes[2]);
+    graph.insertCopyEdge(nodes[3], nodes[0]);
+    factory.mergeNode(nodes[0], nodes[3]);
+    graph.mergeNodes(nodes[0], llvm::ArrayRef<NodeIndex>(nodes[3]));
+    EXPECT_EQ(cNode->getNumCopyEdges(), 2u);
+}
+
+TEST(AndersTest, ConstraintTest) {
+    AndersConstraint c(AndersConstraint::STORE, (1u << 31) - 1, 42);
+    EXPECT_EQ(c.getType(), AndersConstraint::STORE);
+    EXPECT_EQ(c.getDest(), (1u << 31) - 1);
+    EXPECT_EQ(c.getSrc(), 42u);
+    EXPECT_EQ(AndersConstraint::fromPackedKey(c.getPackedKey()), c);
+    EXPECT_EQ(sizeof(AndersConstraint), 8u);
+
+    // Both the short vector path and the radix sort path
+    for (unsigned n: { 100, 100000 }) {
+        std::vector<AndersConstraint> constraints;
+        std::vector<AndersConstraint> expected;
+        for (unsigned i = 0; i < n; ++i) {
+            auto type = static_cast<AndersConstraint::ConstraintType>(i % 4);
+            constraints.emplace_back(type, (i * 7919) % n, i % 13);
+            constraints.emplace_back(type, (i * 7919) % n, i % 13);
+            expected.emplace_back(type, (i * 7919) % n, i % 13);
+        }
+        std::sort(expected.begin(), expected.end());
+        expected.erase(std::unique(expected.begin(), expected.end()), expected.end());
+
+        uniquifyConstraints(constraints);
+        EXPECT_EQ(constraints, expected);
+    }
+}
+
+TEST(AndersTest, ConstraintFileTest) {
+    std::vector<NodeIndex> objectNodes = { 1, 3, 5 };
+    std::vector<AndersConstraint> constraints = {
+        AndersConstraint(AndersConstraint::ADDR_OF, 4, 5),
+        AndersConstraint(AndersConstraint::COPY, 6, 4),
+        AndersConstraint(AndersConstraint::STORE, 6, 2),
+    };
+
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, 7, objectNodes);
+    for (auto const& c: constraints)
+        writer.write(c);
+    os.flush();
+
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+    EXPECT_EQ(reader->getNumNodes(), 7u);
+    EXPECT_EQ(std::vector<NodeIndex>(reader->getObjectNodes().begin(), reader->getObjectNodes().end()), objectNodes);
+    ASSERT_EQ(reader->getNumConstraints(), constraints.size());
+    for (unsigned i = 0; i < constraints.size(); ++i)
+        EXPECT_EQ(reader->getConstraint(i), constraints[i]);
+
+    // A partial constraint and a foreign file are both rejected
+    EXPECT_TRUE(ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes.substr(0, bytes.size() - 1)), error) == nullptr);
+    EXPECT_TRUE(ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy("not a constraint file"), error) == nullptr);
+}
+
+TEST(AndersTest, ConstraintGeneratorTest) {
+    SyntheticConstraintShape shape;
+    shape.numNodes = 500;
+    shape.numConstraints = 2000;
+    shape.numHubs = 3;
+    shape.hubDegree = 10;
+    shape.numIndirectCalls = 20;
+    shape.callFanOut = 4;
+    shape.numFunctions = 8;
+
+    SyntheticConstraintGenerator generator(shape);
+    auto constraints = generator.generate();
+    EXPECT_EQ(constraints.size(), 2000u + 2 * 3 * 10 + 20 * 4 * 3);
+    // The same seed gives the same constraints
+    EXPECT_EQ(SyntheticConstraintGenerator(shape).generate(), constraints);
+
+    auto objectNodes = generator.getObjectNodes();
+    auto isObject = [&objectNodes] (NodeIndex n) { return std::binary_search(objectNodes.begin(), objectNodes.end(), n); };
+    for (auto const& c: constraints) {
+        ASSERT_LT(c.getDest(), generator.getNumNodes());
+        ASSERT_LT(c.getSrc(), generator.getNumNodes());
+        EXPECT_FALSE(isObject(c.getDest()));
+        EXPECT_EQ(isObject(c.getSrc()), c.getType() == AndersConstraint::ADDR_OF);
+    }
+
+    // The output solves like a collected constraint file, and a file of the same shape can be generated from it
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, generator.getNumNodes(), objectNodes);
+    for (auto const& c: constraints)
+        writer.write(c);
+    os.flush();
+
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+    EXPECT_TRUE(Andersen::createFromConstraints(*reader, error) != nullptr) << error;
+
+    auto like = SyntheticConstraintShape::like(*reader);
+    EXPECT_EQ(like.numNodes, shape.numNodes);
+    EXPECT_EQ(like.numConstraints, constraints.size());
+    EXPECT_EQ(SyntheticConstraintGenerator(like).getNumNodes(), generator.getNumNodes());
+}
+
+TEST(AndersTest, LocationEquivalenceTest) {
+    // The IR always gives each object a pointer of its own, so only a constraint file can have two objects whose addresses are taken by the same pointers: a and b are only ever put into p, which q copies. c is stored through p and loaded back into s. d is taken by t alone, and u copies t
+    enum: NodeIndex { a = 4, b, c, d, p, q, r, s, t, u, numNodes };
+    std::vector<NodeIndex> objectNodes = { 1, 3, a, b, c, d };
+    std::vector<AndersConstraint> constraints = {
+        AndersConstraint(AndersConstraint::ADDR_OF, p, a),
+        AndersConstraint(AndersConstraint::ADDR_OF, p, b),
+        AndersConstraint(AndersConstraint::COPY, q, p),
+        AndersConstraint(AndersConstraint::ADDR_OF, r, c),
+        AndersConstraint(AndersConstraint::STORE, p, r),
+        AndersConstraint(AndersConstraint::LOAD, s, q),
+        AndersConstraint(AndersConstraint::ADDR_OF, t, d),
+        AndersConstraint(AndersConstraint::COPY, u, t),
+    };
+
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, numNodes, objectNodes);
+    for (auto const& c: constraints)
+        writer.write(c);
+    os.flush();
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+
+    ScopedOption<bool> le("enable-le");
+    for (bool enabled: { false, true }) {
+        le->setValue(enabled);
+        std::shared_ptr<Andersen> anders = Andersen::createFromConstraints(*reader, error);
+        le->setValue(false);
+        ASSERT_TRUE(anders != nullptr) << error;
+
+        // a and b are merged into a, which stands for both of them in the sets
+        AndersPtsSetView view;
+        ASSERT_TRUE(anders->getPointsToSetViewOfNode(q, view));
+        EXPECT_EQ(view.getNodes().getSize(), enabled ? 1u : 2u);
+        EXPECT_TRUE(view.getNodes().has(a));
+        EXPECT_TRUE(view.hasNode(a));
+        EXPECT_TRUE(view.hasNode(b));
+        EXPECT_FALSE(view.hasNode(c));
+        ASSERT_TRUE(anders->getPointsToSetViewOfNode(s, view));
+        EXPECT_EQ(view.getNodes().getSize(), 1u);
+        EXPECT_TRUE(view.hasNode(c));
+
+        // A set that only holds a is no longer a single memory object, while one that only holds d still is
+        AndersFrozenResults frozen(anders);
+        EXPECT_EQ(frozen.aliasResolved(frozen.resolveNode(p), frozen.resolveNode(q)), MayAlias);
+        EXPECT_EQ(frozen.aliasResolved(frozen.resolveNode(t), frozen.resolveNode(u)), MustAlias);
+        EXPECT_EQ(frozen.aliasResolved(frozen.resolveNode(q), frozen.resolveNode(u)), NoAlias);
+    }
+}
+
+TEST(AndersTest, LocationEquivalenceInitializerTest) {
+    // a and b are like two globals whose addresses are only ever put into p, but a is initialized to point to x and b to y. They must not be merged, or the content of a would also point to y
+    enum: NodeIndex { a = 4, b, x, y, p, s, numNodes };
+    std::vector<NodeIndex> objectNodes = { 1, 3, a, b, x, y };
+    std::vector<AndersConstraint> constraints = {
+        AndersConstraint(AndersConstraint::ADDR_OF, a, x),
+        AndersConstraint(AndersConstraint::ADDR_OF, b, y),
+        AndersConstraint(AndersConstraint::ADDR_OF, p, a),
+        AndersConstraint(AndersConstraint::ADDR_OF, p, b),
+        AndersConstraint(AndersConstraint::LOAD, s, p),
+    };
+
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, numNodes, objectNodes);
+    for (auto const& c: constraints)
+        writer.write(c);
+    os.flush();
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+
+    ScopedOption<bool> le("enable-le");
+    le->setValue(true);
+    std::shared_ptr<Andersen> anders = Andersen::createFromConstraints(*reader, error);
+    ASSERT_TRUE(anders != nullptr) << error;
+
+    AndersPtsSetView view;
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(p, view));
+    EXPECT_EQ(view.getNodes().getSize(), 2u);
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(a, view));
+    EXPECT_TRUE(view.hasNode(x));
+    EXPECT_FALSE(view.hasNode(y));
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(b, view));
+    EXPECT_FALSE(view.hasNode(x));
+    EXPECT_TRUE(view.hasNode(y));
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(s, view));
+    EXPECT_TRUE(view.hasNode(x));
+    EXPECT_TRUE(view.hasNode(y));
+}
+
+TEST(AndersTest, DistributedSolverTest) {
+    // Cycles that cross the ranks, and ones within a rank that get collapsed
+    SyntheticConstraintShape shape;
+    shape.numNodes = 600;
+    shape.numConstraints = 2000;
+    shape.cycleDensity = 0.2;
+    shape.numHubs = 3;
+    shape.hubDegree = 10;
+    SyntheticConstraintGenerator generator(shape);
+    auto constraints = generator.generate();
+
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, generator.getNumNodes(), generator.getObjectNodes());
+    for (auto const& c: constraints)
+        writer.write(c);
+    os.flush();
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+
+    // The fixed point, the slow way
+    unsigned numNodes = generator.getNumNodes();
+    std::vector<std::set<NodeIndex>> expected(numNodes);
+    for (bool changed = true; changed; ) {
+        changed = false;
+        auto addAll = [&expected, &changed] (NodeIndex dst, NodeIndex src) {
+            for (auto obj: std::vector<NodeIndex>(expected[src].begin(), expected[src].end()))
+                changed |= expected[dst].insert(obj).second;
+        };
+        for (auto const& c: constraints) {
+            NodeIndex dst = c.getDest(), src = c.getSrc();
+            switch (c.getType()) {
+                case AndersConstraint::ADDR_OF:
+                    changed |= expected[dst].insert(src).second;
+                    break;
+                case AndersConstraint::COPY:
+                    addAll(dst, src);
+                    break;
+                case AndersConstraint::LOAD:
+                    for (auto obj: std::vector<NodeIndex>(expected[src].begin(), expected[src].end()))
+                        addAll(dst, obj);
+                    break;
+                case AndersConstraint::STORE:
+                    for (auto obj: std::vector<NodeIndex>(expected[dst].begin(), expected[dst].end()))
+                        addAll(obj, src);
+                    break;
+            }
+        }
+    }
+
+    for (unsigned numRanks: {1u, 3u, 8u}) {
+        auto transports = AndersInProcessTransport::create(numRanks);
+        std::vector<std::unique_ptr<DistributedAndersSolver>> solvers(numRanks);
+        std::vector<std::string> errors(numRanks);
+        std::vector<std::thread> threads;
+        for (unsigned rank = 0; rank < numRanks; ++rank) {
+            threads.emplace_back([&, rank] {
+                solvers[rank] = DistributedAndersSolver::create(*reader, *transports[rank], errors[rank]);
+                if (solvers[rank] != nullptr && !solvers[rank]->solve(errors[rank]))
+                    solvers[rank].reset();
+            });
+        }
+        for (auto& thread: threads)
+            thread.join();
+
+        // The ranks cover the nodes, and each has the sets of its own
+        NodeIndex next = 0;
+        for (unsigned rank = 0; rank < numRanks; ++rank) {
+            ASSERT_TRUE(solvers[rank] != nullptr) << errors[rank];
+            auto const& solver = *solvers[rank];
+            EXPECT_EQ(solver.getFirstNode(), next);
+            next = solver.getLastNode();
+            for (NodeIndex n = solver.getFirstNode(); n < solver.getLastNode(); ++n) {
+                auto const& ptsSet = solver.getPointsToSet(n);
+                std::set<NodeIndex> actual;
+                for (auto obj: ptsSet)
+                    actual.insert(obj);
+                if (ptsSet.hasNullObject())
+                    actual.insert(NodeIndex(AndersNodeFactory::NullObjectIndex));
+                EXPECT_EQ(actual, expected[n]) << "node " << n << " with " << numRanks << " ranks";
+            }
+            if (numRanks > 1)
+                EXPECT_GT(solver.getStats().wordsSent, 0u);
+            EXPECT_EQ(solver.getStats().rounds, solvers[0]->getStats().rounds);
+        }
+        EXPECT_EQ(next, numNodes);
+        if (numRanks == 1)
+            EXPECT_GT(solvers[0]->getStats().merges, 0u);
+    }
+}
+
+TEST(AndersTest, PooledSparseBitVectorTest) {
+    SparseBitVectorArena arena, other;
+    {
+        PooledSparseBitVector v1(arena), v2(arena);
+        // Out of order, across elements, and back before the cursor
+        for (unsigned i: { 1000, 5, 300, 129, 7, 1000 })
+            v1.set(i);
+        EXPECT_EQ(v1.count(), 5u);
+        EXPECT_TRUE(v1.test(129));
+        EXPECT_FALSE(v1.test(128));
+        EXPECT_FALSE(v1.test_and_set(300));
+        EXPECT_TRUE(v1.test_and_set(301));
+        std::vector<unsigned> elems(v1.begin(), v1.end());
+        EXPECT_EQ(elems, std::vector<unsigned>({ 5, 7, 129, 300, 301, 1000 }));
+
+        v2.set(7);
+        v2.set(2000);
+        EXPECT_TRUE(v2 |= v1);
+        EXPECT_FALSE(v2 |= v1);
+        EXPECT_EQ(v2.count(), 7u);
+        EXPECT_FALSE(v1 == v2);
+        EXPECT_EQ(arena.getNumLiveElements(), 4u + 5u);
+
+        // A copy assigned into a vector of another arena takes its elements from there
+        PooledSparseBitVector v3(other);
+        v3 = v2;
+        EXPECT_TRUE(v3 == v2);
+        EXPECT_EQ(other.getNumLiveElements(), 5u);
+        PooledSparseBitVector v4(std::move(v3));
+        EXPECT_TRUE(v3.empty());
+        EXPECT_TRUE(v4 == v2);
+    }
+    // The elements are recycled, and reset() drops the slabs
+    EXPECT_EQ(arena.getNumLiveElements(), 0u);
+    unsigned numSlabs = arena.getNumSlabs();
+    EXPECT_GT(numSlabs, 0u);
+    {
+        PooledSparseBitVector v(arena);
+        for (unsigned i = 0; i < 9; ++i)
+            v.set(i * 128);
+        EXPECT_EQ(arena.getNumSlabs(), numSlabs);
+    }
+    arena.reset();
+    other.reset();
+    EXPECT_EQ(arena.getNumSlabs(), 0u);
+}
+
+TEST(AndersTest, LabelSetTableTest) {
+    SparseBitVectorArena arena;
+    PooledSparseBitVector s0(arena), s1(arena), s2(arena);
+    SetFingerprint f0, f1;
+    s0.set(0);
+    f0.add(0);
+    for (unsigned i: { 3, 1, 2 }) {
+        s1.set(i);
+        f1.add(i);
+    }
+    s2.set(2);
+    s2.set(3);
+    s2.set(1);
+
+    // The fingerprint does not depend on the insertion order, and {1, 2, 3} does not collide with {0}
+    EXPECT_EQ(f1, SetFingerprint::of(s1));
+    EXPECT_EQ(SetFingerprint::of(s1), SetFingerprint::of(s2));
+    EXPECT_NE(f0, f1);
+
+    LabelSetTable table;
+    EXPECT_EQ(table.getOrInsert(s0, f0, 7), 7u);
+    EXPECT_EQ(table.getOrInsert(s1, f1, 8), 8u);
+    EXPECT_EQ(table.getOrInsert(s2, SetFingerprint::of(s2), 9), 8u);
+    EXPECT_EQ(table.getSize(), 2u);
+
+    // Sets whose fingerprints collide are still told apart
+    EXPECT_EQ(table.getOrInsert(s2, f0, 10), 10u);
+    EXPECT_EQ(table.getOrInsert(s0, f0, 11), 7u);
+    EXPECT_EQ(table.getOrInsert(s2, f0, 12), 10u);
+    EXPECT_EQ(table.lookup(s1, f1), 8u);
+    EXPECT_EQ(table.lookup(s1, SetFingerprint()), static_cast<unsigned>(LabelSetTable::NoLabel));
+
+    // Threads interning the same sets agree on their labels, and the counter only moves for new sets
+    SparseBitVectorArena concurrentArena;
+    concurrentArena.setConcurrent(true);
+    ConcurrentLabelSetTable concurrentTable(4);
+    std::atomic<unsigned> nextLabel(1);
+    std::vector<std::vector<unsigned>> labels(4);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t) {
+        threads.emplace_back([&concurrentArena, &concurrentTable, &nextLabel, &labels, t] {
+            for (unsigned i = 0; i < 100; ++i) {
+                PooledSparseBitVector set(concurrentArena);
+                set.set(i);
+                set.set(i + 1000);
+                labels[t].push_back(concurrentTable.getOrInsert(set, SetFingerprint::of(set), nextLabel));
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(101u, nextLabel.load());
+    for (unsigned t = 1; t < 4; ++t)
+        EXPECT_EQ(labels[0], labels[t]);
+}
+
 TEST(AndersTest, NodeMergeTest) {
     AndersNodeFactory factory;
 
@@ -115,6 +1230,59 @@ TEST(AndersTest, NodeMergeTest) {
     factory.mergeNode(n2, n4);
     EXPECT_EQ(factory.getMergeTarget(n1), factory.getMergeTarget(n2));
     EXPECT_EQ(factory.getMergeTarget(n3), factory.getMergeTarget(n4));
+
+    // The first argument of mergeNode() stays the representative, however long the chain gets
+    std::vector<NodeIndex> chain;
+    for (unsigned i = 0; i < 10; ++i)
+        chain.push_back(factory.createObjectNode());
+    for (unsigned i = 1; i < chain.size(); ++i)
+        factory.mergeNode(chain[i], chain[i - 1]);
+    const AndersNodeFactory& constFactory = factory;
+    EXPECT_EQ(constFactory.getMergeTarget(chain.front()), chain.back());
+    EXPECT_EQ(factory.getMergeTarget(chain.front()), chain.back());
+    EXPECT_EQ(factory.getMergeTarget(chain[5]), chain.back());
+    EXPECT_TRUE(factory.isObjectNode(chain[5]));
+    EXPECT_FALSE(factory.isObjectNode(n0));
+}
+
+TEST(AndersTest, ConcurrentNodeMergeTest) {
+    AndersNodeFactory factory;
+    const unsigned numNodes = 1000;
+    std::vector<NodeIndex> nodes;
+    for (unsigned i = 0; i < numNodes; ++i)
+        nodes.push_back(factory.createValueNode());
+
+    // A merge done before concurrent merging starts is kept
+    factory.mergeNode(nodes[10], nodes[0]);
+    // All the nodes have the same type class but one
+    std::vector<unsigned> classes(factory.getNumNodes(), 1);
+    classes[nodes[702]] = 2;
+    factory.setTypeClasses(classes);
+
+    // Four threads merge the nodes into classes by their index modulo 7, each taking the pairs in a different order
+    factory.beginConcurrentMerge();
+    std::vector<std::thread> threads;
+    for (unsigned tid = 0; tid < 4; ++tid)
+    {
+        threads.emplace_back([&factory, &nodes, tid] {
+            for (unsigned k = 0; k < numNodes - 7; ++k)
+            {
+                unsigned i = (k * (2 * tid + 1)) % (numNodes - 7);
+                factory.concurrentMergeNode(nodes[i], nodes[i + 7]);
+                factory.concurrentGetMergeTarget(nodes[(i * 13) % numNodes]);
+            }
+        });
+    }
+    for (auto& t: threads)
+        t.join();
+    factory.endConcurrentMerge();
+
+    // The earlier merge joined the classes of 0 and 3. The representatives are the smallest roots, whatever the thread interleaving
+    for (unsigned i = 0; i < numNodes; ++i)
+        EXPECT_EQ(factory.getMergeTarget(nodes[i]), nodes[i % 7 == 0 ? 3 : i % 7]);
+    // As with mergeNode(), only the representative of the class that has the odd node out loses its type class
+    EXPECT_EQ(factory.getTypeClass(nodes[1]), 1u);
+    EXPECT_EQ(factory.getTypeClass(nodes[2]), AndersNodeFactory::NoTypeClass);
 }
 
 // This fixture assists in setting up the pass environments
@@ -139,6 +1307,27 @@ protected:
 
         return module.get();
     }
+
+    // The instruction named name in function func of the parsed module, or else the global value named name
+    const Value* getValue(const char* name, const char* func = "main") const {
+        for (auto& inst : instructions(*module->getFunction(func)))
+            if (inst.getName() == name)
+                return &inst;
+        return module->getNamedValue(name);
+    }
+
+    // The points-to set of the value named name, sorted so that it compares equal to a sorted() list of the same values
+    std::vector<const Value*> getSortedPtsSet(const Andersen& anders, const char* name) const {
+        std::vector<const Value*> ptsSet;
+        EXPECT_TRUE(anders.getPointsToSet(getValue(name), ptsSet));
+        std::sort(ptsSet.begin(), ptsSet.end());
+        return ptsSet;
+    }
+
+    static std::vector<const Value*> sorted(std::vector<const Value*> values) {
+        std::sort(values.begin(), values.end());
+        return values;
+    }
 };
 
 TEST_F(AndersPassTest, NodeFactoryTest) {
@@ -177,4 +1366,3803 @@ TEST_F(AndersPassTest, NodeFactoryTest) {
     EXPECT_EQ(factory.getObjectNodeFor(w), ow);
 }
 
-} // end of anonymous namespace
+TEST_F(AndersPassTest, NodeRenumberTest) {
+    auto module = ParseAssembly("define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  ret i32* %x\n"
+                                "}\n");
+
+    auto f = &*module->begin();
+    auto itr = f->begin()->begin();
+    auto x = &*itr;
+    auto y = &*++itr;
+
+    AndersNodeFactory factory;
+    auto vx = factory.createValueNode(x);
+    auto ox = factory.createObjectNode(x);
+    auto tmp = factory.createValueNode();
+    auto ret = factory.createReturnNode(f);
+    auto oy = factory.createObjectNode(y);
+    EXPECT_EQ(factory.getValueNodeFor(x), vx);
+
+    auto newIndices = factory.packObjectNodes();
+    // The special nodes stay, then come the objects and then the values, each in creation order
+    EXPECT_EQ(newIndices[factory.getNullObjectNode()], factory.getNullObjectNode());
+    EXPECT_EQ(newIndices[ox], 4u);
+    EXPECT_EQ(newIndices[oy], 5u);
+    EXPECT_EQ(newIndices[vx], 6u);
+    EXPECT_EQ(newIndices[tmp], 7u);
+    EXPECT_EQ(newIndices[ret], 8u);
+
+    EXPECT_EQ(factory.getObjectNodeFor(x), 4u);
+    EXPECT_EQ(factory.getObjectNodeFor(y), 5u);
+    EXPECT_EQ(factory.getValueNodeFor(x), 6u);
+    EXPECT_EQ(factory.getReturnNodeFor(f), 8u);
+    EXPECT_EQ(factory.getValueForNode(5), y);
+    EXPECT_TRUE(factory.getValueForNode(7) == nullptr);
+    EXPECT_TRUE(factory.isObjectNode(4));
+    EXPECT_TRUE(factory.isObjectNode(5));
+    EXPECT_FALSE(factory.isObjectNode(6));
+    EXPECT_EQ(factory.getNumNodes(), 9u);
+}
+
+TEST_F(AndersPassTest, PtsSetViewTest) {
+    auto module = ParseAssembly("define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %z = alloca i32, align 4\n"
+                                "  ret void\n"
+                                "}\n");
+
+    auto itr = module->begin()->begin()->begin();
+    auto x = &*itr;
+    auto y = &*++itr;
+    auto z = &*++itr;
+
+    AndersNodeFactory factory;
+    auto p = factory.createValueNode();
+    auto ox = factory.createObjectNode(x);
+    auto anon = factory.createObjectNode();
+    auto oy = factory.createObjectNode(y);
+    auto oz = factory.createObjectNode(z);
+    // z is location equivalent to x
+    DenseMap<NodeIndex, std::vector<NodeIndex>> locationClasses;
+    factory.mergeNode(ox, oz);
+    locationClasses[ox].push_back(oz);
+
+    AndersPtsGraph graph;
+    graph[p].insertNullObject();
+    graph[p].insert(ox);
+    graph[p].insert(anon);
+    graph[p].insert(oy);
+    factory.flattenMergeTargets();
+    CompactPtsGraph compact;
+    compact.build(graph, factory);
+
+    CompactPtsSet set(nullptr, nullptr);
+    ASSERT_TRUE(compact.find(p, set));
+    AndersPtsSetView view(factory, locationClasses, set);
+    EXPECT_TRUE(view.hasNullObject());
+    EXPECT_FALSE(view.hasUniversalObject());
+    EXPECT_FALSE(view.isEmpty());
+    EXPECT_EQ(view.getNodes().getSize(), 3u);
+    EXPECT_TRUE(view.hasNode(anon));
+    EXPECT_TRUE(view.hasValue(z));
+    EXPECT_TRUE(view.hasValue(y));
+    EXPECT_FALSE(view.hasNode(p));
+
+    // The class members follow their representative, and the object without a value is skipped
+    std::vector<const Value*> vals(view.begin(), view.end());
+    EXPECT_EQ(vals, (std::vector<const Value*>{x, z, y}));
+    EXPECT_EQ(view.getNumValues(), 3u);
+
+    AndersPtsSetView empty(factory, locationClasses, CompactPtsSet(nullptr, nullptr));
+    EXPECT_TRUE(empty.isEmpty());
+    EXPECT_TRUE(empty.begin() == empty.end());
+    EXPECT_FALSE(empty.hasValue(x));
+}
+
+TEST_F(AndersPassTest, PersistedResultsTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %p = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  store i32* %y, i32** %p\n"
+                                "  store i32* %x, i32** @g\n"
+                                "  %q = load i32*, i32** %p\n"
+                                "  %r = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+
+    Andersen anders(*module);
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    anders.writeSolvedResults(*module, os);
+    os.flush();
+
+    std::string error;
+    auto results = PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(bytes), *module, error);
+    ASSERT_TRUE(results != nullptr) << error;
+
+    std::vector<const Value*> pointers;
+    for (auto const& g : module->globals())
+        pointers.push_back(&g);
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+    pointers.push_back(ConstantPointerNull::get(Type::getInt32PtrTy(module->getContext())));
+
+    for (auto p : pointers) {
+        std::vector<const Value*> expected, actual;
+        bool known = anders.getPointsToSet(p, expected);
+        EXPECT_EQ(results->getPointsToSet(p, actual), known);
+        EXPECT_EQ(actual, expected);
+    }
+
+    auto findInst = [&pointers](StringRef name) {
+        return *std::find_if(pointers.begin(), pointers.end(), [name](const Value* v) { return v->getName() == name; });
+    };
+    auto q = findInst("q"), r = findInst("r"), x = findInst("x"), y = findInst("y");
+    EXPECT_EQ(results->alias(q, r), MayAlias);
+    EXPECT_EQ(results->alias(x, y), NoAlias);
+    EXPECT_EQ(results->alias(x, x), MustAlias);
+
+    // A file is only good for the module it was written for
+    auto other = ParseAssembly("define void @main() {\n"
+                               "bb:\n"
+                               "  ret void\n"
+                               "}\n");
+    EXPECT_TRUE(PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(bytes), *other, error) == nullptr);
+    EXPECT_TRUE(PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy("garbage"), *other, error) == nullptr);
+}
+
+// Keeps the records of an export, to compare them with the queries and with each other
+struct RecordingResultsSink : public AndersResultsSink {
+    unsigned numValues = 0;
+    std::vector<std::vector<std::uint32_t>> sets;
+    std::vector<bool> universal;
+    std::vector<std::pair<unsigned, unsigned>> valueSets;
+
+    void begin(unsigned n, unsigned numSets) override {
+        numValues = n;
+        sets.clear();
+        universal.clear();
+        valueSets.clear();
+    }
+    void writeSet(unsigned setId, bool isUniversal, bool nullObject, ArrayRef<std::uint32_t> objs) override {
+        EXPECT_EQ(setId, sets.size());
+        sets.emplace_back(objs.begin(), objs.end());
+        universal.push_back(isUniversal);
+    }
+    void writeValue(unsigned valueId, const Value* v, unsigned setId) override { valueSets.emplace_back(valueId, setId); }
+};
+
+TEST_F(AndersPassTest, ExportResultsTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %p = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  store i32* %y, i32** %p\n"
+                                "  store i32* %x, i32** @g\n"
+                                "  %q = load i32*, i32** %p\n"
+                                "  %r = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+
+    Andersen anders(*module);
+    RecordingResultsSink direct;
+    anders.exportResults(*module, direct);
+
+    std::vector<const Value*> values;
+    PersistedResultsFormat::enumerateValues(*module, values);
+    EXPECT_EQ(direct.numValues, values.size());
+    EXPECT_FALSE(direct.valueSets.empty());
+    for (auto const& valueSet : direct.valueSets) {
+        std::vector<const Value*> expected;
+        bool known = anders.getPointsToSet(values[valueSet.first], expected);
+        std::set<unsigned> expectedIds;
+        for (auto v : expected)
+            expectedIds.insert(std::find(values.begin(), values.end(), v) - values.begin());
+        if (valueSet.second == AndersResultsSink::EmptySet) {
+            EXPECT_TRUE(known && expected.empty());
+            continue;
+        }
+        EXPECT_EQ(!direct.universal[valueSet.second], known);
+        if (known)
+            EXPECT_EQ(std::set<unsigned>(direct.sets[valueSet.second].begin(), direct.sets[valueSet.second].end()), expectedIds);
+    }
+
+    // The binary file gives back the same records
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    {
+        AndersBinaryResultsWriter writer(os);
+        anders.exportResults(*module, writer);
+    }
+    os.flush();
+    RecordingResultsSink read;
+    std::string error;
+    ASSERT_TRUE(readExportedResults(MemoryBuffer::getMemBufferCopy(bytes), read, error)) << error;
+    EXPECT_EQ(read.numValues, direct.numValues);
+    EXPECT_EQ(read.sets, direct.sets);
+    EXPECT_EQ(read.universal, direct.universal);
+    EXPECT_EQ(read.valueSets, direct.valueSets);
+    EXPECT_FALSE(readExportedResults(MemoryBuffer::getMemBufferCopy(bytes.substr(0, bytes.size() - 4)), read, error));
+    EXPECT_FALSE(readExportedResults(MemoryBuffer::getMemBufferCopy("garbage!"), read, error));
+
+    std::string text;
+    raw_string_ostream textOs(text);
+    {
+        AndersTextResultsWriter writer(textOs);
+        anders.exportResults(*module, writer);
+    }
+    textOs.flush();
+    unsigned qId = std::find_if(values.begin(), values.end(), [](const Value* v) { return v->getName() == "q"; }) - values.begin();
+    EXPECT_NE(text.find("value " + std::to_string(qId) + " q: "), std::string::npos);
+}
+
+TEST_F(AndersPassTest, QueryServerTest) {
+    const char* source = "@g = global i32* null\n"
+                         "@fp = global void ()* null\n"
+                         "define void @f() {\n"
+                         "bb:\n"
+                         "  ret void\n"
+                         "}\n"
+                         "define void @main() {\n"
+                         "bb:\n"
+                         "  %x = alloca i32, align 4\n"
+                         "  %y = alloca i32, align 4\n"
+                         "  store i32* %x, i32** @g\n"
+                         "  store void ()* @f, void ()** @fp\n"
+                         "  %p = load i32*, i32** @g\n"
+                         "  %h = load void ()*, void ()** @fp\n"
+                         "  call void %h()\n"
+                         "  call void @f()\n"
+                         "  ret void\n"
+                         "}\n";
+    // The server owns its modules, so it gets a copy of its own
+    LLVMContext serverCtx;
+    SMDiagnostic err;
+    auto served = parseAssemblyString(source, err, serverCtx);
+    ASSERT_TRUE(served != nullptr);
+    auto module = served.get();
+
+    Andersen anders(*module);
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    anders.writeSolvedResults(*module, os);
+    os.flush();
+    std::string error;
+    auto results = PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(bytes), *module, error);
+    ASSERT_TRUE(results != nullptr) << error;
+    auto resultsPtr = results.get();
+    auto id = [resultsPtr](const Value* v) { return resultsPtr->getValueId(v); };
+
+    AndersQueryServer server;
+    EXPECT_EQ(server.addModule(std::move(served), std::move(results)), 0u);
+
+    auto ask = [&server](std::vector<std::uint32_t> request) {
+        std::vector<std::uint32_t> reply;
+        server.handleRequest(request, reply);
+        return reply;
+    };
+    auto name = [](StringRef s, std::vector<std::uint32_t>& request) {
+        request.push_back(s.size());
+        std::vector<std::uint32_t> words((s.size() + 3) / 4, 0);
+        std::memcpy(words.data(), s.data(), s.size());
+        request.insert(request.end(), words.begin(), words.end());
+    };
+
+    auto getInst = [module](StringRef s) {
+        for (auto& inst : instructions(*module->getFunction("main")))
+            if (inst.getName() == s)
+                return &inst;
+        return static_cast<Instruction*>(nullptr);
+    };
+    auto x = getInst("x"), y = getInst("y"), p = getInst("p");
+    const Value* g = module->getNamedValue("g");
+    const Function* f = module->getFunction("f");
+    const Instruction* indirectCall = nullptr;
+    const Instruction* directCall = nullptr;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (auto call = dyn_cast<CallInst>(&inst))
+            (call->getCalledFunction() ? directCall : indirectCall) = call;
+
+    std::vector<std::uint32_t> lookUp = {QueryProtocol::LookUp, 0, 3};
+    name("@g", lookUp);
+    name("main:x", lookUp);
+    name("main:nothing", lookUp);
+    EXPECT_EQ(ask(lookUp), std::vector<std::uint32_t>({QueryProtocol::Ok, id(g), id(x), QueryProtocol::NoEntry}));
+
+    EXPECT_EQ(ask({QueryProtocol::PointsTo, 0, 2, id(p), id(g)}), std::vector<std::uint32_t>({QueryProtocol::Ok, 1, id(x), 1, id(g)}));
+    // The alloca points to its own object too
+    auto pointedBy = ask({QueryProtocol::PointedBy, 0, 1, id(x)});
+    ASSERT_EQ(pointedBy.size(), 4u);
+    std::sort(pointedBy.begin() + 2, pointedBy.end());
+    std::vector<std::uint32_t> expected = {QueryProtocol::Ok, 2, std::min(id(p), id(x)), std::max(id(p), id(x))};
+    EXPECT_EQ(pointedBy, expected);
+    EXPECT_EQ(ask({QueryProtocol::Alias, 0, 2, id(x), id(x), id(x), id(y)}), std::vector<std::uint32_t>({QueryProtocol::Ok, QueryProtocol::MustAliasCode, QueryProtocol::NoAliasCode}));
+    EXPECT_EQ(ask({QueryProtocol::CallTargets, 0, 3, id(indirectCall), id(directCall), id(x)}), std::vector<std::uint32_t>({QueryProtocol::Ok, 1, id(f), 1, id(f), QueryProtocol::NoEntry}));
+
+    EXPECT_EQ(ask({QueryProtocol::PointsTo, 1, 1, id(p)}), std::vector<std::uint32_t>({QueryProtocol::NoSuchModule}));
+    EXPECT_EQ(ask({QueryProtocol::PointsTo, 0, 2, id(p)}), std::vector<std::uint32_t>({QueryProtocol::BadRequest}));
+    EXPECT_EQ(ask({42, 0, 0}), std::vector<std::uint32_t>({QueryProtocol::BadRequest}));
+    EXPECT_EQ(ask({QueryProtocol::LookUp, 0, 1, 100}), std::vector<std::uint32_t>({QueryProtocol::BadRequest}));
+}
+
+TEST_F(AndersPassTest, IncrementalUpdateTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "@h = global i32* null\n"
+                                "define void @f(i32* %a) {\n"
+                                "bb:\n"
+                                "  store i32* %a, i32** @g\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  call void @f(i32* %x)\n"
+                                "  %p = load i32*, i32** @g\n"
+                                "  %q = load i32*, i32** @h\n"
+                                "  ret i32* %y\n"
+                                "}\n");
+
+    ScopedOption<bool> incremental("anders-incremental");
+    incremental->setValue(true);
+    Andersen anders(*module);
+    incremental->setValue(false);
+
+    auto f = module->getFunction("f");
+    auto expectSameAsFresh = [&]() {
+        Andersen fresh(*module);
+        for (auto& func : *module) {
+            for (auto& inst : instructions(func)) {
+                if (!inst.getType()->isPointerTy())
+                    continue;
+                std::vector<const Value*> expected, actual;
+                EXPECT_EQ(anders.getPointsToSet(&inst, actual), fresh.getPointsToSet(&inst, expected));
+                std::sort(expected.begin(), expected.end());
+                std::sort(actual.begin(), actual.end());
+                EXPECT_EQ(actual, expected) << inst.getName().str();
+            }
+        }
+    };
+
+    // f now stores into @h instead of @g: %p loses x, which %q gains
+    auto store = cast<StoreInst>(&*f->begin()->begin());
+    new StoreInst(&*f->arg_begin(), module->getNamedGlobal("h"), store);
+    store->eraseFromParent();
+    EXPECT_TRUE(anders.updateFunctions(*module, f));
+    expectSameAsFresh();
+
+    std::vector<const Value*> ptsSet;
+    auto mainEntry = module->getFunction("main")->begin()->begin();
+    auto x = &*mainEntry;
+    auto q = &*std::next(mainEntry, 4);
+    EXPECT_TRUE(anders.getPointsToSet(q, ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{x});
+
+    // Taking the address of a function changes what indirect calls may reach, which forces a full analysis
+    new StoreInst(ConstantExpr::getBitCast(f, Type::getInt32PtrTy(module->getContext())), module->getNamedGlobal("h"), &*f->begin()->begin());
+    EXPECT_FALSE(anders.updateFunctions(*module, f));
+    expectSameAsFresh();
+}
+
+TEST_F(AndersPassTest, AppendDefinitionsTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  store i32* %x, i32** @g\n"
+                                "  %p = load i32*, i32** @g\n"
+                                "  ret i32* %p\n"
+                                "}\n");
+
+    ScopedOption<bool> append("anders-append");
+    append->setValue(true);
+    Andersen anders(*module);
+    append->setValue(false);
+
+    auto expectSameAsFresh = [&]() {
+        Andersen fresh(*module);
+        for (auto& func : *module) {
+            for (auto& inst : instructions(func)) {
+                if (!inst.getType()->isPointerTy())
+                    continue;
+                std::vector<const Value*> expected, actual;
+                EXPECT_EQ(anders.getPointsToSet(&inst, actual), fresh.getPointsToSet(&inst, expected));
+                std::sort(expected.begin(), expected.end());
+                std::sort(actual.begin(), actual.end());
+                EXPECT_EQ(actual, expected) << inst.getName().str();
+            }
+        }
+    };
+
+    // A JIT adds @k, which points to @g, and a function that stores its own object into @g and its argument through @k
+    auto& ctx = module->getContext();
+    auto i32Ptr = Type::getInt32PtrTy(ctx);
+    auto g = module->getNamedGlobal("g");
+    auto k = new GlobalVariable(*module, g->getType(), false, GlobalValue::ExternalLinkage, g, "k");
+    auto later = Function::Create(FunctionType::get(Type::getVoidTy(ctx), {i32Ptr}, false), GlobalValue::ExternalLinkage, "later", module);
+    auto bb = BasicBlock::Create(ctx, "bb", later);
+    auto z = new AllocaInst(Type::getInt32Ty(ctx), 0, "z", bb);
+    new StoreInst(z, g, bb);
+    auto m = new LoadInst(g->getType(), k, "m", bb);
+    new StoreInst(&*later->arg_begin(), m, bb);
+    new LoadInst(i32Ptr, g, "r", bb);
+    ReturnInst::Create(ctx, bb);
+    EXPECT_TRUE(anders.appendDefinitions(*module, later, k));
+    expectSameAsFresh();
+
+    // %p, collected before, sees what the new code stores
+    std::vector<const Value*> ptsSet;
+    auto p = &*std::next(module->getFunction("main")->begin()->begin(), 2);
+    ASSERT_TRUE(anders.getPointsToSet(p, ptsSet));
+    EXPECT_EQ(ptsSet.size(), 2u);
+    EXPECT_TRUE(std::find(ptsSet.begin(), ptsSet.end(), z) != ptsSet.end());
+
+    // A new function whose address is taken may be reached by the old indirect calls, which forces a full analysis
+    auto target = Function::Create(FunctionType::get(Type::getVoidTy(ctx), false), GlobalValue::ExternalLinkage, "target", module);
+    ReturnInst::Create(ctx, BasicBlock::Create(ctx, "bb", target));
+    auto slot = new GlobalVariable(*module, target->getType(), false, GlobalValue::ExternalLinkage, target, "slot");
+    EXPECT_FALSE(anders.appendDefinitions(*module, target, slot));
+    expectSameAsFresh();
+}
+
+TEST_F(AndersPassTest, TrackValuesTest) {
+    auto module = ParseAssembly("define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %p = alloca i32*\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  %a = load i32*, i32** %p\n"
+                                "  %b = load i32*, i32** %p\n"
+                                "  %c = getelementptr i32, i32* %y, i64 1\n"
+                                "  ret void\n"
+                                "}\n");
+    ScopedOption<bool> track("anders-track-values");
+    {
+        Andersen untracked(*module);
+        EXPECT_FALSE(untracked.followsIRChanges());
+    }
+    track->setValue(true);
+    AndersenAAResult aa(*module);
+    track->setValue(false);
+    const Andersen& anders = aa.getAndersen();
+    EXPECT_TRUE(anders.followsIRChanges());
+
+    auto entry = module->getFunction("main")->begin();
+    auto itr = entry->begin();
+    Instruction* x = &*itr++;
+    Instruction* y = &*itr++;
+    ++itr;
+    ++itr;
+    Instruction* a = &*itr++;
+    Instruction* b = &*itr++;
+    Instruction* c = &*itr++;
+
+    // The instruction that replaces %a takes its place
+    std::vector<const Value*> ptsSet;
+    Instruction* a2 = CastInst::CreatePointerCast(b, a->getType(), "a2", a);
+    a->replaceAllUsesWith(a2);
+    a->eraseFromParent();
+    EXPECT_TRUE(anders.getPointsToSet(a2, ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{x});
+    EXPECT_TRUE(aa.isUpToDate(*module));
+
+    // A deleted object is forgotten
+    std::vector<const Value*> allocSites;
+    anders.getAllAllocationSites(allocSites);
+    unsigned numAllocSites = allocSites.size();
+    c->eraseFromParent();
+    y->eraseFromParent();
+    anders.getAllAllocationSites(allocSites);
+    EXPECT_EQ(allocSites.size(), numAllocSites - 1);
+
+    // A clone has the set of its original, and a cloned object is wherever its original is, without being the same object
+    Instruction* xc = x->clone();
+    xc->insertAfter(x);
+    Instruction* bc = b->clone();
+    bc->insertAfter(b);
+    ValueToValueMapTy vmap;
+    vmap[x] = xc;
+    vmap[b] = bc;
+    EXPECT_EQ(aa.alias(MemoryLocation(x, 4), MemoryLocation(b, 4)), MustAlias);
+    aa.noteClonedValues(vmap);
+    EXPECT_TRUE(anders.getPointsToSet(bc, ptsSet));
+    std::sort(ptsSet.begin(), ptsSet.end());
+    std::vector<const Value*> expected{x, xc};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(ptsSet, expected);
+    EXPECT_TRUE(aa.getFrozenResults()->mayPointTo(bc, xc));
+    EXPECT_EQ(aa.alias(MemoryLocation(x, 4), MemoryLocation(b, 4)), MayAlias);
+    EXPECT_EQ(aa.alias(MemoryLocation(b, 4), MemoryLocation(bc, 4)), MayAlias);
+    EXPECT_TRUE(aa.isUpToDate(*module));
+
+    // Replacing an object with another one the analysis knows can't be followed
+    xc->replaceAllUsesWith(x);
+    xc->eraseFromParent();
+    EXPECT_FALSE(anders.followsIRChanges());
+    EXPECT_FALSE(aa.isUpToDate(*module));
+}
+
+TEST_F(AndersPassTest, SolverBudgetTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  store i32* %p, i32** @g\n"
+                                "  %q = load i32*, i32** @g\n"
+                                "  ret i32* %q\n"
+                                "}\n");
+    Andersen fresh(*module);
+
+    ScopedOption<double> timeBudget("anders-time-budget");
+    ScopedOption<bool> wave("enable-wave");
+    ScopedOption<unsigned> threads("anders-threads");
+    // The worklist, wave and parallel solvers
+    for (unsigned engine = 0; engine < 3; ++engine) {
+        wave->setValue(engine == 1);
+        threads->setValue(engine == 2 ? 2 : 1);
+        // The budget runs out before the solver starts: the results are less precise, but every pointer still covers what it points to
+        timeBudget->setValue(1e-9);
+        Andersen degraded(*module);
+        timeBudget->setValue(0);
+        wave->setValue(false);
+        threads->setValue(1);
+
+        unsigned numUniversal = 0;
+        for (auto& inst : instructions(*module->getFunction("main"))) {
+            if (!inst.getType()->isPointerTy())
+                continue;
+            std::vector<const Value*> expected, actual;
+            ASSERT_TRUE(fresh.getPointsToSet(&inst, expected));
+            AndersPtsSetView view;
+            ASSERT_TRUE(degraded.getPointsToSetView(&inst, view));
+            if (view.hasUniversalObject()) {
+                ++numUniversal;
+                continue;
+            }
+            actual.assign(view.begin(), view.end());
+            for (auto v : expected)
+                EXPECT_TRUE(std::find(actual.begin(), actual.end(), v) != actual.end()) << inst.getName().str();
+        }
+        EXPECT_GT(numUniversal, 0u) << engine;
+    }
+}
+
+TEST_F(AndersPassTest, CancellationTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  store i32* %p, i32** @g\n"
+                                "  %q = load i32*, i32** @g\n"
+                                "  ret i32* %q\n"
+                                "}\n");
+    Andersen fresh(*module);
+
+    // Without a cancellation, the callback sees the phases in order and the solver iterate, and the results are those of a plain run
+    std::vector<AndersProgress> reports;
+    AndersRunOptions options;
+    options.onProgress = [&reports](const AndersProgress& progress) { reports.push_back(progress); };
+    Andersen watched(*module, options);
+    EXPECT_FALSE(watched.wasCancelled());
+    ASSERT_FALSE(reports.empty());
+    EXPECT_EQ(reports.front().phase, AndersPhase::Collection);
+    EXPECT_EQ(reports.back().phase, AndersPhase::Solving);
+    EXPECT_GT(reports.back().iteration, 0u);
+    EXPECT_GT(reports.back().numNodes, 0u);
+    for (size_t i = 1; i < reports.size(); ++i)
+        EXPECT_LE(static_cast<unsigned>(reports[i - 1].phase), static_cast<unsigned>(reports[i].phase));
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        ASSERT_TRUE(fresh.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(watched.getPointsToSet(&inst, actual));
+        EXPECT_EQ(expected, actual) << inst.getName().str();
+    }
+
+    // Cancelled once the solving starts: every pointer is either unknown or still covers what it points to
+    AndersCancellationToken token;
+    options.cancellation = &token;
+    options.onProgress = [&token](const AndersProgress& progress) {
+        if (progress.phase == AndersPhase::Solving)
+            token.cancel();
+    };
+    Andersen cancelled(*module, options);
+    EXPECT_TRUE(cancelled.wasCancelled());
+    unsigned numUnknown = 0;
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        ASSERT_TRUE(fresh.getPointsToSet(&inst, expected));
+        if (!cancelled.getPointsToSet(&inst, actual)) {
+            ++numUnknown;
+            continue;
+        }
+        for (auto v : expected)
+            EXPECT_TRUE(std::find(actual.begin(), actual.end(), v) != actual.end()) << inst.getName().str();
+    }
+    EXPECT_GT(numUnknown, 0u);
+
+    // Cancelled before the run: the constraints are still collected, but no phase is reported and nothing is solved
+    reports.clear();
+    options.onProgress = [&reports](const AndersProgress& progress) { reports.push_back(progress); };
+    Andersen early(*module, options);
+    EXPECT_TRUE(early.wasCancelled());
+    EXPECT_TRUE(reports.empty());
+}
+
+TEST_F(AndersPassTest, SolverCheckpointTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "@h = global i32** null\n"
+                                "define i32* @id(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret i32* %a\n"
+                                "}\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32** @g, i32*** @h\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  %r = load i32**, i32*** @h\n"
+                                "  store i32* %p, i32** %r\n"
+                                "  %q = load i32*, i32** @g\n"
+                                "  %fp = bitcast i32* (i32*)* @id to i8*\n"
+                                "  %f = bitcast i8* %fp to i32* (i32*)*\n"
+                                "  %s = call i32* %f(i32* %q)\n"
+                                "  ret i32* %s\n"
+                                "}\n");
+    Andersen fresh(*module);
+
+    SmallString<128> fileName;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("anders", "ckpt", fileName));
+    ScopedOption<std::string> checkpoint("anders-checkpoint");
+    ScopedOption<double> interval("anders-checkpoint-interval");
+    ScopedOption<std::string> resume("anders-resume");
+    ScopedOption<bool> hcd("enable-hcd");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+
+    auto expectSameResults = [&module, &fresh](const Andersen& anders, unsigned config) {
+        for (auto& inst : instructions(*module->getFunction("main"))) {
+            if (!inst.getType()->isPointerTy())
+                continue;
+            std::vector<const Value*> expected, actual;
+            EXPECT_EQ(anders.getPointsToSet(&inst, actual), fresh.getPointsToSet(&inst, expected));
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            EXPECT_EQ(actual, expected) << inst.getName().str() << " " << config;
+        }
+    };
+
+    // A checkpoint at every iteration leaves the one taken at the start of the last iteration, which the resumed solving finishes
+    for (unsigned config = 0; config < 2; ++config) {
+        hcd->setValue(config == 1);
+        diffProp->setValue(config == 1);
+        checkpoint->setValue(fileName.str().str());
+        interval->setValue(0);
+        Andersen checkpointed(*module);
+        checkpoint->setValue("");
+        interval->setValue(600);
+        expectSameResults(checkpointed, config);
+
+        resume->setValue(fileName.str().str());
+        Andersen resumed(*module);
+        resume->setValue("");
+        hcd->setValue(false);
+        diffProp->setValue(false);
+        expectSameResults(resumed, config);
+    }
+
+    // A checkpoint that doesn't fit is ignored, and the solving starts over
+    {
+        std::error_code ec;
+        raw_fd_ostream os(fileName, ec, sys::fs::F_None);
+        ASSERT_FALSE(ec);
+        os << "garbage";
+    }
+    resume->setValue(fileName.str().str());
+    Andersen restarted(*module);
+    resume->setValue("");
+    expectSameResults(restarted, 2);
+    sys::fs::remove(fileName);
+}
+
+TEST_F(AndersPassTest, OptimizeCacheTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %p = alloca i32*, align 8\n"
+                                "  %a = bitcast i32* %x to i8*\n"
+                                "  %b = bitcast i32* %x to i8*\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  store i32* %y, i32** %p\n"
+                                "  store i32* %x, i32** @g\n"
+                                "  %q = load i32*, i32** %p\n"
+                                "  %r = load i32*, i32** @g\n"
+                                "  %s = load i32*, i32** %p\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen fresh(*module);
+
+    SmallString<128> dir;
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("anders-optimize-cache", dir));
+    ScopedOption<std::string> cache("anders-optimize-cache");
+    ScopedOption<bool> hvn("enable-hvn");
+    ScopedOption<bool> hu("enable-hu");
+    ScopedOption<bool> le("enable-le");
+
+    auto expectSameResults = [&module, &fresh](const Andersen& anders, const char* run) {
+        for (auto& inst : instructions(*module->getFunction("main"))) {
+            if (!inst.getType()->isPointerTy())
+                continue;
+            std::vector<const Value*> expected, actual;
+            EXPECT_EQ(anders.getPointsToSet(&inst, actual), fresh.getPointsToSet(&inst, expected));
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            EXPECT_EQ(actual, expected) << inst.getName().str() << " " << run;
+        }
+    };
+    auto listEntries = [&dir]() {
+        std::vector<std::string> entries;
+        std::error_code ec;
+        for (sys::fs::directory_iterator itr(dir, ec), end; itr != end && !ec; itr.increment(ec))
+            entries.push_back(itr->path());
+        return entries;
+    };
+
+    cache->setValue(dir.str().str());
+    hvn->setValue(true);
+    hu->setValue(true);
+    le->setValue(true);
+    {
+        Andersen cold(*module);
+        expectSameResults(cold, "cold");
+    }
+    auto entries = listEntries();
+    ASSERT_EQ(entries.size(), 1u);
+    {
+        Andersen warm(*module);
+        expectSameResults(warm, "warm");
+    }
+    EXPECT_EQ(listEntries(), entries);
+
+    // A damaged entry is ignored, and written again
+    {
+        std::error_code ec;
+        raw_fd_ostream os(entries[0], ec, sys::fs::F_None);
+        ASSERT_FALSE(ec);
+        os << "garbage";
+    }
+    {
+        Andersen rewritten(*module);
+        expectSameResults(rewritten, "damaged");
+    }
+    uint64_t size = 0;
+    ASSERT_FALSE(sys::fs::file_size(entries[0], size));
+    EXPECT_GT(size, sizeof(OptimizeCacheFormat::Header));
+
+    // Other options make another entry
+    le->setValue(false);
+    {
+        Andersen other(*module);
+        expectSameResults(other, "other options");
+    }
+    EXPECT_EQ(listEntries().size(), 2u);
+
+    cache->setValue("");
+    hvn->setValue(false);
+    hu->setValue(false);
+    for (auto const& entry : listEntries())
+        sys::fs::remove(entry);
+    sys::fs::remove(dir);
+}
+
+TEST_F(AndersPassTest, SteensgaardFallbackTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %z = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  store i32* %p, i32** @g\n"
+                                "  %q = load i32*, i32** @g\n"
+                                "  %w = bitcast i32* %z to i8*\n"
+                                "  ret i32* %q\n"
+                                "}\n");
+    Andersen fresh(*module);
+
+    ScopedOption<double> timeBudget("anders-time-budget");
+    ScopedOption<bool> fallback("enable-steensgaard-fallback");
+    // The budget runs out before the solver starts, so every pointer that could grow gets its Steensgaard set
+    timeBudget->setValue(1e-9);
+    fallback->setValue(true);
+    Andersen degraded(*module);
+    fallback->setValue(false);
+    timeBudget->setValue(0);
+
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        ASSERT_TRUE(fresh.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(degraded.getPointsToSet(&inst, actual)) << inst.getName().str();
+        for (auto v : expected)
+            EXPECT_TRUE(std::find(actual.begin(), actual.end(), v) != actual.end()) << inst.getName().str();
+    }
+    // Nothing ever mixes %z with the other objects
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(degraded.getPointsToSet(module->getFunction("main")->getEntryBlock().getTerminator()->getOperand(0), ptsSet));
+    for (auto v : ptsSet)
+        EXPECT_NE(v->getName(), "z");
+}
+
+TEST_F(AndersPassTest, UniversalTopTest) {
+    auto module = ParseAssembly("define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  %u = inttoptr i64 42 to i32*\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  store i32* %u, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  %z = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  store i32* %z, i32** %s\n"
+                                "  %r = load i32*, i32** %s\n"
+                                "  ret void\n"
+                                "}\n");
+    const Value *p = nullptr, *r = nullptr, *z = nullptr;
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (inst.getName() == "p")
+            p = &inst;
+        else if (inst.getName() == "r")
+            r = &inst;
+        else if (inst.getName() == "z")
+            z = &inst;
+    }
+    ASSERT_TRUE(p != nullptr && r != nullptr && z != nullptr);
+
+    ScopedOption<bool> top("enable-universal-top");
+    ScopedOption<bool> wave("enable-wave");
+    ScopedOption<unsigned> threads("anders-threads");
+    // Without the option, then with it under the worklist, wave and parallel solvers
+    for (unsigned config = 0; config < 4; ++config) {
+        top->setValue(config != 0);
+        wave->setValue(config == 2);
+        threads->setValue(config == 3 ? 2 : 1);
+        Andersen anders(*module);
+        top->setValue(false);
+        wave->setValue(false);
+        threads->setValue(1);
+
+        // p may point to anything, so it is unknown either way. Only the top set forgets about x
+        std::vector<const Value*> ptsSet;
+        EXPECT_FALSE(anders.getPointsToSet(p, ptsSet)) << config;
+        AndersPtsSetView view;
+        ASSERT_TRUE(anders.getPointsToSetView(p, view));
+        EXPECT_TRUE(view.hasUniversalObject());
+        EXPECT_EQ(config == 0 ? 1u : 0u, view.getNumValues()) << config;
+
+        // r has nothing to do with p
+        ASSERT_TRUE(anders.getPointsToSet(r, ptsSet));
+        EXPECT_EQ(std::vector<const Value*>({ z }), ptsSet);
+
+        std::vector<std::vector<const Value*>> ptsSets;
+        BitVector unknown;
+        anders.getPointsToSets({ p, r }, ptsSets, unknown);
+        EXPECT_TRUE(unknown.test(0));
+        EXPECT_FALSE(unknown.test(1));
+    }
+}
+
+TEST_F(AndersPassTest, PtsSetLimitTest) {
+    // p gets three objects through the memory, q two, and c is a copy of p
+    auto module = ParseAssembly("define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %z = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %s\n"
+                                "  store i32* %y, i32** %s\n"
+                                "  store i32* %z, i32** %s\n"
+                                "  %p = load i32*, i32** %s\n"
+                                "  %c = bitcast i32* %p to i8*\n"
+                                "  %t = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %t\n"
+                                "  store i32* %y, i32** %t\n"
+                                "  %q = load i32*, i32** %t\n"
+                                "  ret void\n"
+                                "}\n");
+    const Value *p = nullptr, *c = nullptr, *q = nullptr;
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (inst.getName() == "p")
+            p = &inst;
+        else if (inst.getName() == "c")
+            c = &inst;
+        else if (inst.getName() == "q")
+            q = &inst;
+    }
+    ASSERT_TRUE(p != nullptr && c != nullptr && q != nullptr);
+
+    ScopedOption<unsigned> limit("anders-pts-limit");
+    ScopedOption<bool> wave("enable-wave");
+    ScopedOption<unsigned> threads("anders-threads");
+    // Under the worklist, wave and parallel solvers
+    for (unsigned config = 0; config < 3; ++config) {
+        limit->setValue(2);
+        wave->setValue(config == 1);
+        threads->setValue(config == 2 ? 2 : 1);
+        Andersen anders(*module);
+        limit->setValue(0);
+        wave->setValue(false);
+        threads->setValue(1);
+
+        // The sets of p and of what it flows into are past the limit, and may point to anything
+        std::vector<const Value*> ptsSet;
+        for (auto v : { p, c }) {
+            EXPECT_FALSE(anders.getPointsToSet(v, ptsSet)) << config;
+            AndersPtsSetView view;
+            ASSERT_TRUE(anders.getPointsToSetView(v, view));
+            EXPECT_TRUE(view.hasUniversalObject()) << config;
+            EXPECT_EQ(0u, view.getNumValues()) << config;
+        }
+        EXPECT_EQ(unsigned(Andersen::UniversalAliasClass), anders.getAliasClass(p)) << config;
+
+        // q is within it
+        ASSERT_TRUE(anders.getPointsToSet(q, ptsSet)) << config;
+        EXPECT_EQ(2u, ptsSet.size()) << config;
+    }
+}
+
+} // end of anonymous namespace
+
+TEST_F(AndersPassTest, OnlineEquivTest) {
+    // Many copies of the same pointer, which end up with the same points-to set and no edges of their own. The selects have the same set as the copies at first, until the load of %t gets %z into half of them
+    std::string ir = "define void @main(i1 %c) {\n"
+                     "bb:\n"
+                     "  %x = alloca i32, align 4\n"
+                     "  %y = alloca i32, align 4\n"
+                     "  %z = alloca i32, align 4\n"
+                     "  %s = alloca i32*, align 8\n"
+                     "  %t = alloca i32*, align 8\n"
+                     "  store i32* %x, i32** %s\n"
+                     "  store i32* %y, i32** %s\n"
+                     "  %p = load i32*, i32** %s\n"
+                     "  store i32* %p, i32** %t\n"
+                     "  %u = load i32*, i32** %t\n"
+                     "  store i32* %z, i32** %t\n";
+    for (unsigned i = 0; i < 32; ++i) {
+        ir += "  %c" + std::to_string(i) + " = bitcast i32* %p to i8*\n";
+        ir += "  %d" + std::to_string(i) + " = select i1 %c, i32* %p, i32* " + (i % 2 ? "%u" : "%p") + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> equiv("enable-online-equiv");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+    ScopedOption<unsigned> threads("anders-threads");
+    // Under the worklist solver, with difference propagation and under the parallel solver, only nodes that get their objects from the same edges are merged, so the sets are the same as without merging
+    for (unsigned config = 0; config < 3; ++config) {
+        diffProp->setValue(config == 1);
+        threads->setValue(config == 2 ? 2 : 1);
+        Andersen plain(*module);
+        equiv->setValue(true);
+        Andersen merged(*module);
+        equiv->setValue(false);
+        diffProp->setValue(false);
+        threads->setValue(1);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> plainSet, mergedSet;
+            ASSERT_TRUE(plain.getPointsToSet(v, plainSet));
+            ASSERT_TRUE(merged.getPointsToSet(v, mergedSet)) << config;
+            std::sort(plainSet.begin(), plainSet.end());
+            std::sort(mergedSet.begin(), mergedSet.end());
+            EXPECT_EQ(mergedSet, plainSet) << config;
+        }
+    }
+}
+
+TEST(AndersTest, OnlineEquivIncomingEdgesTest) {
+    // c and d both point to x from the start and copy into e, but d also gets z from the far end of a chain of copies, which only arrives once the detector has run a few times. The links go down in index, so that the solver takes an iteration for each
+    const unsigned chainLength = 24;
+    enum: NodeIndex { x = 4, z, c, d, e, firstLink };
+    NodeIndex numNodes = firstLink + chainLength + 1;
+    std::vector<NodeIndex> objectNodes = { 1, 3, x, z };
+    std::vector<AndersConstraint> constraints = {
+        AndersConstraint(AndersConstraint::ADDR_OF, c, x),
+        AndersConstraint(AndersConstraint::ADDR_OF, d, x),
+        AndersConstraint(AndersConstraint::COPY, e, c),
+        AndersConstraint(AndersConstraint::COPY, e, d),
+        AndersConstraint(AndersConstraint::ADDR_OF, firstLink + chainLength, z),
+        AndersConstraint(AndersConstraint::COPY, d, firstLink),
+    };
+    for (unsigned i = 0; i < chainLength; ++i)
+        constraints.emplace_back(AndersConstraint::COPY, firstLink + i, firstLink + i + 1);
+
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ConstraintFileWriter writer(os, numNodes, objectNodes);
+    for (auto const& constraint: constraints)
+        writer.write(constraint);
+    os.flush();
+    std::string error;
+    auto reader = ConstraintFileReader::open(MemoryBuffer::getMemBufferCopy(bytes), error);
+    ASSERT_TRUE(reader != nullptr) << error;
+
+    // c and d have the same set and the same outgoing edges for a while, but not the same incoming edges, so they are never merged
+    ScopedOption<bool> equiv("enable-online-equiv");
+    equiv->setValue(true);
+    std::shared_ptr<Andersen> anders = Andersen::createFromConstraints(*reader, error);
+    ASSERT_TRUE(anders != nullptr) << error;
+    AndersPtsSetView view;
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(c, view));
+    EXPECT_EQ(view.getNodes().getSize(), 1u);
+    EXPECT_TRUE(view.hasNode(x));
+    ASSERT_TRUE(anders->getPointsToSetViewOfNode(d, view));
+    EXPECT_EQ(view.getNodes().getSize(), 2u);
+    EXPECT_TRUE(view.hasNode(z));
+}
+
+TEST_F(AndersPassTest, AdaptiveCyclesTest) {
+    // Loads and stores through the same pointers, which close copy cycles while solving, and pointers copied around a loop
+    std::string ir = "define void @main(i1 %c) {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 4; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %x" + n + " = alloca i32, align 4\n";
+        ir += "  %s" + n + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + n + ", i32** %s" + n + "\n";
+    }
+    for (unsigned i = 0; i < 32; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %p" + n + " = load i32*, i32** %s" + std::to_string(i % 4) + "\n";
+        ir += "  store i32* %p" + n + ", i32** %s" + std::to_string((i + 1) % 4) + "\n";
+    }
+    ir += "  br label %loop\n"
+          "loop:\n";
+    for (unsigned i = 0; i < 4; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %a" + n + " = phi i32** [ %s" + n + ", %bb ], [ %b" + n + ", %loop ]\n";
+    }
+    for (unsigned i = 0; i < 4; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %b" + n + " = select i1 %c, i32** %a" + n + ", i32** %a" + std::to_string((i + 1) % 4) + "\n";
+        ir += "  %m" + n + " = load i32*, i32** %b" + n + "\n";
+    }
+    ir += "  br i1 %c, label %loop, label %exit\n"
+          "exit:\n"
+          "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> adaptive("anders-adaptive-cycles");
+    ScopedOption<double> yield("anders-adaptive-cycles-yield");
+    ScopedOption<bool> lcd("enable-lcd");
+    ScopedOption<bool> hcd("enable-hcd");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+    ScopedOption<unsigned> threads("anders-threads");
+    // Turning the detection off only leaves some cycles uncollapsed, so the sets must be the same, whether it is turned off now and then (the default yield) or after nearly every iteration (a yield no iteration reaches)
+    for (unsigned config = 0; config < 6; ++config) {
+        lcd->setValue(true);
+        hcd->setValue(config % 3 != 0);
+        diffProp->setValue(config % 3 == 1);
+        threads->setValue(config % 3 == 2 ? 2 : 1);
+        Andersen plain(*module);
+        adaptive->setValue(true);
+        yield->setValue(config < 3 ? 0.01 : 1000);
+        Andersen throttled(*module);
+        adaptive->setValue(false);
+        yield->setValue(0.01);
+        lcd->setValue(false);
+        hcd->setValue(false);
+        diffProp->setValue(false);
+        threads->setValue(1);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> plainSet, throttledSet;
+            ASSERT_TRUE(plain.getPointsToSet(v, plainSet));
+            ASSERT_TRUE(throttled.getPointsToSet(v, throttledSet)) << config;
+            std::sort(plainSet.begin(), plainSet.end());
+            std::sort(throttledSet.begin(), throttledSet.end());
+            EXPECT_EQ(throttledSet, plainSet) << config << " " << v->getName().str();
+        }
+    }
+}
+
+TEST_F(AndersPassTest, PreSolveTest) {
+    // A cycle of copies through phis, fed by address-of edges and feeding a store and a load
+    auto module = ParseAssembly("define void @main(i1 %c) {\n"
+                                "entry:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  br label %loop\n"
+                                "loop:\n"
+                                "  %a = phi i32* [ %x, %entry ], [ %b, %loop ]\n"
+                                "  %b = phi i32* [ %y, %entry ], [ %a, %loop ]\n"
+                                "  %d = bitcast i32* %b to i8*\n"
+                                "  store i32* %a, i32** %s\n"
+                                "  br i1 %c, label %loop, label %exit\n"
+                                "exit:\n"
+                                "  %p = load i32*, i32** %s\n"
+                                "  %q = bitcast i32* %p to i8*\n"
+                                "  ret void\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> presolve("anders-presolve");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+    ScopedOption<bool> hcd("enable-hcd");
+    // The pre-solving must leave the same sets as the worklist solver alone, with and without difference propagation and HCD
+    for (unsigned config = 0; config < 3; ++config) {
+        diffProp->setValue(config == 1);
+        hcd->setValue(config == 2);
+        Andersen plain(*module);
+        presolve->setValue(true);
+        Andersen presolved(*module);
+        presolve->setValue(false);
+        diffProp->setValue(false);
+        hcd->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> plainSet, presolvedSet;
+            ASSERT_TRUE(plain.getPointsToSet(v, plainSet));
+            ASSERT_TRUE(presolved.getPointsToSet(v, presolvedSet)) << config;
+            std::sort(plainSet.begin(), plainSet.end());
+            std::sort(presolvedSet.begin(), presolvedSet.end());
+            EXPECT_EQ(presolvedSet, plainSet) << config << " " << v->getName().str();
+        }
+        // %q gets both objects through the store and the load
+        auto q = std::find_if(pointers.begin(), pointers.end(), [](const Value* v) { return v->getName() == "q"; });
+        std::vector<const Value*> qSet;
+        ASSERT_TRUE(presolved.getPointsToSet(*q, qSet));
+        EXPECT_EQ(qSet.size(), 2u) << config;
+    }
+}
+
+TEST_F(AndersPassTest, WorkListBatchTest) {
+    // Chains of stores and loads through pointers to pointers, so that the work list goes through several iterations with more nodes than a batch
+    std::string ir = "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 5; ++i)
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+    for (unsigned i = 0; i < 40; ++i) {
+        std::string n = std::to_string(i);
+        std::string stored = i < 5 ? "%x" + n : "%p" + std::to_string(i - 5);
+        ir += "  %s" + n + " = alloca i32*, align 8\n";
+        ir += "  store i32* " + stored + ", i32** %s" + n + "\n";
+        ir += "  %p" + n + " = load i32*, i32** %s" + std::to_string(i * 7 % 40) + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<unsigned> batchSize("anders-worklist-batch");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+    ScopedOption<bool> hcd("enable-hcd");
+    // The nodes are visited in the same order whatever the batch size, so the sets must be the same, with and without difference propagation and HCD
+    for (unsigned config = 0; config < 3; ++config) {
+        diffProp->setValue(config == 1);
+        hcd->setValue(config == 2);
+        Andersen single(*module);
+        batchSize->setValue(8);
+        Andersen batched(*module);
+        batchSize->setValue(1);
+        diffProp->setValue(false);
+        hcd->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> singleSet, batchedSet;
+            ASSERT_TRUE(single.getPointsToSet(v, singleSet));
+            ASSERT_TRUE(batched.getPointsToSet(v, batchedSet)) << config;
+            std::sort(singleSet.begin(), singleSet.end());
+            std::sort(batchedSet.begin(), batchedSet.end());
+            EXPECT_EQ(batchedSet, singleSet) << config << " " << v->getName().str();
+        }
+    }
+}
+
+TEST_F(AndersPassTest, OutOfCoreTest) {
+    SmallString<128> dir;
+    ASSERT_FALSE(sys::fs::createUniqueDirectory("anders-out-of-core", dir));
+    auto listEntries = [&dir]() {
+        std::vector<std::string> entries;
+        std::error_code ec;
+        for (sys::fs::directory_iterator itr(dir, ec), end; itr != end && !ec; itr.increment(ec))
+            entries.push_back(itr->path());
+        return entries;
+    };
+
+    // The spill file on its own: the sets come back on their first lookup, and the file is rewritten once most of it has been read back
+    {
+        std::string error;
+        auto spillFile = PtsSetSpillFile::create(dir, error);
+        ASSERT_TRUE(spillFile != nullptr) << error;
+        AndersPtsGraph graph;
+        for (NodeIndex n = 4; n < 20; ++n) {
+            graph[n].insert(n + 100);
+            graph[n].insert(n + 300);
+            if (n % 2 == 0)
+                graph[n].insertNullObject();
+        }
+        graph[20];
+        std::vector<NodeIndex> nodes(graph.begin(), graph.end());
+        ASSERT_TRUE(spillFile->spill(graph, nodes, error)) << error;
+        // The empty set isn't worth spilling
+        EXPECT_EQ(spillFile->getNumSpilledSets(), 16u);
+        EXPECT_FALSE(graph.isSpilled(20));
+        EXPECT_TRUE(graph.isSpilled(4));
+        EXPECT_EQ(graph.getSize(), 17u);
+
+        const AndersPtsGraph& constGraph = graph;
+        const AndersPtsSet* set = constGraph.find(6);
+        ASSERT_TRUE(set != nullptr);
+        EXPECT_TRUE(set->has(106) && set->has(306) && set->hasNullObject());
+        EXPECT_EQ(set->getSize(), 3u);
+        EXPECT_FALSE(graph.isSpilled(6));
+        graph.erase(7);
+        EXPECT_EQ(spillFile->getNumSpilledSets(), 14u);
+        for (NodeIndex n = 8; n < 16; ++n)
+            graph.find(n);
+
+        // Spill again: the new sets start on a page of their own, after the file has been rewritten with the six sets that are still in it
+        std::vector<NodeIndex> more = { 6, 8 };
+        ASSERT_TRUE(spillFile->spill(graph, more, error)) << error;
+        EXPECT_EQ(spillFile->getNumSpilledSets(), 8u);
+        EXPECT_EQ(spillFile->getFileSize() % sys::Process::getPageSizeEstimate(), 6 * sizeof(std::uint32_t));
+        EXPECT_EQ(listEntries().size(), 1u);
+
+        spillFile->readBackAll(graph);
+        EXPECT_FALSE(graph.isSpilled(4));
+        EXPECT_FALSE(graph.count(7));
+        for (NodeIndex n = 4; n < 20; ++n) {
+            if (n == 7)
+                continue;
+            EXPECT_TRUE(graph[n].has(n + 100) && graph[n].has(n + 300)) << n;
+            EXPECT_EQ(graph[n].hasNullObject(), n % 2 == 0) << n;
+        }
+    }
+    EXPECT_TRUE(listEntries().empty());
+
+    // The solver with every cold set spilled between two iterations must get the same sets as without, with and without difference propagation and HCD
+    std::string ir = "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 5; ++i)
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+    for (unsigned i = 0; i < 40; ++i) {
+        std::string n = std::to_string(i);
+        std::string stored = i < 5 ? "%x" + n : "%p" + std::to_string(i - 5);
+        ir += "  %s" + n + " = alloca i32*, align 8\n";
+        ir += "  store i32* " + stored + ", i32** %s" + n + "\n";
+        ir += "  %p" + n + " = load i32*, i32** %s" + std::to_string(i * 7 % 40) + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<std::string> outOfCore("anders-out-of-core");
+    ScopedOption<unsigned> limit("anders-out-of-core-limit");
+    ScopedOption<bool> diffProp("enable-diff-prop");
+    ScopedOption<bool> hcd("enable-hcd");
+    for (unsigned config = 0; config < 3; ++config) {
+        diffProp->setValue(config == 1);
+        hcd->setValue(config == 2);
+        Andersen inMemory(*module);
+        outOfCore->setValue(dir.str().str());
+        limit->setValue(0);
+        Andersen spilled(*module);
+        outOfCore->setValue("");
+        limit->setValue(1024);
+        diffProp->setValue(false);
+        hcd->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> inMemorySet, spilledSet;
+            ASSERT_TRUE(inMemory.getPointsToSet(v, inMemorySet));
+            ASSERT_TRUE(spilled.getPointsToSet(v, spilledSet)) << config;
+            std::sort(inMemorySet.begin(), inMemorySet.end());
+            std::sort(spilledSet.begin(), spilledSet.end());
+            EXPECT_EQ(spilledSet, inMemorySet) << config << " " << v->getName().str();
+        }
+        EXPECT_TRUE(listEntries().empty()) << config;
+    }
+    sys::fs::remove(dir);
+}
+
+TEST_F(AndersPassTest, ParallelOfflineOptimizationTest) {
+    // Enough independent pointers to fill a level of the predecessor graph that is labelled on several threads
+    std::string ir = "@g = global i32 0\n"
+                     "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 7; ++i)
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+    for (unsigned i = 0; i < 1500; ++i) {
+        std::string n = std::to_string(i);
+        std::string stored = i % 3 == 0 ? "@g" : "%x" + std::to_string(i % 7);
+        ir += "  %s" + n + " = alloca i32*, align 8\n";
+        ir += "  store i32* " + stored + ", i32** %s" + n + "\n";
+        ir += "  %p" + n + " = load i32*, i32** %s" + n + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> hvn("enable-hvn");
+    ScopedOption<bool> hu("enable-hu");
+    ScopedOption<unsigned> threads("anders-offline-threads");
+    hvn->setValue(true);
+    hu->setValue(true);
+    Andersen sequential(*module);
+    threads->setValue(4);
+    Andersen parallel(*module);
+    threads->setValue(1);
+    hvn->setValue(false);
+    hu->setValue(false);
+
+    // The labels are numbered differently, but they partition the nodes the same way
+    for (auto v : pointers) {
+        std::vector<const Value*> sequentialSet, parallelSet;
+        ASSERT_TRUE(sequential.getPointsToSet(v, sequentialSet));
+        ASSERT_TRUE(parallel.getPointsToSet(v, parallelSet));
+        std::sort(sequentialSet.begin(), sequentialSet.end());
+        std::sort(parallelSet.begin(), parallelSet.end());
+        EXPECT_EQ(sequentialSet, parallelSet);
+    }
+}
+
+TEST_F(AndersPassTest, HUReleasedSetsTest) {
+    // Chains of copies through cycles, where a set is read by several nodes labelled at different times, so HU frees sets while the nodes further down still need theirs
+    std::string ir = "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 5; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  %s" + std::to_string(i) + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s" + std::to_string(i) + "\n";
+    }
+    ir += "  %c0 = load i32*, i32** %s0\n";
+    for (unsigned i = 1; i < 1500; ++i) {
+        std::string n = std::to_string(i), prev = std::to_string(i - 1);
+        ir += "  %c" + n + " = select i1 true, i32* %c" + prev + ", i32* %c" + std::to_string(i / 2) + "\n";
+        if (i % 100 == 0)
+            ir += "  store i32* %c" + n + ", i32** %s" + std::to_string(i / 100 % 5) + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    Andersen plain(*module);
+
+    ScopedOption<bool> hu("enable-hu");
+    ScopedOption<unsigned> threads("anders-offline-threads");
+    hu->setValue(true);
+    Andersen sequential(*module);
+    threads->setValue(4);
+    Andersen parallel(*module);
+    threads->setValue(1);
+    hu->setValue(false);
+
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, sequentialSet, parallelSet;
+        ASSERT_TRUE(plain.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(sequential.getPointsToSet(&inst, sequentialSet));
+        ASSERT_TRUE(parallel.getPointsToSet(&inst, parallelSet));
+        std::sort(expected.begin(), expected.end());
+        std::sort(sequentialSet.begin(), sequentialSet.end());
+        std::sort(parallelSet.begin(), parallelSet.end());
+        EXPECT_EQ(expected, sequentialSet) << inst.getName().str();
+        EXPECT_EQ(expected, parallelSet) << inst.getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, ParallelSolverTest) {
+    // Enough pointers for a batch that the parallel solver splits among its threads, whose shards then exchange the edges and sets they find for each other
+    std::string ir = "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 10; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  %s" + std::to_string(i) + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s" + std::to_string(i) + "\n";
+    }
+    for (unsigned i = 0; i < 3000; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %l" + n + " = load i32*, i32** %s" + std::to_string(i * 7 % 10) + "\n";
+        ir += "  store i32* %l" + n + ", i32** %s" + std::to_string(i * 3 % 10) + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    Andersen sequential(*module);
+
+    ScopedOption<unsigned> threads("anders-threads");
+    threads->setValue(4);
+    Andersen parallel(*module);
+    threads->setValue(1);
+
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        ASSERT_TRUE(sequential.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(parallel.getPointsToSet(&inst, actual));
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(expected, actual) << inst.getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, ParallelWaveTest) {
+    // Thousands of copies of a few pointers, which make a level of the sweep, each with a load and a store the resolution splits among the threads
+    std::string ir = "define void @main() {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 10; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  %s" + std::to_string(i) + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s" + std::to_string(i) + "\n";
+    }
+    for (unsigned i = 0; i < 2000; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %q" + n + " = bitcast i32** %s" + std::to_string(i % 10) + " to i32**\n";
+        ir += "  %l" + n + " = load i32*, i32** %q" + n + "\n";
+    }
+    for (unsigned i = 0; i < 2000; ++i)
+        ir += "  store i32* %l" + std::to_string(i) + ", i32** %q" + std::to_string(i * 7 % 2000) + "\n";
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    Andersen worklist(*module);
+
+    ScopedOption<bool> wave("enable-wave");
+    ScopedOption<unsigned> threads("anders-threads");
+    wave->setValue(true);
+    Andersen sequential(*module);
+    threads->setValue(4);
+    Andersen parallel(*module);
+    threads->setValue(1);
+    wave->setValue(false);
+
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, waveSet, actual;
+        ASSERT_TRUE(worklist.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(sequential.getPointsToSet(&inst, waveSet));
+        ASSERT_TRUE(parallel.getPointsToSet(&inst, actual));
+        std::sort(expected.begin(), expected.end());
+        std::sort(waveSet.begin(), waveSet.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(expected, waveSet) << inst.getName().str();
+        EXPECT_EQ(expected, actual) << inst.getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, MatrixSolverTest) {
+    // Loads and stores that add copy edges over several rounds, more nodes than the matrix products split among the threads, and an indirect call through a pointer loaded from memory for the on-the-fly call graph
+    std::string ir = "define i32* @id(i32* %a) {\n"
+                     "  ret i32* %a\n"
+                     "}\n"
+                     "define void @main() {\n"
+                     "bb:\n"
+                     "  %f = alloca i32* (i32*)*, align 8\n"
+                     "  store i32* (i32*)* @id, i32* (i32*)** %f\n"
+                     "  %g = load i32* (i32*)*, i32* (i32*)** %f\n";
+    for (unsigned i = 0; i < 10; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  %s" + std::to_string(i) + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s" + std::to_string(i) + "\n";
+    }
+    for (unsigned i = 0; i < 600; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %l" + n + " = load i32*, i32** %s" + std::to_string(i * 7 % 10) + "\n";
+        ir += "  %c" + n + " = call i32* %g(i32* %l" + n + ")\n";
+        ir += "  store i32* %c" + n + ", i32** %s" + std::to_string(i * 3 % 10) + "\n";
+    }
+    ir += "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> matrix("anders-matrix-solver");
+    ScopedOption<bool> otf("enable-otf-callgraph");
+    ScopedOption<unsigned> threads("anders-threads");
+    for (bool onTheFly : { false, true }) {
+        otf->setValue(onTheFly);
+        Andersen worklist(*module);
+        matrix->setValue(true);
+        Andersen sequential(*module);
+        threads->setValue(4);
+        Andersen parallel(*module);
+        threads->setValue(1);
+        matrix->setValue(false);
+        otf->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> expected, sequentialSet, parallelSet;
+            bool known = worklist.getPointsToSet(v, expected);
+            EXPECT_EQ(known, sequential.getPointsToSet(v, sequentialSet)) << v->getName().str();
+            EXPECT_EQ(known, parallel.getPointsToSet(v, parallelSet)) << v->getName().str();
+            std::sort(expected.begin(), expected.end());
+            std::sort(sequentialSet.begin(), sequentialSet.end());
+            std::sort(parallelSet.begin(), parallelSet.end());
+            EXPECT_EQ(expected, sequentialSet) << v->getName().str();
+            EXPECT_EQ(expected, parallelSet) << v->getName().str();
+        }
+    }
+}
+
+TEST_F(AndersPassTest, PullPropagationTest) {
+    // Batches large enough to be split among the threads, with loads and stores that add copy edges between rounds, and copy cycles through the phis for LCD and HCD to collapse
+    std::string ir = "define void @main(i1 %c) {\n"
+                     "bb:\n";
+    for (unsigned i = 0; i < 10; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  %s" + std::to_string(i) + " = alloca i32*, align 8\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s" + std::to_string(i) + "\n";
+    }
+    for (unsigned i = 0; i < 1500; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %q" + n + " = bitcast i32** %s" + std::to_string(i % 10) + " to i32**\n";
+        ir += "  %l" + n + " = load i32*, i32** %q" + n + "\n";
+    }
+    for (unsigned i = 0; i < 1500; ++i)
+        ir += "  store i32* %l" + std::to_string(i) + ", i32** %q" + std::to_string(i * 7 % 1500) + "\n";
+    ir += "  br label %loop\n"
+          "loop:\n";
+    for (unsigned i = 0; i < 10; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %a" + n + " = phi i32** [ %s" + n + ", %bb ], [ %b" + n + ", %loop ]\n";
+    }
+    for (unsigned i = 0; i < 10; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %b" + n + " = select i1 %c, i32** %a" + n + ", i32** %a" + std::to_string((i + 1) % 10) + "\n";
+        ir += "  %m" + n + " = load i32*, i32** %b" + n + "\n";
+    }
+    ir += "  br i1 %c, label %loop, label %exit\n"
+          "exit:\n"
+          "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    Andersen push(*module);
+
+    ScopedOption<bool> pull("anders-pull-propagation");
+    ScopedOption<unsigned> threads("anders-threads");
+    ScopedOption<bool> lcd("enable-lcd");
+    ScopedOption<bool> hcd("enable-hcd");
+    // On one thread, on several, and with the cycles collapsed as the solving goes, which makes the merged nodes pull their predecessors' whole sets again
+    for (unsigned config = 0; config < 3; ++config) {
+        pull->setValue(true);
+        threads->setValue(config == 0 ? 1 : 4);
+        lcd->setValue(config == 2);
+        hcd->setValue(config == 2);
+        Andersen pulled(*module);
+        pull->setValue(false);
+        threads->setValue(1);
+        lcd->setValue(false);
+        hcd->setValue(false);
+
+        for (auto& inst : instructions(*module->getFunction("main"))) {
+            if (!inst.getType()->isPointerTy())
+                continue;
+            std::vector<const Value*> expected, actual;
+            ASSERT_TRUE(push.getPointsToSet(&inst, expected));
+            ASSERT_TRUE(pulled.getPointsToSet(&inst, actual)) << config;
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            EXPECT_EQ(expected, actual) << config << " " << inst.getName().str();
+        }
+    }
+}
+
+TEST_F(AndersPassTest, AutoConfigTest) {
+    // Mostly loads and stores, with a copy back to an earlier node through the loop
+    auto module = ParseAssembly(
+        "define void @main() {\n"
+        "bb:\n"
+        "  %x = alloca i32, align 4\n"
+        "  %y = alloca i32, align 4\n"
+        "  %s = alloca i32*, align 8\n"
+        "  store i32* %x, i32** %s\n"
+        "  br label %loop\n"
+        "loop:\n"
+        "  %p = phi i32* [ %y, %bb ], [ %l, %loop ]\n"
+        "  store i32* %p, i32** %s\n"
+        "  %l = load i32*, i32** %s\n"
+        "  br label %loop\n"
+        "}\n");
+    auto main = module->getFunction("main");
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*main))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+    Andersen plain(*module);
+    EXPECT_EQ(plain.getAutoConfig(), nullptr);
+
+    ScopedOption<bool> autoConfig("anders-auto-config");
+    ScopedOption<bool> hvn("enable-hvn");
+    ScopedOption<unsigned> hvnThreshold("anders-auto-hvn-constraints");
+    autoConfig->setValue(true);
+
+    // Too few constraints for the offline optimizations to pay off, but enough loads, stores and backward copies for the cycle detection
+    Andersen small(*module);
+    ASSERT_NE(small.getAutoConfig(), nullptr);
+    EXPECT_FALSE(small.getAutoConfig()->hvn);
+    EXPECT_FALSE(small.getAutoConfig()->hu);
+    EXPECT_TRUE(small.getAutoConfig()->hcd);
+    EXPECT_TRUE(small.getAutoConfig()->lcd);
+    std::string name;
+    raw_string_ostream os(name);
+    small.getAutoConfig()->print(os);
+    EXPECT_EQ(os.str(), "hcd+lcd");
+
+    unsigned defaultThreshold = hvnThreshold->getValue();
+    hvnThreshold->setValue(0);
+    Andersen withHVN(*module);
+    hvnThreshold->setValue(defaultThreshold);
+    autoConfig->setValue(false);
+    EXPECT_TRUE(withHVN.getAutoConfig()->hvn);
+    // The options are back to what they were
+    EXPECT_FALSE(hvn->getValue());
+
+    for (auto v : pointers) {
+        std::vector<const Value*> expected, smallSet, hvnSet;
+        ASSERT_TRUE(plain.getPointsToSet(v, expected));
+        ASSERT_TRUE(small.getPointsToSet(v, smallSet));
+        ASSERT_TRUE(withHVN.getPointsToSet(v, hvnSet));
+        std::sort(expected.begin(), expected.end());
+        std::sort(smallSet.begin(), smallSet.end());
+        std::sort(hvnSet.begin(), hvnSet.end());
+        EXPECT_EQ(expected, smallSet);
+        EXPECT_EQ(expected, hvnSet);
+    }
+}
+
+TEST_F(AndersPassTest, HotNodeReportTest) {
+    // %p is loaded from a slot every object is stored into, so it shares the largest set with the slot
+    std::string ir = "define void @main() {\n"
+                     "bb:\n"
+                     "  %s = alloca i32*, align 8\n";
+    for (unsigned i = 0; i < 5; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s\n";
+    }
+    ir += "  %p = load i32*, i32** %s\n"
+          "  %q = getelementptr i32, i32* %p, i64 1\n"
+          "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+
+    SmallString<128> fileName;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("anders", "hot", fileName));
+    ScopedOption<unsigned> hotNodes("anders-hot-nodes");
+    ScopedOption<std::string> hotNodeFile("anders-hot-nodes-file");
+    hotNodes->setValue(2);
+    hotNodeFile->setValue(fileName.str().str());
+    Andersen anders(*module);
+    hotNodes->setValue(0);
+    hotNodeFile->setValue("");
+
+    auto buffer = MemoryBuffer::getFile(fileName);
+    sys::fs::remove(fileName);
+    ASSERT_TRUE(bool(buffer));
+    StringRef report = (*buffer)->getBuffer();
+    auto section = [&report](StringRef title) {
+        size_t begin = report.find(title);
+        return begin == StringRef::npos ? StringRef() : report.substr(begin).split("\nTop").first;
+    };
+    StringRef bySize = section("Top nodes by points-to set size:");
+    EXPECT_TRUE(bySize.find("5  [V #") != StringRef::npos) << report.str();
+    EXPECT_TRUE(bySize.find("%p in @main") != StringRef::npos) << report.str();
+    EXPECT_TRUE(section("Top nodes by work list visits:").find("in @main") != StringRef::npos) << report.str();
+    EXPECT_TRUE(section("Top nodes by union work:").find("in @main") != StringRef::npos) << report.str();
+    // %s points to one object, and the object of %s, %p and %q to five
+    EXPECT_TRUE(report.find("  1: ") != StringRef::npos) << report.str();
+    EXPECT_TRUE(report.find("  4-7: 3\n") != StringRef::npos) << report.str();
+}
+
+TEST_F(AndersPassTest, FunctionCostReportTest) {
+    // @heavy stores five objects into a slot it finds through a global and loads them back, @light only one
+    std::string ir = "@slot = global i32* null\n"
+                     "@g = global i32** @slot\n"
+                     "define void @heavy() {\n"
+                     "bb:\n"
+                     "  %s = load i32**, i32*** @g\n";
+    for (unsigned i = 0; i < 5; ++i) {
+        ir += "  %x" + std::to_string(i) + " = alloca i32, align 4\n";
+        ir += "  store i32* %x" + std::to_string(i) + ", i32** %s\n";
+    }
+    ir += "  %p = load i32*, i32** %s\n"
+          "  %q = getelementptr i32, i32* %p, i64 1\n"
+          "  ret void\n"
+          "}\n"
+          "define void @light() {\n"
+          "bb:\n"
+          "  %s = load i32**, i32*** @g\n"
+          "  %x = alloca i32, align 4\n"
+          "  store i32* %x, i32** %s\n"
+          "  %p = load i32*, i32** %s\n"
+          "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+
+    SmallString<128> fileName;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("anders", "cost", fileName));
+    ScopedOption<unsigned> functionCost("anders-function-cost");
+    ScopedOption<std::string> functionCostFile("anders-function-cost-file");
+    ScopedOption<bool> hvn("enable-hvn");
+    // HVN merges %q into %p, whose tags it must carry along
+    for (bool withHVN : { false, true }) {
+        functionCost->setValue(3);
+        functionCostFile->setValue(fileName.str().str());
+        hvn->setValue(withHVN);
+        {
+            Andersen anders(*module);
+        }
+        functionCost->setValue(0);
+        functionCostFile->setValue("");
+        hvn->setValue(false);
+
+        auto buffer = MemoryBuffer::getFile(fileName);
+        ASSERT_TRUE(bool(buffer));
+        StringRef report = (*buffer)->getBuffer();
+        // The count of function in the section title, or 0 if it isn't listed
+        auto count = [&report](StringRef title, StringRef function) {
+            StringRef section = report.substr(report.find(title)).split("\n").second.split("\nTop").first;
+            SmallVector<StringRef, 8> lines;
+            section.split(lines, '\n');
+            for (auto line : lines) {
+                uint64_t n = 0;
+                if (line.endswith(function) && !line.trim().split(' ').first.getAsInteger(10, n))
+                    return n;
+            }
+            return uint64_t(0);
+        };
+        EXPECT_GT(count("Top functions by union work", "@heavy"), count("Top functions by union work", "@light")) << report.str();
+        EXPECT_GE(count("Top functions by copy edges added", "@heavy"), count("Top functions by copy edges added", "@light")) << report.str();
+        EXPECT_GT(count("Top functions by copy edges added", "@light"), 0u) << report.str();
+    }
+    sys::fs::remove(fileName);
+}
+
+TEST_F(AndersPassTest, MemoryUsageTest) {
+    auto module = ParseAssembly("define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  %q = getelementptr i32, i32* %p, i64 1\n"
+                                "  ret i32* %q\n"
+                                "}\n");
+
+    // Before the solving there is no graph yet, and while solving there is one. The callback runs inside the constructor, so it reaches the analysis through the storage it is built in
+    AndersMemoryUsage beforeGraph, whileSolving;
+    std::aligned_storage<sizeof(Andersen), alignof(Andersen)>::type storage;
+    Andersen* running = reinterpret_cast<Andersen*>(&storage);
+    AndersRunOptions options;
+    options.onProgress = [&](const AndersProgress& progress) {
+        if (progress.phase == AndersPhase::GraphBuild)
+            beforeGraph = running->getMemoryUsage();
+        else if (progress.phase == AndersPhase::Solving && whileSolving.getTotal() == 0)
+            whileSolving = running->getMemoryUsage();
+    };
+    Andersen& anders = *new (&storage) Andersen(*module, options);
+
+    EXPECT_GT(beforeGraph.nodes, 0u);
+    EXPECT_GT(beforeGraph.constraints, 0u);
+    EXPECT_EQ(beforeGraph.copyEdges, 0u);
+    EXPECT_GT(whileSolving.graphNodes, 0u);
+    EXPECT_GT(whileSolving.copyEdges + whileSolving.complexEdges, 0u);
+
+    // Once solved, the graph is gone and the points-to sets hold the results
+    AndersMemoryUsage after = anders.getMemoryUsage();
+    EXPECT_GT(after.nodes, 0u);
+    EXPECT_GT(after.ptsSets, 0u);
+    EXPECT_EQ(after.graphNodes, 0u);
+    EXPECT_EQ(after.hcdTable, 0u);
+    EXPECT_EQ(after.getTotal(), after.nodes + after.constraints + after.ptsSets);
+    anders.~Andersen();
+
+    std::string line;
+    raw_string_ostream os(line);
+    after.print(os);
+    EXPECT_TRUE(os.str().find("total=") != StringRef::npos) << os.str();
+
+    // Two bits in one 128-bit element, and one in another
+    SparseBitVector<> bits;
+    bits.set(1);
+    bits.set(2);
+    bits.set(300);
+    SparseBitVector<> one;
+    one.set(0);
+    EXPECT_EQ(getSparseBitVectorMemoryUsage(bits), 2 * getSparseBitVectorMemoryUsage(one));
+}
+
+TEST_F(AndersPassTest, PerfCountersTest) {
+    // Where the sandbox or the CPU offers no counter, there is nothing to count but the results must not change
+    AndersPerfCounters probe;
+    volatile unsigned sink = 0;
+    for (unsigned i = 0; i < 100000; ++i)
+        sink = sink + i;
+    AndersPerfCounts counts = probe.read();
+    if (counts.isAvailable(PerfInstructions))
+        EXPECT_GT(counts.get(PerfInstructions), 100000u);
+    std::string line;
+    raw_string_ostream lineStream(line);
+    counts.print(lineStream);
+    EXPECT_TRUE(lineStream.str().find("dtlb_misses=") != StringRef::npos) << lineStream.str();
+
+    auto module = ParseAssembly("define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %y\n"
+                                "  %p = load i32*, i32** %y\n"
+                                "  ret i32* %p\n"
+                                "}\n");
+    Andersen plain(*module);
+
+    SmallString<128> fileName;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("anders", "trace", fileName));
+    ScopedOption<bool> perfCounters("anders-perf-counters");
+    ScopedOption<std::string> traceFile("anders-trace");
+    perfCounters->setValue(true);
+    traceFile->setValue(fileName.str().str());
+    resetPhaseRecords();
+    Andersen counted(*module);
+    perfCounters->setValue(false);
+    traceFile->setValue("");
+
+    auto buffer = MemoryBuffer::getFile(fileName);
+    sys::fs::remove(fileName);
+    ASSERT_TRUE(bool(buffer));
+    StringRef trace = (*buffer)->getBuffer();
+    EXPECT_FALSE(trace.empty());
+    const AndersPhaseRecord& solving = getPhaseRecord(AndersPhase::Solving);
+    EXPECT_EQ(solving.counters.availableMask, counts.availableMask);
+    if (counts.isAvailable(PerfInstructions)) {
+        EXPECT_GT(getPhaseRecord(AndersPhase::Collection).counters.get(PerfInstructions), 0u);
+        EXPECT_GT(solving.counters.get(PerfInstructions), 0u);
+        EXPECT_TRUE(trace.find("\"instructions\":") != StringRef::npos) << trace.str();
+    } else {
+        EXPECT_TRUE(trace.find("\"instructions\":") == StringRef::npos) << trace.str();
+    }
+
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        ASSERT_TRUE(plain.getPointsToSet(&inst, expected));
+        ASSERT_TRUE(counted.getPointsToSet(&inst, actual));
+        EXPECT_EQ(expected, actual) << inst.getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, PartitionTest) {
+    // Functions that share nothing but the universal object: what one stores through an unknown address, the other loads through another one
+    std::string ir = "@g = global i32* null\n";
+    for (unsigned i = 0; i < 6; ++i) {
+        std::string n = std::to_string(i);
+        ir += "define i32* @f" + n + "(i64 %n) {\n"
+              "bb:\n"
+              "  %x = alloca i32, align 4\n"
+              "  %s = alloca i32*, align 8\n"
+              "  store i32* %x, i32** %s\n"
+              "  %p = load i32*, i32** %s\n"
+              "  %u = inttoptr i64 %n to i32**\n";
+        ir += i % 2 == 0 ? "  store i32* %p, i32** %u\n  ret i32* %p\n" : "  %q = load i32*, i32** %u\n  ret i32* %q\n";
+        ir += "}\n";
+    }
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& f : *module)
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy())
+                pointers.push_back(&inst);
+
+    ScopedOption<bool> partition("enable-partition");
+    ScopedOption<unsigned> threads("anders-threads");
+    Andersen whole(*module);
+    partition->setValue(true);
+    threads->setValue(2);
+    Andersen partitioned(*module);
+    threads->setValue(1);
+    partition->setValue(false);
+
+    for (auto v : pointers) {
+        std::vector<const Value*> wholeSet, partitionedSet;
+        // The loads through the unknown addresses may point to anything in both
+        EXPECT_EQ(whole.getPointsToSet(v, wholeSet), partitioned.getPointsToSet(v, partitionedSet));
+        std::sort(wholeSet.begin(), wholeSet.end());
+        std::sort(partitionedSet.begin(), partitionedSet.end());
+        EXPECT_EQ(wholeSet, partitionedSet);
+    }
+}
+
+TEST_F(AndersPassTest, DenseKernelTest) {
+    // Small functions that share nothing, not even the special nodes, with loads and stores through pointers to pointers and a cycle of copies in each
+    std::string ir;
+    for (unsigned i = 0; i < 8; ++i) {
+        std::string n = std::to_string(i);
+        ir += "define void @f" + n + "(i1 %c) {\n"
+              "bb:\n"
+              "  %x = alloca i32, align 4\n"
+              "  %y = alloca i32, align 4\n"
+              "  %s = alloca i32*, align 8\n"
+              "  %t = alloca i32*, align 8\n"
+              "  %u = alloca i32**, align 8\n"
+              "  store i32* %x, i32** %s\n"
+              "  store i32** %t, i32*** %u\n"
+              "  %p = load i32*, i32** %s\n"
+              "  %w = load i32**, i32*** %u\n"
+              "  store i32* %p, i32** %w\n"
+              "  br label %loop\n"
+              "loop:\n"
+              "  %a = phi i32* [ %y, %bb ], [ %b, %loop ]\n"
+              "  %b = select i1 %c, i32* %a, i32* %q\n"
+              "  %q = load i32*, i32** %t\n"
+              "  br i1 %c, label %loop, label %exit\n"
+              "exit:\n";
+        ir += i % 2 == 0 ? "  store i32* %b, i32** %s\n" : "  store i32* %b, i32** %t\n";
+        ir += "  ret void\n"
+              "}\n";
+    }
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& f : *module)
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy())
+                pointers.push_back(&inst);
+
+    ScopedOption<bool> partition("enable-partition");
+    ScopedOption<unsigned> kernelSize("anders-dense-kernel-size");
+    Andersen whole(*module);
+    partition->setValue(true);
+    Andersen dense(*module);
+    kernelSize->setValue(0);
+    Andersen sparse(*module);
+    kernelSize->setValue(256);
+    partition->setValue(false);
+
+    for (auto v : pointers) {
+        std::vector<const Value*> wholeSet, denseSet, sparseSet;
+        EXPECT_EQ(whole.getPointsToSet(v, wholeSet), dense.getPointsToSet(v, denseSet));
+        EXPECT_EQ(whole.getPointsToSet(v, wholeSet), sparse.getPointsToSet(v, sparseSet));
+        std::sort(wholeSet.begin(), wholeSet.end());
+        std::sort(denseSet.begin(), denseSet.end());
+        std::sort(sparseSet.begin(), sparseSet.end());
+        EXPECT_EQ(wholeSet, denseSet) << v->getName().str();
+        EXPECT_EQ(wholeSet, sparseSet) << v->getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, CopyReductionTest) {
+    // Copies into %c that are implied by two others, a cycle of copies that each imply the copy into the other, and loads and stores that add copies while solving
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define void @main(i1 %cond) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %s = alloca i32*\n"
+                                "  %b = bitcast i32* %x to i32*\n"
+                                "  %c = select i1 %cond, i32* %x, i32* %b\n"
+                                "  store i32* %c, i32** %s\n"
+                                "  br label %loop\n"
+                                "loop:\n"
+                                "  %p = phi i32* [ %y, %bb ], [ %q, %loop ]\n"
+                                "  %q = select i1 %cond, i32* %p, i32* %y\n"
+                                "  %l = load i32*, i32** %s\n"
+                                "  %m = select i1 %cond, i32* %l, i32* %q\n"
+                                "  store i32* %m, i32** @g\n"
+                                "  br i1 %cond, label %loop, label %exit\n"
+                                "exit:\n"
+                                "  %n = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> reduceCopies("anders-reduce-copies");
+    Andersen full(*module);
+    reduceCopies->setValue(true);
+    Andersen reduced(*module);
+    reduceCopies->setValue(false);
+
+    for (auto v : pointers) {
+        std::vector<const Value*> fullSet, reducedSet;
+        EXPECT_EQ(full.getPointsToSet(v, fullSet), reduced.getPointsToSet(v, reducedSet));
+        std::sort(fullSet.begin(), fullSet.end());
+        std::sort(reducedSet.begin(), reducedSet.end());
+        EXPECT_EQ(fullSet, reducedSet) << v->getName().str();
+    }
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(reduced.getPointsToSet(pointers.back(), ptsSet));
+    EXPECT_EQ(ptsSet.size(), 2u);
+}
+
+TEST_F(AndersPassTest, HubTest) {
+    // A loaded pointer with many copy successors that grows twice: most successors are idle, one is stored and loaded again, and one is the source of a copy that a load adds while solving
+    std::string ir = "define void @main(i1 %cond) {\n"
+                     "bb:\n"
+                     "  %a = alloca i32\n"
+                     "  %b = alloca i32\n"
+                     "  %s = alloca i32*\n"
+                     "  %t = alloca i32*\n"
+                     "  %u = alloca i32**\n"
+                     "  store i32* %a, i32** %s\n"
+                     "  %h = load i32*, i32** %s\n";
+    for (unsigned i = 0; i < 40; ++i)
+        ir += "  %c" + std::to_string(i) + " = bitcast i32* %h to i32*\n";
+    ir += "  store i32* %c0, i32** %t\n"
+          "  %l = load i32*, i32** %t\n"
+          "  store i32* %l, i32** %s\n"
+          "  store i32** %s, i32*** %u\n"
+          "  %w = load i32**, i32*** %u\n"
+          "  store i32* %c1, i32** %w\n"
+          "  store i32* %b, i32** %t\n"
+          "  ret void\n"
+          "}\n";
+    auto module = ParseAssembly(ir.c_str());
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<unsigned> hubDegree("anders-hub-degree");
+    Andersen full(*module);
+    hubDegree->setValue(8);
+    Andersen hubs(*module);
+    hubDegree->setValue(0);
+
+    for (auto v : pointers) {
+        std::vector<const Value*> fullSet, hubSet;
+        EXPECT_EQ(full.getPointsToSet(v, fullSet), hubs.getPointsToSet(v, hubSet));
+        std::sort(fullSet.begin(), fullSet.end());
+        std::sort(hubSet.begin(), hubSet.end());
+        EXPECT_EQ(fullSet, hubSet) << v->getName().str();
+    }
+    // %h gets %b through %t, %l and %s
+    std::vector<const Value*> ptsSet;
+    auto idle = std::find_if(pointers.begin(), pointers.end(), [](const Value* v) { return v->getName() == "c39"; });
+    ASSERT_TRUE(idle != pointers.end());
+    ASSERT_TRUE(hubs.getPointsToSet(*idle, ptsSet));
+    EXPECT_EQ(ptsSet.size(), 2u);
+}
+
+TEST_F(AndersPassTest, ConstraintStreamingTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @id(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret i32* %a\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %s\n"
+                                "  %p = load i32*, i32** %s\n"
+                                "  %q = call i32* @id(i32* %p)\n"
+                                "  %r = call i32* @id(i32* %y)\n"
+                                "  store i32* %r, i32** @g\n"
+                                "  %t = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    for (auto& f : *module)
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy())
+                pointers.push_back(&inst);
+
+    ScopedOption<bool> streaming("enable-constraint-streaming");
+    ScopedOption<unsigned> collectThreads("anders-collect-threads");
+    Andersen collected(*module);
+    // Committing the functions one at a time and in one batch per thread
+    for (unsigned threads = 1; threads <= 2; ++threads) {
+        streaming->setValue(true);
+        collectThreads->setValue(threads);
+        Andersen streamed(*module);
+        collectThreads->setValue(1);
+        streaming->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> collectedSet, streamedSet;
+            ASSERT_TRUE(collected.getPointsToSet(v, collectedSet));
+            ASSERT_TRUE(streamed.getPointsToSet(v, streamedSet));
+            std::sort(collectedSet.begin(), collectedSet.end());
+            std::sort(streamedSet.begin(), streamedSet.end());
+            EXPECT_EQ(collectedSet, streamedSet) << threads;
+        }
+    }
+}
+
+TEST_F(AndersPassTest, DenseValueNodesTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @pick(i32 %n, i32* %a, i32* %b) {\n"
+                                "bb:\n"
+                                "  %c = icmp eq i32 %n, 0\n"
+                                "  %r = select i1 %c, i32* %a, i32* %b\n"
+                                "  ret i32* %r\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %s\n"
+                                "  %p = load i32*, i32** %s\n"
+                                "  %q = call i32* @pick(i32 0, i32* %p, i32* %y)\n"
+                                "  store i32* %q, i32** @g\n"
+                                "  %t = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    for (auto& f : *module) {
+        for (auto& arg : f.args())
+            if (arg.getType()->isPointerTy())
+                pointers.push_back(&arg);
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy())
+                pointers.push_back(&inst);
+    }
+
+    ScopedOption<bool> dense("anders-dense-value-nodes");
+    ScopedOption<unsigned> collectThreads("anders-collect-threads");
+    Andersen mapped(*module);
+    for (unsigned threads = 1; threads <= 2; ++threads) {
+        dense->setValue(true);
+        collectThreads->setValue(threads);
+        Andersen indexed(*module);
+        collectThreads->setValue(1);
+        dense->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> mappedSet, indexedSet;
+            ASSERT_TRUE(mapped.getPointsToSet(v, mappedSet));
+            ASSERT_TRUE(indexed.getPointsToSet(v, indexedSet));
+            std::sort(mappedSet.begin(), mappedSet.end());
+            std::sort(indexedSet.begin(), indexedSet.end());
+            EXPECT_EQ(mappedSet, indexedSet) << threads;
+        }
+    }
+}
+
+TEST_F(AndersPassTest, CopyCoalescingTest) {
+    auto module = ParseAssembly("%pair = type { i32*, i32* }\n"
+                                "define i32* @main(i1 %c) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %s = alloca %pair, align 8\n"
+                                "  %f = getelementptr %pair, %pair* %s, i32 0, i32 1\n"
+                                "  store i32* %x, i32** %f\n"
+                                "  %b = bitcast %pair* %s to i32**\n"
+                                "  %l = load i32*, i32** %b\n"
+                                "  %same = select i1 %c, i32* %l, i32* %l\n"
+                                "  %either = select i1 %c, i32* %same, i32* %y\n"
+                                "  br label %loop\n"
+                                "loop:\n"
+                                "  %p = phi i32* [ %same, %bb ], [ %p, %loop ]\n"
+                                "  br i1 %c, label %loop, label %exit\n"
+                                "exit:\n"
+                                "  %q = phi i32* [ %p, %loop ]\n"
+                                "  store i32* %either, i32** %f\n"
+                                "  ret i32* %q\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    for (auto& inst : instructions(*module->begin()))
+        if (inst.getType()->isPointerTy())
+            pointers.push_back(&inst);
+
+    ScopedOption<bool> coalesce("anders-coalesce-copies");
+    ScopedOption<bool> fieldSensitive("anders-field-sensitive");
+    // Field-sensitively, %f moves to another field and stays apart from %s
+    for (bool fields : {false, true}) {
+        fieldSensitive->setValue(fields);
+        Andersen copied(*module);
+        coalesce->setValue(true);
+        Andersen coalesced(*module);
+        coalesce->setValue(false);
+        fieldSensitive->setValue(false);
+
+        for (auto v : pointers) {
+            std::vector<const Value*> copiedSet, coalescedSet;
+            ASSERT_TRUE(copied.getPointsToSet(v, copiedSet));
+            ASSERT_TRUE(coalesced.getPointsToSet(v, coalescedSet));
+            std::sort(copiedSet.begin(), copiedSet.end());
+            std::sort(coalescedSet.begin(), coalescedSet.end());
+            EXPECT_EQ(copiedSet, coalescedSet) << fields;
+        }
+    }
+}
+
+TEST_F(AndersPassTest, DuplicateConstraintTest) {
+    // %p has the same incoming value along two edges, %a is passed to both targets of %f, and %x to two unresolved calls. The heap object of @f1 is created while collecting a function that comes before @main
+    auto module = ParseAssembly("@fp = global void (i32*)* @f1\n"
+                                "declare void @unknown(i32*)\n"
+                                "declare noalias i8* @malloc(i64)\n"
+                                "define void @f1(i32* %a) {\n"
+                                "bb:\n"
+                                "  %m = call i8* @malloc(i64 8)\n"
+                                "  %s = bitcast i8* %m to i32**\n"
+                                "  store i32* %a, i32** %s\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @f2(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main(i1 %c) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  store void (i32*)* @f2, void (i32*)** @fp\n"
+                                "  br i1 %c, label %left, label %right\n"
+                                "left:\n"
+                                "  br label %join\n"
+                                "right:\n"
+                                "  br label %join\n"
+                                "join:\n"
+                                "  %p = phi i32* [ %x, %left ], [ %x, %right ], [ %x, %bb ]\n"
+                                "  %f = load void (i32*)*, void (i32*)** @fp\n"
+                                "  call void %f(i32* %p)\n"
+                                "  call void @unknown(i32* %x)\n"
+                                "  call void @unknown(i32* %x)\n"
+                                "  ret void\n"
+                                "}\n");
+    SmallString<128> fileName;
+    ASSERT_FALSE(sys::fs::createTemporaryFile("anders", "cons", fileName));
+
+    // The constraints collected with one thread and with several, as they are handed to the optimizers. The nodes are numbered the same way whatever the number of threads, so the files are the same too, with the nodes packed by -anders-renumber and in the order they were created
+    ScopedOption<std::string> writeConstraints("anders-write-constraints");
+    ScopedOption<unsigned> collectThreads("anders-collect-threads");
+    ScopedOption<bool> renumber("anders-renumber");
+    writeConstraints->setValue(fileName.str().str());
+    std::vector<std::string> files;
+    for (unsigned config = 0; config < 6; ++config) {
+        collectThreads->setValue(config % 3 + 1);
+        renumber->setValue(config < 3);
+        Andersen anders(*module);
+
+        std::string error;
+        auto buffer = MemoryBuffer::getFile(fileName);
+        ASSERT_TRUE(bool(buffer));
+        files.push_back((*buffer)->getBuffer().str());
+        auto reader = ConstraintFileReader::open(std::move(*buffer), error);
+        ASSERT_TRUE(reader != nullptr) << error;
+        ASSERT_GT(reader->getNumConstraints(), 0u);
+        for (size_t i = 1; i < reader->getNumConstraints(); ++i)
+            EXPECT_LT(reader->getConstraint(i - 1), reader->getConstraint(i));
+    }
+    for (unsigned config = 0; config < files.size(); ++config)
+        EXPECT_TRUE(files[config] == files[config / 3 * 3]) << config;
+    collectThreads->setValue(1);
+    writeConstraints->setValue("");
+    sys::fs::remove(fileName);
+}
+
+TEST_F(AndersPassTest, DirectStackAccessTest) {
+    // %s is accessed directly, %t escapes into @set, and %u is used before the alloca in the layout
+    auto module = ParseAssembly("@g = global i32 0\n"
+                                "define void @set(i32** %p) {\n"
+                                "bb:\n"
+                                "  store i32* @g, i32** %p\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define i32* @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  %t = alloca i32*, align 8\n"
+                                "  store i32* %x, i32** %s\n"
+                                "  %a = load i32*, i32** %s\n"
+                                "  store i32* %a, i32** %t\n"
+                                "  call void @set(i32** %t)\n"
+                                "  %b = load i32*, i32** %t\n"
+                                "  br label %late\n"
+                                "use:\n"
+                                "  store i32* %b, i32** %u\n"
+                                "  %c = load i32*, i32** %u\n"
+                                "  ret i32* %c\n"
+                                "late:\n"
+                                "  %u = alloca i32*, align 8\n"
+                                "  br label %use\n"
+                                "}\n");
+    std::vector<const Value*> pointers;
+    const Value* c = nullptr;
+    for (auto& f : *module)
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy()) {
+                pointers.push_back(&inst);
+                if (inst.getName() == "c")
+                    c = &inst;
+            }
+    ASSERT_TRUE(c != nullptr);
+
+    ScopedOption<bool> direct("anders-direct-stack-access");
+    Andersen indirect(*module);
+    direct->setValue(true);
+    Andersen lowered(*module);
+    direct->setValue(false);
+
+    for (auto v : pointers) {
+        std::vector<const Value*> indirectSet, loweredSet;
+        ASSERT_TRUE(indirect.getPointsToSet(v, indirectSet));
+        ASSERT_TRUE(lowered.getPointsToSet(v, loweredSet));
+        std::sort(indirectSet.begin(), indirectSet.end());
+        std::sort(loweredSet.begin(), loweredSet.end());
+        EXPECT_EQ(indirectSet, loweredSet);
+    }
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(lowered.getPointsToSet(c, ptsSet));
+    EXPECT_EQ(ptsSet.size(), 2u);
+}
+
+TEST_F(AndersPassTest, DeadPointerElimTest) {
+    auto module = ParseAssembly("define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %s = alloca i32*, align 8\n"
+                                "  %p = bitcast i32* %x to i8*\n"
+                                "  %q = getelementptr i8, i8* %p, i64 1\n"
+                                "  store i32* %x, i32** %s\n"
+                                "  %l = load i32*, i32** %s\n"
+                                "  %m = load i32*, i32** %s\n"
+                                "  store i32* %m, i32** %s\n"
+                                "  ret void\n"
+                                "}\n");
+    auto f = module->begin();
+    auto itr = f->begin()->begin();
+    auto x = &*itr;
+    auto s = &*++itr;
+    auto p = &*++itr;
+    auto q = &*++itr;
+    ++itr;
+    auto l = &*++itr;
+    auto m = &*++itr;
+
+    Andersen full(*module);
+    auto sameAsFull = [&full](const Andersen& pruned, const Value* v) {
+        std::vector<const Value*> fullSet, prunedSet;
+        if (!full.getPointsToSet(v, fullSet) || !pruned.getPointsToSet(v, prunedSet))
+            return false;
+        std::sort(fullSet.begin(), fullSet.end());
+        std::sort(prunedSet.begin(), prunedSet.end());
+        return fullSet == prunedSet;
+    };
+    std::vector<const Value*> ptsSet;
+
+    // Nothing reads %p, %q or %l, so the analysis forgets them
+    ScopedOption<bool> dpe("enable-dead-pointer-elim");
+    dpe->setValue(true);
+    Andersen pruned(*module);
+    dpe->setValue(false);
+    for (auto v : {x, s, m})
+        EXPECT_TRUE(sameAsFull(pruned, v));
+    for (auto v : {p, q, l})
+        EXPECT_FALSE(pruned.getPointsToSet(v, ptsSet));
+
+    // Unless they are asked about
+    std::string error;
+    auto queried = Andersen::createForQueries(*module, {q}, error);
+    ASSERT_TRUE(queried != nullptr) << error;
+    for (auto v : {x, s, m, p, q})
+        EXPECT_TRUE(sameAsFull(*queried, v));
+    EXPECT_FALSE(queried->getPointsToSet(l, ptsSet));
+}
+
+TEST_F(AndersPassTest, ScopeTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define i32* @make(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret i32* %a\n"
+                                "}\n"
+                                "define void @other(i32* %o) {\n"
+                                "bb:\n"
+                                "  %v = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %z = alloca i32, align 4\n"
+                                "  %r = call i32* @make(i32* %x)\n"
+                                "  call void @other(i32* %z)\n"
+                                "  %y = load i32*, i32** @g\n"
+                                "  ret void\n"
+                                "}\n");
+    auto make = module->getFunction("make");
+    auto other = module->getFunction("other");
+    auto mainFunc = module->getFunction("main");
+    auto itr = mainFunc->begin()->begin();
+    const Value* x = &*itr;
+    const Value* z = &*++itr;
+    const Value* r = &*++itr;
+    ++itr;
+    const Value* y = &*++itr;
+    const Value* o = &*other->arg_begin();
+
+    Andersen full(*module);
+    auto sameAsFull = [&full](const Andersen& scoped, const Value* v) {
+        std::vector<const Value*> fullSet, scopedSet;
+        if (!full.getPointsToSet(v, fullSet) || !scoped.getPointsToSet(v, scopedSet))
+            return false;
+        std::sort(fullSet.begin(), fullSet.end());
+        std::sort(scopedSet.begin(), scopedSet.end());
+        return fullSet == scopedSet;
+    };
+    std::vector<const Value*> ptsSet;
+
+    // @other is out of the scope, and is called like an unknown external function: the analysis knows nothing about its values, what it is given may point to anything, and it may have written anything into @g
+    AndersRunOptions options;
+    options.scope = {mainFunc, make};
+    Andersen scoped(*module, options);
+    for (auto v : {x, r})
+        EXPECT_TRUE(sameAsFull(scoped, v));
+    for (auto v : {z, o, y})
+        EXPECT_FALSE(scoped.getPointsToSet(v, ptsSet));
+
+    // Without @make, its value is unknown to the call
+    options.scope = {mainFunc};
+    Andersen narrow(*module, options);
+    EXPECT_FALSE(narrow.getPointsToSet(r, ptsSet));
+
+    // Everything @main reaches is the whole module
+    options.scopeReachable = true;
+    Andersen reachable(*module, options);
+    for (auto v : {x, z, r, y, o})
+        EXPECT_TRUE(sameAsFull(reachable, v));
+}
+
+TEST_F(AndersPassTest, LazyMaterializationTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "@fp = global i32* (i32*)* null\n"
+                                "declare i8* @malloc(i64)\n"
+                                "define i32* @id(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret i32* %a\n"
+                                "}\n"
+                                "define i32* @id2(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret i32* %a\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %m = call i8* @malloc(i64 4)\n"
+                                "  %y = bitcast i8* %m to i32*\n"
+                                "  store i32* (i32*)* @id2, i32* (i32*)** @fp\n"
+                                "  %f = load i32* (i32*)*, i32* (i32*)** @fp\n"
+                                "  %p = call i32* @id(i32* %x)\n"
+                                "  %q = call i32* %f(i32* %y)\n"
+                                "  store i32* %q, i32** @g\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define i32* @later() {\n"
+                                "bb:\n"
+                                "  %r = load i32*, i32** @g\n"
+                                "  %s = call i32* @id(i32* %r)\n"
+                                "  ret i32* %s\n"
+                                "}\n");
+    Andersen anders(*module);
+    std::string expected;
+    raw_string_ostream expectedOs(expected);
+    anders.writeSolvedResults(*module, expectedOs);
+    expectedOs.flush();
+
+    std::string bitcode;
+    raw_string_ostream bitcodeOs(bitcode);
+    WriteBitcodeToFile(module, bitcodeOs);
+    bitcodeOs.flush();
+
+    // The bodies are only read as they are materialized, so only @id2, whose address is taken in the body of @main, is found by the scan
+    LLVMContext lazyCtx;
+    auto scanned = getLazyBitcodeModule(MemoryBufferRef(bitcode, "lazy"), lazyCtx);
+    ASSERT_TRUE(bool(scanned)) << toString(scanned.takeError());
+    EXPECT_FALSE((*scanned)->getFunction("id2")->hasAddressTaken());
+    BitVector addressTaken;
+    std::string error;
+    ASSERT_TRUE(Andersen::findAddressTakenFunctions(**scanned, addressTaken, error)) << error;
+    EXPECT_EQ(addressTaken.count(), 1u);
+
+    auto lazyModule = getLazyBitcodeModule(MemoryBufferRef(bitcode, "lazy"), lazyCtx);
+    ASSERT_TRUE(bool(lazyModule)) << toString(lazyModule.takeError());
+    auto lazy = Andersen::createLazily(**lazyModule, addressTaken, error);
+    ASSERT_TRUE(lazy != nullptr) << error;
+    EXPECT_TRUE((*lazyModule)->getFunction("main")->empty());
+
+    // The same nodes and sets as the analysis of the whole module, recorded for the same walk of the module
+    std::string actual;
+    raw_string_ostream actualOs(actual);
+    lazy->writeSolvedResults(**lazyModule, actualOs);
+    actualOs.flush();
+    EXPECT_EQ(actual, expected);
+
+    auto results = PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(actual), *module, error);
+    ASSERT_TRUE(results != nullptr) << error;
+    for (auto& f : *module)
+        for (auto& inst : instructions(f))
+            if (inst.getType()->isPointerTy()) {
+                std::vector<const Value*> expectedSet, actualSet;
+                EXPECT_EQ(results->getPointsToSet(&inst, actualSet), anders.getPointsToSet(&inst, expectedSet));
+                EXPECT_EQ(actualSet, expectedSet);
+            }
+
+    // With the bodies materialized ahead on a thread of their own, one at a time and then in batches collected on two threads
+    ScopedOption<unsigned> prefetch("anders-lazy-prefetch");
+    ScopedOption<unsigned> collectThreads("anders-collect-threads");
+    for (unsigned threads : {1, 2}) {
+        auto prefetchedModule = getLazyBitcodeModule(MemoryBufferRef(bitcode, "lazy"), lazyCtx);
+        ASSERT_TRUE(bool(prefetchedModule)) << toString(prefetchedModule.takeError());
+        prefetch->setValue(2);
+        collectThreads->setValue(threads);
+        auto prefetched = Andersen::createLazily(**prefetchedModule, addressTaken, error);
+        prefetch->setValue(0);
+        collectThreads->setValue(1);
+        ASSERT_TRUE(prefetched != nullptr) << error;
+        for (auto& f : **prefetchedModule)
+            EXPECT_TRUE(f.empty()) << f.getName().str();
+
+        std::string prefetchedResults;
+        raw_string_ostream prefetchedOs(prefetchedResults);
+        prefetched->writeSolvedResults(**prefetchedModule, prefetchedOs);
+        prefetchedOs.flush();
+        if (threads == 1)
+            EXPECT_EQ(prefetchedResults, expected);
+        auto loaded = PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(prefetchedResults), *module, error);
+        ASSERT_TRUE(loaded != nullptr) << error;
+        for (auto& f : *module)
+            for (auto& inst : instructions(f))
+                if (inst.getType()->isPointerTy()) {
+                    std::vector<const Value*> expectedSet, actualSet;
+                    EXPECT_EQ(loaded->getPointsToSet(&inst, actualSet), anders.getPointsToSet(&inst, expectedSet)) << threads;
+                    EXPECT_EQ(actualSet, expectedSet) << threads;
+                }
+    }
+}
+
+TEST_F(AndersPassTest, ConstraintSummaryTest) {
+    const char* mainAsm = "@g = global i32* null\n"
+                          "@fp = external global i32* (i32*)*\n"
+                          "declare i32* @id(i32*)\n"
+                          "declare i8* @malloc(i64)\n"
+                          "declare void @put(i32**, i32*)\n"
+                          "define void @main() {\n"
+                          "bb:\n"
+                          "  %x = alloca i32, align 4\n"
+                          "  %y = alloca i32, align 4\n"
+                          "  %p = call i32* @id(i32* %x)\n"
+                          "  %m = call i8* @malloc(i64 4)\n"
+                          "  %z = bitcast i8* %m to i32*\n"
+                          "  %f = load i32* (i32*)*, i32* (i32*)** @fp\n"
+                          "  %q = call i32* %f(i32* %y)\n"
+                          "  call void @put(i32** @g, i32* %z)\n"
+                          "  %r = load i32*, i32** @g\n"
+                          "  ret void\n"
+                          "}\n";
+    const char* libAsm = "@fp = global i32* (i32*)* @other\n"
+                         "@g = external global i32*\n"
+                         "define i32* @id(i32* %a) {\n"
+                         "bb:\n"
+                         "  ret i32* %a\n"
+                         "}\n"
+                         "define internal i32* @other(i32* %a) {\n"
+                         "bb:\n"
+                         "  ret i32* %a\n"
+                         "}\n"
+                         "define void @put(i32** %d, i32* %v) {\n"
+                         "bb:\n"
+                         "  store i32* %v, i32** %d\n"
+                         "  ret void\n"
+                         "}\n";
+    // What llvm-link would make of the two
+    auto combined = ParseAssembly("@g = global i32* null\n"
+                                  "@fp = global i32* (i32*)* @other\n"
+                                  "declare i8* @malloc(i64)\n"
+                                  "define void @main() {\n"
+                                  "bb:\n"
+                                  "  %x = alloca i32, align 4\n"
+                                  "  %y = alloca i32, align 4\n"
+                                  "  %p = call i32* @id(i32* %x)\n"
+                                  "  %m = call i8* @malloc(i64 4)\n"
+                                  "  %z = bitcast i8* %m to i32*\n"
+                                  "  %f = load i32* (i32*)*, i32* (i32*)** @fp\n"
+                                  "  %q = call i32* %f(i32* %y)\n"
+                                  "  call void @put(i32** @g, i32* %z)\n"
+                                  "  %r = load i32*, i32** @g\n"
+                                  "  ret void\n"
+                                  "}\n"
+                                  "define i32* @id(i32* %a) {\n"
+                                  "bb:\n"
+                                  "  ret i32* %a\n"
+                                  "}\n"
+                                  "define internal i32* @other(i32* %a) {\n"
+                                  "bb:\n"
+                                  "  ret i32* %a\n"
+                                  "}\n"
+                                  "define void @put(i32** %d, i32* %v) {\n"
+                                  "bb:\n"
+                                  "  store i32* %v, i32** %d\n"
+                                  "  ret void\n"
+                                  "}\n");
+    Andersen anders(*combined);
+
+    LLVMContext moduleCtx;
+    SMDiagnostic diag;
+    auto mainModule = parseAssemblyString(mainAsm, diag, moduleCtx);
+    auto libModule = parseAssemblyString(libAsm, diag, moduleCtx);
+    ASSERT_TRUE(mainModule && libModule);
+
+    std::string error;
+    std::vector<std::unique_ptr<ConstraintSummary>> summaries;
+    for (Module* m : { mainModule.get(), libModule.get() }) {
+        auto summary = Andersen::summarize(*m, error);
+        ASSERT_TRUE(summary != nullptr) << error;
+
+        // A summary reads back as it was written
+        std::string bytes, rewritten;
+        raw_string_ostream os(bytes), rewrittenOs(rewritten);
+        summary->write(os);
+        os.flush();
+        summaries.push_back(ConstraintSummary::read(*MemoryBuffer::getMemBuffer(bytes, "", false), error));
+        ASSERT_TRUE(summaries.back() != nullptr) << error;
+        summaries.back()->write(rewrittenOs);
+        rewrittenOs.flush();
+        EXPECT_EQ(rewritten, bytes);
+        EXPECT_TRUE(ConstraintSummary::read(*MemoryBuffer::getMemBuffer(bytes.substr(0, bytes.size() - 1), "", false), error) == nullptr);
+    }
+    EXPECT_TRUE(ConstraintSummary::read(*MemoryBuffer::getMemBuffer("garbage", "", false), error) == nullptr);
+
+    auto linked = Andersen::createFromSummaries({ summaries[0].get(), summaries[1].get() }, error);
+    ASSERT_TRUE(linked != nullptr) << error;
+    std::string bytes;
+    raw_string_ostream os(bytes);
+    ASSERT_TRUE(linked->writeModuleResults(0, *mainModule, os, error)) << error;
+    os.flush();
+    std::string wrongModule;
+    raw_string_ostream wrongOs(wrongModule);
+    EXPECT_FALSE(linked->writeModuleResults(1, *mainModule, wrongOs, error));
+    auto results = PersistedAndersResults::load(MemoryBuffer::getMemBufferCopy(bytes), *mainModule, error);
+    ASSERT_TRUE(results != nullptr) << error;
+
+    // The same points-to sets as the analysis of the linked module, less what only the other module has (@other)
+    auto getNames = [&mainModule](const std::vector<const Value*>& ptsSet) {
+        std::vector<std::string> names;
+        for (auto v : ptsSet)
+            if (mainModule->getNamedValue(v->getName()) || (isa<Instruction>(v) && cast<Instruction>(v)->getFunction()->getName() == "main"))
+                names.push_back(v->getName().str());
+        std::sort(names.begin(), names.end());
+        return names;
+    };
+    auto getMainInst = [](Module& m, StringRef name) -> const Value* {
+        for (auto& inst : instructions(*m.getFunction("main")))
+            if (inst.getName() == name)
+                return &inst;
+        return nullptr;
+    };
+    const char* pointers[] = { "x", "y", "p", "m", "z", "f", "q", "r" };
+    for (auto name : pointers) {
+        std::vector<const Value*> expected, actual;
+        EXPECT_EQ(results->getPointsToSet(getMainInst(*mainModule, name), actual), anders.getPointsToSet(getMainInst(*combined, name), expected)) << name;
+        EXPECT_EQ(getNames(actual), getNames(expected)) << name;
+    }
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(results->getPointsToSet(getMainInst(*mainModule, "p"), ptsSet));
+    EXPECT_EQ(getNames(ptsSet), std::vector<std::string>{ "x" });
+    ASSERT_TRUE(results->getPointsToSet(getMainInst(*mainModule, "r"), ptsSet));
+    EXPECT_EQ(getNames(ptsSet), std::vector<std::string>{ "m" });
+    EXPECT_EQ(results->alias(getMainInst(*mainModule, "p"), getMainInst(*mainModule, "z")), NoAlias);
+    EXPECT_EQ(results->alias(getMainInst(*mainModule, "r"), getMainInst(*mainModule, "z")), MayAlias);
+}
+
+TEST_F(AndersPassTest, ModRefTest) {
+    auto module = ParseAssembly("@a = global i32 0\n"
+                                "@b = global i32 0\n"
+                                "@c = global i32 0\n"
+                                "@fp = global void ()* null\n"
+                                "declare void @opaque(i32*)\n"
+                                "declare i32 @strlen(i32*) readonly\n"
+                                "declare i8* @memmove(i8*, i8*, i64)\n"
+                                "define void @writeA() {\n"
+                                "bb:\n"
+                                "  store i32 1, i32* @a\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @readB() {\n"
+                                "bb:\n"
+                                "  %v = load i32, i32* @b\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @even(i32 %n) {\n"
+                                "bb:\n"
+                                "  call void @odd(i32 %n)\n"
+                                "  call void @writeA()\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @odd(i32 %n) {\n"
+                                "bb:\n"
+                                "  call void @even(i32 %n)\n"
+                                "  call void @readB()\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  call void @writeA()\n"
+                                "  call void @even(i32 0)\n"
+                                "  store void ()* @readB, void ()** @fp\n"
+                                "  %f = load void ()*, void ()** @fp\n"
+                                "  call void %f()\n"
+                                "  %n = call i32 @strlen(i32* @c)\n"
+                                "  %m = call i8* @memmove(i8* bitcast (i32* @a to i8*), i8* bitcast (i32* @c to i8*), i64 4)\n"
+                                "  %o = alloca i32\n"
+                                "  call void @opaque(i32* %o)\n"
+                                "  ret void\n"
+                                "}\n");
+    AndersenAAResult aa(*module);
+    std::vector<ImmutableCallSite> calls;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (ImmutableCallSite cs = ImmutableCallSite(&inst))
+            calls.push_back(cs);
+    ASSERT_EQ(calls.size(), 6u);
+
+    auto modRef = [&](unsigned call, const char* global) {
+        return aa.getModRefInfo(calls[call], MemoryLocation(module->getNamedValue(global), 4));
+    };
+    EXPECT_EQ(modRef(0, "a"), MRI_Mod);
+    EXPECT_EQ(modRef(0, "b"), MRI_NoModRef);
+    // The two functions of the cycle share what they do and what their callees do
+    EXPECT_EQ(modRef(1, "a"), MRI_Mod);
+    EXPECT_EQ(modRef(1, "b"), MRI_Ref);
+    EXPECT_EQ(modRef(1, "c"), MRI_NoModRef);
+    // The indirect call may only reach @readB
+    EXPECT_EQ(modRef(2, "a"), MRI_NoModRef);
+    EXPECT_EQ(modRef(2, "b"), MRI_Ref);
+    // The library functions touch what their arguments point to
+    EXPECT_EQ(modRef(3, "c"), MRI_Ref);
+    EXPECT_EQ(modRef(3, "a"), MRI_NoModRef);
+    EXPECT_EQ(modRef(4, "a"), MRI_Mod);
+    EXPECT_EQ(modRef(4, "c"), MRI_Ref);
+    EXPECT_EQ(modRef(4, "b"), MRI_NoModRef);
+    // An unknown function may touch anything
+    EXPECT_EQ(modRef(5, "b"), MRI_ModRef);
+}
+
+TEST_F(AndersPassTest, FrozenResultsTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "declare i32* @unknown()\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %p = alloca i32*\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  store i32* %y, i32** @g\n"
+                                "  %a = load i32*, i32** %p\n"
+                                "  %b = load i32*, i32** @g\n"
+                                "  %c = select i1 true, i32* %a, i32* %b\n"
+                                "  %u = call i32* @unknown()\n"
+                                "  ret void\n"
+                                "}\n");
+    AndersenAAResult aa(*module);
+    std::shared_ptr<const AndersFrozenResults> frozen = aa.getFrozenResults();
+
+    std::vector<const Value*> values;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (inst.getType()->isPointerTy())
+            values.push_back(&inst);
+    values.push_back(module->getNamedValue("g"));
+    auto x = values[0], y = values[1], a = values[3], b = values[4],
+         c = values[5], u = values[6];
+    EXPECT_EQ(frozen->alias(a, b), NoAlias);
+    EXPECT_EQ(frozen->alias(a, c), MayAlias);
+    EXPECT_EQ(frozen->alias(u, a), MayAlias);
+    EXPECT_TRUE(frozen->mayPointTo(a, x));
+    EXPECT_FALSE(frozen->mayPointTo(a, y));
+    EXPECT_TRUE(frozen->mayPointTo(c, y));
+    EXPECT_TRUE(frozen->mayPointTo(u, y));
+
+    // The view answers as the result does, from any number of threads at once
+    std::vector<AliasResult> expected;
+    for (auto v1 : values)
+        for (auto v2 : values) {
+            expected.push_back(aa.alias(MemoryLocation(v1, 4), MemoryLocation(v2, 4)));
+            if (v1 != v2)
+                EXPECT_EQ(frozen->alias(v1, v2), expected.back());
+        }
+    std::atomic<unsigned> mismatches(0);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < 4; ++t)
+        threads.emplace_back([&] {
+            for (unsigned round = 0; round < 1000; ++round) {
+                unsigned i = 0;
+                for (auto v1 : values)
+                    for (auto v2 : values) {
+                        if (v1 != v2 && frozen->alias(v1, v2) != expected[i])
+                            ++mismatches;
+                        ++i;
+                    }
+            }
+        });
+    for (auto& thread : threads)
+        thread.join();
+    EXPECT_EQ(mismatches, 0u);
+}
+
+TEST_F(AndersPassTest, AliasClassTest) {
+    auto module = ParseAssembly("declare i8* @unknown()\n"
+                                "define void @main(i1 %c) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %z = alloca i32\n"
+                                "  %w = alloca i32\n"
+                                "  %p = select i1 %c, i32* %x, i32* %y\n"
+                                "  %q = select i1 %c, i32* %y, i32* %z\n"
+                                "  %n = select i1 %c, i32* null, i32* null\n"
+                                "  %u = call i8* @unknown()\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    auto value = [&module](StringRef name) -> const Value* {
+        Function* f = module->getFunction("main");
+        for (auto& inst : instructions(*f))
+            if (inst.getName() == name)
+                return &inst;
+        return f->getArg(0);
+    };
+
+    // %p and %q share no set but have %y in common, so %x, %y, %z, %p and %q are all in one class, and %w in another
+    unsigned cls = anders.getAliasClass(value("p"));
+    ASSERT_LT(cls, anders.getNumAliasClasses());
+    EXPECT_EQ(anders.getAliasClass(value("q")), cls);
+    EXPECT_EQ(anders.getAliasClass(value("x")), cls);
+    EXPECT_EQ(anders.getAliasClass(value("z")), cls);
+    EXPECT_NE(anders.getAliasClass(value("w")), cls);
+    EXPECT_LT(anders.getAliasClass(value("w")), anders.getNumAliasClasses());
+    EXPECT_EQ(anders.getAliasClass(value("n")), Andersen::NoAliasClass);
+    EXPECT_EQ(anders.getAliasClass(value("u")), Andersen::UniversalAliasClass);
+    // %c is not a pointer
+    EXPECT_EQ(anders.getAliasClass(value("c")), Andersen::UniversalAliasClass);
+}
+
+TEST_F(AndersPassTest, AliasMetadataTest) {
+    auto module = ParseAssembly("declare i32* @unknown()\n"
+                                "define void @main(i1 %c) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %z = alloca i32\n"
+                                "  %p = select i1 %c, i32* %x, i32* %y\n"
+                                "  %u = call i32* @unknown()\n"
+                                "  %a = load i32, i32* %x\n"
+                                "  %b = load i32, i32* %y\n"
+                                "  %d = load i32, i32* %p\n"
+                                "  %e = load i32, i32* %u\n"
+                                "  %f = load i32, i32* %z\n"
+                                "  store i32 0, i32* %x\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    Function* f = module->getFunction("main");
+    auto getInst = [f](StringRef name) -> Instruction* {
+        for (auto& inst : instructions(*f))
+            if (inst.getName() == name)
+                return &inst;
+        return nullptr;
+    };
+    // The scoped noalias rule for a single domain: the accesses are noalias if the scopes of one are all in the noalias list of the other
+    auto noAlias = [](const Instruction* i1, const Instruction* i2) {
+        auto covers = [](const Instruction* scoped, const Instruction* other) {
+            MDNode* scopes = scoped->getMetadata(LLVMContext::MD_alias_scope);
+            MDNode* noAliases = other->getMetadata(LLVMContext::MD_noalias);
+            if (scopes == nullptr || noAliases == nullptr)
+                return false;
+            for (auto& scope : scopes->operands())
+                if (std::find(noAliases->op_begin(), noAliases->op_end(), scope.get()) == noAliases->op_end())
+                    return false;
+            return true;
+        };
+        return covers(i1, i2) || covers(i2, i1);
+    };
+
+    ScopedOption<unsigned> maxScopes("anders-alias-metadata-max-scopes");
+    ASSERT_TRUE(addAliasMetadata(*f, anders));
+    Instruction* store = &*std::prev(f->begin()->end(), 2);
+    EXPECT_TRUE(noAlias(getInst("a"), getInst("b")));
+    EXPECT_TRUE(noAlias(getInst("b"), getInst("f")));
+    EXPECT_FALSE(noAlias(getInst("a"), getInst("d")));
+    EXPECT_FALSE(noAlias(getInst("b"), getInst("d")));
+    EXPECT_TRUE(noAlias(getInst("d"), getInst("f")));
+    EXPECT_FALSE(noAlias(getInst("a"), store));
+    EXPECT_TRUE(noAlias(getInst("b"), store));
+    // The analysis doesn't know where %u points to
+    EXPECT_EQ(getInst("e")->getMetadata(LLVMContext::MD_alias_scope), nullptr);
+    EXPECT_EQ(getInst("e")->getMetadata(LLVMContext::MD_noalias), nullptr);
+    for (auto& inst : instructions(*f)) {
+        inst.setMetadata(LLVMContext::MD_alias_scope, nullptr);
+        inst.setMetadata(LLVMContext::MD_noalias, nullptr);
+    }
+
+    // With two scopes, the class of %x and %y has the most accesses and keeps its own scope, and that of %z gets the other. A single scope says nothing
+    maxScopes->setValue(2);
+    ASSERT_TRUE(addAliasMetadata(*f, anders));
+    EXPECT_FALSE(noAlias(getInst("a"), getInst("b")));
+    EXPECT_TRUE(noAlias(getInst("a"), getInst("f")));
+    EXPECT_TRUE(noAlias(getInst("d"), getInst("f")));
+    maxScopes->setValue(1);
+    EXPECT_FALSE(addAliasMetadata(*f, anders));
+}
+
+TEST_F(AndersPassTest, ResolvedCallGraphTest) {
+    auto module = ParseAssembly("@fp = global void (i32*)* null\n"
+                                "declare void @ext(i32*)\n"
+                                "declare void (i32*)* @unknown()\n"
+                                "define void @f(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @g(i32* %a) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @h(i32* %a, i32* %b) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main(i1 %c) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %s = select i1 %c, void (i32*)* @f, void (i32*)* @ext\n"
+                                "  %t = select i1 %c, void (i32*)* %s, void (i32*)* bitcast (void (i32*, i32*)* @h to void (i32*)*)\n"
+                                "  store void (i32*)* @g, void (i32*)** @fp\n"
+                                "  call void %t(i32* %x)\n"
+                                "  %l = load void (i32*)*, void (i32*)** @fp\n"
+                                "  call void %l(i32* %x)\n"
+                                "  %u = call void (i32*)* @unknown()\n"
+                                "  call void %u(i32* %x)\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    std::vector<const Instruction*> calls;
+    for (auto& inst : instructions(*module->getFunction("main")))
+        if (auto call = dyn_cast<CallInst>(&inst))
+            if (call->getCalledFunction() == nullptr)
+                calls.push_back(call);
+    ASSERT_EQ(calls.size(), 3u);
+
+    // @h takes two arguments, so the first call can't reach it
+    ArrayRef<const Function*> callees;
+    EXPECT_TRUE(anders.getResolvedCallees(calls[0], callees));
+    std::vector<const Function*> sorted(callees.begin(), callees.end());
+    std::sort(sorted.begin(), sorted.end());
+    std::vector<const Function*> expected{module->getFunction("f"), module->getFunction("ext")};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(sorted, expected);
+    EXPECT_TRUE(anders.getResolvedCallees(calls[1], callees));
+    EXPECT_EQ(callees.vec(), std::vector<const Function*>{module->getFunction("g")});
+    EXPECT_FALSE(anders.getResolvedCallees(calls[2], callees));
+    EXPECT_FALSE(anders.getResolvedCallees(&*module->getFunction("f")->begin()->begin(), callees));
+
+    // The exported call graph has the resolved edges in place of those to the external calling node, except for the call it can't resolve
+    CallGraph cg(*module);
+    anders.exportCallGraph(cg);
+    std::vector<const Function*> mainCallees;
+    unsigned numExternal = 0;
+    for (auto& record : *cg[module->getFunction("main")]) {
+        if (record.second == cg.getCallsExternalNode())
+            ++numExternal;
+        else if (record.second->getFunction() != module->getFunction("unknown"))
+            mainCallees.push_back(record.second->getFunction());
+    }
+    std::sort(mainCallees.begin(), mainCallees.end());
+    expected.push_back(module->getFunction("g"));
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(mainCallees, expected);
+    EXPECT_EQ(numExternal, 1u);
+}
+
+TEST_F(AndersPassTest, TypeMetadataCallsTest) {
+    // Two classes with a method of the same arity, one called through llvm.type.test and the other through llvm.type.checked.load
+    auto module = ParseAssembly("@vtA = constant { [2 x i8*] } { [2 x i8*] [i8* null, i8* bitcast (void (i8*, i32*)* @A_f to i8*)] }, !type !0\n"
+                                "@vtB = constant { [2 x i8*] } { [2 x i8*] [i8* null, i8* bitcast (void (i8*, i32*)* @B_f to i8*)] }, !type !1\n"
+                                "declare i1 @llvm.type.test(i8*, metadata)\n"
+                                "declare void @llvm.assume(i1)\n"
+                                "declare { i8*, i1 } @llvm.type.checked.load(i8*, i32, metadata)\n"
+                                "define void @A_f(i8* %this, i32* %p) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @B_f(i8* %this, i32* %q) {\n"
+                                "bb:\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @callA(i8* %obj) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %vtp = bitcast i8* %obj to i8***\n"
+                                "  %vt = load i8**, i8*** %vtp\n"
+                                "  %vt8 = bitcast i8** %vt to i8*\n"
+                                "  %t = call i1 @llvm.type.test(i8* %vt8, metadata !\"A\")\n"
+                                "  call void @llvm.assume(i1 %t)\n"
+                                "  %slot = getelementptr inbounds i8*, i8** %vt, i64 0\n"
+                                "  %fp8 = load i8*, i8** %slot\n"
+                                "  %fp = bitcast i8* %fp8 to void (i8*, i32*)*\n"
+                                "  call void %fp(i8* %obj, i32* %x)\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @callB(i8* %obj) {\n"
+                                "bb:\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %vtp = bitcast i8* %obj to i8**\n"
+                                "  %vt = load i8*, i8** %vtp\n"
+                                "  %pair = call { i8*, i1 } @llvm.type.checked.load(i8* %vt, i32 0, metadata !\"B\")\n"
+                                "  %fp8 = extractvalue { i8*, i1 } %pair, 0\n"
+                                "  %fp = bitcast i8* %fp8 to void (i8*, i32*)*\n"
+                                "  call void %fp(i8* %obj, i32* %y)\n"
+                                "  ret void\n"
+                                "}\n"
+                                "!0 = !{i64 8, !\"A\"}\n"
+                                "!1 = !{i64 8, !\"B\"}\n");
+    const Value* p = module->getFunction("A_f")->getArg(1);
+    const Value* q = module->getFunction("B_f")->getArg(1);
+    const Value* x = &*inst_begin(module->getFunction("callA"));
+    const Value* y = &*inst_begin(module->getFunction("callB"));
+
+    // Each call reaches every function of its arity
+    std::vector<const Value*> ptsSet;
+    {
+        Andersen anders(*module);
+        ASSERT_TRUE(anders.getPointsToSet(q, ptsSet));
+        std::sort(ptsSet.begin(), ptsSet.end());
+        std::vector<const Value*> expected{x, y};
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(ptsSet, expected);
+    }
+
+    ScopedOption<bool> typeMetadataCalls("anders-type-metadata-calls");
+    typeMetadataCalls->setValue(true);
+    Andersen anders(*module);
+    typeMetadataCalls->setValue(false);
+    ptsSet.clear();
+    ASSERT_TRUE(anders.getPointsToSet(p, ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{x});
+    ptsSet.clear();
+    ASSERT_TRUE(anders.getPointsToSet(q, ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{y});
+}
+
+TEST_F(AndersPassTest, DemandDrivenTest) {
+    auto module = ParseAssembly("%pair = type { i32*, i32* }\n"
+                                "@g = internal global i32* null\n"
+                                "@h = internal global i32** @g\n"
+                                "@fp = internal global i32* (i32*)* null\n"
+                                "declare i8* @malloc(i64)\n"
+                                "declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)\n"
+                                "define internal i32* @id(i32* %p) {\n"
+                                "bb:\n"
+                                "  ret i32* %p\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %s = alloca %pair\n"
+                                "  %t = alloca %pair\n"
+                                "  %m = call i8* @malloc(i64 4)\n"
+                                "  %mi = bitcast i8* %m to i32*\n"
+                                "  %f0 = getelementptr %pair, %pair* %s, i32 0, i32 0\n"
+                                "  store i32* %x, i32** %f0\n"
+                                "  %f1 = getelementptr %pair, %pair* %s, i32 0, i32 1\n"
+                                "  store i32* %mi, i32** %f1\n"
+                                "  %s8 = bitcast %pair* %s to i8*\n"
+                                "  %t8 = bitcast %pair* %t to i8*\n"
+                                "  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %t8, i8* %s8, i64 16, i1 false)\n"
+                                "  %tf = getelementptr %pair, %pair* %t, i32 0, i32 0\n"
+                                "  %a = load i32*, i32** %tf\n"
+                                "  store i32* %y, i32** @g\n"
+                                "  %hh = load i32**, i32*** @h\n"
+                                "  %b = load i32*, i32** %hh\n"
+                                "  store i32* (i32*)* @id, i32* (i32*)** @fp\n"
+                                "  %f = load i32* (i32*)*, i32* (i32*)** @fp\n"
+                                "  %c = call i32* %f(i32* %b)\n"
+                                "  %d = call i32* @id(i32* %a)\n"
+                                "  ret void\n"
+                                "}\n");
+
+    std::string error;
+    std::unique_ptr<Andersen> onDemand = Andersen::createOnDemand(*module, error);
+    ASSERT_TRUE(onDemand != nullptr) << error;
+    Andersen full(*module);
+
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(onDemand->getPointsToSetOnDemand(getValue("b"), ptsSet));
+    EXPECT_EQ(ptsSet, (std::vector<const Value*>{getValue("y")}));
+    // The result of an indirect call may be anything
+    EXPECT_FALSE(onDemand->getPointsToSetOnDemand(getValue("c"), ptsSet));
+
+    // Every pointer gets the set the whole analysis finds, whatever was asked before
+    for (auto& inst : instructions(*module->getFunction("main"))) {
+        if (!inst.getType()->isPointerTy())
+            continue;
+        std::vector<const Value*> expected, actual;
+        bool known = full.getPointsToSet(&inst, expected);
+        EXPECT_EQ(onDemand->getPointsToSetOnDemand(&inst, actual), known);
+        std::sort(expected.begin(), expected.end());
+        std::sort(actual.begin(), actual.end());
+        EXPECT_EQ(actual, expected) << inst.getName().str();
+    }
+}
+
+TEST_F(AndersPassTest, DeferredSolvingTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %y = alloca i32\n"
+                                "  %p = alloca i32*\n"
+                                "  store i32* %x, i32** %p\n"
+                                "  store i32* %y, i32** @g\n"
+                                "  %a = load i32*, i32** %p\n"
+                                "  %b = load i32*, i32** @g\n"
+                                "  %c = select i1 true, i32* %a, i32* %b\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen eager(*module);
+    AndersenAAResult eagerAA(*module);
+
+    ScopedOption<bool> defer("anders-defer-solving");
+    ScopedOption<bool> background("anders-background-solving");
+    // Solved by the first query, then on a thread of its own
+    for (unsigned mode = 0; mode < 2; ++mode) {
+        defer->setValue(mode == 0);
+        background->setValue(mode == 1);
+        Andersen deferred(*module);
+        AndersenAAResult deferredAA(*module);
+        defer->setValue(false);
+        background->setValue(false);
+
+        std::vector<const Value*> values;
+        for (auto& inst : instructions(*module->getFunction("main"))) {
+            if (!inst.getType()->isPointerTy())
+                continue;
+            values.push_back(&inst);
+            std::vector<const Value*> expected, actual;
+            EXPECT_EQ(deferred.getPointsToSet(&inst, actual), eager.getPointsToSet(&inst, expected));
+            std::sort(expected.begin(), expected.end());
+            std::sort(actual.begin(), actual.end());
+            EXPECT_EQ(actual, expected) << inst.getName().str();
+        }
+        for (auto v1 : values)
+            for (auto v2 : values)
+                EXPECT_EQ(deferredAA.alias(MemoryLocation(v1, 4), MemoryLocation(v2, 4)),
+                          eagerAA.alias(MemoryLocation(v1, 4), MemoryLocation(v2, 4)));
+    }
+}
+
+TEST_F(AndersPassTest, ConstantMemoryTest) {
+    auto module = ParseAssembly("@c = constant i32 0\n"
+                                "@d = constant i32 1\n"
+                                "@v = global i32 0\n"
+                                "define void @f() {\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main(i1 %cond) {\n"
+                                "bb:\n"
+                                "  %cd = select i1 %cond, i32* @c, i32* @d\n"
+                                "  %cv = select i1 %cond, i32* @c, i32* @v\n"
+                                "  %cn = select i1 %cond, i32* @c, i32* null\n"
+                                "  %x = alloca i32\n"
+                                "  %fp = alloca void()*\n"
+                                "  store void()* @f, void()** %fp\n"
+                                "  %g = load void()*, void()** %fp\n"
+                                "  ret void\n"
+                                "}\n");
+    AndersenAAResult aa(*module);
+    auto isConstant = [&](const char* name) {
+        return aa.pointsToConstantMemory(MemoryLocation(getValue(name), 4), false);
+    };
+    EXPECT_TRUE(isConstant("c"));
+    EXPECT_TRUE(isConstant("cd"));
+    EXPECT_TRUE(isConstant("cn"));
+    EXPECT_TRUE(isConstant("g"));
+    EXPECT_FALSE(isConstant("v"));
+    EXPECT_FALSE(isConstant("cv"));
+    EXPECT_FALSE(isConstant("x"));
+}
+
+TEST_F(AndersPassTest, ObjectCategoryTest) {
+    auto module = ParseAssembly("@c = constant i32 0\n"
+                                "@v = global i32 0\n"
+                                "declare noalias i8* @malloc(i64)\n"
+                                "declare i32* @unknown()\n"
+                                "define void @f() {\n"
+                                "  ret void\n"
+                                "}\n"
+                                "define void @main(i1 %cond) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32\n"
+                                "  %m = call i8* @malloc(i64 4)\n"
+                                "  %mi = bitcast i8* %m to i32*\n"
+                                "  %cv = select i1 %cond, i32* @c, i32* @v\n"
+                                "  %xm = select i1 %cond, i32* %x, i32* %mi\n"
+                                "  %n = select i1 %cond, i32* null, i32* null\n"
+                                "  %u = call i32* @unknown()\n"
+                                "  %fp = alloca void()*\n"
+                                "  store void()* @f, void()** %fp\n"
+                                "  %g = load void()*, void()** %fp\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    auto categories = [&](const char* name) { return anders.getPointeeCategories(getValue(name)); };
+    EXPECT_EQ(categories("x"), unsigned(AndersNodeFactory::StackObject));
+    EXPECT_EQ(categories("mi"), unsigned(AndersNodeFactory::HeapObject));
+    EXPECT_EQ(categories("xm"), unsigned(AndersNodeFactory::StackObject | AndersNodeFactory::HeapObject));
+    EXPECT_EQ(categories("cv"), unsigned(AndersNodeFactory::ConstantGlobalObject | AndersNodeFactory::GlobalObject));
+    EXPECT_EQ(categories("g"), unsigned(AndersNodeFactory::FunctionObject));
+    EXPECT_EQ(categories("n"), 0u);
+    EXPECT_NE(categories("u") & AndersNodeFactory::UniversalObject, 0u);
+    // %cond is not a pointer
+    EXPECT_EQ(anders.getPointeeCategories(module->getFunction("main")->getArg(0)), unsigned(AndersNodeFactory::UniversalObject));
+}
+
+TEST_F(AndersPassTest, EscapeTest) {
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "declare void @sink(i32*)\n"
+                                "declare void @nocap(i32* nocapture)\n"
+                                "declare noalias i8* @malloc(i64)\n"
+                                "define i32* @f(i32** %out) {\n"
+                                "bb:\n"
+                                "  %a = alloca i32*\n"
+                                "  %b = alloca i32\n"
+                                "  %c = alloca i32\n"
+                                "  %d = alloca i32\n"
+                                "  %e = alloca i32\n"
+                                "  %m = call i8* @malloc(i64 4)\n"
+                                "  %mi = bitcast i8* %m to i32*\n"
+                                "  %ai = bitcast i32** %a to i32*\n"
+                                "  store i32* %ai, i32** @g\n"
+                                "  store i32* %mi, i32** %a\n"
+                                "  store i32* %b, i32** %out\n"
+                                "  call void @sink(i32* %d)\n"
+                                "  call void @nocap(i32* %e)\n"
+                                "  ret i32* %c\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %o = alloca i32*\n"
+                                "  %r = call i32* @f(i32** %o)\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    AndersEscapeInfo info;
+    anders.computeEscapes(*module, info);
+    auto escapes = [&](const char* func, const char* name) {
+        for (auto& inst : instructions(*module->getFunction(func)))
+            if (inst.getName() == name)
+                return info.getEscapes(&inst);
+        return unsigned(AndersEscapeInfo::EscapesAnywhere);
+    };
+    // The allocas and the malloc, in module order
+    ASSERT_EQ(info.objects.size(), 7u);
+    EXPECT_EQ(escapes("f", "a"), unsigned(AndersEscapeInfo::EscapesToGlobals));
+    EXPECT_EQ(escapes("f", "m"), unsigned(AndersEscapeInfo::EscapesToGlobals));
+    EXPECT_EQ(escapes("f", "b"), unsigned(AndersEscapeInfo::EscapesToCaller));
+    EXPECT_EQ(escapes("f", "c"), unsigned(AndersEscapeInfo::EscapesToCaller));
+    EXPECT_EQ(escapes("f", "d"), unsigned(AndersEscapeInfo::EscapesToUnknown));
+    EXPECT_EQ(escapes("f", "e"), 0u);
+    EXPECT_EQ(escapes("main", "o"), 0u);
+    EXPECT_EQ(info.getEscapes(module->getNamedValue("g")), unsigned(AndersEscapeInfo::EscapesAnywhere));
+}
+
+TEST_F(AndersPassTest, FlowSensitiveTest) {
+    // A private alloca and a global, each written twice, read in between, across a call and after a branch
+    auto module = ParseAssembly("@g = global i32* null\n"
+                                "@x = global i32 0\n"
+                                "@y = global i32 0\n"
+                                "declare void @h()\n"
+                                "define void @f(i1 %c) {\n"
+                                "bb:\n"
+                                "  %p = alloca i32*\n"
+                                "  store i32* @x, i32** %p\n"
+                                "  %a = load i32*, i32** %p\n"
+                                "  store i32* @y, i32** %p\n"
+                                "  %b = load i32*, i32** %p\n"
+                                "  store i32* @x, i32** @g\n"
+                                "  call void @h()\n"
+                                "  %d = load i32*, i32** @g\n"
+                                "  store i32* @y, i32** @g\n"
+                                "  %e = load i32*, i32** @g\n"
+                                "  br i1 %c, label %l, label %r\n"
+                                "l:\n"
+                                "  store i32* @x, i32** %p\n"
+                                "  br label %m\n"
+                                "r:\n"
+                                "  br label %m\n"
+                                "m:\n"
+                                "  %j = load i32*, i32** %p\n"
+                                "  %k = bitcast i32* %j to i8*\n"
+                                "  ret void\n"
+                                "}\n");
+    Andersen anders(*module);
+    AndersFlowSensitiveInfo info;
+    anders.computeFlowSensitive(*module->getFunction("f"), info);
+    auto ptsSize = [&](const char* name) {
+        std::vector<const Value*> ptsSet;
+        return info.getPointsToSet(getValue(name, "f"), ptsSet) ? ptsSet.size() : ~size_t(0);
+    };
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(anders.getPointsToSet(getValue("b", "f"), ptsSet));
+    EXPECT_EQ(ptsSet.size(), 2u);
+
+    ASSERT_TRUE(info.getPointsToSet(getValue("a", "f"), ptsSet));
+    ASSERT_EQ(ptsSet.size(), 1u);
+    EXPECT_EQ(ptsSet[0], module->getNamedValue("x"));
+    ASSERT_TRUE(info.getPointsToSet(getValue("b", "f"), ptsSet));
+    ASSERT_EQ(ptsSet.size(), 1u);
+    EXPECT_EQ(ptsSet[0], module->getNamedValue("y"));
+    // The call may write @g, which then holds what the solution says
+    EXPECT_EQ(ptsSize("d"), 2u);
+    ASSERT_TRUE(info.getPointsToSet(getValue("e", "f"), ptsSet));
+    ASSERT_EQ(ptsSet.size(), 1u);
+    EXPECT_EQ(ptsSet[0], module->getNamedValue("y"));
+    // Both branches reach the merge
+    EXPECT_EQ(ptsSize("j"), 2u);
+    EXPECT_EQ(ptsSize("k"), 2u);
+    EXPECT_EQ(ptsSize("p"), 1u);
+    EXPECT_EQ(info.numStrongUpdates, 5u);
+}
+
+TEST_F(AndersPassTest, IntProvenanceTest) {
+    // A tagged pointer, two pointers hashed together and taken apart again, an integer pointer carried around a loop, and an integer from memory
+    auto module = ParseAssembly("@g = global i32 0\n"
+                                "define void @main(i64* %m) {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %xi = ptrtoint i32* %x to i64\n"
+                                "  %tagged = or i64 %xi, 1\n"
+                                "  %untagged = and i64 %tagged, -8\n"
+                                "  %p = inttoptr i64 %untagged to i32*\n"
+                                "  %yi = ptrtoint i32* %y to i64\n"
+                                "  %hash = xor i64 %xi, %yi\n"
+                                "  %back = xor i64 %hash, %yi\n"
+                                "  %q = inttoptr i64 %back to i32*\n"
+                                "  br label %loop\n"
+                                "loop:\n"
+                                "  %i = phi i64 [ ptrtoint (i32* @g to i64), %bb ], [ %next, %loop ]\n"
+                                "  %next = add i64 %i, 4\n"
+                                "  %c = icmp ult i64 %next, %yi\n"
+                                "  br i1 %c, label %loop, label %exit\n"
+                                "exit:\n"
+                                "  %r = inttoptr i64 %next to i32*\n"
+                                "  %l = load i64, i64* %m\n"
+                                "  %s = inttoptr i64 %l to i32*\n"
+                                "  ret void\n"
+                                "}\n");
+    const Function* f = module->getFunction("main");
+    auto getInst = [f](StringRef name) -> const Value* {
+        for (auto& inst : instructions(*f))
+            if (inst.getName() == name)
+                return &inst;
+        return nullptr;
+    };
+    const Value* x = getInst("x");
+    const Value* y = getInst("y");
+    const Value* g = module->getNamedValue("g");
+
+    std::vector<const Value*> ptsSet;
+    {
+        // Only the plain ptrtoint and ptrtoint plus offset patterns are known
+        Andersen anders(*module);
+        EXPECT_FALSE(anders.getPointsToSet(getInst("p"), ptsSet));
+        EXPECT_FALSE(anders.getPointsToSet(getInst("q"), ptsSet));
+    }
+
+    ScopedOption<bool> intProvenance("anders-int-provenance");
+    intProvenance->setValue(true);
+    Andersen anders(*module);
+    intProvenance->setValue(false);
+
+    ptsSet.clear();
+    ASSERT_TRUE(anders.getPointsToSet(getInst("p"), ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{x});
+    ptsSet.clear();
+    ASSERT_TRUE(anders.getPointsToSet(getInst("q"), ptsSet));
+    std::sort(ptsSet.begin(), ptsSet.end());
+    std::vector<const Value*> expected{x, y};
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(ptsSet, expected);
+    ptsSet.clear();
+    ASSERT_TRUE(anders.getPointsToSet(getInst("r"), ptsSet));
+    EXPECT_EQ(ptsSet, std::vector<const Value*>{g});
+    // Nothing is known about what is stored in memory as an integer
+    EXPECT_FALSE(anders.getPointsToSet(getInst("s"), ptsSet));
+}
+
+TEST_F(AndersPassTest, ExternalLibrarySpecTest) {
+    auto module = ParseAssembly("declare i8* @my_alloc(i64)\n"
+                                "declare i8* @my_dup(i8*)\n"
+                                "declare void @my_store(i8**, i8*)\n"
+                                "declare i8* @strchr(i8*, i32)\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %a = call i8* @my_alloc(i64 8)\n"
+                                "  %b = call i8* @my_alloc(i64 8)\n"
+                                "  %d = call i8* @my_dup(i8* %a)\n"
+                                "  %slot = alloca i8*\n"
+                                "  call void @my_store(i8** %slot, i8* %b)\n"
+                                "  %l = load i8*, i8** %slot\n"
+                                "  %x = alloca i8\n"
+                                "  %c = call i8* @strchr(i8* %x, i32 0)\n"
+                                "  ret void\n"
+                                "}\n");
+    // Each spec goes into a temporary file, which remover deletes when the next spec is written or the test ends, however it ends
+    auto writeSpec = [](const char* text, std::string& fileName, FileRemover& remover) -> ::testing::AssertionResult {
+        SmallString<128> path;
+        if (std::error_code ec = sys::fs::createTemporaryFile("anders", "spec", path))
+            return ::testing::AssertionFailure() << "cannot create a spec file: " << ec.message();
+        remover.setFile(path);
+        std::error_code ec;
+        raw_fd_ostream os(path, ec, sys::fs::F_None);
+        if (ec)
+            return ::testing::AssertionFailure() << "cannot open " << path.str().str() << ": " << ec.message();
+        os << text;
+        fileName = path.str().str();
+        return ::testing::AssertionSuccess();
+    };
+    std::vector<const Value*> ptsSet;
+
+    // Without a spec, the allocator and the other functions of the program's own libraries are unknown, and strchr() returns its argument
+    {
+        Andersen plain(*module);
+        EXPECT_FALSE(plain.getPointsToSet(getValue("a"), ptsSet));
+        EXPECT_FALSE(plain.getPointsToSet(getValue("d"), ptsSet));
+        EXPECT_EQ(getSortedPtsSet(plain, "c"), sorted({getValue("x")}));
+    }
+
+    std::string fileName;
+    FileRemover specRemover;
+    ASSERT_TRUE(writeSpec("# The allocator of the program\n"
+                          "alloc my_alloc\n"
+                          "\n"
+                          "   ret-arg0   my_dup   # hands its argument back\n"
+                          "store-arg my_store\n"
+                          "# strchr() is built in as ret-arg0\n"
+                          "noop strchr\n",
+                          fileName, specRemover));
+    ScopedOption<std::string> spec("anders-ext-spec");
+    spec->setValue(fileName);
+    {
+        // Each call to the allocator gets a heap object of its own, not the universal one
+        Andersen anders(*module);
+        EXPECT_EQ(getSortedPtsSet(anders, "a"), sorted({getValue("a")}));
+        EXPECT_EQ(getSortedPtsSet(anders, "b"), sorted({getValue("b")}));
+        EXPECT_EQ(getSortedPtsSet(anders, "d"), sorted({getValue("a")}));
+        EXPECT_EQ(getSortedPtsSet(anders, "l"), sorted({getValue("b")}));
+        // The spec replaces the built-in model
+        EXPECT_TRUE(getSortedPtsSet(anders, "c").empty());
+    }
+
+    // A line with an unknown kind, or with more than a function name after the kind, is fatal and reported by its line number. The child process of a death test dies without running the destructors, so report_fatal_error() removes the spec it was given
+    ScopedDeathTestStyle style("threadsafe");
+    ASSERT_TRUE(writeSpec("# The allocator of the program\n"
+                          "\n"
+                          "allocate my_alloc\n",
+                          fileName, specRemover));
+    spec->setValue(fileName);
+    EXPECT_DEATH({ sys::RemoveFileOnSignal(fileName); Andersen anders(*module); }, ":3: expected \"<kind> <function name>\"");
+    ASSERT_TRUE(writeSpec("alloc my_alloc\n"
+                          "ret-arg0 my_dup extra\n",
+                          fileName, specRemover));
+    spec->setValue(fileName);
+    EXPECT_DEATH({ sys::RemoveFileOnSignal(fileName); Andersen anders(*module); }, ":2: expected \"<kind> <function name>\"");
+}
+
+TEST_F(AndersPassTest, HeapCloningTest) {
+    auto module = ParseAssembly("@last = global i8* null\n"
+                                "declare noalias i8* @malloc(i64)\n"
+                                "declare void @abort()\n"
+                                "define i8* @xmalloc(i64 %n) {\n"
+                                "entry:\n"
+                                "  %m = call i8* @malloc(i64 %n)\n"
+                                "  %isnull = icmp eq i8* %m, null\n"
+                                "  br i1 %isnull, label %fail, label %ok\n"
+                                "fail:\n"
+                                "  call void @abort()\n"
+                                "  unreachable\n"
+                                "ok:\n"
+                                "  ret i8* %m\n"
+                                "}\n"
+                                "define i32* @xnew() {\n"
+                                "  %m = call i8* @xmalloc(i64 4)\n"
+                                "  %c = bitcast i8* %m to i32*\n"
+                                "  ret i32* %c\n"
+                                "}\n"
+                                "define i8* @remember(i64 %n) {\n"
+                                "  %m = call i8* @malloc(i64 %n)\n"
+                                "  store i8* %m, i8** @last\n"
+                                "  ret i8* %m\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %p = call i8* @xmalloc(i64 8)\n"
+                                "  %q = call i8* @xmalloc(i64 8)\n"
+                                "  %r = call i32* @xnew()\n"
+                                "  %s = call i32* @xnew()\n"
+                                "  %t = call i8* @remember(i64 8)\n"
+                                "  %u = call i8* @remember(i64 8)\n"
+                                "  %l = load i8*, i8** @last\n"
+                                "  ret void\n"
+                                "}\n");
+
+    ScopedOption<bool> heapCloning("anders-heap-cloning");
+    heapCloning->setValue(true);
+    Andersen anders(*module);
+    AndersenAAResult aa(*module);
+    heapCloning->setValue(false);
+    Andersen shared(*module);
+
+    auto alias = [&](const char* a, const char* b) {
+        return aa.alias(MemoryLocation(getValue(a), 1), MemoryLocation(getValue(b), 1));
+    };
+    // Each call to a wrapper, or to a wrapper of a wrapper, allocates an object of its own
+    std::vector<const Value*> ptsSet;
+    ASSERT_TRUE(anders.getPointsToSet(getValue("p"), ptsSet));
+    EXPECT_EQ(ptsSet, (std::vector<const Value*>{getValue("p")}));
+    ASSERT_TRUE(anders.getPointsToSet(getValue("r"), ptsSet));
+    EXPECT_EQ(ptsSet, (std::vector<const Value*>{getValue("r")}));
+    EXPECT_EQ(alias("p", "q"), NoAlias);
+    EXPECT_EQ(alias("r", "s"), NoAlias);
+    EXPECT_EQ(alias("p", "r"), NoAlias);
+    // The object of @remember is kept in a global, so its calls still share it
+    EXPECT_EQ(alias("t", "u"), MustAlias);
+    EXPECT_NE(alias("l", "t"), NoAlias);
+
+    ASSERT_TRUE(shared.getPointsToSet(getValue("p"), ptsSet));
+    ASSERT_TRUE(ptsSet.size() == 1);
+    EXPECT_TRUE(isa<CallInst>(ptsSet[0]) && cast<CallInst>(ptsSet[0])->getParent()->getParent()->getName() == "xmalloc");
+}
+
+TEST_F(AndersPassTest, HeapAbstractionTest) {
+    auto module = ParseAssembly("declare noalias i8* @malloc(i64)\n"
+                                "define i32* @make() {\n"
+                                "  %m = call i8* @malloc(i64 4)\n"
+                                "  %c = bitcast i8* %m to i32*\n"
+                                "  ret i32* %c\n"
+                                "}\n"
+                                "define void @main() {\n"
+                                "bb:\n"
+                                "  %x = alloca i32, align 4\n"
+                                "  %y = alloca i32, align 4\n"
+                                "  %a = call i8* @malloc(i64 4)\n"
+                                "  %ai = bitcast i8* %a to i32*\n"
+                                "  %b = call i8* @malloc(i64 8)\n"
+                                "  %bi = bitcast i8* %b to i64*\n"
+                                "  %c = call i32* @make()\n"
+                                "  ret void\n"
+                                "}\n");
+    auto mayAlias = [&](Andersen& anders, const char* a, const char* b) {
+        std::vector<const Value*> aSet, bSet;
+        EXPECT_TRUE(anders.getPointsToSet(getValue(a), aSet));
+        EXPECT_TRUE(anders.getPointsToSet(getValue(b), bSet));
+        return std::find_first_of(aSet.begin(), aSet.end(), bSet.begin(), bSet.end()) != aSet.end();
+    };
+
+    ScopedOption<std::string> heapAbstraction("anders-heap-abstraction");
+    // Which of the three allocations share an object: a and b are in the same function, a and c are both cast to i32*
+    struct {
+        const char* granularity;
+        bool ab, ac, bc;
+    } configs[] = {
+        {"site", false, false, false}, {"function", true, false, false}, {"type", false, true, false}, {"single", true, true, true}};
+    for (auto const& config : configs) {
+        heapAbstraction->setValue(config.granularity);
+        Andersen anders(*module);
+        heapAbstraction->setValue("site");
+        EXPECT_EQ(mayAlias(anders, "a", "b"), config.ab) << config.granularity;
+        EXPECT_EQ(mayAlias(anders, "a", "c"), config.ac) << config.granularity;
+        EXPECT_EQ(mayAlias(anders, "b", "c"), config.bc) << config.granularity;
+        // The stack is left alone
+        EXPECT_FALSE(mayAlias(anders, "x", "y")) << config.granularity;
+        EXPECT_FALSE(mayAlias(anders, "x", "a")) << config.granularity;
+    }
+}
+
+TEST_F(AndersPassTest, TypeFilterTest) {
+    auto module = ParseAssembly("%S = type { i32*, i32 }\n"
+                                "define void @main(i1 %cond) {\n"
+                                "bb:\n"
+                                "  %a = alloca i32\n"
+                                "  %f = alloca float\n"
+                                "  %s = alloca %S\n"
+                                "  %ai = bitcast i32* %a to i8*\n"
+                                "  %fi = bitcast float* %f to i8*\n"
+                                "  %si = bitcast %S* %s to i8*\n"
+                                "  %af = select i1 %cond, i8* %ai, i8* %fi\n"
+                                "  %v = select i1 %cond, i8* %af, i8* %si\n"
+                                "  %p = bitcast i8* %v to i32*\n"
+                                "  %q = bitcast i8* %v to float*\n"
+                                "  %r = bitcast i8* %v to %S*\n"
+                                "  ret void\n"
+                                "}\n");
+
+    ScopedOption<bool> typeFilter("anders-type-filter");
+    typeFilter->setValue(true);
+    Andersen filtered(*module);
+    AndersenAAResult aa(*module);
+    typeFilter->setValue(false);
+    Andersen unfiltered(*module);
+
+    auto a = getValue("a"), f = getValue("f"), s = getValue("s");
+    EXPECT_EQ(getSortedPtsSet(unfiltered, "p"), sorted({a, f, s}));
+    // An i32 may be in the i32 or in the struct, a float only in the float. An i8 pointer may point to anything
+    EXPECT_EQ(getSortedPtsSet(filtered, "p"), sorted({a, s}));
+    EXPECT_EQ(getSortedPtsSet(filtered, "q"), sorted({f}));
+    EXPECT_EQ(getSortedPtsSet(filtered, "r"), sorted({a, s}));
+    EXPECT_EQ(getSortedPtsSet(filtered, "v"), sorted({a, f, s}));
+    // The alias queries of the result strip the casts, so ask the frozen results about the casts themselves
+    std::shared_ptr<const AndersFrozenResults> frozen = aa.getFrozenResults();
+    EXPECT_EQ(frozen->alias(getValue("p"), getValue("q")), NoAlias);
+    EXPECT_EQ(frozen->alias(getValue("p"), getValue("r")), MayAlias);
+}
+
+TEST_F(AndersPassTest, GlobalTableTest) {
+    // A dispatch table of the same two functions and some nulls, behind a field of its own
+    const unsigned numEntries = 3000;
+    std::string table;
+    for (unsigned i = 0; i < numEntries; ++i) {
+        static const char* entries[] = { "void ()* @f1", "void ()* @f2", "void ()* null" };
+        table += std::string(i == 0 ? "" : ", ") + entries[i % 3];
+    }
+    std::string tableType = "[" + std::to_string(numEntries) + " x void ()*]";
+    auto module = ParseAssembly(("%T = type { i32*, " + tableType + " }\n"
+                                 "@x = global i32 0\n"
+                                 "@t = global %T { i32* @x, " + tableType + " [" + table + "] }\n"
+                                 "define void @f1() {\n"
+                                 "bb:\n"
+                                 "  ret void\n"
+                                 "}\n"
+                                 "define void @f2() {\n"
+                                 "bb:\n"
+                                 "  ret void\n"
+                                 "}\n"
+                                 "define void @main(i64 %i) {\n"
+                                 "bb:\n"
+                                 "  %p0 = getelementptr %T, %T* @t, i32 0, i32 0\n"
+                                 "  %x = load i32*, i32** %p0\n"
+                                 "  %pi = getelementptr %T, %T* @t, i32 0, i32 1, i64 %i\n"
+                                 "  %f = load void ()*, void ()** %pi\n"
+                                 "  ret void\n"
+                                 "}\n").c_str());
+
+    ScopedOption<bool> fieldSensitive("anders-field-sensitive");
+    fieldSensitive->setValue(true);
+    Andersen sensitive(*module);
+    fieldSensitive->setValue(false);
+    Andersen insensitive(*module);
+
+    const Value* x = module->getNamedValue("x");
+    const Value* f1 = module->getNamedValue("f1");
+    const Value* f2 = module->getNamedValue("f2");
+    EXPECT_EQ(getSortedPtsSet(insensitive, "x"), sorted({x, f1, f2}));
+    EXPECT_EQ(getSortedPtsSet(insensitive, "f"), sorted({x, f1, f2}));
+    EXPECT_EQ(getSortedPtsSet(sensitive, "x"), sorted({x}));
+    EXPECT_EQ(getSortedPtsSet(sensitive, "f"), sorted({f1, f2}));
+}
+
+TEST_F(AndersPassTest, FieldSensitiveTest) {
+    auto module = ParseAssembly("%S = type { i32*, i32* }\n"
+                                "@g = global %S { i32* @x, i32* null }\n"
+                                "@x = global i32 0\n"
+                                "declare void @llvm.memcpy.p0i8.p0i8.i64(i8*, i8*, i64, i1)\n"
+                                "define void @main(i1 %cond) {\n"
+                                "entry:\n"
+                                "  %a = alloca i32\n"
+                                "  %b = alloca i32\n"
+                                "  %s = alloca %S\n"
+                                "  %t = alloca %S\n"
+                                "  %s0 = getelementptr %S, %S* %s, i32 0, i32 0\n"
+                                "  %s1 = getelementptr %S, %S* %s, i32 0, i32 1\n"
+                                "  store i32* %a, i32** %s0\n"
+                                "  store i32* %b, i32** %s1\n"
+                                "  %x = load i32*, i32** %s0\n"
+                                "  %y = load i32*, i32** %s1\n"
+                                "  %si = bitcast %S* %s to i8*\n"
+                                "  %ti = bitcast %S* %t to i8*\n"
+                                "  call void @llvm.memcpy.p0i8.p0i8.i64(i8* %ti, i8* %si, i64 16, i1 false)\n"
+                                "  %t1 = getelementptr %S, %S* %t, i32 0, i32 1\n"
+                                "  %z = load i32*, i32** %t1\n"
+                                "  %g1 = getelementptr %S, %S* @g, i32 0, i32 1\n"
+                                "  %w = load i32*, i32** %g1\n"
+                                "  br label %loop\n"
+                                "loop:\n"
+                                "  %p = phi %S* [ %s, %entry ], [ %next, %loop ]\n"
+                                "  %p1 = getelementptr %S, %S* %p, i32 0, i32 1\n"
+                                "  %next = bitcast i32** %p1 to %S*\n"
+                                "  br i1 %cond, label %loop, label %exit\n"
+                                "exit:\n"
+                                "  %v = load i32*, i32** %p1\n"
+                                "  ret void\n"
+                                "}\n");
+
+    ScopedOption<bool> fieldSensitive("anders-field-sensitive");
+    fieldSensitive->setValue(true);
+    Andersen sensitive(*module);
+    AndersenAAResult aa(*module);
+    fieldSensitive->setValue(false);
+    Andersen insensitive(*module);
+
+    auto a = getValue("a"), b = getValue("b"), s = getValue("s");
+    EXPECT_EQ(getSortedPtsSet(insensitive, "x"), sorted({a, b}));
+    EXPECT_EQ(getSortedPtsSet(sensitive, "x"), sorted({a}));
+    EXPECT_EQ(getSortedPtsSet(sensitive, "y"), sorted({b}));
+    // The copy of a struct copies each field into its own
+    EXPECT_EQ(getSortedPtsSet(sensitive, "z"), sorted({b}));
+    // The second field of @g is initialized to null
+    std::vector<const Value*> ptsSet;
+    EXPECT_TRUE(sensitive.getPointsToSet(getValue("w"), ptsSet));
+    EXPECT_TRUE(ptsSet.empty());
+    // The cycle through a positive offset stops at the last field
+    EXPECT_EQ(getSortedPtsSet(sensitive, "v"), sorted({b}));
+    // The queries see the objects as a whole
+    EXPECT_EQ(getSortedPtsSet(sensitive, "s1"), sorted({s}));
+    std::shared_ptr<const AndersFrozenResults> frozen = aa.getFrozenResults();
+    EXPECT_NE(frozen->alias(getValue("s0"), getValue("s1")), NoAlias);
+    EXPECT_EQ(frozen->alias(getValue("x"), getValue("y")), NoAlias);
+}
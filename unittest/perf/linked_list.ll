@@ -0,0 +1,81 @@
+; Two linked lists built from the heap, traversed through a table of callbacks
+%struct.node = type { %struct.node*, i32* }
+
+@handlers = global [2 x void (%struct.node*)*] [void (%struct.node*)* @visit_data, void (%struct.node*)* @visit_next]
+@sink = global i32* null
+@heads = global [2 x %struct.node*] zeroinitializer
+
+declare i8* @malloc(i64)
+
+define %struct.node* @push(%struct.node* %head, i32* %data) {
+entry:
+  %mem = call i8* @malloc(i64 16)
+  %n = bitcast i8* %mem to %struct.node*
+  %nextp = getelementptr %struct.node, %struct.node* %n, i64 0, i32 0
+  store %struct.node* %head, %struct.node** %nextp
+  %datap = getelementptr %struct.node, %struct.node* %n, i64 0, i32 1
+  store i32* %data, i32** %datap
+  ret %struct.node* %n
+}
+
+define void @visit_data(%struct.node* %n) {
+entry:
+  %datap = getelementptr %struct.node, %struct.node* %n, i64 0, i32 1
+  %data = load i32*, i32** %datap
+  store i32* %data, i32** @sink
+  ret void
+}
+
+define void @visit_next(%struct.node* %n) {
+entry:
+  %nextp = getelementptr %struct.node, %struct.node* %n, i64 0, i32 0
+  %next = load %struct.node*, %struct.node** %nextp
+  %isnull = icmp eq %struct.node* %next, null
+  br i1 %isnull, label %done, label %more
+
+more:
+  call void @visit_data(%struct.node* %next)
+  br label %done
+
+done:
+  ret void
+}
+
+define void @walk(%struct.node* %head, i64 %which) {
+entry:
+  %slot = getelementptr [2 x void (%struct.node*)*], [2 x void (%struct.node*)*]* @handlers, i64 0, i64 %which
+  %handler = load void (%struct.node*)*, void (%struct.node*)** %slot
+  br label %loop
+
+loop:
+  %cur = phi %struct.node* [ %head, %entry ], [ %next, %body ]
+  %isnull = icmp eq %struct.node* %cur, null
+  br i1 %isnull, label %exit, label %body
+
+body:
+  call void %handler(%struct.node* %cur)
+  %nextp = getelementptr %struct.node, %struct.node* %cur, i64 0, i32 0
+  %next = load %struct.node*, %struct.node** %nextp
+  br label %loop
+
+exit:
+  ret void
+}
+
+define i32 @main(i64 %which) {
+entry:
+  %a = alloca i32, align 4
+  %b = alloca i32, align 4
+  %c = alloca i32, align 4
+  %l0 = call %struct.node* @push(%struct.node* null, i32* %a)
+  %l1 = call %struct.node* @push(%struct.node* %l0, i32* %b)
+  %m0 = call %struct.node* @push(%struct.node* null, i32* %c)
+  %h0 = getelementptr [2 x %struct.node*], [2 x %struct.node*]* @heads, i64 0, i64 0
+  store %struct.node* %l1, %struct.node** %h0
+  %h1 = getelementptr [2 x %struct.node*], [2 x %struct.node*]* @heads, i64 0, i64 1
+  store %struct.node* %m0, %struct.node** %h1
+  %hp = getelementptr [2 x %struct.node*], [2 x %struct.node*]* @heads, i64 0, i64 %which
+  %head = load %struct.node*, %struct.node** %hp
+  call void @walk(%struct.node* %head, i64 %which)
+  ret i32 0
+}